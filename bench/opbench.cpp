@@ -0,0 +1,667 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "../keyarray.h"
+
+/*
+ *  File: bench/opbench.cpp
+ *  Status: Complete
+ *
+ *  Operation Benchmark: Unsigned key list against standard containers
+ *
+ *  Times create, insert (random, ascending, descending order), remove,
+ *  retrieve (hit, miss), find index, copy, and release unused space, for
+ *  an unsigned key list, std::map, std::unordered_map, and a sorted
+ *  std::vector. Keys are drawn from uniform, Zipfian, and clustered
+ *  distributions, at list sizes from 10 up to 10,000,000 items.
+ *
+ *  Results are written to stdout as CSV, one row per measurement:
+ *    container,operation,distribution,items,ops,ns_per_op
+ *  items is the number of unique keys in the list, and ops the number of
+ *  operations timed. Operations a container has no equivalent for are
+ *  left out.
+ *
+ *  Build and run with the Makefile in this directory:
+ *    make opbench.csv
+ *  or pass the largest list size to time, to finish sooner:
+ *    ./opbench 100000 > opbench.csv
+ *
+ *  Random and descending inserts into a sorted array move half of it, on
+ *  average, for every insert, so they are only timed up to
+ *  BENCH_INSERT_LIMIT items for the key list and the sorted vector.
+ *
+ *  https://github.com/orlandol/keyarray
+ */
+
+/*
+ * Benchmark declarations
+ */
+
+  #ifndef BENCH_INSERT_LIMIT
+    #define BENCH_INSERT_LIMIT 100000
+  #endif
+
+  #define LOOKUP_COUNT (1 << 20)
+  #define REMOVE_COUNT 1024
+  #define CREATE_COUNT 1024
+  #define COPY_TOTAL (1 << 22)
+
+  #define ZIPF_THETA 0.99
+  #define CLUSTER_SIZE 256
+  #define CLUSTER_SPAN 1024
+
+  const size_t listSizes[] = { 10, 100, 1000, 10000, 100000, 1000000,
+      10000000 };
+  const size_t listSizeCount = sizeof(listSizes) / sizeof(listSizes[0]);
+
+  enum Distribution {
+    DistributionUniform,
+    DistributionZipf,
+    DistributionClustered,
+    DistributionCount
+  };
+
+  const char* distributionName[DistributionCount] = {
+    "uniform", "zipf", "clustered"
+  };
+
+  unsigned randomState = 2463534242u;
+  volatile size_t checksum = 0;
+
+  typedef std::chrono::steady_clock BenchClock;
+
+  unsigned NextRandom( unsigned* state ) {
+    (*state) ^= (*state) << 13;
+    (*state) ^= (*state) >> 17;
+    (*state) ^= (*state) << 5;
+    return (*state);
+  }
+
+  double ElapsedNs( BenchClock::time_point startTime, size_t opCount ) {
+    std::chrono::duration<double, std::nano> elapsed =
+      BenchClock::now() - startTime;
+
+    return elapsed.count() / (double)(opCount ? opCount : 1);
+  }
+
+  void PrintResult( const char* containerName, const char* operationName,
+      int distribution, size_t itemCount, size_t opCount, double ns ) {
+    printf( "%s,%s,%s,%u,%u,%.2f\n", containerName, operationName,
+        distributionName[distribution], (unsigned)itemCount,
+        (unsigned)opCount, ns );
+    fflush( stdout );
+  }
+
+/*
+ * Key generation
+ */
+
+  /* Keys are even, so that key + 1 is always a miss */
+  unsigned EvenKey( unsigned value ) {
+    return (value & 0x7FFFFFFFu) << 1;
+  }
+
+  /* Zipfian ranks 1 to rankCount, after Gray et al., "Quickly
+     Generating Billion-Record Synthetic Databases" */
+  struct ZipfState {
+    double rankCount;
+    double zetaN;
+    double alpha;
+    double eta;
+    double halfPowTheta;
+  };
+
+  void ZipfInit( ZipfState* zipf, size_t rankCount ) {
+    double zeta2 = 1.0 + pow(0.5, ZIPF_THETA);
+    size_t rank;
+
+    zipf->rankCount = (double)rankCount;
+    zipf->zetaN = 0.0;
+    for( rank = 1; rank <= rankCount; rank++ ) {
+      zipf->zetaN += 1.0 / pow((double)rank, ZIPF_THETA);
+    }
+
+    zipf->alpha = 1.0 / (1.0 - ZIPF_THETA);
+    zipf->eta = (1.0 - pow(2.0 / zipf->rankCount, 1.0 - ZIPF_THETA)) /
+      (1.0 - (zeta2 / zipf->zetaN));
+    zipf->halfPowTheta = pow(0.5, ZIPF_THETA);
+  }
+
+  size_t ZipfNext( ZipfState* zipf ) {
+    double uniform = (double)NextRandom(&randomState) / 4294967296.0;
+    double scaled = uniform * zipf->zetaN;
+    size_t rank;
+
+    if( scaled < 1.0 ) {
+      return 1;
+    }
+
+    if( scaled < (1.0 + zipf->halfPowTheta) ) {
+      return 2;
+    }
+
+    rank = 1 + (size_t)(zipf->rankCount *
+      pow((zipf->eta * uniform) - zipf->eta + 1.0, zipf->alpha));
+    return (rank > (size_t)zipf->rankCount) ?
+      (size_t)zipf->rankCount : rank;
+  }
+
+  /* Fills keys with keyCount keys, in insertion order. Zipfian keys
+     repeat, so the list holds fewer unique keys than keyCount. */
+  void GenerateKeys( std::vector<unsigned>& keys, size_t keyCount,
+      int distribution ) {
+    ZipfState zipf;
+    unsigned clusterBase = 0;
+    size_t keyIndex;
+
+    keys.resize(keyCount);
+
+    switch( distribution ) {
+    case DistributionUniform:
+      for( keyIndex = 0; keyIndex < keyCount; keyIndex++ ) {
+        keys[keyIndex] = EvenKey(NextRandom(&randomState));
+      }
+      break;
+
+    case DistributionZipf:
+      /* Ranks are scattered over the key space, so hot keys are not
+         next to each other */
+      ZipfInit( &zipf, keyCount );
+      for( keyIndex = 0; keyIndex < keyCount; keyIndex++ ) {
+        keys[keyIndex] =
+          EvenKey((unsigned)ZipfNext(&zipf) * 2654435761u);
+      }
+      break;
+
+    default:
+      /* Runs of CLUSTER_SIZE keys, close together around random bases */
+      for( keyIndex = 0; keyIndex < keyCount; keyIndex++ ) {
+        if( (keyIndex % CLUSTER_SIZE) == 0 ) {
+          clusterBase = NextRandom(&randomState);
+        }
+        keys[keyIndex] = EvenKey(clusterBase +
+          (NextRandom(&randomState) % CLUSTER_SPAN));
+      }
+      break;
+    }
+  }
+
+/*
+ * Containers
+ *
+ * Each container wraps the same operations, so one template can time
+ * them all. Operations without an equivalent report false from the
+ * matching Has* member.
+ */
+
+  int CopyData( unsigned* destData, unsigned* sourceData ) {
+    (*destData) = (*sourceData);
+    return 1;
+  }
+
+  void FreeData( unsigned* data ) {
+    (void)data;
+  }
+
+  DECLARE_UINT_KEYARRAY_TYPES( BenchList, unsigned )
+  DECLARE_UINT_KEYARRAY_CREATE( BenchListCreate, BenchList )
+  DECLARE_UINT_KEYARRAY_FREE( BenchListFree, BenchList, FreeData )
+  DECLARE_UINT_KEYARRAY_INSERT( BenchListInsert, BenchList, unsigned )
+  DECLARE_UINT_KEYARRAY_REMOVE( BenchListRemove, BenchList, FreeData )
+  DECLARE_UINT_KEYARRAY_RETRIEVE( BenchListRetrieve, BenchList, unsigned )
+  DECLARE_UINT_KEYARRAY_FINDINDEX( BenchListFindIndex, BenchList )
+  DECLARE_UINT_KEYARRAY_RESERVE( BenchListReserve, BenchList )
+  DECLARE_UINT_KEYARRAY_RELEASEUNUSED( BenchListReleaseUnused, BenchList )
+  DECLARE_UINT_KEYARRAY_COPY( BenchListCopy, BenchList, unsigned,
+      CopyData, FreeData )
+
+  struct KeyArrayContainer {
+    BenchList* list;
+
+    static const char* Name() { return "keyarray"; }
+    static bool QuadraticInsert() { return true; }
+    static bool HasFindIndex() { return true; }
+    static bool HasReleaseUnused() { return true; }
+
+    KeyArrayContainer() : list(NULL) {}
+    ~KeyArrayContainer() { BenchListFree( &list ); }
+
+    bool Create( size_t reserveCount ) {
+      list = BenchListCreate(reserveCount);
+      return list != NULL;
+    }
+
+    void Free() { BenchListFree( &list ); }
+
+    bool Insert( unsigned key, unsigned data ) {
+      return BenchListInsert(list, key, &data) != 0;
+    }
+
+    void Remove( unsigned key ) { BenchListRemove( list, key ); }
+
+    bool Retrieve( unsigned key, unsigned* data ) {
+      return BenchListRetrieve(list, key, data) != 0;
+    }
+
+    size_t FindIndex( unsigned key ) {
+      return (size_t)BenchListFindIndex(list, key);
+    }
+
+    bool CopyFrom( const KeyArrayContainer& source ) {
+      list = BenchListCopy(source.list);
+      return list != NULL;
+    }
+
+    /* Leaves a third of the list unused, for release unused to free */
+    void AddSlack() {
+      BenchListReserve( list, list->itemCount + (list->itemCount / 2) );
+    }
+
+    void ReleaseUnused() { BenchListReleaseUnused( list ); }
+
+    size_t Count() const { return list->itemCount; }
+  };
+
+  struct MapContainer {
+    std::map<unsigned, unsigned>* list;
+
+    static const char* Name() { return "std::map"; }
+    static bool QuadraticInsert() { return false; }
+    static bool HasFindIndex() { return false; }
+    static bool HasReleaseUnused() { return false; }
+
+    MapContainer() : list(NULL) {}
+    ~MapContainer() { delete list; }
+
+    bool Create( size_t reserveCount ) {
+      (void)reserveCount;
+      list = new std::map<unsigned, unsigned>();
+      return true;
+    }
+
+    void Free() { delete list; list = NULL; }
+
+    bool Insert( unsigned key, unsigned data ) {
+      return list->insert(std::make_pair(key, data)).second;
+    }
+
+    void Remove( unsigned key ) { list->erase( key ); }
+
+    bool Retrieve( unsigned key, unsigned* data ) {
+      std::map<unsigned, unsigned>::const_iterator found = list->find(key);
+
+      if( found == list->end() ) {
+        return false;
+      }
+      (*data) = found->second;
+      return true;
+    }
+
+    size_t FindIndex( unsigned key ) { (void)key; return 0; }
+
+    bool CopyFrom( const MapContainer& source ) {
+      list = new std::map<unsigned, unsigned>(*source.list);
+      return true;
+    }
+
+    void AddSlack() {}
+    void ReleaseUnused() {}
+
+    size_t Count() const { return list->size(); }
+  };
+
+  struct UnorderedMapContainer {
+    std::unordered_map<unsigned, unsigned>* list;
+
+    static const char* Name() { return "std::unordered_map"; }
+    static bool QuadraticInsert() { return false; }
+    static bool HasFindIndex() { return false; }
+    static bool HasReleaseUnused() { return true; }
+
+    UnorderedMapContainer() : list(NULL) {}
+    ~UnorderedMapContainer() { delete list; }
+
+    bool Create( size_t reserveCount ) {
+      list = new std::unordered_map<unsigned, unsigned>();
+      list->reserve(reserveCount);
+      return true;
+    }
+
+    void Free() { delete list; list = NULL; }
+
+    bool Insert( unsigned key, unsigned data ) {
+      return list->insert(std::make_pair(key, data)).second;
+    }
+
+    void Remove( unsigned key ) { list->erase( key ); }
+
+    bool Retrieve( unsigned key, unsigned* data ) {
+      std::unordered_map<unsigned, unsigned>::const_iterator found =
+        list->find(key);
+
+      if( found == list->end() ) {
+        return false;
+      }
+      (*data) = found->second;
+      return true;
+    }
+
+    size_t FindIndex( unsigned key ) { (void)key; return 0; }
+
+    bool CopyFrom( const UnorderedMapContainer& source ) {
+      list = new std::unordered_map<unsigned, unsigned>(*source.list);
+      return true;
+    }
+
+    void AddSlack() { list->reserve( list->size() * 3 ); }
+    void ReleaseUnused() { list->rehash( 0 ); }
+
+    size_t Count() const { return list->size(); }
+  };
+
+  typedef std::pair<unsigned, unsigned> VectorItem;
+
+  bool VectorItemLess( const VectorItem& item, unsigned key ) {
+    return item.first < key;
+  }
+
+  struct SortedVectorContainer {
+    std::vector<VectorItem>* list;
+
+    static const char* Name() { return "sorted std::vector"; }
+    static bool QuadraticInsert() { return true; }
+    static bool HasFindIndex() { return true; }
+    static bool HasReleaseUnused() { return true; }
+
+    SortedVectorContainer() : list(NULL) {}
+    ~SortedVectorContainer() { delete list; }
+
+    bool Create( size_t reserveCount ) {
+      list = new std::vector<VectorItem>();
+      list->reserve(reserveCount);
+      return true;
+    }
+
+    void Free() { delete list; list = NULL; }
+
+    bool Insert( unsigned key, unsigned data ) {
+      std::vector<VectorItem>::iterator position =
+        std::lower_bound(list->begin(), list->end(), key, VectorItemLess);
+
+      if( (position != list->end()) && (position->first == key) ) {
+        return false;
+      }
+      list->insert( position, VectorItem(key, data) );
+      return true;
+    }
+
+    void Remove( unsigned key ) {
+      std::vector<VectorItem>::iterator position =
+        std::lower_bound(list->begin(), list->end(), key, VectorItemLess);
+
+      if( (position != list->end()) && (position->first == key) ) {
+        list->erase( position );
+      }
+    }
+
+    bool Retrieve( unsigned key, unsigned* data ) {
+      std::vector<VectorItem>::const_iterator position =
+        std::lower_bound(list->begin(), list->end(), key, VectorItemLess);
+
+      if( (position == list->end()) || (position->first != key) ) {
+        return false;
+      }
+      (*data) = position->second;
+      return true;
+    }
+
+    size_t FindIndex( unsigned key ) {
+      std::vector<VectorItem>::const_iterator position =
+        std::lower_bound(list->begin(), list->end(), key, VectorItemLess);
+
+      if( (position == list->end()) || (position->first != key) ) {
+        return (size_t)-1;
+      }
+      return (size_t)(position - list->begin());
+    }
+
+    bool CopyFrom( const SortedVectorContainer& source ) {
+      list = new std::vector<VectorItem>(*source.list);
+      return true;
+    }
+
+    void AddSlack() { list->reserve( list->size() + (list->size() / 2) ); }
+    void ReleaseUnused() { list->shrink_to_fit(); }
+
+    size_t Count() const { return list->size(); }
+  };
+
+/*
+ * Measurements
+ */
+
+  struct BenchKeys {
+    std::vector<unsigned> insertKey;
+    std::vector<unsigned> sortedKey;
+    std::vector<unsigned> hitKey;
+    std::vector<unsigned> removeKey;
+  };
+
+  /* Times inserting keys, in order, into a new container */
+  template <typename Container>
+  bool TimeInsert( Container& container, const std::vector<unsigned>& keys,
+      const char* operationName, int distribution ) {
+    BenchClock::time_point startTime;
+    size_t keyIndex;
+    size_t inserted = 0;
+
+    if( container.Create(0) == false ) {
+      return false;
+    }
+
+    startTime = BenchClock::now();
+    for( keyIndex = 0; keyIndex < keys.size(); keyIndex++ ) {
+      inserted += container.Insert(keys[keyIndex], (unsigned)keyIndex);
+    }
+    PrintResult( Container::Name(), operationName, distribution,
+        container.Count(), keys.size(), ElapsedNs(startTime, keys.size()) );
+
+    checksum += inserted;
+    return true;
+  }
+
+  template <typename Container>
+  bool RunContainer( const BenchKeys& keys, int distribution ) {
+    Container container;
+    Container scratch;
+    BenchClock::time_point startTime;
+    std::vector<unsigned> descendingKey(keys.sortedKey.rbegin(),
+        keys.sortedKey.rend());
+    size_t itemCount = keys.sortedKey.size();
+    size_t opCount;
+    size_t opIndex;
+    size_t sum = 0;
+    unsigned data = 0;
+
+    /* Create, with room for every item */
+    startTime = BenchClock::now();
+    for( opIndex = 0; opIndex < CREATE_COUNT; opIndex++ ) {
+      if( scratch.Create(itemCount) == false ) {
+        return false;
+      }
+      scratch.Free();
+    }
+    PrintResult( Container::Name(), "create", distribution, itemCount,
+        CREATE_COUNT, ElapsedNs(startTime, CREATE_COUNT) );
+
+    /* Insert, in each order. The ascending list is kept. */
+    if( (Container::QuadraticInsert() == false) ||
+        (itemCount <= BENCH_INSERT_LIMIT) ) {
+      if( TimeInsert(scratch, keys.insertKey, "insert_random",
+          distribution) == false ) {
+        return false;
+      }
+      scratch.Free();
+
+      if( TimeInsert(scratch, descendingKey, "insert_descending",
+          distribution) == false ) {
+        return false;
+      }
+      scratch.Free();
+    }
+
+    if( TimeInsert(container, keys.sortedKey, "insert_ascending",
+        distribution) == false ) {
+      return false;
+    }
+    itemCount = container.Count();
+
+    /* Retrieve, hits then misses */
+    startTime = BenchClock::now();
+    for( opIndex = 0; opIndex < LOOKUP_COUNT; opIndex++ ) {
+      sum += container.Retrieve(keys.hitKey[opIndex], &data);
+      sum += data;
+    }
+    PrintResult( Container::Name(), "retrieve_hit", distribution,
+        itemCount, LOOKUP_COUNT, ElapsedNs(startTime, LOOKUP_COUNT) );
+
+    startTime = BenchClock::now();
+    for( opIndex = 0; opIndex < LOOKUP_COUNT; opIndex++ ) {
+      sum += container.Retrieve(keys.hitKey[opIndex] + 1, &data);
+    }
+    PrintResult( Container::Name(), "retrieve_miss", distribution,
+        itemCount, LOOKUP_COUNT, ElapsedNs(startTime, LOOKUP_COUNT) );
+
+    if( Container::HasFindIndex() ) {
+      startTime = BenchClock::now();
+      for( opIndex = 0; opIndex < LOOKUP_COUNT; opIndex++ ) {
+        sum += container.FindIndex(keys.hitKey[opIndex]);
+      }
+      PrintResult( Container::Name(), "findindex", distribution,
+          itemCount, LOOKUP_COUNT, ElapsedNs(startTime, LOOKUP_COUNT) );
+    }
+
+    /* Copy the whole list, enough times to time small lists */
+    opCount = (COPY_TOTAL / itemCount) ? (COPY_TOTAL / itemCount) : 1;
+    startTime = BenchClock::now();
+    for( opIndex = 0; opIndex < opCount; opIndex++ ) {
+      if( scratch.CopyFrom(container) == false ) {
+        return false;
+      }
+      sum += scratch.Count();
+      scratch.Free();
+    }
+    PrintResult( Container::Name(), "copy", distribution, itemCount,
+        opCount, ElapsedNs(startTime, opCount) );
+
+    /* Release unused, timing only the release of each fresh copy */
+    if( Container::HasReleaseUnused() ) {
+      std::chrono::duration<double, std::nano> elapsed(0);
+
+      for( opIndex = 0; opIndex < opCount; opIndex++ ) {
+        if( scratch.CopyFrom(container) == false ) {
+          return false;
+        }
+        scratch.AddSlack();
+
+        startTime = BenchClock::now();
+        scratch.ReleaseUnused();
+        elapsed += BenchClock::now() - startTime;
+
+        sum += scratch.Count();
+        scratch.Free();
+      }
+      PrintResult( Container::Name(), "releaseunused", distribution,
+          itemCount, opCount, elapsed.count() / (double)opCount );
+    }
+
+    /* Remove, last, as it changes the list */
+    startTime = BenchClock::now();
+    for( opIndex = 0; opIndex < keys.removeKey.size(); opIndex++ ) {
+      container.Remove( keys.removeKey[opIndex] );
+    }
+    PrintResult( Container::Name(), "remove", distribution, itemCount,
+        keys.removeKey.size(), ElapsedNs(startTime, keys.removeKey.size()) );
+
+    checksum += sum + container.Count();
+    return true;
+  }
+
+  void PrepareKeys( BenchKeys& keys, size_t keyCount, int distribution ) {
+    std::vector<unsigned> shuffled;
+    size_t keyIndex;
+    size_t swapIndex;
+
+    GenerateKeys( keys.insertKey, keyCount, distribution );
+
+    keys.sortedKey = keys.insertKey;
+    std::sort( keys.sortedKey.begin(), keys.sortedKey.end() );
+    keys.sortedKey.erase( std::unique(keys.sortedKey.begin(),
+        keys.sortedKey.end()), keys.sortedKey.end() );
+
+    /* Lookups follow the insert distribution, so Zipfian lookups favor
+       the same hot keys */
+    keys.hitKey.resize(LOOKUP_COUNT);
+    for( keyIndex = 0; keyIndex < LOOKUP_COUNT; keyIndex++ ) {
+      keys.hitKey[keyIndex] =
+        keys.insertKey[NextRandom(&randomState) % keyCount];
+    }
+
+    /* Remove distinct keys, in random order */
+    shuffled = keys.sortedKey;
+    for( keyIndex = shuffled.size(); keyIndex > 1; keyIndex-- ) {
+      swapIndex = NextRandom(&randomState) % keyIndex;
+      std::swap( shuffled[keyIndex - 1], shuffled[swapIndex] );
+    }
+    if( shuffled.size() > REMOVE_COUNT ) {
+      shuffled.resize(REMOVE_COUNT);
+    }
+    keys.removeKey = shuffled;
+  }
+
+/*
+ * Main program
+ */
+
+  int main( int argc, char* argv[] ) {
+    size_t maxCount = listSizes[listSizeCount - 1];
+    size_t sizeIndex;
+    int distribution;
+    BenchKeys keys;
+
+    if( argc > 1 ) {
+      maxCount = (size_t)strtoul(argv[1], NULL, 10);
+    }
+
+    printf( "container,operation,distribution,items,ops,ns_per_op\n" );
+
+    for( sizeIndex = 0; sizeIndex < listSizeCount; sizeIndex++ ) {
+      if( listSizes[sizeIndex] > maxCount ) {
+        break;
+      }
+
+      for( distribution = 0; distribution < DistributionCount;
+          distribution++ ) {
+        PrepareKeys( keys, listSizes[sizeIndex], distribution );
+
+        if( !(RunContainer<KeyArrayContainer>(keys, distribution) &&
+            RunContainer<MapContainer>(keys, distribution) &&
+            RunContainer<UnorderedMapContainer>(keys, distribution) &&
+            RunContainer<SortedVectorContainer>(keys, distribution)) ) {
+          fprintf( stderr, "Error allocating %u items\n",
+              (unsigned)listSizes[sizeIndex] );
+          return 1;
+        }
+      }
+    }
+
+    return 0;
+  }
@@ -0,0 +1,207 @@
+#include <stdio.h>
+#include <time.h>
+
+#include "../keyarray.h"
+
+/*
+ *  File: bench/uintsearch.c
+ *  Status: Complete
+ *
+ *  Unsigned Key Search Benchmark: Linear scan threshold crossover
+ *
+ *  Times the original binary search loop against KeyArrayUintLowerBound
+ *  at several linear scan thresholds, for dense keys (structure of arrays
+ *  layout) and for keys interleaved with item data (array of structures
+ *  layout). The fastest threshold for each list size is marked with a *.
+ *
+ *  Build with optimizations, and once more with -DKEYARRAY_NO_SIMD to
+ *  compare against the scalar scan:
+ *    cc -O2 -o uintsearch uintsearch.c
+ *
+ *  https://github.com/orlandol/keyarray
+ */
+
+/*
+ * Benchmark declarations
+ */
+
+  typedef struct BenchItem {
+    unsigned key;
+    unsigned data;
+  } BenchItem;
+
+  #define LOOKUP_COUNT (1 << 16)
+  #define LOOKUP_TOTAL (1 << 21)
+
+  const size_t listSizes[] = { 8, 16, 32, 64, 128, 256, 1024, 16384,
+      262144, 4194304 };
+  const size_t listSizeCount = sizeof(listSizes) / sizeof(listSizes[0]);
+
+  const size_t thresholds[] = { 1, 4, 8, 16, 32, 64, 128 };
+  const size_t thresholdCount = sizeof(thresholds) / sizeof(thresholds[0]);
+
+  unsigned* keys = NULL;
+  BenchItem* items = NULL;
+  unsigned lookupKey[LOOKUP_COUNT];
+  unsigned randomState = 2463534242u;
+  volatile size_t checksum = 0;
+
+  unsigned NextRandom( unsigned* state ) {
+    (*state) ^= (*state) << 13;
+    (*state) ^= (*state) >> 17;
+    (*state) ^= (*state) << 5;
+    return (*state);
+  }
+
+  /* The search loop as it was written before the vectorized scan */
+  size_t ClassicFindIndex( const void* keyBase, size_t keyStride,
+      size_t itemCount, unsigned key ) {
+    size_t leftIndex = 0;
+    size_t rightIndex = itemCount;
+    size_t searchIndex = itemCount / 2;
+
+    while( leftIndex < rightIndex ) {
+      if( KEYARRAY_UINT_KEYAT(keyBase, keyStride, searchIndex) == key ) {
+        return searchIndex;
+      }
+
+      if( KEYARRAY_UINT_KEYAT(keyBase, keyStride, searchIndex) > key ) {
+        rightIndex = searchIndex;
+      } else {
+        leftIndex = searchIndex + 1;
+      }
+
+      searchIndex = (leftIndex + rightIndex) / 2;
+    }
+
+    return itemCount;
+  }
+
+  /* Returns nanoseconds per lookup; a threshold of 0 times the
+     original loop */
+  double TimeLookups( const void* keyBase, size_t keyStride,
+      size_t itemCount, size_t threshold ) {
+    clock_t startTime;
+    size_t lookupIndex;
+    size_t sum = 0;
+
+    startTime = clock();
+
+    for( lookupIndex = 0; lookupIndex < LOOKUP_TOTAL; lookupIndex++ ) {
+      if( threshold ) {
+        sum += KeyArrayUintLowerBound(keyBase, keyStride, itemCount,
+            lookupKey[lookupIndex & (LOOKUP_COUNT - 1)], threshold);
+      } else {
+        sum += ClassicFindIndex(keyBase, keyStride, itemCount,
+            lookupKey[lookupIndex & (LOOKUP_COUNT - 1)]);
+      }
+    }
+
+    checksum += sum;
+
+    return ((double)(clock() - startTime) * 1e9) /
+      ((double)CLOCKS_PER_SEC * LOOKUP_TOTAL);
+  }
+
+  void RunLayout( const char* layoutName, int dense ) {
+    size_t sizeIndex;
+    size_t thresholdIndex;
+    size_t itemCount;
+    size_t lookupIndex;
+    double elapsed[sizeof(thresholds) / sizeof(thresholds[0])];
+    double classicElapsed;
+    size_t bestIndex;
+
+    printf( "\n%s layout, ns per lookup\n", layoutName );
+    printf( "%10s %8s", "items", "loop" );
+    for( thresholdIndex = 0; thresholdIndex < thresholdCount;
+        thresholdIndex++ ) {
+      printf( " %7s%-3u", "t=", (unsigned)thresholds[thresholdIndex] );
+    }
+    printf( "\n" );
+
+    for( sizeIndex = 0; sizeIndex < listSizeCount; sizeIndex++ ) {
+      itemCount = listSizes[sizeIndex];
+
+      /* Keys are even, so about half of the lookups miss */
+      for( lookupIndex = 0; lookupIndex < LOOKUP_COUNT; lookupIndex++ ) {
+        lookupKey[lookupIndex] =
+          NextRandom(&randomState) % (unsigned)(itemCount * 2);
+      }
+
+      classicElapsed = dense ?
+        TimeLookups(keys, sizeof(unsigned), itemCount, 0) :
+        TimeLookups(items, sizeof(BenchItem), itemCount, 0);
+
+      bestIndex = 0;
+      for( thresholdIndex = 0; thresholdIndex < thresholdCount;
+          thresholdIndex++ ) {
+        elapsed[thresholdIndex] = dense ?
+          TimeLookups(keys, sizeof(unsigned), itemCount,
+            thresholds[thresholdIndex]) :
+          TimeLookups(items, sizeof(BenchItem), itemCount,
+            thresholds[thresholdIndex]);
+
+        if( elapsed[thresholdIndex] < elapsed[bestIndex] ) {
+          bestIndex = thresholdIndex;
+        }
+      }
+
+      printf( "%10u %8.1f", (unsigned)itemCount, classicElapsed );
+      for( thresholdIndex = 0; thresholdIndex < thresholdCount;
+          thresholdIndex++ ) {
+        printf( " %9.1f%c", elapsed[thresholdIndex],
+            (thresholdIndex == bestIndex) ? '*' : ' ' );
+      }
+      printf( "\n" );
+    }
+  }
+
+/*
+ * Main program
+ */
+
+  int main( void ) {
+    size_t maxCount = listSizes[listSizeCount - 1];
+    size_t itemIndex;
+
+    keys = (unsigned*)malloc(maxCount * sizeof(unsigned));
+    items = (BenchItem*)malloc(maxCount * sizeof(BenchItem));
+    if( !(keys && items) ) {
+      printf( "Error allocating %u items\n", (unsigned)maxCount );
+      goto ReturnError;
+    }
+
+    /* Sorted keys with gaps */
+    for( itemIndex = 0; itemIndex < maxCount; itemIndex++ ) {
+      keys[itemIndex] = (unsigned)(itemIndex * 2);
+      items[itemIndex].key = keys[itemIndex];
+      items[itemIndex].data = (unsigned)itemIndex;
+    }
+
+  #if defined(KEYARRAY_SIMD_AVX2)
+    printf( "Vector scan: %s\n", KEYARRAY_HAS_AVX2() ? "AVX2" : "SSE2" );
+  #elif defined(KEYARRAY_SIMD_SSE2)
+    printf( "Vector scan: SSE2\n" );
+  #else
+    printf( "Vector scan: none\n" );
+  #endif
+
+    RunLayout( "Structure of arrays", 1 );
+    RunLayout( "Array of structures", 0 );
+
+    free( keys );
+    free( items );
+
+    return 0;
+
+  ReturnError:
+    if( keys ) {
+      free( keys );
+    }
+    if( items ) {
+      free( items );
+    }
+
+    return 1;
+  }
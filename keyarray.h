@@ -27,6 +27,8 @@ SOFTWARE.
 
 #include <stdlib.h>
 #include <string.h>
+#include <stdint.h>
+#include <limits.h>
 
 /*
  * ================
@@ -44,8 +46,10 @@ SOFTWARE.
       dataType data;
     } typeNameItem;
 
+    typedef unsigned typeNameKey;
+
     typedef struct typeNameItem {
-      unsigned key;
+      typeNameKey key;
       dataType data;
     } typeNameItem;
 
@@ -56,6 +60,10 @@ SOFTWARE.
       typeNameItem* item;
     } typeName;
 
+  Unsigned key lists also declare internal fields, after item, to
+    support the read-optimized search index. String key lists declare
+    internal fields, after item, for the key arena and the hash index.
+
   Declares the list as typeName. Declares the key and item types
     internally. Declares the data field as the specified dataType.
 
@@ -64,6 +72,19 @@ SOFTWARE.
 
   Direct access through list->item[index].data
     or list->item[index].data.subfield
+
+  DECLARE_UINT_KEYARRAY_TYPES_WIDTH( typeName, dataType, keyWidth )
+
+  Declares an unsigned key list, with keyWidth bit keys; keyWidth is 16,
+    32, or 64. Key parameters are typeNameKey, in place of unsigned.
+
+  Only the array of structures list functions take other key widths.
+    These use unsigned, 32 bit, keys only:
+    - The structure of arrays, blocked, sharded, snapshot, and mapped
+      layouts, which have no _WIDTH types.
+    - The search index, which is not enabled for 16 or 64 bit keys.
+    - Save, and the logged functions, which fail to compile for 16 or
+      64 bit keys.
   */
 
   /* Create list
@@ -99,14 +120,56 @@ SOFTWARE.
 
   Declares data insert function as funcName, respectively:
     int funcName( listType* keyList, char* key, dataType* data )
-    int funcName( listType* keyList, unsigned key, dataType* data )
+    int funcName( listType* keyList, listTypeKey key, dataType* data )
 
   Inserts data, sorted by key. The developer must allocate dynamic
     data, if applicable, prior to calling insert.
 
+  The search starts at the last insert position. A key past the last
+    key is appended after at most two compares, and a key near the last
+    insert is found in O(log distance) compares.
+
   Return values:
     0 = allocation/etc failure, or key already exists.
     Non-zero = Successful
+
+  The list grows geometrically, by KEYARRAY_GROWTH_NUMERATOR /
+    KEYARRAY_GROWTH_DENOMINATOR (default 3/2), and by at least
+    KEYARRAY_GROWTH_MINIMUM (default 8) items.
+  */
+
+  /* Insert data, with a growth policy
+  DECLARE_STRING_KEYARRAY_INSERT_GROWTH( funcName, listType, dataType,
+      growFunc )
+  DECLARE_UINT_KEYARRAY_INSERT_GROWTH( funcName, listType, dataType,
+      growFunc )
+
+  Same as insert, except that the list grows by calling growFunc,
+    which returns the new reservedCount:
+    size_t growFunc( size_t reservedCount, size_t requiredCount ) {
+    ...
+    }
+
+  A return value less than requiredCount is treated as a failure.
+
+  growFunc can be developer defined, or declared with:
+    DECLARE_KEYARRAY_GEOMETRIC_GROWTH( funcName, numerator, denominator )
+    DECLARE_KEYARRAY_LINEAR_GROWTH( funcName, growCount )
+  */
+
+  /* Reserve space
+  DECLARE_STRING_KEYARRAY_RESERVE( funcName, listType )
+  DECLARE_UINT_KEYARRAY_RESERVE( funcName, listType )
+
+  Declares a function as funcName, to pre-size an existing list:
+    int funcName( listType* keyList, size_t reserveCount )
+
+  Grows the list to hold at least reserveCount items. Never shrinks
+    the list.
+
+  Return values:
+    0 = allocation/etc failure.
+    Non-zero = Successful
   */
 
   /* Remove data
@@ -115,7 +178,7 @@ SOFTWARE.
 
   Declares data remove function as funcName, respectively:
     void funcName( listType* keyList, char* key )
-    void funcName( listType* keyList, unsigned key )
+    void funcName( listType* keyList, listTypeKey key )
 
   Removes the key and its associated data from the list.
 
@@ -131,7 +194,7 @@ SOFTWARE.
 
   Declares data search function as funcName, respectively:
     int funcName( listType* keyList, char* key, dataType* destData )
-    int funcName( listType* keyList, unsigned key, dataType* destData )
+    int funcName( listType* keyList, listTypeKey key, dataType* destData )
 
   Searches for data by key, and copies its contents to destData.
     destData must have the same dataType, to receive a copy.
@@ -147,7 +210,7 @@ SOFTWARE.
 
   Declares modify data function as funcName, respectively:
     int funcName( listType* keyList, char* key, dataType* sourceData )
-    int funcName( listType* keyList, unsigned key, dataType* sourceData )
+    int funcName( listType* keyList, listTypeKey key, dataType* sourceData )
 
   Searches for data by key, and copies back sourceData. Assumes that
     developer worked from original item data.
@@ -162,20 +225,215 @@ SOFTWARE.
   /* Find list index
   DECLARE_STRING_KEYARRAY_FINDINDEX( funcName, listType )
   DECLARE_UINT_KEYARRAY_FINDINDEX( funcName, listType )
+  DECLARE_STRING_KEYARRAY_FINDINDEX_SIZE( funcName, listType )
+  DECLARE_UINT_KEYARRAY_FINDINDEX_SIZE( funcName, listType )
 
   Declares key index search function as funcName, respectively:
+    int funcName( listType* keyList, char* key )
+    int funcName( listType* keyList, listTypeKey key )
     size_t funcName( listType* keyList, char* key )
-    size_t funcName( listType* keyList, unsigned key )
+    size_t funcName( listType* keyList, listTypeKey key )
 
   Searches list for key, and returns the corresponding array index.
     Index value must be used immediately, or cached with care, as
     inserting a new item can invalidate the index.
 
+  The _SIZE functions return the index as size_t, for lists of more
+    than INT_MAX items.
+
   Return values:
-    (-1) = error in state, or key not found.
+    (-1) = error in state, key not found, or index past INT_MAX.
+    ((size_t)-1), from _SIZE = error in state, or key not found.
     Otherwise, the array index for key.
   */
 
+  /* Data pointer, upsert, and update
+  DECLARE_STRING_KEYARRAY_GETPTR( funcName, listType, dataType )
+  DECLARE_UINT_KEYARRAY_GETPTR( funcName, listType, dataType )
+
+  Declares data pointer lookup function as funcName, respectively:
+    dataType* funcName( listType* keyList, char* key )
+    dataType* funcName( listType* keyList, listTypeKey key )
+
+  Returns a pointer to the data of key, without copying it, or NULL if
+    not found. The pointer is valid until the list is next changed.
+
+  DECLARE_STRING_KEYARRAY_UPSERT( funcName, listType, dataType )
+  DECLARE_UINT_KEYARRAY_UPSERT( funcName, listType, dataType )
+  DECLARE_STRING_KEYARRAY_UPSERT_GROWTH( funcName, listType, dataType,
+      growFunc )
+  DECLARE_UINT_KEYARRAY_UPSERT_GROWTH( funcName, listType, dataType,
+      growFunc )
+
+  Declares find or insert function as funcName, respectively:
+    dataType* funcName( listType* keyList, char* key, dataType* data,
+        int* inserted )
+    dataType* funcName( listType* keyList, listTypeKey key, dataType* data,
+        int* inserted )
+
+  Finds key, or inserts it with a copy of data, in one search. Returns
+    a pointer to the data of key, or NULL on allocation/etc failure.
+    inserted, if not NULL, is set to 1 if data was inserted, or 0.
+    Grows, and searches from the last position used, the same as insert.
+
+  DECLARE_STRING_KEYARRAY_UPDATE( funcName, listType, dataType,
+      updateDataFunc )
+  DECLARE_UINT_KEYARRAY_UPDATE( funcName, listType, dataType,
+      updateDataFunc )
+
+  Declares in place update function as funcName, respectively:
+    int funcName( listType* keyList, char* key, dataType* sourceData )
+    int funcName( listType* keyList, listTypeKey key,
+        dataType* sourceData )
+
+  Internally calls developer defined data update function, on the data
+    of key, in place:
+    void updateDataFunc( dataType* data, dataType* sourceData ) {
+    ...
+    }
+
+  Return values:
+    0 = error in state, or key not found.
+    Non-zero = Successful
+  */
+
+  /* Batched lookups
+  DECLARE_STRING_KEYARRAY_FINDINDEXMANY( funcName, listType )
+  DECLARE_UINT_KEYARRAY_FINDINDEXMANY( funcName, listType )
+
+  Declares batched find index function as funcName, respectively:
+    size_t funcName( listType* keyList, char** key, size_t keyCount,
+        size_t* foundIndex )
+    size_t funcName( listType* keyList, listTypeKey* key, size_t keyCount,
+        size_t* foundIndex )
+
+  Stores the item index of each key in foundIndex, or (size_t)-1 if not
+    found.
+
+  DECLARE_STRING_KEYARRAY_RETRIEVEMANY( funcName, listType, dataType )
+  DECLARE_UINT_KEYARRAY_RETRIEVEMANY( funcName, listType, dataType )
+
+  Declares batched retrieve function as funcName, respectively:
+    size_t funcName( listType* keyList, char** key, size_t keyCount,
+        dataType* destData, int* found )
+    size_t funcName( listType* keyList, listTypeKey* key, size_t keyCount,
+        dataType* destData, int* found )
+
+  Copies the data of each key found to the same position in destData.
+    found, if not NULL, is set to 1 for each key found, or 0.
+
+  The binary searches of KEYARRAY_BATCH_WIDTH keys, 16 by default, run
+    interleaved, so their cache misses overlap. With a bloom filter,
+    lookup cache, hash index, or search index enabled, each key is looked
+    up through them instead, the same as find index.
+
+  DECLARE_CUSTOM_KEYARRAY_FINDINDEXMANY and _RETRIEVEMANY declare the
+    same functions for custom key lists, with typeNameKey keys.
+
+  Return values:
+    Number of keys found.
+  */
+
+  /* Lower bound, upper bound, and range
+  DECLARE_STRING_KEYARRAY_LOWERBOUND( funcName, listType )
+  DECLARE_UINT_KEYARRAY_LOWERBOUND( funcName, listType )
+  DECLARE_STRING_KEYARRAY_UPPERBOUND( funcName, listType )
+  DECLARE_UINT_KEYARRAY_UPPERBOUND( funcName, listType )
+
+  Declares bound search function as funcName, respectively:
+    size_t funcName( listType* keyList, char* key )
+    size_t funcName( listType* keyList, listTypeKey key )
+
+  Lower bound returns the index of the first key not less than key.
+    Upper bound returns the index of the first key greater than key.
+    Either returns itemCount if there is no such key, and 0 on error.
+
+  DECLARE_STRING_KEYARRAY_RANGE( funcName, listType )
+  DECLARE_UINT_KEYARRAY_RANGE( funcName, listType )
+
+  Declares key range search function as funcName, respectively:
+    size_t funcName( listType* keyList, char* firstKey, char* lastKey,
+        size_t* beginIndex )
+    size_t funcName( listType* keyList, listTypeKey firstKey,
+        listTypeKey lastKey, size_t* beginIndex )
+
+  Finds the items with keys from firstKey through lastKey, inclusive.
+    They are stored contiguously, from item[*beginIndex] onward, so the
+    range can be read in place.
+
+  Return values:
+    0 = error in state, or no keys in range.
+    Otherwise, the number of items in range.
+  */
+
+  /* Union, intersect, and difference
+  DECLARE_STRING_KEYARRAY_UNION( funcName, listType, dataType,
+      copyDataFunc, combineDataFunc, freeDataFunc )
+  DECLARE_UINT_KEYARRAY_UNION( funcName, listType, dataType,
+      copyDataFunc, combineDataFunc, freeDataFunc )
+  DECLARE_STRING_KEYARRAY_INTERSECT( funcName, listType, dataType,
+      combineDataFunc, freeDataFunc )
+  DECLARE_UINT_KEYARRAY_INTERSECT( funcName, listType, dataType,
+      combineDataFunc, freeDataFunc )
+  DECLARE_STRING_KEYARRAY_DIFFERENCE( funcName, listType, dataType,
+      copyDataFunc, freeDataFunc )
+  DECLARE_UINT_KEYARRAY_DIFFERENCE( funcName, listType, dataType,
+      copyDataFunc, freeDataFunc )
+
+  Declares set operation function as funcName:
+    listType* funcName( listType* leftList, listType* rightList )
+
+  Creates a new list, with the keys in either list (union), in both
+    lists (intersect), or in leftList but not rightList (difference).
+    Both lists are read in one merge pass, and are not changed.
+
+  Callback functions, respectively:
+    int copyDataFunc( dataType* destData, dataType* sourceData )
+    int combineDataFunc( dataType* destData, dataType* leftData,
+        dataType* rightData )
+    void freeDataFunc( dataType* freeData )
+
+  Return values:
+    NULL = allocation/etc failure
+    Otherwise, the new list
+  */
+
+  /* Read-optimized search index
+  DECLARE_UINT_KEYARRAY_SEARCHINDEX( funcName, listType )
+  DECLARE_UINT_KEYARRAY_SEARCHINDEX_SOA( funcName, listType )
+
+  Declares a function as funcName, to enable or disable the search index
+    of an unsigned key list:
+    int funcName( listType* keyList, int enable )
+
+  The search index is a copy of the keys in Eytzinger (breadth first)
+    order, searched without branches, with software prefetch. Once
+    enabled, retrieve, modify, and find index use it transparently.
+    Insert, remove, and merge batch mark it stale, and lookups search
+    the list directly until funcName( keyList, 1 ) rebuilds it.
+
+  Return values:
+    0 = allocation/etc failure.
+    Non-zero = Successful
+  */
+
+  /* Vectorized search
+  KEYARRAY_UINT_LINEAR_THRESHOLD
+  KEYARRAY_UINT_STRIDED_THRESHOLD
+  KEYARRAY_NO_SIMD
+  KEYARRAY_NO_AVX2
+
+  Unsigned key insert, remove, retrieve, modify, and find index narrow
+    the search with a branchless binary search, then count the keys in
+    the last few items with a linear scan. Dense keys (_SOA, and the
+    search index fallback) are scanned with SSE2 or AVX2, chosen at run
+    time. Keys interleaved with item data are scanned one at a time.
+
+  Define the thresholds before including keyarray.h to override the
+    window size of the linear scan. Define KEYARRAY_NO_SIMD, or
+    KEYARRAY_NO_AVX2, to build without the vector scans.
+  */
+
   /* Remove buffered space
   DECLARE_STRING_KEYARRAY_RELEASEUNUSED( funcName, listType )
   DECLARE_UINT_KEYARRAY_RELEASEUNUSED( funcName, listType )
@@ -211,855 +469,13474 @@ SOFTWARE.
     Non-NULL = New copy of sourceList
   */
 
-/*
- * =================================
- *  String Key Array implementation
- * =================================
- */
+  /* Bulk load list
+  DECLARE_STRING_KEYARRAY_BULKLOAD( funcName, listType, dataType,
+      duplicatePolicy, mergeDataFunc, freeDataFunc )
+  DECLARE_UINT_KEYARRAY_BULKLOAD( funcName, listType, dataType,
+      duplicatePolicy, mergeDataFunc, freeDataFunc )
 
-  #define DECLARE_STRING_KEYARRAY_TYPES(\
-      typeName, dataType )\
-  typedef struct typeName##Item {\
-    char* key;\
-    dataType data;\
-  } typeName##Item;\
-  \
-  typedef struct typeName {\
-    size_t reservedCount;\
-    size_t itemCount;\
-    typeName##Item* item;\
-  } typeName;
+  Declares a function as funcName, to create a list from an unsorted
+    array of items:
+    listType* funcName( listType##Item* sourceItem, size_t sourceCount )
 
-  #define DECLARE_STRING_KEYARRAY_CREATE( funcName, listType )\
-  listType* funcName( size_t reserveCount ) {\
-      listType* newKeyArray = NULL;\
-    \
-    newKeyArray = (listType*)calloc(1, sizeof(listType));\
-    if( newKeyArray == NULL ) {\
-      goto ReturnError;\
-    }\
-    \
-    if( reserveCount ) {\
-      newKeyArray->item =\
-        (listType##Item*)calloc(reserveCount, sizeof(listType##Item));\
-      if( newKeyArray->item == NULL ) {\
-        goto ReturnError;\
-      }\
-      \
-      newKeyArray->reservedCount = reserveCount;\
-    }\
-    return newKeyArray;\
-  \
-  ReturnError:\
-    if( newKeyArray ) {\
-      if( newKeyArray->item ) {\
-        free( newKeyArray->item );\
-        newKeyArray->item = NULL;\
-      }\
-      free( newKeyArray );\
-      newKeyArray = NULL;\
-    }\
-    return NULL;\
-  }
+  Sorts a copy of sourceItem in O(n log n), and allocates the list
+    once. String keys are copied. Data is moved into the list, the same
+    as insert.
 
-  #define DECLARE_STRING_KEYARRAY_FREE( funcName, listType, freeDataFunc )\
-  void funcName( listType** keyList ) {\
-    size_t index;\
-    size_t itemCount;\
-    \
-    if( keyList && (*keyList) ) {\
-      itemCount = (*keyList)->itemCount;\
-      for( index = 0; index < itemCount; index++ ) {\
-        if( (*keyList)->item[index].key ) {\
-          free( (*keyList)->item[index].key );\
-        }\
-        freeDataFunc( &((*keyList)->item[index].data) );\
-      }\
-      \
-      free( (*keyList) );\
-      (*keyList) = NULL;\
-    }\
-  }
+  duplicatePolicy is one of:
+    KEYARRAY_DUPLICATES_REJECT = Fail if any key is duplicated.
+    KEYARRAY_DUPLICATES_FIRST = Keep the first item, in source order.
+    KEYARRAY_DUPLICATES_LAST = Keep the last item, in source order.
+    KEYARRAY_DUPLICATES_MERGE = Merge duplicates into the first item.
 
-  #define DECLARE_STRING_KEYARRAY_INSERT( funcName, listType, dataType )\
-  int funcName( listType* keyList, char* key, dataType* data ) {\
-    unsigned leftIndex;\
-    unsigned insertIndex;\
-    unsigned rightIndex;\
-    int result;\
-    char* newStrKey;\
-    size_t keyLen;\
-    unsigned prevCount;\
-    unsigned reservedCount;\
-    unsigned itemCount;\
-    listType##Item* item;\
-    \
-    if( !(keyList && key && data) ) {\
-      return 0;\
-    }\
-    \
-    keyLen = strlen(key);\
-    if( keyLen == 0 ) {\
-      return 0;\
-    }\
-    \
-    /* Grow list, if necessary */\
-    reservedCount = keyList->reservedCount;\
-    itemCount = keyList->itemCount;\
-    item = keyList->item;\
-    \
-    if( itemCount == reservedCount ) {\
-      prevCount = reservedCount;\
-      reservedCount += 8;\
-      if( prevCount > reservedCount ) {\
-        return 0;\
-      }\
-      \
-      item = realloc(item, reservedCount * sizeof(listType##Item));\
-      if( item == NULL ) {\
-        return 0;\
-      }\
-      keyList->reservedCount = reservedCount;\
-      keyList->item = item;\
-    }\
-    \
-    /* Search for insert position */\
-    leftIndex = 0;\
-    rightIndex = itemCount;\
-    insertIndex = itemCount / 2;\
-    \
-    while( leftIndex < rightIndex ) {\
-      result = strcmp(item[insertIndex].key, key);\
-      \
-      if( result == 0 ) {\
-        return 0;\
-      }\
-      \
-      if( result > 0 ) {\
-        rightIndex = insertIndex;\
-      } else {\
-        leftIndex = insertIndex + 1;\
-      }\
-      \
-      insertIndex = (leftIndex + rightIndex) / 2;\
-    }\
-    \
-    /* Attempt to allocate key string before going further */\
-    newStrKey = malloc(keyLen + 1);\
-    if( newStrKey == NULL ) {\
-      return 0;\
-    }\
-    strcpy( newStrKey, key );\
-    \
-    /* Move data past insertion point up, if necessary */\
-    memmove( &(item[insertIndex + 1]), &(item[insertIndex]),\
-        (itemCount - insertIndex) * sizeof(listType##Item) );\
-    \
-    /* Insert item */\
-    item[insertIndex].key = newStrKey;\
-    if( data ) {\
-      memcpy( &(item[insertIndex].data), data, sizeof(dataType) );\
-    }\
-    \
-    keyList->itemCount++;\
-    \
-    return 1;\
-  }
+  Internally calls developer defined data merge function, which can
+    be empty unless duplicatePolicy is KEYARRAY_DUPLICATES_MERGE:
+    void mergeDataFunc( dataType* dest, dataType* source ) {
+    ...
+    }
 
-  #define DECLARE_STRING_KEYARRAY_REMOVE( funcName, listType, freeDataFunc )\
-  void funcName( listType* keyList, char* key ) {\
-    unsigned leftIndex;\
-    unsigned rightIndex;\
-    unsigned removeIndex;\
-    int result;\
-    unsigned reservedCount;\
-    unsigned itemCount;\
-    listType##Item* item;\
-    \
-    if( !(keyList && keyList->item && key && (*key)) ) {\
-      return;\
-    }\
-    \
-    reservedCount = keyList->reservedCount;\
-    itemCount = keyList->itemCount;\
-    item = keyList->item;\
-    \
-    /* Search for insert position */\
-    leftIndex = 0;\
-    rightIndex = itemCount;\
-    removeIndex = itemCount / 2;\
-    \
-    while( leftIndex < rightIndex ) {\
-      result = strcmp(item[removeIndex].key, key);\
-      \
-      if( result == 0 ) {\
-        freeDataFunc( &(item[removeIndex].data) );\
-        if( item[removeIndex].key ) {\
-          free( item[removeIndex].key );\
-          item[removeIndex].key = NULL;\
-        }\
-        \
-        if( itemCount ) {\
-          itemCount--;\
-          \
-          memcpy( &(item[removeIndex]), &(item[removeIndex + 1]),\
-            (itemCount - removeIndex) * sizeof(listType##Item) );\
-          \
-          keyList->itemCount = itemCount;\
-        }\
-        \
-        memset( &(item[itemCount]), 0, sizeof(listType##Item) );\
-        \
-        return;\
-      }\
-      \
+  Internally calls developer defined data release function, on the
+    data of each discarded duplicate:
+    void freeDataFunc( dataType* data ) {
+    ...
+    }
+
+  Return values:
+    NULL = allocate/etc failure, or rejected duplicate. Source data is
+      left untouched.
+    Non-NULL = New list.
+  */
+
+  /* Merge batch
+  DECLARE_STRING_KEYARRAY_MERGEBATCH( funcName, listType, dataType,
+      resolveDataFunc, freeDataFunc )
+  DECLARE_UINT_KEYARRAY_MERGEBATCH( funcName, listType, dataType,
+      resolveDataFunc, freeDataFunc )
+
+  Declares a function as funcName, to merge an unsorted array of items
+    into an existing list:
+    int funcName( listType* keyList, listType##Item* batchItem,
+        size_t batchCount )
+
+  Sorts a copy of the batch, grows the list once, then merges from the
+    back of the list. Each list item is moved at most once.
+
+  Internally calls developer defined data resolve function, for each
+    batch item whose key is already in the list, or repeated in the
+    batch, in batch order:
+    void resolveDataFunc( dataType* existing, dataType* incoming ) {
+    ...
+    }
+
+  Internally calls developer defined data release function, on the
+    incoming data after it is resolved:
+    void freeDataFunc( dataType* data ) {
+    ...
+    }
+
+  Return values:
+    0 = allocation/etc failure. The list and batch data are unchanged.
+    Non-zero = Successful
+  */
+
+  /* Structure of arrays layout
+  DECLARE_STRING_KEYARRAY_TYPES_SOA( typeName, dataType )
+  DECLARE_UINT_KEYARRAY_TYPES_SOA( typeName, dataType )
+
+  List type declaration, respectively:
+    typedef struct typeName {
+      size_t reservedCount;
+      size_t itemCount;
+      char** keys;
+      dataType* data;
+    } typeName;
+
+    typedef struct typeName {
+      size_t reservedCount;
+      size_t itemCount;
+      unsigned* keys;
+      dataType* data;
+    } typeName;
+
+  Also declares typeNameItem, the same as DECLARE_*_KEYARRAY_TYPES,
+    for use with bulk load and merge batch.
+
+  Keys are stored in a dense array, separate from data, so searches
+    only touch keys. Direct access through list->data[index]
+    or list->data[index].subfield
+
+  Every list function has a structure of arrays equivalent, with the
+    same parameters, prototype, and return values:
+    DECLARE_STRING_KEYARRAY_CREATE_SOA, DECLARE_UINT_KEYARRAY_CREATE_SOA
+    DECLARE_STRING_KEYARRAY_FREE_SOA, DECLARE_UINT_KEYARRAY_FREE_SOA
+    DECLARE_STRING_KEYARRAY_INSERT_SOA, DECLARE_UINT_KEYARRAY_INSERT_SOA
+    DECLARE_STRING_KEYARRAY_INSERT_GROWTH_SOA,
+      DECLARE_UINT_KEYARRAY_INSERT_GROWTH_SOA
+    DECLARE_STRING_KEYARRAY_RESERVE_SOA, DECLARE_UINT_KEYARRAY_RESERVE_SOA
+    DECLARE_STRING_KEYARRAY_REMOVE_SOA, DECLARE_UINT_KEYARRAY_REMOVE_SOA
+    DECLARE_STRING_KEYARRAY_RETRIEVE_SOA,
+      DECLARE_UINT_KEYARRAY_RETRIEVE_SOA
+    DECLARE_STRING_KEYARRAY_MODIFY_SOA, DECLARE_UINT_KEYARRAY_MODIFY_SOA
+    DECLARE_STRING_KEYARRAY_FINDINDEX_SOA,
+      DECLARE_UINT_KEYARRAY_FINDINDEX_SOA
+    DECLARE_STRING_KEYARRAY_FINDINDEX_SIZE_SOA,
+      DECLARE_UINT_KEYARRAY_FINDINDEX_SIZE_SOA
+    DECLARE_STRING_KEYARRAY_LOWERBOUND_SOA,
+      DECLARE_UINT_KEYARRAY_LOWERBOUND_SOA
+    DECLARE_STRING_KEYARRAY_UPPERBOUND_SOA,
+      DECLARE_UINT_KEYARRAY_UPPERBOUND_SOA
+    DECLARE_STRING_KEYARRAY_RANGE_SOA, DECLARE_UINT_KEYARRAY_RANGE_SOA
+    DECLARE_STRING_KEYARRAY_RELEASEUNUSED_SOA,
+      DECLARE_UINT_KEYARRAY_RELEASEUNUSED_SOA
+    DECLARE_STRING_KEYARRAY_COPY_SOA, DECLARE_UINT_KEYARRAY_COPY_SOA
+    DECLARE_STRING_KEYARRAY_BULKLOAD_SOA,
+      DECLARE_UINT_KEYARRAY_BULKLOAD_SOA
+    DECLARE_STRING_KEYARRAY_MERGEBATCH_SOA,
+      DECLARE_UINT_KEYARRAY_MERGEBATCH_SOA
+    DECLARE_STRING_KEYARRAY_UNION_SOA, DECLARE_UINT_KEYARRAY_UNION_SOA
+    DECLARE_STRING_KEYARRAY_INTERSECT_SOA,
+      DECLARE_UINT_KEYARRAY_INTERSECT_SOA
+    DECLARE_STRING_KEYARRAY_DIFFERENCE_SOA,
+      DECLARE_UINT_KEYARRAY_DIFFERENCE_SOA
+  */
+
+  /* Key prefix layout
+  DECLARE_STRING_KEYARRAY_TYPES_PREFIX( typeName, dataType )
+
+  Item type declaration:
+    typedef struct typeNameItem {
+      KeyArrayStringPrefix keyPrefix;
+      char* key;
+      dataType data;
+    } typeNameItem;
+
+  List type declaration is the same as DECLARE_STRING_KEYARRAY_TYPES,
+    without the bloom filter and lookup cache.
+
+  The first KEYARRAY_STRING_PREFIX_WORDS * 8 bytes of each key (default
+    8) are packed big-endian into keyPrefix, inline in the item. Most
+    search steps are decided by comparing prefixes, and only read the
+    key string when the prefixes tie.
+
+  Every string list function has a key prefix equivalent, with the
+    same parameters, prototype, and return values:
+    DECLARE_STRING_KEYARRAY_CREATE_PREFIX
+    DECLARE_STRING_KEYARRAY_FREE_PREFIX
+    DECLARE_STRING_KEYARRAY_INSERT_PREFIX
+    DECLARE_STRING_KEYARRAY_INSERT_GROWTH_PREFIX
+    DECLARE_STRING_KEYARRAY_RESERVE_PREFIX
+    DECLARE_STRING_KEYARRAY_REMOVE_PREFIX
+    DECLARE_STRING_KEYARRAY_RETRIEVE_PREFIX
+    DECLARE_STRING_KEYARRAY_MODIFY_PREFIX
+    DECLARE_STRING_KEYARRAY_FINDINDEX_PREFIX
+    DECLARE_STRING_KEYARRAY_FINDINDEX_SIZE_PREFIX
+    DECLARE_STRING_KEYARRAY_LOWERBOUND_PREFIX
+    DECLARE_STRING_KEYARRAY_UPPERBOUND_PREFIX
+    DECLARE_STRING_KEYARRAY_RANGE_PREFIX
+    DECLARE_STRING_KEYARRAY_RELEASEUNUSED_PREFIX
+    DECLARE_STRING_KEYARRAY_COPY_PREFIX
+    DECLARE_STRING_KEYARRAY_BULKLOAD_PREFIX
+    DECLARE_STRING_KEYARRAY_MERGEBATCH_PREFIX
+    DECLARE_STRING_KEYARRAY_UNION_PREFIX
+    DECLARE_STRING_KEYARRAY_INTERSECT_PREFIX
+    DECLARE_STRING_KEYARRAY_DIFFERENCE_PREFIX
+  */
+
+  /* Key arena
+  DECLARE_STRING_KEYARRAY_KEYARENA( funcName, listType )
+  DECLARE_STRING_KEYARRAY_KEYARENA_SOA( funcName, listType )
+  DECLARE_STRING_KEYARRAY_KEYARENA_PREFIX( funcName, listType )
+
+  Declares a function as funcName, to enable or disable the key arena
+    of a string key list:
+    int funcName( listType* keyList, int enable )
+
+  Keys are bump allocated from chunks of KEYARRAY_KEYARENA_CHUNK_SIZE
+    (default 65536) bytes, instead of one allocation per key. Free list
+    releases the arena a chunk at a time, and copy list copies it with
+    one memcpy per chunk. Remove compacts the arena once most of it is
+    free, and remove buffered space always compacts it, so key pointers
+    move.
+
+  Return values:
+    0 = allocation/etc failure.
+    Non-zero = Successful
+  */
+
+  /* Hash index
+  DECLARE_STRING_KEYARRAY_HASHINDEX( funcName, listType )
+  DECLARE_STRING_KEYARRAY_HASHINDEX_SOA( funcName, listType )
+  DECLARE_STRING_KEYARRAY_HASHINDEX_PREFIX( funcName, listType )
+
+  Declares a function as funcName, to enable or disable the hash index
+    of a string key list:
+    int funcName( listType* keyList, int enable )
+
+  The hash index maps key hashes to item indices, alongside the sorted
+    list. Once enabled, retrieve, modify, and find index use it
+    transparently. Insert, remove, and merge batch keep it up to date.
+
+  Return values:
+    0 = allocation/etc failure.
+    Non-zero = Successful
+  */
+
+  /* Lookup cache
+  DECLARE_STRING_KEYARRAY_LOOKUPCACHE( funcName, listType )
+  DECLARE_UINT_KEYARRAY_LOOKUPCACHE( funcName, listType )
+
+  Declares a function as funcName, to enable or disable the lookup
+    cache of a list:
+    int funcName( listType* keyList, int enable )
+
+  The cache holds the item indices of recently found keys, and searches
+    out from the last one found otherwise. Once enabled, retrieve,
+    modify, find index, get pointer, and update use it transparently.
+    Changes to the list clear it. Lookups write to the cache, so they
+    must not run concurrently.
+
+  Return values:
+    0 = allocation/etc failure.
+    Non-zero = Successful
+
+  DECLARE_STRING_KEYARRAY_CACHECOUNTS( funcName, listType )
+  DECLARE_UINT_KEYARRAY_CACHECOUNTS( funcName, listType )
+
+  Declares a function as funcName, to read the lookup cache counters:
+    int funcName( listType* keyList, size_t* hitCount,
+        size_t* missCount, int resetCounts )
+
+  Return values:
+    0 = the lookup cache is not enabled.
+    Non-zero = Successful
+  */
+
+  /* Bloom filter
+  DECLARE_STRING_KEYARRAY_BLOOMFILTER( funcName, listType )
+
+  Declares a function as funcName, to enable or disable the bloom
+    filter of a string key list:
+    int funcName( listType* keyList, int enable )
+
+  The filter turns away most missing keys before any search. Once
+    enabled, retrieve, modify, find index, get pointer, and update
+    consult it first. Insert, upsert, and merge batch add to it, and it
+    is rebuilt as the list grows. KEYARRAY_BLOOMFILTER_BITS sets the bits
+    per key, 12 by default.
+
+  Return values:
+    0 = allocation/etc failure.
+    Non-zero = Successful
+  */
+
+  /* Blocked layout
+  DECLARE_STRING_KEYARRAY_TYPES_BLOCKED( typeName, dataType )
+  DECLARE_UINT_KEYARRAY_TYPES_BLOCKED( typeName, dataType )
+
+  Block and list type declarations, with keyType char* or unsigned:
+    typedef struct typeNameBlock {
+      size_t itemCount;
+      typeNameItem item[KEYARRAY_BLOCK_SIZE];
+    } typeNameBlock;
+
+    typedef struct typeName {
+      size_t reservedBlocks;
+      size_t itemCount;
+      size_t blockCount;
+      typeNameBlock** block;
+      keyType* blockKey;
+    } typeName;
+
+  Items are kept in sorted blocks of up to KEYARRAY_BLOCK_SIZE (default
+    256) items, with the first key of each block in blockKey. Insert
+    and remove move items within one block, and split or join blocks
+    as they fill or empty, so lists of millions of items stay cheap to
+    change.
+
+  Every list function has a blocked equivalent, with the same
+    parameters, prototype, and return values:
+    DECLARE_STRING_KEYARRAY_CREATE_BLOCKED,
+      DECLARE_UINT_KEYARRAY_CREATE_BLOCKED
+    DECLARE_STRING_KEYARRAY_FREE_BLOCKED,
+      DECLARE_UINT_KEYARRAY_FREE_BLOCKED
+    DECLARE_STRING_KEYARRAY_INSERT_BLOCKED,
+      DECLARE_UINT_KEYARRAY_INSERT_BLOCKED
+    DECLARE_STRING_KEYARRAY_INSERT_GROWTH_BLOCKED,
+      DECLARE_UINT_KEYARRAY_INSERT_GROWTH_BLOCKED
+    DECLARE_STRING_KEYARRAY_RESERVE_BLOCKED,
+      DECLARE_UINT_KEYARRAY_RESERVE_BLOCKED
+    DECLARE_STRING_KEYARRAY_REMOVE_BLOCKED,
+      DECLARE_UINT_KEYARRAY_REMOVE_BLOCKED
+    DECLARE_STRING_KEYARRAY_RETRIEVE_BLOCKED,
+      DECLARE_UINT_KEYARRAY_RETRIEVE_BLOCKED
+    DECLARE_STRING_KEYARRAY_MODIFY_BLOCKED,
+      DECLARE_UINT_KEYARRAY_MODIFY_BLOCKED
+    DECLARE_STRING_KEYARRAY_FINDINDEX_BLOCKED,
+      DECLARE_UINT_KEYARRAY_FINDINDEX_BLOCKED
+    DECLARE_STRING_KEYARRAY_FINDINDEX_SIZE_BLOCKED,
+      DECLARE_UINT_KEYARRAY_FINDINDEX_SIZE_BLOCKED
+    DECLARE_STRING_KEYARRAY_LOWERBOUND_BLOCKED,
+      DECLARE_UINT_KEYARRAY_LOWERBOUND_BLOCKED
+    DECLARE_STRING_KEYARRAY_UPPERBOUND_BLOCKED,
+      DECLARE_UINT_KEYARRAY_UPPERBOUND_BLOCKED
+    DECLARE_STRING_KEYARRAY_RANGE_BLOCKED,
+      DECLARE_UINT_KEYARRAY_RANGE_BLOCKED
+    DECLARE_STRING_KEYARRAY_RELEASEUNUSED_BLOCKED,
+      DECLARE_UINT_KEYARRAY_RELEASEUNUSED_BLOCKED
+    DECLARE_STRING_KEYARRAY_COPY_BLOCKED,
+      DECLARE_UINT_KEYARRAY_COPY_BLOCKED
+    DECLARE_STRING_KEYARRAY_BULKLOAD_BLOCKED,
+      DECLARE_UINT_KEYARRAY_BULKLOAD_BLOCKED
+    DECLARE_STRING_KEYARRAY_MERGEBATCH_BLOCKED,
+      DECLARE_UINT_KEYARRAY_MERGEBATCH_BLOCKED
+
+  DECLARE_STRING_KEYARRAY_ITEMAT_BLOCKED( funcName, listType )
+  DECLARE_UINT_KEYARRAY_ITEMAT_BLOCKED( funcName, listType )
+
+  Declares a function as funcName, to find an item by list index:
+    listType##Item* funcName( listType* keyList, size_t index )
+
+  Return values:
+    NULL = index out of range
+    Otherwise, the item at index
+  */
+
+  /* Sharded layout, when KEYARRAY_THREADS is defined
+  DECLARE_STRING_KEYARRAY_TYPES_SHARDED( typeName, dataType )
+  DECLARE_UINT_KEYARRAY_TYPES_SHARDED( typeName, dataType )
+
+  List type declaration, with keyType char* or unsigned:
+    typedef struct typeName {
+      size_t shardCount;
+      typeNameShard* shard;
+      keyType* splitKey;
+    } typeName;
+
+  Keys are spread across shardCount independent sorted lists, each with
+    its own reader-writer lock, so threads working on different shards
+    do not wait for each other.
+
+  DECLARE_STRING_KEYARRAY_CREATE_SHARDED( funcName, listType )
+  DECLARE_UINT_KEYARRAY_CREATE_SHARDED( funcName, listType )
+
+  Declares list creation function as funcName, respectively:
+    listType* funcName( size_t shardCount, char** splitKey )
+    listType* funcName( size_t shardCount, unsigned* splitKey )
+
+  splitKey = NULL spreads keys by hash. Otherwise, it holds
+    shardCount - 1 increasing keys, and shard[index] holds the keys
+    from splitKey[index - 1] up to, but not including, splitKey[index].
+
+  Return values:
+    NULL = allocation/etc failure
+    Otherwise, the new list
+
+  Free, insert, remove, retrieve, and modify have sharded equivalents,
+    with the same parameters, prototype, and return values:
+    DECLARE_STRING_KEYARRAY_FREE_SHARDED,
+      DECLARE_UINT_KEYARRAY_FREE_SHARDED
+    DECLARE_STRING_KEYARRAY_INSERT_SHARDED,
+      DECLARE_UINT_KEYARRAY_INSERT_SHARDED
+    DECLARE_STRING_KEYARRAY_REMOVE_SHARDED,
+      DECLARE_UINT_KEYARRAY_REMOVE_SHARDED
+    DECLARE_STRING_KEYARRAY_RETRIEVE_SHARDED,
+      DECLARE_UINT_KEYARRAY_RETRIEVE_SHARDED
+    DECLARE_STRING_KEYARRAY_MODIFY_SHARDED,
+      DECLARE_UINT_KEYARRAY_MODIFY_SHARDED
+
+  DECLARE_STRING_KEYARRAY_ITERATEBEGIN_SHARDED( funcName, listType )
+  DECLARE_UINT_KEYARRAY_ITERATEBEGIN_SHARDED( funcName, listType )
+  DECLARE_STRING_KEYARRAY_ITERATENEXT_SHARDED( funcName, listType )
+  DECLARE_UINT_KEYARRAY_ITERATENEXT_SHARDED( funcName, listType )
+  DECLARE_STRING_KEYARRAY_ITERATEEND_SHARDED( funcName, listType )
+  DECLARE_UINT_KEYARRAY_ITERATEEND_SHARDED( funcName, listType )
+
+  Declares iterator functions as funcName, respectively:
+    int funcName( listType* keyList, listTypeIterator* iterator )
+    listTypeItem* funcName( listTypeIterator* iterator )
+    void funcName( listTypeIterator* iterator )
+
+  Visits every item of every shard, in key order.
+
+  Return values:
+    Iterate begin returns 0 on allocation/etc failure.
+    Iterate next returns NULL after the last item.
+  */
+
+  /* Snapshot layout, when KEYARRAY_THREADS is defined
+  DECLARE_STRING_KEYARRAY_TYPES_SNAPSHOT( typeName, dataType )
+  DECLARE_UINT_KEYARRAY_TYPES_SNAPSHOT( typeName, dataType )
+
+  Readers look keys up in an immutable version of the list, reached by
+    one atomic load, without locks. Writers edit a private copy, and
+    publish it as the next version. Old versions are released once no
+    reader can still be using them.
+
+  DECLARE_STRING_KEYARRAY_CREATE_SNAPSHOT( funcName, listType )
+  DECLARE_UINT_KEYARRAY_CREATE_SNAPSHOT( funcName, listType )
+  DECLARE_STRING_KEYARRAY_FREE_SNAPSHOT( funcName, listType,
+      freeDataFunc )
+  DECLARE_UINT_KEYARRAY_FREE_SNAPSHOT( funcName, listType,
+      freeDataFunc )
+
+  Declares list creation and free functions as funcName, respectively:
+    listType* funcName( size_t readerCount )
+    void funcName( listType** keyList )
+
+  Each reader thread uses its own readerIndex, from 0 to
+    readerCount - 1.
+
+  DECLARE_STRING_KEYARRAY_READBEGIN_SNAPSHOT( funcName, listType )
+  DECLARE_UINT_KEYARRAY_READBEGIN_SNAPSHOT( funcName, listType )
+  DECLARE_STRING_KEYARRAY_READEND_SNAPSHOT( funcName, listType )
+  DECLARE_UINT_KEYARRAY_READEND_SNAPSHOT( funcName, listType )
+
+  Declares reader functions as funcName, respectively:
+    listTypePart* funcName( listType* keyList, size_t readerIndex )
+    void funcName( listType* keyList, size_t readerIndex )
+
+  Read begin returns the current version, to be searched with the
+    retrieve and find index functions of listTypePart, until read end.
+
+  DECLARE_STRING_KEYARRAY_RETRIEVE_SNAPSHOT( funcName, listType,
+      dataType )
+  DECLARE_UINT_KEYARRAY_RETRIEVE_SNAPSHOT( funcName, listType,
+      dataType )
+
+  Declares one lookup function as funcName, respectively:
+    int funcName( listType* keyList, size_t readerIndex, char* key,
+        dataType* destData )
+    int funcName( listType* keyList, size_t readerIndex, unsigned key,
+        dataType* destData )
+
+  DECLARE_STRING_KEYARRAY_WRITEBEGIN_SNAPSHOT( funcName, listType,
+      dataType, copyDataFunc, freeDataFunc )
+  DECLARE_UINT_KEYARRAY_WRITEBEGIN_SNAPSHOT( funcName, listType,
+      dataType, copyDataFunc, freeDataFunc )
+  DECLARE_STRING_KEYARRAY_WRITECOMMIT_SNAPSHOT( funcName, listType,
+      freeDataFunc )
+  DECLARE_UINT_KEYARRAY_WRITECOMMIT_SNAPSHOT( funcName, listType,
+      freeDataFunc )
+  DECLARE_STRING_KEYARRAY_WRITEABORT_SNAPSHOT( funcName, listType,
+      freeDataFunc )
+  DECLARE_UINT_KEYARRAY_WRITEABORT_SNAPSHOT( funcName, listType,
+      freeDataFunc )
+
+  Declares writer functions as funcName, respectively:
+    listTypePart* funcName( listType* keyList )
+    int funcName( listType* keyList )
+    void funcName( listType* keyList )
+
+  Write begin returns a copy of the current version, to be changed
+    with the listTypePart functions. Write commit publishes it, and
+    write abort discards it.
+
+  Return values:
+    Write begin returns NULL on allocation/etc failure.
+    Write commit returns 0 if there is no write in progress.
+  */
+
+  /* Mapped files, when KEYARRAY_MAPPED is defined
+  DECLARE_STRING_KEYARRAY_TYPES_MAPPED( typeName, dataType )
+  DECLARE_UINT_KEYARRAY_TYPES_MAPPED( typeName, dataType )
+
+  Mapped list type declaration, for list type typeName:
+    typedef struct typeNameMapped {
+      const typeNameFileItem* item;
+      size_t itemCount;
+      const char* pool;
+      const void* mapping;
+      size_t mappingSize;
+    } typeNameMapped;
+
+  DECLARE_STRING_KEYARRAY_SAVE( funcName, listType, dataType )
+  DECLARE_UINT_KEYARRAY_SAVE( funcName, listType, dataType )
+
+  Declares list save function as funcName:
+    int funcName( listType* keyList, const char* fileName )
+
+  DECLARE_STRING_KEYARRAY_OPENMAPPED( funcName, listType, dataType )
+  DECLARE_UINT_KEYARRAY_OPENMAPPED( funcName, listType, dataType )
+  DECLARE_STRING_KEYARRAY_CLOSEMAPPED( funcName, listType )
+  DECLARE_UINT_KEYARRAY_CLOSEMAPPED( funcName, listType )
+
+  Declares mapped list open and close functions as funcName:
+    int funcName( listTypeMapped* mappedList, const char* fileName )
+    void funcName( listTypeMapped* mappedList )
+
+  Retrieve, find index, and range have mapped equivalents, with a
+    listTypeMapped* instead of listType*, and otherwise the same
+    parameters, prototype, and return values:
+    DECLARE_STRING_KEYARRAY_RETRIEVE_MAPPED,
+      DECLARE_UINT_KEYARRAY_RETRIEVE_MAPPED
+    DECLARE_STRING_KEYARRAY_FINDINDEX_MAPPED,
+      DECLARE_UINT_KEYARRAY_FINDINDEX_MAPPED
+    DECLARE_STRING_KEYARRAY_FINDINDEX_SIZE_MAPPED,
+      DECLARE_UINT_KEYARRAY_FINDINDEX_SIZE_MAPPED
+    DECLARE_STRING_KEYARRAY_RANGE_MAPPED,
+      DECLARE_UINT_KEYARRAY_RANGE_MAPPED
+
+  dataType must be trivially copyable, as data is saved byte for byte.
+
+  Return values:
+    0 = file, allocation/etc failure, or file does not match list type
+    Non-zero = Successful
+  */
+
+  /* Write-ahead log, when KEYARRAY_LOGGED is defined
+  DECLARE_STRING_KEYARRAY_LOGOPEN( funcName, listType, dataType )
+  DECLARE_UINT_KEYARRAY_LOGOPEN( funcName, listType, dataType )
+
+  Declares log open function as funcName:
+    KeyArrayLog* funcName( const char* fileName, int syncPolicy,
+        size_t groupCount )
+
+  syncPolicy is KEYARRAY_LOG_SYNC_NONE, or KEYARRAY_LOG_SYNC_COMMIT to
+    fsync on every group commit. Records are committed every groupCount
+    records, or only by KeyArrayLogCommit if groupCount is 0.
+
+  int KeyArrayLogCommit( KeyArrayLog* log )
+  int KeyArrayLogCheckpoint( KeyArrayLog* log )
+  int KeyArrayLogClose( KeyArrayLog** log )
+
+  Checkpoint empties the log, once the list has been saved.
+
+  DECLARE_STRING_KEYARRAY_INSERT_LOGGED( funcName, listType, dataType )
+  DECLARE_UINT_KEYARRAY_INSERT_LOGGED( funcName, listType, dataType )
+  DECLARE_STRING_KEYARRAY_REMOVE_LOGGED( funcName, listType,
+      freeDataFunc )
+  DECLARE_UINT_KEYARRAY_REMOVE_LOGGED( funcName, listType,
+      freeDataFunc )
+  DECLARE_STRING_KEYARRAY_MODIFY_LOGGED( funcName, listType, dataType )
+  DECLARE_UINT_KEYARRAY_MODIFY_LOGGED( funcName, listType, dataType )
+
+  Declares logged functions as funcName, respectively:
+    int funcName( listType* keyList, KeyArrayLog* log, char* key,
+        dataType* data )
+    int funcName( listType* keyList, KeyArrayLog* log, char* key )
+    int funcName( listType* keyList, KeyArrayLog* log, char* key,
+        dataType* data )
+  The unsigned equivalents take an unsigned key. log may be NULL.
+
+  DECLARE_STRING_KEYARRAY_REPLAY( funcName, listType, dataType,
+      freeDataFunc )
+  DECLARE_UINT_KEYARRAY_REPLAY( funcName, listType, dataType,
+      freeDataFunc )
+
+  Declares log replay function as funcName:
+    int funcName( listType* keyList, const char* fileName )
+
+  Applies the log to keyList, loaded from the last snapshot, and cuts
+    off a record torn by a crash. dataType must be trivially copyable.
+
+  Return values:
+    0 = file, allocation/etc failure, or log does not match list type
+    Non-zero = Successful
+  */
+
+  /* Operation statistics, when KEYARRAY_STATS is defined
+  DECLARE_STRING_KEYARRAY_STATS( funcName, listType )
+  DECLARE_UINT_KEYARRAY_STATS( funcName, listType )
+
+  Declares statistics accessor function as funcName:
+    int funcName( listType* keyList, KeyArrayStats* destStats,
+        int resetStats )
+
+  Copies the statistics of keyList to destStats, then clears them if
+    resetStats is non-zero. Insert, remove, retrieve, modify, and find
+    index each record a count, key comparisons, bytes moved, reallocs,
+    and a latency histogram, in destStats->operation[KEYARRAY_STATS_*].
+    Get pointer is recorded as retrieve, update as modify, and upsert
+    as insert. Other operations, and the structure of arrays, prefix,
+    and blocked layouts, are not timed. Timing uses clock_gettime, so
+    -std=c99 also needs _POSIX_C_SOURCE defined as 199309L or later.
+
+  uint64_t KeyArrayStatsPercentile(
+      const KeyArrayOperationStats* operationStats, unsigned percent )
+
+  Returns an upper bound on the latency of percent of the operations.
+
+  Return values:
+    0 = KEYARRAY_STATS is not defined (destStats is cleared), or NULL
+      parameter
+    Non-zero = Successful
+  */
+
+  /* Custom keys
+  DECLARE_CUSTOM_KEYARRAY_TYPES( typeName, keyType, dataType,
+      compareKeyFunc )
+  DECLARE_CUSTOM_KEYARRAY_TYPES_HOOKS( typeName, keyType, dataType,
+      compareKeyFunc, copyKeyFunc, freeKeyFunc )
+
+  Declares a list of keyType keys, ordered by compareKeyFunc, which is
+    expanded inline in the search loops:
+    int compareKeyFunc( keyType leftKey, keyType rightKey )
+
+  Keys are copied by value, or with the optional key hooks:
+    int copyKeyFunc( keyType* keyCopy, keyType key )
+    void freeKeyFunc( keyType key )
+
+  DECLARE_CUSTOM_KEYARRAY_* declares CREATE, FREE, INSERT,
+    INSERT_GROWTH, RESERVE, REMOVE, RETRIEVE, MODIFY, FINDINDEX,
+    FINDINDEX_SIZE, GETPTR, UPSERT, UPSERT_GROWTH, UPDATE, FINDINDEXMANY,
+    RETRIEVEMANY, LOWERBOUND, UPPERBOUND, RANGE, RELEASEUNUSED, COPY,
+    BULKLOAD, MERGEBATCH, UNION, INTERSECT, DIFFERENCE, and STATS, with
+    the same parameters as the unsigned key macros. Key parameters are
+    typeNameKey.
+  */
+
+/*
+ * =======================
+ *  Shared implementation
+ * =======================
+ */
+
+  /* Operation statistics, when KEYARRAY_STATS is defined. Each list
+     counts its own operations; searches, moves, and reallocs are
+     counted per thread, then added to the list by the operation that
+     made them. */
+  #define KEYARRAY_STATS_INSERT 0
+  #define KEYARRAY_STATS_REMOVE 1
+  #define KEYARRAY_STATS_RETRIEVE 2
+  #define KEYARRAY_STATS_MODIFY 3
+  #define KEYARRAY_STATS_FINDINDEX 4
+  #define KEYARRAY_STATS_OPERATIONS 5
+
+  /* Latency histogram buckets. Bucket 0 counts 0 ns, and bucket n
+     counts latencies from 2^(n-1) up to 2^n - 1 ns. */
+  #define KEYARRAY_STATS_BUCKETS 48
+
+  typedef struct KeyArrayOperationStats {
+    uint64_t count;
+    uint64_t compareCount;
+    uint64_t moveBytes;
+    uint64_t reallocCount;
+    uint64_t totalNs;
+    uint64_t maxNs;
+    uint64_t histogram[KEYARRAY_STATS_BUCKETS];
+  } KeyArrayOperationStats;
+
+  typedef struct KeyArrayStats {
+    KeyArrayOperationStats operation[KEYARRAY_STATS_OPERATIONS];
+    size_t peakReservedCount;
+  } KeyArrayStats;
+
+  /* Returns an upper bound on the latency, in ns, below which percent
+     of the operations completed */
+  static inline uint64_t KeyArrayStatsPercentile(
+      const KeyArrayOperationStats* operationStats, unsigned percent ) {
+    uint64_t rank;
+    uint64_t seenCount = 0;
+    uint64_t bucketNs;
+    size_t bucket;
+
+    if( !(operationStats && operationStats->count) ) {
+      return 0;
+    }
+
+    if( percent > 100 ) {
+      percent = 100;
+    }
+
+    rank = ((operationStats->count * percent) + 99) / 100;
+    if( rank == 0 ) {
+      rank = 1;
+    }
+
+    for( bucket = 0; bucket < KEYARRAY_STATS_BUCKETS; bucket++ ) {
+      seenCount += operationStats->histogram[bucket];
+      if( seenCount >= rank ) {
+        bucketNs = bucket ? ((((uint64_t)1) << bucket) - 1) : 0;
+        return (bucketNs < operationStats->maxNs) ?
+          bucketNs : operationStats->maxNs;
+      }
+    }
+
+    return operationStats->maxNs;
+  }
+
+  #if defined(KEYARRAY_STATS)
+
+  #ifndef KEYARRAY_STATS_THREAD
+    #if defined(__GNUC__) || defined(__clang__)
+      #define KEYARRAY_STATS_THREAD __thread
+    #elif defined(_MSC_VER)
+      #define KEYARRAY_STATS_THREAD __declspec(thread)
+    #else
+      #define KEYARRAY_STATS_THREAD
+    #endif
+  #endif
+
+  /* Monotonic time in ns. Defaults to POSIX clock_gettime, which
+     -std=c99 only declares with _POSIX_C_SOURCE 199309L or later. */
+  #ifndef KEYARRAY_STATS_CLOCK
+    #include <time.h>
+
+    #define KEYARRAY_STATS_CLOCK() KeyArrayStatsClock()
+
+    static inline uint64_t KeyArrayStatsClock( void ) {
+      struct timespec now;
+
+      clock_gettime( CLOCK_MONOTONIC, &now );
+      return ((uint64_t)now.tv_sec * 1000000000U) + (uint64_t)now.tv_nsec;
+    }
+  #endif
+
+  typedef struct KeyArrayStatsCounters {
+    uint64_t compareCount;
+    uint64_t moveBytes;
+    uint64_t reallocCount;
+  } KeyArrayStatsCounters;
+
+  static KEYARRAY_STATS_THREAD KeyArrayStatsCounters KeyArrayStatsCounter;
+
+  #define KEYARRAY_STATS_FIELD KeyArrayStats stats;
+
+  #define KEYARRAY_STATS_COMPARE( count )\
+    (KeyArrayStatsCounter.compareCount += (count))
+
+  #define KEYARRAY_STATS_MOVE( bytes )\
+    (KeyArrayStatsCounter.moveBytes += (bytes))
+
+  #define KEYARRAY_STATS_REALLOC()\
+    (KeyArrayStatsCounter.reallocCount++)
+
+  static inline uint64_t KeyArrayStatsBegin(
+      KeyArrayStatsCounters* startCounter ) {
+    (*startCounter) = KeyArrayStatsCounter;
+    return KEYARRAY_STATS_CLOCK();
+  }
+
+  /* With KEYARRAY_THREADS, a sharded part under a read lock, or a
+     published snapshot part, is timed by several readers at once, so
+     statistics are updated with relaxed atomics */
+  #if defined(KEYARRAY_THREADS)
+    #define KEYARRAY_STATS_ADD( dest, value )\
+      ((void)__atomic_fetch_add(&(dest), (value), __ATOMIC_RELAXED))
+    #define KEYARRAY_STATS_LOAD( source )\
+      __atomic_load_n(&(source), __ATOMIC_RELAXED)
+    #define KEYARRAY_STATS_STORE( dest, value )\
+      __atomic_store_n(&(dest), (value), __ATOMIC_RELAXED)
+    #define KEYARRAY_STATS_RAISE( dest, value )\
+      do {\
+        __typeof__(dest) raiseValue = (value);\
+        __typeof__(dest) lastValue = KEYARRAY_STATS_LOAD(dest);\
+        while( (raiseValue > lastValue) &&\
+            !__atomic_compare_exchange_n(&(dest), &lastValue, raiseValue,\
+            1, __ATOMIC_RELAXED, __ATOMIC_RELAXED) ) {\
+        }\
+      } while( 0 )
+  #else
+    #define KEYARRAY_STATS_ADD( dest, value ) ((void)((dest) += (value)))
+    #define KEYARRAY_STATS_LOAD( source ) (source)
+    #define KEYARRAY_STATS_STORE( dest, value ) ((void)((dest) = (value)))
+    #define KEYARRAY_STATS_RAISE( dest, value )\
+      do {\
+        if( (value) > (dest) ) {\
+          (dest) = (value);\
+        }\
+      } while( 0 )
+  #endif
+
+  static inline void KeyArrayStatsEnd( KeyArrayStats* stats,
+      int operation, size_t reservedCount,
+      const KeyArrayStatsCounters* startCounter, uint64_t startNs ) {
+    KeyArrayOperationStats* operationStats = &(stats->operation[operation]);
+    uint64_t elapsedNs = KEYARRAY_STATS_CLOCK() - startNs;
+    size_t bucket = 0;
+
+    while( (bucket < (KEYARRAY_STATS_BUCKETS - 1)) && (elapsedNs >> bucket) ) {
+      bucket++;
+    }
+
+    KEYARRAY_STATS_ADD( operationStats->count, 1 );
+    KEYARRAY_STATS_ADD( operationStats->compareCount,
+        KeyArrayStatsCounter.compareCount - startCounter->compareCount );
+    KEYARRAY_STATS_ADD( operationStats->moveBytes,
+        KeyArrayStatsCounter.moveBytes - startCounter->moveBytes );
+    KEYARRAY_STATS_ADD( operationStats->reallocCount,
+        KeyArrayStatsCounter.reallocCount - startCounter->reallocCount );
+    KEYARRAY_STATS_ADD( operationStats->totalNs, elapsedNs );
+    KEYARRAY_STATS_RAISE( operationStats->maxNs, elapsedNs );
+    KEYARRAY_STATS_ADD( operationStats->histogram[bucket], 1 );
+
+    KEYARRAY_STATS_RAISE( stats->peakReservedCount, reservedCount );
+  }
+
+  /* Returns a statistics word, clearing it if resetStats is non-zero */
+  static inline uint64_t KeyArrayStatsTake( uint64_t* word,
+      int resetStats ) {
+    uint64_t value;
+
+    if( resetStats == 0 ) {
+      return KEYARRAY_STATS_LOAD(*word);
+    }
+
+  #if defined(KEYARRAY_THREADS)
+    value = __atomic_exchange_n(word, 0, __ATOMIC_RELAXED);
+  #else
+    value = (*word);
+    (*word) = 0;
+  #endif
+
+    return value;
+  }
+
+  /* Copies stats to destStats, a word at a time, clearing each word
+     copied if resetStats is non-zero */
+  static inline void KeyArrayStatsCopy( KeyArrayStats* destStats,
+      KeyArrayStats* stats, int resetStats ) {
+    uint64_t* destWord = (uint64_t*)&(destStats->operation[0]);
+    uint64_t* word = (uint64_t*)&(stats->operation[0]);
+    size_t wordIndex;
+
+    for( wordIndex = 0; wordIndex < ((KEYARRAY_STATS_OPERATIONS *
+        sizeof(KeyArrayOperationStats)) / sizeof(uint64_t)); wordIndex++ ) {
+      destWord[wordIndex] = KeyArrayStatsTake(&(word[wordIndex]),
+          resetStats);
+    }
+
+    destStats->peakReservedCount =
+      KEYARRAY_STATS_LOAD(stats->peakReservedCount);
+  }
+
+  /* Declares funcName, timing a call to funcNameUntimed, which
+     declareUntimed declares */
+  #define KEYARRAY_DECLARE_TIMED( funcName, listType, operation,\
+      resultType, parameters, arguments, declareUntimed )\
+  resultType funcName parameters;\
+  static declareUntimed\
+  \
+  resultType funcName parameters {\
+    KeyArrayStatsCounters startCounter;\
+    uint64_t startNs = KeyArrayStatsBegin(&startCounter);\
+    resultType result = funcName##Untimed arguments;\
+    \
+    if( keyList ) {\
+      KeyArrayStatsEnd( &(keyList->stats), operation,\
+          keyList->reservedCount, &startCounter, startNs );\
+    }\
+    \
+    return result;\
+  }
+
+  #define KEYARRAY_DECLARE_TIMED_VOID( funcName, listType, operation,\
+      parameters, arguments, declareUntimed )\
+  void funcName parameters;\
+  static declareUntimed\
+  \
+  void funcName parameters {\
+    KeyArrayStatsCounters startCounter;\
+    uint64_t startNs = KeyArrayStatsBegin(&startCounter);\
+    \
+    funcName##Untimed arguments;\
+    \
+    if( keyList ) {\
+      KeyArrayStatsEnd( &(keyList->stats), operation,\
+          keyList->reservedCount, &startCounter, startNs );\
+    }\
+  }
+
+  #define KEYARRAY_DECLARE_STATS( funcName, listType )\
+  int funcName( listType* keyList, KeyArrayStats* destStats,\
+      int resetStats ) {\
+    if( !(keyList && destStats) ) {\
+      return 0;\
+    }\
+    \
+    KeyArrayStatsCopy( destStats, &(keyList->stats), resetStats );\
+    if( resetStats ) {\
+      KEYARRAY_STATS_STORE( keyList->stats.peakReservedCount,\
+          keyList->reservedCount );\
+    }\
+    \
+    return 1;\
+  }
+
+  #else
+
+  /* Statistics compile away entirely */
+  #define KEYARRAY_STATS_FIELD
+  #define KEYARRAY_STATS_COMPARE( count ) ((void)0)
+  #define KEYARRAY_STATS_MOVE( bytes ) ((void)0)
+  #define KEYARRAY_STATS_REALLOC() ((void)0)
+
+  #define KEYARRAY_DECLARE_STATS( funcName, listType )\
+  int funcName( listType* keyList, KeyArrayStats* destStats,\
+      int resetStats ) {\
+    (void)keyList;\
+    (void)resetStats;\
+    \
+    if( destStats ) {\
+      memset( destStats, 0, sizeof(KeyArrayStats) );\
+    }\
+    \
+    return 0;\
+  }
+
+  #endif
+
+  #ifndef KEYARRAY_GROWTH_NUMERATOR
+    #define KEYARRAY_GROWTH_NUMERATOR 3
+  #endif
+
+  #ifndef KEYARRAY_GROWTH_DENOMINATOR
+    #define KEYARRAY_GROWTH_DENOMINATOR 2
+  #endif
+
+  #ifndef KEYARRAY_GROWTH_MINIMUM
+    #define KEYARRAY_GROWTH_MINIMUM 8
+  #endif
+
+  /* Returns reservedCount scaled by numerator/denominator, grown by at
+     least KEYARRAY_GROWTH_MINIMUM, and never less than requiredCount */
+  static inline size_t KeyArrayGrowGeometric( size_t reservedCount,
+      size_t requiredCount, size_t numerator, size_t denominator ) {
+    size_t newCount;
+
+    if( (denominator == 0) || (numerator <= denominator) ) {
+      newCount = reservedCount;
+    } else if( reservedCount > (((size_t)-1) / numerator) ) {
+      newCount = (size_t)-1;
+    } else {
+      newCount = (reservedCount * numerator) / denominator;
+    }
+
+    if( (newCount - reservedCount) < KEYARRAY_GROWTH_MINIMUM ) {
+      newCount = reservedCount + KEYARRAY_GROWTH_MINIMUM;
+      if( newCount < reservedCount ) {
+        newCount = (size_t)-1;
+      }
+    }
+
+    if( newCount < requiredCount ) {
+      newCount = requiredCount;
+    }
+
+    return newCount;
+  }
+
+  #define KEYARRAY_GROW_DEFAULT( reservedCount, requiredCount )\
+    KeyArrayGrowGeometric( (reservedCount), (requiredCount),\
+        KEYARRAY_GROWTH_NUMERATOR, KEYARRAY_GROWTH_DENOMINATOR )
+
+  #define DECLARE_KEYARRAY_GEOMETRIC_GROWTH( funcName,\
+      numerator, denominator )\
+  size_t funcName( size_t reservedCount, size_t requiredCount ) {\
+    return KeyArrayGrowGeometric(reservedCount, requiredCount,\
+        (numerator), (denominator));\
+  }
+
+  #define DECLARE_KEYARRAY_LINEAR_GROWTH( funcName, growCount )\
+  size_t funcName( size_t reservedCount, size_t requiredCount ) {\
+    size_t newCount;\
+    \
+    newCount = reservedCount + (growCount);\
+    if( newCount < reservedCount ) {\
+      newCount = (size_t)-1;\
+    }\
+    \
+    if( newCount < requiredCount ) {\
+      newCount = requiredCount;\
+    }\
+    \
+    return newCount;\
+  }
+
+  /* Declares funcName with the int result find index has always had,
+     around a find index that returns size_t. (-1) is returned for a key
+     that is not found, or found past INT_MAX; lists that large need
+     the _SIZE declaration. */
+  #define KEYARRAY_DECLARE_FINDINDEX_INT( funcName, listType, listStruct,\
+      keyType, declareFindIndexSize )\
+  static declareFindIndexSize( funcName##Size, listType )\
+  \
+  int funcName( listStruct* keyList, keyType key ) {\
+    size_t foundIndex = funcName##Size(keyList, key);\
+    \
+    if( foundIndex > ((size_t)INT_MAX) ) {\
+      return (-1);\
+    }\
+    \
+    return (int)foundIndex;\
+  }
+
+  /* Duplicate key policies */
+  #define KEYARRAY_DUPLICATES_REJECT 0
+  #define KEYARRAY_DUPLICATES_FIRST 1
+  #define KEYARRAY_DUPLICATES_LAST 2
+  #define KEYARRAY_DUPLICATES_MERGE 3
+
+  /* Key comparisons, returning <0, 0, or >0 */
+  #define KEYARRAY_COMPARE_STRING( leftKey, rightKey )\
+    strcmp((leftKey), (rightKey))
+
+  #define KEYARRAY_COMPARE_UINT( leftKey, rightKey )\
+    (((leftKey) > (rightKey)) - ((leftKey) < (rightKey)))
+
+  #ifndef KEYARRAY_SORT_RUN
+    #define KEYARRAY_SORT_RUN 16
+  #endif
+
+  /* Declares a stable merge sort of count items by key, as sortName.
+     scratch must have room for count items. */
+  #define KEYARRAY_DECLARE_SORT( sortName, itemType, compareKeys )\
+  static void sortName( itemType* item, itemType* scratch, size_t count ) {\
+    itemType* source = item;\
+    itemType* dest = scratch;\
+    itemType* swap;\
+    itemType temp;\
+    size_t width;\
+    size_t leftIndex;\
+    size_t middleIndex;\
+    size_t rightIndex;\
+    size_t index;\
+    size_t mergeIndex;\
+    size_t destIndex;\
+    \
+    /* Insertion sort short runs in place */\
+    for( leftIndex = 0; leftIndex < count;\
+        leftIndex += KEYARRAY_SORT_RUN ) {\
+      rightIndex = leftIndex + KEYARRAY_SORT_RUN;\
+      if( rightIndex > count ) {\
+        rightIndex = count;\
+      }\
+      \
+      for( index = leftIndex + 1; index < rightIndex; index++ ) {\
+        temp = item[index];\
+        for( mergeIndex = index; (mergeIndex > leftIndex) &&\
+            (compareKeys(item[mergeIndex - 1].key, temp.key) > 0);\
+            mergeIndex-- ) {\
+          item[mergeIndex] = item[mergeIndex - 1];\
+        }\
+        item[mergeIndex] = temp;\
+      }\
+    }\
+    \
+    /* Merge runs, alternating between item and scratch */\
+    for( width = KEYARRAY_SORT_RUN; width < count; width *= 2 ) {\
+      for( leftIndex = 0; leftIndex < count; leftIndex += 2 * width ) {\
+        middleIndex = leftIndex + width;\
+        if( middleIndex > count ) {\
+          middleIndex = count;\
+        }\
+        rightIndex = middleIndex + width;\
+        if( rightIndex > count ) {\
+          rightIndex = count;\
+        }\
+        \
+        /* Runs already in order are copied as-is */\
+        if( (middleIndex == rightIndex) ||\
+            (compareKeys(source[middleIndex - 1].key,\
+            source[middleIndex].key) <= 0) ) {\
+          memcpy( &(dest[leftIndex]), &(source[leftIndex]),\
+              (rightIndex - leftIndex) * sizeof(itemType) );\
+          continue;\
+        }\
+        \
+        index = leftIndex;\
+        mergeIndex = middleIndex;\
+        destIndex = leftIndex;\
+        while( (index < middleIndex) && (mergeIndex < rightIndex) ) {\
+          if( compareKeys(source[mergeIndex].key, source[index].key) < 0 ) {\
+            dest[destIndex++] = source[mergeIndex++];\
+          } else {\
+            dest[destIndex++] = source[index++];\
+          }\
+        }\
+        while( index < middleIndex ) {\
+          dest[destIndex++] = source[index++];\
+        }\
+        while( mergeIndex < rightIndex ) {\
+          dest[destIndex++] = source[mergeIndex++];\
+        }\
+      }\
+      \
+      swap = source;\
+      source = dest;\
+      dest = swap;\
+    }\
+    \
+    if( source != item ) {\
+      memcpy( item, source, count * sizeof(itemType) );\
+    }\
+  }
+
+  /* Inline key prefixes for string keys */
+  #ifndef KEYARRAY_STRING_PREFIX_WORDS
+    #define KEYARRAY_STRING_PREFIX_WORDS 1
+  #endif
+
+  #define KEYARRAY_STRING_PREFIX_SIZE (KEYARRAY_STRING_PREFIX_WORDS * 8)
+
+  typedef struct KeyArrayStringPrefix {
+    unsigned long long word[KEYARRAY_STRING_PREFIX_WORDS];
+  } KeyArrayStringPrefix;
+
+  /* Packs the first bytes of key big-endian, zero padded, so that words
+     compare in the same order as strcmp */
+  static inline void KeyArraySetStringPrefix(
+      KeyArrayStringPrefix* keyPrefix, const char* key ) {
+    unsigned long long word;
+    size_t wordIndex;
+    size_t byteIndex;
+
+    for( wordIndex = 0; wordIndex < KEYARRAY_STRING_PREFIX_WORDS;
+        wordIndex++ ) {
+      word = 0;
+      for( byteIndex = 0; byteIndex < 8; byteIndex++ ) {
+        word <<= 8;
+        if( *key ) {
+          word |= (unsigned char)(*key);
+          key++;
+        }
+      }
+      keyPrefix->word[wordIndex] = word;
+    }
+  }
+
+  /* Compares two keys by prefix first. The key strings are only read
+     when the prefixes tie, and both keys run past the prefix. */
+  static inline int KeyArrayCompareStringPrefix(
+      const KeyArrayStringPrefix* leftPrefix, const char* leftKey,
+      const KeyArrayStringPrefix* rightPrefix, const char* rightKey ) {
+    size_t wordIndex;
+
+    for( wordIndex = 0; wordIndex < KEYARRAY_STRING_PREFIX_WORDS;
+        wordIndex++ ) {
+      if( leftPrefix->word[wordIndex] != rightPrefix->word[wordIndex] ) {
+        return (leftPrefix->word[wordIndex] > rightPrefix->word[wordIndex]) ?
+          1 : -1;
+      }
+    }
+
+    /* A zero last byte means both keys ended inside the prefix */
+    if( (leftPrefix->word[KEYARRAY_STRING_PREFIX_WORDS - 1] & 0xFF) == 0 ) {
+      return 0;
+    }
+
+    return strcmp(leftKey + KEYARRAY_STRING_PREFIX_SIZE,
+        rightKey + KEYARRAY_STRING_PREFIX_SIZE);
+  }
+
+  #define KEYARRAY_COMPARE_PREFIXED_ITEMS( leftItem, rightItem )\
+    KeyArrayCompareStringPrefix(&((leftItem).keyPrefix), (leftItem).key,\
+        &((rightItem).keyPrefix), (rightItem).key)
+
+  /* Key arena for string keys */
+  #ifndef KEYARRAY_KEYARENA_CHUNK_SIZE
+    #define KEYARRAY_KEYARENA_CHUNK_SIZE 65536
+  #endif
+
+  #ifndef KEYARRAY_KEYARENA_COMPACT_SHIFT
+    #define KEYARRAY_KEYARENA_COMPACT_SHIFT 1
+  #endif
+
+  typedef struct KeyArrayKeyChunk {
+    char* bytes;
+    size_t size;
+    size_t used;
+  } KeyArrayKeyChunk;
+
+  typedef struct KeyArrayKeyArena {
+    KeyArrayKeyChunk* chunk;
+    size_t chunkCount;
+    size_t reservedChunks;
+    size_t usedBytes;
+    size_t freedBytes;
+  } KeyArrayKeyArena;
+
+  #define KEYARRAY_STRING_KEYAT( keyBase, keyStride, index )\
+    (*(char**)((char*)(keyBase) + ((index) * (keyStride))))
+
+  static inline void KeyArrayArenaRelease( KeyArrayKeyArena** keyArena ) {
+    size_t chunkIndex;
+
+    if( keyArena && (*keyArena) ) {
+      for( chunkIndex = 0; chunkIndex < (*keyArena)->chunkCount;
+          chunkIndex++ ) {
+        free( (*keyArena)->chunk[chunkIndex].bytes );
+      }
+      if( (*keyArena)->chunk ) {
+        free( (*keyArena)->chunk );
+      }
+      free( (*keyArena) );
+      (*keyArena) = NULL;
+    }
+  }
+
+  static inline KeyArrayKeyChunk* KeyArrayArenaAddChunk(
+      KeyArrayKeyArena* keyArena, size_t chunkSize ) {
+    KeyArrayKeyChunk* chunk;
+    size_t reservedChunks;
+
+    if( keyArena->chunkCount == keyArena->reservedChunks ) {
+      reservedChunks = KEYARRAY_GROW_DEFAULT(keyArena->reservedChunks,
+          keyArena->chunkCount + 1);
+      if( reservedChunks > (((size_t)-1) / sizeof(KeyArrayKeyChunk)) ) {
+        return NULL;
+      }
+
+      chunk = (KeyArrayKeyChunk*)realloc(keyArena->chunk,
+          reservedChunks * sizeof(KeyArrayKeyChunk));
+      if( chunk == NULL ) {
+        return NULL;
+      }
+      keyArena->chunk = chunk;
+      keyArena->reservedChunks = reservedChunks;
+    }
+
+    chunk = &(keyArena->chunk[keyArena->chunkCount]);
+    chunk->bytes = (char*)malloc(chunkSize);
+    if( chunk->bytes == NULL ) {
+      return NULL;
+    }
+    chunk->size = chunkSize;
+    chunk->used = 0;
+    keyArena->chunkCount++;
+
+    return chunk;
+  }
+
+  /* Bump allocates from the newest chunk, starting a new chunk when
+     the key does not fit */
+  static inline char* KeyArrayArenaAllocate( KeyArrayKeyArena* keyArena,
+      size_t byteCount ) {
+    KeyArrayKeyChunk* chunk = NULL;
+    char* bytes;
+
+    if( keyArena->chunkCount ) {
+      chunk = &(keyArena->chunk[keyArena->chunkCount - 1]);
+      if( (chunk->size - chunk->used) < byteCount ) {
+        chunk = NULL;
+      }
+    }
+
+    if( chunk == NULL ) {
+      chunk = KeyArrayArenaAddChunk(keyArena,
+          (byteCount > KEYARRAY_KEYARENA_CHUNK_SIZE) ?
+          byteCount : KEYARRAY_KEYARENA_CHUNK_SIZE);
+      if( chunk == NULL ) {
+        return NULL;
+      }
+    }
+
+    bytes = chunk->bytes + chunk->used;
+    chunk->used += byteCount;
+    keyArena->usedBytes += byteCount;
+
+    return bytes;
+  }
+
+  /* Copies a key into the arena, or into its own allocation when the
+     list has no arena */
+  static inline char* KeyArrayDuplicateKey( KeyArrayKeyArena* keyArena,
+      const char* key, size_t keyLen ) {
+    char* keyCopy;
+
+    if( keyArena ) {
+      keyCopy = KeyArrayArenaAllocate(keyArena, keyLen + 1);
+    } else {
+      keyCopy = (char*)malloc(keyLen + 1);
+    }
+
+    if( keyCopy ) {
+      memcpy( keyCopy, key, keyLen + 1 );
+    }
+
+    return keyCopy;
+  }
+
+  /* Arena keys are only counted as free, until the arena is compacted */
+  static inline void KeyArrayReleaseKey( KeyArrayKeyArena* keyArena,
+      char* key ) {
+    if( key ) {
+      if( keyArena ) {
+        keyArena->freedBytes += strlen(key) + 1;
+      } else {
+        free( key );
+      }
+    }
+  }
+
+  static inline int KeyArrayArenaNeedsCompact(
+      const KeyArrayKeyArena* keyArena ) {
+    return keyArena && (keyArena->usedBytes >= KEYARRAY_KEYARENA_CHUNK_SIZE) &&
+      (keyArena->freedBytes >
+      (keyArena->usedBytes >> KEYARRAY_KEYARENA_COMPACT_SHIFT));
+  }
+
+  /* Copies the live keys, in list order, into one new chunk, then
+     releases the old chunks. On failure, the arena is unchanged. */
+  static inline int KeyArrayArenaCompact( KeyArrayKeyArena* keyArena,
+      void* keyBase, size_t keyStride, size_t count ) {
+    KeyArrayKeyChunk newChunk;
+    size_t liveBytes = 0;
+    size_t keyLen;
+    size_t index;
+
+    if( keyArena->chunkCount == 0 ) {
+      return 1;
+    }
+
+    for( index = 0; index < count; index++ ) {
+      liveBytes += strlen(KEYARRAY_STRING_KEYAT(keyBase, keyStride, index)) + 1;
+    }
+
+    newChunk.bytes = NULL;
+    newChunk.size = liveBytes;
+    newChunk.used = 0;
+    if( liveBytes ) {
+      newChunk.bytes = (char*)malloc(liveBytes);
+      if( newChunk.bytes == NULL ) {
+        return 0;
+      }
+    }
+
+    for( index = 0; index < count; index++ ) {
+      keyLen = strlen(KEYARRAY_STRING_KEYAT(keyBase, keyStride, index)) + 1;
+      memcpy( newChunk.bytes + newChunk.used,
+          KEYARRAY_STRING_KEYAT(keyBase, keyStride, index), keyLen );
+      KEYARRAY_STRING_KEYAT(keyBase, keyStride, index) =
+        newChunk.bytes + newChunk.used;
+      newChunk.used += keyLen;
+    }
+
+    for( index = 0; index < keyArena->chunkCount; index++ ) {
+      free( keyArena->chunk[index].bytes );
+    }
+    keyArena->chunkCount = 0;
+    if( newChunk.bytes ) {
+      keyArena->chunk[0] = newChunk;
+      keyArena->chunkCount = 1;
+    }
+
+    keyArena->usedBytes = liveBytes;
+    keyArena->freedBytes = 0;
+
+    return 1;
+  }
+
+  /* Moves keys that were allocated one at a time into the arena, with
+     one allocation for all of them */
+  static inline int KeyArrayArenaAdoptKeys( KeyArrayKeyArena* keyArena,
+      void* keyBase, size_t keyStride, size_t count ) {
+    size_t totalBytes = 0;
+    size_t keyLen;
+    size_t index;
+    char* bytes;
+
+    for( index = 0; index < count; index++ ) {
+      totalBytes +=
+        strlen(KEYARRAY_STRING_KEYAT(keyBase, keyStride, index)) + 1;
+    }
+
+    if( totalBytes == 0 ) {
+      return 1;
+    }
+
+    bytes = KeyArrayArenaAllocate(keyArena, totalBytes);
+    if( bytes == NULL ) {
+      return 0;
+    }
+
+    for( index = 0; index < count; index++ ) {
+      keyLen = strlen(KEYARRAY_STRING_KEYAT(keyBase, keyStride, index)) + 1;
+      memcpy( bytes, KEYARRAY_STRING_KEYAT(keyBase, keyStride, index), keyLen );
+      free( KEYARRAY_STRING_KEYAT(keyBase, keyStride, index) );
+      KEYARRAY_STRING_KEYAT(keyBase, keyStride, index) = bytes;
+      bytes += keyLen;
+    }
+
+    return 1;
+  }
+
+  /* Moves arena keys back into allocations of their own. On failure,
+     the keys are unchanged. */
+  static inline int KeyArrayArenaDisownKeys( void* keyBase,
+      size_t keyStride, size_t count ) {
+    char** keyCopy;
+    size_t keyLen;
+    size_t index;
+
+    if( count == 0 ) {
+      return 1;
+    }
+
+    if( count > (((size_t)-1) / sizeof(char*)) ) {
+      return 0;
+    }
+
+    keyCopy = (char**)malloc(count * sizeof(char*));
+    if( keyCopy == NULL ) {
+      return 0;
+    }
+
+    for( index = 0; index < count; index++ ) {
+      keyLen = strlen(KEYARRAY_STRING_KEYAT(keyBase, keyStride, index));
+      keyCopy[index] = KeyArrayDuplicateKey(NULL,
+          KEYARRAY_STRING_KEYAT(keyBase, keyStride, index), keyLen);
+      if( keyCopy[index] == NULL ) {
+        while( index ) {
+          index--;
+          free( keyCopy[index] );
+        }
+        free( keyCopy );
+        return 0;
+      }
+    }
+
+    for( index = 0; index < count; index++ ) {
+      KEYARRAY_STRING_KEYAT(keyBase, keyStride, index) = keyCopy[index];
+    }
+    free( keyCopy );
+
+    return 1;
+  }
+
+  /* Copies the arena with one memcpy per chunk. The keys at keyBase
+     point into sourceArena, and are moved to the same offsets in the
+     copy. Returns NULL on failure, with the keys unchanged. */
+  static inline KeyArrayKeyArena* KeyArrayArenaCopy(
+      const KeyArrayKeyArena* sourceArena, void* keyBase, size_t keyStride,
+      size_t count ) {
+    KeyArrayKeyArena* newArena;
+    size_t* chunkOrder = NULL;
+    size_t chunkIndex;
+    size_t orderIndex;
+    size_t leftIndex;
+    size_t rightIndex;
+    size_t middleIndex;
+    size_t index;
+    uintptr_t keyAddress;
+    const KeyArrayKeyChunk* chunk;
+
+    newArena = (KeyArrayKeyArena*)calloc(1, sizeof(KeyArrayKeyArena));
+    if( newArena == NULL ) {
+      return NULL;
+    }
+
+    if( (sourceArena->chunkCount == 0) || (count == 0) ) {
+      return newArena;
+    }
+
+    newArena->chunk = (KeyArrayKeyChunk*)malloc(sourceArena->chunkCount *
+        sizeof(KeyArrayKeyChunk));
+    chunkOrder = (size_t*)malloc(sourceArena->chunkCount * sizeof(size_t));
+    if( (newArena->chunk == NULL) || (chunkOrder == NULL) ) {
+      goto ReturnError;
+    }
+    newArena->reservedChunks = sourceArena->chunkCount;
+
+    for( chunkIndex = 0; chunkIndex < sourceArena->chunkCount;
+        chunkIndex++ ) {
+      chunk = &(sourceArena->chunk[chunkIndex]);
+      newArena->chunk[chunkIndex].bytes = (char*)malloc(chunk->size);
+      if( newArena->chunk[chunkIndex].bytes == NULL ) {
+        goto ReturnError;
+      }
+      memcpy( newArena->chunk[chunkIndex].bytes, chunk->bytes,
+          chunk->used );
+      newArena->chunk[chunkIndex].size = chunk->size;
+      newArena->chunk[chunkIndex].used = chunk->used;
+      newArena->chunkCount++;
+
+      /* Keep the source chunks sorted by address, to look keys up */
+      orderIndex = chunkIndex;
+      while( (orderIndex > 0) &&
+          ((uintptr_t)sourceArena->chunk[chunkOrder[orderIndex - 1]].bytes >
+          (uintptr_t)chunk->bytes) ) {
+        chunkOrder[orderIndex] = chunkOrder[orderIndex - 1];
+        orderIndex--;
+      }
+      chunkOrder[orderIndex] = chunkIndex;
+    }
+    newArena->usedBytes = sourceArena->usedBytes;
+    newArena->freedBytes = sourceArena->freedBytes;
+
+    for( index = 0; index < count; index++ ) {
+      keyAddress = (uintptr_t)KEYARRAY_STRING_KEYAT(keyBase, keyStride, index);
+
+      /* Find the last chunk that starts at, or before, the key */
+      leftIndex = 0;
+      rightIndex = sourceArena->chunkCount;
+      while( (rightIndex - leftIndex) > 1 ) {
+        middleIndex = leftIndex + ((rightIndex - leftIndex) / 2);
+        if( (uintptr_t)sourceArena->chunk[chunkOrder[middleIndex]].bytes <=
+            keyAddress ) {
+          leftIndex = middleIndex;
+        } else {
+          rightIndex = middleIndex;
+        }
+      }
+
+      chunkIndex = chunkOrder[leftIndex];
+      KEYARRAY_STRING_KEYAT(keyBase, keyStride, index) =
+        newArena->chunk[chunkIndex].bytes + (keyAddress -
+        (uintptr_t)sourceArena->chunk[chunkIndex].bytes);
+    }
+
+    free( chunkOrder );
+
+    return newArena;
+
+  ReturnError:
+    if( chunkOrder ) {
+      free( chunkOrder );
+    }
+    KeyArrayArenaRelease( &newArena );
+
+    return NULL;
+  }
+
+  /* Key handling, by key kind */
+  static inline int KeyArrayStringValidKey( const char* key ) {
+    return key && (*key);
+  }
+
+  static inline int KeyArrayUintValidKey( unsigned key ) {
+    (void)key;
+    return 1;
+  }
+
+  /* Bounds may be empty strings, which sort before every key */
+  static inline int KeyArrayStringValidBound( const char* key ) {
+    return key != NULL;
+  }
+
+  static inline int KeyArrayUintValidBound( unsigned key ) {
+    (void)key;
+    return 1;
+  }
+
+  static inline int KeyArrayStringCopyKey( char** keyCopy,
+      const char* key ) {
+    (*keyCopy) = KeyArrayDuplicateKey(NULL, key, strlen(key));
+    return (*keyCopy) != NULL;
+  }
+
+  /* Unsigned keys of any width are copied by value */
+  #define KeyArrayUintCopyKey( keyCopy, key )\
+    (((*(keyCopy)) = (key)), 1)
+
+  static inline void KeyArrayStringFreeKey( char* key ) {
+    free( key );
+  }
+
+  static inline void KeyArrayUintFreeKey( unsigned key ) {
+    (void)key;
+  }
+
+  /* Hash index for string keys */
+  #ifndef KEYARRAY_HASHINDEX_MINIMUM
+    #define KEYARRAY_HASHINDEX_MINIMUM 16
+  #endif
+
+  #ifndef KEYARRAY_HASHINDEX_EDIT_LIMIT
+    #define KEYARRAY_HASHINDEX_EDIT_LIMIT 64
+  #endif
+
+  /* itemIndex is the item index + 1, so that 0 marks an empty slot.
+     editCount is the number of edits already applied to itemIndex. */
+  typedef struct KeyArrayStringHashSlot {
+    size_t itemIndex;
+    unsigned keyHash;
+    unsigned editCount;
+  } KeyArrayStringHashSlot;
+
+  /* An insert moves the items at and past position up by one. A remove
+     moves the items past position down by one. */
+  typedef struct KeyArrayStringHashEdit {
+    size_t position;
+    int inserted;
+  } KeyArrayStringHashEdit;
+
+  typedef struct KeyArrayStringHashIndex {
+    KeyArrayStringHashSlot* slot;
+    size_t slotCount;
+    size_t usedCount;
+    unsigned editCount;
+    KeyArrayStringHashEdit edit[KEYARRAY_HASHINDEX_EDIT_LIMIT];
+  } KeyArrayStringHashIndex;
+
+  /* 64 bit FNV-1a */
+  static inline uint64_t KeyArrayStringHash64( const char* key ) {
+    uint64_t keyHash = 14695981039346656037ULL;
+
+    while( *key ) {
+      keyHash ^= (unsigned char)(*key);
+      keyHash *= 1099511628211ULL;
+      key++;
+    }
+
+    return keyHash;
+  }
+
+  /* FNV-1a, with the high half folded into the low half */
+  static inline unsigned KeyArrayStringHash( const char* key ) {
+    uint64_t keyHash = KeyArrayStringHash64(key);
+
+    return (unsigned)(keyHash ^ (keyHash >> 32));
+  }
+
+  static inline void KeyArrayStringFreeHashIndex(
+      KeyArrayStringHashIndex** hashIndex ) {
+    if( hashIndex && (*hashIndex) ) {
+      if( (*hashIndex)->slot ) {
+        free( (*hashIndex)->slot );
+      }
+      free( (*hashIndex) );
+      (*hashIndex) = NULL;
+    }
+  }
+
+  /* Returns the current item index of a used slot, applying the edits
+     made since the slot was last updated */
+  static inline size_t KeyArrayStringHashItemIndex(
+      const KeyArrayStringHashIndex* hashIndex,
+      const KeyArrayStringHashSlot* slot ) {
+    size_t itemIndex = slot->itemIndex - 1;
+    unsigned editIndex;
+
+    for( editIndex = slot->editCount; editIndex < hashIndex->editCount;
+        editIndex++ ) {
+      if( hashIndex->edit[editIndex].inserted ) {
+        itemIndex += (itemIndex >= hashIndex->edit[editIndex].position);
+      } else {
+        itemIndex -= (itemIndex > hashIndex->edit[editIndex].position);
+      }
+    }
+
+    return itemIndex;
+  }
+
+  /* Applies every pending edit to every slot, emptying the edit log.
+     The edits are first combined into a step function of the original
+     item index, so most slots take a binary search over the steps,
+     instead of a walk through the log. */
+  static inline void KeyArrayStringHashApplyEdits(
+      KeyArrayStringHashIndex* hashIndex ) {
+    size_t stepBase[KEYARRAY_HASHINDEX_EDIT_LIMIT];
+    long long stepShift[KEYARRAY_HASHINDEX_EDIT_LIMIT];
+    unsigned stepCount = 0;
+    unsigned stepIndex;
+    unsigned editIndex;
+    unsigned leftIndex;
+    unsigned rightIndex;
+    long long shift;
+    long long itemIndex;
+    size_t segmentBase;
+    size_t slotIndex;
+    KeyArrayStringHashSlot* slot;
+
+    for( editIndex = 0; editIndex < hashIndex->editCount; editIndex++ ) {
+      /* Find the first original index that the edit moves. Within a
+         step, the current index is the original index + shift. */
+      itemIndex = (long long)hashIndex->edit[editIndex].position +
+        (hashIndex->edit[editIndex].inserted ? 0 : 1);
+      segmentBase = 0;
+      shift = 0;
+      for( stepIndex = 0; stepIndex < stepCount; stepIndex++ ) {
+        if( (itemIndex - shift) > (long long)segmentBase ) {
+          segmentBase = (size_t)(itemIndex - shift);
+        }
+        if( segmentBase < stepBase[stepIndex] ) {
+          break;
+        }
+        segmentBase = stepBase[stepIndex];
+        shift = stepShift[stepIndex];
+      }
+      if( (itemIndex - shift) > (long long)segmentBase ) {
+        segmentBase = (size_t)(itemIndex - shift);
+      }
+
+      /* Add a step there, and shift every later step */
+      memmove( &(stepBase[stepIndex + 1]), &(stepBase[stepIndex]),
+          (stepCount - stepIndex) * sizeof(size_t) );
+      memmove( &(stepShift[stepIndex + 1]), &(stepShift[stepIndex]),
+          (stepCount - stepIndex) * sizeof(long long) );
+      stepBase[stepIndex] = segmentBase;
+      stepShift[stepIndex] = shift;
+      stepCount++;
+      for( ; stepIndex < stepCount; stepIndex++ ) {
+        stepShift[stepIndex] += hashIndex->edit[editIndex].inserted ? 1 : -1;
+      }
+    }
+
+    for( slotIndex = 0; slotIndex < hashIndex->slotCount; slotIndex++ ) {
+      slot = &(hashIndex->slot[slotIndex]);
+      if( slot->itemIndex == 0 ) {
+        continue;
+      }
+
+      /* Slots added after the first edit walk the log */
+      if( slot->editCount ) {
+        slot->itemIndex = KeyArrayStringHashItemIndex(hashIndex, slot) + 1;
+        slot->editCount = 0;
+        continue;
+      }
+
+      leftIndex = 0;
+      rightIndex = stepCount;
+      while( leftIndex < rightIndex ) {
+        stepIndex = leftIndex + ((rightIndex - leftIndex) / 2);
+        if( stepBase[stepIndex] <= (slot->itemIndex - 1) ) {
+          leftIndex = stepIndex + 1;
+        } else {
+          rightIndex = stepIndex;
+        }
+      }
+      if( leftIndex ) {
+        slot->itemIndex = (size_t)((long long)slot->itemIndex +
+            stepShift[leftIndex - 1]);
+      }
+    }
+
+    hashIndex->editCount = 0;
+  }
+
+  /* Logs an edit, so that item indices need not be updated one slot at
+     a time. The log is applied to every slot once it fills. */
+  static inline void KeyArrayStringHashAddEdit(
+      KeyArrayStringHashIndex* hashIndex, size_t position, int inserted ) {
+    if( hashIndex->editCount == KEYARRAY_HASHINDEX_EDIT_LIMIT ) {
+      KeyArrayStringHashApplyEdits( hashIndex );
+    }
+
+    hashIndex->edit[hashIndex->editCount].position = position;
+    hashIndex->edit[hashIndex->editCount].inserted = inserted;
+    hashIndex->editCount++;
+  }
+
+  /* Linear probing from the home slot, to the first empty slot */
+  static inline void KeyArrayStringHashAdd(
+      KeyArrayStringHashIndex* hashIndex, unsigned keyHash,
+      size_t itemIndex, unsigned editCount ) {
+    size_t slotMask = hashIndex->slotCount - 1;
+    size_t slotIndex = keyHash & slotMask;
+
+    while( hashIndex->slot[slotIndex].itemIndex ) {
+      slotIndex = (slotIndex + 1) & slotMask;
+    }
+
+    hashIndex->slot[slotIndex].itemIndex = itemIndex + 1;
+    hashIndex->slot[slotIndex].keyHash = keyHash;
+    hashIndex->slot[slotIndex].editCount = editCount;
+    hashIndex->usedCount++;
+  }
+
+  /* Grows the slots, if necessary, so that count keys fill at most half
+     of them. Slots are rehashed from the stored hashes, without reading
+     keys. On failure, the index is unchanged. */
+  static inline int KeyArrayStringHashReserve(
+      KeyArrayStringHashIndex* hashIndex, size_t count ) {
+    KeyArrayStringHashSlot* oldSlot;
+    size_t oldCount;
+    size_t slotCount;
+    size_t slotIndex;
+
+    slotCount = hashIndex->slotCount;
+    if( slotCount < KEYARRAY_HASHINDEX_MINIMUM ) {
+      slotCount = KEYARRAY_HASHINDEX_MINIMUM;
+    }
+    while( (slotCount / 2) < count ) {
+      if( (slotCount > 0x80000000UL) || (slotCount >
+          ((((size_t)-1) / sizeof(KeyArrayStringHashSlot)) / 2)) ) {
+        return 0;
+      }
+      slotCount *= 2;
+    }
+
+    if( slotCount == hashIndex->slotCount ) {
+      return 1;
+    }
+
+    oldSlot = hashIndex->slot;
+    oldCount = hashIndex->slotCount;
+
+    hashIndex->slot = (KeyArrayStringHashSlot*)calloc(slotCount,
+        sizeof(KeyArrayStringHashSlot));
+    if( hashIndex->slot == NULL ) {
+      hashIndex->slot = oldSlot;
+      return 0;
+    }
+    hashIndex->slotCount = slotCount;
+    hashIndex->usedCount = 0;
+
+    for( slotIndex = 0; slotIndex < oldCount; slotIndex++ ) {
+      if( oldSlot[slotIndex].itemIndex ) {
+        KeyArrayStringHashAdd( hashIndex, oldSlot[slotIndex].keyHash,
+            oldSlot[slotIndex].itemIndex - 1,
+            oldSlot[slotIndex].editCount );
+      }
+    }
+
+    if( oldSlot ) {
+      free( oldSlot );
+    }
+
+    return 1;
+  }
+
+  /* Rehashes count keys into slots already reserved for them */
+  static inline void KeyArrayStringHashRefill(
+      KeyArrayStringHashIndex* hashIndex, const void* keyBase,
+      size_t keyStride, size_t count ) {
+    size_t index;
+
+    memset( hashIndex->slot, 0,
+        hashIndex->slotCount * sizeof(KeyArrayStringHashSlot) );
+    hashIndex->usedCount = 0;
+    hashIndex->editCount = 0;
+
+    for( index = 0; index < count; index++ ) {
+      KeyArrayStringHashAdd( hashIndex,
+          KeyArrayStringHash(KEYARRAY_STRING_KEYAT(keyBase, keyStride,
+          index)), index, 0 );
+    }
+  }
+
+  /* Returns the item index of key, or (size_t)-1 if not found. The
+     stored hash is compared first, so strcmp is almost only called on
+     the matching key. */
+  static inline size_t KeyArrayStringHashFind(
+      const KeyArrayStringHashIndex* hashIndex, const void* keyBase,
+      size_t keyStride, const char* key ) {
+    const KeyArrayStringHashSlot* slot;
+    unsigned keyHash = KeyArrayStringHash(key);
+    size_t slotMask = hashIndex->slotCount - 1;
+    size_t slotIndex = keyHash & slotMask;
+    size_t itemIndex;
+
+    for( ;; ) {
+      slot = &(hashIndex->slot[slotIndex]);
+      if( slot->itemIndex == 0 ) {
+        return (size_t)-1;
+      }
+
+      if( slot->keyHash == keyHash ) {
+        itemIndex = KeyArrayStringHashItemIndex(hashIndex, slot);
+        KEYARRAY_STATS_COMPARE( 1 );
+        if( strcmp(KEYARRAY_STRING_KEYAT(keyBase, keyStride, itemIndex),
+            key) == 0 ) {
+          return itemIndex;
+        }
+      }
+
+      slotIndex = (slotIndex + 1) & slotMask;
+    }
+  }
+
+  /* Adds key at insertIndex, after it was inserted into a list of count
+     items. Slots must have been reserved for count + 1 keys. */
+  static inline void KeyArrayStringHashInsert(
+      KeyArrayStringHashIndex* hashIndex, const char* key,
+      size_t insertIndex, size_t count ) {
+    /* Appending moves no items */
+    if( insertIndex < count ) {
+      KeyArrayStringHashAddEdit( hashIndex, insertIndex, 1 );
+    }
+
+    KeyArrayStringHashAdd( hashIndex, KeyArrayStringHash(key),
+        insertIndex, hashIndex->editCount );
+  }
+
+  /* Removes key at removeIndex, from a list of count items. Later slots
+     of the probe run are shifted back, so lookups never need
+     tombstones. */
+  static inline void KeyArrayStringHashRemove(
+      KeyArrayStringHashIndex* hashIndex, const char* key,
+      size_t removeIndex, size_t count ) {
+    size_t slotMask = hashIndex->slotCount - 1;
+    size_t slotIndex = KeyArrayStringHash(key) & slotMask;
+    size_t emptyIndex;
+    size_t homeIndex;
+
+    for( ;; ) {
+      if( hashIndex->slot[slotIndex].itemIndex == 0 ) {
+        return;
+      }
+      if( KeyArrayStringHashItemIndex(hashIndex,
+          &(hashIndex->slot[slotIndex])) == removeIndex ) {
+        break;
+      }
+      slotIndex = (slotIndex + 1) & slotMask;
+    }
+
+    emptyIndex = slotIndex;
+    for( ;; ) {
+      slotIndex = (slotIndex + 1) & slotMask;
+      if( hashIndex->slot[slotIndex].itemIndex == 0 ) {
+        break;
+      }
+
+      /* Move back, unless the home slot lies after the empty slot */
+      homeIndex = hashIndex->slot[slotIndex].keyHash & slotMask;
+      if( ((slotIndex - homeIndex) & slotMask) >=
+          ((slotIndex - emptyIndex) & slotMask) ) {
+        hashIndex->slot[emptyIndex] = hashIndex->slot[slotIndex];
+        emptyIndex = slotIndex;
+      }
+    }
+    hashIndex->slot[emptyIndex].itemIndex = 0;
+    hashIndex->usedCount--;
+
+    /* Removing the last item moves no items */
+    if( (removeIndex + 1) < count ) {
+      KeyArrayStringHashAddEdit( hashIndex, removeIndex, 0 );
+    }
+  }
+
+  /* Blocked bloom filter over string keys, so most missing keys are
+     turned away without a search. A key sets one bit in each of the
+     eight words of one 32 byte block, so a test reads a single cache
+     line. Removed keys keep their bits until the filter is rebuilt, so
+     a missing key may pass the test, but a present key never fails
+     it. */
+  #ifndef KEYARRAY_BLOOMFILTER_BITS
+    #define KEYARRAY_BLOOMFILTER_BITS 12
+  #endif
+
+  #define KEYARRAY_BLOOMFILTER_MINKEYS 64
+
+  typedef struct KeyArrayBloomFilter {
+    uint32_t* block;
+    size_t blockCount;
+    size_t keyCount;
+    size_t keyLimit;
+  } KeyArrayBloomFilter;
+
+  static inline void KeyArrayFreeBloomFilter(
+      KeyArrayBloomFilter** bloomFilter ) {
+    if( bloomFilter && (*bloomFilter) ) {
+      if( (*bloomFilter)->block ) {
+        free( (*bloomFilter)->block );
+      }
+      free( (*bloomFilter) );
+      (*bloomFilter) = NULL;
+    }
+  }
+
+  /* Picks one bit per block word, with the low half of keyHash. The
+     high half picks the block. */
+  static inline void KeyArrayBloomMask( uint32_t keyHash, uint32_t* mask ) {
+    mask[0] = ((uint32_t)1) << ((keyHash * 0x47b6137bU) >> 27);
+    mask[1] = ((uint32_t)1) << ((keyHash * 0x44974d91U) >> 27);
+    mask[2] = ((uint32_t)1) << ((keyHash * 0x8824ad5bU) >> 27);
+    mask[3] = ((uint32_t)1) << ((keyHash * 0xa2b7289dU) >> 27);
+    mask[4] = ((uint32_t)1) << ((keyHash * 0x705495c7U) >> 27);
+    mask[5] = ((uint32_t)1) << ((keyHash * 0x2df1424bU) >> 27);
+    mask[6] = ((uint32_t)1) << ((keyHash * 0x9efc4947U) >> 27);
+    mask[7] = ((uint32_t)1) << ((keyHash * 0x5c6bfb31U) >> 27);
+  }
+
+  /* FNV-1a leaves the high bits of keys that differ only near the end
+     close together, which would crowd them into a few blocks. A
+     finalizer spreads every input bit across the whole hash. */
+  static inline uint64_t KeyArrayBloomMix( uint64_t keyHash ) {
+    keyHash ^= keyHash >> 33;
+    keyHash *= 0xff51afd7ed558ccdULL;
+    keyHash ^= keyHash >> 33;
+    keyHash *= 0xc4ceb9fe1a85ec53ULL;
+    keyHash ^= keyHash >> 33;
+    return keyHash;
+  }
+
+  static inline uint32_t* KeyArrayBloomBlock(
+      const KeyArrayBloomFilter* bloomFilter, uint64_t keyHash ) {
+    return &(bloomFilter->block[(size_t)(((keyHash >> 32) *
+        (uint64_t)bloomFilter->blockCount) >> 32) * 8]);
+  }
+
+  static inline void KeyArrayBloomAdd( KeyArrayBloomFilter* bloomFilter,
+      uint64_t keyHash ) {
+    uint32_t* block;
+    uint32_t mask[8];
+    unsigned wordIndex;
+
+    keyHash = KeyArrayBloomMix(keyHash);
+    block = KeyArrayBloomBlock(bloomFilter, keyHash);
+    KeyArrayBloomMask( (uint32_t)keyHash, mask );
+    for( wordIndex = 0; wordIndex < 8; wordIndex++ ) {
+      block[wordIndex] |= mask[wordIndex];
+    }
+
+    bloomFilter->keyCount++;
+  }
+
+  /* Returns 0 if the key of keyHash was never added */
+  static inline int KeyArrayBloomTest(
+      const KeyArrayBloomFilter* bloomFilter, uint64_t keyHash ) {
+    const uint32_t* block;
+    uint32_t mask[8];
+    uint32_t missingBits = 0;
+    unsigned wordIndex;
+
+    keyHash = KeyArrayBloomMix(keyHash);
+    block = KeyArrayBloomBlock(bloomFilter, keyHash);
+    KeyArrayBloomMask( (uint32_t)keyHash, mask );
+    for( wordIndex = 0; wordIndex < 8; wordIndex++ ) {
+      missingBits |= mask[wordIndex] & ~block[wordIndex];
+    }
+
+    return (missingBits == 0);
+  }
+
+  /* Clears the filter, sizes it for twice count keys, and adds count
+     keys. If a resized filter cannot be allocated, the keys are added
+     to the old one, which only raises the false positive rate. Returns
+     0 only if there is no old one. */
+  static inline int KeyArrayStringBloomRefill(
+      KeyArrayBloomFilter* bloomFilter, const void* keyBase,
+      size_t keyStride, size_t count ) {
+    size_t keyLimit = count * 2;
+    size_t blockCount;
+    uint32_t* block;
+    size_t index;
+
+    if( keyLimit < KEYARRAY_BLOOMFILTER_MINKEYS ) {
+      keyLimit = KEYARRAY_BLOOMFILTER_MINKEYS;
+    }
+
+    /* Each block holds 256 bits */
+    blockCount = ((keyLimit * KEYARRAY_BLOOMFILTER_BITS) + 255) / 256;
+    if( blockCount != bloomFilter->blockCount ) {
+      block = (uint32_t*)malloc(blockCount * 8 * sizeof(uint32_t));
+      if( block ) {
+        if( bloomFilter->block ) {
+          free( bloomFilter->block );
+        }
+        bloomFilter->block = block;
+        bloomFilter->blockCount = blockCount;
+      } else if( bloomFilter->block == NULL ) {
+        return 0;
+      }
+    }
+
+    memset( bloomFilter->block, 0,
+        bloomFilter->blockCount * 8 * sizeof(uint32_t) );
+    bloomFilter->keyCount = 0;
+    bloomFilter->keyLimit = keyLimit;
+
+    for( index = 0; index < count; index++ ) {
+      KeyArrayBloomAdd( bloomFilter,
+          KeyArrayStringHash64(KEYARRAY_STRING_KEYAT(keyBase, keyStride,
+          index)) );
+    }
+
+    return 1;
+  }
+
+  /* Adds key, after it was inserted into a list of count items. Once
+     the filter holds its limit of keys, it is rebuilt from the list,
+     which also drops the bits of removed keys. */
+  static inline void KeyArrayStringBloomInsert(
+      KeyArrayBloomFilter* bloomFilter, const char* key,
+      const void* keyBase, size_t keyStride, size_t count ) {
+    if( bloomFilter->keyCount >= bloomFilter->keyLimit ) {
+      KeyArrayStringBloomRefill( bloomFilter, keyBase, keyStride, count );
+    } else {
+      KeyArrayBloomAdd( bloomFilter, KeyArrayStringHash64(key) );
+    }
+  }
+
+  /* Vectorized lower bound for unsigned keys */
+  #if !defined(KEYARRAY_NO_SIMD)
+    #if defined(__SSE2__) || defined(_M_X64) ||\
+        (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+      #include <emmintrin.h>
+      #define KEYARRAY_SIMD_SSE2
+    #endif
+    #if (defined(__GNUC__) || defined(__clang__)) &&\
+        (defined(__x86_64__) || defined(__i386__)) &&\
+        !defined(KEYARRAY_NO_AVX2)
+      #include <immintrin.h>
+      #define KEYARRAY_SIMD_AVX2
+      #define KEYARRAY_HAS_AVX2() __builtin_cpu_supports("avx2")
+    #endif
+  #endif
+
+  /* Binary search stops narrowing once the window is this small. Dense
+     keys are scanned with vectors, keys interleaved with item data are
+     scanned one at a time, so each has its own threshold. */
+  #ifndef KEYARRAY_UINT_LINEAR_THRESHOLD
+    #if defined(KEYARRAY_SIMD_AVX2)
+      #define KEYARRAY_UINT_LINEAR_THRESHOLD 16
+    #elif defined(KEYARRAY_SIMD_SSE2)
+      #define KEYARRAY_UINT_LINEAR_THRESHOLD 8
+    #else
+      #define KEYARRAY_UINT_LINEAR_THRESHOLD 4
+    #endif
+  #endif
+
+  #ifndef KEYARRAY_UINT_STRIDED_THRESHOLD
+    #define KEYARRAY_UINT_STRIDED_THRESHOLD 4
+  #endif
+
+  #define KEYARRAY_UINT_KEYAT( keyBase, keyStride, index )\
+    (*(const unsigned*)((const char*)(keyBase) + ((index) * (keyStride))))
+
+  /* Number of set bits in a 4 bit movemask result */
+  #define KEYARRAY_POPCOUNT4( mask )\
+    ((size_t)((0x4332322132212110ULL >> ((mask) * 4)) & 0xF))
+
+  static inline size_t KeyArrayUintCountLessScalar( const void* keyBase,
+      size_t keyStride, size_t count, unsigned key ) {
+    size_t lessCount = 0;
+    size_t index;
+
+    for( index = 0; index < count; index++ ) {
+      lessCount += (KEYARRAY_UINT_KEYAT(keyBase, keyStride, index) < key);
+    }
+
+    return lessCount;
+  }
+
+  /* SSE2 and AVX2 only have signed compares, so both sides have their
+     sign bit flipped to compare as unsigned */
+  #if defined(KEYARRAY_SIMD_SSE2)
+  static inline size_t KeyArrayUintCountLessSSE2( const unsigned* keys,
+      size_t count, unsigned key ) {
+    const __m128i signBit = _mm_set1_epi32((int)0x80000000u);
+    const __m128i findKey = _mm_xor_si128(_mm_set1_epi32((int)key), signBit);
+    __m128i lessMask;
+    int moveMask;
+    size_t lessCount = 0;
+    size_t index;
+
+    if( count < 4 ) {
+      for( index = 0; index < count; index++ ) {
+        lessCount += (keys[index] < key);
+      }
+      return lessCount;
+    }
+
+    for( index = 0; (index + 4) <= count; index += 4 ) {
+      lessMask = _mm_cmpgt_epi32(findKey, _mm_xor_si128(signBit,
+          _mm_loadu_si128((const __m128i*)(keys + index))));
+      lessCount += KEYARRAY_POPCOUNT4(
+          _mm_movemask_ps(_mm_castsi128_ps(lessMask)));
+    }
+
+    /* The tail overlaps the last full vector, so drop the lanes that
+       were already counted */
+    if( index < count ) {
+      lessMask = _mm_cmpgt_epi32(findKey, _mm_xor_si128(signBit,
+          _mm_loadu_si128((const __m128i*)(keys + count - 4))));
+      moveMask = _mm_movemask_ps(_mm_castsi128_ps(lessMask));
+      lessCount += KEYARRAY_POPCOUNT4(moveMask >> (4 - (count - index)));
+    }
+
+    return lessCount;
+  }
+  #endif
+
+  #if defined(KEYARRAY_SIMD_AVX2)
+  __attribute__((target("avx2,popcnt")))
+  static inline size_t KeyArrayUintCountLessAVX2( const unsigned* keys,
+      size_t count, unsigned key ) {
+    const __m256i signBit = _mm256_set1_epi32((int)0x80000000u);
+    const __m256i findKey = _mm256_xor_si256(_mm256_set1_epi32((int)key),
+        signBit);
+    __m256i lessMask;
+    unsigned moveMask;
+    size_t lessCount = 0;
+    size_t index;
+
+    if( count < 8 ) {
+      for( index = 0; index < count; index++ ) {
+        lessCount += (keys[index] < key);
+      }
+      return lessCount;
+    }
+
+    for( index = 0; (index + 8) <= count; index += 8 ) {
+      lessMask = _mm256_cmpgt_epi32(findKey, _mm256_xor_si256(signBit,
+          _mm256_loadu_si256((const __m256i*)(keys + index))));
+      lessCount += __builtin_popcount(
+          (unsigned)_mm256_movemask_ps(_mm256_castsi256_ps(lessMask)));
+    }
+
+    /* The tail overlaps the last full vector, so drop the lanes that
+       were already counted */
+    if( index < count ) {
+      lessMask = _mm256_cmpgt_epi32(findKey, _mm256_xor_si256(signBit,
+          _mm256_loadu_si256((const __m256i*)(keys + count - 8))));
+      moveMask = (unsigned)_mm256_movemask_ps(_mm256_castsi256_ps(lessMask));
+      lessCount += __builtin_popcount(moveMask >> (8 - (count - index)));
+    }
+
+    return lessCount;
+  }
+  #endif
+
+  /* Counts the keys less than key in a sorted window. Dense keys use the
+     widest vector unit the CPU supports. Keys interleaved with item data
+     are scanned one at a time. */
+  static inline size_t KeyArrayUintCountLess( const void* keyBase,
+      size_t keyStride, size_t count, unsigned key ) {
+    if( keyStride == sizeof(unsigned) ) {
+  #if defined(KEYARRAY_SIMD_AVX2)
+      if( KEYARRAY_HAS_AVX2() ) {
+        return KeyArrayUintCountLessAVX2((const unsigned*)keyBase,
+            count, key);
+      }
+  #endif
+  #if defined(KEYARRAY_SIMD_SSE2)
+      return KeyArrayUintCountLessSSE2((const unsigned*)keyBase,
+          count, key);
+  #endif
+    }
+
+    return KeyArrayUintCountLessScalar(keyBase, keyStride, count, key);
+  }
+
+  /* Returns the index of the first key not less than key. The window is
+     narrowed with a branchless binary search until it is no larger than
+     linearThreshold, then the rest is counted with a linear scan. */
+  static inline size_t KeyArrayUintLowerBound( const void* keyBase,
+      size_t keyStride, size_t count, unsigned key,
+      size_t linearThreshold ) {
+    size_t leftIndex = 0;
+    size_t halfCount;
+
+    if( linearThreshold < 1 ) {
+      linearThreshold = 1;
+    }
+
+    while( count > linearThreshold ) {
+      halfCount = count / 2;
+      if( KEYARRAY_UINT_KEYAT(keyBase, keyStride,
+          leftIndex + halfCount) < key ) {
+        leftIndex += halfCount;
+      }
+      count -= halfCount;
+      KEYARRAY_STATS_COMPARE( 1 );
+    }
+    KEYARRAY_STATS_COMPARE( count );
+
+    return leftIndex + KeyArrayUintCountLess(
+        (const char*)keyBase + (leftIndex * keyStride), keyStride, count, key);
+  }
+
+  /* Read-optimized search index for unsigned keys */
+  #if defined(__GNUC__) || defined(__clang__)
+    #define KEYARRAY_PREFETCH( address ) __builtin_prefetch( (address) )
+  #else
+    #define KEYARRAY_PREFETCH( address )
+  #endif
+
+  typedef struct KeyArrayUintSearchIndex {
+    unsigned* keys;
+    size_t* ranks;
+    size_t count;
+    size_t generation;
+    int built;
+  } KeyArrayUintSearchIndex;
+
+  /* Fills the index in Eytzinger (breadth first) order, from an in-order
+     walk of the sorted keys. Returns the next sorted index. */
+  static inline size_t KeyArrayUintFillSearchIndex(
+      KeyArrayUintSearchIndex* searchIndex, const void* keyBase,
+      size_t keyStride, size_t sortedIndex, size_t treeIndex ) {
+    if( treeIndex <= searchIndex->count ) {
+      sortedIndex = KeyArrayUintFillSearchIndex(searchIndex, keyBase,
+          keyStride, sortedIndex, 2 * treeIndex);
+
+      searchIndex->keys[treeIndex] =
+        KEYARRAY_UINT_KEYAT(keyBase, keyStride, sortedIndex);
+      searchIndex->ranks[treeIndex] = sortedIndex;
+      sortedIndex++;
+
+      sortedIndex = KeyArrayUintFillSearchIndex(searchIndex, keyBase,
+          keyStride, sortedIndex, (2 * treeIndex) + 1);
+    }
+
+    return sortedIndex;
+  }
+
+  static inline int KeyArrayUintBuildSearchIndex(
+      KeyArrayUintSearchIndex* searchIndex, const void* keyBase,
+      size_t keyStride, size_t count, size_t generation ) {
+    unsigned* keys;
+    size_t* ranks;
+
+    if( count >= (((size_t)-1) / sizeof(size_t)) ) {
+      return 0;
+    }
+
+    searchIndex->built = 0;
+
+    /* Slot 0 is unused, so the tree is 1-based */
+    keys = (unsigned*)realloc(searchIndex->keys,
+        (count + 1) * sizeof(unsigned));
+    if( keys == NULL ) {
+      return 0;
+    }
+    searchIndex->keys = keys;
+
+    ranks = (size_t*)realloc(searchIndex->ranks,
+        (count + 1) * sizeof(size_t));
+    if( ranks == NULL ) {
+      return 0;
+    }
+    searchIndex->ranks = ranks;
+
+    searchIndex->count = count;
+    KeyArrayUintFillSearchIndex( searchIndex, keyBase, keyStride, 0, 1 );
+
+    searchIndex->generation = generation;
+    searchIndex->built = 1;
+
+    return 1;
+  }
+
+  static inline void KeyArrayUintFreeSearchIndex(
+      KeyArrayUintSearchIndex** searchIndex ) {
+    if( searchIndex && (*searchIndex) ) {
+      if( (*searchIndex)->keys ) {
+        free( (*searchIndex)->keys );
+      }
+      if( (*searchIndex)->ranks ) {
+        free( (*searchIndex)->ranks );
+      }
+      free( (*searchIndex) );
+      (*searchIndex) = NULL;
+    }
+  }
+
+  /* Returns the sorted index of key, or (size_t)-1 if not found.
+     A stale index is not used, and the sorted keys are searched
+     directly, until the index is enabled again. A lookup never writes
+     to the index, so it may be searched by many threads at once. */
+  static inline size_t KeyArrayUintSearch(
+      const KeyArrayUintSearchIndex* searchIndex, const void* keyBase,
+      size_t keyStride, size_t count, size_t generation, unsigned key ) {
+    const unsigned* keys;
+    size_t treeIndex;
+    size_t leftIndex;
+
+    if( !(searchIndex->built && (searchIndex->generation == generation)) ) {
+      leftIndex = KeyArrayUintLowerBound(keyBase, keyStride, count, key,
+          (keyStride == sizeof(unsigned)) ?
+          KEYARRAY_UINT_LINEAR_THRESHOLD : KEYARRAY_UINT_STRIDED_THRESHOLD);
+      if( (leftIndex < count) &&
+          (KEYARRAY_UINT_KEYAT(keyBase, keyStride, leftIndex) == key) ) {
+        return leftIndex;
+      }
+      return (size_t)-1;
+    }
+
+    /* Branchless descent, prefetching the descendants four levels down */
+    keys = searchIndex->keys;
+    treeIndex = 1;
+    while( treeIndex <= count ) {
+      KEYARRAY_PREFETCH( (const char*)keys +
+          (treeIndex * 16 * sizeof(unsigned)) );
+      treeIndex = (2 * treeIndex) + (keys[treeIndex] < key);
+      KEYARRAY_STATS_COMPARE( 1 );
+    }
+
+    /* Undo the right turns, and the last left turn, to find the
+       lower bound */
+  #if defined(__GNUC__) || defined(__clang__)
+    treeIndex >>= __builtin_ctzll(~(unsigned long long)treeIndex) + 1;
+  #else
+    while( treeIndex & 1 ) {
+      treeIndex >>= 1;
+    }
+    treeIndex >>= 1;
+  #endif
+
+    if( treeIndex && (keys[treeIndex] == key) ) {
+      return searchIndex->ranks[treeIndex];
+    }
+
+    return (size_t)-1;
+  }
+
+  /* Ordered bounds. Each returns the index of the first key not less than
+     key or, if upperBound is non-zero, of the first key greater than key.
+     Returns count if there is no such key. */
+  static inline size_t KeyArrayStringBound( const void* keyBase,
+      size_t keyStride, size_t count, const char* key, int upperBound ) {
+    size_t leftIndex = 0;
+    size_t rightIndex = count;
+    size_t searchIndex;
+    int result;
+
+    while( leftIndex < rightIndex ) {
+      searchIndex = leftIndex + ((rightIndex - leftIndex) / 2);
+      result = strcmp(KEYARRAY_STRING_KEYAT(keyBase, keyStride, searchIndex),
+          key);
+      KEYARRAY_STATS_COMPARE( 1 );
+      if( (result < 0) || (upperBound && (result == 0)) ) {
+        leftIndex = searchIndex + 1;
+      } else {
+        rightIndex = searchIndex;
+      }
+    }
+
+    return leftIndex;
+  }
+
+  static inline size_t KeyArrayStringPrefixBound( const void* prefixBase,
+      const void* keyBase, size_t itemStride, size_t count, const char* key,
+      int upperBound ) {
+    KeyArrayStringPrefix keyPrefix;
+    size_t leftIndex = 0;
+    size_t rightIndex = count;
+    size_t searchIndex;
+    int result;
+
+    /* Pack the key prefix once, for every probe */
+    KeyArraySetStringPrefix( &keyPrefix, key );
+
+    while( leftIndex < rightIndex ) {
+      searchIndex = leftIndex + ((rightIndex - leftIndex) / 2);
+      result = KeyArrayCompareStringPrefix(
+          (const KeyArrayStringPrefix*)((const char*)prefixBase +
+          (searchIndex * itemStride)),
+          KEYARRAY_STRING_KEYAT(keyBase, itemStride, searchIndex),
+          &keyPrefix, key);
+      if( (result < 0) || (upperBound && (result == 0)) ) {
+        leftIndex = searchIndex + 1;
+      } else {
+        rightIndex = searchIndex;
+      }
+    }
+
+    return leftIndex;
+  }
+
+  static inline size_t KeyArrayUintBound( const void* keyBase,
+      size_t keyStride, size_t count, unsigned key, int upperBound ) {
+    if( upperBound ) {
+      if( key == ((unsigned)-1) ) {
+        return count;
+      }
+      key++;
+    }
+
+    return KeyArrayUintLowerBound(keyBase, keyStride, count, key,
+        (keyStride == sizeof(unsigned)) ? KEYARRAY_UINT_LINEAR_THRESHOLD :
+        KEYARRAY_UINT_STRIDED_THRESHOLD);
+  }
+
+  /* Galloping searches. Each returns the index of the first key not less
+     than key, at or after startIndex. Keys are probed 1, 2, 4, ... items
+     ahead, then the last window is searched, so skipping a run of n
+     keys takes O(log n) compares. */
+  static inline size_t KeyArrayStringGallop( const void* keyBase,
+      size_t keyStride, size_t startIndex, size_t count, const char* key ) {
+    size_t leftIndex = startIndex;
+    size_t rightIndex = startIndex;
+    size_t step = 1;
+
+    while( (rightIndex < count) &&
+        (strcmp(KEYARRAY_STRING_KEYAT(keyBase, keyStride, rightIndex),
+        key) < 0) ) {
+      leftIndex = rightIndex + 1;
+      rightIndex += step;
+      step *= 2;
+    }
+    if( rightIndex > count ) {
+      rightIndex = count;
+    }
+
+    return leftIndex + KeyArrayStringBound(
+        (const char*)keyBase + (leftIndex * keyStride), keyStride,
+        rightIndex - leftIndex, key, 0);
+  }
+
+  static inline size_t KeyArrayStringPrefixGallop( const void* prefixBase,
+      const void* keyBase, size_t itemStride, size_t startIndex,
+      size_t count, const KeyArrayStringPrefix* keyPrefix,
+      const char* key ) {
+    size_t leftIndex = startIndex;
+    size_t rightIndex = startIndex;
+    size_t step = 1;
+
+    while( (rightIndex < count) && (KeyArrayCompareStringPrefix(
+        (const KeyArrayStringPrefix*)((const char*)prefixBase +
+        (rightIndex * itemStride)),
+        KEYARRAY_STRING_KEYAT(keyBase, itemStride, rightIndex),
+        keyPrefix, key) < 0) ) {
+      leftIndex = rightIndex + 1;
+      rightIndex += step;
+      step *= 2;
+    }
+    if( rightIndex > count ) {
+      rightIndex = count;
+    }
+
+    return leftIndex + KeyArrayStringPrefixBound(
+        (const char*)prefixBase + (leftIndex * itemStride),
+        (const char*)keyBase + (leftIndex * itemStride), itemStride,
+        rightIndex - leftIndex, key, 0);
+  }
+
+  static inline size_t KeyArrayUintGallop( const void* keyBase,
+      size_t keyStride, size_t startIndex, size_t count, unsigned key ) {
+    size_t leftIndex = startIndex;
+    size_t rightIndex = startIndex;
+    size_t step = 1;
+
+    while( (rightIndex < count) &&
+        (KEYARRAY_UINT_KEYAT(keyBase, keyStride, rightIndex) < key) ) {
+      leftIndex = rightIndex + 1;
+      rightIndex += step;
+      step *= 2;
+    }
+    if( rightIndex > count ) {
+      rightIndex = count;
+    }
+
+    return leftIndex + KeyArrayUintBound(
+        (const char*)keyBase + (leftIndex * keyStride), keyStride,
+        rightIndex - leftIndex, key, 0);
+  }
+
+  /* Unsigned keys of any width. 32 bit keys use the searches above; 16
+     and 64 bit keys are read at their size, and searched with a
+     branchless binary search. */
+  static inline uint64_t KeyArrayUintWideKeyAt( const void* keyBase,
+      size_t keyStride, size_t keySize, size_t index ) {
+    const char* keyAddress = (const char*)keyBase + (index * keyStride);
+
+    switch( keySize ) {
+    case sizeof(uint16_t):
+      return *(const uint16_t*)keyAddress;
+
+    case sizeof(uint64_t):
+      return *(const uint64_t*)keyAddress;
+
+    default:
+      return *(const uint32_t*)keyAddress;
+    }
+  }
+
+  static inline size_t KeyArrayUintWideBound( const void* keyBase,
+      size_t keyStride, size_t keySize, size_t count, uint64_t key,
+      int upperBound ) {
+    size_t leftIndex = 0;
+    size_t halfCount;
+    uint64_t searchKey;
+
+    if( count == 0 ) {
+      return 0;
+    }
+
+    while( count > 1 ) {
+      halfCount = count / 2;
+      searchKey = KeyArrayUintWideKeyAt(keyBase, keyStride, keySize,
+          leftIndex + halfCount);
+      if( (searchKey < key) || (upperBound && (searchKey == key)) ) {
+        leftIndex += halfCount;
+      }
+      count -= halfCount;
+      KEYARRAY_STATS_COMPARE( 1 );
+    }
+
+    searchKey = KeyArrayUintWideKeyAt(keyBase, keyStride, keySize,
+        leftIndex);
+    KEYARRAY_STATS_COMPARE( 1 );
+    return leftIndex +
+      ((searchKey < key) || (upperBound && (searchKey == key)));
+  }
+
+  static inline size_t KeyArrayUintWideGallop( const void* keyBase,
+      size_t keyStride, size_t keySize, size_t startIndex, size_t count,
+      uint64_t key ) {
+    size_t leftIndex = startIndex;
+    size_t rightIndex = startIndex;
+    size_t step = 1;
+
+    while( (rightIndex < count) && (KeyArrayUintWideKeyAt(keyBase,
+        keyStride, keySize, rightIndex) < key) ) {
+      leftIndex = rightIndex + 1;
+      rightIndex += step;
+      step *= 2;
+    }
+    if( rightIndex > count ) {
+      rightIndex = count;
+    }
+
+    return leftIndex + KeyArrayUintWideBound(
+        (const char*)keyBase + (leftIndex * keyStride), keyStride, keySize,
+        rightIndex - leftIndex, key, 0);
+  }
+
+  /* Finger searches, for insert and cached lookups. Each returns the
+     index of the first key not less than key, searching out from
+     fingerIndex, the last position used. A key past the last key is
+     found with at most two compares, so ascending keys append in O(1).
+     Keys within KEYARRAY_FINGER_REACH items of the finger are found by
+     galloping, with O(log d) compares for a key d items away. Farther
+     keys cost a few compares more than a binary search of the list. */
+  #ifndef KEYARRAY_FINGER_REACH
+    #define KEYARRAY_FINGER_REACH 16
+  #endif
+
+  static inline size_t KeyArrayStringFingerBound( const void* keyBase,
+      size_t keyStride, size_t fingerIndex, size_t count, const char* key ) {
+    size_t leftIndex;
+    size_t rightIndex;
+    size_t probeIndex;
+    size_t step = 1;
+
+    if( count == 0 ) {
+      return 0;
+    }
+
+    if( fingerIndex >= count ) {
+      fingerIndex = count - 1;
+    }
+
+    KEYARRAY_STATS_COMPARE( 1 );
+    if( strcmp(KEYARRAY_STRING_KEYAT(keyBase, keyStride, fingerIndex),
+        key) < 0 ) {
+      /* Key is past the finger, check the last key before galloping */
+      leftIndex = fingerIndex + 1;
+      rightIndex = count;
+      if( leftIndex < count ) {
+        KEYARRAY_STATS_COMPARE( 1 );
+        if( strcmp(KEYARRAY_STRING_KEYAT(keyBase, keyStride, count - 1),
+            key) < 0 ) {
+          return count;
+        }
+        rightIndex = count - 1;
+      }
+
+      while( (step <= KEYARRAY_FINGER_REACH) &&
+          ((fingerIndex + step) < rightIndex) ) {
+        probeIndex = fingerIndex + step;
+        KEYARRAY_STATS_COMPARE( 1 );
+        if( strcmp(KEYARRAY_STRING_KEYAT(keyBase, keyStride, probeIndex),
+            key) >= 0 ) {
+          rightIndex = probeIndex;
+          break;
+        }
+        leftIndex = probeIndex + 1;
+        step *= 2;
+      }
+    } else {
+      /* Key is at or before the finger, gallop back */
+      leftIndex = 0;
+      rightIndex = fingerIndex;
+      while( (step <= KEYARRAY_FINGER_REACH) && (step <= fingerIndex) ) {
+        probeIndex = fingerIndex - step;
+        KEYARRAY_STATS_COMPARE( 1 );
+        if( strcmp(KEYARRAY_STRING_KEYAT(keyBase, keyStride, probeIndex),
+            key) < 0 ) {
+          leftIndex = probeIndex + 1;
+          break;
+        }
+        rightIndex = probeIndex;
+        step *= 2;
+      }
+    }
+
+    /* Out of reach, search the whole list, whose first probes are more
+       likely to be cached than those of the window left */
+    if( (rightIndex - leftIndex) > KEYARRAY_FINGER_REACH ) {
+      leftIndex = 0;
+      rightIndex = count;
+    }
+
+    return leftIndex + KeyArrayStringBound(
+        (const char*)keyBase + (leftIndex * keyStride), keyStride,
+        rightIndex - leftIndex, key, 0);
+  }
+
+  static inline size_t KeyArrayUintFingerBound( const void* keyBase,
+      size_t keyStride, size_t keySize, size_t fingerIndex, size_t count,
+      uint64_t key ) {
+    size_t leftIndex;
+    size_t rightIndex;
+    size_t probeIndex;
+    size_t step = 1;
+
+    if( count == 0 ) {
+      return 0;
+    }
+
+    if( fingerIndex >= count ) {
+      fingerIndex = count - 1;
+    }
+
+    KEYARRAY_STATS_COMPARE( 1 );
+    if( KeyArrayUintWideKeyAt(keyBase, keyStride, keySize,
+        fingerIndex) < key ) {
+      /* Key is past the finger, check the last key before galloping */
+      leftIndex = fingerIndex + 1;
+      rightIndex = count;
+      if( leftIndex < count ) {
+        KEYARRAY_STATS_COMPARE( 1 );
+        if( KeyArrayUintWideKeyAt(keyBase, keyStride, keySize,
+            count - 1) < key ) {
+          return count;
+        }
+        rightIndex = count - 1;
+      }
+
+      while( (step <= KEYARRAY_FINGER_REACH) &&
+          ((fingerIndex + step) < rightIndex) ) {
+        probeIndex = fingerIndex + step;
+        KEYARRAY_STATS_COMPARE( 1 );
+        if( KeyArrayUintWideKeyAt(keyBase, keyStride, keySize,
+            probeIndex) >= key ) {
+          rightIndex = probeIndex;
+          break;
+        }
+        leftIndex = probeIndex + 1;
+        step *= 2;
+      }
+    } else {
+      /* Key is at or before the finger, gallop back */
+      leftIndex = 0;
+      rightIndex = fingerIndex;
+      while( (step <= KEYARRAY_FINGER_REACH) && (step <= fingerIndex) ) {
+        probeIndex = fingerIndex - step;
+        KEYARRAY_STATS_COMPARE( 1 );
+        if( KeyArrayUintWideKeyAt(keyBase, keyStride, keySize,
+            probeIndex) < key ) {
+          leftIndex = probeIndex + 1;
+          break;
+        }
+        rightIndex = probeIndex;
+        step *= 2;
+      }
+    }
+
+    if( (rightIndex - leftIndex) > KEYARRAY_FINGER_REACH ) {
+      leftIndex = 0;
+      rightIndex = count;
+    }
+
+    keyBase = (const char*)keyBase + (leftIndex * keyStride);
+    if( keySize == sizeof(unsigned) ) {
+      return leftIndex + KeyArrayUintBound(keyBase, keyStride,
+          rightIndex - leftIndex, (unsigned)key, 0);
+    }
+    return leftIndex + KeyArrayUintWideBound(keyBase, keyStride, keySize,
+        rightIndex - leftIndex, key, 0);
+  }
+
+  /* Lookup cache. Keeps the item indices of recently found keys in a
+     small direct-mapped table, and the last found index as a finger to
+     search out from. The table holds the list generation it was filled
+     at, and is cleared by the first lookup after the list changes. */
+  #ifndef KEYARRAY_LOOKUPCACHE_BITS
+    #define KEYARRAY_LOOKUPCACHE_BITS 8
+  #endif
+
+  /* The key, or the hash of a string key, and its item index + 1.
+     Index 0 marks an empty entry. */
+  typedef struct KeyArrayLookupCacheEntry {
+    uint64_t keyHash;
+    size_t itemIndex;
+  } KeyArrayLookupCacheEntry;
+
+  typedef struct KeyArrayLookupCache {
+    size_t generation;
+    size_t hitCount;
+    size_t missCount;
+    size_t fingerIndex;
+    KeyArrayLookupCacheEntry entry[((size_t)1) << KEYARRAY_LOOKUPCACHE_BITS];
+  } KeyArrayLookupCache;
+
+  /* Returns the entry for keyHash, after clearing the table if the list
+     has changed since it was filled. Fibonacci hashing spreads adjacent
+     keys across entries. */
+  static inline KeyArrayLookupCacheEntry* KeyArrayLookupCacheEntryOf(
+      KeyArrayLookupCache* lookupCache, size_t generation,
+      uint64_t keyHash ) {
+    if( lookupCache->generation != generation ) {
+      memset( lookupCache->entry, 0, sizeof(lookupCache->entry) );
+      lookupCache->generation = generation;
+    }
+
+    return &(lookupCache->entry[(size_t)((keyHash *
+        11400714819323198485ULL) >> (64 - KEYARRAY_LOOKUPCACHE_BITS))]);
+  }
+
+  static inline void KeyArrayFreeLookupCache(
+      KeyArrayLookupCache** lookupCache ) {
+    if( lookupCache && (*lookupCache) ) {
+      free( (*lookupCache) );
+      (*lookupCache) = NULL;
+    }
+  }
+
+  #define KEYARRAY_DECLARE_LOOKUPCACHE( funcName, listType )\
+  int funcName( listType* keyList, int enable ) {\
+    if( keyList == NULL ) {\
+      return 0;\
+    }\
+    \
+    if( enable == 0 ) {\
+      KeyArrayFreeLookupCache( &(keyList->lookupCache) );\
+      return 1;\
+    }\
+    \
+    if( keyList->lookupCache == NULL ) {\
+      keyList->lookupCache =\
+        (KeyArrayLookupCache*)calloc(1, sizeof(KeyArrayLookupCache));\
+      if( keyList->lookupCache == NULL ) {\
+        return 0;\
+      }\
+    }\
+    \
+    return 1;\
+  }
+
+  #define KEYARRAY_DECLARE_CACHECOUNTS( funcName, listType )\
+  int funcName( listType* keyList, size_t* hitCount, size_t* missCount,\
+      int resetCounts ) {\
+    if( !(keyList && keyList->lookupCache) ) {\
+      return 0;\
+    }\
+    \
+    if( hitCount ) {\
+      (*hitCount) = keyList->lookupCache->hitCount;\
+    }\
+    if( missCount ) {\
+      (*missCount) = keyList->lookupCache->missCount;\
+    }\
+    \
+    if( resetCounts ) {\
+      keyList->lookupCache->hitCount = 0;\
+      keyList->lookupCache->missCount = 0;\
+    }\
+    \
+    return 1;\
+  }
+
+  /* Returns the index of key, or (size_t)-1 if not found. Turns away
+     keys the bloom filter has never seen, if enabled, then checks the
+     lookup cache, if enabled, then looks the key up in the hash index,
+     if enabled. */
+  static inline size_t KeyArrayStringFind(
+      const KeyArrayBloomFilter* bloomFilter,
+      KeyArrayLookupCache* lookupCache, size_t generation,
+      const KeyArrayStringHashIndex* hashIndex, const void* keyBase,
+      size_t keyStride, size_t count, const char* key ) {
+    KeyArrayLookupCacheEntry* cacheEntry = NULL;
+    size_t foundIndex;
+    uint64_t keyHash = 0;
+
+    if( bloomFilter || lookupCache ) {
+      keyHash = KeyArrayStringHash64(key);
+    }
+
+    if( bloomFilter && (KeyArrayBloomTest(bloomFilter, keyHash) == 0) ) {
+      return (size_t)-1;
+    }
+
+    /* Equal hashes are confirmed, as different keys may share one */
+    if( lookupCache ) {
+      cacheEntry = KeyArrayLookupCacheEntryOf(lookupCache, generation,
+          keyHash);
+      if( cacheEntry->itemIndex && (cacheEntry->keyHash == keyHash) ) {
+        foundIndex = cacheEntry->itemIndex - 1;
+        KEYARRAY_STATS_COMPARE( 1 );
+        if( strcmp(KEYARRAY_STRING_KEYAT(keyBase, keyStride, foundIndex),
+            key) == 0 ) {
+          lookupCache->hitCount++;
+          lookupCache->fingerIndex = foundIndex;
+          return foundIndex;
+        }
+      }
+      lookupCache->missCount++;
+    }
+
+    if( hashIndex ) {
+      foundIndex = KeyArrayStringHashFind(hashIndex, keyBase, keyStride,
+          key);
+    } else {
+      if( lookupCache ) {
+        foundIndex = KeyArrayStringFingerBound(keyBase, keyStride,
+            lookupCache->fingerIndex, count, key);
+      } else {
+        foundIndex = KeyArrayStringBound(keyBase, keyStride, count, key, 0);
+      }
+      if( !((foundIndex < count) && (strcmp(KEYARRAY_STRING_KEYAT(keyBase,
+          keyStride, foundIndex), key) == 0)) ) {
+        foundIndex = (size_t)-1;
+      }
+    }
+
+    if( cacheEntry && (foundIndex != ((size_t)-1)) ) {
+      cacheEntry->keyHash = keyHash;
+      cacheEntry->itemIndex = foundIndex + 1;
+      lookupCache->fingerIndex = foundIndex;
+    }
+
+    return foundIndex;
+  }
+
+  #define KEYARRAY_STRING_LIST_FIND( keyList, searchKey )\
+    KeyArrayStringFind((keyList)->bloomFilter, (keyList)->lookupCache,\
+        (keyList)->generation, (keyList)->hashIndex, &((keyList)->item[0].key),\
+        sizeof((keyList)->item[0]), (keyList)->itemCount, (searchKey))
+
+  /* Bound of key in an array of unsigned key items, of any key width */
+  #define KEYARRAY_UINT_ITEM_BOUND( item, count, searchKey, upperBound )\
+    ((sizeof((item)[0].key) == sizeof(unsigned)) ?\
+      KeyArrayUintBound(&((item)[0].key), sizeof(*(item)), (count),\
+          (unsigned)(searchKey), (upperBound)) :\
+      KeyArrayUintWideBound(&((item)[0].key), sizeof(*(item)),\
+          sizeof((item)[0].key), (count), (uint64_t)(searchKey),\
+          (upperBound)))
+
+  /* Returns the index of key, or (size_t)-1 if not found. Checks the
+     lookup cache first, if enabled, then searches the read-optimized
+     index, if enabled. */
+  static inline size_t KeyArrayUintFind( KeyArrayLookupCache* lookupCache,
+      KeyArrayUintSearchIndex* searchIndex, size_t generation,
+      const void* keyBase, size_t keyStride, size_t keySize, size_t count,
+      uint64_t key ) {
+    KeyArrayLookupCacheEntry* cacheEntry = NULL;
+    size_t foundIndex;
+
+    /* An entry filled at this generation is current, so a key that
+       matches it is a hit without reading the list */
+    if( lookupCache ) {
+      cacheEntry = KeyArrayLookupCacheEntryOf(lookupCache, generation,
+          key);
+      if( cacheEntry->itemIndex && (cacheEntry->keyHash == key) ) {
+        foundIndex = cacheEntry->itemIndex - 1;
+        lookupCache->hitCount++;
+        lookupCache->fingerIndex = foundIndex;
+        return foundIndex;
+      }
+      lookupCache->missCount++;
+    }
+
+    if( searchIndex ) {
+      foundIndex = KeyArrayUintSearch(searchIndex, keyBase, keyStride, count,
+          generation, (unsigned)key);
+    } else {
+      if( lookupCache ) {
+        foundIndex = KeyArrayUintFingerBound(keyBase, keyStride, keySize,
+            lookupCache->fingerIndex, count, key);
+      } else if( keySize == sizeof(unsigned) ) {
+        foundIndex = KeyArrayUintBound(keyBase, keyStride, count,
+            (unsigned)key, 0);
+      } else {
+        foundIndex = KeyArrayUintWideBound(keyBase, keyStride, keySize,
+            count, key, 0);
+      }
+      if( !((foundIndex < count) && (KeyArrayUintWideKeyAt(keyBase,
+          keyStride, keySize, foundIndex) == key)) ) {
+        foundIndex = (size_t)-1;
+      }
+    }
+
+    if( cacheEntry && (foundIndex != ((size_t)-1)) ) {
+      cacheEntry->keyHash = key;
+      cacheEntry->itemIndex = foundIndex + 1;
+      lookupCache->fingerIndex = foundIndex;
+    }
+
+    return foundIndex;
+  }
+
+  #define KEYARRAY_UINT_LIST_FIND( keyList, searchKey )\
+    KeyArrayUintFind((keyList)->lookupCache, (keyList)->searchIndex,\
+        (keyList)->generation, &((keyList)->item[0].key),\
+        sizeof((keyList)->item[0]), sizeof((keyList)->item[0].key),\
+        (keyList)->itemCount, (uint64_t)(searchKey))
+
+  /* Batched lookups. The binary searches of up to KEYARRAY_BATCH_WIDTH
+     keys run in lockstep, halving every search window each round. Each
+     round prefetches the probe of every search before comparing any,
+     so their cache misses overlap instead of stalling one at a time.
+     Probes keep the last index whose key is not greater than the key
+     looked up, so one compare after the last round finds the match. */
+  #ifndef KEYARRAY_BATCH_WIDTH
+    #define KEYARRAY_BATCH_WIDTH 16
+  #endif
+
+  /* Stores the index of each of keyCount keys in foundIndex, or
+     (size_t)-1 if not found. Returns the number of keys found. */
+  static inline size_t KeyArrayStringFindMany( const void* keyBase,
+      size_t keyStride, size_t count, char* const* key, size_t keyCount,
+      size_t* foundIndex ) {
+    size_t leftIndex[KEYARRAY_BATCH_WIDTH];
+    const char* probeKey[KEYARRAY_BATCH_WIDTH];
+    size_t batchIndex;
+    size_t laneCount;
+    size_t laneIndex;
+    size_t searchCount;
+    size_t halfCount;
+    size_t foundCount = 0;
+
+    for( batchIndex = 0; batchIndex < keyCount; batchIndex += laneCount ) {
+      laneCount = keyCount - batchIndex;
+      if( laneCount > KEYARRAY_BATCH_WIDTH ) {
+        laneCount = KEYARRAY_BATCH_WIDTH;
+      }
+
+      if( count == 0 ) {
+        for( laneIndex = 0; laneIndex < laneCount; laneIndex++ ) {
+          foundIndex[batchIndex + laneIndex] = (size_t)-1;
+        }
+        continue;
+      }
+
+      for( laneIndex = 0; laneIndex < laneCount; laneIndex++ ) {
+        leftIndex[laneIndex] = 0;
+      }
+
+      for( searchCount = count; searchCount > 1;
+          searchCount -= halfCount ) {
+        halfCount = searchCount / 2;
+
+        /* Fetch the key pointer of every probe, then every key */
+        for( laneIndex = 0; laneIndex < laneCount; laneIndex++ ) {
+          KEYARRAY_PREFETCH( (const char*)keyBase +
+              ((leftIndex[laneIndex] + halfCount) * keyStride) );
+        }
+        for( laneIndex = 0; laneIndex < laneCount; laneIndex++ ) {
+          probeKey[laneIndex] = KEYARRAY_STRING_KEYAT(keyBase, keyStride,
+              leftIndex[laneIndex] + halfCount);
+          KEYARRAY_PREFETCH( probeKey[laneIndex] );
+        }
+
+        for( laneIndex = 0; laneIndex < laneCount; laneIndex++ ) {
+          if( strcmp(probeKey[laneIndex], key[batchIndex + laneIndex]) <=
+              0 ) {
+            leftIndex[laneIndex] += halfCount;
+          }
+        }
+        KEYARRAY_STATS_COMPARE( laneCount );
+      }
+
+      for( laneIndex = 0; laneIndex < laneCount; laneIndex++ ) {
+        if( strcmp(KEYARRAY_STRING_KEYAT(keyBase, keyStride,
+            leftIndex[laneIndex]), key[batchIndex + laneIndex]) == 0 ) {
+          foundIndex[batchIndex + laneIndex] = leftIndex[laneIndex];
+          foundCount++;
+        } else {
+          foundIndex[batchIndex + laneIndex] = (size_t)-1;
+        }
+      }
+      KEYARRAY_STATS_COMPARE( laneCount );
+    }
+
+    return foundCount;
+  }
+
+  /* The same, for an array of keySize byte keys */
+  static inline size_t KeyArrayUintFindMany( const void* keyBase,
+      size_t keyStride, size_t keySize, size_t count, const void* key,
+      size_t keyCount, size_t* foundIndex ) {
+    size_t leftIndex[KEYARRAY_BATCH_WIDTH];
+    uint64_t searchKey[KEYARRAY_BATCH_WIDTH];
+    size_t batchIndex;
+    size_t laneCount;
+    size_t laneIndex;
+    size_t searchCount;
+    size_t halfCount;
+    size_t foundCount = 0;
+
+    for( batchIndex = 0; batchIndex < keyCount; batchIndex += laneCount ) {
+      laneCount = keyCount - batchIndex;
+      if( laneCount > KEYARRAY_BATCH_WIDTH ) {
+        laneCount = KEYARRAY_BATCH_WIDTH;
+      }
+
+      if( count == 0 ) {
+        for( laneIndex = 0; laneIndex < laneCount; laneIndex++ ) {
+          foundIndex[batchIndex + laneIndex] = (size_t)-1;
+        }
+        continue;
+      }
+
+      for( laneIndex = 0; laneIndex < laneCount; laneIndex++ ) {
+        leftIndex[laneIndex] = 0;
+        searchKey[laneIndex] = KeyArrayUintWideKeyAt(key, keySize, keySize,
+            batchIndex + laneIndex);
+      }
+
+      for( searchCount = count; searchCount > 1;
+          searchCount -= halfCount ) {
+        halfCount = searchCount / 2;
+
+        for( laneIndex = 0; laneIndex < laneCount; laneIndex++ ) {
+          KEYARRAY_PREFETCH( (const char*)keyBase +
+              ((leftIndex[laneIndex] + halfCount) * keyStride) );
+        }
+
+        for( laneIndex = 0; laneIndex < laneCount; laneIndex++ ) {
+          leftIndex[laneIndex] += (KeyArrayUintWideKeyAt(keyBase,
+              keyStride, keySize, leftIndex[laneIndex] + halfCount) <=
+              searchKey[laneIndex]) ? halfCount : 0;
+        }
+        KEYARRAY_STATS_COMPARE( laneCount );
+      }
+
+      for( laneIndex = 0; laneIndex < laneCount; laneIndex++ ) {
+        if( KeyArrayUintWideKeyAt(keyBase, keyStride, keySize,
+            leftIndex[laneIndex]) == searchKey[laneIndex] ) {
+          foundIndex[batchIndex + laneIndex] = leftIndex[laneIndex];
+          foundCount++;
+        } else {
+          foundIndex[batchIndex + laneIndex] = (size_t)-1;
+        }
+      }
+      KEYARRAY_STATS_COMPARE( laneCount );
+    }
+
+    return foundCount;
+  }
+
+  /* The same, looking each key up alone through the bloom filter, lookup
+     cache, and hash index of a string list. A hash index finds a key in
+     a probe or two, and the cache has to see keys one at a time to stay
+     current, so interleaving the searches gains nothing once either is
+     enabled. */
+  static inline size_t KeyArrayStringFindEach(
+      const KeyArrayBloomFilter* bloomFilter,
+      KeyArrayLookupCache* lookupCache, size_t generation,
+      const KeyArrayStringHashIndex* hashIndex, const void* keyBase,
+      size_t keyStride, size_t count, char* const* key, size_t keyCount,
+      size_t* foundIndex ) {
+    size_t keyIndex;
+    size_t foundCount = 0;
+
+    for( keyIndex = 0; keyIndex < keyCount; keyIndex++ ) {
+      foundIndex[keyIndex] = KeyArrayStringFind(bloomFilter, lookupCache,
+          generation, hashIndex, keyBase, keyStride, count, key[keyIndex]);
+      if( foundIndex[keyIndex] != ((size_t)-1) ) {
+        foundCount++;
+      }
+    }
+
+    return foundCount;
+  }
+
+  /* The same, through the lookup cache and search index of an unsigned
+     key list */
+  static inline size_t KeyArrayUintFindEach( KeyArrayLookupCache* lookupCache,
+      KeyArrayUintSearchIndex* searchIndex, size_t generation,
+      const void* keyBase, size_t keyStride, size_t keySize, size_t count,
+      const void* key, size_t keyCount, size_t* foundIndex ) {
+    size_t keyIndex;
+    size_t foundCount = 0;
+
+    for( keyIndex = 0; keyIndex < keyCount; keyIndex++ ) {
+      foundIndex[keyIndex] = KeyArrayUintFind(lookupCache, searchIndex,
+          generation, keyBase, keyStride, keySize, count,
+          KeyArrayUintWideKeyAt(key, keySize, keySize, keyIndex));
+      if( foundIndex[keyIndex] != ((size_t)-1) ) {
+        foundCount++;
+      }
+    }
+
+    return foundCount;
+  }
+
+  /* Batched lookups of a list, through the same lookup structures as
+     single lookups, when any is enabled */
+  #define KEYARRAY_STRING_LIST_FINDMANY( keyList, searchKey, keyCount,\
+      foundIndex )\
+    (((keyList)->itemCount && ((keyList)->bloomFilter ||\
+        (keyList)->lookupCache || (keyList)->hashIndex)) ?\
+      KeyArrayStringFindEach((keyList)->bloomFilter, (keyList)->lookupCache,\
+          (keyList)->generation, (keyList)->hashIndex,\
+          &((keyList)->item[0].key), sizeof((keyList)->item[0]),\
+          (keyList)->itemCount, (searchKey), (keyCount), (foundIndex)) :\
+      KeyArrayStringFindMany((keyList)->itemCount ?\
+          (const void*)&((keyList)->item[0].key) : NULL,\
+          sizeof((keyList)->item[0]), (keyList)->itemCount, (searchKey),\
+          (keyCount), (foundIndex)))
+
+  #define KEYARRAY_UINT_LIST_FINDMANY( keyList, searchKey, keyCount,\
+      foundIndex )\
+    (((keyList)->itemCount &&\
+        ((keyList)->lookupCache || (keyList)->searchIndex)) ?\
+      KeyArrayUintFindEach((keyList)->lookupCache, (keyList)->searchIndex,\
+          (keyList)->generation, &((keyList)->item[0].key),\
+          sizeof((keyList)->item[0]), sizeof((keyList)->item[0].key),\
+          (keyList)->itemCount, (searchKey), (keyCount), (foundIndex)) :\
+      KeyArrayUintFindMany((keyList)->itemCount ?\
+          (const void*)&((keyList)->item[0].key) : NULL,\
+          sizeof((keyList)->item[0]), sizeof((keyList)->item[0].key),\
+          (keyList)->itemCount, (searchKey), (keyCount), (foundIndex)))
+
+  /* Item comparisons and galloping searches, by item layout */
+  #define KEYARRAY_COMPARE_STRING_ITEMS( leftItem, rightItem )\
+    KEYARRAY_COMPARE_STRING((leftItem).key, (rightItem).key)
+
+  #define KEYARRAY_COMPARE_UINT_ITEMS( leftItem, rightItem )\
+    KEYARRAY_COMPARE_UINT((leftItem).key, (rightItem).key)
+
+  #define KEYARRAY_GALLOP_STRING_ITEMS( item, startIndex, count, keyItem )\
+    KeyArrayStringGallop(&((item)[0].key), sizeof(*(item)), (startIndex),\
+        (count), (keyItem).key)
+
+  #define KEYARRAY_GALLOP_PREFIXED_ITEMS( item, startIndex, count, keyItem )\
+    KeyArrayStringPrefixGallop(&((item)[0].keyPrefix), &((item)[0].key),\
+        sizeof(*(item)), (startIndex), (count), &((keyItem).keyPrefix),\
+        (keyItem).key)
+
+  #define KEYARRAY_GALLOP_UINT_ITEMS( item, startIndex, count, keyItem )\
+    ((sizeof((item)[0].key) == sizeof(unsigned)) ?\
+      KeyArrayUintGallop(&((item)[0].key), sizeof(*(item)), (startIndex),\
+          (count), (unsigned)(keyItem).key) :\
+      KeyArrayUintWideGallop(&((item)[0].key), sizeof(*(item)),\
+          sizeof((item)[0].key), (startIndex), (count),\
+          (uint64_t)(keyItem).key))
+
+  /* Set operations */
+  #define KEYARRAY_SET_UNION 0
+  #define KEYARRAY_SET_INTERSECT 1
+  #define KEYARRAY_SET_DIFFERENCE 2
+
+  /* Stand-ins for the data functions an operation never calls */
+  #define KEYARRAY_SET_NO_COPY( destData, sourceData ) 0
+  #define KEYARRAY_SET_NO_COMBINE( destData, leftData, rightData ) 0
+
+  /* Declares funcName, to merge two lists of items into a new list, in
+     one pass. Runs of keys in only one list are galloped over, and then
+     copied or skipped, depending on operation. */
+  #define KEYARRAY_DECLARE_SETOP( funcName, listType, keyKind,\
+      compareItems, gallopItems, operation, copyDataFunc, combineDataFunc,\
+      freeDataFunc )\
+  listType* funcName( listType* leftList, listType* rightList ) {\
+    listType* newList = NULL;\
+    listType##Item* leftItem;\
+    listType##Item* rightItem;\
+    listType##Item* sourceItem;\
+    listType##Item* item = NULL;\
+    listType##Item* shrunkItem;\
+    size_t leftCount;\
+    size_t rightCount;\
+    size_t leftIndex = 0;\
+    size_t rightIndex = 0;\
+    size_t runIndex = 0;\
+    size_t copyIndex;\
+    size_t reservedCount;\
+    size_t itemCount = 0;\
+    int result;\
+    \
+    if( !(leftList && rightList) ) {\
+      return NULL;\
+    }\
+    \
+    leftItem = leftList->item;\
+    rightItem = rightList->item;\
+    leftCount = leftItem ? leftList->itemCount : 0;\
+    rightCount = rightItem ? rightList->itemCount : 0;\
+    \
+    /* Size the new list for the largest possible result */\
+    if( (operation) == KEYARRAY_SET_UNION ) {\
+      reservedCount = leftCount + rightCount;\
+      if( reservedCount < leftCount ) {\
+        return NULL;\
+      }\
+    } else if( (operation) == KEYARRAY_SET_INTERSECT ) {\
+      reservedCount = (leftCount < rightCount) ? leftCount : rightCount;\
+    } else {\
+      reservedCount = leftCount;\
+    }\
+    \
+    if( reservedCount > (((size_t)-1) / sizeof(listType##Item)) ) {\
+      return NULL;\
+    }\
+    \
+    newList = (listType*)calloc(1, sizeof(listType));\
+    if( newList == NULL ) {\
+      goto ReturnError;\
+    }\
+    \
+    /* A list with no items is valid */\
+    if( reservedCount == 0 ) {\
+      return newList;\
+    }\
+    \
+    item = (listType##Item*)malloc(reservedCount * sizeof(listType##Item));\
+    if( item == NULL ) {\
+      goto ReturnError;\
+    }\
+    \
+    while( (leftIndex < leftCount) || (rightIndex < rightCount) ) {\
+      if( rightIndex == rightCount ) {\
+        result = -1;\
+        runIndex = leftCount;\
+      } else if( leftIndex == leftCount ) {\
+        result = 1;\
+        runIndex = rightCount;\
+      } else {\
+        result = compareItems(leftItem[leftIndex], rightItem[rightIndex]);\
+        if( result < 0 ) {\
+          runIndex = gallopItems(leftItem, leftIndex + 1, leftCount,\
+              rightItem[rightIndex]);\
+        } else if( result > 0 ) {\
+          runIndex = gallopItems(rightItem, rightIndex + 1, rightCount,\
+              leftItem[leftIndex]);\
+        }\
+      }\
+      \
+      if( result == 0 ) {\
+        /* Key in both lists: combine, unless taking the difference */\
+        if( (operation) != KEYARRAY_SET_DIFFERENCE ) {\
+          item[itemCount] = leftItem[leftIndex];\
+          if( KeyArray##keyKind##CopyKey(&(item[itemCount].key),\
+              leftItem[leftIndex].key) == 0 ) {\
+            goto ReturnError;\
+          }\
+          if( combineDataFunc(&(item[itemCount].data),\
+              &(leftItem[leftIndex].data),\
+              &(rightItem[rightIndex].data)) == 0 ) {\
+            KeyArray##keyKind##FreeKey( item[itemCount].key );\
+            goto ReturnError;\
+          }\
+          itemCount++;\
+        }\
+        leftIndex++;\
+        rightIndex++;\
+        continue;\
+      }\
+      \
+      if( result < 0 ) {\
+        sourceItem = leftItem;\
+        copyIndex = leftIndex;\
+        leftIndex = runIndex;\
+      } else {\
+        sourceItem = rightItem;\
+        copyIndex = rightIndex;\
+        rightIndex = runIndex;\
+      }\
+      \
+      /* Key run in one list: union copies it, difference copies it from\
+         the left list only, and intersect skips it */\
+      if( ((operation) == KEYARRAY_SET_INTERSECT) ||\
+          (((operation) == KEYARRAY_SET_DIFFERENCE) && (result > 0)) ) {\
+        continue;\
+      }\
+      \
+      for( ; copyIndex < runIndex; copyIndex++ ) {\
+        /* Direct copy by default, allowing copy function to be empty */\
+        item[itemCount] = sourceItem[copyIndex];\
+        if( KeyArray##keyKind##CopyKey(&(item[itemCount].key),\
+            sourceItem[copyIndex].key) == 0 ) {\
+          goto ReturnError;\
+        }\
+        if( copyDataFunc(&(item[itemCount].data),\
+            &(sourceItem[copyIndex].data)) == 0 ) {\
+          KeyArray##keyKind##FreeKey( item[itemCount].key );\
+          goto ReturnError;\
+        }\
+        itemCount++;\
+      }\
+    }\
+    \
+    /* Release the space the result did not need */\
+    if( itemCount == 0 ) {\
+      free( item );\
+      item = NULL;\
+      reservedCount = 0;\
+    } else if( itemCount < reservedCount ) {\
+      shrunkItem = (listType##Item*)realloc(item,\
+          itemCount * sizeof(listType##Item));\
+      if( shrunkItem ) {\
+        item = shrunkItem;\
+        reservedCount = itemCount;\
+      }\
+    }\
+    \
+    newList->reservedCount = reservedCount;\
+    newList->itemCount = itemCount;\
+    newList->item = item;\
+    \
+    return newList;\
+    \
+  ReturnError:\
+    if( item ) {\
+      for( copyIndex = 0; copyIndex < itemCount; copyIndex++ ) {\
+        freeDataFunc( &(item[copyIndex].data) );\
+        KeyArray##keyKind##FreeKey( item[copyIndex].key );\
+      }\
+      free( item );\
+      item = NULL;\
+    }\
+    \
+    if( newList ) {\
+      free( newList );\
+      newList = NULL;\
+    }\
+    \
+    return NULL;\
+  }
+
+  /* Declares funcName, the same as KEYARRAY_DECLARE_SETOP, for lists of
+     separate key and data arrays */
+  #define KEYARRAY_DECLARE_SETOP_SOA( funcName, listType, keyType, keyKind,\
+      compareKeys, operation, copyDataFunc, combineDataFunc,\
+      freeDataFunc )\
+  listType* funcName( listType* leftList, listType* rightList ) {\
+    listType* newList = NULL;\
+    keyType* leftKeys;\
+    keyType* rightKeys;\
+    keyType* sourceKeys;\
+    keyType* keys = NULL;\
+    keyType* shrunkKeys;\
+    listType##Data* leftData;\
+    listType##Data* rightData;\
+    listType##Data* sourceData;\
+    listType##Data* itemData = NULL;\
+    listType##Data* shrunkData;\
+    size_t leftCount;\
+    size_t rightCount;\
+    size_t leftIndex = 0;\
+    size_t rightIndex = 0;\
+    size_t runIndex = 0;\
+    size_t copyIndex;\
+    size_t reservedCount;\
+    size_t itemCount = 0;\
+    int result;\
+    \
+    if( !(leftList && rightList) ) {\
+      return NULL;\
+    }\
+    \
+    leftKeys = leftList->keys;\
+    leftData = leftList->data;\
+    rightKeys = rightList->keys;\
+    rightData = rightList->data;\
+    leftCount = (leftKeys && leftData) ? leftList->itemCount : 0;\
+    rightCount = (rightKeys && rightData) ? rightList->itemCount : 0;\
+    \
+    /* Size the new list for the largest possible result */\
+    if( (operation) == KEYARRAY_SET_UNION ) {\
+      reservedCount = leftCount + rightCount;\
+      if( reservedCount < leftCount ) {\
+        return NULL;\
+      }\
+    } else if( (operation) == KEYARRAY_SET_INTERSECT ) {\
+      reservedCount = (leftCount < rightCount) ? leftCount : rightCount;\
+    } else {\
+      reservedCount = leftCount;\
+    }\
+    \
+    if( (reservedCount > (((size_t)-1) / sizeof(keyType))) ||\
+        (reservedCount > (((size_t)-1) / sizeof(listType##Data))) ) {\
+      return NULL;\
+    }\
+    \
+    newList = (listType*)calloc(1, sizeof(listType));\
+    if( newList == NULL ) {\
+      goto ReturnError;\
+    }\
+    \
+    /* A list with no items is valid */\
+    if( reservedCount == 0 ) {\
+      return newList;\
+    }\
+    \
+    keys = (keyType*)malloc(reservedCount * sizeof(keyType));\
+    itemData = (listType##Data*)malloc(reservedCount *\
+        sizeof(listType##Data));\
+    if( (keys == NULL) || (itemData == NULL) ) {\
+      goto ReturnError;\
+    }\
+    \
+    while( (leftIndex < leftCount) || (rightIndex < rightCount) ) {\
+      if( rightIndex == rightCount ) {\
+        result = -1;\
+        runIndex = leftCount;\
+      } else if( leftIndex == leftCount ) {\
+        result = 1;\
+        runIndex = rightCount;\
+      } else {\
+        result = compareKeys(leftKeys[leftIndex], rightKeys[rightIndex]);\
+        if( result < 0 ) {\
+          runIndex = KeyArray##keyKind##Gallop(leftKeys, sizeof(keyType),\
+              leftIndex + 1, leftCount, rightKeys[rightIndex]);\
+        } else if( result > 0 ) {\
+          runIndex = KeyArray##keyKind##Gallop(rightKeys, sizeof(keyType),\
+              rightIndex + 1, rightCount, leftKeys[leftIndex]);\
+        }\
+      }\
+      \
+      if( result == 0 ) {\
+        /* Key in both lists: combine, unless taking the difference */\
+        if( (operation) != KEYARRAY_SET_DIFFERENCE ) {\
+          if( KeyArray##keyKind##CopyKey(&(keys[itemCount]),\
+              leftKeys[leftIndex]) == 0 ) {\
+            goto ReturnError;\
+          }\
+          itemData[itemCount] = leftData[leftIndex];\
+          if( combineDataFunc(&(itemData[itemCount]),\
+              &(leftData[leftIndex]), &(rightData[rightIndex])) == 0 ) {\
+            KeyArray##keyKind##FreeKey( keys[itemCount] );\
+            goto ReturnError;\
+          }\
+          itemCount++;\
+        }\
+        leftIndex++;\
+        rightIndex++;\
+        continue;\
+      }\
+      \
+      if( result < 0 ) {\
+        sourceKeys = leftKeys;\
+        sourceData = leftData;\
+        copyIndex = leftIndex;\
+        leftIndex = runIndex;\
+      } else {\
+        sourceKeys = rightKeys;\
+        sourceData = rightData;\
+        copyIndex = rightIndex;\
+        rightIndex = runIndex;\
+      }\
+      \
+      /* Key run in one list: union copies it, difference copies it from\
+         the left list only, and intersect skips it */\
+      if( ((operation) == KEYARRAY_SET_INTERSECT) ||\
+          (((operation) == KEYARRAY_SET_DIFFERENCE) && (result > 0)) ) {\
+        continue;\
+      }\
+      \
+      for( ; copyIndex < runIndex; copyIndex++ ) {\
+        if( KeyArray##keyKind##CopyKey(&(keys[itemCount]),\
+            sourceKeys[copyIndex]) == 0 ) {\
+          goto ReturnError;\
+        }\
+        \
+        /* Direct copy by default, allowing copy function to be empty */\
+        itemData[itemCount] = sourceData[copyIndex];\
+        if( copyDataFunc(&(itemData[itemCount]),\
+            &(sourceData[copyIndex])) == 0 ) {\
+          KeyArray##keyKind##FreeKey( keys[itemCount] );\
+          goto ReturnError;\
+        }\
+        itemCount++;\
+      }\
+    }\
+    \
+    /* Release the space the result did not need */\
+    if( itemCount == 0 ) {\
+      free( keys );\
+      keys = NULL;\
+      free( itemData );\
+      itemData = NULL;\
+      reservedCount = 0;\
+    } else if( itemCount < reservedCount ) {\
+      shrunkKeys = (keyType*)realloc(keys, itemCount * sizeof(keyType));\
+      shrunkData = (listType##Data*)realloc(itemData,\
+          itemCount * sizeof(listType##Data));\
+      if( shrunkKeys ) {\
+        keys = shrunkKeys;\
+      }\
+      if( shrunkData ) {\
+        itemData = shrunkData;\
+      }\
+      \
+      /* Either array may have shrunk, and both still hold itemCount */\
+      reservedCount = itemCount;\
+    }\
+    \
+    newList->reservedCount = reservedCount;\
+    newList->itemCount = itemCount;\
+    newList->keys = keys;\
+    newList->data = itemData;\
+    \
+    return newList;\
+    \
+  ReturnError:\
+    for( copyIndex = 0; copyIndex < itemCount; copyIndex++ ) {\
+      freeDataFunc( &(itemData[copyIndex]) );\
+      KeyArray##keyKind##FreeKey( keys[copyIndex] );\
+    }\
+    \
+    if( keys ) {\
+      free( keys );\
+      keys = NULL;\
+    }\
+    \
+    if( itemData ) {\
+      free( itemData );\
+      itemData = NULL;\
+    }\
+    \
+    if( newList ) {\
+      free( newList );\
+      newList = NULL;\
+    }\
+    \
+    return NULL;\
+  }
+
+/*
+ * =================================
+ *  String Key Array implementation
+ * =================================
+ */
+
+  #define DECLARE_STRING_KEYARRAY_TYPES(\
+      typeName, dataType )\
+  typedef struct typeName##Item {\
+    char* key;\
+    dataType data;\
+  } typeName##Item;\
+  \
+  typedef struct typeName {\
+    size_t reservedCount;\
+    size_t itemCount;\
+    typeName##Item* item;\
+    size_t generation;\
+    KeyArrayKeyArena* keyArena;\
+    KeyArrayStringHashIndex* hashIndex;\
+    KeyArrayBloomFilter* bloomFilter;\
+    KeyArrayLookupCache* lookupCache;\
+    size_t fingerIndex;\
+    KEYARRAY_STATS_FIELD\
+  } typeName;
+
+  #define DECLARE_STRING_KEYARRAY_CREATE( funcName, listType )\
+  listType* funcName( size_t reserveCount ) {\
+      listType* newKeyArray = NULL;\
+    \
+    newKeyArray = (listType*)calloc(1, sizeof(listType));\
+    if( newKeyArray == NULL ) {\
+      goto ReturnError;\
+    }\
+    \
+    if( reserveCount ) {\
+      newKeyArray->item =\
+        (listType##Item*)calloc(reserveCount, sizeof(listType##Item));\
+      if( newKeyArray->item == NULL ) {\
+        goto ReturnError;\
+      }\
+      \
+      newKeyArray->reservedCount = reserveCount;\
+    }\
+    return newKeyArray;\
+  \
+  ReturnError:\
+    if( newKeyArray ) {\
+      if( newKeyArray->item ) {\
+        free( newKeyArray->item );\
+        newKeyArray->item = NULL;\
+      }\
+      free( newKeyArray );\
+      newKeyArray = NULL;\
+    }\
+    return NULL;\
+  }
+
+  /* The bloom filter and lookup cache, which only the default layout
+     has */
+  #define KEYARRAY_STRING_FREE_LOOKUPS( keyList )\
+  KeyArrayFreeBloomFilter( &((keyList)->bloomFilter) );\
+  KeyArrayFreeLookupCache( &((keyList)->lookupCache) );
+
+  #define DECLARE_STRING_KEYARRAY_FREE( funcName, listType, freeDataFunc )\
+  KEYARRAY_DECLARE_STRING_FREE( funcName, listType, freeDataFunc,\
+      KEYARRAY_STRING_FREE_LOOKUPS )
+
+  /* Frees keys, data, the key arena, and the hash index, then calls
+     freeLookups to free what else the layout has */
+  #define KEYARRAY_DECLARE_STRING_FREE( funcName, listType, freeDataFunc,\
+      freeLookups )\
+  void funcName( listType** keyList ) {\
+    size_t index;\
+    size_t itemCount;\
+    \
+    if( keyList && (*keyList) ) {\
+      itemCount = (*keyList)->itemCount;\
+      for( index = 0; index < itemCount; index++ ) {\
+        if( (*keyList)->item[index].key && ((*keyList)->keyArena == NULL) ) {\
+          free( (*keyList)->item[index].key );\
+        }\
+        freeDataFunc( &((*keyList)->item[index].data) );\
+      }\
+      \
+      /* Arena keys are released a chunk at a time */\
+      KeyArrayArenaRelease( &((*keyList)->keyArena) );\
+      KeyArrayStringFreeHashIndex( &((*keyList)->hashIndex) );\
+      freeLookups( (*keyList) )\
+      \
+      if( (*keyList)->item ) {\
+        free( (*keyList)->item );\
+      }\
+      free( (*keyList) );\
+      (*keyList) = NULL;\
+    }\
+  }
+
+  #define DECLARE_STRING_KEYARRAY_INSERT( funcName, listType, dataType )\
+  DECLARE_STRING_KEYARRAY_INSERT_GROWTH( funcName, listType, dataType,\
+      KEYARRAY_GROW_DEFAULT )
+
+  #define KEYARRAY_DECLARE_STRING_INSERT_GROWTH( funcName, listType,\
+      dataType, growFunc )\
+  int funcName( listType* keyList, char* key, dataType* data ) {\
+    size_t insertIndex;\
+    char* newStrKey;\
+    size_t keyLen;\
+    size_t reservedCount;\
+    size_t itemCount;\
+    listType##Item* item;\
+    \
+    if( !(keyList && key && data) ) {\
+      return 0;\
+    }\
+    \
+    keyLen = strlen(key);\
+    if( keyLen == 0 ) {\
+      return 0;\
+    }\
+    \
+    /* Grow list, if necessary */\
+    reservedCount = keyList->reservedCount;\
+    itemCount = keyList->itemCount;\
+    item = keyList->item;\
+    \
+    if( itemCount == reservedCount ) {\
+      reservedCount = growFunc(reservedCount, itemCount + 1);\
+      if( (reservedCount <= itemCount) ||\
+          (reservedCount > (((size_t)-1) / sizeof(listType##Item))) ) {\
+        return 0;\
+      }\
+      \
+      item = (listType##Item*)realloc(item,\
+          reservedCount * sizeof(listType##Item));\
+      if( item == NULL ) {\
+        return 0;\
+      }\
+      KEYARRAY_STATS_REALLOC();\
+      keyList->reservedCount = reservedCount;\
+      keyList->item = item;\
+    }\
+    \
+    /* Search for insert position, from the last one */\
+    insertIndex = KeyArrayStringFingerBound(&(item[0].key),\
+        sizeof(listType##Item), keyList->fingerIndex, itemCount, key);\
+    if( (insertIndex < itemCount) &&\
+        (strcmp(item[insertIndex].key, key) == 0) ) {\
+      return 0;\
+    }\
+    \
+    /* Make room in the hash index first, so that the list is unchanged\
+       on failure */\
+    if( keyList->hashIndex &&\
+        (KeyArrayStringHashReserve(keyList->hashIndex, itemCount + 1) == 0) ) {\
+      return 0;\
+    }\
+    \
+    /* Attempt to allocate key string before going further */\
+    newStrKey = KeyArrayDuplicateKey(keyList->keyArena, key, keyLen);\
+    if( newStrKey == NULL ) {\
+      return 0;\
+    }\
+    \
+    /* Move data past insertion point up, if necessary */\
+    KEYARRAY_STATS_MOVE( (itemCount - insertIndex) * sizeof(listType##Item) );\
+    memmove( &(item[insertIndex + 1]), &(item[insertIndex]),\
+        (itemCount - insertIndex) * sizeof(listType##Item) );\
+    \
+    /* Insert item */\
+    item[insertIndex].key = newStrKey;\
+    if( data ) {\
+      memcpy( &(item[insertIndex].data), data, sizeof(dataType) );\
+    }\
+    \
+    keyList->itemCount++;\
+    keyList->generation++;\
+    keyList->fingerIndex = insertIndex;\
+    \
+    if( keyList->hashIndex ) {\
+      KeyArrayStringHashInsert( keyList->hashIndex, newStrKey, insertIndex,\
+          itemCount );\
+    }\
+    if( keyList->bloomFilter ) {\
+      KeyArrayStringBloomInsert( keyList->bloomFilter, newStrKey,\
+          &(item[0].key), sizeof(listType##Item), keyList->itemCount );\
+    }\
+    \
+    return 1;\
+  }
+
+  #define DECLARE_STRING_KEYARRAY_RESERVE( funcName, listType )\
+  int funcName( listType* keyList, size_t reserveCount ) {\
+    listType##Item* item;\
+    \
+    if( keyList == NULL ) {\
+      return 0;\
+    }\
+    \
+    if( reserveCount <= keyList->reservedCount ) {\
+      return 1;\
+    }\
+    \
+    if( reserveCount > (((size_t)-1) / sizeof(listType##Item)) ) {\
+      return 0;\
+    }\
+    \
+    item = (listType##Item*)realloc(keyList->item,\
+        reserveCount * sizeof(listType##Item));\
+    if( item == NULL ) {\
+      return 0;\
+    }\
+    \
+    keyList->item = item;\
+    keyList->reservedCount = reserveCount;\
+    \
+    return 1;\
+  }
+
+  #define KEYARRAY_DECLARE_STRING_REMOVE( funcName, listType, freeDataFunc )\
+  void funcName( listType* keyList, char* key ) {\
+    size_t leftIndex;\
+    size_t rightIndex;\
+    size_t removeIndex;\
+    int result;\
+    size_t itemCount;\
+    listType##Item* item;\
+    \
+    if( !(keyList && keyList->item && key && (*key)) ) {\
+      return;\
+    }\
+    \
+    itemCount = keyList->itemCount;\
+    item = keyList->item;\
+    \
+    /* Search for insert position */\
+    leftIndex = 0;\
+    rightIndex = itemCount;\
+    removeIndex = itemCount / 2;\
+    \
+    while( leftIndex < rightIndex ) {\
+      result = strcmp(item[removeIndex].key, key);\
+      KEYARRAY_STATS_COMPARE( 1 );\
+      \
+      if( result == 0 ) {\
+        if( keyList->hashIndex ) {\
+          KeyArrayStringHashRemove( keyList->hashIndex, key, removeIndex,\
+              itemCount );\
+        }\
+        freeDataFunc( &(item[removeIndex].data) );\
+        KeyArrayReleaseKey( keyList->keyArena, item[removeIndex].key );\
+        item[removeIndex].key = NULL;\
+        \
+        if( itemCount ) {\
+          itemCount--;\
+          \
+          KEYARRAY_STATS_MOVE( (itemCount - removeIndex) *\
+              sizeof(listType##Item) );\
+          memmove( &(item[removeIndex]), &(item[removeIndex + 1]),\
+            (itemCount - removeIndex) * sizeof(listType##Item) );\
+          \
+          keyList->itemCount = itemCount;\
+          keyList->generation++;\
+        }\
+        \
+        memset( &(item[itemCount]), 0, sizeof(listType##Item) );\
+        \
+        if( KeyArrayArenaNeedsCompact(keyList->keyArena) ) {\
+          KeyArrayArenaCompact( keyList->keyArena, &(item[0].key),\
+              sizeof(listType##Item), itemCount );\
+        }\
+        \
+        return;\
+      }\
+      \
+      if( result > 0 ) {\
+        rightIndex = removeIndex;\
+      } else {\
+        leftIndex = removeIndex + 1;\
+      }\
+      \
+      removeIndex = (leftIndex + rightIndex) / 2;\
+    }\
+  }
+
+  #define KEYARRAY_DECLARE_STRING_RETRIEVE( funcName, listType, dataType )\
+  int funcName( listType* keyList, char* key, dataType* destData ) {\
+    size_t foundIndex;\
+    \
+    if( !(keyList && keyList->item && key && (*key) && destData) ) {\
+      return 0;\
+    }\
+    \
+    foundIndex = KEYARRAY_STRING_LIST_FIND(keyList, key);\
+    if( foundIndex == ((size_t)-1) ) {\
+      return 0;\
+    }\
+    \
+    memcpy( destData, &(keyList->item[foundIndex].data), sizeof(dataType) );\
+    return 1;\
+  }
+
+  #define KEYARRAY_DECLARE_STRING_MODIFY( funcName, listType, dataType )\
+  int funcName( listType* keyList, char* key, dataType* sourceData ) {\
+    size_t foundIndex;\
+    \
+    if( !(keyList && keyList->item && key && (*key) && sourceData) ) {\
+      return 0;\
+    }\
+    \
+    foundIndex = KEYARRAY_STRING_LIST_FIND(keyList, key);\
+    if( foundIndex == ((size_t)-1) ) {\
+      return 0;\
+    }\
+    \
+    memcpy( &(keyList->item[foundIndex].data), sourceData,\
+        sizeof(dataType) );\
+    return 1;\
+  }
+
+  #define KEYARRAY_DECLARE_STRING_FINDINDEX( funcName, listType )\
+  size_t funcName( listType* keyList, char* key ) {\
+    if( !(keyList && keyList->item && key && (*key)) ) {\
+      return ((size_t)-1);\
+    }\
+    \
+    return KEYARRAY_STRING_LIST_FIND(keyList, key);\
+  }
+
+  #define KEYARRAY_DECLARE_STRING_GETPTR( funcName, listType, dataType )\
+  dataType* funcName( listType* keyList, char* key ) {\
+    size_t foundIndex;\
+    \
+    if( !(keyList && keyList->item && key && (*key)) ) {\
+      return NULL;\
+    }\
+    \
+    foundIndex = KEYARRAY_STRING_LIST_FIND(keyList, key);\
+    if( foundIndex == ((size_t)-1) ) {\
+      return NULL;\
+    }\
+    \
+    return &(keyList->item[foundIndex].data);\
+  }
+
+  #define KEYARRAY_DECLARE_STRING_UPDATE( funcName, listType, dataType,\
+      updateDataFunc )\
+  int funcName( listType* keyList, char* key, dataType* sourceData ) {\
+    size_t foundIndex;\
+    \
+    if( !(keyList && keyList->item && key && (*key)) ) {\
+      return 0;\
+    }\
+    \
+    foundIndex = KEYARRAY_STRING_LIST_FIND(keyList, key);\
+    if( foundIndex == ((size_t)-1) ) {\
+      return 0;\
+    }\
+    \
+    updateDataFunc( &(keyList->item[foundIndex].data), sourceData );\
+    \
+    return 1;\
+  }
+
+  #define DECLARE_STRING_KEYARRAY_UPSERT( funcName, listType, dataType )\
+  DECLARE_STRING_KEYARRAY_UPSERT_GROWTH( funcName, listType, dataType,\
+      KEYARRAY_GROW_DEFAULT )
+
+  #define KEYARRAY_DECLARE_STRING_UPSERT_GROWTH( funcName, listType,\
+      dataType, growFunc )\
+  dataType* funcName( listType* keyList, char* key, dataType* data,\
+      int* inserted ) {\
+    size_t insertIndex = 0;\
+    char* newStrKey;\
+    size_t keyLen;\
+    size_t reservedCount;\
+    size_t itemCount;\
+    listType##Item* item;\
+    \
+    if( inserted ) {\
+      (*inserted) = 0;\
+    }\
+    \
+    if( !(keyList && key && data) ) {\
+      return NULL;\
+    }\
+    \
+    keyLen = strlen(key);\
+    if( keyLen == 0 ) {\
+      return NULL;\
+    }\
+    \
+    reservedCount = keyList->reservedCount;\
+    itemCount = keyList->itemCount;\
+    item = keyList->item;\
+    \
+    /* One search finds the key, or where to insert it, from the last\
+       position used. The hash index finds existing keys without a\
+       bound search. */\
+    if( item && keyList->hashIndex ) {\
+      insertIndex = KeyArrayStringHashFind(keyList->hashIndex,\
+          &(item[0].key), sizeof(listType##Item), key);\
+      if( insertIndex != ((size_t)-1) ) {\
+        keyList->fingerIndex = insertIndex;\
+        return &(item[insertIndex].data);\
+      }\
+      insertIndex = KeyArrayStringFingerBound(&(item[0].key),\
+          sizeof(listType##Item), keyList->fingerIndex, itemCount, key);\
+    } else if( item ) {\
+      insertIndex = KeyArrayStringFingerBound(&(item[0].key),\
+          sizeof(listType##Item), keyList->fingerIndex, itemCount, key);\
+      if( (insertIndex < itemCount) &&\
+          (strcmp(item[insertIndex].key, key) == 0) ) {\
+        keyList->fingerIndex = insertIndex;\
+        return &(item[insertIndex].data);\
+      }\
+    }\
+    \
+    /* Grow list, if necessary */\
+    if( itemCount == reservedCount ) {\
+      reservedCount = growFunc(reservedCount, itemCount + 1);\
+      if( (reservedCount <= itemCount) ||\
+          (reservedCount > (((size_t)-1) / sizeof(listType##Item))) ) {\
+        return NULL;\
+      }\
+      \
+      item = (listType##Item*)realloc(item,\
+          reservedCount * sizeof(listType##Item));\
+      if( item == NULL ) {\
+        return NULL;\
+      }\
+      KEYARRAY_STATS_REALLOC();\
+      keyList->reservedCount = reservedCount;\
+      keyList->item = item;\
+    }\
+    \
+    /* Make room in the hash index first, so that the list is unchanged\
+       on failure */\
+    if( keyList->hashIndex &&\
+        (KeyArrayStringHashReserve(keyList->hashIndex, itemCount + 1) == 0) ) {\
+      return NULL;\
+    }\
+    \
+    newStrKey = KeyArrayDuplicateKey(keyList->keyArena, key, keyLen);\
+    if( newStrKey == NULL ) {\
+      return NULL;\
+    }\
+    \
+    /* Move data past insertion point up, if necessary */\
+    KEYARRAY_STATS_MOVE( (itemCount - insertIndex) * sizeof(listType##Item) );\
+    memmove( &(item[insertIndex + 1]), &(item[insertIndex]),\
+        (itemCount - insertIndex) * sizeof(listType##Item) );\
+    \
+    item[insertIndex].key = newStrKey;\
+    memcpy( &(item[insertIndex].data), data, sizeof(dataType) );\
+    \
+    keyList->itemCount++;\
+    keyList->generation++;\
+    keyList->fingerIndex = insertIndex;\
+    \
+    if( keyList->hashIndex ) {\
+      KeyArrayStringHashInsert( keyList->hashIndex, newStrKey, insertIndex,\
+          itemCount );\
+    }\
+    if( keyList->bloomFilter ) {\
+      KeyArrayStringBloomInsert( keyList->bloomFilter, newStrKey,\
+          &(item[0].key), sizeof(listType##Item), keyList->itemCount );\
+    }\
+    \
+    if( inserted ) {\
+      (*inserted) = 1;\
+    }\
+    \
+    return &(item[insertIndex].data);\
+  }
+
+  #define KEYARRAY_DECLARE_STRING_FINDINDEXMANY( funcName, listType )\
+  size_t funcName( listType* keyList, char** key, size_t keyCount,\
+      size_t* foundIndex ) {\
+    if( !(keyList && key && foundIndex) ) {\
+      return 0;\
+    }\
+    \
+    return KEYARRAY_STRING_LIST_FINDMANY(keyList, key, keyCount,\
+        foundIndex);\
+  }
+
+  #define KEYARRAY_DECLARE_STRING_RETRIEVEMANY( funcName, listType,\
+      dataType )\
+  size_t funcName( listType* keyList, char** key, size_t keyCount,\
+      dataType* destData, int* found ) {\
+    size_t foundIndex[KEYARRAY_BATCH_WIDTH];\
+    size_t batchIndex;\
+    size_t laneCount;\
+    size_t laneIndex;\
+    size_t foundCount = 0;\
+    \
+    if( !(keyList && key && destData) ) {\
+      return 0;\
+    }\
+    \
+    for( batchIndex = 0; batchIndex < keyCount; batchIndex += laneCount ) {\
+      laneCount = keyCount - batchIndex;\
+      if( laneCount > KEYARRAY_BATCH_WIDTH ) {\
+        laneCount = KEYARRAY_BATCH_WIDTH;\
+      }\
+      \
+      foundCount += KEYARRAY_STRING_LIST_FINDMANY(keyList,\
+          &(key[batchIndex]), laneCount, foundIndex);\
+      \
+      for( laneIndex = 0; laneIndex < laneCount; laneIndex++ ) {\
+        if( foundIndex[laneIndex] != ((size_t)-1) ) {\
+          memcpy( &(destData[batchIndex + laneIndex]),\
+              &(keyList->item[foundIndex[laneIndex]].data),\
+              sizeof(dataType) );\
+        }\
+        if( found ) {\
+          found[batchIndex + laneIndex] =\
+              (foundIndex[laneIndex] != ((size_t)-1));\
+        }\
+      }\
+    }\
+    \
+    return foundCount;\
+  }
+
+  /* Operations timed by KEYARRAY_STATS */
+  #if defined(KEYARRAY_STATS)
+
+  #define DECLARE_STRING_KEYARRAY_INSERT_GROWTH( funcName, listType,\
+      dataType, growFunc )\
+  KEYARRAY_DECLARE_TIMED( funcName, listType, KEYARRAY_STATS_INSERT, int,\
+      ( listType* keyList, char* key, dataType* data ),\
+      ( keyList, key, data ),\
+      KEYARRAY_DECLARE_STRING_INSERT_GROWTH( funcName##Untimed, listType,\
+      dataType, growFunc ) )
+
+  #define DECLARE_STRING_KEYARRAY_REMOVE( funcName, listType, freeDataFunc )\
+  KEYARRAY_DECLARE_TIMED_VOID( funcName, listType, KEYARRAY_STATS_REMOVE,\
+      ( listType* keyList, char* key ),\
+      ( keyList, key ),\
+      KEYARRAY_DECLARE_STRING_REMOVE( funcName##Untimed, listType,\
+      freeDataFunc ) )
+
+  #define DECLARE_STRING_KEYARRAY_RETRIEVE( funcName, listType, dataType )\
+  KEYARRAY_DECLARE_TIMED( funcName, listType, KEYARRAY_STATS_RETRIEVE, int,\
+      ( listType* keyList, char* key, dataType* destData ),\
+      ( keyList, key, destData ),\
+      KEYARRAY_DECLARE_STRING_RETRIEVE( funcName##Untimed, listType,\
+      dataType ) )
+
+  #define DECLARE_STRING_KEYARRAY_MODIFY( funcName, listType, dataType )\
+  KEYARRAY_DECLARE_TIMED( funcName, listType, KEYARRAY_STATS_MODIFY, int,\
+      ( listType* keyList, char* key, dataType* sourceData ),\
+      ( keyList, key, sourceData ),\
+      KEYARRAY_DECLARE_STRING_MODIFY( funcName##Untimed, listType,\
+      dataType ) )
+
+  #define DECLARE_STRING_KEYARRAY_FINDINDEX_SIZE( funcName, listType )\
+  KEYARRAY_DECLARE_TIMED( funcName, listType, KEYARRAY_STATS_FINDINDEX,\
+      size_t, ( listType* keyList, char* key ),\
+      ( keyList, key ),\
+      KEYARRAY_DECLARE_STRING_FINDINDEX( funcName##Untimed, listType ) )
+
+
+  #define DECLARE_STRING_KEYARRAY_GETPTR( funcName, listType, dataType )\
+  KEYARRAY_DECLARE_TIMED( funcName, listType, KEYARRAY_STATS_RETRIEVE,\
+      dataType*, ( listType* keyList, char* key ),\
+      ( keyList, key ),\
+      KEYARRAY_DECLARE_STRING_GETPTR( funcName##Untimed, listType,\
+      dataType ) )
+
+  #define DECLARE_STRING_KEYARRAY_UPDATE( funcName, listType, dataType,\
+      updateDataFunc )\
+  KEYARRAY_DECLARE_TIMED( funcName, listType, KEYARRAY_STATS_MODIFY, int,\
+      ( listType* keyList, char* key, dataType* sourceData ),\
+      ( keyList, key, sourceData ),\
+      KEYARRAY_DECLARE_STRING_UPDATE( funcName##Untimed, listType,\
+      dataType, updateDataFunc ) )
+
+  #define DECLARE_STRING_KEYARRAY_UPSERT_GROWTH( funcName, listType,\
+      dataType, growFunc )\
+  KEYARRAY_DECLARE_TIMED( funcName, listType, KEYARRAY_STATS_INSERT,\
+      dataType*, ( listType* keyList, char* key, dataType* data,\
+      int* inserted ),\
+      ( keyList, key, data, inserted ),\
+      KEYARRAY_DECLARE_STRING_UPSERT_GROWTH( funcName##Untimed, listType,\
+      dataType, growFunc ) )
+
+  #define DECLARE_STRING_KEYARRAY_FINDINDEXMANY( funcName, listType )\
+  KEYARRAY_DECLARE_TIMED( funcName, listType, KEYARRAY_STATS_FINDINDEX,\
+      size_t, ( listType* keyList, char** key, size_t keyCount,\
+      size_t* foundIndex ),\
+      ( keyList, key, keyCount, foundIndex ),\
+      KEYARRAY_DECLARE_STRING_FINDINDEXMANY( funcName##Untimed, listType ) )
+
+  #define DECLARE_STRING_KEYARRAY_RETRIEVEMANY( funcName, listType,\
+      dataType )\
+  KEYARRAY_DECLARE_TIMED( funcName, listType, KEYARRAY_STATS_RETRIEVE,\
+      size_t, ( listType* keyList, char** key, size_t keyCount,\
+      dataType* destData, int* found ),\
+      ( keyList, key, keyCount, destData, found ),\
+      KEYARRAY_DECLARE_STRING_RETRIEVEMANY( funcName##Untimed, listType,\
+      dataType ) )
+
+  #else
+
+  #define DECLARE_STRING_KEYARRAY_INSERT_GROWTH\
+    KEYARRAY_DECLARE_STRING_INSERT_GROWTH
+  #define DECLARE_STRING_KEYARRAY_REMOVE KEYARRAY_DECLARE_STRING_REMOVE
+  #define DECLARE_STRING_KEYARRAY_RETRIEVE KEYARRAY_DECLARE_STRING_RETRIEVE
+  #define DECLARE_STRING_KEYARRAY_MODIFY KEYARRAY_DECLARE_STRING_MODIFY
+  #define DECLARE_STRING_KEYARRAY_FINDINDEX_SIZE\
+    KEYARRAY_DECLARE_STRING_FINDINDEX
+  #define DECLARE_STRING_KEYARRAY_GETPTR KEYARRAY_DECLARE_STRING_GETPTR
+  #define DECLARE_STRING_KEYARRAY_UPDATE KEYARRAY_DECLARE_STRING_UPDATE
+  #define DECLARE_STRING_KEYARRAY_UPSERT_GROWTH\
+    KEYARRAY_DECLARE_STRING_UPSERT_GROWTH
+  #define DECLARE_STRING_KEYARRAY_FINDINDEXMANY\
+    KEYARRAY_DECLARE_STRING_FINDINDEXMANY
+  #define DECLARE_STRING_KEYARRAY_RETRIEVEMANY\
+    KEYARRAY_DECLARE_STRING_RETRIEVEMANY
+
+  #endif
+
+  #define DECLARE_STRING_KEYARRAY_FINDINDEX( funcName, listType )\
+  KEYARRAY_DECLARE_FINDINDEX_INT( funcName, listType, listType, char*,\
+      DECLARE_STRING_KEYARRAY_FINDINDEX_SIZE )
+
+  #define DECLARE_STRING_KEYARRAY_STATS( funcName, listType )\
+  KEYARRAY_DECLARE_STATS( funcName, listType )
+
+  #define DECLARE_STRING_KEYARRAY_LOOKUPCACHE( funcName, listType )\
+  KEYARRAY_DECLARE_LOOKUPCACHE( funcName, listType )
+
+  #define DECLARE_STRING_KEYARRAY_CACHECOUNTS( funcName, listType )\
+  KEYARRAY_DECLARE_CACHECOUNTS( funcName, listType )
+
+  #define DECLARE_STRING_KEYARRAY_LOWERBOUND( funcName, listType )\
+  size_t funcName( listType* keyList, char* key ) {\
+    if( !(keyList && keyList->item && key) ) {\
+      return 0;\
+    }\
+    \
+    return KeyArrayStringBound(&(keyList->item[0].key),\
+        sizeof(listType##Item), keyList->itemCount, key, 0);\
+  }
+
+  #define DECLARE_STRING_KEYARRAY_UPPERBOUND( funcName, listType )\
+  size_t funcName( listType* keyList, char* key ) {\
+    if( !(keyList && keyList->item && key) ) {\
+      return 0;\
+    }\
+    \
+    return KeyArrayStringBound(&(keyList->item[0].key),\
+        sizeof(listType##Item), keyList->itemCount, key, 1);\
+  }
+
+  #define DECLARE_STRING_KEYARRAY_RANGE( funcName, listType )\
+  size_t funcName( listType* keyList, char* firstKey,\
+      char* lastKey, size_t* beginIndex ) {\
+    size_t endIndex;\
+    \
+    if( !(keyList && beginIndex) ) {\
+      return 0;\
+    }\
+    \
+    (*beginIndex) = 0;\
+    if( !(keyList->item && firstKey && lastKey) ) {\
+      return 0;\
+    }\
+    \
+    (*beginIndex) = KeyArrayStringBound(&(keyList->item[0].key),\
+        sizeof(listType##Item), keyList->itemCount, firstKey, 0);\
+    \
+    /* The last key can only be at, or after, the first key */\
+    endIndex = (*beginIndex) + KeyArrayStringBound(\
+        &(keyList->item[(*beginIndex)].key), sizeof(listType##Item),\
+        (keyList->itemCount - (*beginIndex)), lastKey, 1);\
+    \
+    return endIndex - (*beginIndex);\
+  }
+
+  #define DECLARE_STRING_KEYARRAY_KEYARENA( funcName, listType )\
+  int funcName( listType* keyList, int enable ) {\
+    KeyArrayKeyArena* keyArena;\
+    \
+    if( keyList == NULL ) {\
+      return 0;\
+    }\
+    \
+    if( enable == 0 ) {\
+      if( keyList->keyArena ) {\
+        /* Give each key its own allocation again */\
+        if( keyList->itemCount &&\
+            (KeyArrayArenaDisownKeys(&(keyList->item[0].key),\
+            sizeof(listType##Item), keyList->itemCount) == 0) ) {\
+          return 0;\
+        }\
+        KeyArrayArenaRelease( &(keyList->keyArena) );\
+      }\
+      return 1;\
+    }\
+    \
+    if( keyList->keyArena ) {\
+      return 1;\
+    }\
+    \
+    keyArena = (KeyArrayKeyArena*)calloc(1, sizeof(KeyArrayKeyArena));\
+    if( keyArena == NULL ) {\
+      return 0;\
+    }\
+    \
+    /* Move the existing keys into the arena */\
+    if( keyList->itemCount && (KeyArrayArenaAdoptKeys(keyArena,\
+        &(keyList->item[0].key), sizeof(listType##Item),\
+        keyList->itemCount) == 0) ) {\
+      KeyArrayArenaRelease( &keyArena );\
+      return 0;\
+    }\
+    \
+    keyList->keyArena = keyArena;\
+    \
+    return 1;\
+  }
+
+  #define DECLARE_STRING_KEYARRAY_HASHINDEX( funcName, listType )\
+  int funcName( listType* keyList, int enable ) {\
+    KeyArrayStringHashIndex* hashIndex;\
+    \
+    if( keyList == NULL ) {\
+      return 0;\
+    }\
+    \
+    if( enable == 0 ) {\
+      KeyArrayStringFreeHashIndex( &(keyList->hashIndex) );\
+      return 1;\
+    }\
+    \
+    if( keyList->hashIndex ) {\
+      return 1;\
+    }\
+    \
+    hashIndex = (KeyArrayStringHashIndex*)calloc(1,\
+        sizeof(KeyArrayStringHashIndex));\
+    if( hashIndex == NULL ) {\
+      return 0;\
+    }\
+    \
+    if( KeyArrayStringHashReserve(hashIndex, keyList->itemCount) == 0 ) {\
+      KeyArrayStringFreeHashIndex( &hashIndex );\
+      return 0;\
+    }\
+    \
+    if( keyList->itemCount ) {\
+      KeyArrayStringHashRefill( hashIndex, &(keyList->item[0].key),\
+          sizeof(listType##Item), keyList->itemCount );\
+    }\
+    \
+    keyList->hashIndex = hashIndex;\
+    \
+    return 1;\
+  }
+
+  #define DECLARE_STRING_KEYARRAY_BLOOMFILTER( funcName, listType )\
+  int funcName( listType* keyList, int enable ) {\
+    KeyArrayBloomFilter* bloomFilter;\
+    \
+    if( keyList == NULL ) {\
+      return 0;\
+    }\
+    \
+    if( enable == 0 ) {\
+      KeyArrayFreeBloomFilter( &(keyList->bloomFilter) );\
+      return 1;\
+    }\
+    \
+    if( keyList->bloomFilter ) {\
+      return 1;\
+    }\
+    \
+    bloomFilter = (KeyArrayBloomFilter*)calloc(1,\
+        sizeof(KeyArrayBloomFilter));\
+    if( bloomFilter == NULL ) {\
+      return 0;\
+    }\
+    \
+    if( KeyArrayStringBloomRefill(bloomFilter, keyList->itemCount ?\
+        (const void*)&(keyList->item[0].key) : NULL,\
+        sizeof(listType##Item), keyList->itemCount) == 0 ) {\
+      KeyArrayFreeBloomFilter( &bloomFilter );\
+      return 0;\
+    }\
+    \
+    keyList->bloomFilter = bloomFilter;\
+    \
+    return 1;\
+  }
+
+  #define DECLARE_STRING_KEYARRAY_RELEASEUNUSED( funcName, listType )\
+  void funcName( listType* keyList ) {\
+    listType##Item* item;\
+    \
+    if( keyList == NULL ) {\
+      return;\
+    }\
+    \
+    if( keyList->item && keyList->itemCount ) {\
+      /* Resize to remove reserved space*/\
+      item = (listType##Item*)realloc(keyList->item,\
+        keyList->itemCount * sizeof(listType##Item));\
+      if( item ) {\
+        keyList->item = item;\
+        keyList->reservedCount = keyList->itemCount;\
+      }\
+      \
+      /* Pack the live keys into one chunk */\
+      if( keyList->keyArena ) {\
+        KeyArrayArenaCompact( keyList->keyArena, &(keyList->item[0].key),\
+            sizeof(listType##Item), keyList->itemCount );\
+      }\
+    } else {\
+      /* Deallocate */\
+      keyList->reservedCount = 0;\
+      keyList->itemCount = 0;\
+      if( keyList->item ) {\
+        free( keyList->item );\
+        keyList->item = NULL;\
+      }\
+      \
+      if( keyList->keyArena ) {\
+        KeyArrayArenaCompact( keyList->keyArena, NULL,\
+            sizeof(listType##Item), 0 );\
+      }\
+    }\
+  }
+
+  #define DECLARE_STRING_KEYARRAY_COPY( funcName, listType, dataType,\
+      copyDataFunc, freeDataFunc )\
+  listType* funcName( listType* sourceList ) {\
+    listType* newCopy = NULL;\
+    listType##Item* sourceItem = NULL;\
+    size_t reservedCount = 0;\
+    size_t itemCount = 0;\
+    size_t copiedCount = 0;\
+    char* keyCopy;\
+    size_t keyLen;\
+    size_t index;\
+    \
+    if( sourceList == NULL ) {\
+      return NULL;\
+    }\
+    \
+    /* Attempt to allocate list object */\
+    newCopy = (listType*)calloc(1, sizeof(listType));\
+    if( newCopy == NULL ) {\
+      goto ReturnError;\
+    }\
+    \
+    /* Initialize important variables */\
+    reservedCount = sourceList->reservedCount;\
+    itemCount = sourceList->itemCount;\
+    sourceItem = sourceList->item;\
+    \
+    /* A list with no items is valid */\
+    if( !(reservedCount && itemCount && sourceItem) ) {\
+      if( sourceList->keyArena ) {\
+        newCopy->keyArena = KeyArrayArenaCopy(sourceList->keyArena,\
+            NULL, sizeof(listType##Item), 0);\
+        if( newCopy->keyArena == NULL ) {\
+          goto ReturnError;\
+        }\
+      }\
+      return newCopy;\
+    }\
+    \
+    /* Copy data, then copy the string keys */\
+    newCopy->item =\
+      (listType##Item*)malloc(reservedCount * sizeof(listType##Item));\
+    if( newCopy->item == NULL ) {\
+      goto ReturnError;\
+    }\
+    \
+    for( index = 0; index < itemCount; index++ ) {\
+      /* Arena keys are copied with the arena, after the items */\
+      keyCopy = sourceItem[index].key;\
+      if( sourceList->keyArena == NULL ) {\
+        keyLen = strlen(keyCopy);\
+        keyCopy = KeyArrayDuplicateKey(NULL, keyCopy, keyLen);\
+        if( keyCopy == NULL ) {\
+          goto ReturnError;\
+        }\
+      }\
+      \
+      /* Direct copy by default, allowing copy function to be empty */\
+      newCopy->item[index].data = sourceItem[index].data;\
+      if( copyDataFunc(&(newCopy->item[index].data),\
+          &(sourceItem[index].data)) == 0 ) {\
+        if( sourceList->keyArena == NULL ) {\
+          free( keyCopy );\
+        }\
+        goto ReturnError;\
+      }\
+      \
+      newCopy->item[index].key = keyCopy;\
+      copiedCount++;\
+    }\
+    \
+    if( sourceList->keyArena ) {\
+      newCopy->keyArena = KeyArrayArenaCopy(sourceList->keyArena,\
+          &(newCopy->item[0].key), sizeof(listType##Item), itemCount);\
+      if( newCopy->keyArena == NULL ) {\
+        goto ReturnError;\
+      }\
+    }\
+    \
+    newCopy->reservedCount = reservedCount;\
+    newCopy->itemCount = itemCount;\
+    \
+    return newCopy;\
+    \
+  ReturnError:\
+    if( newCopy == NULL ) {\
+      return NULL;\
+    }\
+    \
+    for( index = 0; index < copiedCount; index++ ) {\
+      freeDataFunc( &(newCopy->item[index].data) );\
+      if( sourceList->keyArena == NULL ) {\
+        free( newCopy->item[index].key );\
+      }\
+    }\
+    \
+    if( newCopy->item ) {\
+      free( newCopy->item );\
+    }\
+    \
+    free( newCopy );\
+    newCopy = NULL;\
+    \
+    return NULL;\
+  }
+
+  #define DECLARE_STRING_KEYARRAY_BULKLOAD( funcName, listType, dataType,\
+      duplicatePolicy, mergeDataFunc, freeDataFunc )\
+  KEYARRAY_DECLARE_SORT( funcName##SortItems, listType##Item,\
+      KEYARRAY_COMPARE_STRING )\
+  \
+  listType* funcName( listType##Item* sourceItem, size_t sourceCount ) {\
+    listType* newList = NULL;\
+    listType##Item* item = NULL;\
+    listType##Item* scratch = NULL;\
+    size_t index;\
+    size_t runIndex;\
+    size_t keyedIndex = 0;\
+    size_t itemCount;\
+    size_t keyLen;\
+    char* keyCopy;\
+    \
+    if( (sourceItem == NULL) && sourceCount ) {\
+      return NULL;\
+    }\
+    \
+    newList = (listType*)calloc(1, sizeof(listType));\
+    if( newList == NULL ) {\
+      goto ReturnError;\
+    }\
+    \
+    /* A list with no items is valid */\
+    if( sourceCount == 0 ) {\
+      return newList;\
+    }\
+    \
+    for( index = 0; index < sourceCount; index++ ) {\
+      if( !(sourceItem[index].key && (*sourceItem[index].key)) ) {\
+        goto ReturnError;\
+      }\
+    }\
+    \
+    /* Allocate the list once, then sort in place */\
+    if( sourceCount > (((size_t)-1) / sizeof(listType##Item)) ) {\
+      goto ReturnError;\
+    }\
+    \
+    item = (listType##Item*)malloc(sourceCount * sizeof(listType##Item));\
+    scratch = (listType##Item*)malloc(sourceCount * sizeof(listType##Item));\
+    if( (item == NULL) || (scratch == NULL) ) {\
+      goto ReturnError;\
+    }\
+    \
+    memcpy( item, sourceItem, sourceCount * sizeof(listType##Item) );\
+    funcName##SortItems( item, scratch, sourceCount );\
+    \
+    free( scratch );\
+    scratch = NULL;\
+    \
+    /* Copy one key string per run of equal keys, before touching data */\
+    while( keyedIndex < sourceCount ) {\
+      for( runIndex = keyedIndex + 1; (runIndex < sourceCount) &&\
+          (strcmp(item[runIndex].key, item[keyedIndex].key) == 0);\
+          runIndex++ ) {\
+      }\
+      \
+      if( ((runIndex - keyedIndex) > 1) &&\
+          ((duplicatePolicy) == KEYARRAY_DUPLICATES_REJECT) ) {\
+        goto ReturnError;\
+      }\
+      \
+      keyLen = strlen(item[keyedIndex].key);\
+      keyCopy = (char*)malloc(keyLen + 1);\
+      if( keyCopy == NULL ) {\
+        goto ReturnError;\
+      }\
+      memcpy( keyCopy, item[keyedIndex].key, keyLen + 1 );\
+      \
+      item[keyedIndex].key = keyCopy;\
+      keyedIndex = runIndex;\
+    }\
+    \
+    /* Resolve duplicates, and pack the list */\
+    itemCount = 0;\
+    for( index = 0; index < sourceCount; index = runIndex ) {\
+      item[itemCount] = item[index];\
+      \
+      for( runIndex = index + 1; (runIndex < sourceCount) &&\
+          (strcmp(item[runIndex].key, item[itemCount].key) == 0);\
+          runIndex++ ) {\
+        if( (duplicatePolicy) == KEYARRAY_DUPLICATES_LAST ) {\
+          freeDataFunc( &(item[itemCount].data) );\
+          item[itemCount].data = item[runIndex].data;\
+        } else {\
+          if( (duplicatePolicy) == KEYARRAY_DUPLICATES_MERGE ) {\
+            mergeDataFunc( &(item[itemCount].data),\
+                &(item[runIndex].data) );\
+          }\
+          freeDataFunc( &(item[runIndex].data) );\
+        }\
+      }\
+      \
+      itemCount++;\
+    }\
+    \
+    newList->reservedCount = sourceCount;\
+    newList->itemCount = itemCount;\
+    newList->item = item;\
+    \
+    return newList;\
+    \
+  ReturnError:\
+    if( item ) {\
+      /* Release key strings copied so far */\
+      for( index = 0; index < keyedIndex; index = runIndex ) {\
+        for( runIndex = index + 1; (runIndex < keyedIndex) &&\
+            (strcmp(item[runIndex].key, item[index].key) == 0);\
+            runIndex++ ) {\
+        }\
+        free( item[index].key );\
+      }\
+      free( item );\
+      item = NULL;\
+    }\
+    \
+    if( scratch ) {\
+      free( scratch );\
+      scratch = NULL;\
+    }\
+    \
+    if( newList ) {\
+      free( newList );\
+      newList = NULL;\
+    }\
+    \
+    return NULL;\
+  }
+
+
+  #define DECLARE_STRING_KEYARRAY_MERGEBATCH( funcName, listType, dataType,\
+      resolveDataFunc, freeDataFunc )\
+  KEYARRAY_DECLARE_SORT( funcName##SortItems, listType##Item,\
+      KEYARRAY_COMPARE_STRING )\
+  \
+  int funcName( listType* keyList, listType##Item* batchItem,\
+      size_t batchCount ) {\
+    listType##Item* batch = NULL;\
+    listType##Item* scratch = NULL;\
+    listType##Item* item;\
+    size_t reservedCount;\
+    size_t itemCount;\
+    size_t newCount;\
+    size_t batchIndex;\
+    size_t runIndex;\
+    size_t listIndex;\
+    size_t writeIndex;\
+    size_t leftIndex;\
+    size_t rightIndex;\
+    size_t searchIndex;\
+    size_t step;\
+    size_t keyedIndex = 0;\
+    size_t keyLen;\
+    char* keyCopy;\
+    \
+    if( !(keyList && (batchItem || (batchCount == 0))) ) {\
+      return 0;\
+    }\
+    \
+    if( batchCount == 0 ) {\
+      return 1;\
+    }\
+    \
+    for( batchIndex = 0; batchIndex < batchCount; batchIndex++ ) {\
+      if( !(batchItem[batchIndex].key && (*batchItem[batchIndex].key)) ) {\
+        return 0;\
+      }\
+    }\
+    \
+    /* Sort a copy of the batch */\
+    if( batchCount > (((size_t)-1) / sizeof(listType##Item)) ) {\
+      return 0;\
+    }\
+    \
+    batch = (listType##Item*)malloc(batchCount * sizeof(listType##Item));\
+    scratch = (listType##Item*)malloc(batchCount * sizeof(listType##Item));\
+    if( (batch == NULL) || (scratch == NULL) ) {\
+      goto ReturnError;\
+    }\
+    \
+    memcpy( batch, batchItem, batchCount * sizeof(listType##Item) );\
+    funcName##SortItems( batch, scratch, batchCount );\
+    \
+    itemCount = keyList->itemCount;\
+    item = keyList->item;\
+    \
+    /* Count new keys, galloping through the list. scratch[n].key\
+       holds the key copy for each new run of batch keys. */\
+    newCount = 0;\
+    listIndex = 0;\
+    for( batchIndex = 0; batchIndex < batchCount; batchIndex = runIndex ) {\
+      for( runIndex = batchIndex + 1; (runIndex < batchCount) &&\
+          (strcmp(batch[runIndex].key, batch[batchIndex].key) == 0);\
+          runIndex++ ) {\
+        scratch[runIndex].key = NULL;\
+      }\
+      \
+      leftIndex = listIndex;\
+      rightIndex = listIndex;\
+      step = 1;\
+      while( (rightIndex < itemCount) &&\
+          (strcmp(item[rightIndex].key, batch[batchIndex].key) < 0) ) {\
+        leftIndex = rightIndex + 1;\
+        rightIndex += step;\
+        step *= 2;\
+      }\
+      if( rightIndex > itemCount ) {\
+        rightIndex = itemCount;\
+      }\
+      \
+      while( leftIndex < rightIndex ) {\
+        searchIndex = leftIndex + ((rightIndex - leftIndex) / 2);\
+        if( strcmp(item[searchIndex].key, batch[batchIndex].key) < 0 ) {\
+          leftIndex = searchIndex + 1;\
+        } else {\
+          rightIndex = searchIndex;\
+        }\
+      }\
+      listIndex = leftIndex;\
+      \
+      if( (listIndex < itemCount) &&\
+          (strcmp(item[listIndex].key, batch[batchIndex].key) == 0) ) {\
+        scratch[batchIndex].key = NULL;\
+        continue;\
+      }\
+      \
+      keyLen = strlen(batch[batchIndex].key);\
+      keyCopy = KeyArrayDuplicateKey(keyList->keyArena,\
+          batch[batchIndex].key, keyLen);\
+      if( keyCopy == NULL ) {\
+        keyedIndex = batchIndex;\
+        goto ReturnError;\
+      }\
+      scratch[batchIndex].key = keyCopy;\
+      \
+      newCount++;\
+    }\
+    keyedIndex = batchCount;\
+    \
+    /* Grow list once, if necessary */\
+    reservedCount = keyList->reservedCount;\
+    if( (itemCount + newCount) > reservedCount ) {\
+      reservedCount = KEYARRAY_GROW_DEFAULT(reservedCount,\
+          itemCount + newCount);\
+      if( reservedCount > (((size_t)-1) / sizeof(listType##Item)) ) {\
+        goto ReturnError;\
+      }\
+      \
+      item = (listType##Item*)realloc(item,\
+          reservedCount * sizeof(listType##Item));\
+      if( item == NULL ) {\
+        goto ReturnError;\
+      }\
+      keyList->reservedCount = reservedCount;\
+      keyList->item = item;\
+    }\
+    \
+    /* Make room in the hash index, before changing any item */\
+    if( keyList->hashIndex && (KeyArrayStringHashReserve(keyList->hashIndex,\
+        itemCount + newCount) == 0) ) {\
+      goto ReturnError;\
+    }\
+    \
+    /* Merge from the back, moving each list item at most once */\
+    writeIndex = itemCount + newCount;\
+    listIndex = itemCount;\
+    batchIndex = batchCount;\
+    while( batchIndex > 0 ) {\
+      for( runIndex = batchIndex - 1; (runIndex > 0) &&\
+          (strcmp(batch[runIndex - 1].key, batch[runIndex].key) == 0);\
+          runIndex-- ) {\
+      }\
+      \
+      if( writeIndex == listIndex ) {\
+        /* Remaining list items are in place, so search instead */\
+        leftIndex = 0;\
+        rightIndex = listIndex;\
+        while( leftIndex < rightIndex ) {\
+          searchIndex = leftIndex + ((rightIndex - leftIndex) / 2);\
+          if( strcmp(item[searchIndex].key, batch[runIndex].key) > 0 ) {\
+            rightIndex = searchIndex;\
+          } else {\
+            leftIndex = searchIndex + 1;\
+          }\
+        }\
+        listIndex = leftIndex;\
+        writeIndex = leftIndex;\
+      } else {\
+        while( (listIndex > 0) &&\
+            (strcmp(item[listIndex - 1].key, batch[runIndex].key) > 0) ) {\
+          listIndex--;\
+          writeIndex--;\
+          item[writeIndex] = item[listIndex];\
+        }\
+      }\
+      \
+      if( (listIndex > 0) &&\
+          (strcmp(item[listIndex - 1].key, batch[runIndex].key) == 0) ) {\
+        /* Existing key: resolve each batch item into the list item */\
+        listIndex--;\
+        writeIndex--;\
+        for( searchIndex = runIndex; searchIndex < batchIndex;\
+            searchIndex++ ) {\
+          resolveDataFunc( &(item[listIndex].data),\
+              &(batch[searchIndex].data) );\
+          freeDataFunc( &(batch[searchIndex].data) );\
+        }\
+        if( writeIndex != listIndex ) {\
+          item[writeIndex] = item[listIndex];\
+        }\
+      } else {\
+        /* New key: resolve duplicates into the first batch item */\
+        for( searchIndex = runIndex + 1; searchIndex < batchIndex;\
+            searchIndex++ ) {\
+          resolveDataFunc( &(batch[runIndex].data),\
+              &(batch[searchIndex].data) );\
+          freeDataFunc( &(batch[searchIndex].data) );\
+        }\
+        writeIndex--;\
+        item[writeIndex].key = scratch[runIndex].key;\
+        item[writeIndex].data = batch[runIndex].data;\
+      }\
+      \
+      batchIndex = runIndex;\
+    }\
+    \
+    keyList->itemCount = itemCount + newCount;\
+    keyList->generation++;\
+    \
+    /* Items past the first new key have moved, so rehash every key */\
+    if( keyList->hashIndex && newCount ) {\
+      KeyArrayStringHashRefill( keyList->hashIndex,\
+          &(keyList->item[0].key), sizeof(listType##Item),\
+          keyList->itemCount );\
+    }\
+    if( keyList->bloomFilter && newCount ) {\
+      KeyArrayStringBloomRefill( keyList->bloomFilter,\
+          &(keyList->item[0].key), sizeof(listType##Item),\
+          keyList->itemCount );\
+    }\
+    \
+    free( scratch );\
+    free( batch );\
+    \
+    return 1;\
+    \
+  ReturnError:\
+    if( scratch ) {\
+      /* Release key strings copied so far */\
+      for( batchIndex = 0; batchIndex < keyedIndex; batchIndex++ ) {\
+        KeyArrayReleaseKey( keyList->keyArena, scratch[batchIndex].key );\
+      }\
+      free( scratch );\
+      scratch = NULL;\
+    }\
+    \
+    if( batch ) {\
+      free( batch );\
+      batch = NULL;\
+    }\
+    \
+    return 0;\
+  }
+
+  #define DECLARE_STRING_KEYARRAY_UNION( funcName, listType, dataType,\
+      copyDataFunc, combineDataFunc, freeDataFunc )\
+  KEYARRAY_DECLARE_SETOP( funcName, listType, String,\
+      KEYARRAY_COMPARE_STRING_ITEMS, KEYARRAY_GALLOP_STRING_ITEMS,\
+      KEYARRAY_SET_UNION, copyDataFunc, combineDataFunc,\
+      freeDataFunc )
+
+  #define DECLARE_STRING_KEYARRAY_INTERSECT( funcName, listType, dataType,\
+      combineDataFunc, freeDataFunc )\
+  KEYARRAY_DECLARE_SETOP( funcName, listType, String,\
+      KEYARRAY_COMPARE_STRING_ITEMS, KEYARRAY_GALLOP_STRING_ITEMS,\
+      KEYARRAY_SET_INTERSECT, KEYARRAY_SET_NO_COPY, combineDataFunc,\
+      freeDataFunc )
+
+  #define DECLARE_STRING_KEYARRAY_DIFFERENCE( funcName, listType, dataType,\
+      copyDataFunc, freeDataFunc )\
+  KEYARRAY_DECLARE_SETOP( funcName, listType, String,\
+      KEYARRAY_COMPARE_STRING_ITEMS, KEYARRAY_GALLOP_STRING_ITEMS,\
+      KEYARRAY_SET_DIFFERENCE, copyDataFunc, KEYARRAY_SET_NO_COMBINE,\
+      freeDataFunc )
+
+/*
+ * ===========================================================
+ *  String Key Array implementation, structure of arrays layout
+ * ===========================================================
+ */
+
+  #define DECLARE_STRING_KEYARRAY_TYPES_SOA( typeName, dataType )\
+  typedef struct typeName##Item {\
+    char* key;\
+    dataType data;\
+  } typeName##Item;\
+  \
+  typedef dataType typeName##Data;\
+  \
+  typedef struct typeName {\
+    size_t reservedCount;\
+    size_t itemCount;\
+    char** keys;\
+    typeName##Data* data;\
+    KeyArrayKeyArena* keyArena;\
+    KeyArrayStringHashIndex* hashIndex;\
+    size_t fingerIndex;\
+  } typeName;
+
+  #define DECLARE_STRING_KEYARRAY_CREATE_SOA( funcName, listType )\
+  listType* funcName( size_t reserveCount ) {\
+    listType* newKeyArray = NULL;\
+    \
+    newKeyArray = (listType*)calloc(1, sizeof(listType));\
+    if( newKeyArray == NULL ) {\
+      goto ReturnError;\
+    }\
+    \
+    if( reserveCount ) {\
+      newKeyArray->keys = (char**)calloc(reserveCount, sizeof(char*));\
+      newKeyArray->data =\
+        (listType##Data*)calloc(reserveCount, sizeof(listType##Data));\
+      if( (newKeyArray->keys == NULL) || (newKeyArray->data == NULL) ) {\
+        goto ReturnError;\
+      }\
+      \
+      newKeyArray->reservedCount = reserveCount;\
+    }\
+    return newKeyArray;\
+  \
+  ReturnError:\
+    if( newKeyArray ) {\
+      if( newKeyArray->keys ) {\
+        free( newKeyArray->keys );\
+        newKeyArray->keys = NULL;\
+      }\
+      if( newKeyArray->data ) {\
+        free( newKeyArray->data );\
+        newKeyArray->data = NULL;\
+      }\
+      free( newKeyArray );\
+      newKeyArray = NULL;\
+    }\
+    return NULL;\
+  }
+
+  #define DECLARE_STRING_KEYARRAY_FREE_SOA( funcName, listType, freeDataFunc )\
+  void funcName( listType** keyList ) {\
+    size_t index;\
+    size_t itemCount;\
+    \
+    if( keyList && (*keyList) ) {\
+      itemCount = (*keyList)->itemCount;\
+      for( index = 0; index < itemCount; index++ ) {\
+        if( (*keyList)->keys[index] && ((*keyList)->keyArena == NULL) ) {\
+          free( (*keyList)->keys[index] );\
+        }\
+        freeDataFunc( &((*keyList)->data[index]) );\
+      }\
+      \
+      /* Arena keys are released a chunk at a time */\
+      KeyArrayArenaRelease( &((*keyList)->keyArena) );\
+      KeyArrayStringFreeHashIndex( &((*keyList)->hashIndex) );\
+      \
+      if( (*keyList)->keys ) {\
+        free( (*keyList)->keys );\
+      }\
+      if( (*keyList)->data ) {\
+        free( (*keyList)->data );\
+      }\
+      \
+      free( (*keyList) );\
+      (*keyList) = NULL;\
+    }\
+  }
+
+  #define DECLARE_STRING_KEYARRAY_INSERT_SOA( funcName, listType, dataType )\
+  DECLARE_STRING_KEYARRAY_INSERT_GROWTH_SOA( funcName, listType, dataType,\
+      KEYARRAY_GROW_DEFAULT )
+
+  #define DECLARE_STRING_KEYARRAY_INSERT_GROWTH_SOA( funcName, listType,\
+      dataType, growFunc )\
+  int funcName( listType* keyList, char* key, dataType* data ) {\
+    size_t insertIndex;\
+    char* newStrKey;\
+    size_t keyLen;\
+    size_t reservedCount;\
+    size_t itemCount;\
+    char** keys;\
+    dataType* itemData;\
+    \
+    if( !(keyList && key && data) ) {\
+      return 0;\
+    }\
+    \
+    keyLen = strlen(key);\
+    if( keyLen == 0 ) {\
+      return 0;\
+    }\
+    \
+    /* Grow both arrays, if necessary */\
+    reservedCount = keyList->reservedCount;\
+    itemCount = keyList->itemCount;\
+    \
+    if( itemCount == reservedCount ) {\
+      reservedCount = growFunc(reservedCount, itemCount + 1);\
+      if( (reservedCount <= itemCount) ||\
+          (reservedCount > (((size_t)-1) / sizeof(dataType))) ||\
+          (reservedCount > (((size_t)-1) / sizeof(char*))) ) {\
+        return 0;\
+      }\
+      \
+      keys = (char**)realloc(keyList->keys, reservedCount * sizeof(char*));\
+      if( keys == NULL ) {\
+        return 0;\
+      }\
+      keyList->keys = keys;\
+      \
+      itemData = (dataType*)realloc(keyList->data,\
+          reservedCount * sizeof(dataType));\
+      if( itemData == NULL ) {\
+        return 0;\
+      }\
+      keyList->data = itemData;\
+      keyList->reservedCount = reservedCount;\
+    }\
+    \
+    keys = keyList->keys;\
+    itemData = keyList->data;\
+    \
+    /* Search for insert position, from the last one */\
+    insertIndex = KeyArrayStringFingerBound(keys, sizeof(char*),\
+        keyList->fingerIndex, itemCount, key);\
+    if( (insertIndex < itemCount) && (strcmp(keys[insertIndex], key) == 0) ) {\
+      return 0;\
+    }\
+    \
+    /* Make room in the hash index first, so that the list is unchanged\
+       on failure */\
+    if( keyList->hashIndex &&\
+        (KeyArrayStringHashReserve(keyList->hashIndex, itemCount + 1) == 0) ) {\
+      return 0;\
+    }\
+    \
+    /* Attempt to allocate key string before going further */\
+    newStrKey = KeyArrayDuplicateKey(keyList->keyArena, key, keyLen);\
+    if( newStrKey == NULL ) {\
+      return 0;\
+    }\
+    \
+    /* Move keys and data past insertion point up, if necessary */\
+    memmove( &(keys[insertIndex + 1]), &(keys[insertIndex]),\
+        (itemCount - insertIndex) * sizeof(char*) );\
+    memmove( &(itemData[insertIndex + 1]), &(itemData[insertIndex]),\
+        (itemCount - insertIndex) * sizeof(dataType) );\
+    \
+    /* Insert item */\
+    keys[insertIndex] = newStrKey;\
+    memcpy( &(itemData[insertIndex]), data, sizeof(dataType) );\
+    \
+    keyList->itemCount++;\
+    keyList->fingerIndex = insertIndex;\
+    \
+    if( keyList->hashIndex ) {\
+      KeyArrayStringHashInsert( keyList->hashIndex, newStrKey, insertIndex,\
+          itemCount );\
+    }\
+    \
+    return 1;\
+  }
+
+  #define DECLARE_STRING_KEYARRAY_RESERVE_SOA( funcName, listType )\
+  int funcName( listType* keyList, size_t reserveCount ) {\
+    char** keys;\
+    listType##Data* itemData;\
+    \
+    if( keyList == NULL ) {\
+      return 0;\
+    }\
+    \
+    if( reserveCount <= keyList->reservedCount ) {\
+      return 1;\
+    }\
+    \
+    if( (reserveCount > (((size_t)-1) / sizeof(listType##Data))) ||\
+        (reserveCount > (((size_t)-1) / sizeof(char*))) ) {\
+      return 0;\
+    }\
+    \
+    keys = (char**)realloc(keyList->keys, reserveCount * sizeof(char*));\
+    if( keys == NULL ) {\
+      return 0;\
+    }\
+    keyList->keys = keys;\
+    \
+    itemData = (listType##Data*)realloc(keyList->data,\
+        reserveCount * sizeof(listType##Data));\
+    if( itemData == NULL ) {\
+      return 0;\
+    }\
+    keyList->data = itemData;\
+    keyList->reservedCount = reserveCount;\
+    \
+    return 1;\
+  }
+
+  #define DECLARE_STRING_KEYARRAY_REMOVE_SOA( funcName, listType,\
+      freeDataFunc )\
+  void funcName( listType* keyList, char* key ) {\
+    size_t leftIndex;\
+    size_t rightIndex;\
+    size_t removeIndex;\
+    int result;\
+    size_t itemCount;\
+    char** keys;\
+    listType##Data* itemData;\
+    \
+    if( !(keyList && keyList->keys && key && (*key)) ) {\
+      return;\
+    }\
+    \
+    itemCount = keyList->itemCount;\
+    keys = keyList->keys;\
+    itemData = keyList->data;\
+    \
+    /* Search for item */\
+    leftIndex = 0;\
+    rightIndex = itemCount;\
+    removeIndex = itemCount / 2;\
+    \
+    while( leftIndex < rightIndex ) {\
+      result = strcmp(keys[removeIndex], key);\
+      \
+      if( result == 0 ) {\
+        if( keyList->hashIndex ) {\
+          KeyArrayStringHashRemove( keyList->hashIndex, key, removeIndex,\
+              itemCount );\
+        }\
+        freeDataFunc( &(itemData[removeIndex]) );\
+        KeyArrayReleaseKey( keyList->keyArena, keys[removeIndex] );\
+        \
+        itemCount--;\
+        memmove( &(keys[removeIndex]), &(keys[removeIndex + 1]),\
+            (itemCount - removeIndex) * sizeof(char*) );\
+        memmove( &(itemData[removeIndex]), &(itemData[removeIndex + 1]),\
+            (itemCount - removeIndex) * sizeof(listType##Data) );\
+        \
+        keys[itemCount] = NULL;\
+        memset( &(itemData[itemCount]), 0, sizeof(listType##Data) );\
+        keyList->itemCount = itemCount;\
+        \
+        if( KeyArrayArenaNeedsCompact(keyList->keyArena) ) {\
+          KeyArrayArenaCompact( keyList->keyArena, keys, sizeof(char*),\
+              itemCount );\
+        }\
+        \
+        return;\
+      }\
+      \
+      if( result > 0 ) {\
+        rightIndex = removeIndex;\
+      } else {\
+        leftIndex = removeIndex + 1;\
+      }\
+      \
+      removeIndex = (leftIndex + rightIndex) / 2;\
+    }\
+  }
+
+  #define DECLARE_STRING_KEYARRAY_RETRIEVE_SOA( funcName, listType,\
+      dataType )\
+  int funcName( listType* keyList, char* key, dataType* destData ) {\
+    size_t leftIndex;\
+    size_t rightIndex;\
+    size_t retrieveIndex;\
+    int result;\
+    char** keys;\
+    size_t foundIndex;\
+    \
+    if( !(keyList && keyList->keys && key && (*key) && destData) ) {\
+      return 0;\
+    }\
+    \
+    keys = keyList->keys;\
+    \
+    /* Look the key up in the hash index, if enabled */\
+    if( keyList->hashIndex ) {\
+      foundIndex = KeyArrayStringHashFind(keyList->hashIndex,\
+          keys, sizeof(char*), key);\
+      if( foundIndex == ((size_t)-1) ) {\
+        return 0;\
+      }\
+      memcpy( destData, &(keyList->data[foundIndex]), sizeof(dataType) );\
+      return 1;\
+    }\
+    \
+    /* Search keys only, then touch data once */\
+    leftIndex = 0;\
+    rightIndex = keyList->itemCount;\
+    retrieveIndex = rightIndex / 2;\
+    \
+    while( leftIndex < rightIndex ) {\
+      result = strcmp(keys[retrieveIndex], key);\
+      \
+      if( result == 0 ) {\
+        memcpy( destData, &(keyList->data[retrieveIndex]),\
+            sizeof(dataType) );\
+        return 1;\
+      }\
+      \
+      if( result > 0 ) {\
+        rightIndex = retrieveIndex;\
+      } else {\
+        leftIndex = retrieveIndex + 1;\
+      }\
+      \
+      retrieveIndex = (leftIndex + rightIndex) / 2;\
+    }\
+    \
+    return 0;\
+  }
+
+  #define DECLARE_STRING_KEYARRAY_MODIFY_SOA( funcName, listType, dataType )\
+  int funcName( listType* keyList, char* key, dataType* sourceData ) {\
+    size_t leftIndex;\
+    size_t rightIndex;\
+    size_t modifyIndex;\
+    int result;\
+    char** keys;\
+    size_t foundIndex;\
+    \
+    if( !(keyList && keyList->keys && key && (*key) && sourceData) ) {\
+      return 0;\
+    }\
+    \
+    keys = keyList->keys;\
+    \
+    /* Look the key up in the hash index, if enabled */\
+    if( keyList->hashIndex ) {\
+      foundIndex = KeyArrayStringHashFind(keyList->hashIndex,\
+          keys, sizeof(char*), key);\
+      if( foundIndex == ((size_t)-1) ) {\
+        return 0;\
+      }\
+      memcpy( &(keyList->data[foundIndex]), sourceData, sizeof(dataType) );\
+      return 1;\
+    }\
+    \
+    /* Search keys only, then touch data once */\
+    leftIndex = 0;\
+    rightIndex = keyList->itemCount;\
+    modifyIndex = rightIndex / 2;\
+    \
+    while( leftIndex < rightIndex ) {\
+      result = strcmp(keys[modifyIndex], key);\
+      \
+      if( result == 0 ) {\
+        memcpy( &(keyList->data[modifyIndex]), sourceData,\
+            sizeof(dataType) );\
+        return 1;\
+      }\
+      \
+      if( result > 0 ) {\
+        rightIndex = modifyIndex;\
+      } else {\
+        leftIndex = modifyIndex + 1;\
+      }\
+      \
+      modifyIndex = (leftIndex + rightIndex) / 2;\
+    }\
+    \
+    return 0;\
+  }
+
+  #define DECLARE_STRING_KEYARRAY_FINDINDEX_SIZE_SOA( funcName, listType )\
+  size_t funcName( listType* keyList, char* key ) {\
+    size_t leftIndex;\
+    size_t rightIndex;\
+    size_t searchIndex;\
+    int result;\
+    char** keys;\
+    size_t foundIndex;\
+    \
+    if( !(keyList && keyList->keys && key && (*key)) ) {\
+      return ((size_t)-1);\
+    }\
+    \
+    keys = keyList->keys;\
+    \
+    /* Look the key up in the hash index, if enabled */\
+    if( keyList->hashIndex ) {\
+      foundIndex = KeyArrayStringHashFind(keyList->hashIndex,\
+          keys, sizeof(char*), key);\
+      if( foundIndex == ((size_t)-1) ) {\
+        return ((size_t)-1);\
+      }\
+      return foundIndex;\
+    }\
+    \
+    /* Search for item */\
+    leftIndex = 0;\
+    rightIndex = keyList->itemCount;\
+    searchIndex = rightIndex / 2;\
+    \
+    while( leftIndex < rightIndex ) {\
+      result = strcmp(keys[searchIndex], key);\
+      \
+      if( result == 0 ) {\
+        return searchIndex;\
+      }\
+      \
+      if( result > 0 ) {\
+        rightIndex = searchIndex;\
+      } else {\
+        leftIndex = searchIndex + 1;\
+      }\
+      \
+      searchIndex = (leftIndex + rightIndex) / 2;\
+    }\
+    \
+    return ((size_t)-1);\
+  }
+
+  #define DECLARE_STRING_KEYARRAY_FINDINDEX_SOA( funcName, listType )\
+  KEYARRAY_DECLARE_FINDINDEX_INT( funcName, listType, listType, char*,\
+      DECLARE_STRING_KEYARRAY_FINDINDEX_SIZE_SOA )
+
+  #define DECLARE_STRING_KEYARRAY_LOWERBOUND_SOA( funcName, listType )\
+  size_t funcName( listType* keyList, char* key ) {\
+    if( !(keyList && keyList->keys && key) ) {\
+      return 0;\
+    }\
+    \
+    return KeyArrayStringBound(&(keyList->keys[0]), sizeof(char*),\
+        keyList->itemCount, key, 0);\
+  }
+
+  #define DECLARE_STRING_KEYARRAY_UPPERBOUND_SOA( funcName, listType )\
+  size_t funcName( listType* keyList, char* key ) {\
+    if( !(keyList && keyList->keys && key) ) {\
+      return 0;\
+    }\
+    \
+    return KeyArrayStringBound(&(keyList->keys[0]), sizeof(char*),\
+        keyList->itemCount, key, 1);\
+  }
+
+  #define DECLARE_STRING_KEYARRAY_RANGE_SOA( funcName, listType )\
+  size_t funcName( listType* keyList, char* firstKey,\
+      char* lastKey, size_t* beginIndex ) {\
+    size_t endIndex;\
+    \
+    if( !(keyList && beginIndex) ) {\
+      return 0;\
+    }\
+    \
+    (*beginIndex) = 0;\
+    if( !(keyList->keys && firstKey && lastKey) ) {\
+      return 0;\
+    }\
+    \
+    (*beginIndex) = KeyArrayStringBound(&(keyList->keys[0]), sizeof(char*),\
+        keyList->itemCount, firstKey, 0);\
+    \
+    /* The last key can only be at, or after, the first key */\
+    endIndex = (*beginIndex) + KeyArrayStringBound(\
+        &(keyList->keys[(*beginIndex)]), sizeof(char*),\
+        (keyList->itemCount - (*beginIndex)), lastKey, 1);\
+    \
+    return endIndex - (*beginIndex);\
+  }
+
+  #define DECLARE_STRING_KEYARRAY_KEYARENA_SOA( funcName, listType )\
+  int funcName( listType* keyList, int enable ) {\
+    KeyArrayKeyArena* keyArena;\
+    \
+    if( keyList == NULL ) {\
+      return 0;\
+    }\
+    \
+    if( enable == 0 ) {\
+      if( keyList->keyArena ) {\
+        /* Give each key its own allocation again */\
+        if( keyList->itemCount && (KeyArrayArenaDisownKeys(keyList->keys,\
+            sizeof(char*), keyList->itemCount) == 0) ) {\
+          return 0;\
+        }\
+        KeyArrayArenaRelease( &(keyList->keyArena) );\
+      }\
+      return 1;\
+    }\
+    \
+    if( keyList->keyArena ) {\
+      return 1;\
+    }\
+    \
+    keyArena = (KeyArrayKeyArena*)calloc(1, sizeof(KeyArrayKeyArena));\
+    if( keyArena == NULL ) {\
+      return 0;\
+    }\
+    \
+    /* Move the existing keys into the arena */\
+    if( keyList->itemCount && (KeyArrayArenaAdoptKeys(keyArena,\
+        keyList->keys, sizeof(char*), keyList->itemCount) == 0) ) {\
+      KeyArrayArenaRelease( &keyArena );\
+      return 0;\
+    }\
+    \
+    keyList->keyArena = keyArena;\
+    \
+    return 1;\
+  }
+
+  #define DECLARE_STRING_KEYARRAY_HASHINDEX_SOA( funcName, listType )\
+  int funcName( listType* keyList, int enable ) {\
+    KeyArrayStringHashIndex* hashIndex;\
+    \
+    if( keyList == NULL ) {\
+      return 0;\
+    }\
+    \
+    if( enable == 0 ) {\
+      KeyArrayStringFreeHashIndex( &(keyList->hashIndex) );\
+      return 1;\
+    }\
+    \
+    if( keyList->hashIndex ) {\
+      return 1;\
+    }\
+    \
+    hashIndex = (KeyArrayStringHashIndex*)calloc(1,\
+        sizeof(KeyArrayStringHashIndex));\
+    if( hashIndex == NULL ) {\
+      return 0;\
+    }\
+    \
+    if( KeyArrayStringHashReserve(hashIndex, keyList->itemCount) == 0 ) {\
+      KeyArrayStringFreeHashIndex( &hashIndex );\
+      return 0;\
+    }\
+    \
+    if( keyList->itemCount ) {\
+      KeyArrayStringHashRefill( hashIndex, keyList->keys,\
+          sizeof(char*), keyList->itemCount );\
+    }\
+    \
+    keyList->hashIndex = hashIndex;\
+    \
+    return 1;\
+  }
+
+  #define DECLARE_STRING_KEYARRAY_RELEASEUNUSED_SOA( funcName, listType )\
+  void funcName( listType* keyList ) {\
+    char** keys;\
+    listType##Data* itemData;\
+    \
+    if( keyList == NULL ) {\
+      return;\
+    }\
+    \
+    if( keyList->keys && keyList->data && keyList->itemCount ) {\
+      /* Resize to remove reserved space. Either array shrinking is\
+         enough to lower reservedCount. */\
+      keys = (char**)realloc(keyList->keys,\
+        keyList->itemCount * sizeof(char*));\
+      if( keys ) {\
+        keyList->keys = keys;\
+      }\
+      \
+      itemData = (listType##Data*)realloc(keyList->data,\
+        keyList->itemCount * sizeof(listType##Data));\
+      if( itemData ) {\
+        keyList->data = itemData;\
+      }\
+      \
+      if( keys || itemData ) {\
+        keyList->reservedCount = keyList->itemCount;\
+      }\
+      \
+      /* Pack the live keys into one chunk */\
+      if( keyList->keyArena ) {\
+        KeyArrayArenaCompact( keyList->keyArena, keyList->keys,\
+            sizeof(char*), keyList->itemCount );\
+      }\
+    } else {\
+      /* Deallocate */\
+      keyList->reservedCount = 0;\
+      keyList->itemCount = 0;\
+      if( keyList->keys ) {\
+        free( keyList->keys );\
+        keyList->keys = NULL;\
+      }\
+      if( keyList->data ) {\
+        free( keyList->data );\
+        keyList->data = NULL;\
+      }\
+      \
+      if( keyList->keyArena ) {\
+        KeyArrayArenaCompact( keyList->keyArena, NULL, sizeof(char*), 0 );\
+      }\
+    }\
+  }
+
+  #define DECLARE_STRING_KEYARRAY_COPY_SOA( funcName, listType, dataType,\
+      copyDataFunc, freeDataFunc )\
+  listType* funcName( listType* sourceList ) {\
+    listType* newCopy = NULL;\
+    size_t reservedCount = 0;\
+    size_t itemCount = 0;\
+    size_t copiedCount = 0;\
+    char* keyCopy;\
+    size_t keyLen;\
+    size_t index;\
+    \
+    if( sourceList == NULL ) {\
+      return NULL;\
+    }\
+    \
+    /* Attempt to allocate list object */\
+    newCopy = (listType*)calloc(1, sizeof(listType));\
+    if( newCopy == NULL ) {\
+      goto ReturnError;\
+    }\
+    \
+    /* Initialize important variables */\
+    reservedCount = sourceList->reservedCount;\
+    itemCount = sourceList->itemCount;\
+    \
+    /* A list with no items is valid */\
+    if( !(reservedCount && itemCount &&\
+        sourceList->keys && sourceList->data) ) {\
+      if( sourceList->keyArena ) {\
+        newCopy->keyArena = KeyArrayArenaCopy(sourceList->keyArena,\
+            NULL, sizeof(char*), 0);\
+        if( newCopy->keyArena == NULL ) {\
+          goto ReturnError;\
+        }\
+      }\
+      return newCopy;\
+    }\
+    \
+    newCopy->keys = (char**)malloc(reservedCount * sizeof(char*));\
+    newCopy->data = (dataType*)malloc(reservedCount * sizeof(dataType));\
+    if( (newCopy->keys == NULL) || (newCopy->data == NULL) ) {\
+      goto ReturnError;\
+    }\
+    \
+    /* Copy data, then copy the string keys */\
+    for( index = 0; index < itemCount; index++ ) {\
+      /* Arena keys are copied with the arena, after the items */\
+      keyCopy = sourceList->keys[index];\
+      if( sourceList->keyArena == NULL ) {\
+        keyLen = strlen(keyCopy);\
+        keyCopy = KeyArrayDuplicateKey(NULL, keyCopy, keyLen);\
+        if( keyCopy == NULL ) {\
+          goto ReturnError;\
+        }\
+      }\
+      \
+      /* Direct copy by default, allowing copy function to be empty */\
+      newCopy->data[index] = sourceList->data[index];\
+      if( copyDataFunc(&(newCopy->data[index]),\
+          &(sourceList->data[index])) == 0 ) {\
+        if( sourceList->keyArena == NULL ) {\
+          free( keyCopy );\
+        }\
+        goto ReturnError;\
+      }\
+      \
+      newCopy->keys[index] = keyCopy;\
+      copiedCount++;\
+    }\
+    \
+    if( sourceList->keyArena ) {\
+      newCopy->keyArena = KeyArrayArenaCopy(sourceList->keyArena,\
+          newCopy->keys, sizeof(char*), itemCount);\
+      if( newCopy->keyArena == NULL ) {\
+        goto ReturnError;\
+      }\
+    }\
+    \
+    newCopy->reservedCount = reservedCount;\
+    newCopy->itemCount = itemCount;\
+    \
+    return newCopy;\
+    \
+  ReturnError:\
+    if( newCopy == NULL ) {\
+      return NULL;\
+    }\
+    \
+    for( index = 0; index < copiedCount; index++ ) {\
+      freeDataFunc( &(newCopy->data[index]) );\
+      if( sourceList->keyArena == NULL ) {\
+        free( newCopy->keys[index] );\
+      }\
+    }\
+    \
+    if( newCopy->keys ) {\
+      free( newCopy->keys );\
+    }\
+    if( newCopy->data ) {\
+      free( newCopy->data );\
+    }\
+    \
+    free( newCopy );\
+    newCopy = NULL;\
+    \
+    return NULL;\
+  }
+
+  #define DECLARE_STRING_KEYARRAY_BULKLOAD_SOA( funcName, listType, dataType,\
+      duplicatePolicy, mergeDataFunc, freeDataFunc )\
+  KEYARRAY_DECLARE_SORT( funcName##SortItems, listType##Item,\
+      KEYARRAY_COMPARE_STRING )\
+  \
+  listType* funcName( listType##Item* sourceItem, size_t sourceCount ) {\
+    listType* newList = NULL;\
+    listType##Item* item = NULL;\
+    listType##Item* scratch = NULL;\
+    char** keys = NULL;\
+    dataType* itemData = NULL;\
+    size_t index;\
+    size_t runIndex;\
+    size_t keyedIndex = 0;\
+    size_t itemCount;\
+    size_t keyLen;\
+    char* keyCopy;\
+    \
+    if( (sourceItem == NULL) && sourceCount ) {\
+      return NULL;\
+    }\
+    \
+    newList = (listType*)calloc(1, sizeof(listType));\
+    if( newList == NULL ) {\
+      goto ReturnError;\
+    }\
+    \
+    /* A list with no items is valid */\
+    if( sourceCount == 0 ) {\
+      return newList;\
+    }\
+    \
+    for( index = 0; index < sourceCount; index++ ) {\
+      if( !(sourceItem[index].key && (*sourceItem[index].key)) ) {\
+        goto ReturnError;\
+      }\
+    }\
+    \
+    /* Allocate the list once, then sort pairs in place */\
+    if( sourceCount > (((size_t)-1) / sizeof(listType##Item)) ) {\
+      goto ReturnError;\
+    }\
+    \
+    item = (listType##Item*)malloc(sourceCount * sizeof(listType##Item));\
+    scratch = (listType##Item*)malloc(sourceCount * sizeof(listType##Item));\
+    keys = (char**)malloc(sourceCount * sizeof(char*));\
+    itemData = (dataType*)malloc(sourceCount * sizeof(dataType));\
+    if( !(item && scratch && keys && itemData) ) {\
+      goto ReturnError;\
+    }\
+    \
+    memcpy( item, sourceItem, sourceCount * sizeof(listType##Item) );\
+    funcName##SortItems( item, scratch, sourceCount );\
+    \
+    free( scratch );\
+    scratch = NULL;\
+    \
+    /* Copy one key string per run of equal keys, before touching data */\
+    while( keyedIndex < sourceCount ) {\
+      for( runIndex = keyedIndex + 1; (runIndex < sourceCount) &&\
+          (strcmp(item[runIndex].key, item[keyedIndex].key) == 0);\
+          runIndex++ ) {\
+      }\
+      \
+      if( ((runIndex - keyedIndex) > 1) &&\
+          ((duplicatePolicy) == KEYARRAY_DUPLICATES_REJECT) ) {\
+        goto ReturnError;\
+      }\
+      \
+      keyLen = strlen(item[keyedIndex].key);\
+      keyCopy = (char*)malloc(keyLen + 1);\
+      if( keyCopy == NULL ) {\
+        goto ReturnError;\
+      }\
+      memcpy( keyCopy, item[keyedIndex].key, keyLen + 1 );\
+      \
+      item[keyedIndex].key = keyCopy;\
+      keyedIndex = runIndex;\
+    }\
+    \
+    /* Resolve duplicates, and pack the list */\
+    itemCount = 0;\
+    for( index = 0; index < sourceCount; index = runIndex ) {\
+      item[itemCount] = item[index];\
+      \
+      for( runIndex = index + 1; (runIndex < sourceCount) &&\
+          (strcmp(item[runIndex].key, item[itemCount].key) == 0);\
+          runIndex++ ) {\
+        if( (duplicatePolicy) == KEYARRAY_DUPLICATES_LAST ) {\
+          freeDataFunc( &(item[itemCount].data) );\
+          item[itemCount].data = item[runIndex].data;\
+        } else {\
+          if( (duplicatePolicy) == KEYARRAY_DUPLICATES_MERGE ) {\
+            mergeDataFunc( &(item[itemCount].data),\
+                &(item[runIndex].data) );\
+          }\
+          freeDataFunc( &(item[runIndex].data) );\
+        }\
+      }\
+      \
+      itemCount++;\
+    }\
+    \
+    /* Split the pairs into keys and data */\
+    for( index = 0; index < itemCount; index++ ) {\
+      keys[index] = item[index].key;\
+      itemData[index] = item[index].data;\
+    }\
+    free( item );\
+    \
+    newList->reservedCount = sourceCount;\
+    newList->itemCount = itemCount;\
+    newList->keys = keys;\
+    newList->data = itemData;\
+    \
+    return newList;\
+    \
+  ReturnError:\
+    if( item ) {\
+      /* Release key strings copied so far */\
+      for( index = 0; index < keyedIndex; index = runIndex ) {\
+        for( runIndex = index + 1; (runIndex < keyedIndex) &&\
+            (strcmp(item[runIndex].key, item[index].key) == 0);\
+            runIndex++ ) {\
+        }\
+        free( item[index].key );\
+      }\
+      free( item );\
+      item = NULL;\
+    }\
+    \
+    if( scratch ) {\
+      free( scratch );\
+      scratch = NULL;\
+    }\
+    \
+    if( keys ) {\
+      free( keys );\
+      keys = NULL;\
+    }\
+    \
+    if( itemData ) {\
+      free( itemData );\
+      itemData = NULL;\
+    }\
+    \
+    if( newList ) {\
+      free( newList );\
+      newList = NULL;\
+    }\
+    \
+    return NULL;\
+  }
+
+  #define DECLARE_STRING_KEYARRAY_MERGEBATCH_SOA( funcName, listType, dataType,\
+      resolveDataFunc, freeDataFunc )\
+  KEYARRAY_DECLARE_SORT( funcName##SortItems, listType##Item,\
+      KEYARRAY_COMPARE_STRING )\
+  \
+  int funcName( listType* keyList, listType##Item* batchItem,\
+      size_t batchCount ) {\
+    listType##Item* batch = NULL;\
+    listType##Item* scratch = NULL;\
+    char** keys;\
+    dataType* itemData;\
+    size_t reservedCount;\
+    size_t itemCount;\
+    size_t newCount;\
+    size_t batchIndex;\
+    size_t runIndex;\
+    size_t listIndex;\
+    size_t writeIndex;\
+    size_t leftIndex;\
+    size_t rightIndex;\
+    size_t searchIndex;\
+    size_t step;\
+    size_t keyedIndex = 0;\
+    size_t keyLen;\
+    char* keyCopy;\
+    \
+    if( !(keyList && (batchItem || (batchCount == 0))) ) {\
+      return 0;\
+    }\
+    \
+    if( batchCount == 0 ) {\
+      return 1;\
+    }\
+    \
+    for( batchIndex = 0; batchIndex < batchCount; batchIndex++ ) {\
+      if( !(batchItem[batchIndex].key && (*batchItem[batchIndex].key)) ) {\
+        return 0;\
+      }\
+    }\
+    \
+    /* Sort a copy of the batch */\
+    if( batchCount > (((size_t)-1) / sizeof(listType##Item)) ) {\
+      return 0;\
+    }\
+    \
+    batch = (listType##Item*)malloc(batchCount * sizeof(listType##Item));\
+    scratch = (listType##Item*)malloc(batchCount * sizeof(listType##Item));\
+    if( (batch == NULL) || (scratch == NULL) ) {\
+      goto ReturnError;\
+    }\
+    \
+    memcpy( batch, batchItem, batchCount * sizeof(listType##Item) );\
+    funcName##SortItems( batch, scratch, batchCount );\
+    \
+    itemCount = keyList->itemCount;\
+    keys = keyList->keys;\
+    \
+    /* Count new keys, galloping through the list. scratch[n].key\
+       holds the key copy for each new run of batch keys. */\
+    newCount = 0;\
+    listIndex = 0;\
+    for( batchIndex = 0; batchIndex < batchCount; batchIndex = runIndex ) {\
+      for( runIndex = batchIndex + 1; (runIndex < batchCount) &&\
+          (strcmp(batch[runIndex].key, batch[batchIndex].key) == 0);\
+          runIndex++ ) {\
+        scratch[runIndex].key = NULL;\
+      }\
+      \
+      leftIndex = listIndex;\
+      rightIndex = listIndex;\
+      step = 1;\
+      while( (rightIndex < itemCount) &&\
+          (strcmp(keys[rightIndex], batch[batchIndex].key) < 0) ) {\
+        leftIndex = rightIndex + 1;\
+        rightIndex += step;\
+        step *= 2;\
+      }\
+      if( rightIndex > itemCount ) {\
+        rightIndex = itemCount;\
+      }\
+      \
+      while( leftIndex < rightIndex ) {\
+        searchIndex = leftIndex + ((rightIndex - leftIndex) / 2);\
+        if( strcmp(keys[searchIndex], batch[batchIndex].key) < 0 ) {\
+          leftIndex = searchIndex + 1;\
+        } else {\
+          rightIndex = searchIndex;\
+        }\
+      }\
+      listIndex = leftIndex;\
+      \
+      if( (listIndex < itemCount) &&\
+          (strcmp(keys[listIndex], batch[batchIndex].key) == 0) ) {\
+        scratch[batchIndex].key = NULL;\
+        continue;\
+      }\
+      \
+      keyLen = strlen(batch[batchIndex].key);\
+      keyCopy = KeyArrayDuplicateKey(keyList->keyArena,\
+          batch[batchIndex].key, keyLen);\
+      if( keyCopy == NULL ) {\
+        keyedIndex = batchIndex;\
+        goto ReturnError;\
+      }\
+      scratch[batchIndex].key = keyCopy;\
+      \
+      newCount++;\
+    }\
+    keyedIndex = batchCount;\
+    \
+    /* Grow list once, if necessary */\
+    reservedCount = keyList->reservedCount;\
+    if( (itemCount + newCount) > reservedCount ) {\
+      reservedCount = KEYARRAY_GROW_DEFAULT(reservedCount,\
+          itemCount + newCount);\
+      if( (reservedCount > (((size_t)-1) / sizeof(dataType))) ||\
+          (reservedCount > (((size_t)-1) / sizeof(char*))) ) {\
+        goto ReturnError;\
+      }\
+      \
+      keys = (char**)realloc(keyList->keys, reservedCount * sizeof(char*));\
+      if( keys == NULL ) {\
+        goto ReturnError;\
+      }\
+      keyList->keys = keys;\
+      \
+      itemData = (dataType*)realloc(keyList->data,\
+          reservedCount * sizeof(dataType));\
+      if( itemData == NULL ) {\
+        goto ReturnError;\
+      }\
+      keyList->data = itemData;\
+      keyList->reservedCount = reservedCount;\
+    }\
+    itemData = keyList->data;\
+    \
+    /* Make room in the hash index, before changing any item */\
+    if( keyList->hashIndex && (KeyArrayStringHashReserve(keyList->hashIndex,\
+        itemCount + newCount) == 0) ) {\
+      goto ReturnError;\
+    }\
+    \
+    /* Merge from the back, moving each list item at most once */\
+    writeIndex = itemCount + newCount;\
+    listIndex = itemCount;\
+    batchIndex = batchCount;\
+    while( batchIndex > 0 ) {\
+      for( runIndex = batchIndex - 1; (runIndex > 0) &&\
+          (strcmp(batch[runIndex - 1].key, batch[runIndex].key) == 0);\
+          runIndex-- ) {\
+      }\
+      \
+      if( writeIndex == listIndex ) {\
+        /* Remaining list items are in place, so search instead */\
+        leftIndex = 0;\
+        rightIndex = listIndex;\
+        while( leftIndex < rightIndex ) {\
+          searchIndex = leftIndex + ((rightIndex - leftIndex) / 2);\
+          if( strcmp(keys[searchIndex], batch[runIndex].key) > 0 ) {\
+            rightIndex = searchIndex;\
+          } else {\
+            leftIndex = searchIndex + 1;\
+          }\
+        }\
+        listIndex = leftIndex;\
+        writeIndex = leftIndex;\
+      } else {\
+        while( (listIndex > 0) &&\
+            (strcmp(keys[listIndex - 1], batch[runIndex].key) > 0) ) {\
+          listIndex--;\
+          writeIndex--;\
+          keys[writeIndex] = keys[listIndex];\
+          itemData[writeIndex] = itemData[listIndex];\
+        }\
+      }\
+      \
+      if( (listIndex > 0) &&\
+          (strcmp(keys[listIndex - 1], batch[runIndex].key) == 0) ) {\
+        /* Existing key: resolve each batch item into the list item */\
+        listIndex--;\
+        writeIndex--;\
+        for( searchIndex = runIndex; searchIndex < batchIndex;\
+            searchIndex++ ) {\
+          resolveDataFunc( &(itemData[listIndex]),\
+              &(batch[searchIndex].data) );\
+          freeDataFunc( &(batch[searchIndex].data) );\
+        }\
+        if( writeIndex != listIndex ) {\
+          keys[writeIndex] = keys[listIndex];\
+          itemData[writeIndex] = itemData[listIndex];\
+        }\
+      } else {\
+        /* New key: resolve duplicates into the first batch item */\
+        for( searchIndex = runIndex + 1; searchIndex < batchIndex;\
+            searchIndex++ ) {\
+          resolveDataFunc( &(batch[runIndex].data),\
+              &(batch[searchIndex].data) );\
+          freeDataFunc( &(batch[searchIndex].data) );\
+        }\
+        writeIndex--;\
+        keys[writeIndex] = scratch[runIndex].key;\
+        itemData[writeIndex] = batch[runIndex].data;\
+      }\
+      \
+      batchIndex = runIndex;\
+    }\
+    \
+    keyList->itemCount = itemCount + newCount;\
+    \
+    /* Items past the first new key have moved, so rehash every key */\
+    if( keyList->hashIndex && newCount ) {\
+      KeyArrayStringHashRefill( keyList->hashIndex,\
+          keyList->keys, sizeof(char*), keyList->itemCount );\
+    }\
+    \
+    free( scratch );\
+    free( batch );\
+    \
+    return 1;\
+    \
+  ReturnError:\
+    if( scratch ) {\
+      /* Release key strings copied so far */\
+      for( batchIndex = 0; batchIndex < keyedIndex; batchIndex++ ) {\
+        KeyArrayReleaseKey( keyList->keyArena, scratch[batchIndex].key );\
+      }\
+      free( scratch );\
+      scratch = NULL;\
+    }\
+    \
+    if( batch ) {\
+      free( batch );\
+      batch = NULL;\
+    }\
+    \
+    return 0;\
+  }
+
+  #define DECLARE_STRING_KEYARRAY_UNION_SOA( funcName, listType, dataType,\
+      copyDataFunc, combineDataFunc, freeDataFunc )\
+  KEYARRAY_DECLARE_SETOP_SOA( funcName, listType, char*, String,\
+      KEYARRAY_COMPARE_STRING, KEYARRAY_SET_UNION, copyDataFunc,\
+      combineDataFunc, freeDataFunc )
+
+  #define DECLARE_STRING_KEYARRAY_INTERSECT_SOA( funcName, listType, dataType,\
+      combineDataFunc, freeDataFunc )\
+  KEYARRAY_DECLARE_SETOP_SOA( funcName, listType, char*, String,\
+      KEYARRAY_COMPARE_STRING, KEYARRAY_SET_INTERSECT, KEYARRAY_SET_NO_COPY,\
+      combineDataFunc, freeDataFunc )
+
+  #define DECLARE_STRING_KEYARRAY_DIFFERENCE_SOA( funcName, listType, dataType,\
+      copyDataFunc, freeDataFunc )\
+  KEYARRAY_DECLARE_SETOP_SOA( funcName, listType, char*, String,\
+      KEYARRAY_COMPARE_STRING, KEYARRAY_SET_DIFFERENCE, copyDataFunc,\
+      KEYARRAY_SET_NO_COMBINE, freeDataFunc )
+
+/*
+ * ==================================================
+ *  String Key Array implementation, key prefix layout
+ * ==================================================
+ */
+
+  #define DECLARE_STRING_KEYARRAY_TYPES_PREFIX( typeName, dataType )\
+  typedef struct typeName##Item {\
+    KeyArrayStringPrefix keyPrefix;\
+    char* key;\
+    dataType data;\
+  } typeName##Item;\
+  \
+  typedef struct typeName {\
+    size_t reservedCount;\
+    size_t itemCount;\
+    typeName##Item* item;\
+    KeyArrayKeyArena* keyArena;\
+    KeyArrayStringHashIndex* hashIndex;\
+  } typeName;
+
+  /* Create, free, reserve, and remove buffered space do not look at keys,
+     so the key prefix layout shares them with the default layout. It has
+     no bloom filter or lookup cache to free. */
+  #define KEYARRAY_PREFIX_FREE_LOOKUPS( keyList )
+
+  #define DECLARE_STRING_KEYARRAY_CREATE_PREFIX( funcName, listType )\
+  DECLARE_STRING_KEYARRAY_CREATE( funcName, listType )
+
+  #define DECLARE_STRING_KEYARRAY_FREE_PREFIX( funcName, listType,\
+      freeDataFunc )\
+  KEYARRAY_DECLARE_STRING_FREE( funcName, listType, freeDataFunc,\
+      KEYARRAY_PREFIX_FREE_LOOKUPS )
+
+  #define DECLARE_STRING_KEYARRAY_INSERT_PREFIX( funcName, listType,\
+      dataType )\
+  DECLARE_STRING_KEYARRAY_INSERT_GROWTH_PREFIX( funcName, listType,\
+      dataType, KEYARRAY_GROW_DEFAULT )
+
+  #define DECLARE_STRING_KEYARRAY_INSERT_GROWTH_PREFIX( funcName,\
+      listType, dataType, growFunc )\
+  int funcName( listType* keyList, char* key, dataType* data ) {\
+    size_t leftIndex;\
+    size_t insertIndex;\
+    size_t rightIndex;\
+    int result;\
+    KeyArrayStringPrefix keyPrefix;\
+    char* newStrKey;\
+    size_t keyLen;\
+    size_t reservedCount;\
+    size_t itemCount;\
+    listType##Item* item;\
+    \
+    if( !(keyList && key && data) ) {\
+      return 0;\
+    }\
+    \
+    keyLen = strlen(key);\
+    if( keyLen == 0 ) {\
+      return 0;\
+    }\
+    \
+    /* Grow list, if necessary */\
+    reservedCount = keyList->reservedCount;\
+    itemCount = keyList->itemCount;\
+    item = keyList->item;\
+    \
+    if( itemCount == reservedCount ) {\
+      reservedCount = growFunc(reservedCount, itemCount + 1);\
+      if( (reservedCount <= itemCount) ||\
+          (reservedCount > (((size_t)-1) / sizeof(listType##Item))) ) {\
+        return 0;\
+      }\
+      \
+      item = (listType##Item*)realloc(item,\
+          reservedCount * sizeof(listType##Item));\
+      if( item == NULL ) {\
+        return 0;\
+      }\
+      keyList->reservedCount = reservedCount;\
+      keyList->item = item;\
+    }\
+    \
+    /* Pack the key prefix once, for every probe */\
+    KeyArraySetStringPrefix( &keyPrefix, key );\
+    \
+    /* Search for insert position */\
+    leftIndex = 0;\
+    rightIndex = itemCount;\
+    insertIndex = itemCount / 2;\
+    \
+    while( leftIndex < rightIndex ) {\
+      result = KeyArrayCompareStringPrefix(&(item[insertIndex].keyPrefix),\
+          item[insertIndex].key, &keyPrefix, key);\
+      \
+      if( result == 0 ) {\
+        return 0;\
+      }\
+      \
+      if( result > 0 ) {\
+        rightIndex = insertIndex;\
+      } else {\
+        leftIndex = insertIndex + 1;\
+      }\
+      \
+      insertIndex = (leftIndex + rightIndex) / 2;\
+    }\
+    \
+    /* Make room in the hash index first, so that the list is unchanged\
+       on failure */\
+    if( keyList->hashIndex &&\
+        (KeyArrayStringHashReserve(keyList->hashIndex, itemCount + 1) == 0) ) {\
+      return 0;\
+    }\
+    \
+    /* Attempt to allocate key string before going further */\
+    newStrKey = KeyArrayDuplicateKey(keyList->keyArena, key, keyLen);\
+    if( newStrKey == NULL ) {\
+      return 0;\
+    }\
+    \
+    /* Move data past insertion point up, if necessary */\
+    memmove( &(item[insertIndex + 1]), &(item[insertIndex]),\
+        (itemCount - insertIndex) * sizeof(listType##Item) );\
+    \
+    /* Insert item */\
+    item[insertIndex].keyPrefix = keyPrefix;\
+    item[insertIndex].key = newStrKey;\
+    if( data ) {\
+      memcpy( &(item[insertIndex].data), data, sizeof(dataType) );\
+    }\
+    \
+    keyList->itemCount++;\
+    \
+    if( keyList->hashIndex ) {\
+      KeyArrayStringHashInsert( keyList->hashIndex, newStrKey, insertIndex,\
+          itemCount );\
+    }\
+    \
+    return 1;\
+  }
+
+  #define DECLARE_STRING_KEYARRAY_RESERVE_PREFIX( funcName, listType )\
+  DECLARE_STRING_KEYARRAY_RESERVE( funcName, listType )
+
+  #define DECLARE_STRING_KEYARRAY_REMOVE_PREFIX( funcName, listType,\
+      freeDataFunc )\
+  void funcName( listType* keyList, char* key ) {\
+    size_t leftIndex;\
+    size_t rightIndex;\
+    size_t removeIndex;\
+    int result;\
+    KeyArrayStringPrefix keyPrefix;\
+    size_t itemCount;\
+    listType##Item* item;\
+    \
+    if( !(keyList && keyList->item && key && (*key)) ) {\
+      return;\
+    }\
+    \
+    itemCount = keyList->itemCount;\
+    item = keyList->item;\
+    \
+    /* Pack the key prefix once, for every probe */\
+    KeyArraySetStringPrefix( &keyPrefix, key );\
+    \
+    /* Search for item */\
+    leftIndex = 0;\
+    rightIndex = itemCount;\
+    removeIndex = itemCount / 2;\
+    \
+    while( leftIndex < rightIndex ) {\
+      result = KeyArrayCompareStringPrefix(&(item[removeIndex].keyPrefix),\
+          item[removeIndex].key, &keyPrefix, key);\
+      \
+      if( result == 0 ) {\
+        if( keyList->hashIndex ) {\
+          KeyArrayStringHashRemove( keyList->hashIndex, key, removeIndex,\
+              itemCount );\
+        }\
+        freeDataFunc( &(item[removeIndex].data) );\
+        KeyArrayReleaseKey( keyList->keyArena, item[removeIndex].key );\
+        item[removeIndex].key = NULL;\
+        \
+        if( itemCount ) {\
+          itemCount--;\
+          \
+          memmove( &(item[removeIndex]), &(item[removeIndex + 1]),\
+            (itemCount - removeIndex) * sizeof(listType##Item) );\
+          \
+          keyList->itemCount = itemCount;\
+        }\
+        \
+        memset( &(item[itemCount]), 0, sizeof(listType##Item) );\
+        \
+        if( KeyArrayArenaNeedsCompact(keyList->keyArena) ) {\
+          KeyArrayArenaCompact( keyList->keyArena, &(item[0].key),\
+              sizeof(listType##Item), itemCount );\
+        }\
+        \
+        return;\
+      }\
+      \
+      if( result > 0 ) {\
+        rightIndex = removeIndex;\
+      } else {\
+        leftIndex = removeIndex + 1;\
+      }\
+      \
+      removeIndex = (leftIndex + rightIndex) / 2;\
+    }\
+  }
+
+  #define DECLARE_STRING_KEYARRAY_RETRIEVE_PREFIX( funcName, listType,\
+      dataType )\
+  int funcName( listType* keyList, char* key, dataType* destData ) {\
+    size_t leftIndex;\
+    size_t rightIndex;\
+    size_t retrieveIndex;\
+    int result;\
+    KeyArrayStringPrefix keyPrefix;\
+    size_t itemCount;\
+    listType##Item* item;\
+    size_t foundIndex;\
+    \
+    if( !(keyList && keyList->item && key && (*key) && destData) ) {\
+      return 0;\
+    }\
+    \
+    itemCount = keyList->itemCount;\
+    item = keyList->item;\
+    \
+    /* Look the key up in the hash index, if enabled */\
+    if( keyList->hashIndex ) {\
+      foundIndex = KeyArrayStringHashFind(keyList->hashIndex,\
+          &(item[0].key), sizeof(listType##Item), key);\
+      if( foundIndex == ((size_t)-1) ) {\
+        return 0;\
+      }\
+      memcpy( destData, &(item[foundIndex].data), sizeof(dataType) );\
+      return 1;\
+    }\
+    \
+    /* Pack the key prefix once, for every probe */\
+    KeyArraySetStringPrefix( &keyPrefix, key );\
+    \
+    /* Search for item */\
+    leftIndex = 0;\
+    rightIndex = itemCount;\
+    retrieveIndex = itemCount / 2;\
+    \
+    while( leftIndex < rightIndex ) {\
+      result = KeyArrayCompareStringPrefix(&(item[retrieveIndex].keyPrefix),\
+          item[retrieveIndex].key, &keyPrefix, key);\
+      \
+      if( result == 0 ) {\
+        memcpy( destData, &(item[retrieveIndex].data), sizeof(dataType) );\
+        return 1;\
+      }\
+      \
       if( result > 0 ) {\
-        rightIndex = removeIndex;\
+        rightIndex = retrieveIndex;\
+      } else {\
+        leftIndex = retrieveIndex + 1;\
+      }\
+      \
+      retrieveIndex = (leftIndex + rightIndex) / 2;\
+    }\
+    \
+    return 0;\
+  }
+
+  #define DECLARE_STRING_KEYARRAY_MODIFY_PREFIX( funcName, listType,\
+      dataType )\
+  int funcName( listType* keyList, char* key, dataType* sourceData ) {\
+    size_t leftIndex;\
+    size_t rightIndex;\
+    size_t modifyIndex;\
+    int result;\
+    KeyArrayStringPrefix keyPrefix;\
+    size_t itemCount;\
+    listType##Item* item;\
+    size_t foundIndex;\
+    \
+    if( !(keyList && keyList->item && key && (*key) && sourceData) ) {\
+      return 0;\
+    }\
+    \
+    itemCount = keyList->itemCount;\
+    item = keyList->item;\
+    \
+    /* Look the key up in the hash index, if enabled */\
+    if( keyList->hashIndex ) {\
+      foundIndex = KeyArrayStringHashFind(keyList->hashIndex,\
+          &(item[0].key), sizeof(listType##Item), key);\
+      if( foundIndex == ((size_t)-1) ) {\
+        return 0;\
+      }\
+      memcpy( &(item[foundIndex].data), sourceData, sizeof(dataType) );\
+      return 1;\
+    }\
+    \
+    /* Pack the key prefix once, for every probe */\
+    KeyArraySetStringPrefix( &keyPrefix, key );\
+    \
+    /* Search for item */\
+    leftIndex = 0;\
+    rightIndex = itemCount;\
+    modifyIndex = itemCount / 2;\
+    \
+    while( leftIndex < rightIndex ) {\
+      result = KeyArrayCompareStringPrefix(&(item[modifyIndex].keyPrefix),\
+          item[modifyIndex].key, &keyPrefix, key);\
+      \
+      if( result == 0 ) {\
+        memcpy( &(item[modifyIndex].data), sourceData, sizeof(dataType) );\
+        return 1;\
+      }\
+      \
+      if( result > 0 ) {\
+        rightIndex = modifyIndex;\
+      } else {\
+        leftIndex = modifyIndex + 1;\
+      }\
+      \
+      modifyIndex = (leftIndex + rightIndex) / 2;\
+    }\
+    \
+    return 0;\
+  }
+
+  #define DECLARE_STRING_KEYARRAY_FINDINDEX_SIZE_PREFIX( funcName, listType )\
+  size_t funcName( listType* keyList, char* key ) {\
+    size_t leftIndex;\
+    size_t rightIndex;\
+    size_t searchIndex;\
+    int result;\
+    KeyArrayStringPrefix keyPrefix;\
+    size_t itemCount;\
+    listType##Item* item;\
+    size_t foundIndex;\
+    \
+    if( !(keyList && keyList->item && key && (*key)) ) {\
+      return ((size_t)-1);\
+    }\
+    \
+    itemCount = keyList->itemCount;\
+    item = keyList->item;\
+    \
+    /* Look the key up in the hash index, if enabled */\
+    if( keyList->hashIndex ) {\
+      foundIndex = KeyArrayStringHashFind(keyList->hashIndex,\
+          &(item[0].key), sizeof(listType##Item), key);\
+      if( foundIndex == ((size_t)-1) ) {\
+        return ((size_t)-1);\
+      }\
+      return foundIndex;\
+    }\
+    \
+    /* Pack the key prefix once, for every probe */\
+    KeyArraySetStringPrefix( &keyPrefix, key );\
+    \
+    /* Search for item */\
+    leftIndex = 0;\
+    rightIndex = itemCount;\
+    searchIndex = itemCount / 2;\
+    \
+    while( leftIndex < rightIndex ) {\
+      result = KeyArrayCompareStringPrefix(&(item[searchIndex].keyPrefix),\
+          item[searchIndex].key, &keyPrefix, key);\
+      \
+      if( result == 0 ) {\
+        return searchIndex;\
+      }\
+      \
+      if( result > 0 ) {\
+        rightIndex = searchIndex;\
+      } else {\
+        leftIndex = searchIndex + 1;\
+      }\
+      \
+      searchIndex = (leftIndex + rightIndex) / 2;\
+    }\
+    \
+    return ((size_t)-1);\
+  }
+
+  #define DECLARE_STRING_KEYARRAY_FINDINDEX_PREFIX( funcName, listType )\
+  KEYARRAY_DECLARE_FINDINDEX_INT( funcName, listType, listType, char*,\
+      DECLARE_STRING_KEYARRAY_FINDINDEX_SIZE_PREFIX )
+
+  #define DECLARE_STRING_KEYARRAY_LOWERBOUND_PREFIX( funcName, listType )\
+  size_t funcName( listType* keyList, char* key ) {\
+    if( !(keyList && keyList->item && key) ) {\
+      return 0;\
+    }\
+    \
+    return KeyArrayStringPrefixBound(&(keyList->item[0].keyPrefix),\
+        &(keyList->item[0].key), sizeof(listType##Item), keyList->itemCount,\
+        key, 0);\
+  }
+
+  #define DECLARE_STRING_KEYARRAY_UPPERBOUND_PREFIX( funcName, listType )\
+  size_t funcName( listType* keyList, char* key ) {\
+    if( !(keyList && keyList->item && key) ) {\
+      return 0;\
+    }\
+    \
+    return KeyArrayStringPrefixBound(&(keyList->item[0].keyPrefix),\
+        &(keyList->item[0].key), sizeof(listType##Item), keyList->itemCount,\
+        key, 1);\
+  }
+
+  #define DECLARE_STRING_KEYARRAY_RANGE_PREFIX( funcName, listType )\
+  size_t funcName( listType* keyList, char* firstKey,\
+      char* lastKey, size_t* beginIndex ) {\
+    size_t endIndex;\
+    \
+    if( !(keyList && beginIndex) ) {\
+      return 0;\
+    }\
+    \
+    (*beginIndex) = 0;\
+    if( !(keyList->item && firstKey && lastKey) ) {\
+      return 0;\
+    }\
+    \
+    (*beginIndex) = KeyArrayStringPrefixBound(&(keyList->item[0].keyPrefix),\
+        &(keyList->item[0].key), sizeof(listType##Item), keyList->itemCount,\
+        firstKey, 0);\
+    \
+    /* The last key can only be at, or after, the first key */\
+    endIndex = (*beginIndex) + KeyArrayStringPrefixBound(\
+        &(keyList->item[(*beginIndex)].keyPrefix),\
+        &(keyList->item[(*beginIndex)].key), sizeof(listType##Item),\
+        (keyList->itemCount - (*beginIndex)), lastKey, 1);\
+    \
+    return endIndex - (*beginIndex);\
+  }
+
+  #define DECLARE_STRING_KEYARRAY_RELEASEUNUSED_PREFIX( funcName,\
+      listType )\
+  DECLARE_STRING_KEYARRAY_RELEASEUNUSED( funcName, listType )
+
+  #define DECLARE_STRING_KEYARRAY_KEYARENA_PREFIX( funcName, listType )\
+  DECLARE_STRING_KEYARRAY_KEYARENA( funcName, listType )
+
+  #define DECLARE_STRING_KEYARRAY_HASHINDEX_PREFIX( funcName, listType )\
+  DECLARE_STRING_KEYARRAY_HASHINDEX( funcName, listType )
+
+  #define DECLARE_STRING_KEYARRAY_COPY_PREFIX( funcName, listType,\
+      dataType, copyDataFunc, freeDataFunc )\
+  listType* funcName( listType* sourceList ) {\
+    listType* newCopy = NULL;\
+    listType##Item* sourceItem = NULL;\
+    listType##Item* item = NULL;\
+    size_t reservedCount = 0;\
+    size_t itemCount = 0;\
+    size_t copiedCount = 0;\
+    char* keyCopy;\
+    size_t keyLen;\
+    size_t index;\
+    \
+    if( sourceList == NULL ) {\
+      return NULL;\
+    }\
+    \
+    /* Attempt to allocate list object */\
+    newCopy = (listType*)calloc(1, sizeof(listType));\
+    if( newCopy == NULL ) {\
+      goto ReturnError;\
+    }\
+    \
+    /* Initialize important variables */\
+    reservedCount = sourceList->reservedCount;\
+    itemCount = sourceList->itemCount;\
+    sourceItem = sourceList->item;\
+    \
+    /* A list with no items is valid */\
+    if( !(reservedCount && itemCount && sourceItem) ) {\
+      if( sourceList->keyArena ) {\
+        newCopy->keyArena = KeyArrayArenaCopy(sourceList->keyArena,\
+            NULL, sizeof(listType##Item), 0);\
+        if( newCopy->keyArena == NULL ) {\
+          goto ReturnError;\
+        }\
+      }\
+      return newCopy;\
+    }\
+    \
+    /* Copy data and prefixes, then copy the string keys */\
+    item = (listType##Item*)malloc(reservedCount * sizeof(listType##Item));\
+    if( item == NULL ) {\
+      goto ReturnError;\
+    }\
+    \
+    for( index = 0; index < itemCount; index++ ) {\
+      /* Arena keys are copied with the arena, after the items */\
+      keyCopy = sourceItem[index].key;\
+      if( sourceList->keyArena == NULL ) {\
+        keyLen = strlen(keyCopy);\
+        keyCopy = KeyArrayDuplicateKey(NULL, keyCopy, keyLen);\
+        if( keyCopy == NULL ) {\
+          goto ReturnError;\
+        }\
+      }\
+      \
+      /* Direct copy by default, allowing copy function to be empty */\
+      item[index] = sourceItem[index];\
+      item[index].key = keyCopy;\
+      if( copyDataFunc(&(item[index].data),\
+          &(sourceItem[index].data)) == 0 ) {\
+        if( sourceList->keyArena == NULL ) {\
+          free( keyCopy );\
+        }\
+        goto ReturnError;\
+      }\
+      \
+      copiedCount++;\
+    }\
+    \
+    if( sourceList->keyArena ) {\
+      newCopy->keyArena = KeyArrayArenaCopy(sourceList->keyArena,\
+          &(item[0].key), sizeof(listType##Item), itemCount);\
+      if( newCopy->keyArena == NULL ) {\
+        goto ReturnError;\
+      }\
+    }\
+    \
+    newCopy->reservedCount = reservedCount;\
+    newCopy->itemCount = itemCount;\
+    newCopy->item = item;\
+    \
+    return newCopy;\
+    \
+  ReturnError:\
+    if( item ) {\
+      for( index = 0; index < copiedCount; index++ ) {\
+        freeDataFunc( &(item[index].data) );\
+        if( sourceList->keyArena == NULL ) {\
+          free( item[index].key );\
+        }\
+      }\
+      free( item );\
+      item = NULL;\
+    }\
+    \
+    if( newCopy ) {\
+      free( newCopy );\
+      newCopy = NULL;\
+    }\
+    \
+    return NULL;\
+  }
+
+  #define DECLARE_STRING_KEYARRAY_BULKLOAD_PREFIX( funcName, listType,\
+      dataType, duplicatePolicy, mergeDataFunc, freeDataFunc )\
+  KEYARRAY_DECLARE_SORT( funcName##SortItems, listType##Item,\
+      KEYARRAY_COMPARE_STRING )\
+  \
+  listType* funcName( listType##Item* sourceItem, size_t sourceCount ) {\
+    listType* newList = NULL;\
+    listType##Item* item = NULL;\
+    listType##Item* scratch = NULL;\
+    size_t index;\
+    size_t runIndex;\
+    size_t keyedIndex = 0;\
+    size_t itemCount;\
+    size_t keyLen;\
+    char* keyCopy;\
+    \
+    if( (sourceItem == NULL) && sourceCount ) {\
+      return NULL;\
+    }\
+    \
+    newList = (listType*)calloc(1, sizeof(listType));\
+    if( newList == NULL ) {\
+      goto ReturnError;\
+    }\
+    \
+    /* A list with no items is valid */\
+    if( sourceCount == 0 ) {\
+      return newList;\
+    }\
+    \
+    for( index = 0; index < sourceCount; index++ ) {\
+      if( !(sourceItem[index].key && (*sourceItem[index].key)) ) {\
+        goto ReturnError;\
+      }\
+    }\
+    \
+    /* Allocate the list once, then sort in place */\
+    if( sourceCount > (((size_t)-1) / sizeof(listType##Item)) ) {\
+      goto ReturnError;\
+    }\
+    \
+    item = (listType##Item*)malloc(sourceCount * sizeof(listType##Item));\
+    scratch = (listType##Item*)malloc(sourceCount * sizeof(listType##Item));\
+    if( (item == NULL) || (scratch == NULL) ) {\
+      goto ReturnError;\
+    }\
+    \
+    memcpy( item, sourceItem, sourceCount * sizeof(listType##Item) );\
+    funcName##SortItems( item, scratch, sourceCount );\
+    \
+    free( scratch );\
+    scratch = NULL;\
+    \
+    /* Copy one key string, and pack its prefix, per run of equal keys,\
+       before touching data */\
+    while( keyedIndex < sourceCount ) {\
+      for( runIndex = keyedIndex + 1; (runIndex < sourceCount) &&\
+          (strcmp(item[runIndex].key, item[keyedIndex].key) == 0);\
+          runIndex++ ) {\
+      }\
+      \
+      if( ((runIndex - keyedIndex) > 1) &&\
+          ((duplicatePolicy) == KEYARRAY_DUPLICATES_REJECT) ) {\
+        goto ReturnError;\
+      }\
+      \
+      keyLen = strlen(item[keyedIndex].key);\
+      keyCopy = (char*)malloc(keyLen + 1);\
+      if( keyCopy == NULL ) {\
+        goto ReturnError;\
+      }\
+      memcpy( keyCopy, item[keyedIndex].key, keyLen + 1 );\
+      \
+      item[keyedIndex].key = keyCopy;\
+      KeyArraySetStringPrefix( &(item[keyedIndex].keyPrefix), keyCopy );\
+      keyedIndex = runIndex;\
+    }\
+    \
+    /* Resolve duplicates, and pack the list */\
+    itemCount = 0;\
+    for( index = 0; index < sourceCount; index = runIndex ) {\
+      item[itemCount] = item[index];\
+      \
+      for( runIndex = index + 1; (runIndex < sourceCount) &&\
+          (strcmp(item[runIndex].key, item[itemCount].key) == 0);\
+          runIndex++ ) {\
+        if( (duplicatePolicy) == KEYARRAY_DUPLICATES_LAST ) {\
+          freeDataFunc( &(item[itemCount].data) );\
+          item[itemCount].data = item[runIndex].data;\
+        } else {\
+          if( (duplicatePolicy) == KEYARRAY_DUPLICATES_MERGE ) {\
+            mergeDataFunc( &(item[itemCount].data),\
+                &(item[runIndex].data) );\
+          }\
+          freeDataFunc( &(item[runIndex].data) );\
+        }\
+      }\
+      \
+      itemCount++;\
+    }\
+    \
+    newList->reservedCount = sourceCount;\
+    newList->itemCount = itemCount;\
+    newList->item = item;\
+    \
+    return newList;\
+    \
+  ReturnError:\
+    if( item ) {\
+      /* Release key strings copied so far */\
+      for( index = 0; index < keyedIndex; index = runIndex ) {\
+        for( runIndex = index + 1; (runIndex < keyedIndex) &&\
+            (strcmp(item[runIndex].key, item[index].key) == 0);\
+            runIndex++ ) {\
+        }\
+        free( item[index].key );\
+      }\
+      free( item );\
+      item = NULL;\
+    }\
+    \
+    if( scratch ) {\
+      free( scratch );\
+      scratch = NULL;\
+    }\
+    \
+    if( newList ) {\
+      free( newList );\
+      newList = NULL;\
+    }\
+    \
+    return NULL;\
+  }
+
+  #define DECLARE_STRING_KEYARRAY_MERGEBATCH_PREFIX( funcName, listType,\
+      dataType, resolveDataFunc, freeDataFunc )\
+  KEYARRAY_DECLARE_SORT( funcName##SortItems, listType##Item,\
+      KEYARRAY_COMPARE_STRING )\
+  \
+  int funcName( listType* keyList, listType##Item* batchItem,\
+      size_t batchCount ) {\
+    listType##Item* batch = NULL;\
+    listType##Item* scratch = NULL;\
+    listType##Item* item;\
+    size_t reservedCount;\
+    size_t itemCount;\
+    size_t newCount;\
+    size_t batchIndex;\
+    size_t runIndex;\
+    size_t listIndex;\
+    size_t writeIndex;\
+    size_t leftIndex;\
+    size_t rightIndex;\
+    size_t searchIndex;\
+    size_t step;\
+    size_t keyedIndex = 0;\
+    size_t keyLen;\
+    char* keyCopy;\
+    \
+    if( !(keyList && (batchItem || (batchCount == 0))) ) {\
+      return 0;\
+    }\
+    \
+    if( batchCount == 0 ) {\
+      return 1;\
+    }\
+    \
+    for( batchIndex = 0; batchIndex < batchCount; batchIndex++ ) {\
+      if( !(batchItem[batchIndex].key && (*batchItem[batchIndex].key)) ) {\
+        return 0;\
+      }\
+    }\
+    \
+    /* Sort a copy of the batch */\
+    if( batchCount > (((size_t)-1) / sizeof(listType##Item)) ) {\
+      return 0;\
+    }\
+    \
+    batch = (listType##Item*)malloc(batchCount * sizeof(listType##Item));\
+    scratch = (listType##Item*)malloc(batchCount * sizeof(listType##Item));\
+    if( (batch == NULL) || (scratch == NULL) ) {\
+      goto ReturnError;\
+    }\
+    \
+    memcpy( batch, batchItem, batchCount * sizeof(listType##Item) );\
+    funcName##SortItems( batch, scratch, batchCount );\
+    \
+    for( batchIndex = 0; batchIndex < batchCount; batchIndex++ ) {\
+      KeyArraySetStringPrefix( &(batch[batchIndex].keyPrefix),\
+          batch[batchIndex].key );\
+    }\
+    \
+    itemCount = keyList->itemCount;\
+    item = keyList->item;\
+    \
+    /* Count new keys, galloping through the list. scratch[n].key\
+       holds the key copy for each new run of batch keys. */\
+    newCount = 0;\
+    listIndex = 0;\
+    for( batchIndex = 0; batchIndex < batchCount; batchIndex = runIndex ) {\
+      for( runIndex = batchIndex + 1; (runIndex < batchCount) &&\
+          (KEYARRAY_COMPARE_PREFIXED_ITEMS(batch[runIndex],\
+          batch[batchIndex]) == 0);\
+          runIndex++ ) {\
+        scratch[runIndex].key = NULL;\
+      }\
+      \
+      leftIndex = listIndex;\
+      rightIndex = listIndex;\
+      step = 1;\
+      while( (rightIndex < itemCount) &&\
+          (KEYARRAY_COMPARE_PREFIXED_ITEMS(item[rightIndex],\
+          batch[batchIndex]) < 0) ) {\
+        leftIndex = rightIndex + 1;\
+        rightIndex += step;\
+        step *= 2;\
+      }\
+      if( rightIndex > itemCount ) {\
+        rightIndex = itemCount;\
+      }\
+      \
+      while( leftIndex < rightIndex ) {\
+        searchIndex = leftIndex + ((rightIndex - leftIndex) / 2);\
+        if( KEYARRAY_COMPARE_PREFIXED_ITEMS(item[searchIndex],\
+            batch[batchIndex]) < 0 ) {\
+          leftIndex = searchIndex + 1;\
+        } else {\
+          rightIndex = searchIndex;\
+        }\
+      }\
+      listIndex = leftIndex;\
+      \
+      if( (listIndex < itemCount) &&\
+          (KEYARRAY_COMPARE_PREFIXED_ITEMS(item[listIndex],\
+          batch[batchIndex]) == 0) ) {\
+        scratch[batchIndex].key = NULL;\
+        continue;\
+      }\
+      \
+      keyLen = strlen(batch[batchIndex].key);\
+      keyCopy = KeyArrayDuplicateKey(keyList->keyArena,\
+          batch[batchIndex].key, keyLen);\
+      if( keyCopy == NULL ) {\
+        keyedIndex = batchIndex;\
+        goto ReturnError;\
+      }\
+      scratch[batchIndex].key = keyCopy;\
+      \
+      newCount++;\
+    }\
+    keyedIndex = batchCount;\
+    \
+    /* Grow list once, if necessary */\
+    reservedCount = keyList->reservedCount;\
+    if( (itemCount + newCount) > reservedCount ) {\
+      reservedCount = KEYARRAY_GROW_DEFAULT(reservedCount,\
+          itemCount + newCount);\
+      if( reservedCount > (((size_t)-1) / sizeof(listType##Item)) ) {\
+        goto ReturnError;\
+      }\
+      \
+      item = (listType##Item*)realloc(item,\
+          reservedCount * sizeof(listType##Item));\
+      if( item == NULL ) {\
+        goto ReturnError;\
+      }\
+      keyList->reservedCount = reservedCount;\
+      keyList->item = item;\
+    }\
+    \
+    /* Make room in the hash index, before changing any item */\
+    if( keyList->hashIndex && (KeyArrayStringHashReserve(keyList->hashIndex,\
+        itemCount + newCount) == 0) ) {\
+      goto ReturnError;\
+    }\
+    \
+    /* Merge from the back, moving each list item at most once */\
+    writeIndex = itemCount + newCount;\
+    listIndex = itemCount;\
+    batchIndex = batchCount;\
+    while( batchIndex > 0 ) {\
+      for( runIndex = batchIndex - 1; (runIndex > 0) &&\
+          (KEYARRAY_COMPARE_PREFIXED_ITEMS(batch[runIndex - 1],\
+          batch[runIndex]) == 0);\
+          runIndex-- ) {\
+      }\
+      \
+      if( writeIndex == listIndex ) {\
+        /* Remaining list items are in place, so search instead */\
+        leftIndex = 0;\
+        rightIndex = listIndex;\
+        while( leftIndex < rightIndex ) {\
+          searchIndex = leftIndex + ((rightIndex - leftIndex) / 2);\
+          if( KEYARRAY_COMPARE_PREFIXED_ITEMS(item[searchIndex],\
+              batch[runIndex]) > 0 ) {\
+            rightIndex = searchIndex;\
+          } else {\
+            leftIndex = searchIndex + 1;\
+          }\
+        }\
+        listIndex = leftIndex;\
+        writeIndex = leftIndex;\
+      } else {\
+        while( (listIndex > 0) &&\
+            (KEYARRAY_COMPARE_PREFIXED_ITEMS(item[listIndex - 1],\
+            batch[runIndex]) > 0) ) {\
+          listIndex--;\
+          writeIndex--;\
+          item[writeIndex] = item[listIndex];\
+        }\
+      }\
+      \
+      if( (listIndex > 0) &&\
+          (KEYARRAY_COMPARE_PREFIXED_ITEMS(item[listIndex - 1],\
+          batch[runIndex]) == 0) ) {\
+        /* Existing key: resolve each batch item into the list item */\
+        listIndex--;\
+        writeIndex--;\
+        for( searchIndex = runIndex; searchIndex < batchIndex;\
+            searchIndex++ ) {\
+          resolveDataFunc( &(item[listIndex].data),\
+              &(batch[searchIndex].data) );\
+          freeDataFunc( &(batch[searchIndex].data) );\
+        }\
+        if( writeIndex != listIndex ) {\
+          item[writeIndex] = item[listIndex];\
+        }\
+      } else {\
+        /* New key: resolve duplicates into the first batch item */\
+        for( searchIndex = runIndex + 1; searchIndex < batchIndex;\
+            searchIndex++ ) {\
+          resolveDataFunc( &(batch[runIndex].data),\
+              &(batch[searchIndex].data) );\
+          freeDataFunc( &(batch[searchIndex].data) );\
+        }\
+        writeIndex--;\
+        item[writeIndex].keyPrefix = batch[runIndex].keyPrefix;\
+        item[writeIndex].key = scratch[runIndex].key;\
+        item[writeIndex].data = batch[runIndex].data;\
+      }\
+      \
+      batchIndex = runIndex;\
+    }\
+    \
+    keyList->itemCount = itemCount + newCount;\
+    \
+    /* Items past the first new key have moved, so rehash every key */\
+    if( keyList->hashIndex && newCount ) {\
+      KeyArrayStringHashRefill( keyList->hashIndex,\
+          &(keyList->item[0].key), sizeof(listType##Item),\
+          keyList->itemCount );\
+    }\
+    \
+    free( scratch );\
+    free( batch );\
+    \
+    return 1;\
+    \
+  ReturnError:\
+    if( scratch ) {\
+      /* Release key strings copied so far */\
+      for( batchIndex = 0; batchIndex < keyedIndex; batchIndex++ ) {\
+        KeyArrayReleaseKey( keyList->keyArena, scratch[batchIndex].key );\
+      }\
+      free( scratch );\
+      scratch = NULL;\
+    }\
+    \
+    if( batch ) {\
+      free( batch );\
+      batch = NULL;\
+    }\
+    \
+    return 0;\
+  }
+
+  #define DECLARE_STRING_KEYARRAY_UNION_PREFIX( funcName, listType, dataType,\
+      copyDataFunc, combineDataFunc, freeDataFunc )\
+  KEYARRAY_DECLARE_SETOP( funcName, listType, String,\
+      KEYARRAY_COMPARE_PREFIXED_ITEMS, KEYARRAY_GALLOP_PREFIXED_ITEMS,\
+      KEYARRAY_SET_UNION, copyDataFunc, combineDataFunc,\
+      freeDataFunc )
+
+  #define DECLARE_STRING_KEYARRAY_INTERSECT_PREFIX( funcName, listType,\
+      dataType, combineDataFunc, freeDataFunc )\
+  KEYARRAY_DECLARE_SETOP( funcName, listType, String,\
+      KEYARRAY_COMPARE_PREFIXED_ITEMS, KEYARRAY_GALLOP_PREFIXED_ITEMS,\
+      KEYARRAY_SET_INTERSECT, KEYARRAY_SET_NO_COPY, combineDataFunc,\
+      freeDataFunc )
+
+  #define DECLARE_STRING_KEYARRAY_DIFFERENCE_PREFIX( funcName, listType,\
+      dataType, copyDataFunc, freeDataFunc )\
+  KEYARRAY_DECLARE_SETOP( funcName, listType, String,\
+      KEYARRAY_COMPARE_PREFIXED_ITEMS, KEYARRAY_GALLOP_PREFIXED_ITEMS,\
+      KEYARRAY_SET_DIFFERENCE, copyDataFunc, KEYARRAY_SET_NO_COMBINE,\
+      freeDataFunc )
+
+/*
+ * ===================================
+ *  Unsigned Key Array implementation
+ * ===================================
+ */
+
+  #define DECLARE_UINT_KEYARRAY_TYPES( typeName, dataType )\
+  KEYARRAY_DECLARE_UINT_TYPES( typeName, dataType, unsigned )
+
+  /* keyWidth is 16, 32, or 64 */
+  #define DECLARE_UINT_KEYARRAY_TYPES_WIDTH( typeName, dataType, keyWidth )\
+  KEYARRAY_DECLARE_UINT_TYPES( typeName, dataType, uint##keyWidth##_t )
+
+  /* Fails to compile, with funcNameUnsignedKey in the error, unless the
+     keys of listType are the size of unsigned. Saved files and logs
+     store unsigned keys. */
+  #define KEYARRAY_ASSERT_UINT_KEY( funcName, listType )\
+  typedef char funcName##UnsignedKey[(sizeof(listType##Key) ==\
+      sizeof(unsigned)) ? 1 : -1];
+
+  #define KEYARRAY_DECLARE_UINT_TYPES( typeName, dataType, keyType )\
+  typedef keyType typeName##Key;\
+  \
+  typedef struct typeName##Item {\
+    typeName##Key key;\
+    dataType data;\
+  } typeName##Item;\
+  \
+  typedef struct typeName {\
+    size_t reservedCount;\
+    size_t itemCount;\
+    typeName##Item* item;\
+    size_t generation;\
+    KeyArrayUintSearchIndex* searchIndex;\
+    KeyArrayLookupCache* lookupCache;\
+    size_t fingerIndex;\
+    KEYARRAY_STATS_FIELD\
+  } typeName;
+
+  #define DECLARE_UINT_KEYARRAY_CREATE( funcName, listType )\
+  listType* funcName( size_t reserveCount ) {\
+    listType* newKeyArray = NULL;\
+    \
+    newKeyArray = (listType*)calloc(1, sizeof(listType));\
+    if( newKeyArray == NULL ) {\
+      goto ReturnError;\
+    }\
+    \
+    if( reserveCount ) {\
+      newKeyArray->item =\
+        (listType##Item*)calloc(reserveCount, sizeof(listType##Item));\
+      if( newKeyArray->item == NULL ) {\
+        goto ReturnError;\
+      }\
+      \
+      newKeyArray->reservedCount = reserveCount;\
+    }\
+    return newKeyArray;\
+    \
+  ReturnError:\
+    if( newKeyArray ) {\
+      if( newKeyArray->item ) {\
+        free( newKeyArray->item );\
+        newKeyArray->item = NULL;\
+      }\
+      free( newKeyArray );\
+      newKeyArray = NULL;\
+    }\
+    return NULL;\
+  }
+
+  #define DECLARE_UINT_KEYARRAY_FREE( funcName, listType, freeDataFunc )\
+  void funcName( listType** keyList ) {\
+    size_t index;\
+    size_t itemCount;\
+    \
+    if( keyList && (*keyList) ) {\
+      itemCount = (*keyList)->itemCount;\
+      for( index = 0; index < itemCount; index++ ) {\
+        freeDataFunc( &((*keyList)->item[index].data) );\
+      }\
+      \
+      if( (*keyList)->item ) {\
+        free( (*keyList)->item );\
+      }\
+      KeyArrayUintFreeSearchIndex( &((*keyList)->searchIndex) );\
+      KeyArrayFreeLookupCache( &((*keyList)->lookupCache) );\
+      \
+      free( (*keyList) );\
+      (*keyList) = NULL;\
+    }\
+  }
+
+  #define DECLARE_UINT_KEYARRAY_INSERT( funcName, listType, dataType )\
+  DECLARE_UINT_KEYARRAY_INSERT_GROWTH( funcName, listType, dataType,\
+      KEYARRAY_GROW_DEFAULT )
+
+  #define KEYARRAY_DECLARE_UINT_INSERT_GROWTH( funcName, listType,\
+      dataType, growFunc )\
+  int funcName( listType* keyList,\
+      listType##Key key, dataType* data ) {\
+    size_t insertIndex;\
+    size_t reservedCount;\
+    size_t itemCount;\
+    listType##Item* item;\
+    \
+    if( !(keyList && data) ) {\
+      return 0;\
+    }\
+    \
+    /* Grow list, if necessary */\
+    reservedCount = keyList->reservedCount;\
+    itemCount = keyList->itemCount;\
+    item = keyList->item;\
+    \
+    if( itemCount == reservedCount ) {\
+      reservedCount = growFunc(reservedCount, itemCount + 1);\
+      if( (reservedCount <= itemCount) ||\
+          (reservedCount > (((size_t)-1) / sizeof(listType##Item))) ) {\
+        return 0;\
+      }\
+      \
+      item = (listType##Item*)realloc(item,\
+          reservedCount * sizeof(listType##Item));\
+      if( item == NULL ) {\
+        return 0;\
+      }\
+      KEYARRAY_STATS_REALLOC();\
+      keyList->reservedCount = reservedCount;\
+      keyList->item = item;\
+    }\
+    \
+    /* Search for insert position, from the last one */\
+    insertIndex = KeyArrayUintFingerBound(&(item[0].key),\
+        sizeof(listType##Item), sizeof(item[0].key), keyList->fingerIndex,\
+        itemCount, (uint64_t)key);\
+    if( (insertIndex < itemCount) && (item[insertIndex].key == key) ) {\
+      return 0;\
+    }\
+    \
+    /* Move data past insertion point up, if necessary */\
+    KEYARRAY_STATS_MOVE( (itemCount - insertIndex) * sizeof(listType##Item) );\
+    memmove( &(item[insertIndex + 1]), &(item[insertIndex]),\
+        (itemCount - insertIndex) * sizeof(listType##Item) );\
+    \
+    /* Insert item */\
+    item[insertIndex].key = key;\
+    if( data ) {\
+      memcpy( &(item[insertIndex].data), data, sizeof(dataType) );\
+    }\
+    \
+    keyList->itemCount++;\
+    keyList->generation++;\
+    keyList->fingerIndex = insertIndex;\
+    \
+    return 1;\
+  }
+
+  #define DECLARE_UINT_KEYARRAY_RESERVE( funcName, listType )\
+  int funcName( listType* keyList, size_t reserveCount ) {\
+    listType##Item* item;\
+    \
+    if( keyList == NULL ) {\
+      return 0;\
+    }\
+    \
+    if( reserveCount <= keyList->reservedCount ) {\
+      return 1;\
+    }\
+    \
+    if( reserveCount > (((size_t)-1) / sizeof(listType##Item)) ) {\
+      return 0;\
+    }\
+    \
+    item = (listType##Item*)realloc(keyList->item,\
+        reserveCount * sizeof(listType##Item));\
+    if( item == NULL ) {\
+      return 0;\
+    }\
+    \
+    keyList->item = item;\
+    keyList->reservedCount = reserveCount;\
+    \
+    return 1;\
+  }
+
+  #define KEYARRAY_DECLARE_UINT_REMOVE( funcName, listType, freeDataFunc )\
+  void funcName( listType* keyList, listType##Key key ) {\
+    size_t removeIndex;\
+    size_t itemCount;\
+    listType##Item* item;\
+    \
+    if( !(keyList && keyList->item) ) {\
+      return;\
+    }\
+    \
+    itemCount = keyList->itemCount;\
+    item = keyList->item;\
+    \
+    /* Search for insert position */\
+    removeIndex = KEYARRAY_UINT_ITEM_BOUND(item, itemCount, key, 0);\
+    if( (removeIndex < itemCount) && (item[removeIndex].key == key) ) {\
+      freeDataFunc( &(item[removeIndex].data) );\
+      \
+      if( itemCount ) {\
+        itemCount--;\
+        \
+        KEYARRAY_STATS_MOVE( (itemCount - removeIndex) *\
+            sizeof(listType##Item) );\
+        memmove( &(item[removeIndex]), &(item[removeIndex + 1]),\
+          (itemCount - removeIndex) * sizeof(listType##Item) );\
+        \
+        keyList->itemCount = itemCount;\
+        keyList->generation++;\
+      }\
+      \
+      memset( &(item[itemCount]), 0, sizeof(listType##Item) );\
+      \
+      return;\
+    }\
+  }
+
+  #define KEYARRAY_DECLARE_UINT_RETRIEVE( funcName, listType, dataType )\
+  int funcName( listType* keyList, listType##Key key,\
+      dataType* destData ) {\
+    size_t foundIndex;\
+    \
+    if( !(keyList && keyList->item && destData) ) {\
+      return 0;\
+    }\
+    \
+    foundIndex = KEYARRAY_UINT_LIST_FIND(keyList, key);\
+    if( foundIndex == ((size_t)-1) ) {\
+      return 0;\
+    }\
+    \
+    memcpy( destData, &(keyList->item[foundIndex].data), sizeof(dataType) );\
+    return 1;\
+  }
+
+  #define KEYARRAY_DECLARE_UINT_MODIFY( funcName, listType, dataType )\
+  int funcName( listType* keyList, listType##Key key,\
+      dataType* sourceData ) {\
+    size_t foundIndex;\
+    \
+    if( !(keyList && keyList->item && sourceData) ) {\
+      return 0;\
+    }\
+    \
+    foundIndex = KEYARRAY_UINT_LIST_FIND(keyList, key);\
+    if( foundIndex == ((size_t)-1) ) {\
+      return 0;\
+    }\
+    \
+    memcpy( &(keyList->item[foundIndex].data), sourceData,\
+        sizeof(dataType) );\
+    return 1;\
+  }
+
+  #define KEYARRAY_DECLARE_UINT_FINDINDEX( funcName, listType )\
+  size_t funcName( listType* keyList, listType##Key key ) {\
+    if( !(keyList && keyList->item) ) {\
+      return ((size_t)-1);\
+    }\
+    \
+    return KEYARRAY_UINT_LIST_FIND(keyList, key);\
+  }
+
+  #define KEYARRAY_DECLARE_UINT_GETPTR( funcName, listType, dataType )\
+  dataType* funcName( listType* keyList, listType##Key key ) {\
+    size_t foundIndex;\
+    \
+    if( !(keyList && keyList->item) ) {\
+      return NULL;\
+    }\
+    \
+    foundIndex = KEYARRAY_UINT_LIST_FIND(keyList, key);\
+    if( foundIndex == ((size_t)-1) ) {\
+      return NULL;\
+    }\
+    \
+    return &(keyList->item[foundIndex].data);\
+  }
+
+  #define KEYARRAY_DECLARE_UINT_UPDATE( funcName, listType, dataType,\
+      updateDataFunc )\
+  int funcName( listType* keyList, listType##Key key,\
+      dataType* sourceData ) {\
+    size_t foundIndex;\
+    \
+    if( !(keyList && keyList->item) ) {\
+      return 0;\
+    }\
+    \
+    foundIndex = KEYARRAY_UINT_LIST_FIND(keyList, key);\
+    if( foundIndex == ((size_t)-1) ) {\
+      return 0;\
+    }\
+    \
+    updateDataFunc( &(keyList->item[foundIndex].data), sourceData );\
+    \
+    return 1;\
+  }
+
+  #define DECLARE_UINT_KEYARRAY_UPSERT( funcName, listType, dataType )\
+  DECLARE_UINT_KEYARRAY_UPSERT_GROWTH( funcName, listType, dataType,\
+      KEYARRAY_GROW_DEFAULT )
+
+  #define KEYARRAY_DECLARE_UINT_UPSERT_GROWTH( funcName, listType,\
+      dataType, growFunc )\
+  dataType* funcName( listType* keyList, listType##Key key,\
+      dataType* data, int* inserted ) {\
+    size_t insertIndex = 0;\
+    size_t reservedCount;\
+    size_t itemCount;\
+    listType##Item* item;\
+    \
+    if( inserted ) {\
+      (*inserted) = 0;\
+    }\
+    \
+    if( !(keyList && data) ) {\
+      return NULL;\
+    }\
+    \
+    reservedCount = keyList->reservedCount;\
+    itemCount = keyList->itemCount;\
+    item = keyList->item;\
+    \
+    /* One search finds the key, or where to insert it, from the last\
+       position used */\
+    if( item ) {\
+      insertIndex = KeyArrayUintFingerBound(&(item[0].key),\
+          sizeof(listType##Item), sizeof(item[0].key), keyList->fingerIndex,\
+          itemCount, (uint64_t)key);\
+      if( (insertIndex < itemCount) && (item[insertIndex].key == key) ) {\
+        keyList->fingerIndex = insertIndex;\
+        return &(item[insertIndex].data);\
+      }\
+    }\
+    \
+    /* Grow list, if necessary */\
+    if( itemCount == reservedCount ) {\
+      reservedCount = growFunc(reservedCount, itemCount + 1);\
+      if( (reservedCount <= itemCount) ||\
+          (reservedCount > (((size_t)-1) / sizeof(listType##Item))) ) {\
+        return NULL;\
+      }\
+      \
+      item = (listType##Item*)realloc(item,\
+          reservedCount * sizeof(listType##Item));\
+      if( item == NULL ) {\
+        return NULL;\
+      }\
+      KEYARRAY_STATS_REALLOC();\
+      keyList->reservedCount = reservedCount;\
+      keyList->item = item;\
+    }\
+    \
+    /* Move data past insertion point up, if necessary */\
+    KEYARRAY_STATS_MOVE( (itemCount - insertIndex) * sizeof(listType##Item) );\
+    memmove( &(item[insertIndex + 1]), &(item[insertIndex]),\
+        (itemCount - insertIndex) * sizeof(listType##Item) );\
+    \
+    item[insertIndex].key = key;\
+    memcpy( &(item[insertIndex].data), data, sizeof(dataType) );\
+    \
+    keyList->itemCount++;\
+    keyList->fingerIndex = insertIndex;\
+    keyList->generation++;\
+    \
+    if( inserted ) {\
+      (*inserted) = 1;\
+    }\
+    \
+    return &(item[insertIndex].data);\
+  }
+
+  #define KEYARRAY_DECLARE_UINT_FINDINDEXMANY( funcName, listType )\
+  size_t funcName( listType* keyList, listType##Key* key, size_t keyCount,\
+      size_t* foundIndex ) {\
+    if( !(keyList && key && foundIndex) ) {\
+      return 0;\
+    }\
+    \
+    return KEYARRAY_UINT_LIST_FINDMANY(keyList, key, keyCount,\
+        foundIndex);\
+  }
+
+  #define KEYARRAY_DECLARE_UINT_RETRIEVEMANY( funcName, listType,\
+      dataType )\
+  size_t funcName( listType* keyList, listType##Key* key, size_t keyCount,\
+      dataType* destData, int* found ) {\
+    size_t foundIndex[KEYARRAY_BATCH_WIDTH];\
+    size_t batchIndex;\
+    size_t laneCount;\
+    size_t laneIndex;\
+    size_t foundCount = 0;\
+    \
+    if( !(keyList && key && destData) ) {\
+      return 0;\
+    }\
+    \
+    for( batchIndex = 0; batchIndex < keyCount; batchIndex += laneCount ) {\
+      laneCount = keyCount - batchIndex;\
+      if( laneCount > KEYARRAY_BATCH_WIDTH ) {\
+        laneCount = KEYARRAY_BATCH_WIDTH;\
+      }\
+      \
+      foundCount += KEYARRAY_UINT_LIST_FINDMANY(keyList,\
+          &(key[batchIndex]), laneCount, foundIndex);\
+      \
+      for( laneIndex = 0; laneIndex < laneCount; laneIndex++ ) {\
+        if( foundIndex[laneIndex] != ((size_t)-1) ) {\
+          memcpy( &(destData[batchIndex + laneIndex]),\
+              &(keyList->item[foundIndex[laneIndex]].data),\
+              sizeof(dataType) );\
+        }\
+        if( found ) {\
+          found[batchIndex + laneIndex] =\
+              (foundIndex[laneIndex] != ((size_t)-1));\
+        }\
+      }\
+    }\
+    \
+    return foundCount;\
+  }
+
+  /* Operations timed by KEYARRAY_STATS */
+  #if defined(KEYARRAY_STATS)
+
+  #define DECLARE_UINT_KEYARRAY_INSERT_GROWTH( funcName, listType,\
+      dataType, growFunc )\
+  KEYARRAY_DECLARE_TIMED( funcName, listType, KEYARRAY_STATS_INSERT, int,\
+      ( listType* keyList, listType##Key key, dataType* data ),\
+      ( keyList, key, data ),\
+      KEYARRAY_DECLARE_UINT_INSERT_GROWTH( funcName##Untimed, listType,\
+      dataType, growFunc ) )
+
+  #define DECLARE_UINT_KEYARRAY_REMOVE( funcName, listType, freeDataFunc )\
+  KEYARRAY_DECLARE_TIMED_VOID( funcName, listType, KEYARRAY_STATS_REMOVE,\
+      ( listType* keyList, listType##Key key ),\
+      ( keyList, key ),\
+      KEYARRAY_DECLARE_UINT_REMOVE( funcName##Untimed, listType,\
+      freeDataFunc ) )
+
+  #define DECLARE_UINT_KEYARRAY_RETRIEVE( funcName, listType, dataType )\
+  KEYARRAY_DECLARE_TIMED( funcName, listType, KEYARRAY_STATS_RETRIEVE, int,\
+      ( listType* keyList, listType##Key key, dataType* destData ),\
+      ( keyList, key, destData ),\
+      KEYARRAY_DECLARE_UINT_RETRIEVE( funcName##Untimed, listType,\
+      dataType ) )
+
+  #define DECLARE_UINT_KEYARRAY_MODIFY( funcName, listType, dataType )\
+  KEYARRAY_DECLARE_TIMED( funcName, listType, KEYARRAY_STATS_MODIFY, int,\
+      ( listType* keyList, listType##Key key, dataType* sourceData ),\
+      ( keyList, key, sourceData ),\
+      KEYARRAY_DECLARE_UINT_MODIFY( funcName##Untimed, listType,\
+      dataType ) )
+
+  #define DECLARE_UINT_KEYARRAY_FINDINDEX_SIZE( funcName, listType )\
+  KEYARRAY_DECLARE_TIMED( funcName, listType, KEYARRAY_STATS_FINDINDEX,\
+      size_t, ( listType* keyList, listType##Key key ),\
+      ( keyList, key ),\
+      KEYARRAY_DECLARE_UINT_FINDINDEX( funcName##Untimed, listType ) )
+
+
+  #define DECLARE_UINT_KEYARRAY_GETPTR( funcName, listType, dataType )\
+  KEYARRAY_DECLARE_TIMED( funcName, listType, KEYARRAY_STATS_RETRIEVE,\
+      dataType*, ( listType* keyList, listType##Key key ),\
+      ( keyList, key ),\
+      KEYARRAY_DECLARE_UINT_GETPTR( funcName##Untimed, listType,\
+      dataType ) )
+
+  #define DECLARE_UINT_KEYARRAY_UPDATE( funcName, listType, dataType,\
+      updateDataFunc )\
+  KEYARRAY_DECLARE_TIMED( funcName, listType, KEYARRAY_STATS_MODIFY, int,\
+      ( listType* keyList, listType##Key key, dataType* sourceData ),\
+      ( keyList, key, sourceData ),\
+      KEYARRAY_DECLARE_UINT_UPDATE( funcName##Untimed, listType,\
+      dataType, updateDataFunc ) )
+
+  #define DECLARE_UINT_KEYARRAY_UPSERT_GROWTH( funcName, listType,\
+      dataType, growFunc )\
+  KEYARRAY_DECLARE_TIMED( funcName, listType, KEYARRAY_STATS_INSERT,\
+      dataType*, ( listType* keyList, listType##Key key, dataType* data,\
+      int* inserted ),\
+      ( keyList, key, data, inserted ),\
+      KEYARRAY_DECLARE_UINT_UPSERT_GROWTH( funcName##Untimed, listType,\
+      dataType, growFunc ) )
+
+  #define DECLARE_UINT_KEYARRAY_FINDINDEXMANY( funcName, listType )\
+  KEYARRAY_DECLARE_TIMED( funcName, listType, KEYARRAY_STATS_FINDINDEX,\
+      size_t, ( listType* keyList, listType##Key* key, size_t keyCount,\
+      size_t* foundIndex ),\
+      ( keyList, key, keyCount, foundIndex ),\
+      KEYARRAY_DECLARE_UINT_FINDINDEXMANY( funcName##Untimed, listType ) )
+
+  #define DECLARE_UINT_KEYARRAY_RETRIEVEMANY( funcName, listType,\
+      dataType )\
+  KEYARRAY_DECLARE_TIMED( funcName, listType, KEYARRAY_STATS_RETRIEVE,\
+      size_t, ( listType* keyList, listType##Key* key, size_t keyCount,\
+      dataType* destData, int* found ),\
+      ( keyList, key, keyCount, destData, found ),\
+      KEYARRAY_DECLARE_UINT_RETRIEVEMANY( funcName##Untimed, listType,\
+      dataType ) )
+
+  #else
+
+  #define DECLARE_UINT_KEYARRAY_INSERT_GROWTH\
+    KEYARRAY_DECLARE_UINT_INSERT_GROWTH
+  #define DECLARE_UINT_KEYARRAY_REMOVE KEYARRAY_DECLARE_UINT_REMOVE
+  #define DECLARE_UINT_KEYARRAY_RETRIEVE KEYARRAY_DECLARE_UINT_RETRIEVE
+  #define DECLARE_UINT_KEYARRAY_MODIFY KEYARRAY_DECLARE_UINT_MODIFY
+  #define DECLARE_UINT_KEYARRAY_FINDINDEX_SIZE\
+    KEYARRAY_DECLARE_UINT_FINDINDEX
+  #define DECLARE_UINT_KEYARRAY_GETPTR KEYARRAY_DECLARE_UINT_GETPTR
+  #define DECLARE_UINT_KEYARRAY_UPDATE KEYARRAY_DECLARE_UINT_UPDATE
+  #define DECLARE_UINT_KEYARRAY_UPSERT_GROWTH\
+    KEYARRAY_DECLARE_UINT_UPSERT_GROWTH
+  #define DECLARE_UINT_KEYARRAY_FINDINDEXMANY\
+    KEYARRAY_DECLARE_UINT_FINDINDEXMANY
+  #define DECLARE_UINT_KEYARRAY_RETRIEVEMANY\
+    KEYARRAY_DECLARE_UINT_RETRIEVEMANY
+
+  #endif
+
+  #define DECLARE_UINT_KEYARRAY_FINDINDEX( funcName, listType )\
+  KEYARRAY_DECLARE_FINDINDEX_INT( funcName, listType, listType, listType##Key,\
+      DECLARE_UINT_KEYARRAY_FINDINDEX_SIZE )
+
+  #define DECLARE_UINT_KEYARRAY_STATS( funcName, listType )\
+  KEYARRAY_DECLARE_STATS( funcName, listType )
+
+  #define DECLARE_UINT_KEYARRAY_LOOKUPCACHE( funcName, listType )\
+  KEYARRAY_DECLARE_LOOKUPCACHE( funcName, listType )
+
+  #define DECLARE_UINT_KEYARRAY_CACHECOUNTS( funcName, listType )\
+  KEYARRAY_DECLARE_CACHECOUNTS( funcName, listType )
+
+  #define DECLARE_UINT_KEYARRAY_LOWERBOUND( funcName, listType )\
+  size_t funcName( listType* keyList, listType##Key key ) {\
+    if( !(keyList && keyList->item) ) {\
+      return 0;\
+    }\
+    \
+    return KEYARRAY_UINT_ITEM_BOUND(keyList->item, keyList->itemCount, key,\
+        0);\
+  }
+
+  #define DECLARE_UINT_KEYARRAY_UPPERBOUND( funcName, listType )\
+  size_t funcName( listType* keyList, listType##Key key ) {\
+    if( !(keyList && keyList->item) ) {\
+      return 0;\
+    }\
+    \
+    return KEYARRAY_UINT_ITEM_BOUND(keyList->item, keyList->itemCount, key,\
+        1);\
+  }
+
+  #define DECLARE_UINT_KEYARRAY_RANGE( funcName, listType )\
+  size_t funcName( listType* keyList, listType##Key firstKey,\
+      listType##Key lastKey, size_t* beginIndex ) {\
+    size_t endIndex;\
+    \
+    if( !(keyList && beginIndex) ) {\
+      return 0;\
+    }\
+    \
+    (*beginIndex) = 0;\
+    if( !(keyList->item) ) {\
+      return 0;\
+    }\
+    \
+    (*beginIndex) = KEYARRAY_UINT_ITEM_BOUND(keyList->item,\
+        keyList->itemCount, firstKey, 0);\
+    \
+    /* The last key can only be at, or after, the first key */\
+    endIndex = (*beginIndex) + KEYARRAY_UINT_ITEM_BOUND(\
+        &(keyList->item[(*beginIndex)]),\
+        (keyList->itemCount - (*beginIndex)), lastKey, 1);\
+    \
+    return endIndex - (*beginIndex);\
+  }
+
+  #define DECLARE_UINT_KEYARRAY_SEARCHINDEX( funcName, listType )\
+  int funcName( listType* keyList, int enable ) {\
+    KeyArrayUintSearchIndex* searchIndex;\
+    \
+    if( keyList == NULL ) {\
+      return 0;\
+    }\
+    \
+    if( enable == 0 ) {\
+      KeyArrayUintFreeSearchIndex( &(keyList->searchIndex) );\
+      return 1;\
+    }\
+    \
+    /* The search index holds 32 bit keys */\
+    if( sizeof(keyList->item[0].key) != sizeof(unsigned) ) {\
+      return 0;\
+    }\
+    \
+    searchIndex = keyList->searchIndex;\
+    if( searchIndex == NULL ) {\
+      searchIndex = (KeyArrayUintSearchIndex*)calloc(1,\
+          sizeof(KeyArrayUintSearchIndex));\
+      if( searchIndex == NULL ) {\
+        return 0;\
+      }\
+    }\
+    \
+    /* Build now, so that the first lookups do not pay for it */\
+    if( KeyArrayUintBuildSearchIndex(searchIndex, keyList->item,\
+        sizeof(listType##Item), keyList->itemCount,\
+        keyList->generation) == 0 ) {\
+      if( keyList->searchIndex == NULL ) {\
+        KeyArrayUintFreeSearchIndex( &searchIndex );\
+      }\
+      return 0;\
+    }\
+    \
+    keyList->searchIndex = searchIndex;\
+    \
+    return 1;\
+  }
+
+  #define DECLARE_UINT_KEYARRAY_RELEASEUNUSED( funcName, listType )\
+  void funcName( listType* keyList ) {\
+    listType##Item* item;\
+    \
+    if( keyList == NULL ) {\
+      return;\
+    }\
+    \
+    if( keyList->item && keyList->itemCount ) {\
+      /* Resize to remove reserved space */\
+      item = (listType##Item*)realloc(keyList->item,\
+        keyList->itemCount * sizeof(listType##Item));\
+      if( item ) {\
+        keyList->item = item;\
+        keyList->reservedCount = keyList->itemCount;\
+      }\
+    } else {\
+      /* Deallocate */\
+      keyList->reservedCount = 0;\
+      keyList->itemCount = 0;\
+      if( keyList->item ) {\
+        free( keyList->item );\
+        keyList->item = NULL;\
+      }\
+    }\
+  }
+
+  #define DECLARE_UINT_KEYARRAY_COPY( funcName, listType, dataType,\
+      copyDataFunc, freeDataFunc )\
+  listType* funcName( listType* sourceList ) {\
+    listType* newCopy = NULL;\
+    listType##Item* sourceItem = NULL;\
+    size_t reservedCount = 0;\
+    size_t itemCount = 0;\
+    size_t copiedCount = 0;\
+    size_t index;\
+    \
+    if( sourceList == NULL ) {\
+      return NULL;\
+    }\
+    \
+    /* Attempt to allocate list object */\
+    newCopy = (listType*)calloc(1, sizeof(listType));\
+    if( newCopy == NULL ) {\
+      goto ReturnError;\
+    }\
+    \
+    /* Initialize important variables */\
+    reservedCount = sourceList->reservedCount;\
+    itemCount = sourceList->itemCount;\
+    sourceItem = sourceList->item;\
+    \
+    /* A list with no items is valid */\
+    if( !(reservedCount && itemCount && sourceItem) ) {\
+      return newCopy;\
+    }\
+    \
+    /* Copy data, then copy the Uint keys */\
+    newCopy->item =\
+      (listType##Item*)malloc(reservedCount * sizeof(listType##Item));\
+    if( newCopy->item == NULL ) {\
+      goto ReturnError;\
+    }\
+    \
+    for( index = 0; index < itemCount; index++ ) {\
+     /* Direct copy by default, allowing copy function to be empty */\
+      newCopy->item[index].data = sourceItem[index].data;\
+      if( copyDataFunc(&(newCopy->item[index].data),\
+          &(sourceItem[index].data)) == 0 ) {\
+        goto ReturnError;\
+      }\
+      \
+      newCopy->item[index].key = sourceItem[index].key;\
+      copiedCount++;\
+    }\
+    \
+    newCopy->reservedCount = reservedCount;\
+    newCopy->itemCount = itemCount;\
+    \
+    return newCopy;\
+    \
+  ReturnError:\
+    if( newCopy == NULL ) {\
+      return NULL;\
+    }\
+    \
+    for( index = 0; index < copiedCount; index++ ) {\
+      freeDataFunc( &(newCopy->item[index].data) );\
+    }\
+    \
+    if( newCopy->item ) {\
+      free( newCopy->item );\
+    }\
+    \
+    free( newCopy );\
+    newCopy = NULL;\
+    \
+    return NULL;\
+  }
+
+  #define DECLARE_UINT_KEYARRAY_BULKLOAD( funcName, listType, dataType,\
+      duplicatePolicy, mergeDataFunc, freeDataFunc )\
+  KEYARRAY_DECLARE_SORT( funcName##SortItems, listType##Item,\
+      KEYARRAY_COMPARE_UINT )\
+  \
+  listType* funcName( listType##Item* sourceItem, size_t sourceCount ) {\
+    listType* newList = NULL;\
+    listType##Item* item = NULL;\
+    listType##Item* scratch = NULL;\
+    size_t index;\
+    size_t runIndex;\
+    size_t itemCount;\
+    \
+    if( (sourceItem == NULL) && sourceCount ) {\
+      return NULL;\
+    }\
+    \
+    newList = (listType*)calloc(1, sizeof(listType));\
+    if( newList == NULL ) {\
+      goto ReturnError;\
+    }\
+    \
+    /* A list with no items is valid */\
+    if( sourceCount == 0 ) {\
+      return newList;\
+    }\
+    \
+    /* Allocate the list once, then sort in place */\
+    if( sourceCount > (((size_t)-1) / sizeof(listType##Item)) ) {\
+      goto ReturnError;\
+    }\
+    \
+    item = (listType##Item*)malloc(sourceCount * sizeof(listType##Item));\
+    scratch = (listType##Item*)malloc(sourceCount * sizeof(listType##Item));\
+    if( (item == NULL) || (scratch == NULL) ) {\
+      goto ReturnError;\
+    }\
+    \
+    memcpy( item, sourceItem, sourceCount * sizeof(listType##Item) );\
+    funcName##SortItems( item, scratch, sourceCount );\
+    \
+    free( scratch );\
+    scratch = NULL;\
+    \
+    /* Check for rejected duplicates before touching data */\
+    if( (duplicatePolicy) == KEYARRAY_DUPLICATES_REJECT ) {\
+      for( index = 1; index < sourceCount; index++ ) {\
+        if( item[index - 1].key == item[index].key ) {\
+          goto ReturnError;\
+        }\
+      }\
+    }\
+    \
+    /* Resolve duplicates, and pack the list */\
+    itemCount = 0;\
+    for( index = 0; index < sourceCount; index = runIndex ) {\
+      item[itemCount] = item[index];\
+      \
+      for( runIndex = index + 1; (runIndex < sourceCount) &&\
+          (item[runIndex].key == item[itemCount].key); runIndex++ ) {\
+        if( (duplicatePolicy) == KEYARRAY_DUPLICATES_LAST ) {\
+          freeDataFunc( &(item[itemCount].data) );\
+          item[itemCount].data = item[runIndex].data;\
+        } else {\
+          if( (duplicatePolicy) == KEYARRAY_DUPLICATES_MERGE ) {\
+            mergeDataFunc( &(item[itemCount].data),\
+                &(item[runIndex].data) );\
+          }\
+          freeDataFunc( &(item[runIndex].data) );\
+        }\
+      }\
+      \
+      itemCount++;\
+    }\
+    \
+    newList->reservedCount = sourceCount;\
+    newList->itemCount = itemCount;\
+    newList->item = item;\
+    \
+    return newList;\
+    \
+  ReturnError:\
+    if( item ) {\
+      free( item );\
+      item = NULL;\
+    }\
+    \
+    if( scratch ) {\
+      free( scratch );\
+      scratch = NULL;\
+    }\
+    \
+    if( newList ) {\
+      free( newList );\
+      newList = NULL;\
+    }\
+    \
+    return NULL;\
+  }
+
+  #define DECLARE_UINT_KEYARRAY_MERGEBATCH( funcName, listType, dataType,\
+      resolveDataFunc, freeDataFunc )\
+  KEYARRAY_DECLARE_SORT( funcName##SortItems, listType##Item,\
+      KEYARRAY_COMPARE_UINT )\
+  \
+  int funcName( listType* keyList, listType##Item* batchItem,\
+      size_t batchCount ) {\
+    listType##Item* batch = NULL;\
+    listType##Item* scratch = NULL;\
+    listType##Item* item;\
+    size_t reservedCount;\
+    size_t itemCount;\
+    size_t newCount;\
+    size_t batchIndex;\
+    size_t runIndex;\
+    size_t listIndex;\
+    size_t writeIndex;\
+    size_t leftIndex;\
+    size_t rightIndex;\
+    size_t searchIndex;\
+    size_t step;\
+    \
+    if( !(keyList && (batchItem || (batchCount == 0))) ) {\
+      return 0;\
+    }\
+    \
+    if( batchCount == 0 ) {\
+      return 1;\
+    }\
+    \
+    /* Sort a copy of the batch */\
+    if( batchCount > (((size_t)-1) / sizeof(listType##Item)) ) {\
+      return 0;\
+    }\
+    \
+    batch = (listType##Item*)malloc(batchCount * sizeof(listType##Item));\
+    scratch = (listType##Item*)malloc(batchCount * sizeof(listType##Item));\
+    if( (batch == NULL) || (scratch == NULL) ) {\
+      goto ReturnError;\
+    }\
+    \
+    memcpy( batch, batchItem, batchCount * sizeof(listType##Item) );\
+    funcName##SortItems( batch, scratch, batchCount );\
+    \
+    itemCount = keyList->itemCount;\
+    item = keyList->item;\
+    \
+    /* Count new keys, galloping through the list */\
+    newCount = 0;\
+    listIndex = 0;\
+    for( batchIndex = 0; batchIndex < batchCount; batchIndex = runIndex ) {\
+      for( runIndex = batchIndex + 1; (runIndex < batchCount) &&\
+          (batch[runIndex].key == batch[batchIndex].key); runIndex++ ) {\
+      }\
+      \
+      leftIndex = listIndex;\
+      rightIndex = listIndex;\
+      step = 1;\
+      while( (rightIndex < itemCount) &&\
+          (item[rightIndex].key < batch[batchIndex].key) ) {\
+        leftIndex = rightIndex + 1;\
+        rightIndex += step;\
+        step *= 2;\
+      }\
+      if( rightIndex > itemCount ) {\
+        rightIndex = itemCount;\
+      }\
+      \
+      while( leftIndex < rightIndex ) {\
+        searchIndex = leftIndex + ((rightIndex - leftIndex) / 2);\
+        if( item[searchIndex].key < batch[batchIndex].key ) {\
+          leftIndex = searchIndex + 1;\
+        } else {\
+          rightIndex = searchIndex;\
+        }\
+      }\
+      listIndex = leftIndex;\
+      \
+      if( (listIndex < itemCount) &&\
+          (item[listIndex].key == batch[batchIndex].key) ) {\
+        continue;\
+      }\
+      \
+      newCount++;\
+    }\
+    \
+    /* Grow list once, if necessary */\
+    reservedCount = keyList->reservedCount;\
+    if( (itemCount + newCount) > reservedCount ) {\
+      reservedCount = KEYARRAY_GROW_DEFAULT(reservedCount,\
+          itemCount + newCount);\
+      if( reservedCount > (((size_t)-1) / sizeof(listType##Item)) ) {\
+        goto ReturnError;\
+      }\
+      \
+      item = (listType##Item*)realloc(item,\
+          reservedCount * sizeof(listType##Item));\
+      if( item == NULL ) {\
+        goto ReturnError;\
+      }\
+      keyList->reservedCount = reservedCount;\
+      keyList->item = item;\
+    }\
+    \
+    /* Merge from the back, moving each list item at most once */\
+    writeIndex = itemCount + newCount;\
+    listIndex = itemCount;\
+    batchIndex = batchCount;\
+    while( batchIndex > 0 ) {\
+      for( runIndex = batchIndex - 1; (runIndex > 0) &&\
+          (batch[runIndex - 1].key == batch[runIndex].key); runIndex-- ) {\
+      }\
+      \
+      if( writeIndex == listIndex ) {\
+        /* Remaining list items are in place, so search instead */\
+        leftIndex = 0;\
+        rightIndex = listIndex;\
+        while( leftIndex < rightIndex ) {\
+          searchIndex = leftIndex + ((rightIndex - leftIndex) / 2);\
+          if( item[searchIndex].key > batch[runIndex].key ) {\
+            rightIndex = searchIndex;\
+          } else {\
+            leftIndex = searchIndex + 1;\
+          }\
+        }\
+        listIndex = leftIndex;\
+        writeIndex = leftIndex;\
+      } else {\
+        while( (listIndex > 0) &&\
+            (item[listIndex - 1].key > batch[runIndex].key) ) {\
+          listIndex--;\
+          writeIndex--;\
+          item[writeIndex] = item[listIndex];\
+        }\
+      }\
+      \
+      if( (listIndex > 0) &&\
+          (item[listIndex - 1].key == batch[runIndex].key) ) {\
+        /* Existing key: resolve each batch item into the list item */\
+        listIndex--;\
+        writeIndex--;\
+        for( searchIndex = runIndex; searchIndex < batchIndex;\
+            searchIndex++ ) {\
+          resolveDataFunc( &(item[listIndex].data),\
+              &(batch[searchIndex].data) );\
+          freeDataFunc( &(batch[searchIndex].data) );\
+        }\
+        if( writeIndex != listIndex ) {\
+          item[writeIndex] = item[listIndex];\
+        }\
+      } else {\
+        /* New key: resolve duplicates into the first batch item */\
+        for( searchIndex = runIndex + 1; searchIndex < batchIndex;\
+            searchIndex++ ) {\
+          resolveDataFunc( &(batch[runIndex].data),\
+              &(batch[searchIndex].data) );\
+          freeDataFunc( &(batch[searchIndex].data) );\
+        }\
+        writeIndex--;\
+        item[writeIndex].key = batch[runIndex].key;\
+        item[writeIndex].data = batch[runIndex].data;\
+      }\
+      \
+      batchIndex = runIndex;\
+    }\
+    \
+    keyList->itemCount = itemCount + newCount;\
+    keyList->generation++;\
+    \
+    free( scratch );\
+    free( batch );\
+    \
+    return 1;\
+    \
+  ReturnError:\
+    if( scratch ) {\
+      free( scratch );\
+      scratch = NULL;\
+    }\
+    \
+    if( batch ) {\
+      free( batch );\
+      batch = NULL;\
+    }\
+    \
+    return 0;\
+  }
+
+  #define DECLARE_UINT_KEYARRAY_UNION( funcName, listType, dataType,\
+      copyDataFunc, combineDataFunc, freeDataFunc )\
+  KEYARRAY_DECLARE_SETOP( funcName, listType, Uint,\
+      KEYARRAY_COMPARE_UINT_ITEMS, KEYARRAY_GALLOP_UINT_ITEMS,\
+      KEYARRAY_SET_UNION, copyDataFunc, combineDataFunc,\
+      freeDataFunc )
+
+  #define DECLARE_UINT_KEYARRAY_INTERSECT( funcName, listType, dataType,\
+      combineDataFunc, freeDataFunc )\
+  KEYARRAY_DECLARE_SETOP( funcName, listType, Uint,\
+      KEYARRAY_COMPARE_UINT_ITEMS, KEYARRAY_GALLOP_UINT_ITEMS,\
+      KEYARRAY_SET_INTERSECT, KEYARRAY_SET_NO_COPY, combineDataFunc,\
+      freeDataFunc )
+
+  #define DECLARE_UINT_KEYARRAY_DIFFERENCE( funcName, listType, dataType,\
+      copyDataFunc, freeDataFunc )\
+  KEYARRAY_DECLARE_SETOP( funcName, listType, Uint,\
+      KEYARRAY_COMPARE_UINT_ITEMS, KEYARRAY_GALLOP_UINT_ITEMS,\
+      KEYARRAY_SET_DIFFERENCE, copyDataFunc, KEYARRAY_SET_NO_COMBINE,\
+      freeDataFunc )
+
+/*
+ * =============================================================
+ *  Unsigned Key Array implementation, structure of arrays layout
+ * =============================================================
+ */
+
+  #define DECLARE_UINT_KEYARRAY_TYPES_SOA( typeName, dataType )\
+  typedef struct typeName##Item {\
+    unsigned key;\
+    dataType data;\
+  } typeName##Item;\
+  \
+  typedef dataType typeName##Data;\
+  \
+  typedef struct typeName {\
+    size_t reservedCount;\
+    size_t itemCount;\
+    unsigned* keys;\
+    typeName##Data* data;\
+    size_t generation;\
+    KeyArrayUintSearchIndex* searchIndex;\
+    size_t fingerIndex;\
+  } typeName;
+
+  #define DECLARE_UINT_KEYARRAY_CREATE_SOA( funcName, listType )\
+  listType* funcName( size_t reserveCount ) {\
+    listType* newKeyArray = NULL;\
+    \
+    newKeyArray = (listType*)calloc(1, sizeof(listType));\
+    if( newKeyArray == NULL ) {\
+      goto ReturnError;\
+    }\
+    \
+    if( reserveCount ) {\
+      newKeyArray->keys = (unsigned*)calloc(reserveCount, sizeof(unsigned));\
+      newKeyArray->data =\
+        (listType##Data*)calloc(reserveCount, sizeof(listType##Data));\
+      if( (newKeyArray->keys == NULL) || (newKeyArray->data == NULL) ) {\
+        goto ReturnError;\
+      }\
+      \
+      newKeyArray->reservedCount = reserveCount;\
+    }\
+    return newKeyArray;\
+  \
+  ReturnError:\
+    if( newKeyArray ) {\
+      if( newKeyArray->keys ) {\
+        free( newKeyArray->keys );\
+        newKeyArray->keys = NULL;\
+      }\
+      if( newKeyArray->data ) {\
+        free( newKeyArray->data );\
+        newKeyArray->data = NULL;\
+      }\
+      free( newKeyArray );\
+      newKeyArray = NULL;\
+    }\
+    return NULL;\
+  }
+
+  #define DECLARE_UINT_KEYARRAY_FREE_SOA( funcName, listType, freeDataFunc )\
+  void funcName( listType** keyList ) {\
+    size_t index;\
+    size_t itemCount;\
+    \
+    if( keyList && (*keyList) ) {\
+      itemCount = (*keyList)->itemCount;\
+      for( index = 0; index < itemCount; index++ ) {\
+        freeDataFunc( &((*keyList)->data[index]) );\
+      }\
+      \
+      if( (*keyList)->keys ) {\
+        free( (*keyList)->keys );\
+      }\
+      if( (*keyList)->data ) {\
+        free( (*keyList)->data );\
+      }\
+      KeyArrayUintFreeSearchIndex( &((*keyList)->searchIndex) );\
+      \
+      free( (*keyList) );\
+      (*keyList) = NULL;\
+    }\
+  }
+
+  #define DECLARE_UINT_KEYARRAY_INSERT_SOA( funcName, listType, dataType )\
+  DECLARE_UINT_KEYARRAY_INSERT_GROWTH_SOA( funcName, listType, dataType,\
+      KEYARRAY_GROW_DEFAULT )
+
+  #define DECLARE_UINT_KEYARRAY_INSERT_GROWTH_SOA( funcName, listType,\
+      dataType, growFunc )\
+  int funcName( listType* keyList, unsigned key, dataType* data ) {\
+    size_t insertIndex;\
+    size_t reservedCount;\
+    size_t itemCount;\
+    unsigned* keys;\
+    dataType* itemData;\
+    \
+    if( !(keyList && data) ) {\
+      return 0;\
+    }\
+    \
+    /* Grow both arrays, if necessary */\
+    reservedCount = keyList->reservedCount;\
+    itemCount = keyList->itemCount;\
+    \
+    if( itemCount == reservedCount ) {\
+      reservedCount = growFunc(reservedCount, itemCount + 1);\
+      if( (reservedCount <= itemCount) ||\
+          (reservedCount > (((size_t)-1) / sizeof(dataType))) ||\
+          (reservedCount > (((size_t)-1) / sizeof(unsigned))) ) {\
+        return 0;\
+      }\
+      \
+      keys = (unsigned*)realloc(keyList->keys,\
+          reservedCount * sizeof(unsigned));\
+      if( keys == NULL ) {\
+        return 0;\
+      }\
+      keyList->keys = keys;\
+      \
+      itemData = (dataType*)realloc(keyList->data,\
+          reservedCount * sizeof(dataType));\
+      if( itemData == NULL ) {\
+        return 0;\
+      }\
+      keyList->data = itemData;\
+      keyList->reservedCount = reservedCount;\
+    }\
+    \
+    keys = keyList->keys;\
+    itemData = keyList->data;\
+    \
+    /* Search for insert position, from the last one */\
+    insertIndex = KeyArrayUintFingerBound(keys, sizeof(unsigned),\
+        sizeof(unsigned), keyList->fingerIndex, itemCount, (uint64_t)key);\
+    if( (insertIndex < itemCount) && (keys[insertIndex] == key) ) {\
+      return 0;\
+    }\
+    \
+    /* Move keys and data past insertion point up, if necessary */\
+    memmove( &(keys[insertIndex + 1]), &(keys[insertIndex]),\
+        (itemCount - insertIndex) * sizeof(unsigned) );\
+    memmove( &(itemData[insertIndex + 1]), &(itemData[insertIndex]),\
+        (itemCount - insertIndex) * sizeof(dataType) );\
+    \
+    /* Insert item */\
+    keys[insertIndex] = key;\
+    memcpy( &(itemData[insertIndex]), data, sizeof(dataType) );\
+    \
+    keyList->itemCount++;\
+    keyList->generation++;\
+    keyList->fingerIndex = insertIndex;\
+    \
+    return 1;\
+  }
+
+  #define DECLARE_UINT_KEYARRAY_RESERVE_SOA( funcName, listType )\
+  int funcName( listType* keyList, size_t reserveCount ) {\
+    unsigned* keys;\
+    listType##Data* itemData;\
+    \
+    if( keyList == NULL ) {\
+      return 0;\
+    }\
+    \
+    if( reserveCount <= keyList->reservedCount ) {\
+      return 1;\
+    }\
+    \
+    if( (reserveCount > (((size_t)-1) / sizeof(listType##Data))) ||\
+        (reserveCount > (((size_t)-1) / sizeof(unsigned))) ) {\
+      return 0;\
+    }\
+    \
+    keys = (unsigned*)realloc(keyList->keys, reserveCount * sizeof(unsigned));\
+    if( keys == NULL ) {\
+      return 0;\
+    }\
+    keyList->keys = keys;\
+    \
+    itemData = (listType##Data*)realloc(keyList->data,\
+        reserveCount * sizeof(listType##Data));\
+    if( itemData == NULL ) {\
+      return 0;\
+    }\
+    keyList->data = itemData;\
+    keyList->reservedCount = reserveCount;\
+    \
+    return 1;\
+  }
+
+  #define DECLARE_UINT_KEYARRAY_REMOVE_SOA( funcName, listType,\
+      freeDataFunc )\
+  void funcName( listType* keyList, unsigned key ) {\
+    size_t removeIndex;\
+    size_t itemCount;\
+    unsigned* keys;\
+    listType##Data* itemData;\
+    \
+    if( !(keyList && keyList->keys) ) {\
+      return;\
+    }\
+    \
+    itemCount = keyList->itemCount;\
+    keys = keyList->keys;\
+    itemData = keyList->data;\
+    \
+    /* Search for item */\
+    removeIndex = KeyArrayUintLowerBound(keys,\
+        sizeof(unsigned), itemCount, key,\
+        KEYARRAY_UINT_LINEAR_THRESHOLD);\
+    if( (removeIndex < itemCount) && (keys[removeIndex] == key) ) {\
+      freeDataFunc( &(itemData[removeIndex]) );\
+      \
+      itemCount--;\
+      memmove( &(keys[removeIndex]), &(keys[removeIndex + 1]),\
+          (itemCount - removeIndex) * sizeof(unsigned) );\
+      memmove( &(itemData[removeIndex]), &(itemData[removeIndex + 1]),\
+          (itemCount - removeIndex) * sizeof(listType##Data) );\
+      \
+      keys[itemCount] = 0;\
+      memset( &(itemData[itemCount]), 0, sizeof(listType##Data) );\
+      keyList->itemCount = itemCount;\
+      keyList->generation++;\
+      \
+      return;\
+    }\
+  }
+
+  #define DECLARE_UINT_KEYARRAY_RETRIEVE_SOA( funcName, listType,\
+      dataType )\
+  int funcName( listType* keyList, unsigned key, dataType* destData ) {\
+    size_t retrieveIndex;\
+    unsigned* keys;\
+    size_t foundIndex;\
+    \
+    if( !(keyList && keyList->keys && destData) ) {\
+      return 0;\
+    }\
+    \
+    keys = keyList->keys;\
+    \
+    /* Search the read-optimized index, if enabled */\
+    if( keyList->searchIndex ) {\
+      foundIndex = KeyArrayUintSearch(keyList->searchIndex,\
+          keyList->keys, sizeof(unsigned), keyList->itemCount,\
+          keyList->generation, key);\
+      if( foundIndex == ((size_t)-1) ) {\
+        return 0;\
+      }\
+      memcpy( destData, &(keyList->data[foundIndex]), sizeof(dataType) );\
+      return 1;\
+    }\
+    \
+    /* Search keys only, then touch data once */\
+    retrieveIndex = KeyArrayUintLowerBound(keys,\
+        sizeof(unsigned), keyList->itemCount, key,\
+        KEYARRAY_UINT_LINEAR_THRESHOLD);\
+    if( (retrieveIndex < keyList->itemCount) &&\
+        (keys[retrieveIndex] == key) ) {\
+      memcpy( destData, &(keyList->data[retrieveIndex]),\
+          sizeof(dataType) );\
+      return 1;\
+    }\
+    \
+    return 0;\
+  }
+
+  #define DECLARE_UINT_KEYARRAY_MODIFY_SOA( funcName, listType, dataType )\
+  int funcName( listType* keyList, unsigned key, dataType* sourceData ) {\
+    size_t modifyIndex;\
+    unsigned* keys;\
+    size_t foundIndex;\
+    \
+    if( !(keyList && keyList->keys && sourceData) ) {\
+      return 0;\
+    }\
+    \
+    keys = keyList->keys;\
+    \
+    /* Search the read-optimized index, if enabled */\
+    if( keyList->searchIndex ) {\
+      foundIndex = KeyArrayUintSearch(keyList->searchIndex,\
+          keyList->keys, sizeof(unsigned), keyList->itemCount,\
+          keyList->generation, key);\
+      if( foundIndex == ((size_t)-1) ) {\
+        return 0;\
+      }\
+      memcpy( &(keyList->data[foundIndex]), sourceData, sizeof(dataType) );\
+      return 1;\
+    }\
+    \
+    /* Search keys only, then touch data once */\
+    modifyIndex = KeyArrayUintLowerBound(keys,\
+        sizeof(unsigned), keyList->itemCount, key,\
+        KEYARRAY_UINT_LINEAR_THRESHOLD);\
+    if( (modifyIndex < keyList->itemCount) && (keys[modifyIndex] == key) ) {\
+      memcpy( &(keyList->data[modifyIndex]), sourceData,\
+          sizeof(dataType) );\
+      return 1;\
+    }\
+    \
+    return 0;\
+  }
+
+  #define DECLARE_UINT_KEYARRAY_FINDINDEX_SIZE_SOA( funcName, listType )\
+  size_t funcName( listType* keyList, unsigned key ) {\
+    size_t searchIndex;\
+    unsigned* keys;\
+    size_t foundIndex;\
+    \
+    if( !(keyList && keyList->keys) ) {\
+      return ((size_t)-1);\
+    }\
+    \
+    keys = keyList->keys;\
+    \
+    /* Search the read-optimized index, if enabled */\
+    if( keyList->searchIndex ) {\
+      foundIndex = KeyArrayUintSearch(keyList->searchIndex,\
+          keyList->keys, sizeof(unsigned), keyList->itemCount,\
+          keyList->generation, key);\
+      if( foundIndex == ((size_t)-1) ) {\
+        return ((size_t)-1);\
+      }\
+      return foundIndex;\
+    }\
+    \
+    /* Search for item */\
+    searchIndex = KeyArrayUintLowerBound(keys,\
+        sizeof(unsigned), keyList->itemCount, key,\
+        KEYARRAY_UINT_LINEAR_THRESHOLD);\
+    if( (searchIndex < keyList->itemCount) && (keys[searchIndex] == key) ) {\
+      return searchIndex;\
+    }\
+    \
+    return ((size_t)-1);\
+  }
+
+  #define DECLARE_UINT_KEYARRAY_FINDINDEX_SOA( funcName, listType )\
+  KEYARRAY_DECLARE_FINDINDEX_INT( funcName, listType, listType, unsigned,\
+      DECLARE_UINT_KEYARRAY_FINDINDEX_SIZE_SOA )
+
+  #define DECLARE_UINT_KEYARRAY_LOWERBOUND_SOA( funcName, listType )\
+  size_t funcName( listType* keyList, unsigned key ) {\
+    if( !(keyList && keyList->keys) ) {\
+      return 0;\
+    }\
+    \
+    return KeyArrayUintBound(&(keyList->keys[0]), sizeof(unsigned),\
+        keyList->itemCount, key, 0);\
+  }
+
+  #define DECLARE_UINT_KEYARRAY_UPPERBOUND_SOA( funcName, listType )\
+  size_t funcName( listType* keyList, unsigned key ) {\
+    if( !(keyList && keyList->keys) ) {\
+      return 0;\
+    }\
+    \
+    return KeyArrayUintBound(&(keyList->keys[0]), sizeof(unsigned),\
+        keyList->itemCount, key, 1);\
+  }
+
+  #define DECLARE_UINT_KEYARRAY_RANGE_SOA( funcName, listType )\
+  size_t funcName( listType* keyList, unsigned firstKey,\
+      unsigned lastKey, size_t* beginIndex ) {\
+    size_t endIndex;\
+    \
+    if( !(keyList && beginIndex) ) {\
+      return 0;\
+    }\
+    \
+    (*beginIndex) = 0;\
+    if( !(keyList->keys) ) {\
+      return 0;\
+    }\
+    \
+    (*beginIndex) = KeyArrayUintBound(&(keyList->keys[0]), sizeof(unsigned),\
+        keyList->itemCount, firstKey, 0);\
+    \
+    /* The last key can only be at, or after, the first key */\
+    endIndex = (*beginIndex) + KeyArrayUintBound(\
+        &(keyList->keys[(*beginIndex)]), sizeof(unsigned),\
+        (keyList->itemCount - (*beginIndex)), lastKey, 1);\
+    \
+    return endIndex - (*beginIndex);\
+  }
+
+  #define DECLARE_UINT_KEYARRAY_SEARCHINDEX_SOA( funcName, listType )\
+  int funcName( listType* keyList, int enable ) {\
+    KeyArrayUintSearchIndex* searchIndex;\
+    \
+    if( keyList == NULL ) {\
+      return 0;\
+    }\
+    \
+    if( enable == 0 ) {\
+      KeyArrayUintFreeSearchIndex( &(keyList->searchIndex) );\
+      return 1;\
+    }\
+    \
+    searchIndex = keyList->searchIndex;\
+    if( searchIndex == NULL ) {\
+      searchIndex = (KeyArrayUintSearchIndex*)calloc(1,\
+          sizeof(KeyArrayUintSearchIndex));\
+      if( searchIndex == NULL ) {\
+        return 0;\
+      }\
+    }\
+    \
+    /* Build now, so that the first lookups do not pay for it */\
+    if( KeyArrayUintBuildSearchIndex(searchIndex, keyList->keys,\
+        sizeof(unsigned), keyList->itemCount, keyList->generation) == 0 ) {\
+      if( keyList->searchIndex == NULL ) {\
+        KeyArrayUintFreeSearchIndex( &searchIndex );\
+      }\
+      return 0;\
+    }\
+    \
+    keyList->searchIndex = searchIndex;\
+    \
+    return 1;\
+  }
+
+  #define DECLARE_UINT_KEYARRAY_RELEASEUNUSED_SOA( funcName, listType )\
+  void funcName( listType* keyList ) {\
+    unsigned* keys;\
+    listType##Data* itemData;\
+    \
+    if( keyList == NULL ) {\
+      return;\
+    }\
+    \
+    if( keyList->keys && keyList->data && keyList->itemCount ) {\
+      /* Resize to remove reserved space. Either array shrinking is\
+         enough to lower reservedCount. */\
+      keys = (unsigned*)realloc(keyList->keys,\
+        keyList->itemCount * sizeof(unsigned));\
+      if( keys ) {\
+        keyList->keys = keys;\
+      }\
+      \
+      itemData = (listType##Data*)realloc(keyList->data,\
+        keyList->itemCount * sizeof(listType##Data));\
+      if( itemData ) {\
+        keyList->data = itemData;\
+      }\
+      \
+      if( keys || itemData ) {\
+        keyList->reservedCount = keyList->itemCount;\
+      }\
+    } else {\
+      /* Deallocate */\
+      keyList->reservedCount = 0;\
+      keyList->itemCount = 0;\
+      if( keyList->keys ) {\
+        free( keyList->keys );\
+        keyList->keys = NULL;\
+      }\
+      if( keyList->data ) {\
+        free( keyList->data );\
+        keyList->data = NULL;\
+      }\
+    }\
+  }
+
+  #define DECLARE_UINT_KEYARRAY_COPY_SOA( funcName, listType, dataType,\
+      copyDataFunc, freeDataFunc )\
+  listType* funcName( listType* sourceList ) {\
+    listType* newCopy = NULL;\
+    size_t reservedCount = 0;\
+    size_t itemCount = 0;\
+    size_t copiedCount = 0;\
+    size_t index;\
+    \
+    if( sourceList == NULL ) {\
+      return NULL;\
+    }\
+    \
+    /* Attempt to allocate list object */\
+    newCopy = (listType*)calloc(1, sizeof(listType));\
+    if( newCopy == NULL ) {\
+      goto ReturnError;\
+    }\
+    \
+    /* Initialize important variables */\
+    reservedCount = sourceList->reservedCount;\
+    itemCount = sourceList->itemCount;\
+    \
+    /* A list with no items is valid */\
+    if( !(reservedCount && itemCount &&\
+        sourceList->keys && sourceList->data) ) {\
+      return newCopy;\
+    }\
+    \
+    newCopy->keys = (unsigned*)malloc(reservedCount * sizeof(unsigned));\
+    newCopy->data = (dataType*)malloc(reservedCount * sizeof(dataType));\
+    if( (newCopy->keys == NULL) || (newCopy->data == NULL) ) {\
+      goto ReturnError;\
+    }\
+    \
+    /* Copy data, then copy the Uint keys */\
+    for( index = 0; index < itemCount; index++ ) {\
+      /* Direct copy by default, allowing copy function to be empty */\
+      newCopy->data[index] = sourceList->data[index];\
+      if( copyDataFunc(&(newCopy->data[index]),\
+          &(sourceList->data[index])) == 0 ) {\
+        goto ReturnError;\
+      }\
+      \
+      newCopy->keys[index] = sourceList->keys[index];\
+      copiedCount++;\
+    }\
+    \
+    newCopy->reservedCount = reservedCount;\
+    newCopy->itemCount = itemCount;\
+    \
+    return newCopy;\
+    \
+  ReturnError:\
+    if( newCopy == NULL ) {\
+      return NULL;\
+    }\
+    \
+    for( index = 0; index < copiedCount; index++ ) {\
+      freeDataFunc( &(newCopy->data[index]) );\
+    }\
+    \
+    if( newCopy->keys ) {\
+      free( newCopy->keys );\
+    }\
+    if( newCopy->data ) {\
+      free( newCopy->data );\
+    }\
+    \
+    free( newCopy );\
+    newCopy = NULL;\
+    \
+    return NULL;\
+  }
+
+  #define DECLARE_UINT_KEYARRAY_BULKLOAD_SOA( funcName, listType, dataType,\
+      duplicatePolicy, mergeDataFunc, freeDataFunc )\
+  KEYARRAY_DECLARE_SORT( funcName##SortItems, listType##Item,\
+      KEYARRAY_COMPARE_UINT )\
+  \
+  listType* funcName( listType##Item* sourceItem, size_t sourceCount ) {\
+    listType* newList = NULL;\
+    listType##Item* item = NULL;\
+    listType##Item* scratch = NULL;\
+    unsigned* keys = NULL;\
+    dataType* itemData = NULL;\
+    size_t index;\
+    size_t runIndex;\
+    size_t itemCount;\
+    \
+    if( (sourceItem == NULL) && sourceCount ) {\
+      return NULL;\
+    }\
+    \
+    newList = (listType*)calloc(1, sizeof(listType));\
+    if( newList == NULL ) {\
+      goto ReturnError;\
+    }\
+    \
+    /* A list with no items is valid */\
+    if( sourceCount == 0 ) {\
+      return newList;\
+    }\
+    \
+    /* Allocate the list once, then sort pairs in place */\
+    if( sourceCount > (((size_t)-1) / sizeof(listType##Item)) ) {\
+      goto ReturnError;\
+    }\
+    \
+    item = (listType##Item*)malloc(sourceCount * sizeof(listType##Item));\
+    scratch = (listType##Item*)malloc(sourceCount * sizeof(listType##Item));\
+    keys = (unsigned*)malloc(sourceCount * sizeof(unsigned));\
+    itemData = (dataType*)malloc(sourceCount * sizeof(dataType));\
+    if( !(item && scratch && keys && itemData) ) {\
+      goto ReturnError;\
+    }\
+    \
+    memcpy( item, sourceItem, sourceCount * sizeof(listType##Item) );\
+    funcName##SortItems( item, scratch, sourceCount );\
+    \
+    free( scratch );\
+    scratch = NULL;\
+    \
+    /* Check for rejected duplicates before touching data */\
+    if( (duplicatePolicy) == KEYARRAY_DUPLICATES_REJECT ) {\
+      for( index = 1; index < sourceCount; index++ ) {\
+        if( item[index - 1].key == item[index].key ) {\
+          goto ReturnError;\
+        }\
+      }\
+    }\
+    \
+    /* Resolve duplicates, and pack the list */\
+    itemCount = 0;\
+    for( index = 0; index < sourceCount; index = runIndex ) {\
+      item[itemCount] = item[index];\
+      \
+      for( runIndex = index + 1; (runIndex < sourceCount) &&\
+          (item[runIndex].key == item[itemCount].key); runIndex++ ) {\
+        if( (duplicatePolicy) == KEYARRAY_DUPLICATES_LAST ) {\
+          freeDataFunc( &(item[itemCount].data) );\
+          item[itemCount].data = item[runIndex].data;\
+        } else {\
+          if( (duplicatePolicy) == KEYARRAY_DUPLICATES_MERGE ) {\
+            mergeDataFunc( &(item[itemCount].data),\
+                &(item[runIndex].data) );\
+          }\
+          freeDataFunc( &(item[runIndex].data) );\
+        }\
+      }\
+      \
+      itemCount++;\
+    }\
+    \
+    /* Split the pairs into keys and data */\
+    for( index = 0; index < itemCount; index++ ) {\
+      keys[index] = item[index].key;\
+      itemData[index] = item[index].data;\
+    }\
+    free( item );\
+    \
+    newList->reservedCount = sourceCount;\
+    newList->itemCount = itemCount;\
+    newList->keys = keys;\
+    newList->data = itemData;\
+    \
+    return newList;\
+    \
+  ReturnError:\
+    if( item ) {\
+      free( item );\
+      item = NULL;\
+    }\
+    \
+    if( scratch ) {\
+      free( scratch );\
+      scratch = NULL;\
+    }\
+    \
+    if( keys ) {\
+      free( keys );\
+      keys = NULL;\
+    }\
+    \
+    if( itemData ) {\
+      free( itemData );\
+      itemData = NULL;\
+    }\
+    \
+    if( newList ) {\
+      free( newList );\
+      newList = NULL;\
+    }\
+    \
+    return NULL;\
+  }
+
+  #define DECLARE_UINT_KEYARRAY_MERGEBATCH_SOA( funcName, listType, dataType,\
+      resolveDataFunc, freeDataFunc )\
+  KEYARRAY_DECLARE_SORT( funcName##SortItems, listType##Item,\
+      KEYARRAY_COMPARE_UINT )\
+  \
+  int funcName( listType* keyList, listType##Item* batchItem,\
+      size_t batchCount ) {\
+    listType##Item* batch = NULL;\
+    listType##Item* scratch = NULL;\
+    unsigned* keys;\
+    dataType* itemData;\
+    size_t reservedCount;\
+    size_t itemCount;\
+    size_t newCount;\
+    size_t batchIndex;\
+    size_t runIndex;\
+    size_t listIndex;\
+    size_t writeIndex;\
+    size_t leftIndex;\
+    size_t rightIndex;\
+    size_t searchIndex;\
+    size_t step;\
+    \
+    if( !(keyList && (batchItem || (batchCount == 0))) ) {\
+      return 0;\
+    }\
+    \
+    if( batchCount == 0 ) {\
+      return 1;\
+    }\
+    \
+    /* Sort a copy of the batch */\
+    if( batchCount > (((size_t)-1) / sizeof(listType##Item)) ) {\
+      return 0;\
+    }\
+    \
+    batch = (listType##Item*)malloc(batchCount * sizeof(listType##Item));\
+    scratch = (listType##Item*)malloc(batchCount * sizeof(listType##Item));\
+    if( (batch == NULL) || (scratch == NULL) ) {\
+      goto ReturnError;\
+    }\
+    \
+    memcpy( batch, batchItem, batchCount * sizeof(listType##Item) );\
+    funcName##SortItems( batch, scratch, batchCount );\
+    \
+    itemCount = keyList->itemCount;\
+    keys = keyList->keys;\
+    \
+    /* Count new keys, galloping through the list */\
+    newCount = 0;\
+    listIndex = 0;\
+    for( batchIndex = 0; batchIndex < batchCount; batchIndex = runIndex ) {\
+      for( runIndex = batchIndex + 1; (runIndex < batchCount) &&\
+          (batch[runIndex].key == batch[batchIndex].key); runIndex++ ) {\
+      }\
+      \
+      leftIndex = listIndex;\
+      rightIndex = listIndex;\
+      step = 1;\
+      while( (rightIndex < itemCount) &&\
+          (keys[rightIndex] < batch[batchIndex].key) ) {\
+        leftIndex = rightIndex + 1;\
+        rightIndex += step;\
+        step *= 2;\
+      }\
+      if( rightIndex > itemCount ) {\
+        rightIndex = itemCount;\
+      }\
+      \
+      while( leftIndex < rightIndex ) {\
+        searchIndex = leftIndex + ((rightIndex - leftIndex) / 2);\
+        if( keys[searchIndex] < batch[batchIndex].key ) {\
+          leftIndex = searchIndex + 1;\
+        } else {\
+          rightIndex = searchIndex;\
+        }\
+      }\
+      listIndex = leftIndex;\
+      \
+      if( (listIndex < itemCount) &&\
+          (keys[listIndex] == batch[batchIndex].key) ) {\
+        continue;\
+      }\
+      \
+      newCount++;\
+    }\
+    \
+    /* Grow list once, if necessary */\
+    reservedCount = keyList->reservedCount;\
+    if( (itemCount + newCount) > reservedCount ) {\
+      reservedCount = KEYARRAY_GROW_DEFAULT(reservedCount,\
+          itemCount + newCount);\
+      if( (reservedCount > (((size_t)-1) / sizeof(dataType))) ||\
+          (reservedCount > (((size_t)-1) / sizeof(unsigned))) ) {\
+        goto ReturnError;\
+      }\
+      \
+      keys = (unsigned*)realloc(keyList->keys,\
+          reservedCount * sizeof(unsigned));\
+      if( keys == NULL ) {\
+        goto ReturnError;\
+      }\
+      keyList->keys = keys;\
+      \
+      itemData = (dataType*)realloc(keyList->data,\
+          reservedCount * sizeof(dataType));\
+      if( itemData == NULL ) {\
+        goto ReturnError;\
+      }\
+      keyList->data = itemData;\
+      keyList->reservedCount = reservedCount;\
+    }\
+    itemData = keyList->data;\
+    \
+    /* Merge from the back, moving each list item at most once */\
+    writeIndex = itemCount + newCount;\
+    listIndex = itemCount;\
+    batchIndex = batchCount;\
+    while( batchIndex > 0 ) {\
+      for( runIndex = batchIndex - 1; (runIndex > 0) &&\
+          (batch[runIndex - 1].key == batch[runIndex].key); runIndex-- ) {\
+      }\
+      \
+      if( writeIndex == listIndex ) {\
+        /* Remaining list items are in place, so search instead */\
+        leftIndex = 0;\
+        rightIndex = listIndex;\
+        while( leftIndex < rightIndex ) {\
+          searchIndex = leftIndex + ((rightIndex - leftIndex) / 2);\
+          if( keys[searchIndex] > batch[runIndex].key ) {\
+            rightIndex = searchIndex;\
+          } else {\
+            leftIndex = searchIndex + 1;\
+          }\
+        }\
+        listIndex = leftIndex;\
+        writeIndex = leftIndex;\
+      } else {\
+        while( (listIndex > 0) &&\
+            (keys[listIndex - 1] > batch[runIndex].key) ) {\
+          listIndex--;\
+          writeIndex--;\
+          keys[writeIndex] = keys[listIndex];\
+          itemData[writeIndex] = itemData[listIndex];\
+        }\
+      }\
+      \
+      if( (listIndex > 0) &&\
+          (keys[listIndex - 1] == batch[runIndex].key) ) {\
+        /* Existing key: resolve each batch item into the list item */\
+        listIndex--;\
+        writeIndex--;\
+        for( searchIndex = runIndex; searchIndex < batchIndex;\
+            searchIndex++ ) {\
+          resolveDataFunc( &(itemData[listIndex]),\
+              &(batch[searchIndex].data) );\
+          freeDataFunc( &(batch[searchIndex].data) );\
+        }\
+        if( writeIndex != listIndex ) {\
+          keys[writeIndex] = keys[listIndex];\
+          itemData[writeIndex] = itemData[listIndex];\
+        }\
+      } else {\
+        /* New key: resolve duplicates into the first batch item */\
+        for( searchIndex = runIndex + 1; searchIndex < batchIndex;\
+            searchIndex++ ) {\
+          resolveDataFunc( &(batch[runIndex].data),\
+              &(batch[searchIndex].data) );\
+          freeDataFunc( &(batch[searchIndex].data) );\
+        }\
+        writeIndex--;\
+        keys[writeIndex] = batch[runIndex].key;\
+        itemData[writeIndex] = batch[runIndex].data;\
+      }\
+      \
+      batchIndex = runIndex;\
+    }\
+    \
+    keyList->itemCount = itemCount + newCount;\
+    keyList->generation++;\
+    \
+    free( scratch );\
+    free( batch );\
+    \
+    return 1;\
+    \
+  ReturnError:\
+    if( scratch ) {\
+      free( scratch );\
+      scratch = NULL;\
+    }\
+    \
+    if( batch ) {\
+      free( batch );\
+      batch = NULL;\
+    }\
+    \
+    return 0;\
+  }
+
+  #define DECLARE_UINT_KEYARRAY_UNION_SOA( funcName, listType, dataType,\
+      copyDataFunc, combineDataFunc, freeDataFunc )\
+  KEYARRAY_DECLARE_SETOP_SOA( funcName, listType, unsigned, Uint,\
+      KEYARRAY_COMPARE_UINT, KEYARRAY_SET_UNION, copyDataFunc,\
+      combineDataFunc, freeDataFunc )
+
+  #define DECLARE_UINT_KEYARRAY_INTERSECT_SOA( funcName, listType, dataType,\
+      combineDataFunc, freeDataFunc )\
+  KEYARRAY_DECLARE_SETOP_SOA( funcName, listType, unsigned, Uint,\
+      KEYARRAY_COMPARE_UINT, KEYARRAY_SET_INTERSECT, KEYARRAY_SET_NO_COPY,\
+      combineDataFunc, freeDataFunc )
+
+  #define DECLARE_UINT_KEYARRAY_DIFFERENCE_SOA( funcName, listType, dataType,\
+      copyDataFunc, freeDataFunc )\
+  KEYARRAY_DECLARE_SETOP_SOA( funcName, listType, unsigned, Uint,\
+      KEYARRAY_COMPARE_UINT, KEYARRAY_SET_DIFFERENCE, copyDataFunc,\
+      KEYARRAY_SET_NO_COMBINE, freeDataFunc )
+
+/*
+ * =================================
+ *  Custom Key Array implementation
+ * =================================
+ */
+
+  /* Key hooks for keys copied by value, that own no memory */
+  #define KEYARRAY_CUSTOM_COPY_VALUE( keyCopy, key )\
+    (((*(keyCopy)) = (key)), 1)
+
+  #define KEYARRAY_CUSTOM_NO_FREE( key ) ((void)(key))
+
+  #define DECLARE_CUSTOM_KEYARRAY_TYPES( typeName, keyType, dataType,\
+      compareKeyFunc )\
+  DECLARE_CUSTOM_KEYARRAY_TYPES_HOOKS( typeName, keyType, dataType,\
+      compareKeyFunc, KEYARRAY_CUSTOM_COPY_VALUE, KEYARRAY_CUSTOM_NO_FREE )
+
+  /* Declares the key hooks as static inline functions, so that the
+     developer's compare, copy, and free functions or macros expand
+     inline in each search loop */
+  #define DECLARE_CUSTOM_KEYARRAY_TYPES_HOOKS( typeName, keyType, dataType,\
+      compareKeyFunc, copyKeyFunc, freeKeyFunc )\
+  typedef keyType typeName##Key;\
+  \
+  typedef struct typeName##Item {\
+    typeName##Key key;\
+    dataType data;\
+  } typeName##Item;\
+  \
+  typedef struct typeName {\
+    size_t reservedCount;\
+    size_t itemCount;\
+    typeName##Item* item;\
+    size_t fingerIndex;\
+    KEYARRAY_STATS_FIELD\
+  } typeName;\
+  \
+  static inline int KeyArray##typeName##CompareKey( typeName##Key leftKey,\
+      typeName##Key rightKey ) {\
+    KEYARRAY_STATS_COMPARE( 1 );\
+    return compareKeyFunc(leftKey, rightKey);\
+  }\
+  \
+  static inline int KeyArray##typeName##CopyKey( typeName##Key* keyCopy,\
+      typeName##Key key ) {\
+    return copyKeyFunc(keyCopy, key);\
+  }\
+  \
+  static inline void KeyArray##typeName##FreeKey( typeName##Key key ) {\
+    freeKeyFunc( key );\
+  }\
+  \
+  static inline size_t KeyArray##typeName##Bound(\
+      const typeName##Item* item, size_t count, typeName##Key key,\
+      int upperBound ) {\
+    size_t leftIndex = 0;\
+    size_t halfCount;\
+    int result;\
+    \
+    if( count == 0 ) {\
+      return 0;\
+    }\
+    \
+    while( count > 1 ) {\
+      halfCount = count / 2;\
+      result = KeyArray##typeName##CompareKey(\
+          item[leftIndex + halfCount].key, key);\
+      if( (result < 0) || (upperBound && (result == 0)) ) {\
+        leftIndex += halfCount;\
+      }\
+      count -= halfCount;\
+    }\
+    \
+    result = KeyArray##typeName##CompareKey(item[leftIndex].key, key);\
+    return leftIndex + ((result < 0) || (upperBound && (result == 0)));\
+  }\
+  \
+  static inline int KeyArray##typeName##CompareItems(\
+      typeName##Item leftItem, typeName##Item rightItem ) {\
+    return KeyArray##typeName##CompareKey(leftItem.key, rightItem.key);\
+  }\
+  \
+  static inline size_t KeyArray##typeName##GallopItems(\
+      const typeName##Item* item, size_t startIndex, size_t count,\
+      typeName##Item keyItem ) {\
+    size_t leftIndex = startIndex;\
+    size_t rightIndex = startIndex;\
+    size_t step = 1;\
+    \
+    while( (rightIndex < count) && (KeyArray##typeName##CompareKey(\
+        item[rightIndex].key, keyItem.key) < 0) ) {\
+      leftIndex = rightIndex + 1;\
+      rightIndex += step;\
+      step *= 2;\
+    }\
+    if( rightIndex > count ) {\
+      rightIndex = count;\
+    }\
+    \
+    return leftIndex + KeyArray##typeName##Bound(&(item[leftIndex]),\
+        rightIndex - leftIndex, keyItem.key, 0);\
+  }\
+  \
+  static inline size_t KeyArray##typeName##FingerBound(\
+      const typeName##Item* item, size_t fingerIndex, size_t count,\
+      typeName##Key key ) {\
+    size_t leftIndex;\
+    size_t rightIndex;\
+    size_t probeIndex;\
+    size_t step = 1;\
+    \
+    if( count == 0 ) {\
+      return 0;\
+    }\
+    \
+    if( fingerIndex >= count ) {\
+      fingerIndex = count - 1;\
+    }\
+    \
+    if( KeyArray##typeName##CompareKey(item[fingerIndex].key, key) < 0 ) {\
+      /* Key is past the finger, check the last key before galloping */\
+      leftIndex = fingerIndex + 1;\
+      rightIndex = count;\
+      if( leftIndex < count ) {\
+        if( KeyArray##typeName##CompareKey(item[count - 1].key, key) < 0 ) {\
+          return count;\
+        }\
+        rightIndex = count - 1;\
+      }\
+      \
+      while( (step <= KEYARRAY_FINGER_REACH) &&\
+          ((fingerIndex + step) < rightIndex) ) {\
+        probeIndex = fingerIndex + step;\
+        if( KeyArray##typeName##CompareKey(item[probeIndex].key,\
+            key) >= 0 ) {\
+          rightIndex = probeIndex;\
+          break;\
+        }\
+        leftIndex = probeIndex + 1;\
+        step *= 2;\
+      }\
+    } else {\
+      /* Key is at or before the finger, gallop back */\
+      leftIndex = 0;\
+      rightIndex = fingerIndex;\
+      while( (step <= KEYARRAY_FINGER_REACH) && (step <= fingerIndex) ) {\
+        probeIndex = fingerIndex - step;\
+        if( KeyArray##typeName##CompareKey(item[probeIndex].key, key) < 0 ) {\
+          leftIndex = probeIndex + 1;\
+          break;\
+        }\
+        rightIndex = probeIndex;\
+        step *= 2;\
+      }\
+    }\
+    \
+    if( (rightIndex - leftIndex) > KEYARRAY_FINGER_REACH ) {\
+      leftIndex = 0;\
+      rightIndex = count;\
+    }\
+    \
+    return leftIndex + KeyArray##typeName##Bound(&(item[leftIndex]),\
+        rightIndex - leftIndex, key, 0);\
+  }\
+  \
+  /* Batched lookups, with the searches of KEYARRAY_BATCH_WIDTH keys in\
+     lockstep, the same as string and unsigned lists */\
+  static inline size_t KeyArray##typeName##FindMany(\
+      const typeName##Item* item, size_t count, const typeName##Key* key,\
+      size_t keyCount, size_t* foundIndex ) {\
+    size_t leftIndex[KEYARRAY_BATCH_WIDTH];\
+    size_t batchIndex;\
+    size_t laneCount;\
+    size_t laneIndex;\
+    size_t searchCount;\
+    size_t halfCount;\
+    size_t foundCount = 0;\
+    \
+    for( batchIndex = 0; batchIndex < keyCount; batchIndex += laneCount ) {\
+      laneCount = keyCount - batchIndex;\
+      if( laneCount > KEYARRAY_BATCH_WIDTH ) {\
+        laneCount = KEYARRAY_BATCH_WIDTH;\
+      }\
+      \
+      if( count == 0 ) {\
+        for( laneIndex = 0; laneIndex < laneCount; laneIndex++ ) {\
+          foundIndex[batchIndex + laneIndex] = (size_t)-1;\
+        }\
+        continue;\
+      }\
+      \
+      for( laneIndex = 0; laneIndex < laneCount; laneIndex++ ) {\
+        leftIndex[laneIndex] = 0;\
+      }\
+      \
+      for( searchCount = count; searchCount > 1;\
+          searchCount -= halfCount ) {\
+        halfCount = searchCount / 2;\
+        \
+        for( laneIndex = 0; laneIndex < laneCount; laneIndex++ ) {\
+          KEYARRAY_PREFETCH( &(item[leftIndex[laneIndex] + halfCount]) );\
+        }\
+        \
+        for( laneIndex = 0; laneIndex < laneCount; laneIndex++ ) {\
+          if( KeyArray##typeName##CompareKey(\
+              item[leftIndex[laneIndex] + halfCount].key,\
+              key[batchIndex + laneIndex]) <= 0 ) {\
+            leftIndex[laneIndex] += halfCount;\
+          }\
+        }\
+      }\
+      \
+      for( laneIndex = 0; laneIndex < laneCount; laneIndex++ ) {\
+        if( KeyArray##typeName##CompareKey(item[leftIndex[laneIndex]].key,\
+            key[batchIndex + laneIndex]) == 0 ) {\
+          foundIndex[batchIndex + laneIndex] = leftIndex[laneIndex];\
+          foundCount++;\
+        } else {\
+          foundIndex[batchIndex + laneIndex] = (size_t)-1;\
+        }\
+      }\
+    }\
+    \
+    return foundCount;\
+  }
+
+  #define DECLARE_CUSTOM_KEYARRAY_CREATE( funcName, listType )\
+  listType* funcName( size_t reserveCount ) {\
+    listType* newKeyArray = NULL;\
+    \
+    newKeyArray = (listType*)calloc(1, sizeof(listType));\
+    if( newKeyArray == NULL ) {\
+      goto ReturnError;\
+    }\
+    \
+    if( reserveCount ) {\
+      newKeyArray->item =\
+        (listType##Item*)calloc(reserveCount, sizeof(listType##Item));\
+      if( newKeyArray->item == NULL ) {\
+        goto ReturnError;\
+      }\
+      \
+      newKeyArray->reservedCount = reserveCount;\
+    }\
+    return newKeyArray;\
+    \
+  ReturnError:\
+    if( newKeyArray ) {\
+      if( newKeyArray->item ) {\
+        free( newKeyArray->item );\
+        newKeyArray->item = NULL;\
+      }\
+      free( newKeyArray );\
+      newKeyArray = NULL;\
+    }\
+    return NULL;\
+  }
+
+  #define DECLARE_CUSTOM_KEYARRAY_FREE( funcName, listType, freeDataFunc )\
+  void funcName( listType** keyList ) {\
+    size_t index;\
+    size_t itemCount;\
+    \
+    if( keyList && (*keyList) ) {\
+      itemCount = (*keyList)->itemCount;\
+      for( index = 0; index < itemCount; index++ ) {\
+        freeDataFunc( &((*keyList)->item[index].data) );\
+        KeyArray##listType##FreeKey( (*keyList)->item[index].key );\
+      }\
+      \
+      if( (*keyList)->item ) {\
+        free( (*keyList)->item );\
+      }\
+      \
+      free( (*keyList) );\
+      (*keyList) = NULL;\
+    }\
+  }
+
+  #define DECLARE_CUSTOM_KEYARRAY_INSERT( funcName, listType, dataType )\
+  DECLARE_CUSTOM_KEYARRAY_INSERT_GROWTH( funcName, listType, dataType,\
+      KEYARRAY_GROW_DEFAULT )
+
+  #define KEYARRAY_DECLARE_CUSTOM_INSERT_GROWTH( funcName, listType,\
+      dataType, growFunc )\
+  int funcName( listType* keyList,\
+      listType##Key key, dataType* data ) {\
+    size_t insertIndex;\
+    size_t reservedCount;\
+    size_t itemCount;\
+    listType##Item* item;\
+    listType##Key keyCopy;\
+    \
+    if( !(keyList && data) ) {\
+      return 0;\
+    }\
+    \
+    /* Grow list, if necessary */\
+    reservedCount = keyList->reservedCount;\
+    itemCount = keyList->itemCount;\
+    item = keyList->item;\
+    \
+    if( itemCount == reservedCount ) {\
+      reservedCount = growFunc(reservedCount, itemCount + 1);\
+      if( (reservedCount <= itemCount) ||\
+          (reservedCount > (((size_t)-1) / sizeof(listType##Item))) ) {\
+        return 0;\
+      }\
+      \
+      item = (listType##Item*)realloc(item,\
+          reservedCount * sizeof(listType##Item));\
+      if( item == NULL ) {\
+        return 0;\
+      }\
+      KEYARRAY_STATS_REALLOC();\
+      keyList->reservedCount = reservedCount;\
+      keyList->item = item;\
+    }\
+    \
+    /* Search for insert position, from the last one */\
+    insertIndex = KeyArray##listType##FingerBound(item,\
+        keyList->fingerIndex, itemCount, key);\
+    if( (insertIndex < itemCount) &&\
+        (KeyArray##listType##CompareKey(item[insertIndex].key, key) == 0) ) {\
+      return 0;\
+    }\
+    \
+    if( KeyArray##listType##CopyKey(&keyCopy, key) == 0 ) {\
+      return 0;\
+    }\
+    \
+    /* Move data past insertion point up, if necessary */\
+    KEYARRAY_STATS_MOVE( (itemCount - insertIndex) * sizeof(listType##Item) );\
+    memmove( &(item[insertIndex + 1]), &(item[insertIndex]),\
+        (itemCount - insertIndex) * sizeof(listType##Item) );\
+    \
+    /* Insert item */\
+    item[insertIndex].key = keyCopy;\
+    memcpy( &(item[insertIndex].data), data, sizeof(dataType) );\
+    \
+    keyList->itemCount++;\
+    keyList->fingerIndex = insertIndex;\
+    \
+    return 1;\
+  }
+
+  #define DECLARE_CUSTOM_KEYARRAY_RESERVE( funcName, listType )\
+  int funcName( listType* keyList, size_t reserveCount ) {\
+    listType##Item* item;\
+    \
+    if( keyList == NULL ) {\
+      return 0;\
+    }\
+    \
+    if( reserveCount <= keyList->reservedCount ) {\
+      return 1;\
+    }\
+    \
+    if( reserveCount > (((size_t)-1) / sizeof(listType##Item)) ) {\
+      return 0;\
+    }\
+    \
+    item = (listType##Item*)realloc(keyList->item,\
+        reserveCount * sizeof(listType##Item));\
+    if( item == NULL ) {\
+      return 0;\
+    }\
+    \
+    keyList->item = item;\
+    keyList->reservedCount = reserveCount;\
+    \
+    return 1;\
+  }
+
+  #define KEYARRAY_DECLARE_CUSTOM_REMOVE( funcName, listType, freeDataFunc )\
+  void funcName( listType* keyList, listType##Key key ) {\
+    size_t removeIndex;\
+    size_t itemCount;\
+    listType##Item* item;\
+    \
+    if( !(keyList && keyList->item) ) {\
+      return;\
+    }\
+    \
+    itemCount = keyList->itemCount;\
+    item = keyList->item;\
+    \
+    removeIndex = KeyArray##listType##Bound(item, itemCount, key, 0);\
+    if( (removeIndex < itemCount) &&\
+        (KeyArray##listType##CompareKey(item[removeIndex].key, key) == 0) ) {\
+      freeDataFunc( &(item[removeIndex].data) );\
+      KeyArray##listType##FreeKey( item[removeIndex].key );\
+      \
+      itemCount--;\
+      \
+      KEYARRAY_STATS_MOVE( (itemCount - removeIndex) *\
+          sizeof(listType##Item) );\
+      memmove( &(item[removeIndex]), &(item[removeIndex + 1]),\
+        (itemCount - removeIndex) * sizeof(listType##Item) );\
+      \
+      keyList->itemCount = itemCount;\
+      memset( &(item[itemCount]), 0, sizeof(listType##Item) );\
+    }\
+  }
+
+  #define KEYARRAY_DECLARE_CUSTOM_RETRIEVE( funcName, listType, dataType )\
+  int funcName( listType* keyList, listType##Key key,\
+      dataType* destData ) {\
+    size_t retrieveIndex;\
+    size_t itemCount;\
+    listType##Item* item;\
+    \
+    if( !(keyList && keyList->item && destData) ) {\
+      return 0;\
+    }\
+    \
+    itemCount = keyList->itemCount;\
+    item = keyList->item;\
+    \
+    retrieveIndex = KeyArray##listType##Bound(item, itemCount, key, 0);\
+    if( (retrieveIndex < itemCount) && (KeyArray##listType##CompareKey(\
+        item[retrieveIndex].key, key) == 0) ) {\
+      memcpy( destData, &(item[retrieveIndex].data), sizeof(dataType) );\
+      return 1;\
+    }\
+    \
+    return 0;\
+  }
+
+  #define KEYARRAY_DECLARE_CUSTOM_MODIFY( funcName, listType, dataType )\
+  int funcName( listType* keyList, listType##Key key,\
+      dataType* sourceData ) {\
+    size_t modifyIndex;\
+    size_t itemCount;\
+    listType##Item* item;\
+    \
+    if( !(keyList && keyList->item && sourceData) ) {\
+      return 0;\
+    }\
+    \
+    itemCount = keyList->itemCount;\
+    item = keyList->item;\
+    \
+    modifyIndex = KeyArray##listType##Bound(item, itemCount, key, 0);\
+    if( (modifyIndex < itemCount) &&\
+        (KeyArray##listType##CompareKey(item[modifyIndex].key, key) == 0) ) {\
+      memcpy( &(item[modifyIndex].data), sourceData, sizeof(dataType) );\
+      return 1;\
+    }\
+    \
+    return 0;\
+  }
+
+  #define KEYARRAY_DECLARE_CUSTOM_FINDINDEX( funcName, listType )\
+  size_t funcName( listType* keyList, listType##Key key ) {\
+    size_t searchIndex;\
+    size_t itemCount;\
+    listType##Item* item;\
+    \
+    if( !(keyList && keyList->item) ) {\
+      return ((size_t)-1);\
+    }\
+    \
+    itemCount = keyList->itemCount;\
+    item = keyList->item;\
+    \
+    searchIndex = KeyArray##listType##Bound(item, itemCount, key, 0);\
+    if( (searchIndex < itemCount) &&\
+        (KeyArray##listType##CompareKey(item[searchIndex].key, key) == 0) ) {\
+      return searchIndex;\
+    }\
+    \
+    return ((size_t)-1);\
+  }
+
+  #define KEYARRAY_DECLARE_CUSTOM_GETPTR( funcName, listType, dataType )\
+  dataType* funcName( listType* keyList, listType##Key key ) {\
+    size_t foundIndex;\
+    \
+    if( !(keyList && keyList->item) ) {\
+      return NULL;\
+    }\
+    \
+    foundIndex = KeyArray##listType##Bound(keyList->item,\
+        keyList->itemCount, key, 0);\
+    if( (foundIndex < keyList->itemCount) && (KeyArray##listType##CompareKey(\
+        keyList->item[foundIndex].key, key) == 0) ) {\
+      return &(keyList->item[foundIndex].data);\
+    }\
+    \
+    return NULL;\
+  }
+
+  #define KEYARRAY_DECLARE_CUSTOM_UPDATE( funcName, listType, dataType,\
+      updateDataFunc )\
+  int funcName( listType* keyList, listType##Key key,\
+      dataType* sourceData ) {\
+    size_t foundIndex;\
+    \
+    if( !(keyList && keyList->item) ) {\
+      return 0;\
+    }\
+    \
+    foundIndex = KeyArray##listType##Bound(keyList->item,\
+        keyList->itemCount, key, 0);\
+    if( (foundIndex < keyList->itemCount) && (KeyArray##listType##CompareKey(\
+        keyList->item[foundIndex].key, key) == 0) ) {\
+      updateDataFunc( &(keyList->item[foundIndex].data), sourceData );\
+      return 1;\
+    }\
+    \
+    return 0;\
+  }
+
+  #define DECLARE_CUSTOM_KEYARRAY_UPSERT( funcName, listType, dataType )\
+  DECLARE_CUSTOM_KEYARRAY_UPSERT_GROWTH( funcName, listType, dataType,\
+      KEYARRAY_GROW_DEFAULT )
+
+  #define KEYARRAY_DECLARE_CUSTOM_FINDINDEXMANY( funcName, listType )\
+  size_t funcName( listType* keyList, listType##Key* key, size_t keyCount,\
+      size_t* foundIndex ) {\
+    if( !(keyList && key && foundIndex) ) {\
+      return 0;\
+    }\
+    \
+    return KeyArray##listType##FindMany(keyList->item,\
+        keyList->item ? keyList->itemCount : 0, key, keyCount, foundIndex);\
+  }
+
+  #define KEYARRAY_DECLARE_CUSTOM_RETRIEVEMANY( funcName, listType,\
+      dataType )\
+  size_t funcName( listType* keyList, listType##Key* key, size_t keyCount,\
+      dataType* destData, int* found ) {\
+    size_t foundIndex[KEYARRAY_BATCH_WIDTH];\
+    size_t batchIndex;\
+    size_t laneCount;\
+    size_t laneIndex;\
+    size_t foundCount = 0;\
+    \
+    if( !(keyList && key && destData) ) {\
+      return 0;\
+    }\
+    \
+    for( batchIndex = 0; batchIndex < keyCount; batchIndex += laneCount ) {\
+      laneCount = keyCount - batchIndex;\
+      if( laneCount > KEYARRAY_BATCH_WIDTH ) {\
+        laneCount = KEYARRAY_BATCH_WIDTH;\
+      }\
+      \
+      foundCount += KeyArray##listType##FindMany(keyList->item,\
+          keyList->item ? keyList->itemCount : 0, &(key[batchIndex]),\
+          laneCount, foundIndex);\
+      \
+      for( laneIndex = 0; laneIndex < laneCount; laneIndex++ ) {\
+        if( foundIndex[laneIndex] != ((size_t)-1) ) {\
+          memcpy( &(destData[batchIndex + laneIndex]),\
+              &(keyList->item[foundIndex[laneIndex]].data),\
+              sizeof(dataType) );\
+        }\
+        if( found ) {\
+          found[batchIndex + laneIndex] =\
+              (foundIndex[laneIndex] != ((size_t)-1));\
+        }\
+      }\
+    }\
+    \
+    return foundCount;\
+  }
+
+  #define KEYARRAY_DECLARE_CUSTOM_UPSERT_GROWTH( funcName, listType,\
+      dataType, growFunc )\
+  dataType* funcName( listType* keyList, listType##Key key,\
+      dataType* data, int* inserted ) {\
+    size_t insertIndex = 0;\
+    size_t reservedCount;\
+    size_t itemCount;\
+    listType##Item* item;\
+    listType##Key keyCopy;\
+    \
+    if( inserted ) {\
+      (*inserted) = 0;\
+    }\
+    \
+    if( !(keyList && data) ) {\
+      return NULL;\
+    }\
+    \
+    reservedCount = keyList->reservedCount;\
+    itemCount = keyList->itemCount;\
+    item = keyList->item;\
+    \
+    /* One search finds the key, or where to insert it, from the last\
+       position used */\
+    if( item ) {\
+      insertIndex = KeyArray##listType##FingerBound(item,\
+          keyList->fingerIndex, itemCount, key);\
+      if( (insertIndex < itemCount) && (KeyArray##listType##CompareKey(\
+          item[insertIndex].key, key) == 0) ) {\
+        keyList->fingerIndex = insertIndex;\
+        return &(item[insertIndex].data);\
+      }\
+    }\
+    \
+    /* Grow list, if necessary */\
+    if( itemCount == reservedCount ) {\
+      reservedCount = growFunc(reservedCount, itemCount + 1);\
+      if( (reservedCount <= itemCount) ||\
+          (reservedCount > (((size_t)-1) / sizeof(listType##Item))) ) {\
+        return NULL;\
+      }\
+      \
+      item = (listType##Item*)realloc(item,\
+          reservedCount * sizeof(listType##Item));\
+      if( item == NULL ) {\
+        return NULL;\
+      }\
+      KEYARRAY_STATS_REALLOC();\
+      keyList->reservedCount = reservedCount;\
+      keyList->item = item;\
+    }\
+    \
+    if( KeyArray##listType##CopyKey(&keyCopy, key) == 0 ) {\
+      return NULL;\
+    }\
+    \
+    /* Move data past insertion point up, if necessary */\
+    KEYARRAY_STATS_MOVE( (itemCount - insertIndex) * sizeof(listType##Item) );\
+    memmove( &(item[insertIndex + 1]), &(item[insertIndex]),\
+        (itemCount - insertIndex) * sizeof(listType##Item) );\
+    \
+    item[insertIndex].key = keyCopy;\
+    memcpy( &(item[insertIndex].data), data, sizeof(dataType) );\
+    \
+    keyList->itemCount++;\
+    keyList->fingerIndex = insertIndex;\
+    \
+    if( inserted ) {\
+      (*inserted) = 1;\
+    }\
+    \
+    return &(item[insertIndex].data);\
+  }
+
+  /* Operations timed by KEYARRAY_STATS */
+  #if defined(KEYARRAY_STATS)
+
+  #define DECLARE_CUSTOM_KEYARRAY_INSERT_GROWTH( funcName, listType,\
+      dataType, growFunc )\
+  KEYARRAY_DECLARE_TIMED( funcName, listType, KEYARRAY_STATS_INSERT, int,\
+      ( listType* keyList, listType##Key key, dataType* data ),\
+      ( keyList, key, data ),\
+      KEYARRAY_DECLARE_CUSTOM_INSERT_GROWTH( funcName##Untimed, listType,\
+      dataType, growFunc ) )
+
+  #define DECLARE_CUSTOM_KEYARRAY_REMOVE( funcName, listType, freeDataFunc )\
+  KEYARRAY_DECLARE_TIMED_VOID( funcName, listType, KEYARRAY_STATS_REMOVE,\
+      ( listType* keyList, listType##Key key ),\
+      ( keyList, key ),\
+      KEYARRAY_DECLARE_CUSTOM_REMOVE( funcName##Untimed, listType,\
+      freeDataFunc ) )
+
+  #define DECLARE_CUSTOM_KEYARRAY_RETRIEVE( funcName, listType, dataType )\
+  KEYARRAY_DECLARE_TIMED( funcName, listType, KEYARRAY_STATS_RETRIEVE, int,\
+      ( listType* keyList, listType##Key key, dataType* destData ),\
+      ( keyList, key, destData ),\
+      KEYARRAY_DECLARE_CUSTOM_RETRIEVE( funcName##Untimed, listType,\
+      dataType ) )
+
+  #define DECLARE_CUSTOM_KEYARRAY_MODIFY( funcName, listType, dataType )\
+  KEYARRAY_DECLARE_TIMED( funcName, listType, KEYARRAY_STATS_MODIFY, int,\
+      ( listType* keyList, listType##Key key, dataType* sourceData ),\
+      ( keyList, key, sourceData ),\
+      KEYARRAY_DECLARE_CUSTOM_MODIFY( funcName##Untimed, listType,\
+      dataType ) )
+
+  #define DECLARE_CUSTOM_KEYARRAY_FINDINDEX_SIZE( funcName, listType )\
+  KEYARRAY_DECLARE_TIMED( funcName, listType, KEYARRAY_STATS_FINDINDEX,\
+      size_t, ( listType* keyList, listType##Key key ),\
+      ( keyList, key ),\
+      KEYARRAY_DECLARE_CUSTOM_FINDINDEX( funcName##Untimed, listType ) )
+
+
+  #define DECLARE_CUSTOM_KEYARRAY_GETPTR( funcName, listType, dataType )\
+  KEYARRAY_DECLARE_TIMED( funcName, listType, KEYARRAY_STATS_RETRIEVE,\
+      dataType*, ( listType* keyList, listType##Key key ),\
+      ( keyList, key ),\
+      KEYARRAY_DECLARE_CUSTOM_GETPTR( funcName##Untimed, listType,\
+      dataType ) )
+
+  #define DECLARE_CUSTOM_KEYARRAY_UPDATE( funcName, listType, dataType,\
+      updateDataFunc )\
+  KEYARRAY_DECLARE_TIMED( funcName, listType, KEYARRAY_STATS_MODIFY, int,\
+      ( listType* keyList, listType##Key key, dataType* sourceData ),\
+      ( keyList, key, sourceData ),\
+      KEYARRAY_DECLARE_CUSTOM_UPDATE( funcName##Untimed, listType,\
+      dataType, updateDataFunc ) )
+
+  #define DECLARE_CUSTOM_KEYARRAY_UPSERT_GROWTH( funcName, listType,\
+      dataType, growFunc )\
+  KEYARRAY_DECLARE_TIMED( funcName, listType, KEYARRAY_STATS_INSERT,\
+      dataType*, ( listType* keyList, listType##Key key, dataType* data,\
+      int* inserted ),\
+      ( keyList, key, data, inserted ),\
+      KEYARRAY_DECLARE_CUSTOM_UPSERT_GROWTH( funcName##Untimed, listType,\
+      dataType, growFunc ) )
+
+  #define DECLARE_CUSTOM_KEYARRAY_FINDINDEXMANY( funcName, listType )\
+  KEYARRAY_DECLARE_TIMED( funcName, listType, KEYARRAY_STATS_FINDINDEX,\
+      size_t, ( listType* keyList, listType##Key* key, size_t keyCount,\
+      size_t* foundIndex ),\
+      ( keyList, key, keyCount, foundIndex ),\
+      KEYARRAY_DECLARE_CUSTOM_FINDINDEXMANY( funcName##Untimed, listType ) )
+
+  #define DECLARE_CUSTOM_KEYARRAY_RETRIEVEMANY( funcName, listType,\
+      dataType )\
+  KEYARRAY_DECLARE_TIMED( funcName, listType, KEYARRAY_STATS_RETRIEVE,\
+      size_t, ( listType* keyList, listType##Key* key, size_t keyCount,\
+      dataType* destData, int* found ),\
+      ( keyList, key, keyCount, destData, found ),\
+      KEYARRAY_DECLARE_CUSTOM_RETRIEVEMANY( funcName##Untimed, listType,\
+      dataType ) )
+
+  #else
+
+  #define DECLARE_CUSTOM_KEYARRAY_INSERT_GROWTH\
+    KEYARRAY_DECLARE_CUSTOM_INSERT_GROWTH
+  #define DECLARE_CUSTOM_KEYARRAY_REMOVE KEYARRAY_DECLARE_CUSTOM_REMOVE
+  #define DECLARE_CUSTOM_KEYARRAY_RETRIEVE KEYARRAY_DECLARE_CUSTOM_RETRIEVE
+  #define DECLARE_CUSTOM_KEYARRAY_MODIFY KEYARRAY_DECLARE_CUSTOM_MODIFY
+  #define DECLARE_CUSTOM_KEYARRAY_FINDINDEX_SIZE\
+    KEYARRAY_DECLARE_CUSTOM_FINDINDEX
+  #define DECLARE_CUSTOM_KEYARRAY_GETPTR KEYARRAY_DECLARE_CUSTOM_GETPTR
+  #define DECLARE_CUSTOM_KEYARRAY_UPDATE KEYARRAY_DECLARE_CUSTOM_UPDATE
+  #define DECLARE_CUSTOM_KEYARRAY_UPSERT_GROWTH\
+    KEYARRAY_DECLARE_CUSTOM_UPSERT_GROWTH
+  #define DECLARE_CUSTOM_KEYARRAY_FINDINDEXMANY\
+    KEYARRAY_DECLARE_CUSTOM_FINDINDEXMANY
+  #define DECLARE_CUSTOM_KEYARRAY_RETRIEVEMANY\
+    KEYARRAY_DECLARE_CUSTOM_RETRIEVEMANY
+
+  #endif
+
+  #define DECLARE_CUSTOM_KEYARRAY_FINDINDEX( funcName, listType )\
+  KEYARRAY_DECLARE_FINDINDEX_INT( funcName, listType, listType, listType##Key,\
+      DECLARE_CUSTOM_KEYARRAY_FINDINDEX_SIZE )
+
+  #define DECLARE_CUSTOM_KEYARRAY_STATS( funcName, listType )\
+  KEYARRAY_DECLARE_STATS( funcName, listType )
+
+  #define DECLARE_CUSTOM_KEYARRAY_LOWERBOUND( funcName, listType )\
+  size_t funcName( listType* keyList, listType##Key key ) {\
+    if( !(keyList && keyList->item) ) {\
+      return 0;\
+    }\
+    \
+    return KeyArray##listType##Bound(keyList->item, keyList->itemCount,\
+        key, 0);\
+  }
+
+  #define DECLARE_CUSTOM_KEYARRAY_UPPERBOUND( funcName, listType )\
+  size_t funcName( listType* keyList, listType##Key key ) {\
+    if( !(keyList && keyList->item) ) {\
+      return 0;\
+    }\
+    \
+    return KeyArray##listType##Bound(keyList->item, keyList->itemCount,\
+        key, 1);\
+  }
+
+  #define DECLARE_CUSTOM_KEYARRAY_RANGE( funcName, listType )\
+  size_t funcName( listType* keyList, listType##Key firstKey,\
+      listType##Key lastKey, size_t* beginIndex ) {\
+    size_t endIndex;\
+    \
+    if( !(keyList && beginIndex) ) {\
+      return 0;\
+    }\
+    \
+    (*beginIndex) = 0;\
+    if( !(keyList->item) ) {\
+      return 0;\
+    }\
+    \
+    (*beginIndex) = KeyArray##listType##Bound(keyList->item,\
+        keyList->itemCount, firstKey, 0);\
+    \
+    /* The last key can only be at, or after, the first key */\
+    endIndex = (*beginIndex) + KeyArray##listType##Bound(\
+        &(keyList->item[(*beginIndex)]),\
+        (keyList->itemCount - (*beginIndex)), lastKey, 1);\
+    \
+    return endIndex - (*beginIndex);\
+  }
+
+  #define DECLARE_CUSTOM_KEYARRAY_RELEASEUNUSED( funcName, listType )\
+  void funcName( listType* keyList ) {\
+    listType##Item* item;\
+    \
+    if( keyList == NULL ) {\
+      return;\
+    }\
+    \
+    if( keyList->item && keyList->itemCount ) {\
+      /* Resize to remove reserved space */\
+      item = (listType##Item*)realloc(keyList->item,\
+        keyList->itemCount * sizeof(listType##Item));\
+      if( item ) {\
+        keyList->item = item;\
+        keyList->reservedCount = keyList->itemCount;\
+      }\
+    } else {\
+      /* Deallocate */\
+      keyList->reservedCount = 0;\
+      keyList->itemCount = 0;\
+      if( keyList->item ) {\
+        free( keyList->item );\
+        keyList->item = NULL;\
+      }\
+    }\
+  }
+
+  #define DECLARE_CUSTOM_KEYARRAY_COPY( funcName, listType, dataType,\
+      copyDataFunc, freeDataFunc )\
+  listType* funcName( listType* sourceList ) {\
+    listType* newCopy = NULL;\
+    listType##Item* sourceItem = NULL;\
+    size_t reservedCount = 0;\
+    size_t itemCount = 0;\
+    size_t copiedCount = 0;\
+    size_t index;\
+    \
+    if( sourceList == NULL ) {\
+      return NULL;\
+    }\
+    \
+    /* Attempt to allocate list object */\
+    newCopy = (listType*)calloc(1, sizeof(listType));\
+    if( newCopy == NULL ) {\
+      goto ReturnError;\
+    }\
+    \
+    /* Initialize important variables */\
+    reservedCount = sourceList->reservedCount;\
+    itemCount = sourceList->itemCount;\
+    sourceItem = sourceList->item;\
+    \
+    /* A list with no items is valid */\
+    if( !(reservedCount && itemCount && sourceItem) ) {\
+      return newCopy;\
+    }\
+    \
+    /* Copy data, then copy the keys */\
+    newCopy->item =\
+      (listType##Item*)malloc(reservedCount * sizeof(listType##Item));\
+    if( newCopy->item == NULL ) {\
+      goto ReturnError;\
+    }\
+    \
+    for( index = 0; index < itemCount; index++ ) {\
+      /* Direct copy by default, allowing copy function to be empty */\
+      newCopy->item[index].data = sourceItem[index].data;\
+      if( copyDataFunc(&(newCopy->item[index].data),\
+          &(sourceItem[index].data)) == 0 ) {\
+        goto ReturnError;\
+      }\
+      \
+      if( KeyArray##listType##CopyKey(&(newCopy->item[index].key),\
+          sourceItem[index].key) == 0 ) {\
+        freeDataFunc( &(newCopy->item[index].data) );\
+        goto ReturnError;\
+      }\
+      copiedCount++;\
+    }\
+    \
+    newCopy->reservedCount = reservedCount;\
+    newCopy->itemCount = itemCount;\
+    \
+    return newCopy;\
+    \
+  ReturnError:\
+    if( newCopy == NULL ) {\
+      return NULL;\
+    }\
+    \
+    for( index = 0; index < copiedCount; index++ ) {\
+      freeDataFunc( &(newCopy->item[index].data) );\
+      KeyArray##listType##FreeKey( newCopy->item[index].key );\
+    }\
+    \
+    if( newCopy->item ) {\
+      free( newCopy->item );\
+    }\
+    \
+    free( newCopy );\
+    newCopy = NULL;\
+    \
+    return NULL;\
+  }
+
+  #define DECLARE_CUSTOM_KEYARRAY_BULKLOAD( funcName, listType, dataType,\
+      duplicatePolicy, mergeDataFunc, freeDataFunc )\
+  KEYARRAY_DECLARE_SORT( funcName##SortItems, listType##Item,\
+      KeyArray##listType##CompareKey )\
+  \
+  listType* funcName( listType##Item* sourceItem, size_t sourceCount ) {\
+    listType* newList = NULL;\
+    listType##Item* item = NULL;\
+    listType##Item* scratch = NULL;\
+    size_t index;\
+    size_t runIndex;\
+    size_t keyedIndex = 0;\
+    size_t itemCount;\
+    \
+    if( (sourceItem == NULL) && sourceCount ) {\
+      return NULL;\
+    }\
+    \
+    newList = (listType*)calloc(1, sizeof(listType));\
+    if( newList == NULL ) {\
+      goto ReturnError;\
+    }\
+    \
+    /* A list with no items is valid */\
+    if( sourceCount == 0 ) {\
+      return newList;\
+    }\
+    \
+    /* Allocate the list once, then sort in place */\
+    if( sourceCount > (((size_t)-1) / sizeof(listType##Item)) ) {\
+      goto ReturnError;\
+    }\
+    \
+    item = (listType##Item*)malloc(sourceCount * sizeof(listType##Item));\
+    scratch = (listType##Item*)malloc(sourceCount * sizeof(listType##Item));\
+    if( (item == NULL) || (scratch == NULL) ) {\
+      goto ReturnError;\
+    }\
+    \
+    memcpy( item, sourceItem, sourceCount * sizeof(listType##Item) );\
+    funcName##SortItems( item, scratch, sourceCount );\
+    \
+    free( scratch );\
+    scratch = NULL;\
+    \
+    /* Copy one key per run of equal keys, before touching data */\
+    while( keyedIndex < sourceCount ) {\
+      for( runIndex = keyedIndex + 1; (runIndex < sourceCount) &&\
+          (KeyArray##listType##CompareKey(item[runIndex].key,\
+          item[keyedIndex].key) == 0); runIndex++ ) {\
+      }\
+      \
+      if( ((runIndex - keyedIndex) > 1) &&\
+          ((duplicatePolicy) == KEYARRAY_DUPLICATES_REJECT) ) {\
+        goto ReturnError;\
+      }\
+      \
+      if( KeyArray##listType##CopyKey(&(item[keyedIndex].key),\
+          item[keyedIndex].key) == 0 ) {\
+        goto ReturnError;\
+      }\
+      keyedIndex = runIndex;\
+    }\
+    \
+    /* Resolve duplicates, and pack the list */\
+    itemCount = 0;\
+    for( index = 0; index < sourceCount; index = runIndex ) {\
+      item[itemCount] = item[index];\
+      \
+      for( runIndex = index + 1; (runIndex < sourceCount) &&\
+          (KeyArray##listType##CompareKey(item[runIndex].key,\
+          item[itemCount].key) == 0); runIndex++ ) {\
+        if( (duplicatePolicy) == KEYARRAY_DUPLICATES_LAST ) {\
+          freeDataFunc( &(item[itemCount].data) );\
+          item[itemCount].data = item[runIndex].data;\
+        } else {\
+          if( (duplicatePolicy) == KEYARRAY_DUPLICATES_MERGE ) {\
+            mergeDataFunc( &(item[itemCount].data),\
+                &(item[runIndex].data) );\
+          }\
+          freeDataFunc( &(item[runIndex].data) );\
+        }\
+      }\
+      \
+      itemCount++;\
+    }\
+    \
+    newList->reservedCount = sourceCount;\
+    newList->itemCount = itemCount;\
+    newList->item = item;\
+    \
+    return newList;\
+    \
+  ReturnError:\
+    if( item ) {\
+      /* Release keys copied so far */\
+      for( index = 0; index < keyedIndex; index = runIndex ) {\
+        for( runIndex = index + 1; (runIndex < keyedIndex) &&\
+            (KeyArray##listType##CompareKey(item[runIndex].key,\
+            item[index].key) == 0); runIndex++ ) {\
+        }\
+        KeyArray##listType##FreeKey( item[index].key );\
+      }\
+      free( item );\
+      item = NULL;\
+    }\
+    \
+    if( scratch ) {\
+      free( scratch );\
+      scratch = NULL;\
+    }\
+    \
+    if( newList ) {\
+      free( newList );\
+      newList = NULL;\
+    }\
+    \
+    return NULL;\
+  }
+
+  #define DECLARE_CUSTOM_KEYARRAY_MERGEBATCH( funcName, listType, dataType,\
+      resolveDataFunc, freeDataFunc )\
+  KEYARRAY_DECLARE_SORT( funcName##SortItems, listType##Item,\
+      KeyArray##listType##CompareKey )\
+  \
+  int funcName( listType* keyList, listType##Item* batchItem,\
+      size_t batchCount ) {\
+    listType##Item* batch = NULL;\
+    listType##Item* scratch = NULL;\
+    listType##Item* item;\
+    size_t reservedCount;\
+    size_t itemCount;\
+    size_t newCount = 0;\
+    size_t keyIndex;\
+    size_t batchIndex;\
+    size_t runIndex;\
+    size_t listIndex;\
+    size_t writeIndex;\
+    size_t searchIndex;\
+    \
+    if( !(keyList && (batchItem || (batchCount == 0))) ) {\
+      return 0;\
+    }\
+    \
+    if( batchCount == 0 ) {\
+      return 1;\
+    }\
+    \
+    /* Sort a copy of the batch */\
+    if( batchCount > (((size_t)-1) / sizeof(listType##Item)) ) {\
+      return 0;\
+    }\
+    \
+    batch = (listType##Item*)malloc(batchCount * sizeof(listType##Item));\
+    scratch = (listType##Item*)malloc(batchCount * sizeof(listType##Item));\
+    if( (batch == NULL) || (scratch == NULL) ) {\
+      goto ReturnError;\
+    }\
+    \
+    memcpy( batch, batchItem, batchCount * sizeof(listType##Item) );\
+    funcName##SortItems( batch, scratch, batchCount );\
+    \
+    itemCount = keyList->itemCount;\
+    item = keyList->item;\
+    \
+    /* Count new keys, galloping through the list. scratch[n].key holds\
+       the key copy for the nth new run of batch keys. */\
+    listIndex = 0;\
+    for( batchIndex = 0; batchIndex < batchCount; batchIndex = runIndex ) {\
+      for( runIndex = batchIndex + 1; (runIndex < batchCount) &&\
+          (KeyArray##listType##CompareKey(batch[runIndex].key,\
+          batch[batchIndex].key) == 0); runIndex++ ) {\
+      }\
+      \
+      listIndex = KeyArray##listType##GallopItems(item, listIndex,\
+          itemCount, batch[batchIndex]);\
+      if( (listIndex < itemCount) && (KeyArray##listType##CompareKey(\
+          item[listIndex].key, batch[batchIndex].key) == 0) ) {\
+        continue;\
+      }\
+      \
+      if( KeyArray##listType##CopyKey(&(scratch[newCount].key),\
+          batch[batchIndex].key) == 0 ) {\
+        goto ReturnError;\
+      }\
+      newCount++;\
+    }\
+    \
+    /* Grow list once, if necessary */\
+    reservedCount = keyList->reservedCount;\
+    if( (itemCount + newCount) > reservedCount ) {\
+      reservedCount = KEYARRAY_GROW_DEFAULT(reservedCount,\
+          itemCount + newCount);\
+      if( reservedCount > (((size_t)-1) / sizeof(listType##Item)) ) {\
+        goto ReturnError;\
+      }\
+      \
+      item = (listType##Item*)realloc(item,\
+          reservedCount * sizeof(listType##Item));\
+      if( item == NULL ) {\
+        goto ReturnError;\
+      }\
+      keyList->reservedCount = reservedCount;\
+      keyList->item = item;\
+    }\
+    \
+    /* Merge from the back, moving each list item at most once. New runs\
+       are met in reverse, so their key copies are taken from the end. */\
+    writeIndex = itemCount + newCount;\
+    listIndex = itemCount;\
+    batchIndex = batchCount;\
+    keyIndex = newCount;\
+    while( batchIndex > 0 ) {\
+      for( runIndex = batchIndex - 1; (runIndex > 0) &&\
+          (KeyArray##listType##CompareKey(batch[runIndex - 1].key,\
+          batch[runIndex].key) == 0); runIndex-- ) {\
+      }\
+      \
+      if( writeIndex == listIndex ) {\
+        /* Remaining list items are in place, so search instead */\
+        listIndex = KeyArray##listType##Bound(item, listIndex,\
+            batch[runIndex].key, 1);\
+        writeIndex = listIndex;\
       } else {\
-        leftIndex = removeIndex + 1;\
+        while( (listIndex > 0) && (KeyArray##listType##CompareKey(\
+            item[listIndex - 1].key, batch[runIndex].key) > 0) ) {\
+          listIndex--;\
+          writeIndex--;\
+          item[writeIndex] = item[listIndex];\
+        }\
+      }\
+      \
+      if( (listIndex > 0) && (KeyArray##listType##CompareKey(\
+          item[listIndex - 1].key, batch[runIndex].key) == 0) ) {\
+        /* Existing key: resolve each batch item into the list item */\
+        listIndex--;\
+        writeIndex--;\
+        for( searchIndex = runIndex; searchIndex < batchIndex;\
+            searchIndex++ ) {\
+          resolveDataFunc( &(item[listIndex].data),\
+              &(batch[searchIndex].data) );\
+          freeDataFunc( &(batch[searchIndex].data) );\
+        }\
+        if( writeIndex != listIndex ) {\
+          item[writeIndex] = item[listIndex];\
+        }\
+      } else {\
+        /* New key: resolve duplicates into the first batch item */\
+        for( searchIndex = runIndex + 1; searchIndex < batchIndex;\
+            searchIndex++ ) {\
+          resolveDataFunc( &(batch[runIndex].data),\
+              &(batch[searchIndex].data) );\
+          freeDataFunc( &(batch[searchIndex].data) );\
+        }\
+        writeIndex--;\
+        keyIndex--;\
+        item[writeIndex].key = scratch[keyIndex].key;\
+        item[writeIndex].data = batch[runIndex].data;\
+      }\
+      \
+      batchIndex = runIndex;\
+    }\
+    \
+    keyList->itemCount = itemCount + newCount;\
+    \
+    free( scratch );\
+    free( batch );\
+    \
+    return 1;\
+    \
+  ReturnError:\
+    if( scratch ) {\
+      /* Release keys copied so far */\
+      for( batchIndex = 0; batchIndex < newCount; batchIndex++ ) {\
+        KeyArray##listType##FreeKey( scratch[batchIndex].key );\
+      }\
+      free( scratch );\
+      scratch = NULL;\
+    }\
+    \
+    if( batch ) {\
+      free( batch );\
+      batch = NULL;\
+    }\
+    \
+    return 0;\
+  }
+
+  #define DECLARE_CUSTOM_KEYARRAY_UNION( funcName, listType, dataType,\
+      copyDataFunc, combineDataFunc, freeDataFunc )\
+  KEYARRAY_DECLARE_SETOP( funcName, listType, listType,\
+      KeyArray##listType##CompareItems, KeyArray##listType##GallopItems,\
+      KEYARRAY_SET_UNION, copyDataFunc, combineDataFunc,\
+      freeDataFunc )
+
+  #define DECLARE_CUSTOM_KEYARRAY_INTERSECT( funcName, listType, dataType,\
+      combineDataFunc, freeDataFunc )\
+  KEYARRAY_DECLARE_SETOP( funcName, listType, listType,\
+      KeyArray##listType##CompareItems, KeyArray##listType##GallopItems,\
+      KEYARRAY_SET_INTERSECT, KEYARRAY_SET_NO_COPY, combineDataFunc,\
+      freeDataFunc )
+
+  #define DECLARE_CUSTOM_KEYARRAY_DIFFERENCE( funcName, listType, dataType,\
+      copyDataFunc, freeDataFunc )\
+  KEYARRAY_DECLARE_SETOP( funcName, listType, listType,\
+      KeyArray##listType##CompareItems, KeyArray##listType##GallopItems,\
+      KEYARRAY_SET_DIFFERENCE, copyDataFunc, KEYARRAY_SET_NO_COMBINE,\
+      freeDataFunc )
+
+/*
+ * ==========================================
+ *  Key Array implementation, blocked layout
+ * ==========================================
+ */
+
+  #ifndef KEYARRAY_BLOCK_SIZE
+    #define KEYARRAY_BLOCK_SIZE 256
+  #endif
+
+  #define KEYARRAY_DECLARE_BLOCKED_TYPES( typeName, keyType, dataType )\
+  typedef struct typeName##Item {\
+    keyType key;\
+    dataType data;\
+  } typeName##Item;\
+  \
+  typedef struct typeName##Block {\
+    size_t itemCount;\
+    typeName##Item item[KEYARRAY_BLOCK_SIZE];\
+  } typeName##Block;\
+  \
+  typedef struct typeName {\
+    size_t reservedBlocks;\
+    size_t itemCount;\
+    size_t blockCount;\
+    typeName##Block** block;\
+    keyType* blockKey;\
+  } typeName;
+
+  /* Declares findName, to find the block that holds, or would hold, key,
+     and the lower bound of key in that block. Returns non-zero if key is
+     in the list. */
+  #define KEYARRAY_DECLARE_BLOCKED_FIND( findName, listType, keyType,\
+      keyKind, compareKeys )\
+  static int findName( listType* keyList, keyType key,\
+      size_t* blockIndex, size_t* itemIndex ) {\
+    listType##Block* block;\
+    size_t blockCount = keyList->blockCount;\
+    size_t searchIndex;\
+    \
+    (*blockIndex) = 0;\
+    (*itemIndex) = 0;\
+    if( blockCount == 0 ) {\
+      return 0;\
+    }\
+    \
+    /* Find the last block that starts at, or before, key */\
+    searchIndex = KeyArray##keyKind##Bound(keyList->blockKey,\
+        sizeof(keyType), blockCount, key, 0);\
+    if( (searchIndex < blockCount) &&\
+        (compareKeys(keyList->blockKey[searchIndex], key) == 0) ) {\
+      (*blockIndex) = searchIndex;\
+      return 1;\
+    }\
+    \
+    if( searchIndex ) {\
+      (*blockIndex) = searchIndex - 1;\
+    }\
+    \
+    block = keyList->block[*blockIndex];\
+    searchIndex = KeyArray##keyKind##Bound(&(block->item[0].key),\
+        sizeof(listType##Item), block->itemCount, key, 0);\
+    (*itemIndex) = searchIndex;\
+    \
+    return (searchIndex < block->itemCount) &&\
+      (compareKeys(block->item[searchIndex].key, key) == 0);\
+  }
+
+  /* Declares resizeName, to resize the block and blockKey arrays to
+     reservedBlocks, which must not be less than blockCount */
+  #define KEYARRAY_DECLARE_BLOCKED_RESIZE( resizeName, listType, keyType )\
+  static int resizeName( listType* keyList, size_t reservedBlocks ) {\
+    listType##Block** block;\
+    keyType* blockKey;\
+    \
+    if( reservedBlocks > (((size_t)-1) / sizeof(listType##Block*)) ) {\
+      return 0;\
+    }\
+    \
+    if( reservedBlocks == 0 ) {\
+      if( keyList->block ) {\
+        free( keyList->block );\
+        keyList->block = NULL;\
+      }\
+      if( keyList->blockKey ) {\
+        free( keyList->blockKey );\
+        keyList->blockKey = NULL;\
+      }\
+      keyList->reservedBlocks = 0;\
+      return 1;\
+    }\
+    \
+    block = (listType##Block**)realloc(keyList->block,\
+        reservedBlocks * sizeof(listType##Block*));\
+    if( block == NULL ) {\
+      return 0;\
+    }\
+    keyList->block = block;\
+    \
+    blockKey = (keyType*)realloc(keyList->blockKey,\
+        reservedBlocks * sizeof(keyType));\
+    if( blockKey == NULL ) {\
+      return 0;\
+    }\
+    keyList->blockKey = blockKey;\
+    keyList->reservedBlocks = reservedBlocks;\
+    \
+    return 1;\
+  }
+
+  #define KEYARRAY_DECLARE_BLOCKED_CREATE( funcName, listType, keyType )\
+  KEYARRAY_DECLARE_BLOCKED_RESIZE( funcName##Resize, listType, keyType )\
+  \
+  listType* funcName( size_t reserveCount ) {\
+    listType* newKeyArray = NULL;\
+    \
+    newKeyArray = (listType*)calloc(1, sizeof(listType));\
+    if( newKeyArray == NULL ) {\
+      return NULL;\
+    }\
+    \
+    /* Blocks are allocated as they fill, so only reserve the index */\
+    if( reserveCount && (funcName##Resize(newKeyArray,\
+        (reserveCount / (KEYARRAY_BLOCK_SIZE / 2)) + 1) == 0) ) {\
+      funcName##Resize( newKeyArray, 0 );\
+      free( newKeyArray );\
+      return NULL;\
+    }\
+    \
+    return newKeyArray;\
+  }
+
+  #define KEYARRAY_DECLARE_BLOCKED_FREE( funcName, listType, keyKind,\
+      freeDataFunc )\
+  void funcName( listType** keyList ) {\
+    listType##Block* block;\
+    size_t blockIndex;\
+    size_t index;\
+    \
+    if( keyList && (*keyList) ) {\
+      for( blockIndex = 0; blockIndex < (*keyList)->blockCount;\
+          blockIndex++ ) {\
+        block = (*keyList)->block[blockIndex];\
+        for( index = 0; index < block->itemCount; index++ ) {\
+          KeyArray##keyKind##FreeKey( block->item[index].key );\
+          freeDataFunc( &(block->item[index].data) );\
+        }\
+        free( block );\
+      }\
+      \
+      if( (*keyList)->block ) {\
+        free( (*keyList)->block );\
+      }\
+      if( (*keyList)->blockKey ) {\
+        free( (*keyList)->blockKey );\
+      }\
+      free( (*keyList) );\
+      (*keyList) = NULL;\
+    }\
+  }
+
+  #define KEYARRAY_DECLARE_BLOCKED_INSERT( funcName, listType, keyType,\
+      dataType, keyKind, compareKeys, growFunc )\
+  KEYARRAY_DECLARE_BLOCKED_FIND( funcName##Find, listType, keyType,\
+      keyKind, compareKeys )\
+  KEYARRAY_DECLARE_BLOCKED_RESIZE( funcName##Resize, listType, keyType )\
+  \
+  int funcName( listType* keyList, keyType key, dataType* data ) {\
+    listType##Block* block;\
+    listType##Block* newBlock = NULL;\
+    size_t blockIndex;\
+    size_t itemIndex;\
+    size_t blockCount;\
+    size_t reservedBlocks;\
+    size_t splitCount;\
+    keyType keyCopy;\
+    \
+    if( !(keyList && data && KeyArray##keyKind##ValidKey(key)) ) {\
+      return 0;\
+    }\
+    \
+    if( funcName##Find(keyList, key, &blockIndex, &itemIndex) ) {\
+      return 0;\
+    }\
+    \
+    /* Grow the block index, in case a block is added */\
+    blockCount = keyList->blockCount;\
+    if( blockCount == keyList->reservedBlocks ) {\
+      reservedBlocks = growFunc(keyList->reservedBlocks, blockCount + 1);\
+      if( (reservedBlocks <= blockCount) ||\
+          (funcName##Resize(keyList, reservedBlocks) == 0) ) {\
+        return 0;\
+      }\
+    }\
+    \
+    if( (blockCount == 0) ||\
+        (keyList->block[blockIndex]->itemCount == KEYARRAY_BLOCK_SIZE) ) {\
+      newBlock = (listType##Block*)malloc(sizeof(listType##Block));\
+      if( newBlock == NULL ) {\
+        return 0;\
+      }\
+      newBlock->itemCount = 0;\
+    }\
+    \
+    if( KeyArray##keyKind##CopyKey(&keyCopy, key) == 0 ) {\
+      if( newBlock ) {\
+        free( newBlock );\
+      }\
+      return 0;\
+    }\
+    \
+    if( newBlock && (blockCount == 0) ) {\
+      keyList->block[0] = newBlock;\
+      keyList->blockCount = 1;\
+    } else if( newBlock ) {\
+      /* Split the full block, moving its upper half to the new block */\
+      block = keyList->block[blockIndex];\
+      splitCount = KEYARRAY_BLOCK_SIZE / 2;\
+      memcpy( newBlock->item, &(block->item[splitCount]),\
+          (KEYARRAY_BLOCK_SIZE - splitCount) * sizeof(listType##Item) );\
+      newBlock->itemCount = KEYARRAY_BLOCK_SIZE - splitCount;\
+      block->itemCount = splitCount;\
+      \
+      memmove( &(keyList->block[blockIndex + 2]),\
+          &(keyList->block[blockIndex + 1]),\
+          (blockCount - blockIndex - 1) * sizeof(listType##Block*) );\
+      memmove( &(keyList->blockKey[blockIndex + 2]),\
+          &(keyList->blockKey[blockIndex + 1]),\
+          (blockCount - blockIndex - 1) * sizeof(keyType) );\
+      keyList->block[blockIndex + 1] = newBlock;\
+      keyList->blockKey[blockIndex + 1] = newBlock->item[0].key;\
+      keyList->blockCount++;\
+      \
+      if( itemIndex > splitCount ) {\
+        blockIndex++;\
+        itemIndex -= splitCount;\
+      }\
+    }\
+    \
+    /* Move items past insertion point up, in this block only */\
+    block = keyList->block[blockIndex];\
+    memmove( &(block->item[itemIndex + 1]), &(block->item[itemIndex]),\
+        (block->itemCount - itemIndex) * sizeof(listType##Item) );\
+    \
+    block->item[itemIndex].key = keyCopy;\
+    memcpy( &(block->item[itemIndex].data), data, sizeof(dataType) );\
+    block->itemCount++;\
+    \
+    if( itemIndex == 0 ) {\
+      keyList->blockKey[blockIndex] = keyCopy;\
+    }\
+    keyList->itemCount++;\
+    \
+    return 1;\
+  }
+
+  #define KEYARRAY_DECLARE_BLOCKED_RESERVE( funcName, listType, keyType )\
+  KEYARRAY_DECLARE_BLOCKED_RESIZE( funcName##Resize, listType, keyType )\
+  \
+  int funcName( listType* keyList, size_t reserveCount ) {\
+    size_t reservedBlocks;\
+    \
+    if( keyList == NULL ) {\
+      return 0;\
+    }\
+    \
+    /* Enough for reserveCount items, in half full blocks */\
+    reservedBlocks = (reserveCount / (KEYARRAY_BLOCK_SIZE / 2)) + 1;\
+    if( reservedBlocks <= keyList->reservedBlocks ) {\
+      return 1;\
+    }\
+    \
+    return funcName##Resize(keyList, reservedBlocks);\
+  }
+
+  #define KEYARRAY_DECLARE_BLOCKED_REMOVE( funcName, listType, keyType,\
+      keyKind, compareKeys, freeDataFunc )\
+  KEYARRAY_DECLARE_BLOCKED_FIND( funcName##Find, listType, keyType,\
+      keyKind, compareKeys )\
+  \
+  void funcName( listType* keyList, keyType key ) {\
+    listType##Block* block;\
+    listType##Block* joinBlock;\
+    size_t blockIndex;\
+    size_t itemIndex;\
+    size_t joinIndex;\
+    \
+    if( !(keyList && KeyArray##keyKind##ValidKey(key)) ) {\
+      return;\
+    }\
+    \
+    if( funcName##Find(keyList, key, &blockIndex, &itemIndex) == 0 ) {\
+      return;\
+    }\
+    \
+    block = keyList->block[blockIndex];\
+    freeDataFunc( &(block->item[itemIndex].data) );\
+    KeyArray##keyKind##FreeKey( block->item[itemIndex].key );\
+    \
+    /* Move items past removal point down, in this block only */\
+    block->itemCount--;\
+    memmove( &(block->item[itemIndex]), &(block->item[itemIndex + 1]),\
+        (block->itemCount - itemIndex) * sizeof(listType##Item) );\
+    keyList->itemCount--;\
+    \
+    /* Join neighbours once both fit in half a block, so that blocks\
+       stay at least a quarter full on average */\
+    joinIndex = keyList->blockCount;\
+    if( block->itemCount == 0 ) {\
+      joinIndex = blockIndex;\
+    } else if( ((blockIndex + 1) < keyList->blockCount) &&\
+        ((block->itemCount + keyList->block[blockIndex + 1]->itemCount) <=\
+        (KEYARRAY_BLOCK_SIZE / 2)) ) {\
+      joinIndex = blockIndex + 1;\
+    } else if( (blockIndex > 0) &&\
+        ((block->itemCount + keyList->block[blockIndex - 1]->itemCount) <=\
+        (KEYARRAY_BLOCK_SIZE / 2)) ) {\
+      joinIndex = blockIndex;\
+    }\
+    \
+    if( joinIndex < keyList->blockCount ) {\
+      joinBlock = keyList->block[joinIndex];\
+      if( joinBlock->itemCount ) {\
+        block = keyList->block[joinIndex - 1];\
+        memcpy( &(block->item[block->itemCount]), joinBlock->item,\
+            joinBlock->itemCount * sizeof(listType##Item) );\
+        block->itemCount += joinBlock->itemCount;\
+      }\
+      free( joinBlock );\
+      \
+      keyList->blockCount--;\
+      memmove( &(keyList->block[joinIndex]),\
+          &(keyList->block[joinIndex + 1]),\
+          (keyList->blockCount - joinIndex) * sizeof(listType##Block*) );\
+      memmove( &(keyList->blockKey[joinIndex]),\
+          &(keyList->blockKey[joinIndex + 1]),\
+          (keyList->blockCount - joinIndex) * sizeof(keyType) );\
+      \
+      if( joinIndex == blockIndex ) {\
+        return;\
+      }\
+    }\
+    \
+    keyList->blockKey[blockIndex] = keyList->block[blockIndex]->item[0].key;\
+  }
+
+  #define KEYARRAY_DECLARE_BLOCKED_RETRIEVE( funcName, listType, keyType,\
+      dataType, keyKind, compareKeys )\
+  KEYARRAY_DECLARE_BLOCKED_FIND( funcName##Find, listType, keyType,\
+      keyKind, compareKeys )\
+  \
+  int funcName( listType* keyList, keyType key, dataType* destData ) {\
+    size_t blockIndex;\
+    size_t itemIndex;\
+    \
+    if( !(keyList && KeyArray##keyKind##ValidKey(key) && destData) ) {\
+      return 0;\
+    }\
+    \
+    if( funcName##Find(keyList, key, &blockIndex, &itemIndex) == 0 ) {\
+      return 0;\
+    }\
+    \
+    memcpy( destData, &(keyList->block[blockIndex]->item[itemIndex].data),\
+        sizeof(dataType) );\
+    \
+    return 1;\
+  }
+
+  #define KEYARRAY_DECLARE_BLOCKED_MODIFY( funcName, listType, keyType,\
+      dataType, keyKind, compareKeys )\
+  KEYARRAY_DECLARE_BLOCKED_FIND( funcName##Find, listType, keyType,\
+      keyKind, compareKeys )\
+  \
+  int funcName( listType* keyList, keyType key, dataType* sourceData ) {\
+    size_t blockIndex;\
+    size_t itemIndex;\
+    \
+    if( !(keyList && KeyArray##keyKind##ValidKey(key) && sourceData) ) {\
+      return 0;\
+    }\
+    \
+    if( funcName##Find(keyList, key, &blockIndex, &itemIndex) == 0 ) {\
+      return 0;\
+    }\
+    \
+    memcpy( &(keyList->block[blockIndex]->item[itemIndex].data),\
+        sourceData, sizeof(dataType) );\
+    \
+    return 1;\
+  }
+
+  #define KEYARRAY_DECLARE_BLOCKED_FINDINDEX( funcName, listType, keyType,\
+      keyKind, compareKeys )\
+  size_t funcName( listType* keyList, keyType key );\
+  KEYARRAY_DECLARE_BLOCKED_FIND( funcName##Find, listType, keyType,\
+      keyKind, compareKeys )\
+  \
+  size_t funcName( listType* keyList, keyType key ) {\
+    size_t blockIndex;\
+    size_t itemIndex;\
+    size_t index;\
+    \
+    if( !(keyList && KeyArray##keyKind##ValidKey(key)) ) {\
+      return ((size_t)-1);\
+    }\
+    \
+    if( funcName##Find(keyList, key, &blockIndex, &itemIndex) == 0 ) {\
+      return ((size_t)-1);\
+    }\
+    \
+    for( index = 0; index < blockIndex; index++ ) {\
+      itemIndex += keyList->block[index]->itemCount;\
+    }\
+    \
+    return itemIndex;\
+  }
+
+  /* Declares boundName, to find the list index of the first key not less
+     than key or, if upperBound is non-zero, of the first key greater
+     than key */
+  #define KEYARRAY_DECLARE_BLOCKED_BOUND( boundName, listType, keyType,\
+      keyKind, compareKeys )\
+  KEYARRAY_DECLARE_BLOCKED_FIND( boundName##Find, listType, keyType,\
+      keyKind, compareKeys )\
+  \
+  static size_t boundName( listType* keyList, keyType key,\
+      int upperBound ) {\
+    size_t blockIndex;\
+    size_t itemIndex;\
+    size_t index;\
+    \
+    if( boundName##Find(keyList, key, &blockIndex, &itemIndex) &&\
+        upperBound ) {\
+      itemIndex++;\
+    }\
+    \
+    for( index = 0; index < blockIndex; index++ ) {\
+      itemIndex += keyList->block[index]->itemCount;\
+    }\
+    \
+    return itemIndex;\
+  }
+
+  #define KEYARRAY_DECLARE_BLOCKED_KEYBOUND( funcName, listType,\
+      keyType, keyKind, compareKeys, upperBound )\
+  KEYARRAY_DECLARE_BLOCKED_BOUND( funcName##Bound, listType, keyType,\
+      keyKind, compareKeys )\
+  \
+  size_t funcName( listType* keyList, keyType key ) {\
+    if( !(keyList && KeyArray##keyKind##ValidBound(key)) ) {\
+      return 0;\
+    }\
+    \
+    return funcName##Bound(keyList, key, upperBound);\
+  }
+
+  #define KEYARRAY_DECLARE_BLOCKED_RANGE( funcName, listType, keyType,\
+      keyKind, compareKeys )\
+  KEYARRAY_DECLARE_BLOCKED_BOUND( funcName##Bound, listType, keyType,\
+      keyKind, compareKeys )\
+  \
+  size_t funcName( listType* keyList, keyType firstKey, keyType lastKey,\
+      size_t* beginIndex ) {\
+    size_t endIndex;\
+    \
+    if( !(keyList && beginIndex) ) {\
+      return 0;\
+    }\
+    \
+    (*beginIndex) = 0;\
+    if( !(KeyArray##keyKind##ValidBound(firstKey) &&\
+        KeyArray##keyKind##ValidBound(lastKey)) ) {\
+      return 0;\
+    }\
+    \
+    (*beginIndex) = funcName##Bound(keyList, firstKey, 0);\
+    endIndex = funcName##Bound(keyList, lastKey, 1);\
+    if( endIndex <= (*beginIndex) ) {\
+      return 0;\
+    }\
+    \
+    return endIndex - (*beginIndex);\
+  }
+
+  #define KEYARRAY_DECLARE_BLOCKED_ITEMAT( funcName, listType )\
+  listType##Item* funcName( listType* keyList, size_t index ) {\
+    size_t blockIndex;\
+    \
+    if( !(keyList && (index < keyList->itemCount)) ) {\
+      return NULL;\
+    }\
+    \
+    for( blockIndex = 0; index >= keyList->block[blockIndex]->itemCount;\
+        blockIndex++ ) {\
+      index -= keyList->block[blockIndex]->itemCount;\
+    }\
+    \
+    return &(keyList->block[blockIndex]->item[index]);\
+  }
+
+  #define KEYARRAY_DECLARE_BLOCKED_RELEASEUNUSED( funcName, listType,\
+      keyType )\
+  KEYARRAY_DECLARE_BLOCKED_RESIZE( funcName##Resize, listType, keyType )\
+  \
+  void funcName( listType* keyList ) {\
+    listType##Block* source;\
+    listType##Block* target;\
+    size_t blockIndex;\
+    size_t targetIndex = 0;\
+    size_t sourceIndex;\
+    size_t moveCount;\
+    \
+    if( keyList == NULL ) {\
+      return;\
+    }\
+    \
+    /* Pack items into full blocks, in order */\
+    for( blockIndex = 1; blockIndex < keyList->blockCount; blockIndex++ ) {\
+      source = keyList->block[blockIndex];\
+      sourceIndex = 0;\
+      \
+      while( sourceIndex < source->itemCount ) {\
+        target = keyList->block[targetIndex];\
+        if( target->itemCount == KEYARRAY_BLOCK_SIZE ) {\
+          targetIndex++;\
+          if( targetIndex == blockIndex ) {\
+            /* The rest of the source block becomes the target */\
+            memmove( source->item, &(source->item[sourceIndex]),\
+                (source->itemCount - sourceIndex) *\
+                sizeof(listType##Item) );\
+            source->itemCount -= sourceIndex;\
+            sourceIndex = source->itemCount;\
+          }\
+          continue;\
+        }\
+        \
+        moveCount = KEYARRAY_BLOCK_SIZE - target->itemCount;\
+        if( moveCount > (source->itemCount - sourceIndex) ) {\
+          moveCount = source->itemCount - sourceIndex;\
+        }\
+        memcpy( &(target->item[target->itemCount]),\
+            &(source->item[sourceIndex]),\
+            moveCount * sizeof(listType##Item) );\
+        target->itemCount += moveCount;\
+        sourceIndex += moveCount;\
+      }\
+      \
+      if( targetIndex != blockIndex ) {\
+        source->itemCount = 0;\
+      }\
+    }\
+    \
+    /* Release the emptied blocks, then the unused index */\
+    if( keyList->blockCount ) {\
+      for( blockIndex = targetIndex + 1; blockIndex < keyList->blockCount;\
+          blockIndex++ ) {\
+        free( keyList->block[blockIndex] );\
+      }\
+      keyList->blockCount = targetIndex + 1;\
+      \
+      for( blockIndex = 0; blockIndex < keyList->blockCount;\
+          blockIndex++ ) {\
+        keyList->blockKey[blockIndex] =\
+          keyList->block[blockIndex]->item[0].key;\
+      }\
+    }\
+    \
+    funcName##Resize( keyList, keyList->blockCount );\
+  }
+
+  #define KEYARRAY_DECLARE_BLOCKED_COPY( funcName, listType, keyType,\
+      dataType, keyKind, copyDataFunc, freeDataFunc )\
+  KEYARRAY_DECLARE_BLOCKED_RESIZE( funcName##Resize, listType, keyType )\
+  \
+  listType* funcName( listType* sourceList ) {\
+    listType* newCopy = NULL;\
+    listType##Block* sourceBlock;\
+    listType##Block* block;\
+    size_t blockIndex;\
+    size_t index;\
+    size_t copiedCount = 0;\
+    keyType keyCopy;\
+    \
+    if( sourceList == NULL ) {\
+      return NULL;\
+    }\
+    \
+    newCopy = (listType*)calloc(1, sizeof(listType));\
+    if( newCopy == NULL ) {\
+      return NULL;\
+    }\
+    \
+    /* A list with no items is valid */\
+    if( sourceList->blockCount == 0 ) {\
+      return newCopy;\
+    }\
+    \
+    if( funcName##Resize(newCopy, sourceList->blockCount) == 0 ) {\
+      goto ReturnError;\
+    }\
+    \
+    /* Copy one block at a time, then the keys and data in it */\
+    for( blockIndex = 0; blockIndex < sourceList->blockCount;\
+        blockIndex++ ) {\
+      sourceBlock = sourceList->block[blockIndex];\
+      block = (listType##Block*)malloc(sizeof(listType##Block));\
+      if( block == NULL ) {\
+        goto ReturnError;\
+      }\
+      block->itemCount = 0;\
+      newCopy->block[blockIndex] = block;\
+      newCopy->blockCount++;\
+      \
+      for( index = 0; index < sourceBlock->itemCount; index++ ) {\
+        if( KeyArray##keyKind##CopyKey(&keyCopy,\
+            sourceBlock->item[index].key) == 0 ) {\
+          goto ReturnError;\
+        }\
+        \
+        /* Direct copy by default, allowing copy function to be empty */\
+        block->item[index].data = sourceBlock->item[index].data;\
+        if( copyDataFunc(&(block->item[index].data),\
+            &(sourceBlock->item[index].data)) == 0 ) {\
+          KeyArray##keyKind##FreeKey( keyCopy );\
+          goto ReturnError;\
+        }\
+        \
+        block->item[index].key = keyCopy;\
+        block->itemCount++;\
+        copiedCount++;\
+      }\
+      \
+      newCopy->blockKey[blockIndex] = block->item[0].key;\
+    }\
+    \
+    newCopy->itemCount = copiedCount;\
+    \
+    return newCopy;\
+    \
+  ReturnError:\
+    for( blockIndex = 0; blockIndex < newCopy->blockCount; blockIndex++ ) {\
+      block = newCopy->block[blockIndex];\
+      for( index = 0; index < block->itemCount; index++ ) {\
+        freeDataFunc( &(block->item[index].data) );\
+        KeyArray##keyKind##FreeKey( block->item[index].key );\
+      }\
+      free( block );\
+    }\
+    \
+    funcName##Resize( newCopy, 0 );\
+    free( newCopy );\
+    \
+    return NULL;\
+  }
+
+  #define KEYARRAY_DECLARE_BLOCKED_BULKLOAD( funcName, listType, keyType,\
+      keyKind, compareKeys, duplicatePolicy, mergeDataFunc, freeDataFunc )\
+  KEYARRAY_DECLARE_SORT( funcName##SortItems, listType##Item, compareKeys )\
+  KEYARRAY_DECLARE_BLOCKED_RESIZE( funcName##Resize, listType, keyType )\
+  \
+  listType* funcName( listType##Item* sourceItem, size_t sourceCount ) {\
+    listType* newList = NULL;\
+    listType##Item* item = NULL;\
+    listType##Item* scratch = NULL;\
+    listType##Block* block = NULL;\
+    size_t index;\
+    size_t runIndex;\
+    size_t itemCount;\
+    size_t blockCount;\
+    \
+    if( (sourceItem == NULL) && sourceCount ) {\
+      return NULL;\
+    }\
+    \
+    for( index = 0; index < sourceCount; index++ ) {\
+      if( KeyArray##keyKind##ValidKey(sourceItem[index].key) == 0 ) {\
+        return NULL;\
+      }\
+    }\
+    \
+    newList = (listType*)calloc(1, sizeof(listType));\
+    if( newList == NULL ) {\
+      goto ReturnError;\
+    }\
+    \
+    /* A list with no items is valid */\
+    if( sourceCount == 0 ) {\
+      return newList;\
+    }\
+    \
+    /* Sort a copy of the source items */\
+    if( sourceCount > (((size_t)-1) / sizeof(listType##Item)) ) {\
+      goto ReturnError;\
+    }\
+    \
+    item = (listType##Item*)malloc(sourceCount * sizeof(listType##Item));\
+    scratch = (listType##Item*)malloc(sourceCount * sizeof(listType##Item));\
+    if( (item == NULL) || (scratch == NULL) ) {\
+      goto ReturnError;\
+    }\
+    \
+    memcpy( item, sourceItem, sourceCount * sizeof(listType##Item) );\
+    funcName##SortItems( item, scratch, sourceCount );\
+    \
+    free( scratch );\
+    scratch = NULL;\
+    \
+    /* Check for rejected duplicates, and count keys */\
+    itemCount = 1;\
+    for( index = 1; index < sourceCount; index++ ) {\
+      if( compareKeys(item[index - 1].key, item[index].key) ) {\
+        itemCount++;\
+      } else if( (duplicatePolicy) == KEYARRAY_DUPLICATES_REJECT ) {\
+        goto ReturnError;\
+      }\
+    }\
+    \
+    blockCount = (itemCount + KEYARRAY_BLOCK_SIZE - 1) / KEYARRAY_BLOCK_SIZE;\
+    if( funcName##Resize(newList, blockCount) == 0 ) {\
+      goto ReturnError;\
+    }\
+    \
+    /* Fill full blocks with one key copy per run, before touching data */\
+    itemCount = 0;\
+    for( index = 0; index < sourceCount; index = runIndex ) {\
+      if( (itemCount % KEYARRAY_BLOCK_SIZE) == 0 ) {\
+        block = (listType##Block*)malloc(sizeof(listType##Block));\
+        if( block == NULL ) {\
+          goto ReturnError;\
+        }\
+        block->itemCount = 0;\
+        newList->block[newList->blockCount] = block;\
+        newList->blockCount++;\
+      }\
+      \
+      if( KeyArray##keyKind##CopyKey(&(block->item[block->itemCount].key),\
+          item[index].key) == 0 ) {\
+        goto ReturnError;\
+      }\
+      block->itemCount++;\
+      itemCount++;\
+      \
+      for( runIndex = index + 1; (runIndex < sourceCount) &&\
+          (compareKeys(item[runIndex].key, item[index].key) == 0);\
+          runIndex++ ) {\
+      }\
+    }\
+    \
+    /* Resolve duplicates into the blocks */\
+    itemCount = 0;\
+    for( index = 0; index < sourceCount; index = runIndex ) {\
+      block = newList->block[itemCount / KEYARRAY_BLOCK_SIZE];\
+      block->item[itemCount % KEYARRAY_BLOCK_SIZE].data = item[index].data;\
+      \
+      for( runIndex = index + 1; (runIndex < sourceCount) &&\
+          (compareKeys(item[runIndex].key, item[index].key) == 0);\
+          runIndex++ ) {\
+        if( (duplicatePolicy) == KEYARRAY_DUPLICATES_LAST ) {\
+          freeDataFunc( &(block->item[itemCount %\
+              KEYARRAY_BLOCK_SIZE].data) );\
+          block->item[itemCount % KEYARRAY_BLOCK_SIZE].data =\
+            item[runIndex].data;\
+        } else {\
+          if( (duplicatePolicy) == KEYARRAY_DUPLICATES_MERGE ) {\
+            mergeDataFunc( &(block->item[itemCount %\
+                KEYARRAY_BLOCK_SIZE].data), &(item[runIndex].data) );\
+          }\
+          freeDataFunc( &(item[runIndex].data) );\
+        }\
+      }\
+      \
+      itemCount++;\
+    }\
+    \
+    for( index = 0; index < newList->blockCount; index++ ) {\
+      newList->blockKey[index] = newList->block[index]->item[0].key;\
+    }\
+    newList->itemCount = itemCount;\
+    \
+    free( item );\
+    \
+    return newList;\
+    \
+  ReturnError:\
+    if( newList ) {\
+      for( index = 0; index < newList->blockCount; index++ ) {\
+        block = newList->block[index];\
+        for( runIndex = 0; runIndex < block->itemCount; runIndex++ ) {\
+          KeyArray##keyKind##FreeKey( block->item[runIndex].key );\
+        }\
+        free( block );\
+      }\
+      funcName##Resize( newList, 0 );\
+      free( newList );\
+      newList = NULL;\
+    }\
+    \
+    if( item ) {\
+      free( item );\
+      item = NULL;\
+    }\
+    \
+    if( scratch ) {\
+      free( scratch );\
+      scratch = NULL;\
+    }\
+    \
+    return NULL;\
+  }
+
+  #define KEYARRAY_DECLARE_BLOCKED_MERGEBATCH( funcName, listType, keyType,\
+      keyKind, compareKeys, resolveDataFunc, freeDataFunc )\
+  KEYARRAY_DECLARE_SORT( funcName##SortItems, listType##Item, compareKeys )\
+  KEYARRAY_DECLARE_BLOCKED_FIND( funcName##Find, listType, keyType,\
+      keyKind, compareKeys )\
+  KEYARRAY_DECLARE_BLOCKED_RESIZE( funcName##Resize, listType, keyType )\
+  \
+  int funcName( listType* keyList, listType##Item* batchItem,\
+      size_t batchCount ) {\
+    listType##Item* batch = NULL;\
+    listType##Item* scratch = NULL;\
+    size_t* runBlock = NULL;\
+    listType##Block** spare = NULL;\
+    listType##Block* merged = NULL;\
+    listType##Block* block;\
+    listType##Item* listItem;\
+    size_t blockCount;\
+    size_t spareCount = 0;\
+    size_t allocatedCount = 0;\
+    size_t keyedCount = 0;\
+    size_t newCount = 0;\
+    size_t reservedBlocks;\
+    size_t batchIndex;\
+    size_t runIndex;\
+    size_t groupIndex;\
+    size_t listBlock;\
+    size_t writeBlock;\
+    size_t outputCount;\
+    size_t outputBlocks;\
+    size_t outputIndex;\
+    size_t mergedIndex;\
+    size_t mergedCount;\
+    size_t itemIndex;\
+    size_t index;\
+    int found;\
+    \
+    if( !(keyList && (batchItem || (batchCount == 0))) ) {\
+      return 0;\
+    }\
+    \
+    for( index = 0; index < batchCount; index++ ) {\
+      if( KeyArray##keyKind##ValidKey(batchItem[index].key) == 0 ) {\
+        return 0;\
+      }\
+    }\
+    \
+    if( batchCount == 0 ) {\
+      return 1;\
+    }\
+    \
+    /* Sort a copy of the batch */\
+    if( batchCount > (((size_t)-1) / sizeof(listType##Item)) ) {\
+      return 0;\
+    }\
+    \
+    batch = (listType##Item*)malloc(batchCount * sizeof(listType##Item));\
+    scratch = (listType##Item*)malloc(batchCount * sizeof(listType##Item));\
+    runBlock = (size_t*)malloc(batchCount * sizeof(size_t));\
+    if( (batch == NULL) || (scratch == NULL) || (runBlock == NULL) ) {\
+      goto ReturnError;\
+    }\
+    \
+    memcpy( batch, batchItem, batchCount * sizeof(listType##Item) );\
+    funcName##SortItems( batch, scratch, batchCount );\
+    \
+    /* Find the block for each run, and copy new keys into scratch.\
+       runBlock holds the block index times two, plus one if new. */\
+    blockCount = keyList->blockCount;\
+    for( batchIndex = 0; batchIndex < batchCount; batchIndex = runIndex ) {\
+      found = funcName##Find(keyList, batch[batchIndex].key,\
+          &listBlock, &itemIndex);\
+      \
+      if( found == 0 ) {\
+        if( KeyArray##keyKind##CopyKey(&(scratch[batchIndex].key),\
+            batch[batchIndex].key) == 0 ) {\
+          goto ReturnError;\
+        }\
+        newCount++;\
+      }\
+      \
+      for( runIndex = batchIndex; (runIndex < batchCount) &&\
+          (compareKeys(batch[runIndex].key, batch[batchIndex].key) == 0);\
+          runIndex++ ) {\
+        runBlock[runIndex] = (listBlock * 2) + (found == 0);\
+      }\
+      keyedCount = runIndex;\
+    }\
+    \
+    /* Count the blocks each touched block splits into */\
+    for( batchIndex = 0; batchIndex < batchCount;\
+        batchIndex = groupIndex ) {\
+      outputCount = blockCount ?\
+        keyList->block[runBlock[batchIndex] / 2]->itemCount : 0;\
+      for( groupIndex = batchIndex; (groupIndex < batchCount) &&\
+          ((runBlock[groupIndex] / 2) == (runBlock[batchIndex] / 2));\
+          groupIndex++ ) {\
+        if( (runBlock[groupIndex] & 1) && ((groupIndex == batchIndex) ||\
+            compareKeys(batch[groupIndex - 1].key,\
+            batch[groupIndex].key)) ) {\
+          outputCount++;\
+        }\
+      }\
+      \
+      spareCount += ((outputCount + KEYARRAY_BLOCK_SIZE - 1) /\
+          KEYARRAY_BLOCK_SIZE) - (blockCount ? 1 : 0);\
+    }\
+    \
+    /* Allocate every block before changing the list */\
+    if( spareCount ) {\
+      if( spareCount > (((size_t)-1) / sizeof(listType##Block*)) ) {\
+        goto ReturnError;\
+      }\
+      spare = (listType##Block**)malloc(spareCount *\
+          sizeof(listType##Block*));\
+      if( spare == NULL ) {\
+        goto ReturnError;\
+      }\
+      for( ; allocatedCount < spareCount; allocatedCount++ ) {\
+        spare[allocatedCount] =\
+          (listType##Block*)malloc(sizeof(listType##Block));\
+        if( spare[allocatedCount] == NULL ) {\
+          goto ReturnError;\
+        }\
+      }\
+    }\
+    \
+    if( blockCount ) {\
+      merged = (listType##Block*)malloc(sizeof(listType##Block));\
+      if( merged == NULL ) {\
+        goto ReturnError;\
+      }\
+    }\
+    \
+    if( (blockCount + spareCount) > keyList->reservedBlocks ) {\
+      reservedBlocks = KEYARRAY_GROW_DEFAULT(keyList->reservedBlocks,\
+          blockCount + spareCount);\
+      if( (reservedBlocks < (blockCount + spareCount)) ||\
+          (funcName##Resize(keyList, reservedBlocks) == 0) ) {\
+        goto ReturnError;\
+      }\
+    }\
+    \
+    /* Merge from the back, one touched block at a time, moving\
+       untouched blocks by pointer only */\
+    writeBlock = blockCount + spareCount;\
+    batchIndex = batchCount;\
+    for( listBlock = (blockCount ? blockCount : 1); listBlock > 0;\
+        listBlock-- ) {\
+      for( groupIndex = batchIndex; (groupIndex > 0) &&\
+          ((runBlock[groupIndex - 1] / 2) == (listBlock - 1));\
+          groupIndex-- ) {\
+      }\
+      \
+      if( groupIndex == batchIndex ) {\
+        writeBlock--;\
+        keyList->block[writeBlock] = keyList->block[listBlock - 1];\
+        keyList->blockKey[writeBlock] = keyList->blockKey[listBlock - 1];\
+        continue;\
+      }\
+      \
+      /* Move the block aside, then spread it and its new keys evenly\
+         over the output blocks */\
+      mergedCount = 0;\
+      if( blockCount ) {\
+        block = keyList->block[listBlock - 1];\
+        mergedCount = block->itemCount;\
+        memcpy( merged->item, block->item,\
+            mergedCount * sizeof(listType##Item) );\
+      }\
+      outputCount = mergedCount;\
+      for( index = groupIndex; index < batchIndex; index++ ) {\
+        if( (runBlock[index] & 1) && ((index == groupIndex) ||\
+            compareKeys(batch[index - 1].key, batch[index].key)) ) {\
+          outputCount++;\
+        }\
+      }\
+      \
+      outputBlocks = (outputCount + KEYARRAY_BLOCK_SIZE - 1) /\
+          KEYARRAY_BLOCK_SIZE;\
+      writeBlock -= outputBlocks;\
+      for( index = 0; index < outputBlocks; index++ ) {\
+        if( (index == 0) && blockCount ) {\
+          block = keyList->block[listBlock - 1];\
+        } else {\
+          spareCount--;\
+          block = spare[spareCount];\
+        }\
+        block->itemCount = 0;\
+        keyList->block[writeBlock + index] = block;\
+      }\
+      \
+      mergedIndex = 0;\
+      runIndex = groupIndex;\
+      for( index = 0; index < outputCount; index++ ) {\
+        outputIndex = (index * outputBlocks) / outputCount;\
+        block = keyList->block[writeBlock + outputIndex];\
+        listItem = &(block->item[block->itemCount]);\
+        block->itemCount++;\
+        \
+        if( (runIndex == batchIndex) || ((mergedIndex < mergedCount) &&\
+            (compareKeys(merged->item[mergedIndex].key,\
+            batch[runIndex].key) < 0)) ) {\
+          (*listItem) = merged->item[mergedIndex];\
+          mergedIndex++;\
+          continue;\
+        }\
+        \
+        if( (runBlock[runIndex] & 1) == 0 ) {\
+          /* Existing key: resolve each batch item into the list item */\
+          (*listItem) = merged->item[mergedIndex];\
+          mergedIndex++;\
+          itemIndex = runIndex;\
+        } else {\
+          /* New key: resolve duplicates into the first batch item */\
+          listItem->key = scratch[runIndex].key;\
+          listItem->data = batch[runIndex].data;\
+          itemIndex = runIndex + 1;\
+        }\
+        \
+        for( runIndex++; (runIndex < batchIndex) &&\
+            (compareKeys(batch[runIndex - 1].key, batch[runIndex].key) ==\
+            0); runIndex++ ) {\
+        }\
+        for( ; itemIndex < runIndex; itemIndex++ ) {\
+          resolveDataFunc( &(listItem->data), &(batch[itemIndex].data) );\
+          freeDataFunc( &(batch[itemIndex].data) );\
+        }\
+      }\
+      \
+      for( index = 0; index < outputBlocks; index++ ) {\
+        keyList->blockKey[writeBlock + index] =\
+          keyList->block[writeBlock + index]->item[0].key;\
+      }\
+      batchIndex = groupIndex;\
+    }\
+    \
+    keyList->blockCount = blockCount + allocatedCount;\
+    keyList->itemCount += newCount;\
+    \
+    if( merged ) {\
+      free( merged );\
+    }\
+    if( spare ) {\
+      free( spare );\
+    }\
+    free( runBlock );\
+    free( scratch );\
+    free( batch );\
+    \
+    return 1;\
+    \
+  ReturnError:\
+    if( spare ) {\
+      while( allocatedCount > 0 ) {\
+        allocatedCount--;\
+        if( spare[allocatedCount] ) {\
+          free( spare[allocatedCount] );\
+        }\
+      }\
+      free( spare );\
+      spare = NULL;\
+    }\
+    \
+    if( merged ) {\
+      free( merged );\
+      merged = NULL;\
+    }\
+    \
+    /* Release new key copies, in runs already keyed */\
+    for( batchIndex = 0; batchIndex < keyedCount; batchIndex++ ) {\
+      if( (runBlock[batchIndex] & 1) && ((batchIndex == 0) ||\
+          compareKeys(batch[batchIndex - 1].key, batch[batchIndex].key)) ) {\
+        KeyArray##keyKind##FreeKey( scratch[batchIndex].key );\
+      }\
+    }\
+    \
+    if( runBlock ) {\
+      free( runBlock );\
+      runBlock = NULL;\
+    }\
+    \
+    if( scratch ) {\
+      free( scratch );\
+      scratch = NULL;\
+    }\
+    \
+    if( batch ) {\
+      free( batch );\
+      batch = NULL;\
+    }\
+    \
+    return 0;\
+  }
+
+  #define DECLARE_STRING_KEYARRAY_TYPES_BLOCKED( typeName, dataType )\
+  KEYARRAY_DECLARE_BLOCKED_TYPES( typeName, char*, dataType )
+
+  #define DECLARE_STRING_KEYARRAY_CREATE_BLOCKED( funcName, listType )\
+  KEYARRAY_DECLARE_BLOCKED_CREATE( funcName, listType, char* )
+
+  #define DECLARE_STRING_KEYARRAY_FREE_BLOCKED( funcName, listType,\
+      freeDataFunc )\
+  KEYARRAY_DECLARE_BLOCKED_FREE( funcName, listType, String,\
+      freeDataFunc )
+
+  #define DECLARE_STRING_KEYARRAY_INSERT_BLOCKED( funcName, listType,\
+      dataType )\
+  DECLARE_STRING_KEYARRAY_INSERT_GROWTH_BLOCKED( funcName, listType, dataType,\
+      KEYARRAY_GROW_DEFAULT )
+
+  #define DECLARE_STRING_KEYARRAY_INSERT_GROWTH_BLOCKED( funcName, listType,\
+      dataType, growFunc )\
+  KEYARRAY_DECLARE_BLOCKED_INSERT( funcName, listType, char*, dataType,\
+      String, KEYARRAY_COMPARE_STRING, growFunc )
+
+  #define DECLARE_STRING_KEYARRAY_RESERVE_BLOCKED( funcName, listType )\
+  KEYARRAY_DECLARE_BLOCKED_RESERVE( funcName, listType, char* )
+
+  #define DECLARE_STRING_KEYARRAY_REMOVE_BLOCKED( funcName, listType,\
+      freeDataFunc )\
+  KEYARRAY_DECLARE_BLOCKED_REMOVE( funcName, listType, char*, String,\
+      KEYARRAY_COMPARE_STRING, freeDataFunc )
+
+  #define DECLARE_STRING_KEYARRAY_RETRIEVE_BLOCKED( funcName, listType,\
+      dataType )\
+  KEYARRAY_DECLARE_BLOCKED_RETRIEVE( funcName, listType, char*, dataType,\
+      String, KEYARRAY_COMPARE_STRING )
+
+  #define DECLARE_STRING_KEYARRAY_MODIFY_BLOCKED( funcName, listType,\
+      dataType )\
+  KEYARRAY_DECLARE_BLOCKED_MODIFY( funcName, listType, char*, dataType,\
+      String, KEYARRAY_COMPARE_STRING )
+
+  #define DECLARE_STRING_KEYARRAY_FINDINDEX_SIZE_BLOCKED( funcName, listType )\
+  KEYARRAY_DECLARE_BLOCKED_FINDINDEX( funcName, listType, char*, String,\
+      KEYARRAY_COMPARE_STRING )
+
+  #define DECLARE_STRING_KEYARRAY_FINDINDEX_BLOCKED( funcName, listType )\
+  KEYARRAY_DECLARE_FINDINDEX_INT( funcName, listType, listType, char*,\
+      DECLARE_STRING_KEYARRAY_FINDINDEX_SIZE_BLOCKED )
+
+  #define DECLARE_STRING_KEYARRAY_LOWERBOUND_BLOCKED( funcName, listType )\
+  KEYARRAY_DECLARE_BLOCKED_KEYBOUND( funcName, listType, char*, String,\
+      KEYARRAY_COMPARE_STRING, 0 )
+
+  #define DECLARE_STRING_KEYARRAY_UPPERBOUND_BLOCKED( funcName, listType )\
+  KEYARRAY_DECLARE_BLOCKED_KEYBOUND( funcName, listType, char*, String,\
+      KEYARRAY_COMPARE_STRING, 1 )
+
+  #define DECLARE_STRING_KEYARRAY_RANGE_BLOCKED( funcName, listType )\
+  KEYARRAY_DECLARE_BLOCKED_RANGE( funcName, listType, char*, String,\
+      KEYARRAY_COMPARE_STRING )
+
+  #define DECLARE_STRING_KEYARRAY_ITEMAT_BLOCKED( funcName, listType )\
+  KEYARRAY_DECLARE_BLOCKED_ITEMAT( funcName, listType )
+
+  #define DECLARE_STRING_KEYARRAY_RELEASEUNUSED_BLOCKED( funcName, listType )\
+  KEYARRAY_DECLARE_BLOCKED_RELEASEUNUSED( funcName, listType, char* )
+
+  #define DECLARE_STRING_KEYARRAY_COPY_BLOCKED( funcName, listType,\
+      dataType, copyDataFunc, freeDataFunc )\
+  KEYARRAY_DECLARE_BLOCKED_COPY( funcName, listType, char*, dataType,\
+      String, copyDataFunc, freeDataFunc )
+
+  #define DECLARE_STRING_KEYARRAY_BULKLOAD_BLOCKED( funcName, listType,\
+      dataType, duplicatePolicy, mergeDataFunc, freeDataFunc )\
+  KEYARRAY_DECLARE_BLOCKED_BULKLOAD( funcName, listType, char*, String,\
+      KEYARRAY_COMPARE_STRING, duplicatePolicy, mergeDataFunc, freeDataFunc )
+
+  #define DECLARE_STRING_KEYARRAY_MERGEBATCH_BLOCKED( funcName, listType,\
+      dataType, resolveDataFunc, freeDataFunc )\
+  KEYARRAY_DECLARE_BLOCKED_MERGEBATCH( funcName, listType, char*, String,\
+      KEYARRAY_COMPARE_STRING, resolveDataFunc, freeDataFunc )
+
+  #define DECLARE_UINT_KEYARRAY_TYPES_BLOCKED( typeName, dataType )\
+  KEYARRAY_DECLARE_BLOCKED_TYPES( typeName, unsigned, dataType )
+
+  #define DECLARE_UINT_KEYARRAY_CREATE_BLOCKED( funcName, listType )\
+  KEYARRAY_DECLARE_BLOCKED_CREATE( funcName, listType, unsigned )
+
+  #define DECLARE_UINT_KEYARRAY_FREE_BLOCKED( funcName, listType,\
+      freeDataFunc )\
+  KEYARRAY_DECLARE_BLOCKED_FREE( funcName, listType, Uint,\
+      freeDataFunc )
+
+  #define DECLARE_UINT_KEYARRAY_INSERT_BLOCKED( funcName, listType, dataType )\
+  DECLARE_UINT_KEYARRAY_INSERT_GROWTH_BLOCKED( funcName, listType, dataType,\
+      KEYARRAY_GROW_DEFAULT )
+
+  #define DECLARE_UINT_KEYARRAY_INSERT_GROWTH_BLOCKED( funcName, listType,\
+      dataType, growFunc )\
+  KEYARRAY_DECLARE_BLOCKED_INSERT( funcName, listType, unsigned, dataType,\
+      Uint, KEYARRAY_COMPARE_UINT, growFunc )
+
+  #define DECLARE_UINT_KEYARRAY_RESERVE_BLOCKED( funcName, listType )\
+  KEYARRAY_DECLARE_BLOCKED_RESERVE( funcName, listType, unsigned )
+
+  #define DECLARE_UINT_KEYARRAY_REMOVE_BLOCKED( funcName, listType,\
+      freeDataFunc )\
+  KEYARRAY_DECLARE_BLOCKED_REMOVE( funcName, listType, unsigned, Uint,\
+      KEYARRAY_COMPARE_UINT, freeDataFunc )
+
+  #define DECLARE_UINT_KEYARRAY_RETRIEVE_BLOCKED( funcName, listType,\
+      dataType )\
+  KEYARRAY_DECLARE_BLOCKED_RETRIEVE( funcName, listType, unsigned, dataType,\
+      Uint, KEYARRAY_COMPARE_UINT )
+
+  #define DECLARE_UINT_KEYARRAY_MODIFY_BLOCKED( funcName, listType,\
+      dataType )\
+  KEYARRAY_DECLARE_BLOCKED_MODIFY( funcName, listType, unsigned, dataType,\
+      Uint, KEYARRAY_COMPARE_UINT )
+
+  #define DECLARE_UINT_KEYARRAY_FINDINDEX_SIZE_BLOCKED( funcName, listType )\
+  KEYARRAY_DECLARE_BLOCKED_FINDINDEX( funcName, listType, unsigned, Uint,\
+      KEYARRAY_COMPARE_UINT )
+
+  #define DECLARE_UINT_KEYARRAY_FINDINDEX_BLOCKED( funcName, listType )\
+  KEYARRAY_DECLARE_FINDINDEX_INT( funcName, listType, listType, unsigned,\
+      DECLARE_UINT_KEYARRAY_FINDINDEX_SIZE_BLOCKED )
+
+  #define DECLARE_UINT_KEYARRAY_LOWERBOUND_BLOCKED( funcName, listType )\
+  KEYARRAY_DECLARE_BLOCKED_KEYBOUND( funcName, listType, unsigned, Uint,\
+      KEYARRAY_COMPARE_UINT, 0 )
+
+  #define DECLARE_UINT_KEYARRAY_UPPERBOUND_BLOCKED( funcName, listType )\
+  KEYARRAY_DECLARE_BLOCKED_KEYBOUND( funcName, listType, unsigned, Uint,\
+      KEYARRAY_COMPARE_UINT, 1 )
+
+  #define DECLARE_UINT_KEYARRAY_RANGE_BLOCKED( funcName, listType )\
+  KEYARRAY_DECLARE_BLOCKED_RANGE( funcName, listType, unsigned, Uint,\
+      KEYARRAY_COMPARE_UINT )
+
+  #define DECLARE_UINT_KEYARRAY_ITEMAT_BLOCKED( funcName, listType )\
+  KEYARRAY_DECLARE_BLOCKED_ITEMAT( funcName, listType )
+
+  #define DECLARE_UINT_KEYARRAY_RELEASEUNUSED_BLOCKED( funcName, listType )\
+  KEYARRAY_DECLARE_BLOCKED_RELEASEUNUSED( funcName, listType, unsigned )
+
+  #define DECLARE_UINT_KEYARRAY_COPY_BLOCKED( funcName, listType,\
+      dataType, copyDataFunc, freeDataFunc )\
+  KEYARRAY_DECLARE_BLOCKED_COPY( funcName, listType, unsigned, dataType,\
+      Uint, copyDataFunc, freeDataFunc )
+
+  #define DECLARE_UINT_KEYARRAY_BULKLOAD_BLOCKED( funcName, listType,\
+      dataType, duplicatePolicy, mergeDataFunc, freeDataFunc )\
+  KEYARRAY_DECLARE_BLOCKED_BULKLOAD( funcName, listType, unsigned, Uint,\
+      KEYARRAY_COMPARE_UINT, duplicatePolicy, mergeDataFunc, freeDataFunc )
+
+  #define DECLARE_UINT_KEYARRAY_MERGEBATCH_BLOCKED( funcName, listType,\
+      dataType, resolveDataFunc, freeDataFunc )\
+  KEYARRAY_DECLARE_BLOCKED_MERGEBATCH( funcName, listType, unsigned, Uint,\
+      KEYARRAY_COMPARE_UINT, resolveDataFunc, freeDataFunc )
+
+/*
+ * ==========================================
+ *  Key Array implementation, sharded layout
+ * ==========================================
+ */
+
+  /* Sharded lists lock with POSIX threads, so they are only declared
+     when KEYARRAY_THREADS is defined before including keyarray.h */
+  #if defined(KEYARRAY_THREADS)
+
+  #include <pthread.h>
+
+  /* Keeps the locks of neighbouring shards off one cache line */
+  #ifndef KEYARRAY_SHARD_PADDING
+    #define KEYARRAY_SHARD_PADDING 64
+  #endif
+
+  /* Shard selection. Without split keys, keys are spread by hash; the
+     high bits of the hash pick the shard, leaving the low bits evenly
+     spread within each shard. With split keys, shard index is the
+     number of split keys not greater than key. */
+  static inline size_t KeyArrayStringShardIndex( char** splitKey,
+      size_t shardCount, const char* key ) {
+    if( splitKey ) {
+      return KeyArrayStringBound(splitKey, sizeof(char*), shardCount - 1,
+          key, 1);
+    }
+
+    return (size_t)(((unsigned long long)(KeyArrayStringHash(key) &
+        0xFFFFFFFFU) * shardCount) >> 32);
+  }
+
+  static inline size_t KeyArrayUintShardIndex( unsigned* splitKey,
+      size_t shardCount, unsigned key ) {
+    if( splitKey ) {
+      return KeyArrayUintBound(splitKey, sizeof(unsigned), shardCount - 1,
+          key, 1);
+    }
+
+    /* Fibonacci hashing spreads sequential keys across shards */
+    return (size_t)(((unsigned long long)((key * 2654435769U) &
+        0xFFFFFFFFU) * shardCount) >> 32);
+  }
+
+  #define KEYARRAY_DECLARE_SHARDED_TYPES( typeName, keyType )\
+  typedef typeName##PartItem typeName##Item;\
+  \
+  typedef struct typeName##Shard {\
+    pthread_rwlock_t lock;\
+    typeName##Part* list;\
+    char padding[KEYARRAY_SHARD_PADDING];\
+  } typeName##Shard;\
+  \
+  typedef struct typeName {\
+    size_t shardCount;\
+    typeName##Shard* shard;\
+    keyType* splitKey;\
+  } typeName;\
+  \
+  typedef struct typeName##Iterator {\
+    typeName* list;\
+    size_t* itemIndex;\
+    size_t* heap;\
+    size_t heapCount;\
+  } typeName##Iterator;
+
+  #define KEYARRAY_DECLARE_SHARDED_CREATE( funcName, listType, keyType,\
+      keyKind, compareKeys )\
+  listType* funcName( size_t shardCount, keyType* splitKey ) {\
+    listType* newList = NULL;\
+    size_t index;\
+    size_t keyCount = 0;\
+    size_t lockCount = 0;\
+    \
+    if( (shardCount == 0) ||\
+        (shardCount > (((size_t)-1) / sizeof(listType##Shard))) ) {\
+      return NULL;\
+    }\
+    \
+    /* Split keys must be valid, and strictly increasing */\
+    if( splitKey ) {\
+      for( index = 0; (index + 1) < shardCount; index++ ) {\
+        if( (KeyArray##keyKind##ValidKey(splitKey[index]) == 0) ||\
+            (index && (compareKeys(splitKey[index - 1],\
+            splitKey[index]) >= 0)) ) {\
+          return NULL;\
+        }\
+      }\
+    }\
+    \
+    newList = (listType*)calloc(1, sizeof(listType));\
+    if( newList == NULL ) {\
+      goto ReturnError;\
+    }\
+    \
+    newList->shard =\
+      (listType##Shard*)calloc(shardCount, sizeof(listType##Shard));\
+    if( newList->shard == NULL ) {\
+      goto ReturnError;\
+    }\
+    \
+    if( splitKey && (shardCount > 1) ) {\
+      newList->splitKey =\
+        (keyType*)malloc((shardCount - 1) * sizeof(keyType));\
+      if( newList->splitKey == NULL ) {\
+        goto ReturnError;\
+      }\
+      \
+      for( ; (keyCount + 1) < shardCount; keyCount++ ) {\
+        if( KeyArray##keyKind##CopyKey(&(newList->splitKey[keyCount]),\
+            splitKey[keyCount]) == 0 ) {\
+          goto ReturnError;\
+        }\
+      }\
+    }\
+    \
+    for( ; lockCount < shardCount; lockCount++ ) {\
+      newList->shard[lockCount].list =\
+        (listType##Part*)calloc(1, sizeof(listType##Part));\
+      if( newList->shard[lockCount].list == NULL ) {\
+        goto ReturnError;\
+      }\
+      \
+      if( pthread_rwlock_init(&(newList->shard[lockCount].lock),\
+          NULL) != 0 ) {\
+        free( newList->shard[lockCount].list );\
+        goto ReturnError;\
+      }\
+    }\
+    \
+    newList->shardCount = shardCount;\
+    \
+    return newList;\
+    \
+  ReturnError:\
+    if( newList ) {\
+      if( newList->shard ) {\
+        for( index = 0; index < lockCount; index++ ) {\
+          pthread_rwlock_destroy( &(newList->shard[index].lock) );\
+          free( newList->shard[index].list );\
+        }\
+        free( newList->shard );\
+      }\
+      \
+      if( newList->splitKey ) {\
+        for( index = 0; index < keyCount; index++ ) {\
+          KeyArray##keyKind##FreeKey( newList->splitKey[index] );\
+        }\
+        free( newList->splitKey );\
+      }\
+      \
+      free( newList );\
+      newList = NULL;\
+    }\
+    \
+    return NULL;\
+  }
+
+  #define KEYARRAY_DECLARE_SHARDED_FREE( funcName, listType, keyKind,\
+      declareFree, freeDataFunc )\
+  static declareFree( funcName##Part, listType##Part, freeDataFunc )\
+  \
+  void funcName( listType** keyList ) {\
+    size_t index;\
+    \
+    if( keyList && (*keyList) ) {\
+      for( index = 0; index < (*keyList)->shardCount; index++ ) {\
+        funcName##Part( &((*keyList)->shard[index].list) );\
+        pthread_rwlock_destroy( &((*keyList)->shard[index].lock) );\
+      }\
+      \
+      if( (*keyList)->splitKey ) {\
+        for( index = 0; (index + 1) < (*keyList)->shardCount; index++ ) {\
+          KeyArray##keyKind##FreeKey( (*keyList)->splitKey[index] );\
+        }\
+        free( (*keyList)->splitKey );\
+      }\
+      \
+      free( (*keyList)->shard );\
+      free( (*keyList) );\
+      (*keyList) = NULL;\
+    }\
+  }
+
+  /* Declares funcName, to call a list function on the shard of key,
+     while holding its lock for reading or writing */
+  #define KEYARRAY_DECLARE_SHARDED_CALL( funcName, listType, keyType,\
+      keyKind, dataType, declarePart, lockFunc )\
+  static declarePart( funcName##Part, listType##Part, dataType )\
+  \
+  int funcName( listType* keyList, keyType key, dataType* data ) {\
+    listType##Shard* shard;\
+    int result;\
+    \
+    if( !(keyList && KeyArray##keyKind##ValidKey(key) && data) ) {\
+      return 0;\
+    }\
+    \
+    shard = &(keyList->shard[KeyArray##keyKind##ShardIndex(\
+        keyList->splitKey, keyList->shardCount, key)]);\
+    if( lockFunc(&(shard->lock)) != 0 ) {\
+      return 0;\
+    }\
+    \
+    result = funcName##Part(shard->list, key, data);\
+    \
+    pthread_rwlock_unlock( &(shard->lock) );\
+    \
+    return result;\
+  }
+
+  #define KEYARRAY_DECLARE_SHARDED_REMOVE( funcName, listType, keyType,\
+      keyKind, declareRemove, freeDataFunc )\
+  static declareRemove( funcName##Part, listType##Part, freeDataFunc )\
+  \
+  void funcName( listType* keyList, keyType key ) {\
+    listType##Shard* shard;\
+    \
+    if( !(keyList && KeyArray##keyKind##ValidKey(key)) ) {\
+      return;\
+    }\
+    \
+    shard = &(keyList->shard[KeyArray##keyKind##ShardIndex(\
+        keyList->splitKey, keyList->shardCount, key)]);\
+    if( pthread_rwlock_wrlock(&(shard->lock)) != 0 ) {\
+      return;\
+    }\
+    \
+    funcName##Part( shard->list, key );\
+    \
+    pthread_rwlock_unlock( &(shard->lock) );\
+  }
+
+  /* Declares siftName, to restore the iterator heap below heapIndex.
+     The heap holds the shards with items left, ordered by the key of
+     their next item. */
+  #define KEYARRAY_DECLARE_SHARDED_SIFT( siftName, listType,\
+      compareKeys )\
+  static void siftName( listType##Iterator* iterator,\
+      size_t heapIndex ) {\
+    listType##Shard* shard = iterator->list->shard;\
+    size_t* itemIndex = iterator->itemIndex;\
+    size_t* heap = iterator->heap;\
+    size_t heapCount = iterator->heapCount;\
+    size_t childIndex;\
+    size_t shardIndex = heap[heapIndex];\
+    \
+    while( (childIndex = (heapIndex * 2) + 1) < heapCount ) {\
+      if( ((childIndex + 1) < heapCount) && (compareKeys(\
+          shard[heap[childIndex + 1]].list->item[\
+          itemIndex[heap[childIndex + 1]]].key,\
+          shard[heap[childIndex]].list->item[\
+          itemIndex[heap[childIndex]]].key) < 0) ) {\
+        childIndex++;\
+      }\
+      \
+      if( compareKeys(shard[heap[childIndex]].list->item[\
+          itemIndex[heap[childIndex]]].key,\
+          shard[shardIndex].list->item[itemIndex[shardIndex]].key) >= 0 ) {\
+        break;\
+      }\
+      \
+      heap[heapIndex] = heap[childIndex];\
+      heapIndex = childIndex;\
+    }\
+    \
+    heap[heapIndex] = shardIndex;\
+  }
+
+  #define KEYARRAY_DECLARE_SHARDED_ITERATEBEGIN( funcName, listType,\
+      compareKeys )\
+  KEYARRAY_DECLARE_SHARDED_SIFT( funcName##Sift, listType, compareKeys )\
+  \
+  int funcName( listType* keyList, listType##Iterator* iterator ) {\
+    size_t shardCount;\
+    size_t lockCount = 0;\
+    size_t index;\
+    \
+    if( !(keyList && iterator) ) {\
+      return 0;\
+    }\
+    \
+    memset( iterator, 0, sizeof(listType##Iterator) );\
+    shardCount = keyList->shardCount;\
+    \
+    iterator->itemIndex = (size_t*)calloc(shardCount * 2, sizeof(size_t));\
+    if( iterator->itemIndex == NULL ) {\
+      return 0;\
+    }\
+    iterator->heap = &(iterator->itemIndex[shardCount]);\
+    iterator->list = keyList;\
+    \
+    /* Locks are always taken in shard order, so iterators never\
+       deadlock each other */\
+    for( ; lockCount < shardCount; lockCount++ ) {\
+      if( pthread_rwlock_rdlock(&(keyList->shard[lockCount].lock)) != 0 ) {\
+        goto ReturnError;\
+      }\
+      \
+      if( keyList->shard[lockCount].list->itemCount ) {\
+        iterator->heap[iterator->heapCount] = lockCount;\
+        iterator->heapCount++;\
+      }\
+    }\
+    \
+    for( index = iterator->heapCount / 2; index > 0; index-- ) {\
+      funcName##Sift( iterator, index - 1 );\
+    }\
+    \
+    return 1;\
+    \
+  ReturnError:\
+    for( index = 0; index < lockCount; index++ ) {\
+      pthread_rwlock_unlock( &(keyList->shard[index].lock) );\
+    }\
+    \
+    free( iterator->itemIndex );\
+    memset( iterator, 0, sizeof(listType##Iterator) );\
+    \
+    return 0;\
+  }
+
+  #define KEYARRAY_DECLARE_SHARDED_ITERATENEXT( funcName, listType,\
+      compareKeys )\
+  KEYARRAY_DECLARE_SHARDED_SIFT( funcName##Sift, listType, compareKeys )\
+  \
+  listType##Item* funcName( listType##Iterator* iterator ) {\
+    listType##Part* shardList;\
+    size_t shardIndex;\
+    size_t itemIndex;\
+    \
+    if( !(iterator && iterator->heapCount) ) {\
+      return NULL;\
+    }\
+    \
+    shardIndex = iterator->heap[0];\
+    shardList = iterator->list->shard[shardIndex].list;\
+    itemIndex = iterator->itemIndex[shardIndex];\
+    \
+    iterator->itemIndex[shardIndex]++;\
+    if( iterator->itemIndex[shardIndex] == shardList->itemCount ) {\
+      iterator->heapCount--;\
+      iterator->heap[0] = iterator->heap[iterator->heapCount];\
+    }\
+    \
+    if( iterator->heapCount ) {\
+      funcName##Sift( iterator, 0 );\
+    }\
+    \
+    return &(shardList->item[itemIndex]);\
+  }
+
+  #define KEYARRAY_DECLARE_SHARDED_ITERATEEND( funcName, listType )\
+  void funcName( listType##Iterator* iterator ) {\
+    size_t index;\
+    \
+    if( !(iterator && iterator->list) ) {\
+      return;\
+    }\
+    \
+    for( index = iterator->list->shardCount; index > 0; index-- ) {\
+      pthread_rwlock_unlock( &(iterator->list->shard[index - 1].lock) );\
+    }\
+    \
+    free( iterator->itemIndex );\
+    memset( iterator, 0, sizeof(listType##Iterator) );\
+  }
+
+  /* String key sharded list */
+  #define DECLARE_STRING_KEYARRAY_TYPES_SHARDED( typeName, dataType )\
+  DECLARE_STRING_KEYARRAY_TYPES( typeName##Part, dataType )\
+  KEYARRAY_DECLARE_SHARDED_TYPES( typeName, char* )
+
+  #define DECLARE_STRING_KEYARRAY_CREATE_SHARDED( funcName, listType )\
+  KEYARRAY_DECLARE_SHARDED_CREATE( funcName, listType, char*, String,\
+      KEYARRAY_COMPARE_STRING )
+
+  #define DECLARE_STRING_KEYARRAY_FREE_SHARDED( funcName, listType,\
+      freeDataFunc )\
+  KEYARRAY_DECLARE_SHARDED_FREE( funcName, listType, String,\
+      DECLARE_STRING_KEYARRAY_FREE, freeDataFunc )
+
+  #define DECLARE_STRING_KEYARRAY_INSERT_SHARDED( funcName, listType,\
+      dataType )\
+  KEYARRAY_DECLARE_SHARDED_CALL( funcName, listType, char*, String,\
+      dataType, DECLARE_STRING_KEYARRAY_INSERT, pthread_rwlock_wrlock )
+
+  #define DECLARE_STRING_KEYARRAY_REMOVE_SHARDED( funcName, listType,\
+      freeDataFunc )\
+  KEYARRAY_DECLARE_SHARDED_REMOVE( funcName, listType, char*, String,\
+      DECLARE_STRING_KEYARRAY_REMOVE, freeDataFunc )
+
+  #define DECLARE_STRING_KEYARRAY_RETRIEVE_SHARDED( funcName, listType,\
+      dataType )\
+  KEYARRAY_DECLARE_SHARDED_CALL( funcName, listType, char*, String,\
+      dataType, DECLARE_STRING_KEYARRAY_RETRIEVE, pthread_rwlock_rdlock )
+
+  #define DECLARE_STRING_KEYARRAY_MODIFY_SHARDED( funcName, listType,\
+      dataType )\
+  KEYARRAY_DECLARE_SHARDED_CALL( funcName, listType, char*, String,\
+      dataType, DECLARE_STRING_KEYARRAY_MODIFY, pthread_rwlock_wrlock )
+
+  #define DECLARE_STRING_KEYARRAY_ITERATEBEGIN_SHARDED( funcName,\
+      listType )\
+  KEYARRAY_DECLARE_SHARDED_ITERATEBEGIN( funcName, listType,\
+      KEYARRAY_COMPARE_STRING )
+
+  #define DECLARE_STRING_KEYARRAY_ITERATENEXT_SHARDED( funcName,\
+      listType )\
+  KEYARRAY_DECLARE_SHARDED_ITERATENEXT( funcName, listType,\
+      KEYARRAY_COMPARE_STRING )
+
+  #define DECLARE_STRING_KEYARRAY_ITERATEEND_SHARDED( funcName, listType )\
+  KEYARRAY_DECLARE_SHARDED_ITERATEEND( funcName, listType )
+
+  /* Unsigned key sharded list */
+  #define DECLARE_UINT_KEYARRAY_TYPES_SHARDED( typeName, dataType )\
+  DECLARE_UINT_KEYARRAY_TYPES( typeName##Part, dataType )\
+  KEYARRAY_DECLARE_SHARDED_TYPES( typeName, unsigned )
+
+  #define DECLARE_UINT_KEYARRAY_CREATE_SHARDED( funcName, listType )\
+  KEYARRAY_DECLARE_SHARDED_CREATE( funcName, listType, unsigned, Uint,\
+      KEYARRAY_COMPARE_UINT )
+
+  #define DECLARE_UINT_KEYARRAY_FREE_SHARDED( funcName, listType,\
+      freeDataFunc )\
+  KEYARRAY_DECLARE_SHARDED_FREE( funcName, listType, Uint,\
+      DECLARE_UINT_KEYARRAY_FREE, freeDataFunc )
+
+  #define DECLARE_UINT_KEYARRAY_INSERT_SHARDED( funcName, listType,\
+      dataType )\
+  KEYARRAY_DECLARE_SHARDED_CALL( funcName, listType, unsigned, Uint,\
+      dataType, DECLARE_UINT_KEYARRAY_INSERT, pthread_rwlock_wrlock )
+
+  #define DECLARE_UINT_KEYARRAY_REMOVE_SHARDED( funcName, listType,\
+      freeDataFunc )\
+  KEYARRAY_DECLARE_SHARDED_REMOVE( funcName, listType, unsigned, Uint,\
+      DECLARE_UINT_KEYARRAY_REMOVE, freeDataFunc )
+
+  #define DECLARE_UINT_KEYARRAY_RETRIEVE_SHARDED( funcName, listType,\
+      dataType )\
+  KEYARRAY_DECLARE_SHARDED_CALL( funcName, listType, unsigned, Uint,\
+      dataType, DECLARE_UINT_KEYARRAY_RETRIEVE, pthread_rwlock_rdlock )
+
+  #define DECLARE_UINT_KEYARRAY_MODIFY_SHARDED( funcName, listType,\
+      dataType )\
+  KEYARRAY_DECLARE_SHARDED_CALL( funcName, listType, unsigned, Uint,\
+      dataType, DECLARE_UINT_KEYARRAY_MODIFY, pthread_rwlock_wrlock )
+
+  #define DECLARE_UINT_KEYARRAY_ITERATEBEGIN_SHARDED( funcName, listType )\
+  KEYARRAY_DECLARE_SHARDED_ITERATEBEGIN( funcName, listType,\
+      KEYARRAY_COMPARE_UINT )
+
+  #define DECLARE_UINT_KEYARRAY_ITERATENEXT_SHARDED( funcName, listType )\
+  KEYARRAY_DECLARE_SHARDED_ITERATENEXT( funcName, listType,\
+      KEYARRAY_COMPARE_UINT )
+
+  #define DECLARE_UINT_KEYARRAY_ITERATEEND_SHARDED( funcName, listType )\
+  KEYARRAY_DECLARE_SHARDED_ITERATEEND( funcName, listType )
+
+  #endif
+
+/*
+ * ===========================================
+ *  Key Array implementation, snapshot layout
+ * ===========================================
+ */
+
+  /* Snapshot lists publish versions with atomic builtins, and serialize
+     writers with a POSIX mutex, so they are only declared when
+     KEYARRAY_THREADS is defined before including keyarray.h */
+  #if defined(KEYARRAY_THREADS)
+
+  #include <pthread.h>
+
+  /* Keeps the epochs of neighbouring readers off one cache line */
+  #ifndef KEYARRAY_SNAPSHOT_PADDING
+    #define KEYARRAY_SNAPSHOT_PADDING 64
+  #endif
+
+  #define KEYARRAY_ATOMIC_LOAD( source )\
+    __atomic_load_n((source), __ATOMIC_SEQ_CST)
+
+  #define KEYARRAY_ATOMIC_STORE( dest, value )\
+    __atomic_store_n((dest), (value), __ATOMIC_SEQ_CST)
+
+  #define KEYARRAY_ATOMIC_RELEASE( dest, value )\
+    __atomic_store_n((dest), (value), __ATOMIC_RELEASE)
+
+  #define KEYARRAY_ATOMIC_EXCHANGE( dest, value )\
+    __atomic_exchange_n((dest), (value), __ATOMIC_SEQ_CST)
+
+  /* Epoch of a reader slot. 0 while the reader is outside a snapshot,
+     otherwise the list epoch when it entered. */
+  typedef struct KeyArraySnapshotReader {
+    unsigned long long epoch;
+    char padding[KEYARRAY_SNAPSHOT_PADDING];
+  } KeyArraySnapshotReader;
+
+  #define KEYARRAY_DECLARE_SNAPSHOT_TYPES( typeName )\
+  typedef typeName##PartItem typeName##Item;\
+  \
+  typedef struct typeName##Version {\
+    typeName##Part* list;\
+    unsigned long long retireEpoch;\
+    struct typeName##Version* nextRetired;\
+  } typeName##Version;\
+  \
+  typedef struct typeName {\
+    typeName##Version* current;\
+    unsigned long long epoch;\
+    size_t readerCount;\
+    KeyArraySnapshotReader* reader;\
+    pthread_mutex_t writeLock;\
+    typeName##Version* draft;\
+    typeName##Version* retired;\
+  } typeName;
+
+  #define KEYARRAY_DECLARE_SNAPSHOT_CREATE( funcName, listType )\
+  listType* funcName( size_t readerCount ) {\
+    listType* newList = NULL;\
+    \
+    if( readerCount > (((size_t)-1) / sizeof(KeyArraySnapshotReader)) ) {\
+      return NULL;\
+    }\
+    \
+    newList = (listType*)calloc(1, sizeof(listType));\
+    if( newList == NULL ) {\
+      goto ReturnError;\
+    }\
+    \
+    if( readerCount ) {\
+      newList->reader = (KeyArraySnapshotReader*)calloc(readerCount,\
+          sizeof(KeyArraySnapshotReader));\
+      if( newList->reader == NULL ) {\
+        goto ReturnError;\
       }\
-      \
-      removeIndex = (leftIndex + rightIndex) / 2;\
     }\
+    \
+    /* The first version is an empty list */\
+    newList->current =\
+      (listType##Version*)calloc(1, sizeof(listType##Version));\
+    if( newList->current == NULL ) {\
+      goto ReturnError;\
+    }\
+    \
+    newList->current->list =\
+      (listType##Part*)calloc(1, sizeof(listType##Part));\
+    if( newList->current->list == NULL ) {\
+      goto ReturnError;\
+    }\
+    \
+    if( pthread_mutex_init(&(newList->writeLock), NULL) != 0 ) {\
+      goto ReturnError;\
+    }\
+    \
+    newList->readerCount = readerCount;\
+    newList->epoch = 1;\
+    \
+    return newList;\
+    \
+  ReturnError:\
+    if( newList ) {\
+      if( newList->current ) {\
+        free( newList->current->list );\
+        free( newList->current );\
+      }\
+      free( newList->reader );\
+      free( newList );\
+      newList = NULL;\
+    }\
+    \
+    return NULL;\
   }
 
-  #define DECLARE_STRING_KEYARRAY_RETRIEVE( funcName, listType, dataType )\
-  int funcName( listType* keyList, char* key, dataType* destData ) {\
-    unsigned leftIndex;\
-    unsigned rightIndex;\
-    unsigned retrieveIndex;\
-    int result;\
-    unsigned reservedCount;\
-    unsigned itemCount;\
-    listType##Item* item;\
+  #define KEYARRAY_DECLARE_SNAPSHOT_FREE( funcName, listType,\
+      declareFree, freeDataFunc )\
+  static declareFree( funcName##Part, listType##Part, freeDataFunc )\
+  \
+  void funcName( listType** keyList ) {\
+    listType##Version* version;\
     \
-    if( !(keyList && keyList->item && key && (*key) && destData) ) {\
-      return 0;\
+    if( !(keyList && (*keyList)) ) {\
+      return;\
     }\
     \
-    reservedCount = keyList->reservedCount;\
-    itemCount = keyList->itemCount;\
-    item = keyList->item;\
+    if( (*keyList)->draft ) {\
+      funcName##Part( &((*keyList)->draft->list) );\
+      free( (*keyList)->draft );\
+    }\
     \
-    /* Search for item */\
-    leftIndex = 0;\
-    rightIndex = itemCount;\
-    retrieveIndex = itemCount / 2;\
+    while( (*keyList)->retired ) {\
+      version = (*keyList)->retired;\
+      (*keyList)->retired = version->nextRetired;\
+      funcName##Part( &(version->list) );\
+      free( version );\
+    }\
     \
-    while( leftIndex < rightIndex ) {\
-      result = strcmp(item[retrieveIndex].key, key);\
-      \
-      if( result == 0 ) {\
-        memcpy( destData, &(item[retrieveIndex].data), sizeof(dataType) );\
-        return 1;\
-      }\
-      \
-      if( result > 0 ) {\
-        rightIndex = retrieveIndex;\
-      } else {\
-        leftIndex = retrieveIndex + 1;\
-      }\
-      \
-      retrieveIndex = (leftIndex + rightIndex) / 2;\
+    funcName##Part( &((*keyList)->current->list) );\
+    free( (*keyList)->current );\
+    \
+    pthread_mutex_destroy( &((*keyList)->writeLock) );\
+    free( (*keyList)->reader );\
+    free( (*keyList) );\
+    (*keyList) = NULL;\
+  }
+
+  #define KEYARRAY_DECLARE_SNAPSHOT_READBEGIN( funcName, listType )\
+  listType##Part* funcName( listType* keyList, size_t readerIndex ) {\
+    KeyArraySnapshotReader* reader;\
+    listType##Version* version;\
+    \
+    if( !(keyList && (readerIndex < keyList->readerCount)) ) {\
+      return NULL;\
     }\
     \
-    return 0;\
+    /* The epoch is published before the version is loaded, so a writer\
+       that retires this version sees the reader, and keeps it */\
+    reader = &(keyList->reader[readerIndex]);\
+    KEYARRAY_ATOMIC_STORE( &(reader->epoch),\
+        KEYARRAY_ATOMIC_LOAD(&(keyList->epoch)) );\
+    version = KEYARRAY_ATOMIC_LOAD(&(keyList->current));\
+    \
+    return version->list;\
   }
 
-  #define DECLARE_STRING_KEYARRAY_MODIFY( funcName, listType, dataType )\
-  int funcName( listType* keyList, char* key, dataType* sourceData ) {\
-    unsigned leftIndex;\
-    unsigned rightIndex;\
-    unsigned modifyIndex;\
+  #define KEYARRAY_DECLARE_SNAPSHOT_READEND( funcName, listType )\
+  void funcName( listType* keyList, size_t readerIndex ) {\
+    if( !(keyList && (readerIndex < keyList->readerCount)) ) {\
+      return;\
+    }\
+    \
+    KEYARRAY_ATOMIC_RELEASE( &(keyList->reader[readerIndex].epoch), 0 );\
+  }
+
+  #define KEYARRAY_DECLARE_SNAPSHOT_RETRIEVE( funcName, listType,\
+      keyType, dataType, declareRetrieve )\
+  static declareRetrieve( funcName##Part, listType##Part, dataType )\
+  static KEYARRAY_DECLARE_SNAPSHOT_READBEGIN( funcName##Begin, listType )\
+  static KEYARRAY_DECLARE_SNAPSHOT_READEND( funcName##End, listType )\
+  \
+  int funcName( listType* keyList, size_t readerIndex, keyType key,\
+      dataType* destData ) {\
+    listType##Part* snapshot;\
     int result;\
-    unsigned reservedCount;\
-    unsigned itemCount;\
-    listType##Item* item;\
     \
-    if( !(keyList && keyList->item && key && (*key) && sourceData) ) {\
+    snapshot = funcName##Begin(keyList, readerIndex);\
+    if( snapshot == NULL ) {\
       return 0;\
     }\
     \
-    reservedCount = keyList->reservedCount;\
-    itemCount = keyList->itemCount;\
-    item = keyList->item;\
+    result = funcName##Part(snapshot, key, destData);\
+    funcName##End( keyList, readerIndex );\
     \
-    /* Search for item */\
-    leftIndex = 0;\
-    rightIndex = itemCount;\
-    modifyIndex = itemCount / 2;\
+    return result;\
+  }
+
+  #define KEYARRAY_DECLARE_SNAPSHOT_WRITEBEGIN( funcName, listType,\
+      dataType, declareCopy, copyDataFunc, freeDataFunc )\
+  static declareCopy( funcName##Part, listType##Part, dataType,\
+      copyDataFunc, freeDataFunc )\
+  \
+  listType##Part* funcName( listType* keyList ) {\
+    listType##Version* draft;\
     \
-    while( leftIndex < rightIndex ) {\
-      result = strcmp(item[modifyIndex].key, key);\
-      \
-      if( result == 0 ) {\
-        memcpy( &(item[modifyIndex].data), sourceData, sizeof(dataType) );\
-        return 1;\
-      }\
-      \
-      if( result > 0 ) {\
-        rightIndex = modifyIndex;\
-      } else {\
-        leftIndex = modifyIndex + 1;\
-      }\
-      \
-      modifyIndex = (leftIndex + rightIndex) / 2;\
+    if( keyList == NULL ) {\
+      return NULL;\
     }\
     \
-    return 0;\
+    if( pthread_mutex_lock(&(keyList->writeLock)) != 0 ) {\
+      return NULL;\
+    }\
+    \
+    /* Allocated now, so that commit cannot fail */\
+    draft = (listType##Version*)calloc(1, sizeof(listType##Version));\
+    if( draft == NULL ) {\
+      goto ReturnError;\
+    }\
+    \
+    /* Only writers change current, and this writer holds the lock */\
+    draft->list = funcName##Part(keyList->current->list);\
+    if( draft->list == NULL ) {\
+      goto ReturnError;\
+    }\
+    \
+    keyList->draft = draft;\
+    \
+    return draft->list;\
+    \
+  ReturnError:\
+    free( draft );\
+    pthread_mutex_unlock( &(keyList->writeLock) );\
+    \
+    return NULL;\
   }
 
-  #define DECLARE_STRING_KEYARRAY_FINDINDEX( funcName, listType )\
-  int funcName( listType* keyList, char* key ) {\
-    unsigned leftIndex;\
-    unsigned rightIndex;\
-    unsigned searchIndex;\
-    int result;\
-    unsigned reservedCount;\
-    unsigned itemCount;\
-    listType##Item* item;\
+  /* A published part is read by many threads at once, so it must not
+     hold anything a lookup writes to. The lookup cache is released. A
+     stale search index is rebuilt now, so that readers use it, or
+     released if that fails. */
+  #define KEYARRAY_SNAPSHOT_STRING_PUBLISH( partList )\
+  KeyArrayFreeLookupCache( &((partList)->lookupCache) );
+
+  #define KEYARRAY_SNAPSHOT_UINT_PUBLISH( partList )\
+  KeyArrayFreeLookupCache( &((partList)->lookupCache) );\
+  if( (partList)->searchIndex &&\
+      !((partList)->searchIndex->built &&\
+      ((partList)->searchIndex->generation == (partList)->generation)) &&\
+      (KeyArrayUintBuildSearchIndex((partList)->searchIndex,\
+      (partList)->item, sizeof((partList)->item[0]), (partList)->itemCount,\
+      (partList)->generation) == 0) ) {\
+    KeyArrayUintFreeSearchIndex( &((partList)->searchIndex) );\
+  }
+
+  #define KEYARRAY_DECLARE_SNAPSHOT_WRITECOMMIT( funcName, listType,\
+      declareFree, freeDataFunc, publishPart )\
+  static declareFree( funcName##Part, listType##Part, freeDataFunc )\
+  \
+  int funcName( listType* keyList ) {\
+    listType##Version* version;\
+    listType##Version** retiredLink;\
+    unsigned long long readerEpoch;\
+    unsigned long long oldestEpoch;\
+    size_t index;\
     \
-    if( !(keyList && keyList->item && key && (*key)) ) {\
-      return (-1);\
+    if( !(keyList && keyList->draft) ) {\
+      return 0;\
     }\
     \
-    reservedCount = keyList->reservedCount;\
-    itemCount = keyList->itemCount;\
-    item = keyList->item;\
+    publishPart( keyList->draft->list )\
     \
-    /* Search for item */\
-    leftIndex = 0;\
-    rightIndex = itemCount;\
-    searchIndex = itemCount / 2;\
+    /* Publish the draft, and retire the version it replaces */\
+    version = KEYARRAY_ATOMIC_EXCHANGE(&(keyList->current),\
+        keyList->draft);\
+    keyList->draft = NULL;\
     \
-    while( leftIndex < rightIndex ) {\
-      result = strcmp(item[searchIndex].key, key);\
-      \
-      if( result == 0 ) {\
-        return searchIndex;\
+    version->retireEpoch = KEYARRAY_ATOMIC_LOAD(&(keyList->epoch));\
+    version->nextRetired = keyList->retired;\
+    keyList->retired = version;\
+    KEYARRAY_ATOMIC_STORE( &(keyList->epoch), version->retireEpoch + 1 );\
+    \
+    /* Readers that entered at, or before, a version's retire epoch may\
+       still hold it. Every other retired version is released. */\
+    oldestEpoch = (unsigned long long)-1;\
+    for( index = 0; index < keyList->readerCount; index++ ) {\
+      readerEpoch = KEYARRAY_ATOMIC_LOAD(&(keyList->reader[index].epoch));\
+      if( readerEpoch && (readerEpoch < oldestEpoch) ) {\
+        oldestEpoch = readerEpoch;\
       }\
-      \
-      if( result > 0 ) {\
-        rightIndex = searchIndex;\
+    }\
+    \
+    retiredLink = &(keyList->retired);\
+    while( (*retiredLink) ) {\
+      version = (*retiredLink);\
+      if( version->retireEpoch < oldestEpoch ) {\
+        (*retiredLink) = version->nextRetired;\
+        funcName##Part( &(version->list) );\
+        free( version );\
       } else {\
-        leftIndex = searchIndex + 1;\
+        retiredLink = &(version->nextRetired);\
       }\
-      \
-      searchIndex = (leftIndex + rightIndex) / 2;\
     }\
     \
-    return (-1);\
+    pthread_mutex_unlock( &(keyList->writeLock) );\
+    \
+    return 1;\
   }
 
-  #define DECLARE_STRING_KEYARRAY_RELEASEUNUSED( funcName, listType )\
+  #define KEYARRAY_DECLARE_SNAPSHOT_WRITEABORT( funcName, listType,\
+      declareFree, freeDataFunc )\
+  static declareFree( funcName##Part, listType##Part, freeDataFunc )\
+  \
   void funcName( listType* keyList ) {\
-    listType##Item* item;\
-    \
-    if( keyList == NULL ) {\
+    if( !(keyList && keyList->draft) ) {\
       return;\
     }\
     \
-    if( keyList->item && keyList->itemCount ) {\
-      /* Resize to remove reserved space*/\
-      item = realloc(keyList->item,\
-        keyList->itemCount * sizeof(listType##Item));\
-      if( item ) {\
-        keyList->item = item;\
-        keyList->reservedCount = keyList->itemCount;\
-      }\
-    } else {\
-      /* Deallocate */\
-      keyList->reservedCount = 0;\
-      keyList->itemCount = 0;\
-      if( keyList->item ) {\
-        free( keyList->item );\
-        keyList->item = NULL;\
-      }\
-    }\
+    funcName##Part( &(keyList->draft->list) );\
+    free( keyList->draft );\
+    keyList->draft = NULL;\
+    \
+    pthread_mutex_unlock( &(keyList->writeLock) );\
   }
 
-  #define DECLARE_STRING_KEYARRAY_COPY( funcName, listType, dataType,\
-      copyDataFunc, freeDataFunc )\
-  listType* funcName( listType* sourceList ) {\
-    listType* newCopy = NULL;\
-    listType##Item* sourceItem = NULL;\
-    size_t reservedCount = 0;\
-    size_t itemCount = 0;\
-    char* keyCopy;\
-    size_t keyLen;\
+  /* String key snapshot list */
+  #define DECLARE_STRING_KEYARRAY_TYPES_SNAPSHOT( typeName, dataType )\
+  DECLARE_STRING_KEYARRAY_TYPES( typeName##Part, dataType )\
+  KEYARRAY_DECLARE_SNAPSHOT_TYPES( typeName )
+
+  #define DECLARE_STRING_KEYARRAY_CREATE_SNAPSHOT( funcName, listType )\
+  KEYARRAY_DECLARE_SNAPSHOT_CREATE( funcName, listType )
+
+  #define DECLARE_STRING_KEYARRAY_FREE_SNAPSHOT( funcName, listType,\
+      freeDataFunc )\
+  KEYARRAY_DECLARE_SNAPSHOT_FREE( funcName, listType,\
+      DECLARE_STRING_KEYARRAY_FREE, freeDataFunc )
+
+  #define DECLARE_STRING_KEYARRAY_READBEGIN_SNAPSHOT( funcName, listType )\
+  KEYARRAY_DECLARE_SNAPSHOT_READBEGIN( funcName, listType )
+
+  #define DECLARE_STRING_KEYARRAY_READEND_SNAPSHOT( funcName, listType )\
+  KEYARRAY_DECLARE_SNAPSHOT_READEND( funcName, listType )
+
+  #define DECLARE_STRING_KEYARRAY_RETRIEVE_SNAPSHOT( funcName, listType,\
+      dataType )\
+  KEYARRAY_DECLARE_SNAPSHOT_RETRIEVE( funcName, listType, char*,\
+      dataType, DECLARE_STRING_KEYARRAY_RETRIEVE )
+
+  #define DECLARE_STRING_KEYARRAY_WRITEBEGIN_SNAPSHOT( funcName, listType,\
+      dataType, copyDataFunc, freeDataFunc )\
+  KEYARRAY_DECLARE_SNAPSHOT_WRITEBEGIN( funcName, listType, dataType,\
+      DECLARE_STRING_KEYARRAY_COPY, copyDataFunc, freeDataFunc )
+
+  #define DECLARE_STRING_KEYARRAY_WRITECOMMIT_SNAPSHOT( funcName,\
+      listType, freeDataFunc )\
+  KEYARRAY_DECLARE_SNAPSHOT_WRITECOMMIT( funcName, listType,\
+      DECLARE_STRING_KEYARRAY_FREE, freeDataFunc,\
+      KEYARRAY_SNAPSHOT_STRING_PUBLISH )
+
+  #define DECLARE_STRING_KEYARRAY_WRITEABORT_SNAPSHOT( funcName, listType,\
+      freeDataFunc )\
+  KEYARRAY_DECLARE_SNAPSHOT_WRITEABORT( funcName, listType,\
+      DECLARE_STRING_KEYARRAY_FREE, freeDataFunc )
+
+  /* Unsigned key snapshot list */
+  #define DECLARE_UINT_KEYARRAY_TYPES_SNAPSHOT( typeName, dataType )\
+  DECLARE_UINT_KEYARRAY_TYPES( typeName##Part, dataType )\
+  KEYARRAY_DECLARE_SNAPSHOT_TYPES( typeName )
+
+  #define DECLARE_UINT_KEYARRAY_CREATE_SNAPSHOT( funcName, listType )\
+  KEYARRAY_DECLARE_SNAPSHOT_CREATE( funcName, listType )
+
+  #define DECLARE_UINT_KEYARRAY_FREE_SNAPSHOT( funcName, listType,\
+      freeDataFunc )\
+  KEYARRAY_DECLARE_SNAPSHOT_FREE( funcName, listType,\
+      DECLARE_UINT_KEYARRAY_FREE, freeDataFunc )
+
+  #define DECLARE_UINT_KEYARRAY_READBEGIN_SNAPSHOT( funcName, listType )\
+  KEYARRAY_DECLARE_SNAPSHOT_READBEGIN( funcName, listType )
+
+  #define DECLARE_UINT_KEYARRAY_READEND_SNAPSHOT( funcName, listType )\
+  KEYARRAY_DECLARE_SNAPSHOT_READEND( funcName, listType )
+
+  #define DECLARE_UINT_KEYARRAY_RETRIEVE_SNAPSHOT( funcName, listType,\
+      dataType )\
+  KEYARRAY_DECLARE_SNAPSHOT_RETRIEVE( funcName, listType, unsigned,\
+      dataType, DECLARE_UINT_KEYARRAY_RETRIEVE )
+
+  #define DECLARE_UINT_KEYARRAY_WRITEBEGIN_SNAPSHOT( funcName, listType,\
+      dataType, copyDataFunc, freeDataFunc )\
+  KEYARRAY_DECLARE_SNAPSHOT_WRITEBEGIN( funcName, listType, dataType,\
+      DECLARE_UINT_KEYARRAY_COPY, copyDataFunc, freeDataFunc )
+
+  #define DECLARE_UINT_KEYARRAY_WRITECOMMIT_SNAPSHOT( funcName, listType,\
+      freeDataFunc )\
+  KEYARRAY_DECLARE_SNAPSHOT_WRITECOMMIT( funcName, listType,\
+      DECLARE_UINT_KEYARRAY_FREE, freeDataFunc,\
+      KEYARRAY_SNAPSHOT_UINT_PUBLISH )
+
+  #define DECLARE_UINT_KEYARRAY_WRITEABORT_SNAPSHOT( funcName, listType,\
+      freeDataFunc )\
+  KEYARRAY_DECLARE_SNAPSHOT_WRITEABORT( funcName, listType,\
+      DECLARE_UINT_KEYARRAY_FREE, freeDataFunc )
+
+  #endif
+
+/*
+ * ========================================
+ *  Key Array implementation, mapped files
+ * ========================================
+ */
+
+  /* Mapped files use POSIX mmap and fsync, so they are only declared when
+     KEYARRAY_MAPPED is defined before including keyarray.h */
+  #if defined(KEYARRAY_MAPPED)
+
+  #include <stdio.h>
+  #include <fcntl.h>
+  #include <unistd.h>
+  #include <sys/mman.h>
+  #include <sys/stat.h>
+
+  #define KEYARRAY_FILE_VERSION 1
+  #define KEYARRAY_FILE_BYTEORDER 0x01020304U
+  #define KEYARRAY_FILE_STRING 1
+  #define KEYARRAY_FILE_UINT 2
+
+  /* Items start at this file offset, after the header */
+  #define KEYARRAY_FILE_ITEMOFFSET 128
+
+  /* File header. Sections are found by offset from the start of the
+     file, and keys by offset from the start of the string pool, so the
+     file can be mapped at any address. */
+  typedef struct KeyArrayFileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t byteOrder;
+    uint32_t keyKind;
+    uint32_t keySize;
+    uint64_t itemSize;
+    uint64_t dataSize;
+    uint64_t itemCount;
+    uint64_t itemOffset;
+    uint64_t poolOffset;
+    uint64_t poolSize;
+  } KeyArrayFileHeader;
+
+  static inline void KeyArraySetFileHeader( KeyArrayFileHeader* header,
+      uint32_t keyKind, uint32_t keySize, size_t itemSize,
+      size_t dataSize, size_t itemCount, size_t poolSize ) {
+    memset( header, 0, sizeof(KeyArrayFileHeader) );
+    memcpy( header->magic, "KEYARRAY", 8 );
+    header->version = KEYARRAY_FILE_VERSION;
+    header->byteOrder = KEYARRAY_FILE_BYTEORDER;
+    header->keyKind = keyKind;
+    header->keySize = keySize;
+    header->itemSize = itemSize;
+    header->dataSize = dataSize;
+    header->itemCount = itemCount;
+    header->itemOffset = KEYARRAY_FILE_ITEMOFFSET;
+    header->poolOffset = KEYARRAY_FILE_ITEMOFFSET +
+      ((uint64_t)itemCount * itemSize);
+    header->poolSize = poolSize;
+  }
+
+  /* Writes header, then pads the file up to the first item */
+  static inline int KeyArrayWriteFileHeader( FILE* file,
+      const KeyArrayFileHeader* header ) {
+    char padding[KEYARRAY_FILE_ITEMOFFSET];
+
+    memset( padding, 0, sizeof(padding) );
+    return (fwrite(header, sizeof(KeyArrayFileHeader), 1, file) == 1) &&
+      (fwrite(padding, KEYARRAY_FILE_ITEMOFFSET -
+      sizeof(KeyArrayFileHeader), 1, file) == 1);
+  }
+
+  /* Save writes to fileName with this suffix, then renames the file
+     over fileName once it is on disk, so a crash leaves either the old
+     file or the new one */
+  #define KEYARRAY_FILE_TEMPSUFFIX ".tmp"
+
+  static inline FILE* KeyArrayCreateSaveFile( const char* fileName,
+      char** tempName ) {
+    size_t nameLen = strlen(fileName);
+    FILE* file;
+
+    (*tempName) = (char*)malloc(nameLen +
+        sizeof(KEYARRAY_FILE_TEMPSUFFIX));
+    if( (*tempName) == NULL ) {
+      return NULL;
+    }
+    memcpy( (*tempName), fileName, nameLen );
+    memcpy( (*tempName) + nameLen, KEYARRAY_FILE_TEMPSUFFIX,
+        sizeof(KEYARRAY_FILE_TEMPSUFFIX) );
+
+    file = fopen((*tempName), "wb");
+    if( file == NULL ) {
+      free( (*tempName) );
+      (*tempName) = NULL;
+    }
+
+    return file;
+  }
+
+  /* Closes file. If written is non-zero, the file is synced to disk,
+     and renamed over fileName; otherwise, or if that fails, it is
+     removed. fileName is left untouched unless the rename succeeds.
+     Returns non-zero if fileName was replaced. */
+  static inline int KeyArrayFinishSaveFile( FILE* file, char* tempName,
+      const char* fileName, int written ) {
+    if( written &&
+        ((fflush(file) != 0) || (fsync(fileno(file)) != 0)) ) {
+      written = 0;
+    }
+
+    if( fclose(file) != 0 ) {
+      written = 0;
+    }
+
+    if( written && (rename(tempName, fileName) != 0) ) {
+      written = 0;
+    }
+
+    if( written == 0 ) {
+      remove( tempName );
+    }
+    free( tempName );
+
+    return written;
+  }
+
+  /* Maps fileName read-only, and checks that its header matches the
+     list it is opened as. String key offsets are checked against the
+     pool, so that no lookup reads outside the mapping, and keys are
+     checked to be sorted and unique, so that every search finds them. */
+  static inline const KeyArrayFileHeader* KeyArrayMapFile(
+      const char* fileName, uint32_t keyKind, uint32_t keySize,
+      size_t itemSize, size_t dataSize, size_t* mappingSize ) {
+    const KeyArrayFileHeader* header = NULL;
+    struct stat fileStat;
+    void* mapping = MAP_FAILED;
+    const char* itemBase;
+    const char* pool;
+    uint64_t fileSize;
+    uint64_t index;
+    uint64_t keyOffset;
+    uint64_t lastOffset = 0;
+    int file;
+
+    file = open(fileName, O_RDONLY);
+    if( file < 0 ) {
+      return NULL;
+    }
+
+    if( (fstat(file, &fileStat) != 0) ||
+        (fileStat.st_size < KEYARRAY_FILE_ITEMOFFSET) ||
+        ((uint64_t)fileStat.st_size > (size_t)-1) ) {
+      close( file );
+      return NULL;
+    }
+
+    fileSize = (uint64_t)fileStat.st_size;
+    mapping = mmap(NULL, (size_t)fileSize, PROT_READ, MAP_SHARED, file, 0);
+    close( file );
+    if( mapping == MAP_FAILED ) {
+      return NULL;
+    }
+
+    header = (const KeyArrayFileHeader*)mapping;
+    if( (memcmp(header->magic, "KEYARRAY", 8) != 0) ||
+        (header->version != KEYARRAY_FILE_VERSION) ||
+        (header->byteOrder != KEYARRAY_FILE_BYTEORDER) ||
+        (header->keyKind != keyKind) || (header->keySize != keySize) ||
+        (header->itemSize != itemSize) || (header->dataSize != dataSize) ||
+        (header->itemOffset != KEYARRAY_FILE_ITEMOFFSET) ||
+        (header->itemCount > ((fileSize - KEYARRAY_FILE_ITEMOFFSET) /
+        itemSize)) ||
+        (header->poolOffset != (KEYARRAY_FILE_ITEMOFFSET +
+        (header->itemCount * itemSize))) ||
+        (header->poolSize > (fileSize - header->poolOffset)) ||
+        (header->poolSize &&
+        (((const char*)mapping)[header->poolOffset +
+        header->poolSize - 1] != '\0')) ) {
+      munmap( mapping, (size_t)fileSize );
+      return NULL;
+    }
+
+    /* Each item starts with the pool offset of its key. The pool ends
+       with '\0', so every key in it is terminated. */
+    itemBase = (const char*)mapping + header->itemOffset;
+    pool = (const char*)mapping + header->poolOffset;
+    for( index = 0; index < header->itemCount; index++ ) {
+      if( keyKind == KEYARRAY_FILE_STRING ) {
+        keyOffset = *(const uint64_t*)(itemBase + (index * itemSize));
+        if( (keyOffset >= header->poolSize) || (index &&
+            (strcmp(pool + lastOffset, pool + keyOffset) >= 0)) ) {
+          break;
+        }
+        lastOffset = keyOffset;
+      } else if( index && (*(const unsigned*)(itemBase +
+          ((index - 1) * itemSize)) >= *(const unsigned*)(itemBase +
+          (index * itemSize))) ) {
+        break;
+      }
+    }
+
+    if( index != header->itemCount ) {
+      munmap( mapping, (size_t)fileSize );
+      return NULL;
+    }
+
+    (*mappingSize) = (size_t)fileSize;
+    return header;
+  }
+
+  /* Bound search of string keys stored as string pool offsets */
+  static inline size_t KeyArrayStringOffsetBound( const char* pool,
+      const void* offsetBase, size_t offsetStride, size_t count,
+      const char* key, int upperBound ) {
+    size_t leftIndex = 0;
+    size_t rightIndex = count;
+    size_t searchIndex;
+    int result;
+
+    while( leftIndex < rightIndex ) {
+      searchIndex = leftIndex + ((rightIndex - leftIndex) / 2);
+      result = strcmp(pool + *(const uint64_t*)((const char*)offsetBase +
+          (searchIndex * offsetStride)), key);
+      if( (result < 0) || (upperBound && (result == 0)) ) {
+        leftIndex = searchIndex + 1;
+      } else {
+        rightIndex = searchIndex;
+      }
+    }
+
+    return leftIndex;
+  }
+
+  #define DECLARE_STRING_KEYARRAY_TYPES_MAPPED( typeName, dataType )\
+  typedef struct typeName##FileItem {\
+    uint64_t keyOffset;\
+    dataType data;\
+  } typeName##FileItem;\
+  \
+  typedef struct typeName##Mapped {\
+    const typeName##FileItem* item;\
+    size_t itemCount;\
+    const char* pool;\
+    const void* mapping;\
+    size_t mappingSize;\
+  } typeName##Mapped;
+
+  #define DECLARE_UINT_KEYARRAY_TYPES_MAPPED( typeName, dataType )\
+  typedef struct typeName##FileItem {\
+    unsigned key;\
+    dataType data;\
+  } typeName##FileItem;\
+  \
+  typedef struct typeName##Mapped {\
+    const typeName##FileItem* item;\
+    size_t itemCount;\
+    const char* pool;\
+    const void* mapping;\
+    size_t mappingSize;\
+  } typeName##Mapped;
+
+  #define DECLARE_STRING_KEYARRAY_SAVE( funcName, listType, dataType )\
+  int funcName( listType* keyList, const char* fileName ) {\
+    KeyArrayFileHeader header;\
+    listType##FileItem fileItem;\
+    FILE* file = NULL;\
+    char* tempName = NULL;\
+    size_t itemCount;\
     size_t index;\
+    size_t keyLen;\
+    uint64_t poolSize = 0;\
     \
-    if( sourceList == NULL ) {\
-      return NULL;\
+    if( !(keyList && fileName) ) {\
+      return 0;\
     }\
     \
-    /* Attempt to allocate list object */\
-    newCopy = calloc(1, sizeof(listType));\
-    if( newCopy == NULL ) {\
-      goto ReturnError;\
+    itemCount = keyList->item ? keyList->itemCount : 0;\
+    for( index = 0; index < itemCount; index++ ) {\
+      poolSize += strlen(keyList->item[index].key) + 1;\
     }\
     \
-    /* Initialize important variables */\
-    reservedCount = sourceList->reservedCount;\
-    itemCount = sourceList->itemCount;\
-    sourceItem = sourceList->item;\
+    KeyArraySetFileHeader( &header, KEYARRAY_FILE_STRING, 0,\
+        sizeof(listType##FileItem), sizeof(dataType), itemCount,\
+        poolSize );\
     \
-    /* A list with no items is valid */\
-    if( !(reservedCount && itemCount && sourceItem) ) {\
-      return newCopy;\
+    file = KeyArrayCreateSaveFile(fileName, &tempName);\
+    if( file == NULL ) {\
+      return 0;\
     }\
     \
-    /* Copy data, then copy the string keys */\
-    newCopy->item = malloc(reservedCount * sizeof(listType##Item));\
-    if( newCopy->item == NULL ) {\
+    if( KeyArrayWriteFileHeader(file, &header) == 0 ) {\
       goto ReturnError;\
     }\
     \
+    /* Items hold the offset of their key in the string pool */\
+    poolSize = 0;\
     for( index = 0; index < itemCount; index++ ) {\
-      /* Direct copy by default, allowing copy function to be empty */\
-      newCopy->item[index].data = sourceItem[index].data;\
-      if( copyDataFunc(&(newCopy->item[index].data),\
-          &(sourceItem[index].data)) == 0 ) {\
+      memset( &fileItem, 0, sizeof(listType##FileItem) );\
+      fileItem.keyOffset = poolSize;\
+      memcpy( &(fileItem.data), &(keyList->item[index].data),\
+          sizeof(dataType) );\
+      if( fwrite(&fileItem, sizeof(listType##FileItem), 1, file) != 1 ) {\
         goto ReturnError;\
       }\
-      \
-      keyLen = strlen(sourceItem[index].key);\
-      keyCopy = malloc(keyLen + 1);\
-      if( keyCopy == NULL ) {\
+      poolSize += strlen(keyList->item[index].key) + 1;\
+    }\
+    \
+    for( index = 0; index < itemCount; index++ ) {\
+      keyLen = strlen(keyList->item[index].key) + 1;\
+      if( fwrite(keyList->item[index].key, keyLen, 1, file) != 1 ) {\
         goto ReturnError;\
       }\
-      strcpy( keyCopy, sourceItem[index].key );\
-      \
-      newCopy->item[index].key = keyCopy;\
     }\
     \
-    newCopy->reservedCount = reservedCount;\
-    newCopy->itemCount = itemCount;\
-    \
-    return newCopy;\
+    return KeyArrayFinishSaveFile(file, tempName, fileName, 1);\
     \
   ReturnError:\
-    if( newCopy == NULL ) {\
-      return NULL;\
+    KeyArrayFinishSaveFile( file, tempName, fileName, 0 );\
+    \
+    return 0;\
+  }
+
+  #define DECLARE_UINT_KEYARRAY_SAVE( funcName, listType, dataType )\
+  KEYARRAY_ASSERT_UINT_KEY( funcName, listType )\
+  int funcName( listType* keyList, const char* fileName ) {\
+    KeyArrayFileHeader header;\
+    listType##FileItem fileItem;\
+    FILE* file = NULL;\
+    char* tempName = NULL;\
+    size_t itemCount;\
+    size_t index;\
+    \
+    if( !(keyList && fileName) ) {\
+      return 0;\
     }\
     \
-    if( newCopy->item ) {\
-      for( index = 0; index < itemCount; index++ ) {\
-        freeDataFunc( &(newCopy->item[index].data) );\
-        \
-        keyCopy = newCopy->item[index].key;\
-        if( keyCopy ) {\
-          free( keyCopy );\
-          keyCopy = NULL;\
-        }\
+    itemCount = keyList->item ? keyList->itemCount : 0;\
+    KeyArraySetFileHeader( &header, KEYARRAY_FILE_UINT, sizeof(unsigned),\
+        sizeof(listType##FileItem), sizeof(dataType), itemCount, 0 );\
+    \
+    file = KeyArrayCreateSaveFile(fileName, &tempName);\
+    if( file == NULL ) {\
+      return 0;\
+    }\
+    \
+    if( KeyArrayWriteFileHeader(file, &header) == 0 ) {\
+      goto ReturnError;\
+    }\
+    \
+    /* Items are copied one at a time, so padding is written as zero */\
+    for( index = 0; index < itemCount; index++ ) {\
+      memset( &fileItem, 0, sizeof(listType##FileItem) );\
+      fileItem.key = keyList->item[index].key;\
+      memcpy( &(fileItem.data), &(keyList->item[index].data),\
+          sizeof(dataType) );\
+      if( fwrite(&fileItem, sizeof(listType##FileItem), 1, file) != 1 ) {\
+        goto ReturnError;\
       }\
     }\
     \
-    free( newCopy );\
-    newCopy = NULL;\
+    return KeyArrayFinishSaveFile(file, tempName, fileName, 1);\
     \
-    return NULL;\
+  ReturnError:\
+    KeyArrayFinishSaveFile( file, tempName, fileName, 0 );\
+    \
+    return 0;\
   }
 
-/*
- * ===================================
- *  Unsigned Key Array implementation
- * ===================================
- */
+  #define KEYARRAY_DECLARE_OPENMAPPED( funcName, listType, dataType,\
+      keyKind, keySize )\
+  int funcName( listType##Mapped* mappedList, const char* fileName ) {\
+    const KeyArrayFileHeader* header;\
+    size_t mappingSize = 0;\
+    \
+    if( !(mappedList && fileName) ) {\
+      return 0;\
+    }\
+    \
+    memset( mappedList, 0, sizeof(listType##Mapped) );\
+    header = KeyArrayMapFile(fileName, keyKind, keySize,\
+        sizeof(listType##FileItem), sizeof(dataType), &mappingSize);\
+    if( header == NULL ) {\
+      return 0;\
+    }\
+    \
+    mappedList->item = (const listType##FileItem*)\
+      ((const char*)header + header->itemOffset);\
+    mappedList->itemCount = (size_t)header->itemCount;\
+    if( header->poolSize ) {\
+      mappedList->pool = (const char*)header + header->poolOffset;\
+    }\
+    mappedList->mapping = header;\
+    mappedList->mappingSize = mappingSize;\
+    \
+    return 1;\
+  }
 
-  #define DECLARE_UINT_KEYARRAY_TYPES( typeName, dataType )\
-  typedef struct typeName##Item {\
-    unsigned key;\
-    dataType data;\
-  } typeName##Item;\
-  \
-  typedef struct typeName {\
-    size_t reservedCount;\
-    size_t itemCount;\
-    typeName##Item* item;\
-  } typeName;
+  #define DECLARE_STRING_KEYARRAY_OPENMAPPED( funcName, listType,\
+      dataType )\
+  KEYARRAY_DECLARE_OPENMAPPED( funcName, listType, dataType,\
+      KEYARRAY_FILE_STRING, 0 )
 
-  #define DECLARE_UINT_KEYARRAY_CREATE( funcName, listType )\
-  listType* funcName( size_t reserveCount ) {\
-    listType* newKeyArray = NULL;\
-    \
-    newKeyArray = (listType*)calloc(1, sizeof(listType));\
-    if( newKeyArray == NULL ) {\
-      goto ReturnError;\
+  #define DECLARE_UINT_KEYARRAY_OPENMAPPED( funcName, listType, dataType )\
+  KEYARRAY_DECLARE_OPENMAPPED( funcName, listType, dataType,\
+      KEYARRAY_FILE_UINT, sizeof(unsigned) )
+
+  #define KEYARRAY_DECLARE_CLOSEMAPPED( funcName, listType )\
+  void funcName( listType##Mapped* mappedList ) {\
+    if( !(mappedList && mappedList->mapping) ) {\
+      return;\
     }\
     \
-    if( reserveCount ) {\
-      newKeyArray->item =\
-        (listType##Item*)calloc(reserveCount, sizeof(listType##Item));\
-      if( newKeyArray->item == NULL ) {\
-        goto ReturnError;\
-      }\
-      \
-      newKeyArray->reservedCount = reserveCount;\
+    munmap( (void*)mappedList->mapping, mappedList->mappingSize );\
+    memset( mappedList, 0, sizeof(listType##Mapped) );\
+  }
+
+  #define DECLARE_STRING_KEYARRAY_CLOSEMAPPED( funcName, listType )\
+  KEYARRAY_DECLARE_CLOSEMAPPED( funcName, listType )
+
+  #define DECLARE_UINT_KEYARRAY_CLOSEMAPPED( funcName, listType )\
+  KEYARRAY_DECLARE_CLOSEMAPPED( funcName, listType )
+
+  /* Bounds of a key in a mapped list, by key kind */
+  #define KEYARRAY_MAPPED_STRING_BOUND( mappedList, startIndex, boundKey,\
+      upperBound )\
+    ((startIndex) + KeyArrayStringOffsetBound((mappedList)->pool,\
+        &((mappedList)->item[(startIndex)].keyOffset),\
+        sizeof(*((mappedList)->item)),\
+        (mappedList)->itemCount - (startIndex), (boundKey), (upperBound)))
+
+  #define KEYARRAY_MAPPED_UINT_BOUND( mappedList, startIndex, boundKey,\
+      upperBound )\
+    ((startIndex) + KeyArrayUintBound(\
+        &((mappedList)->item[(startIndex)].key),\
+        sizeof(*((mappedList)->item)),\
+        (mappedList)->itemCount - (startIndex), (boundKey), (upperBound)))
+
+  #define KEYARRAY_MAPPED_STRING_KEYAT( mappedList, index )\
+    ((mappedList)->pool + (mappedList)->item[(index)].keyOffset)
+
+  #define KEYARRAY_MAPPED_UINT_KEYAT( mappedList, index )\
+    ((mappedList)->item[(index)].key)
+
+  #define KEYARRAY_DECLARE_FINDINDEX_MAPPED( funcName, listType, keyType,\
+      keyKind, keyBound, keyAt, compareKeys )\
+  size_t funcName( listType##Mapped* mappedList, keyType key ) {\
+    size_t searchIndex;\
+    \
+    if( !(mappedList && mappedList->item &&\
+        KeyArray##keyKind##ValidKey(key)) ) {\
+      return ((size_t)-1);\
     }\
-    return newKeyArray;\
     \
-  ReturnError:\
-    if( newKeyArray ) {\
-      if( newKeyArray->item ) {\
-        free( newKeyArray->item );\
-        newKeyArray->item = NULL;\
-      }\
-      free( newKeyArray );\
-      newKeyArray = NULL;\
+    searchIndex = keyBound(mappedList, 0, key, 0);\
+    if( (searchIndex < mappedList->itemCount) &&\
+        (compareKeys(keyAt(mappedList, searchIndex), key) == 0) ) {\
+      return searchIndex;\
     }\
-    return NULL;\
+    \
+    return ((size_t)-1);\
   }
 
-  #define DECLARE_UINT_KEYARRAY_FREE( funcName, listType, freeDataFunc )\
-  void funcName( listType** keyList ) {\
-    size_t index;\
-    size_t itemCount;\
+  #define KEYARRAY_DECLARE_RETRIEVE_MAPPED( funcName, listType, keyType,\
+      dataType, keyKind, keyBound, keyAt, compareKeys )\
+  int funcName( listType##Mapped* mappedList, keyType key,\
+      dataType* destData ) {\
+    size_t searchIndex;\
     \
-    if( keyList && (*keyList) ) {\
-      itemCount = (*keyList)->itemCount;\
-      for( index = 0; index < itemCount; index++ ) {\
-        freeDataFunc( &((*keyList)->item[index].data) );\
-      }\
-      \
-      free( (*keyList) );\
-      (*keyList) = NULL;\
+    if( !(mappedList && mappedList->item &&\
+        KeyArray##keyKind##ValidKey(key) && destData) ) {\
+      return 0;\
+    }\
+    \
+    searchIndex = keyBound(mappedList, 0, key, 0);\
+    if( (searchIndex < mappedList->itemCount) &&\
+        (compareKeys(keyAt(mappedList, searchIndex), key) == 0) ) {\
+      memcpy( destData, &(mappedList->item[searchIndex].data),\
+          sizeof(dataType) );\
+      return 1;\
     }\
+    \
+    return 0;\
   }
 
-  #define DECLARE_UINT_KEYARRAY_INSERT( funcName, listType, dataType )\
-  int funcName( listType* keyList,\
-      unsigned key, dataType* data ) {\
-    unsigned leftIndex;\
-    unsigned insertIndex;\
-    unsigned rightIndex;\
-    unsigned prevCount;\
-    unsigned reservedCount;\
-    unsigned itemCount;\
-    listType##Item* item;\
+  #define KEYARRAY_DECLARE_RANGE_MAPPED( funcName, listType, keyType,\
+      keyKind, keyBound )\
+  size_t funcName( listType##Mapped* mappedList, keyType firstKey,\
+      keyType lastKey, size_t* beginIndex ) {\
+    if( !(mappedList && beginIndex) ) {\
+      return 0;\
+    }\
     \
-    if( !(keyList && data) ) {\
+    (*beginIndex) = 0;\
+    if( !(mappedList->item && KeyArray##keyKind##ValidBound(firstKey) &&\
+        KeyArray##keyKind##ValidBound(lastKey)) ) {\
       return 0;\
     }\
     \
-    /* Grow list, if necessary */\
-    reservedCount = keyList->reservedCount;\
-    itemCount = keyList->itemCount;\
-    item = keyList->item;\
+    (*beginIndex) = keyBound(mappedList, 0, firstKey, 0);\
     \
-    if( itemCount == reservedCount ) {\
-      prevCount = reservedCount;\
-      reservedCount += 8;\
-      if( prevCount > reservedCount ) {\
-        return 0;\
-      }\
-      \
-      item = (listType##Item*)realloc(item, reservedCount * sizeof(listType##Item));\
-      if( item == NULL ) {\
-        return 0;\
-      }\
-      keyList->reservedCount = reservedCount;\
-      keyList->item = item;\
+    /* The last key can only be at, or after, the first key */\
+    return keyBound(mappedList, (*beginIndex), lastKey, 1) -\
+      (*beginIndex);\
+  }
+
+  #define DECLARE_STRING_KEYARRAY_RETRIEVE_MAPPED( funcName, listType,\
+      dataType )\
+  KEYARRAY_DECLARE_RETRIEVE_MAPPED( funcName, listType, const char*,\
+      dataType, String, KEYARRAY_MAPPED_STRING_BOUND,\
+      KEYARRAY_MAPPED_STRING_KEYAT, KEYARRAY_COMPARE_STRING )
+
+  #define DECLARE_UINT_KEYARRAY_RETRIEVE_MAPPED( funcName, listType,\
+      dataType )\
+  KEYARRAY_DECLARE_RETRIEVE_MAPPED( funcName, listType, unsigned,\
+      dataType, Uint, KEYARRAY_MAPPED_UINT_BOUND,\
+      KEYARRAY_MAPPED_UINT_KEYAT, KEYARRAY_COMPARE_UINT )
+
+  #define DECLARE_STRING_KEYARRAY_FINDINDEX_SIZE_MAPPED( funcName, listType )\
+  KEYARRAY_DECLARE_FINDINDEX_MAPPED( funcName, listType, const char*,\
+      String, KEYARRAY_MAPPED_STRING_BOUND, KEYARRAY_MAPPED_STRING_KEYAT,\
+      KEYARRAY_COMPARE_STRING )
+
+  #define DECLARE_STRING_KEYARRAY_FINDINDEX_MAPPED( funcName, listType )\
+  KEYARRAY_DECLARE_FINDINDEX_INT( funcName, listType, listType##Mapped,\
+      const char*, DECLARE_STRING_KEYARRAY_FINDINDEX_SIZE_MAPPED )
+
+  #define DECLARE_UINT_KEYARRAY_FINDINDEX_SIZE_MAPPED( funcName, listType )\
+  KEYARRAY_DECLARE_FINDINDEX_MAPPED( funcName, listType, unsigned,\
+      Uint, KEYARRAY_MAPPED_UINT_BOUND, KEYARRAY_MAPPED_UINT_KEYAT,\
+      KEYARRAY_COMPARE_UINT )
+
+  #define DECLARE_UINT_KEYARRAY_FINDINDEX_MAPPED( funcName, listType )\
+  KEYARRAY_DECLARE_FINDINDEX_INT( funcName, listType, listType##Mapped,\
+      unsigned, DECLARE_UINT_KEYARRAY_FINDINDEX_SIZE_MAPPED )
+
+  #define DECLARE_STRING_KEYARRAY_RANGE_MAPPED( funcName, listType )\
+  KEYARRAY_DECLARE_RANGE_MAPPED( funcName, listType, const char*,\
+      String, KEYARRAY_MAPPED_STRING_BOUND )
+
+  #define DECLARE_UINT_KEYARRAY_RANGE_MAPPED( funcName, listType )\
+  KEYARRAY_DECLARE_RANGE_MAPPED( funcName, listType, unsigned,\
+      Uint, KEYARRAY_MAPPED_UINT_BOUND )
+
+  #endif
+
+/*
+ * ========================================
+ *  Key Array implementation, logged lists
+ * ========================================
+ */
+
+  /* Logged lists sync with POSIX fsync, so they are only declared when
+     KEYARRAY_LOGGED is defined before including keyarray.h */
+  #if defined(KEYARRAY_LOGGED)
+
+  #include <stdio.h>
+  #include <unistd.h>
+
+  #define KEYARRAY_LOG_VERSION 1
+  #define KEYARRAY_LOG_BYTEORDER 0x01020304U
+  #define KEYARRAY_LOG_STRING 1
+  #define KEYARRAY_LOG_UINT 2
+
+  /* Sync policy, for each group commit */
+  #define KEYARRAY_LOG_SYNC_NONE 0
+  #define KEYARRAY_LOG_SYNC_COMMIT 1
+
+  /* Record operations */
+  #define KEYARRAY_LOG_INSERT 1
+  #define KEYARRAY_LOG_REMOVE 2
+  #define KEYARRAY_LOG_MODIFY 3
+
+  #ifndef KEYARRAY_LOG_BUFFER_SIZE
+    #define KEYARRAY_LOG_BUFFER_SIZE 65536
+  #endif
+
+  typedef struct KeyArrayLogHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t byteOrder;
+    uint32_t keyKind;
+    uint32_t dataSize;
+  } KeyArrayLogHeader;
+
+  /* Each record is followed by keySize key bytes, then dataSize data
+     bytes. checksum covers the rest of the record, so a record torn by
+     a crash is found, and ends replay. */
+  typedef struct KeyArrayLogRecord {
+    uint32_t checksum;
+    uint32_t operation;
+    uint32_t keySize;
+    uint32_t dataSize;
+  } KeyArrayLogRecord;
+
+  typedef struct KeyArrayLog {
+    FILE* file;
+    int syncPolicy;
+    int failed;
+    size_t groupCount;
+    size_t pendingCount;
+  } KeyArrayLog;
+
+  /* FNV-1a, continued from keyHash */
+  static inline uint32_t KeyArrayLogHash( uint32_t keyHash,
+      const void* source, size_t size ) {
+    const unsigned char* byte = (const unsigned char*)source;
+
+    while( size ) {
+      keyHash ^= (*byte);
+      keyHash *= 16777619U;
+      byte++;
+      size--;
+    }
+
+    return keyHash;
+  }
+
+  static inline uint32_t KeyArrayLogChecksum(
+      const KeyArrayLogRecord* record, const void* key,
+      const void* data ) {
+    uint32_t checksum = 2166136261U;
+
+    checksum = KeyArrayLogHash(checksum, &(record->operation),
+        sizeof(KeyArrayLogRecord) - sizeof(uint32_t));
+    checksum = KeyArrayLogHash(checksum, key, record->keySize);
+    return KeyArrayLogHash(checksum, data, record->dataSize);
+  }
+
+  static inline void KeyArraySetLogHeader( KeyArrayLogHeader* header,
+      uint32_t keyKind, size_t dataSize ) {
+    memset( header, 0, sizeof(KeyArrayLogHeader) );
+    memcpy( header->magic, "KEYALOG1", 8 );
+    header->version = KEYARRAY_LOG_VERSION;
+    header->byteOrder = KEYARRAY_LOG_BYTEORDER;
+    header->keyKind = keyKind;
+    header->dataSize = (uint32_t)dataSize;
+  }
+
+  /* Opens fileName for appending, and writes its header if it is new.
+     An existing log must have been written for the same list type. */
+  static inline KeyArrayLog* KeyArrayLogOpen( const char* fileName,
+      uint32_t keyKind, size_t dataSize, int syncPolicy,
+      size_t groupCount ) {
+    KeyArrayLog* log = NULL;
+    KeyArrayLogHeader header;
+    KeyArrayLogHeader fileHeader;
+    long fileSize;
+
+    if( fileName == NULL ) {
+      return NULL;
+    }
+
+    log = (KeyArrayLog*)calloc(1, sizeof(KeyArrayLog));
+    if( log == NULL ) {
+      return NULL;
+    }
+
+    log->file = fopen(fileName, "a+b");
+    if( log->file == NULL ) {
+      goto ReturnError;
+    }
+    setvbuf( log->file, NULL, _IOFBF, KEYARRAY_LOG_BUFFER_SIZE );
+
+    KeyArraySetLogHeader( &header, keyKind, dataSize );
+    if( (fseek(log->file, 0, SEEK_END) != 0) ||
+        ((fileSize = ftell(log->file)) < 0) ) {
+      goto ReturnError;
+    }
+
+    if( fileSize == 0 ) {
+      if( (fwrite(&header, sizeof(KeyArrayLogHeader), 1, log->file) != 1) ||
+          (fflush(log->file) != 0) ) {
+        goto ReturnError;
+      }
+    } else {
+      if( (fseek(log->file, 0, SEEK_SET) != 0) ||
+          (fread(&fileHeader, sizeof(KeyArrayLogHeader), 1,
+          log->file) != 1) ||
+          (memcmp(&fileHeader, &header, sizeof(KeyArrayLogHeader)) != 0) ||
+          (fseek(log->file, 0, SEEK_END) != 0) ) {
+        goto ReturnError;
+      }
+    }
+
+    log->syncPolicy = syncPolicy;
+    log->groupCount = groupCount;
+
+    return log;
+
+  ReturnError:
+    if( log->file ) {
+      fclose( log->file );
+    }
+    free( log );
+
+    return NULL;
+  }
+
+  /* Writes the records appended since the last commit to the file, and
+     syncs it, according to the sync policy */
+  static inline int KeyArrayLogCommit( KeyArrayLog* log ) {
+    if( log == NULL ) {
+      return 0;
+    }
+
+    if( log->failed ) {
+      return 0;
+    }
+
+    if( (fflush(log->file) != 0) ||
+        ((log->syncPolicy == KEYARRAY_LOG_SYNC_COMMIT) &&
+        (fsync(fileno(log->file)) != 0)) ) {
+      log->failed = 1;
+      return 0;
+    }
+
+    log->pendingCount = 0;
+    return 1;
+  }
+
+  static inline int KeyArrayLogClose( KeyArrayLog** log ) {
+    int result;
+
+    if( !(log && (*log)) ) {
+      return 0;
+    }
+
+    result = KeyArrayLogCommit(*log);
+    if( fclose((*log)->file) != 0 ) {
+      result = 0;
+    }
+    free( (*log) );
+    (*log) = NULL;
+
+    return result;
+  }
+
+  /* Empties the log after a snapshot is saved: pending records are
+     committed, then the file is cut back to its header. The cut is
+     synced, according to the sync policy, so that old records are not
+     replayed after the log has been appended to again. */
+  static inline int KeyArrayLogCheckpoint( KeyArrayLog* log ) {
+    if( KeyArrayLogCommit(log) == 0 ) {
+      return 0;
+    }
+
+    if( (ftruncate(fileno(log->file),
+        (off_t)sizeof(KeyArrayLogHeader)) != 0) ||
+        (fseek(log->file, 0, SEEK_END) != 0) ||
+        ((log->syncPolicy == KEYARRAY_LOG_SYNC_COMMIT) &&
+        (fsync(fileno(log->file)) != 0)) ) {
+      log->failed = 1;
+      return 0;
+    }
+
+    return 1;
+  }
+
+  /* Appends one record, then commits the group once it is full. A log
+     that failed appends nothing more, as it no longer matches the
+     list. */
+  static inline int KeyArrayLogAppend( KeyArrayLog* log,
+      uint32_t operation, const void* key, size_t keySize,
+      const void* data, size_t dataSize ) {
+    KeyArrayLogRecord record;
+
+    if( log->failed ) {
+      return 0;
+    }
+
+    record.operation = operation;
+    record.keySize = (uint32_t)keySize;
+    record.dataSize = (uint32_t)dataSize;
+    record.checksum = KeyArrayLogChecksum(&record, key, data);
+
+    if( (fwrite(&record, sizeof(KeyArrayLogRecord), 1, log->file) != 1) ||
+        (fwrite(key, keySize, 1, log->file) != 1) ||
+        (dataSize && (fwrite(data, dataSize, 1, log->file) != 1)) ) {
+      log->failed = 1;
+      return 0;
+    }
+
+    log->pendingCount++;
+    if( log->groupCount && (log->pendingCount >= log->groupCount) ) {
+      return KeyArrayLogCommit(log);
+    }
+
+    return 1;
+  }
+
+  /* Record keys, by key kind. Keys are passed by address, so string
+     and uint keys are both found at the returned address. */
+  static inline const void* KeyArrayStringLogKey( char* const* key ) {
+    return (*key);
+  }
+
+  static inline const void* KeyArrayUintLogKey( const unsigned* key ) {
+    return key;
+  }
+
+  static inline size_t KeyArrayStringLogKeySize( const char* key ) {
+    return strlen(key);
+  }
+
+  static inline size_t KeyArrayUintLogKeySize( unsigned key ) {
+    (void)key;
+    return sizeof(unsigned);
+  }
+
+  static inline int KeyArrayStringLogReadKey( FILE* file,
+      uint32_t keySize, char** key ) {
+    (*key) = NULL;
+    if( (keySize == 0) || (keySize == (uint32_t)-1) ) {
+      return 0;
+    }
+
+    (*key) = (char*)malloc((size_t)keySize + 1);
+    if( (*key) == NULL ) {
+      return 0;
+    }
+
+    if( (fread((*key), keySize, 1, file) != 1) ||
+        (memchr((*key), '\0', keySize) != NULL) ) {
+      free( (*key) );
+      (*key) = NULL;
+      return 0;
+    }
+    (*key)[keySize] = '\0';
+
+    return 1;
+  }
+
+  static inline int KeyArrayUintLogReadKey( FILE* file,
+      uint32_t keySize, unsigned* key ) {
+    return (keySize == sizeof(unsigned)) &&
+      (fread(key, sizeof(unsigned), 1, file) == 1);
+  }
+
+  /* Merged log data replaces list data */
+  #define KEYARRAY_LOG_REPLACE_DATA( existing, incoming )\
+    memcpy( (existing), (incoming), sizeof(*(existing)) )
+
+  #define KEYARRAY_LOG_KEEP_DATA( data ) ((void)(data))
+
+  #define KEYARRAY_DECLARE_LOGOPEN( funcName, dataType, fileKind )\
+  KeyArrayLog* funcName( const char* fileName, int syncPolicy,\
+      size_t groupCount ) {\
+    return KeyArrayLogOpen(fileName, fileKind, sizeof(dataType),\
+        syncPolicy, groupCount);\
+  }
+
+  /* Logged changes keep the list and the log in step. A remove or
+     modify is appended before the list is changed, once the key is
+     known to be present. An insert can fail for lack of memory, so it
+     is made first, and taken back out if its record cannot be
+     appended. */
+  #define KEYARRAY_DECLARE_INSERT_LOGGED( funcName, listType, keyType,\
+      dataType, keyKind, declareInsert, declareRemove )\
+  static declareInsert( funcName##List, listType, dataType )\
+  static declareRemove( funcName##Undo, listType, KEYARRAY_LOG_KEEP_DATA )\
+  \
+  int funcName( listType* keyList, KeyArrayLog* log, keyType key,\
+      dataType* data ) {\
+    if( log && log->failed ) {\
+      return 0;\
     }\
     \
-    /* Search for insert position */\
-    leftIndex = 0;\
-    rightIndex = itemCount;\
-    insertIndex = itemCount / 2;\
-    \
-    while( leftIndex < rightIndex ) {\
-      if( item[insertIndex].key == key ) {\
-        return 0;\
-      }\
-      \
-      if( item[insertIndex].key > key ) {\
-        rightIndex = insertIndex;\
-      } else {\
-        leftIndex = insertIndex + 1;\
-      }\
-      \
-      insertIndex = (leftIndex + rightIndex) / 2;\
+    if( funcName##List(keyList, key, data) == 0 ) {\
+      return 0;\
     }\
     \
-    /* Move data past insertion point up, if necessary */\
-    memmove( &(item[insertIndex + 1]), &(item[insertIndex]),\
-        (itemCount - insertIndex) * sizeof(listType##Item) );\
-    \
-    /* Insert item */\
-    item[insertIndex].key = key;\
-    if( data ) {\
-      memcpy( &(item[insertIndex].data), data, sizeof(dataType) );\
+    if( log && (KeyArrayLogAppend(log, KEYARRAY_LOG_INSERT,\
+        KeyArray##keyKind##LogKey(&key),\
+        KeyArray##keyKind##LogKeySize(key), data,\
+        sizeof(dataType)) == 0) ) {\
+      funcName##Undo( keyList, key );\
+      return 0;\
     }\
     \
-    keyList->itemCount++;\
-    \
     return 1;\
   }
 
-  #define DECLARE_UINT_KEYARRAY_REMOVE( funcName, listType, freeDataFunc )\
-  void funcName( listType* keyList, unsigned key ) {\
-    unsigned leftIndex;\
-    unsigned rightIndex;\
-    unsigned removeIndex;\
-    unsigned reservedCount;\
-    unsigned itemCount;\
-    listType##Item* item;\
-    \
-    if( !(keyList && keyList->item) ) {\
-      return;\
+  #define KEYARRAY_DECLARE_REMOVE_LOGGED( funcName, listType, keyType,\
+      keyKind, declareFindIndex, declareRemove, freeDataFunc )\
+  static declareFindIndex( funcName##Find, listType )\
+  static declareRemove( funcName##List, listType, freeDataFunc )\
+  \
+  int funcName( listType* keyList, KeyArrayLog* log, keyType key ) {\
+    /* Only keys that are present are logged, and removed */\
+    if( funcName##Find(keyList, key) == ((size_t)-1) ) {\
+      return 0;\
     }\
     \
-    reservedCount = keyList->reservedCount;\
-    itemCount = keyList->itemCount;\
-    item = keyList->item;\
+    if( log && (KeyArrayLogAppend(log, KEYARRAY_LOG_REMOVE,\
+        KeyArray##keyKind##LogKey(&key),\
+        KeyArray##keyKind##LogKeySize(key), NULL, 0) == 0) ) {\
+      return 0;\
+    }\
     \
-    /* Search for insert position */\
-    leftIndex = 0;\
-    rightIndex = itemCount;\
-    removeIndex = itemCount / 2;\
+    funcName##List( keyList, key );\
     \
-    while( leftIndex < rightIndex ) {\
-      if( item[removeIndex].key == key ) {\
-        freeDataFunc( &(item[removeIndex].data) );\
-        \
-        if( itemCount ) {\
-          itemCount--;\
-          \
-          memcpy( &(item[removeIndex]), &(item[removeIndex + 1]),\
-            (itemCount - removeIndex) * sizeof(listType##Item) );\
-          \
-          keyList->itemCount = itemCount;\
-        }\
-        \
-        memset( &(item[itemCount]), 0, sizeof(listType##Item) );\
-        \
-        return;\
-      }\
-      \
-      if( item[removeIndex].key > key ) {\
-        rightIndex = removeIndex;\
-      } else {\
-        leftIndex = removeIndex + 1;\
-      }\
-      \
-      removeIndex = (leftIndex + rightIndex) / 2;\
-    }\
+    return 1;\
   }
 
-  #define DECLARE_UINT_KEYARRAY_RETRIEVE( funcName, listType, dataType )\
-  int funcName( listType* keyList, unsigned key,\
-      dataType* destData ) {\
-    unsigned leftIndex;\
-    unsigned rightIndex;\
-    unsigned retrieveIndex;\
-    unsigned reservedCount;\
-    unsigned itemCount;\
-    listType##Item* item;\
-    \
-    if( !(keyList && keyList->item && destData) ) {\
+  #define KEYARRAY_DECLARE_MODIFY_LOGGED( funcName, listType, keyType,\
+      dataType, keyKind, declareFindIndex, declareModify )\
+  static declareFindIndex( funcName##Find, listType )\
+  static declareModify( funcName##List, listType, dataType )\
+  \
+  int funcName( listType* keyList, KeyArrayLog* log, keyType key,\
+      dataType* data ) {\
+    if( (data == NULL) ||\
+        (funcName##Find(keyList, key) == ((size_t)-1)) ) {\
       return 0;\
     }\
     \
-    reservedCount = keyList->reservedCount;\
-    itemCount = keyList->itemCount;\
-    item = keyList->item;\
-    \
-    /* Search for insert position */\
-    leftIndex = 0;\
-    rightIndex = itemCount;\
-    retrieveIndex = itemCount / 2;\
-    \
-    while( leftIndex < rightIndex ) {\
-      if( item[retrieveIndex].key == key ) {\
-        memcpy( destData, &(item[retrieveIndex].data), sizeof(dataType) );\
-        return 1;\
-      }\
-      \
-      if( item[retrieveIndex].key > key ) {\
-        rightIndex = retrieveIndex;\
-      } else {\
-        leftIndex = retrieveIndex + 1;\
-      }\
-      \
-      retrieveIndex = (leftIndex + rightIndex) / 2;\
+    if( log && (KeyArrayLogAppend(log, KEYARRAY_LOG_MODIFY,\
+        KeyArray##keyKind##LogKey(&key),\
+        KeyArray##keyKind##LogKeySize(key), data,\
+        sizeof(dataType)) == 0) ) {\
+      return 0;\
     }\
     \
-    return 0;\
+    return funcName##List(keyList, key, data);\
   }
 
-  #define DECLARE_UINT_KEYARRAY_MODIFY( funcName, listType, dataType )\
-  int funcName( listType* keyList, unsigned key,\
-      dataType* sourceData ) {\
-    unsigned leftIndex;\
-    unsigned rightIndex;\
-    unsigned modifyIndex;\
-    unsigned reservedCount;\
-    unsigned itemCount;\
-    listType##Item* item;\
+  /* Declares funcName, to apply a log to a list loaded from the last
+     snapshot. Records are read in log order, then sorted by key, and
+     the records of each key are reduced to their net effect. Keys that
+     end up in the list are merged in one batch; keys that end up out
+     of it are removed. */
+  #define KEYARRAY_DECLARE_REPLAY( funcName, listType, keyType, dataType,\
+      keyKind, fileKind, compareKeys, declareRetrieve, declareMerge,\
+      declareRemove, freeDataFunc )\
+  typedef struct funcName##Entry {\
+    keyType key;\
+    uint32_t operation;\
+    dataType data;\
+  } funcName##Entry;\
+  \
+  KEYARRAY_DECLARE_SORT( funcName##Sort, funcName##Entry, compareKeys )\
+  static declareRetrieve( funcName##Retrieve, listType, dataType )\
+  declareMerge( funcName##Merge, listType, dataType,\
+      KEYARRAY_LOG_REPLACE_DATA, KEYARRAY_LOG_KEEP_DATA )\
+  static declareRemove( funcName##Remove, listType, freeDataFunc )\
+  \
+  int funcName( listType* keyList, const char* fileName ) {\
+    KeyArrayLogHeader header;\
+    KeyArrayLogHeader fileHeader;\
+    KeyArrayLogRecord record;\
+    FILE* file = NULL;\
+    funcName##Entry* entry = NULL;\
+    funcName##Entry* newEntry;\
+    listType##Item* batch = NULL;\
+    keyType* removeKey = NULL;\
+    dataType listData;\
+    size_t reservedCount = 0;\
+    size_t entryCount = 0;\
+    size_t batchCount = 0;\
+    size_t removeCount = 0;\
+    size_t index;\
+    size_t groupIndex;\
+    long validSize;\
+    long fileSize;\
+    int wasPresent;\
+    int present;\
+    int changed;\
+    int result = 0;\
     \
-    if( !(keyList && keyList->item && sourceData) ) {\
+    if( !(keyList && fileName) ) {\
       return 0;\
     }\
     \
-    reservedCount = keyList->reservedCount;\
-    itemCount = keyList->itemCount;\
-    item = keyList->item;\
+    /* No log, or an empty one, leaves nothing to replay */\
+    file = fopen(fileName, "rb");\
+    if( file == NULL ) {\
+      return 1;\
+    }\
     \
-    /* Search for insert position */\
-    leftIndex = 0;\
-    rightIndex = itemCount;\
-    modifyIndex = itemCount / 2;\
+    /* A header torn by a crash is dropped, leaving an empty log */\
+    validSize = 0;\
+    KeyArraySetLogHeader( &header, fileKind, sizeof(dataType) );\
+    if( fread(&fileHeader, sizeof(KeyArrayLogHeader), 1, file) != 1 ) {\
+      goto TruncateLog;\
+    }\
+    if( memcmp(&fileHeader, &header, sizeof(KeyArrayLogHeader)) != 0 ) {\
+      goto ReturnError;\
+    }\
+    validSize = (long)sizeof(KeyArrayLogHeader);\
     \
-    while( leftIndex < rightIndex ) {\
-      if( item[modifyIndex].key == key ) {\
-        memcpy( &(item[modifyIndex].data), sourceData, sizeof(dataType) );\
-        return 1;\
+    /* Read records, up to the end, or the first torn record */\
+    for( ;; ) {\
+      if( entryCount == reservedCount ) {\
+        reservedCount = reservedCount ? (reservedCount * 2) : 256;\
+        if( reservedCount > (((size_t)-1) / sizeof(funcName##Entry)) ) {\
+          goto ReturnError;\
+        }\
+        newEntry = (funcName##Entry*)realloc(entry,\
+            reservedCount * sizeof(funcName##Entry));\
+        if( newEntry == NULL ) {\
+          goto ReturnError;\
+        }\
+        entry = newEntry;\
       }\
       \
-      if( item[modifyIndex].key > key ) {\
-        rightIndex = modifyIndex;\
-      } else {\
-        leftIndex = modifyIndex + 1;\
+      if( (fread(&record, sizeof(KeyArrayLogRecord), 1, file) != 1) ||\
+          (record.operation < KEYARRAY_LOG_INSERT) ||\
+          (record.operation > KEYARRAY_LOG_MODIFY) ||\
+          (record.dataSize != ((record.operation == KEYARRAY_LOG_REMOVE) ?\
+          0 : sizeof(dataType))) ) {\
+        break;\
       }\
       \
-      modifyIndex = (leftIndex + rightIndex) / 2;\
-    }\
-    \
-    return 0;\
-  }
-
-  #define DECLARE_UINT_KEYARRAY_FINDINDEX( funcName, listType )\
-  int funcName( listType* keyList, unsigned key ) {\
-    unsigned leftIndex;\
-    unsigned rightIndex;\
-    unsigned searchIndex;\
-    unsigned reservedCount;\
-    unsigned itemCount;\
-    listType##Item* item;\
-    \
-    if( !(keyList && keyList->item) ) {\
-      return (-1);\
-    }\
-    \
-    reservedCount = keyList->reservedCount;\
-    itemCount = keyList->itemCount;\
-    item = keyList->item;\
-    \
-    /* Search for insert position */\
-    leftIndex = 0;\
-    rightIndex = itemCount;\
-    searchIndex = itemCount / 2;\
-    \
-    while( leftIndex < rightIndex ) {\
-      if( item[searchIndex].key == key ) {\
-        return searchIndex;\
+      memset( &(entry[entryCount]), 0, sizeof(funcName##Entry) );\
+      if( KeyArray##keyKind##LogReadKey(file, record.keySize,\
+          &(entry[entryCount].key)) == 0 ) {\
+        break;\
       }\
       \
-      if( item[searchIndex].key > key ) {\
-        rightIndex = searchIndex;\
-      } else {\
-        leftIndex = searchIndex + 1;\
+      if( (record.dataSize && (fread(&(entry[entryCount].data),\
+          sizeof(dataType), 1, file) != 1)) ||\
+          (KeyArrayLogChecksum(&record,\
+          KeyArray##keyKind##LogKey(&(entry[entryCount].key)),\
+          &(entry[entryCount].data)) != record.checksum) ) {\
+        KeyArray##keyKind##FreeKey( entry[entryCount].key );\
+        break;\
       }\
       \
-      searchIndex = (leftIndex + rightIndex) / 2;\
+      entry[entryCount].operation = record.operation;\
+      entryCount++;\
+      validSize = ftell(file);\
     }\
     \
-    return (-1);\
-  }
-
-  #define DECLARE_UINT_KEYARRAY_RELEASEUNUSED( funcName, listType )\
-  void funcName( listType* keyList ) {\
-    listType##Item* item;\
-    \
-    if( keyList == NULL ) {\
-      return;\
+    /* Cut off a torn record, so later appends follow the last good one */\
+  TruncateLog:\
+    if( (fseek(file, 0, SEEK_END) != 0) ||\
+        ((fileSize = ftell(file)) < 0) ) {\
+      goto ReturnError;\
     }\
-    \
-    if( keyList->item && keyList->itemCount ) {\
-      /* Resize to remove reserved space */\
-      item = realloc(keyList->item,\
-        keyList->itemCount * sizeof(listType##Item));\
-      if( item ) {\
-        keyList->item = item;\
-        keyList->reservedCount = keyList->itemCount;\
-      }\
-    } else {\
-      /* Deallocate */\
-      keyList->reservedCount = 0;\
-      keyList->itemCount = 0;\
-      if( keyList->item ) {\
-        free( keyList->item );\
-        keyList->item = NULL;\
-      }\
+    fclose( file );\
+    file = NULL;\
+    if( (validSize < fileSize) && (truncate(fileName, validSize) != 0) ) {\
+      goto ReturnError;\
     }\
-  }
-
-  #define DECLARE_UINT_KEYARRAY_COPY( funcName, listType, dataType,\
-      copyDataFunc, freeDataFunc )\
-  listType* funcName( listType* sourceList ) {\
-    listType* newCopy = NULL;\
-    listType##Item* sourceItem = NULL;\
-    size_t reservedCount = 0;\
-    size_t itemCount = 0;\
-    size_t index;\
     \
-    if( sourceList == NULL ) {\
-      return NULL;\
+    if( entryCount == 0 ) {\
+      result = 1;\
+      goto ReturnError;\
     }\
     \
-    /* Attempt to allocate list object */\
-    newCopy = calloc(1, sizeof(listType));\
-    if( newCopy == NULL ) {\
+    /* Sorting is stable, so each key's records stay in log order */\
+    newEntry = (funcName##Entry*)malloc(entryCount *\
+        sizeof(funcName##Entry));\
+    batch = (listType##Item*)malloc(entryCount * sizeof(listType##Item));\
+    removeKey = (keyType*)malloc(entryCount * sizeof(keyType));\
+    if( !(newEntry && batch && removeKey) ) {\
+      free( newEntry );\
       goto ReturnError;\
     }\
+    funcName##Sort( entry, newEntry, entryCount );\
+    free( newEntry );\
     \
-    /* Initialize important variables */\
-    reservedCount = sourceList->reservedCount;\
-    itemCount = sourceList->itemCount;\
-    sourceItem = sourceList->item;\
-    \
-    /* A list with no items is valid */\
-    if( !(reservedCount && itemCount && sourceItem) ) {\
-      return newCopy;\
+    for( index = 0; index < entryCount; index = groupIndex ) {\
+      wasPresent = funcName##Retrieve(keyList, entry[index].key,\
+          &listData);\
+      present = wasPresent;\
+      changed = 0;\
+      \
+      for( groupIndex = index; (groupIndex < entryCount) &&\
+          (compareKeys(entry[groupIndex].key, entry[index].key) == 0);\
+          groupIndex++ ) {\
+        switch( entry[groupIndex].operation ) {\
+        case KEYARRAY_LOG_INSERT:\
+          if( present == 0 ) {\
+            listData = entry[groupIndex].data;\
+            present = 1;\
+            changed = 1;\
+          }\
+          break;\
+        \
+        case KEYARRAY_LOG_MODIFY:\
+          if( present ) {\
+            listData = entry[groupIndex].data;\
+            changed = 1;\
+          }\
+          break;\
+        \
+        default:\
+          present = 0;\
+          break;\
+        }\
+      }\
+      \
+      if( present && changed ) {\
+        batch[batchCount].key = entry[index].key;\
+        batch[batchCount].data = listData;\
+        batchCount++;\
+      } else if( wasPresent && (present == 0) ) {\
+        removeKey[removeCount] = entry[index].key;\
+        removeCount++;\
+      }\
     }\
     \
-    /* Copy data, then copy the Uint keys */\
-    newCopy->item = malloc(reservedCount * sizeof(listType##Item));\
-    if( newCopy->item == NULL ) {\
+    if( batchCount && (funcName##Merge(keyList, batch, batchCount) == 0) ) {\
       goto ReturnError;\
     }\
     \
-    for( index = 0; index < itemCount; index++ ) {\
-     /* Direct copy by default, allowing copy function to be empty */\
-      newCopy->item[index].data = sourceItem[index].data;\
-      if( copyDataFunc(&(newCopy->item[index].data),\
-          &(sourceItem[index].data)) == 0 ) {\
-        goto ReturnError;\
-      }\
-      \
-      newCopy->item[index].key = sourceItem[index].key;\
+    for( index = 0; index < removeCount; index++ ) {\
+      funcName##Remove( keyList, removeKey[index] );\
     }\
     \
-    newCopy->reservedCount = reservedCount;\
-    newCopy->itemCount = itemCount;\
-    \
-    return newCopy;\
+    result = 1;\
     \
   ReturnError:\
-    if( newCopy == NULL ) {\
-      return NULL;\
+    if( file ) {\
+      fclose( file );\
+      file = NULL;\
     }\
     \
-    if( newCopy->item ) {\
-      for( index = 0; index < itemCount; index++ ) {\
-        freeDataFunc( &(newCopy->item[index].data) );\
+    if( entry ) {\
+      for( index = 0; index < entryCount; index++ ) {\
+        KeyArray##keyKind##FreeKey( entry[index].key );\
       }\
+      free( entry );\
     }\
     \
-    free( newCopy );\
-    newCopy = NULL;\
+    free( batch );\
+    free( removeKey );\
     \
-    return NULL;\
+    return result;\
   }
 
+  #define DECLARE_STRING_KEYARRAY_LOGOPEN( funcName, listType, dataType )\
+  KEYARRAY_DECLARE_LOGOPEN( funcName, dataType, KEYARRAY_LOG_STRING )
+
+  #define DECLARE_UINT_KEYARRAY_LOGOPEN( funcName, listType, dataType )\
+  KEYARRAY_DECLARE_LOGOPEN( funcName, dataType, KEYARRAY_LOG_UINT )
+
+  #define DECLARE_STRING_KEYARRAY_INSERT_LOGGED( funcName, listType,\
+      dataType )\
+  KEYARRAY_DECLARE_INSERT_LOGGED( funcName, listType, char*, dataType,\
+      String, DECLARE_STRING_KEYARRAY_INSERT,\
+      DECLARE_STRING_KEYARRAY_REMOVE )
+
+  #define DECLARE_UINT_KEYARRAY_INSERT_LOGGED( funcName, listType,\
+      dataType )\
+  KEYARRAY_ASSERT_UINT_KEY( funcName, listType )\
+  KEYARRAY_DECLARE_INSERT_LOGGED( funcName, listType, unsigned, dataType,\
+      Uint, DECLARE_UINT_KEYARRAY_INSERT, DECLARE_UINT_KEYARRAY_REMOVE )
+
+  #define DECLARE_STRING_KEYARRAY_REMOVE_LOGGED( funcName, listType,\
+      freeDataFunc )\
+  KEYARRAY_DECLARE_REMOVE_LOGGED( funcName, listType, char*, String,\
+      DECLARE_STRING_KEYARRAY_FINDINDEX_SIZE, DECLARE_STRING_KEYARRAY_REMOVE,\
+      freeDataFunc )
+
+  #define DECLARE_UINT_KEYARRAY_REMOVE_LOGGED( funcName, listType,\
+      freeDataFunc )\
+  KEYARRAY_ASSERT_UINT_KEY( funcName, listType )\
+  KEYARRAY_DECLARE_REMOVE_LOGGED( funcName, listType, unsigned, Uint,\
+      DECLARE_UINT_KEYARRAY_FINDINDEX_SIZE, DECLARE_UINT_KEYARRAY_REMOVE,\
+      freeDataFunc )
+
+  #define DECLARE_STRING_KEYARRAY_MODIFY_LOGGED( funcName, listType,\
+      dataType )\
+  KEYARRAY_DECLARE_MODIFY_LOGGED( funcName, listType, char*, dataType,\
+      String, DECLARE_STRING_KEYARRAY_FINDINDEX_SIZE,\
+      DECLARE_STRING_KEYARRAY_MODIFY )
+
+  #define DECLARE_UINT_KEYARRAY_MODIFY_LOGGED( funcName, listType,\
+      dataType )\
+  KEYARRAY_ASSERT_UINT_KEY( funcName, listType )\
+  KEYARRAY_DECLARE_MODIFY_LOGGED( funcName, listType, unsigned, dataType,\
+      Uint, DECLARE_UINT_KEYARRAY_FINDINDEX_SIZE,\
+      DECLARE_UINT_KEYARRAY_MODIFY )
+
+  #define DECLARE_STRING_KEYARRAY_REPLAY( funcName, listType, dataType,\
+      freeDataFunc )\
+  KEYARRAY_DECLARE_REPLAY( funcName, listType, char*, dataType, String,\
+      KEYARRAY_LOG_STRING, KEYARRAY_COMPARE_STRING,\
+      DECLARE_STRING_KEYARRAY_RETRIEVE, DECLARE_STRING_KEYARRAY_MERGEBATCH,\
+      DECLARE_STRING_KEYARRAY_REMOVE, freeDataFunc )
+
+  #define DECLARE_UINT_KEYARRAY_REPLAY( funcName, listType, dataType,\
+      freeDataFunc )\
+  KEYARRAY_ASSERT_UINT_KEY( funcName, listType )\
+  KEYARRAY_DECLARE_REPLAY( funcName, listType, unsigned, dataType, Uint,\
+      KEYARRAY_LOG_UINT, KEYARRAY_COMPARE_UINT,\
+      DECLARE_UINT_KEYARRAY_RETRIEVE, DECLARE_UINT_KEYARRAY_MERGEBATCH,\
+      DECLARE_UINT_KEYARRAY_REMOVE, freeDataFunc )
+
+  #endif
+
 #endif
@@ -0,0 +1,480 @@
+#include <stdio.h>
+
+/* Small chunks, so that keys fill chunks, and outgrow them, often */
+#define KEYARRAY_KEYARENA_CHUNK_SIZE 256
+
+#include "../keyarray.h"
+#include "model.h"
+
+/*
+ *  File: tests/arenamodel.c
+ *  Status: Complete
+ *
+ *  Key Arena Model Test: random operations checked against a model
+ *
+ *  Runs the same random inserts, removes, modifies, retrieves, and merge
+ *  batches on string lists in the array of structures, structure of
+ *  arrays, and key prefix layouts, and checks every result against a
+ *  table of the keys that should be present. The key arena of each list
+ *  is switched on and off along the way, and unused space is released,
+ *  so that keys move into and out of the arena, and the arena is
+ *  compacted. Keys run from a few bytes to longer than a chunk, and are
+ *  inserted from a scratch buffer that is overwritten after each call,
+ *  so a list that kept the caller's key would fail.
+ *
+ *  Every CHECK_INTERVAL operations, and at the end of each round, each
+ *  list is walked in full, and a copy of it is checked the same way.
+ *
+ *  Build and run with the Makefile in this directory:
+ *    make check
+ *  or pass a seed, to repeat a run with other operations:
+ *    ./arenamodel 12345
+ *
+ *  https://github.com/orlandol/keyarray
+ */
+
+/*
+ * Model declarations
+ */
+
+  #define KEY_LIMIT 1500
+  #define KEY_SIZE 400
+  #define ROUND_COUNT 24
+  #define STEP_COUNT 4000
+  #define CHECK_INTERVAL 250
+  #define BATCH_LIMIT 48
+
+  char keyName[KEY_LIMIT][KEY_SIZE];
+  unsigned char present[KEY_LIMIT];
+  unsigned value[KEY_LIMIT];
+  size_t presentCount = 0;
+
+  /* Scratch copy of a key, passed to the lists in place of keyName */
+  char scratchKey[KEY_SIZE];
+
+  /* Most keys are short. One in eight runs past a chunk. */
+  void MakeKeyNames() {
+    unsigned keyId;
+    size_t length;
+
+    for( keyId = 0; keyId < KEY_LIMIT; keyId++ ) {
+      length = sprintf(keyName[keyId], "arena-%u-", keyId);
+      if( (keyId % 8) == 7 ) {
+        memset( keyName[keyId] + length, 'x', 300 );
+        length += 300;
+      } else {
+        memset( keyName[keyId] + length, 'x', keyId % 40 );
+        length += keyId % 40;
+      }
+      keyName[keyId][length] = 0;
+    }
+  }
+
+  /* Returns the key id of a key name */
+  unsigned KeyIdOf( const char* key ) {
+    return (unsigned)strtoul(key + 6, NULL, 10);
+  }
+
+  /* Copies a key into the scratch buffer */
+  char* ScratchKey( unsigned keyId ) {
+    strcpy( scratchKey, keyName[keyId] );
+    return scratchKey;
+  }
+
+  /* Overwrites the scratch buffer */
+  void SpoilScratchKey() {
+    memset( scratchKey, '#', KEY_SIZE - 1 );
+    scratchKey[KEY_SIZE - 1] = 0;
+  }
+
+  void ClearModel() {
+    memset( present, 0, sizeof(present) );
+    memset( value, 0, sizeof(value) );
+    presentCount = 0;
+  }
+
+/*
+ * List declarations
+ */
+
+  int CopyValue( unsigned* dest, unsigned* source ) {
+    (*dest) = (*source);
+    return 1;
+  }
+
+  void AddValue( unsigned* existing, unsigned* incoming ) {
+    (*existing) += (*incoming);
+  }
+
+  DECLARE_STRING_KEYARRAY_TYPES( AosList, unsigned )
+  DECLARE_STRING_KEYARRAY_CREATE( CreateAos, AosList )
+  DECLARE_STRING_KEYARRAY_FREE( FreeAos, AosList, FreeNothing )
+  DECLARE_STRING_KEYARRAY_INSERT( InsertAos, AosList, unsigned )
+  DECLARE_STRING_KEYARRAY_REMOVE( RemoveAos, AosList, FreeNothing )
+  DECLARE_STRING_KEYARRAY_RETRIEVE( RetrieveAos, AosList, unsigned )
+  DECLARE_STRING_KEYARRAY_MODIFY( ModifyAos, AosList, unsigned )
+  DECLARE_STRING_KEYARRAY_FINDINDEX_SIZE( FindAos, AosList )
+  DECLARE_STRING_KEYARRAY_MERGEBATCH( MergeAos, AosList, unsigned,
+      AddValue, FreeNothing )
+  DECLARE_STRING_KEYARRAY_RELEASEUNUSED( ReleaseAos, AosList )
+  DECLARE_STRING_KEYARRAY_COPY( CopyAos, AosList, unsigned,
+      CopyValue, FreeNothing )
+  DECLARE_STRING_KEYARRAY_KEYARENA( ArenaAos, AosList )
+
+  DECLARE_STRING_KEYARRAY_TYPES_SOA( SoaList, unsigned )
+  DECLARE_STRING_KEYARRAY_CREATE_SOA( CreateSoa, SoaList )
+  DECLARE_STRING_KEYARRAY_FREE_SOA( FreeSoa, SoaList, FreeNothing )
+  DECLARE_STRING_KEYARRAY_INSERT_SOA( InsertSoa, SoaList, unsigned )
+  DECLARE_STRING_KEYARRAY_REMOVE_SOA( RemoveSoa, SoaList, FreeNothing )
+  DECLARE_STRING_KEYARRAY_RETRIEVE_SOA( RetrieveSoa, SoaList, unsigned )
+  DECLARE_STRING_KEYARRAY_MODIFY_SOA( ModifySoa, SoaList, unsigned )
+  DECLARE_STRING_KEYARRAY_FINDINDEX_SIZE_SOA( FindSoa, SoaList )
+  DECLARE_STRING_KEYARRAY_MERGEBATCH_SOA( MergeSoa, SoaList, unsigned,
+      AddValue, FreeNothing )
+  DECLARE_STRING_KEYARRAY_RELEASEUNUSED_SOA( ReleaseSoa, SoaList )
+  DECLARE_STRING_KEYARRAY_COPY_SOA( CopySoa, SoaList, unsigned,
+      CopyValue, FreeNothing )
+  DECLARE_STRING_KEYARRAY_KEYARENA_SOA( ArenaSoa, SoaList )
+
+  DECLARE_STRING_KEYARRAY_TYPES_PREFIX( PrefixList, unsigned )
+  DECLARE_STRING_KEYARRAY_CREATE_PREFIX( CreatePrefix, PrefixList )
+  DECLARE_STRING_KEYARRAY_FREE_PREFIX( FreePrefix, PrefixList, FreeNothing )
+  DECLARE_STRING_KEYARRAY_INSERT_PREFIX( InsertPrefix, PrefixList,
+      unsigned )
+  DECLARE_STRING_KEYARRAY_REMOVE_PREFIX( RemovePrefix, PrefixList,
+      FreeNothing )
+  DECLARE_STRING_KEYARRAY_RETRIEVE_PREFIX( RetrievePrefix, PrefixList,
+      unsigned )
+  DECLARE_STRING_KEYARRAY_MODIFY_PREFIX( ModifyPrefix, PrefixList,
+      unsigned )
+  DECLARE_STRING_KEYARRAY_FINDINDEX_SIZE_PREFIX( FindPrefix, PrefixList )
+  DECLARE_STRING_KEYARRAY_MERGEBATCH_PREFIX( MergePrefix, PrefixList,
+      unsigned, AddValue, FreeNothing )
+  DECLARE_STRING_KEYARRAY_RELEASEUNUSED_PREFIX( ReleasePrefix,
+      PrefixList )
+  DECLARE_STRING_KEYARRAY_COPY_PREFIX( CopyPrefix, PrefixList, unsigned,
+      CopyValue, FreeNothing )
+  DECLARE_STRING_KEYARRAY_KEYARENA_PREFIX( ArenaPrefix, PrefixList )
+
+  AosList* aosList = NULL;
+  SoaList* soaList = NULL;
+  PrefixList* prefixList = NULL;
+
+/*
+ * List checks
+ */
+
+  /* Checks one item, in list order, against the model */
+  int CheckItem( size_t index, char* previousKey, char* key,
+      unsigned data ) {
+    unsigned keyId = KeyIdOf(key);
+
+    CHECK( keyId < KEY_LIMIT );
+    CHECK( strcmp(key, keyName[keyId]) == 0 );
+    CHECK( present[keyId] );
+    CHECK( data == value[keyId] );
+    if( index ) {
+      CHECK( strcmp(previousKey, key) < 0 );
+    }
+    return 1;
+  }
+
+  /* Walks the whole list. Keys are in strictly increasing order, and as
+     many as in the model, so the list holds exactly the model's keys. */
+  int CheckAos( AosList* keyList ) {
+    size_t index;
+
+    CHECK( keyList->itemCount == presentCount );
+    for( index = 0; index < keyList->itemCount; index++ ) {
+      CHECK( CheckItem(index, index ? keyList->item[index - 1].key : NULL,
+          keyList->item[index].key, keyList->item[index].data) );
+      CHECK( FindAos(keyList, keyList->item[index].key) == index );
+    }
+    return 1;
+  }
+
+  int CheckSoa( SoaList* keyList ) {
+    size_t index;
+
+    CHECK( keyList->itemCount == presentCount );
+    for( index = 0; index < keyList->itemCount; index++ ) {
+      CHECK( CheckItem(index, index ? keyList->keys[index - 1] : NULL,
+          keyList->keys[index], keyList->data[index]) );
+      CHECK( FindSoa(keyList, keyList->keys[index]) == index );
+    }
+    return 1;
+  }
+
+  int CheckPrefix( PrefixList* keyList ) {
+    size_t index;
+
+    CHECK( keyList->itemCount == presentCount );
+    for( index = 0; index < keyList->itemCount; index++ ) {
+      CHECK( CheckItem(index, index ? keyList->item[index - 1].key : NULL,
+          keyList->item[index].key, keyList->item[index].data) );
+      CHECK( FindPrefix(keyList, keyList->item[index].key) == index );
+    }
+    return 1;
+  }
+
+  /* Checks each list, and a copy of each list */
+  int CheckLists() {
+    AosList* aosCopy = NULL;
+    SoaList* soaCopy = NULL;
+    PrefixList* prefixCopy = NULL;
+    int result;
+
+    CHECK( CheckAos(aosList) );
+    CHECK( CheckSoa(soaList) );
+    CHECK( CheckPrefix(prefixList) );
+
+    aosCopy = CopyAos(aosList);
+    soaCopy = CopySoa(soaList);
+    prefixCopy = CopyPrefix(prefixList);
+    result = aosCopy && soaCopy && prefixCopy && CheckAos(aosCopy) &&
+        CheckSoa(soaCopy) && CheckPrefix(prefixCopy);
+
+    FreeAos( &aosCopy );
+    FreeSoa( &soaCopy );
+    FreePrefix( &prefixCopy );
+
+    CHECK( result );
+    return 1;
+  }
+
+/*
+ * Operations
+ */
+
+  int TestInsert( unsigned keyId ) {
+    unsigned data = NextRandom(&randomState);
+    int expected = (present[keyId] == 0);
+
+    CHECK( (InsertAos(aosList, ScratchKey(keyId), &data) != 0) ==
+        expected );
+    SpoilScratchKey();
+    CHECK( (InsertSoa(soaList, ScratchKey(keyId), &data) != 0) ==
+        expected );
+    SpoilScratchKey();
+    CHECK( (InsertPrefix(prefixList, ScratchKey(keyId), &data) != 0) ==
+        expected );
+    SpoilScratchKey();
+
+    if( expected ) {
+      present[keyId] = 1;
+      value[keyId] = data;
+      presentCount++;
+    }
+    return 1;
+  }
+
+  int TestRemove( unsigned keyId ) {
+    char* key = keyName[keyId];
+
+    RemoveAos( aosList, key );
+    RemoveSoa( soaList, key );
+    RemovePrefix( prefixList, key );
+
+    if( present[keyId] ) {
+      present[keyId] = 0;
+      presentCount--;
+    }
+    return 1;
+  }
+
+  int TestModify( unsigned keyId ) {
+    char* key = keyName[keyId];
+    unsigned data = NextRandom(&randomState);
+    int expected = present[keyId];
+
+    CHECK( (ModifyAos(aosList, key, &data) != 0) == expected );
+    CHECK( (ModifySoa(soaList, key, &data) != 0) == expected );
+    CHECK( (ModifyPrefix(prefixList, key, &data) != 0) == expected );
+
+    if( expected ) {
+      value[keyId] = data;
+    }
+    return 1;
+  }
+
+  int TestRetrieve( unsigned keyId ) {
+    char* key = keyName[keyId];
+    int expected = present[keyId];
+    unsigned data;
+    size_t index;
+
+    data = ~value[keyId];
+    CHECK( (RetrieveAos(aosList, key, &data) != 0) == expected );
+    CHECK( (expected == 0) || (data == value[keyId]) );
+
+    data = ~value[keyId];
+    CHECK( (RetrieveSoa(soaList, key, &data) != 0) == expected );
+    CHECK( (expected == 0) || (data == value[keyId]) );
+
+    data = ~value[keyId];
+    CHECK( (RetrievePrefix(prefixList, key, &data) != 0) == expected );
+    CHECK( (expected == 0) || (data == value[keyId]) );
+
+    index = FindAos(aosList, key);
+    CHECK( (index == (size_t)-1) == (expected == 0) );
+    CHECK( FindSoa(soaList, key) == index );
+    CHECK( FindPrefix(prefixList, key) == index );
+    return 1;
+  }
+
+  /* Merges a batch of random keys, some repeated, into every list. The
+     batch keys are copies, which are overwritten after the merge. */
+  int TestMergeBatch( unsigned keyRange ) {
+    static char batchKey[BATCH_LIMIT][KEY_SIZE];
+    static AosListItem aosBatch[BATCH_LIMIT];
+    static SoaListItem soaBatch[BATCH_LIMIT];
+    static PrefixListItem prefixBatch[BATCH_LIMIT];
+    size_t batchCount = NextRandom(&randomState) % BATCH_LIMIT;
+    size_t batchIndex;
+    unsigned keyId;
+    unsigned data;
+
+    for( batchIndex = 0; batchIndex < batchCount; batchIndex++ ) {
+      keyId = NextRandom(&randomState) % keyRange;
+      data = NextRandom(&randomState) & 0xFFFF;
+      strcpy( batchKey[batchIndex], keyName[keyId] );
+
+      aosBatch[batchIndex].key = batchKey[batchIndex];
+      aosBatch[batchIndex].data = data;
+      soaBatch[batchIndex].key = batchKey[batchIndex];
+      soaBatch[batchIndex].data = data;
+      prefixBatch[batchIndex].key = batchKey[batchIndex];
+      prefixBatch[batchIndex].data = data;
+
+      if( present[keyId] ) {
+        value[keyId] += data;
+      } else {
+        present[keyId] = 1;
+        value[keyId] = data;
+        presentCount++;
+      }
+    }
+
+    CHECK( MergeAos(aosList, aosBatch, batchCount) );
+    CHECK( MergeSoa(soaList, soaBatch, batchCount) );
+    CHECK( MergePrefix(prefixList, prefixBatch, batchCount) );
+    memset( batchKey, '#', sizeof(batchKey) );
+    return 1;
+  }
+
+  /* Switches the key arena of each list on or off, or releases unused
+     space, which compacts the arena */
+  int TestToggle() {
+    int enable = (NextRandom(&randomState) % 4) != 0;
+
+    switch( NextRandom(&randomState) % 4 ) {
+    case 0:
+      CHECK( ArenaAos(aosList, enable) );
+      break;
+
+    case 1:
+      CHECK( ArenaSoa(soaList, enable) );
+      break;
+
+    case 2:
+      CHECK( ArenaPrefix(prefixList, enable) );
+      break;
+
+    default:
+      ReleaseAos( aosList );
+      ReleaseSoa( soaList );
+      ReleasePrefix( prefixList );
+      break;
+    }
+    return 1;
+  }
+
+/*
+ * Test rounds
+ */
+
+  int RunRound() {
+    unsigned keyRange = 1 + (NextRandom(&randomState) % KEY_LIMIT);
+    unsigned step;
+    unsigned keyId;
+    int result = 1;
+
+    for( step = 0; result && (step < STEP_COUNT); step++ ) {
+      keyId = NextRandom(&randomState) % keyRange;
+
+      switch( NextRandom(&randomState) % 16 ) {
+      case 0: case 1: case 2: case 3: case 4:
+        result = TestInsert(keyId);
+        break;
+
+      case 5: case 6: case 7: case 8:
+        result = TestRemove(keyId);
+        break;
+
+      case 9:
+        result = TestModify(keyId);
+        break;
+
+      case 10: case 11: case 12:
+        result = TestRetrieve(keyId);
+        break;
+
+      case 13:
+        result = TestMergeBatch(keyRange);
+        break;
+
+      default:
+        result = TestToggle();
+        break;
+      }
+
+      if( result && ((step % CHECK_INTERVAL) == 0) ) {
+        result = CheckLists();
+      }
+
+      if( result == 0 ) {
+        printf( "  Failed at step %u, key id %u\n", step, keyId );
+      }
+    }
+
+    return result && CheckLists();
+  }
+
+/*
+ * Main program
+ */
+
+  int main( int argc, char* argv[] ) {
+    unsigned seed = 1;
+    unsigned round;
+
+    if( argc > 1 ) {
+      seed = (unsigned)strtoul(argv[1], NULL, 10);
+    }
+    randomState = seed ? seed : 1;
+
+    MakeKeyNames();
+
+    for( round = 0; round < ROUND_COUNT; round++ ) {
+      ClearModel();
+      aosList = CreateAos(0);
+      soaList = CreateSoa(0);
+      prefixList = CreatePrefix(0);
+      if( !(aosList && soaList && prefixList) ) {
+        printf( "Error allocating lists\n" );
+        return 1;
+      }
+
+      if( RunRound() == 0 ) {
+        printf( "arenamodel: failed in round %u, seed %u\n", round, seed );
+        return 1;
+      }
+
+      FreeAos( &aosList );
+      FreeSoa( &soaList );
+      FreePrefix( &prefixList );
+    }
+
+    printf( "arenamodel: passed %u rounds, seed %u\n", ROUND_COUNT, seed );
+    return 0;
+  }
@@ -0,0 +1,490 @@
+#include <stdio.h>
+
+#include "../keyarray.h"
+#include "model.h"
+
+/*
+ *  File: tests/batchmodel.c
+ *  Status: Complete
+ *
+ *  Batched Lookup Model Test: find index many and retrieve many checked
+ *  against a model
+ *
+ *  Runs random inserts, removes, and modifies on a string list, an
+ *  unsigned list, and a custom key list, mixed with batched lookups of
+ *  the same keys on all three, and checks every result against a table
+ *  of the keys that should be present. Batches hold from 0 to
+ *  BATCH_LIMIT keys, so that they end part way through a group of
+ *  KEYARRAY_BATCH_WIDTH searches as often as not. Keys in a batch are in
+ *  any order, repeat, and are often missing. The bloom filter, lookup
+ *  cache, and hash index of the string list, and the lookup cache and
+ *  search index of the unsigned list, are switched on and off along the
+ *  way, so that batches run both interleaved and through them.
+ *
+ *  Key n is "batch-n" in the string list, n in the unsigned list, and
+ *  (n / 64, n % 64) in the custom list.
+ *
+ *  Every CHECK_INTERVAL operations, and at the end of each round, each
+ *  list is walked in full.
+ *
+ *  Build and run with the Makefile in this directory:
+ *    make check
+ *  or pass a seed, to repeat a run with other operations:
+ *    ./batchmodel 12345
+ *
+ *  https://github.com/orlandol/keyarray
+ */
+
+/*
+ * Model declarations
+ */
+
+  #define KEY_LIMIT 3000
+  #define KEY_SIZE 16
+  #define ROUND_COUNT 24
+  #define STEP_COUNT 6000
+  #define CHECK_INTERVAL 500
+  #define BATCH_LIMIT 64
+
+  char keyName[KEY_LIMIT][KEY_SIZE];
+  unsigned char present[KEY_LIMIT];
+  unsigned value[KEY_LIMIT];
+  size_t presentCount = 0;
+
+  void MakeKeyNames() {
+    unsigned keyId;
+
+    for( keyId = 0; keyId < KEY_LIMIT; keyId++ ) {
+      sprintf( keyName[keyId], "batch-%u", keyId );
+    }
+  }
+
+  void ClearModel() {
+    memset( present, 0, sizeof(present) );
+    memset( value, 0, sizeof(value) );
+    presentCount = 0;
+  }
+
+  /* Returns the number of keys in the model less than keyId */
+  size_t CountBelow( unsigned keyId ) {
+    size_t count = 0;
+    unsigned modelId;
+
+    for( modelId = 0; modelId < keyId; modelId++ ) {
+      count += present[modelId];
+    }
+    return count;
+  }
+
+/*
+ * List declarations
+ */
+
+  typedef struct PairKey {
+    unsigned high;
+    unsigned low;
+  } PairKey;
+
+  int ComparePairKeys( PairKey leftKey, PairKey rightKey ) {
+    if( leftKey.high != rightKey.high ) {
+      return (leftKey.high < rightKey.high) ? -1 : 1;
+    }
+    if( leftKey.low != rightKey.low ) {
+      return (leftKey.low < rightKey.low) ? -1 : 1;
+    }
+    return 0;
+  }
+
+  DECLARE_STRING_KEYARRAY_TYPES( StringList, unsigned )
+  DECLARE_STRING_KEYARRAY_CREATE( CreateString, StringList )
+  DECLARE_STRING_KEYARRAY_FREE( FreeString, StringList, FreeNothing )
+  DECLARE_STRING_KEYARRAY_INSERT( InsertString, StringList, unsigned )
+  DECLARE_STRING_KEYARRAY_REMOVE( RemoveString, StringList, FreeNothing )
+  DECLARE_STRING_KEYARRAY_MODIFY( ModifyString, StringList, unsigned )
+  DECLARE_STRING_KEYARRAY_FINDINDEXMANY( FindManyString, StringList )
+  DECLARE_STRING_KEYARRAY_RETRIEVEMANY( RetrieveManyString, StringList,
+      unsigned )
+  DECLARE_STRING_KEYARRAY_BLOOMFILTER( FilterString, StringList )
+  DECLARE_STRING_KEYARRAY_LOOKUPCACHE( CacheString, StringList )
+  DECLARE_STRING_KEYARRAY_HASHINDEX( HashString, StringList )
+
+  DECLARE_UINT_KEYARRAY_TYPES( UintList, unsigned )
+  DECLARE_UINT_KEYARRAY_CREATE( CreateUint, UintList )
+  DECLARE_UINT_KEYARRAY_FREE( FreeUint, UintList, FreeNothing )
+  DECLARE_UINT_KEYARRAY_INSERT( InsertUint, UintList, unsigned )
+  DECLARE_UINT_KEYARRAY_REMOVE( RemoveUint, UintList, FreeNothing )
+  DECLARE_UINT_KEYARRAY_MODIFY( ModifyUint, UintList, unsigned )
+  DECLARE_UINT_KEYARRAY_FINDINDEXMANY( FindManyUint, UintList )
+  DECLARE_UINT_KEYARRAY_RETRIEVEMANY( RetrieveManyUint, UintList,
+      unsigned )
+  DECLARE_UINT_KEYARRAY_LOOKUPCACHE( CacheUint, UintList )
+  DECLARE_UINT_KEYARRAY_SEARCHINDEX( IndexUint, UintList )
+
+  DECLARE_CUSTOM_KEYARRAY_TYPES( PairList, PairKey, unsigned,
+      ComparePairKeys )
+  DECLARE_CUSTOM_KEYARRAY_CREATE( CreatePair, PairList )
+  DECLARE_CUSTOM_KEYARRAY_FREE( FreePair, PairList, FreeNothing )
+  DECLARE_CUSTOM_KEYARRAY_INSERT( InsertPair, PairList, unsigned )
+  DECLARE_CUSTOM_KEYARRAY_REMOVE( RemovePair, PairList, FreeNothing )
+  DECLARE_CUSTOM_KEYARRAY_MODIFY( ModifyPair, PairList, unsigned )
+  DECLARE_CUSTOM_KEYARRAY_FINDINDEXMANY( FindManyPair, PairList )
+  DECLARE_CUSTOM_KEYARRAY_RETRIEVEMANY( RetrieveManyPair, PairList,
+      unsigned )
+
+  StringList* stringList = NULL;
+  UintList* uintList = NULL;
+  PairList* pairList = NULL;
+
+  PairKey MakePairKey( unsigned keyId ) {
+    PairKey key;
+
+    key.high = keyId / 64;
+    key.low = keyId % 64;
+    return key;
+  }
+
+/*
+ * List checks
+ */
+
+  /* Walks each list in full. Keys are in strictly increasing order, and
+     as many as in the model, so each list holds exactly the model's
+     keys. */
+  int CheckString( StringList* keyList ) {
+    unsigned keyId;
+    size_t index;
+
+    CHECK( keyList->itemCount == presentCount );
+    for( index = 0; index < keyList->itemCount; index++ ) {
+      keyId = (unsigned)strtoul(keyList->item[index].key + 6, NULL, 10);
+      CHECK( keyId < KEY_LIMIT );
+      CHECK( strcmp(keyList->item[index].key, keyName[keyId]) == 0 );
+      CHECK( present[keyId] );
+      CHECK( keyList->item[index].data == value[keyId] );
+      if( index ) {
+        CHECK( strcmp(keyList->item[index - 1].key,
+            keyList->item[index].key) < 0 );
+      }
+    }
+    return 1;
+  }
+
+  int CheckUint( UintList* keyList ) {
+    unsigned keyId;
+    size_t index;
+
+    CHECK( keyList->itemCount == presentCount );
+    for( index = 0; index < keyList->itemCount; index++ ) {
+      keyId = keyList->item[index].key;
+      CHECK( keyId < KEY_LIMIT );
+      CHECK( present[keyId] );
+      CHECK( keyList->item[index].data == value[keyId] );
+      if( index ) {
+        CHECK( keyList->item[index - 1].key < keyId );
+      }
+    }
+    return 1;
+  }
+
+  int CheckPair( PairList* keyList ) {
+    unsigned keyId;
+    size_t index;
+
+    CHECK( keyList->itemCount == presentCount );
+    for( index = 0; index < keyList->itemCount; index++ ) {
+      CHECK( keyList->item[index].key.low < 64 );
+      keyId = (keyList->item[index].key.high * 64) +
+          keyList->item[index].key.low;
+      CHECK( keyId < KEY_LIMIT );
+      CHECK( present[keyId] );
+      CHECK( keyList->item[index].data == value[keyId] );
+      if( index ) {
+        CHECK( ComparePairKeys(keyList->item[index - 1].key,
+            keyList->item[index].key) < 0 );
+      }
+    }
+    return 1;
+  }
+
+  int CheckLists() {
+    CHECK( CheckString(stringList) );
+    CHECK( CheckUint(uintList) );
+    CHECK( CheckPair(pairList) );
+    return 1;
+  }
+
+/*
+ * Operations
+ */
+
+  int TestInsert( unsigned keyId ) {
+    unsigned data = NextRandom(&randomState);
+    int expected = (present[keyId] == 0);
+
+    CHECK( (InsertString(stringList, keyName[keyId], &data) != 0) ==
+        expected );
+    CHECK( (InsertUint(uintList, keyId, &data) != 0) == expected );
+    CHECK( (InsertPair(pairList, MakePairKey(keyId), &data) != 0) ==
+        expected );
+
+    if( expected ) {
+      present[keyId] = 1;
+      value[keyId] = data;
+      presentCount++;
+    }
+    return 1;
+  }
+
+  int TestRemove( unsigned keyId ) {
+    RemoveString( stringList, keyName[keyId] );
+    RemoveUint( uintList, keyId );
+    RemovePair( pairList, MakePairKey(keyId) );
+
+    if( present[keyId] ) {
+      present[keyId] = 0;
+      presentCount--;
+    }
+    return 1;
+  }
+
+  int TestModify( unsigned keyId ) {
+    unsigned data = NextRandom(&randomState);
+    int expected = present[keyId];
+
+    CHECK( (ModifyString(stringList, keyName[keyId], &data) != 0) ==
+        expected );
+    CHECK( (ModifyUint(uintList, keyId, &data) != 0) == expected );
+    CHECK( (ModifyPair(pairList, MakePairKey(keyId), &data) != 0) ==
+        expected );
+
+    if( expected ) {
+      value[keyId] = data;
+    }
+    return 1;
+  }
+
+  /* Looks up a batch of keys on each list. Keys repeat an earlier key of
+     the batch a quarter of the time, and otherwise may be any key, so
+     that keys past the range of the round are always missing. Data of
+     missing keys must be left as it was, and found is left out of some
+     retrieves. */
+  int TestBatch( unsigned keyRange ) {
+    static unsigned keyId[BATCH_LIMIT];
+    static char* stringKey[BATCH_LIMIT];
+    static UintListKey uintKey[BATCH_LIMIT];
+    static PairKey pairKey[BATCH_LIMIT];
+    static size_t stringIndex[BATCH_LIMIT];
+    static size_t uintIndex[BATCH_LIMIT];
+    static size_t pairIndex[BATCH_LIMIT];
+    static unsigned stringData[BATCH_LIMIT];
+    static unsigned uintData[BATCH_LIMIT];
+    static unsigned pairData[BATCH_LIMIT];
+    static int stringFound[BATCH_LIMIT];
+    static int uintFound[BATCH_LIMIT];
+    static int pairFound[BATCH_LIMIT];
+    size_t keyCount = NextRandom(&randomState) % (BATCH_LIMIT + 1);
+    int useFound = (NextRandom(&randomState) % 4) != 0;
+    size_t foundCount = 0;
+    size_t keyIndex;
+    size_t index;
+
+    for( keyIndex = 0; keyIndex < keyCount; keyIndex++ ) {
+      if( keyIndex && ((NextRandom(&randomState) % 4) == 0) ) {
+        keyId[keyIndex] = keyId[NextRandom(&randomState) % keyIndex];
+      } else if( NextRandom(&randomState) % 8 ) {
+        keyId[keyIndex] = NextRandom(&randomState) % keyRange;
+      } else {
+        keyId[keyIndex] = NextRandom(&randomState) % KEY_LIMIT;
+      }
+
+      stringKey[keyIndex] = keyName[keyId[keyIndex]];
+      uintKey[keyIndex] = keyId[keyIndex];
+      pairKey[keyIndex] = MakePairKey(keyId[keyIndex]);
+      stringData[keyIndex] = ~value[keyId[keyIndex]];
+      uintData[keyIndex] = ~value[keyId[keyIndex]];
+      pairData[keyIndex] = ~value[keyId[keyIndex]];
+      stringFound[keyIndex] = -1;
+      uintFound[keyIndex] = -1;
+      pairFound[keyIndex] = -1;
+      foundCount += present[keyId[keyIndex]];
+    }
+
+    CHECK( FindManyString(stringList, stringKey, keyCount, stringIndex) ==
+        foundCount );
+    CHECK( FindManyUint(uintList, uintKey, keyCount, uintIndex) ==
+        foundCount );
+    CHECK( FindManyPair(pairList, pairKey, keyCount, pairIndex) ==
+        foundCount );
+    CHECK( RetrieveManyString(stringList, stringKey, keyCount, stringData,
+        useFound ? stringFound : NULL) == foundCount );
+    CHECK( RetrieveManyUint(uintList, uintKey, keyCount, uintData,
+        useFound ? uintFound : NULL) == foundCount );
+    CHECK( RetrieveManyPair(pairList, pairKey, keyCount, pairData,
+        useFound ? pairFound : NULL) == foundCount );
+
+    for( keyIndex = 0; keyIndex < keyCount; keyIndex++ ) {
+      if( present[keyId[keyIndex]] ) {
+        index = stringIndex[keyIndex];
+        CHECK( index < stringList->itemCount );
+        CHECK( strcmp(stringList->item[index].key, stringKey[keyIndex]) ==
+            0 );
+        CHECK( uintIndex[keyIndex] == CountBelow(keyId[keyIndex]) );
+        CHECK( pairIndex[keyIndex] == uintIndex[keyIndex] );
+        CHECK( stringData[keyIndex] == value[keyId[keyIndex]] );
+        CHECK( uintData[keyIndex] == value[keyId[keyIndex]] );
+        CHECK( pairData[keyIndex] == value[keyId[keyIndex]] );
+      } else {
+        CHECK( stringIndex[keyIndex] == (size_t)-1 );
+        CHECK( uintIndex[keyIndex] == (size_t)-1 );
+        CHECK( pairIndex[keyIndex] == (size_t)-1 );
+        CHECK( stringData[keyIndex] == ~value[keyId[keyIndex]] );
+        CHECK( uintData[keyIndex] == ~value[keyId[keyIndex]] );
+        CHECK( pairData[keyIndex] == ~value[keyId[keyIndex]] );
+      }
+
+      if( useFound ) {
+        CHECK( stringFound[keyIndex] == present[keyId[keyIndex]] );
+        CHECK( uintFound[keyIndex] == present[keyId[keyIndex]] );
+        CHECK( pairFound[keyIndex] == present[keyId[keyIndex]] );
+      } else {
+        CHECK( (stringFound[keyIndex] == -1) &&
+            (uintFound[keyIndex] == -1) && (pairFound[keyIndex] == -1) );
+      }
+    }
+    return 1;
+  }
+
+  /* Switches a lookup structure on or off */
+  int TestToggle() {
+    int enable = (NextRandom(&randomState) % 2) != 0;
+
+    switch( NextRandom(&randomState) % 5 ) {
+    case 0:
+      CHECK( FilterString(stringList, enable) );
+      break;
+
+    case 1:
+      CHECK( CacheString(stringList, enable) );
+      break;
+
+    case 2:
+      CHECK( HashString(stringList, enable) );
+      break;
+
+    case 3:
+      CHECK( CacheUint(uintList, enable) );
+      break;
+
+    default:
+      CHECK( IndexUint(uintList, enable) );
+      break;
+    }
+    return 1;
+  }
+
+  /* Batched lookups fail on a missing list or array */
+  int TestErrors() {
+    char* stringKey = keyName[0];
+    UintListKey uintKey = 0;
+    PairKey pairKey = MakePairKey(0);
+    size_t foundIndex = 0;
+    unsigned data = 0;
+
+    CHECK( FindManyString(NULL, &stringKey, 1, &foundIndex) == 0 );
+    CHECK( FindManyString(stringList, NULL, 1, &foundIndex) == 0 );
+    CHECK( FindManyString(stringList, &stringKey, 1, NULL) == 0 );
+    CHECK( FindManyUint(NULL, &uintKey, 1, &foundIndex) == 0 );
+    CHECK( FindManyPair(NULL, &pairKey, 1, &foundIndex) == 0 );
+    CHECK( RetrieveManyString(NULL, &stringKey, 1, &data, NULL) == 0 );
+    CHECK( RetrieveManyString(stringList, &stringKey, 1, NULL, NULL) ==
+        0 );
+    CHECK( RetrieveManyUint(uintList, NULL, 1, &data, NULL) == 0 );
+    CHECK( RetrieveManyPair(pairList, &pairKey, 1, NULL, NULL) == 0 );
+    return 1;
+  }
+
+/*
+ * Test rounds
+ */
+
+  int RunRound() {
+    unsigned keyRange = 1 + (NextRandom(&randomState) % KEY_LIMIT);
+    unsigned step;
+    unsigned keyId;
+    int result = 1;
+
+    for( step = 0; result && (step < STEP_COUNT); step++ ) {
+      keyId = NextRandom(&randomState) % keyRange;
+
+      switch( NextRandom(&randomState) % 16 ) {
+      case 0: case 1: case 2: case 3: case 4:
+        result = TestInsert(keyId);
+        break;
+
+      case 5: case 6: case 7:
+        result = TestRemove(keyId);
+        break;
+
+      case 8: case 9:
+        result = TestModify(keyId);
+        break;
+
+      case 10:
+        result = TestToggle();
+        break;
+
+      default:
+        result = TestBatch(keyRange);
+        break;
+      }
+
+      if( result && ((step % CHECK_INTERVAL) == 0) ) {
+        result = CheckLists();
+      }
+
+      if( result == 0 ) {
+        printf( "  Failed at step %u, key %u\n", step, keyId );
+      }
+    }
+
+    return result && CheckLists();
+  }
+
+/*
+ * Main program
+ */
+
+  int main( int argc, char* argv[] ) {
+    unsigned seed = 1;
+    unsigned round;
+
+    if( argc > 1 ) {
+      seed = (unsigned)strtoul(argv[1], NULL, 10);
+    }
+    randomState = seed ? seed : 1;
+
+    MakeKeyNames();
+
+    for( round = 0; round < ROUND_COUNT; round++ ) {
+      ClearModel();
+      stringList = CreateString(0);
+      uintList = CreateUint(0);
+      pairList = CreatePair(NextRandom(&randomState) % 64);
+      if( !(stringList && uintList && pairList) ) {
+        printf( "Error allocating lists\n" );
+        return 1;
+      }
+
+      if( (TestErrors() && RunRound()) == 0 ) {
+        printf( "batchmodel: failed in round %u, seed %u\n", round, seed );
+        return 1;
+      }
+
+      FreeString( &stringList );
+      FreeUint( &uintList );
+      FreePair( &pairList );
+    }
+
+    printf( "batchmodel: passed %u rounds, seed %u\n", ROUND_COUNT, seed );
+    return 0;
+  }
@@ -0,0 +1,622 @@
+#include <stdio.h>
+
+/* Small blocks, so that random operations split and join them often */
+#define KEYARRAY_BLOCK_SIZE 16
+
+#include "../keyarray.h"
+#include "model.h"
+
+/*
+ *  File: tests/blockmodel.c
+ *  Status: Complete
+ *
+ *  Blocked Layout Model Test: random operations checked against a model
+ *
+ *  First fills, splits, drains, and joins blocks one key at a time, at
+ *  each block size boundary, checking the blocks after every step. Then
+ *  runs the same random inserts, removes, modifies, retrieves, merge
+ *  batches, and bulk loads on a blocked string list and a blocked
+ *  unsigned list, and checks every result against a table of the keys
+ *  that should be present.
+ *
+ *  Key n is n in the unsigned list, and a zero padded string in the
+ *  string list, so that both lists hold their keys in the same order.
+ *
+ *  Build and run with the Makefile in this directory:
+ *    make check
+ *  or pass a seed, to repeat a run with other operations:
+ *    ./blockmodel 12345
+ *
+ *  https://github.com/orlandol/keyarray
+ */
+
+/*
+ * Model declarations
+ */
+
+  #define KEY_LIMIT 3000
+  #define KEY_SIZE 16
+  #define ROUND_COUNT 24
+  #define STEP_COUNT 6000
+  #define CHECK_INTERVAL 250
+  #define BATCH_LIMIT 48
+
+  char keyName[KEY_LIMIT][KEY_SIZE];
+  unsigned char present[KEY_LIMIT];
+  unsigned value[KEY_LIMIT];
+  size_t presentCount = 0;
+
+  void MakeKeyNames() {
+    unsigned keyId;
+
+    for( keyId = 0; keyId < KEY_LIMIT; keyId++ ) {
+      sprintf( keyName[keyId], "block-%05u", keyId );
+    }
+  }
+
+  unsigned KeyIdOf( const char* key ) {
+    return (unsigned)strtoul(key + 6, NULL, 10);
+  }
+
+  void ClearModel() {
+    memset( present, 0, sizeof(present) );
+    memset( value, 0, sizeof(value) );
+    presentCount = 0;
+  }
+
+  /* Returns the number of keys in the model less than keyId */
+  size_t CountBelow( unsigned keyId ) {
+    size_t count = 0;
+    unsigned modelId;
+
+    for( modelId = 0; (modelId < keyId) && (modelId < KEY_LIMIT);
+        modelId++ ) {
+      count += present[modelId];
+    }
+    return count;
+  }
+
+/*
+ * List declarations
+ */
+
+  int CopyValue( unsigned* dest, unsigned* source ) {
+    (*dest) = (*source);
+    return 1;
+  }
+
+  void AddValue( unsigned* existing, unsigned* incoming ) {
+    (*existing) += (*incoming);
+  }
+
+  DECLARE_STRING_KEYARRAY_TYPES_BLOCKED( StringList, unsigned )
+  DECLARE_STRING_KEYARRAY_CREATE_BLOCKED( CreateString, StringList )
+  DECLARE_STRING_KEYARRAY_FREE_BLOCKED( FreeString, StringList, FreeNothing )
+  DECLARE_STRING_KEYARRAY_INSERT_BLOCKED( InsertString, StringList,
+      unsigned )
+  DECLARE_STRING_KEYARRAY_REMOVE_BLOCKED( RemoveString, StringList,
+      FreeNothing )
+  DECLARE_STRING_KEYARRAY_RETRIEVE_BLOCKED( RetrieveString, StringList,
+      unsigned )
+  DECLARE_STRING_KEYARRAY_MODIFY_BLOCKED( ModifyString, StringList,
+      unsigned )
+  DECLARE_STRING_KEYARRAY_FINDINDEX_SIZE_BLOCKED( FindString, StringList )
+  DECLARE_STRING_KEYARRAY_LOWERBOUND_BLOCKED( LowerBoundString,
+      StringList )
+  DECLARE_STRING_KEYARRAY_RANGE_BLOCKED( RangeString, StringList )
+  DECLARE_STRING_KEYARRAY_ITEMAT_BLOCKED( ItemAtString, StringList )
+  DECLARE_STRING_KEYARRAY_RESERVE_BLOCKED( ReserveString, StringList )
+  DECLARE_STRING_KEYARRAY_RELEASEUNUSED_BLOCKED( ReleaseString,
+      StringList )
+  DECLARE_STRING_KEYARRAY_COPY_BLOCKED( CopyString, StringList, unsigned,
+      CopyValue, FreeNothing )
+  DECLARE_STRING_KEYARRAY_MERGEBATCH_BLOCKED( MergeString, StringList,
+      unsigned, AddValue, FreeNothing )
+  DECLARE_STRING_KEYARRAY_BULKLOAD_BLOCKED( BulkLoadString, StringList,
+      unsigned, KEYARRAY_DUPLICATES_MERGE, AddValue, FreeNothing )
+
+  DECLARE_UINT_KEYARRAY_TYPES_BLOCKED( UintList, unsigned )
+  DECLARE_UINT_KEYARRAY_CREATE_BLOCKED( CreateUint, UintList )
+  DECLARE_UINT_KEYARRAY_FREE_BLOCKED( FreeUint, UintList, FreeNothing )
+  DECLARE_UINT_KEYARRAY_INSERT_BLOCKED( InsertUint, UintList, unsigned )
+  DECLARE_UINT_KEYARRAY_REMOVE_BLOCKED( RemoveUint, UintList, FreeNothing )
+  DECLARE_UINT_KEYARRAY_RETRIEVE_BLOCKED( RetrieveUint, UintList,
+      unsigned )
+  DECLARE_UINT_KEYARRAY_MODIFY_BLOCKED( ModifyUint, UintList, unsigned )
+  DECLARE_UINT_KEYARRAY_FINDINDEX_SIZE_BLOCKED( FindUint, UintList )
+  DECLARE_UINT_KEYARRAY_UPPERBOUND_BLOCKED( UpperBoundUint, UintList )
+  DECLARE_UINT_KEYARRAY_RANGE_BLOCKED( RangeUint, UintList )
+  DECLARE_UINT_KEYARRAY_ITEMAT_BLOCKED( ItemAtUint, UintList )
+  DECLARE_UINT_KEYARRAY_RELEASEUNUSED_BLOCKED( ReleaseUint, UintList )
+  DECLARE_UINT_KEYARRAY_COPY_BLOCKED( CopyUint, UintList, unsigned,
+      CopyValue, FreeNothing )
+  DECLARE_UINT_KEYARRAY_MERGEBATCH_BLOCKED( MergeUint, UintList,
+      unsigned, AddValue, FreeNothing )
+  DECLARE_UINT_KEYARRAY_BULKLOAD_BLOCKED( BulkLoadUint, UintList,
+      unsigned, KEYARRAY_DUPLICATES_MERGE, AddValue, FreeNothing )
+
+  StringList* stringList = NULL;
+  UintList* uintList = NULL;
+
+/*
+ * List checks
+ */
+
+  /* Checks one item, in list order, against the model */
+  int CheckItem( size_t index, unsigned previousKeyId, unsigned keyId,
+      unsigned data ) {
+    CHECK( keyId < KEY_LIMIT );
+    CHECK( present[keyId] );
+    CHECK( data == value[keyId] );
+    if( index ) {
+      CHECK( previousKeyId < keyId );
+    }
+    return 1;
+  }
+
+  /* Checks that every block holds 1 to KEYARRAY_BLOCK_SIZE items, that
+     each block key is the first key of its block, and walks every item.
+     Keys are in strictly increasing order, and as many as in the model,
+     so the list holds exactly the model's keys. */
+  int CheckString( StringList* keyList ) {
+    StringListBlock* block;
+    unsigned previousKeyId = 0;
+    unsigned keyId;
+    size_t blockIndex;
+    size_t itemIndex;
+    size_t index = 0;
+
+    CHECK( keyList->itemCount == presentCount );
+    CHECK( keyList->blockCount <= keyList->reservedBlocks );
+
+    for( blockIndex = 0; blockIndex < keyList->blockCount; blockIndex++ ) {
+      block = keyList->block[blockIndex];
+      CHECK( (block->itemCount > 0) &&
+          (block->itemCount <= KEYARRAY_BLOCK_SIZE) );
+      CHECK( strcmp(keyList->blockKey[blockIndex],
+          block->item[0].key) == 0 );
+
+      for( itemIndex = 0; itemIndex < block->itemCount; itemIndex++ ) {
+        keyId = KeyIdOf(block->item[itemIndex].key);
+        CHECK( strcmp(block->item[itemIndex].key, keyName[keyId]) == 0 );
+        CHECK( CheckItem(index, previousKeyId, keyId,
+            block->item[itemIndex].data) );
+        CHECK( ItemAtString(keyList, index) == &(block->item[itemIndex]) );
+        CHECK( FindString(keyList, block->item[itemIndex].key) == index );
+        previousKeyId = keyId;
+        index++;
+      }
+    }
+
+    CHECK( index == keyList->itemCount );
+    CHECK( ItemAtString(keyList, index) == NULL );
+    return 1;
+  }
+
+  int CheckUint( UintList* keyList ) {
+    UintListBlock* block;
+    unsigned previousKeyId = 0;
+    unsigned keyId;
+    size_t blockIndex;
+    size_t itemIndex;
+    size_t index = 0;
+
+    CHECK( keyList->itemCount == presentCount );
+    CHECK( keyList->blockCount <= keyList->reservedBlocks );
+
+    for( blockIndex = 0; blockIndex < keyList->blockCount; blockIndex++ ) {
+      block = keyList->block[blockIndex];
+      CHECK( (block->itemCount > 0) &&
+          (block->itemCount <= KEYARRAY_BLOCK_SIZE) );
+      CHECK( keyList->blockKey[blockIndex] == block->item[0].key );
+
+      for( itemIndex = 0; itemIndex < block->itemCount; itemIndex++ ) {
+        keyId = block->item[itemIndex].key;
+        CHECK( CheckItem(index, previousKeyId, keyId,
+            block->item[itemIndex].data) );
+        CHECK( ItemAtUint(keyList, index) == &(block->item[itemIndex]) );
+        CHECK( FindUint(keyList, keyId) == index );
+        previousKeyId = keyId;
+        index++;
+      }
+    }
+
+    CHECK( index == keyList->itemCount );
+    CHECK( ItemAtUint(keyList, index) == NULL );
+    return 1;
+  }
+
+  /* Checks each list, and a copy of each list */
+  int CheckLists() {
+    StringList* stringCopy = NULL;
+    UintList* uintCopy = NULL;
+    int result;
+
+    CHECK( CheckString(stringList) );
+    CHECK( CheckUint(uintList) );
+
+    stringCopy = CopyString(stringList);
+    uintCopy = CopyUint(uintList);
+    result = stringCopy && uintCopy && CheckString(stringCopy) &&
+        CheckUint(uintCopy);
+
+    FreeString( &stringCopy );
+    FreeUint( &uintCopy );
+
+    CHECK( result );
+    return 1;
+  }
+
+/*
+ * Operations
+ */
+
+  int TestInsert( unsigned keyId ) {
+    unsigned data = NextRandom(&randomState);
+    int expected = (present[keyId] == 0);
+
+    CHECK( (InsertString(stringList, keyName[keyId], &data) != 0) ==
+        expected );
+    CHECK( (InsertUint(uintList, keyId, &data) != 0) == expected );
+
+    if( expected ) {
+      present[keyId] = 1;
+      value[keyId] = data;
+      presentCount++;
+    }
+    return 1;
+  }
+
+  int TestRemove( unsigned keyId ) {
+    RemoveString( stringList, keyName[keyId] );
+    RemoveUint( uintList, keyId );
+
+    if( present[keyId] ) {
+      present[keyId] = 0;
+      presentCount--;
+    }
+    return 1;
+  }
+
+  int TestModify( unsigned keyId ) {
+    unsigned data = NextRandom(&randomState);
+    int expected = present[keyId];
+
+    CHECK( (ModifyString(stringList, keyName[keyId], &data) != 0) ==
+        expected );
+    CHECK( (ModifyUint(uintList, keyId, &data) != 0) == expected );
+
+    if( expected ) {
+      value[keyId] = data;
+    }
+    return 1;
+  }
+
+  int TestRetrieve( unsigned keyId ) {
+    int expected = present[keyId];
+    size_t index = expected ? CountBelow(keyId) : (size_t)-1;
+    unsigned data;
+
+    data = ~value[keyId];
+    CHECK( (RetrieveString(stringList, keyName[keyId], &data) != 0) ==
+        expected );
+    CHECK( (expected == 0) || (data == value[keyId]) );
+
+    data = ~value[keyId];
+    CHECK( (RetrieveUint(uintList, keyId, &data) != 0) == expected );
+    CHECK( (expected == 0) || (data == value[keyId]) );
+
+    CHECK( FindString(stringList, keyName[keyId]) == index );
+    CHECK( FindUint(uintList, keyId) == index );
+    return 1;
+  }
+
+  /* Checks bounds and ranges from firstKeyId through lastKeyId */
+  int TestBounds( unsigned firstKeyId, unsigned lastKeyId ) {
+    size_t lowerBound = CountBelow(firstKeyId);
+    size_t upperBound = CountBelow(lastKeyId + 1);
+    size_t rangeCount = 0;
+    size_t beginIndex = (size_t)-1;
+
+    CHECK( LowerBoundString(stringList, keyName[firstKeyId]) ==
+        lowerBound );
+    CHECK( UpperBoundUint(uintList, lastKeyId) == upperBound );
+
+    if( firstKeyId > lastKeyId ) {
+      return 1;
+    }
+
+    rangeCount = RangeString(stringList, keyName[firstKeyId],
+        keyName[lastKeyId], &beginIndex);
+    CHECK( rangeCount == (upperBound - lowerBound) );
+    CHECK( (rangeCount == 0) || (beginIndex == lowerBound) );
+
+    rangeCount = RangeUint(uintList, firstKeyId, lastKeyId, &beginIndex);
+    CHECK( rangeCount == (upperBound - lowerBound) );
+    CHECK( (rangeCount == 0) || (beginIndex == lowerBound) );
+    return 1;
+  }
+
+  /* Merges a batch of random keys, some repeated, into both lists.
+     Large batches split several blocks at once. */
+  int TestMergeBatch( unsigned keyRange ) {
+    static StringListItem stringBatch[BATCH_LIMIT * 8];
+    static UintListItem uintBatch[BATCH_LIMIT * 8];
+    size_t batchCount = NextRandom(&randomState) % BATCH_LIMIT;
+    size_t batchIndex;
+    unsigned keyId;
+
+    if( (NextRandom(&randomState) % 8) == 0 ) {
+      batchCount *= 8;
+    }
+
+    for( batchIndex = 0; batchIndex < batchCount; batchIndex++ ) {
+      keyId = NextRandom(&randomState) % keyRange;
+
+      stringBatch[batchIndex].key = keyName[keyId];
+      stringBatch[batchIndex].data = NextRandom(&randomState) & 0xFFFF;
+      uintBatch[batchIndex].key = keyId;
+      uintBatch[batchIndex].data = stringBatch[batchIndex].data;
+
+      if( present[keyId] ) {
+        value[keyId] += stringBatch[batchIndex].data;
+      } else {
+        present[keyId] = 1;
+        value[keyId] = stringBatch[batchIndex].data;
+        presentCount++;
+      }
+    }
+
+    CHECK( MergeString(stringList, stringBatch, batchCount) );
+    CHECK( MergeUint(uintList, uintBatch, batchCount) );
+    return 1;
+  }
+
+  /* Replaces both lists with bulk loads of the model's keys, in reverse
+     order, with every other key repeated */
+  int TestBulkLoad() {
+    StringListItem* stringItem = NULL;
+    UintListItem* uintItem = NULL;
+    StringList* newStringList = NULL;
+    UintList* newUintList = NULL;
+    size_t itemCount = 0;
+    unsigned keyId;
+    int result = 0;
+
+    stringItem = (StringListItem*)malloc(KEY_LIMIT * 2 *
+        sizeof(StringListItem));
+    uintItem = (UintListItem*)malloc(KEY_LIMIT * 2 * sizeof(UintListItem));
+    if( !(stringItem && uintItem) ) {
+      goto ReturnError;
+    }
+
+    for( keyId = KEY_LIMIT; keyId-- > 0; ) {
+      if( present[keyId] == 0 ) {
+        continue;
+      }
+
+      stringItem[itemCount].key = keyName[keyId];
+      stringItem[itemCount].data = value[keyId];
+      uintItem[itemCount].key = keyId;
+      uintItem[itemCount].data = value[keyId];
+      itemCount++;
+
+      if( keyId & 1 ) {
+        stringItem[itemCount].key = keyName[keyId];
+        stringItem[itemCount].data = 1;
+        uintItem[itemCount].key = keyId;
+        uintItem[itemCount].data = 1;
+        itemCount++;
+        value[keyId]++;
+      }
+    }
+
+    newStringList = BulkLoadString(stringItem, itemCount);
+    newUintList = BulkLoadUint(uintItem, itemCount);
+    if( !(newStringList && newUintList) ) {
+      goto ReturnError;
+    }
+
+    FreeString( &stringList );
+    FreeUint( &uintList );
+    stringList = newStringList;
+    uintList = newUintList;
+    newStringList = NULL;
+    newUintList = NULL;
+    result = 1;
+
+  ReturnError:
+    FreeString( &newStringList );
+    FreeUint( &newUintList );
+    free( stringItem );
+    free( uintItem );
+
+    CHECK( result );
+    return 1;
+  }
+
+  /* Reserves or releases space */
+  int TestReserve() {
+    if( NextRandom(&randomState) % 2 ) {
+      CHECK( ReserveString(stringList, NextRandom(&randomState) % 4096) );
+    } else {
+      ReleaseString( stringList );
+      ReleaseUint( uintList );
+    }
+    return 1;
+  }
+
+/*
+ * Block boundaries
+ */
+
+  /* Inserts keyId, then checks every block */
+  int BoundaryInsert( unsigned keyId ) {
+    CHECK( TestInsert(keyId) );
+    CHECK( CheckString(stringList) );
+    CHECK( CheckUint(uintList) );
+    return 1;
+  }
+
+  /* Removes keyId, then checks every block */
+  int BoundaryRemove( unsigned keyId ) {
+    CHECK( TestRemove(keyId) );
+    CHECK( CheckString(stringList) );
+    CHECK( CheckUint(uintList) );
+    return 1;
+  }
+
+  /* Walks both lists across each split and join. Keys start out even,
+     so that odd keys can be inserted between them. */
+  int TestBoundaries() {
+    size_t blockCount;
+    unsigned keyId;
+
+    /* Fill one block exactly, then split it at the back */
+    for( keyId = 2; keyId <= (KEYARRAY_BLOCK_SIZE * 2); keyId += 2 ) {
+      CHECK( BoundaryInsert(keyId) );
+    }
+    CHECK( (stringList->blockCount == 1) && (uintList->blockCount == 1) );
+
+    CHECK( BoundaryInsert(KEYARRAY_BLOCK_SIZE * 2 + 2) );
+    CHECK( (stringList->blockCount == 2) && (uintList->blockCount == 2) );
+
+    /* Fill the first block again, then split it at the front */
+    for( keyId = 3; uintList->block[0]->itemCount < KEYARRAY_BLOCK_SIZE;
+        keyId += 2 ) {
+      CHECK( BoundaryInsert(keyId) );
+    }
+    CHECK( BoundaryInsert(0) );
+    CHECK( (stringList->blockCount == 3) && (uintList->blockCount == 3) );
+
+    /* Fill the last block, until it splits in the middle */
+    for( keyId = KEYARRAY_BLOCK_SIZE * 2 + 1;
+        keyId > (KEYARRAY_BLOCK_SIZE + 2); keyId -= 2 ) {
+      CHECK( BoundaryInsert(keyId) );
+    }
+    CHECK( (stringList->blockCount == 4) && (uintList->blockCount == 4) );
+
+    /* Remove from the front, until blocks start to join */
+    blockCount = uintList->blockCount;
+    for( keyId = 0; (keyId < KEY_LIMIT) &&
+        (uintList->blockCount == blockCount); keyId++ ) {
+      if( present[keyId] ) {
+        CHECK( BoundaryRemove(keyId) );
+      }
+    }
+    CHECK( (stringList->blockCount < blockCount) &&
+        (uintList->blockCount < blockCount) );
+
+    /* Then remove the rest, from the back, until the list is empty */
+    for( keyId = KEYARRAY_BLOCK_SIZE * 4; presentCount > 0; keyId-- ) {
+      if( present[keyId] ) {
+        CHECK( BoundaryRemove(keyId) );
+      }
+    }
+    CHECK( (stringList->blockCount == 0) && (uintList->blockCount == 0) );
+
+    /* Refill the empty list, out of order */
+    for( keyId = 0; keyId <= (KEYARRAY_BLOCK_SIZE * 2); keyId++ ) {
+      CHECK( BoundaryInsert((keyId * 7) % (KEYARRAY_BLOCK_SIZE * 2 + 1)) );
+    }
+    return 1;
+  }
+
+/*
+ * Test rounds
+ */
+
+  int RunRound() {
+    unsigned keyRange = 1 + (NextRandom(&randomState) % KEY_LIMIT);
+    unsigned step;
+    unsigned keyId;
+    int result = 1;
+
+    for( step = 0; result && (step < STEP_COUNT); step++ ) {
+      keyId = NextRandom(&randomState) % keyRange;
+
+      switch( NextRandom(&randomState) % 16 ) {
+      case 0: case 1: case 2: case 3: case 4:
+        result = TestInsert(keyId);
+        break;
+
+      case 5: case 6: case 7: case 8:
+        result = TestRemove(keyId);
+        break;
+
+      case 9:
+        result = TestModify(keyId);
+        break;
+
+      case 10: case 11:
+        result = TestRetrieve(keyId);
+        break;
+
+      case 12:
+        result = TestBounds(keyId, NextRandom(&randomState) % keyRange);
+        break;
+
+      case 13:
+        result = TestMergeBatch(keyRange);
+        break;
+
+      case 14:
+        if( (NextRandom(&randomState) % 32) == 0 ) {
+          result = TestBulkLoad();
+        }
+        break;
+
+      default:
+        result = TestReserve();
+        break;
+      }
+
+      if( result && ((step % CHECK_INTERVAL) == 0) ) {
+        result = CheckLists();
+      }
+
+      if( result == 0 ) {
+        printf( "  Failed at step %u, key %u\n", step, keyId );
+      }
+    }
+
+    return result && CheckLists();
+  }
+
+/*
+ * Main program
+ */
+
+  int main( int argc, char* argv[] ) {
+    unsigned seed = 1;
+    unsigned round;
+
+    if( argc > 1 ) {
+      seed = (unsigned)strtoul(argv[1], NULL, 10);
+    }
+    randomState = seed ? seed : 1;
+
+    MakeKeyNames();
+
+    for( round = 0; round <= ROUND_COUNT; round++ ) {
+      ClearModel();
+      stringList = CreateString(NextRandom(&randomState) % 64);
+      uintList = CreateUint(0);
+      if( !(stringList && uintList) ) {
+        printf( "Error allocating lists\n" );
+        return 1;
+      }
+
+      /* Round 0 walks the block boundaries, in place of random steps */
+      if( ((round == 0) ? TestBoundaries() : RunRound()) == 0 ) {
+        printf( "blockmodel: failed in round %u, seed %u\n", round, seed );
+        return 1;
+      }
+
+      FreeString( &stringList );
+      FreeUint( &uintList );
+    }
+
+    printf( "blockmodel: passed %u rounds, seed %u\n", ROUND_COUNT, seed );
+    return 0;
+  }
@@ -0,0 +1,441 @@
+#include <stdio.h>
+
+#include "../keyarray.h"
+#include "model.h"
+
+/*
+ *  File: tests/bloommodel.c
+ *  Status: Complete
+ *
+ *  Bloom Filter Model Test: missing key lookups checked against a model
+ *
+ *  Runs random inserts, upserts, removes, and merges on a string list
+ *  with the bloom filter enabled, mixed with many more lookups of keys
+ *  that are not in the list than of keys that are. Lookups go through
+ *  retrieve, modify, find index, get pointer, and update, and every
+ *  result is checked against a table of the keys that should be present.
+ *  The filter, the hash index, and the lookup cache are switched on and
+ *  off along the way, so that the filter is built from lists of every
+ *  size, and rebuilt as inserts and merges grow it.
+ *
+ *  Missing keys are "miss-n", and present keys with a byte changed.
+ *  Every present key must pass the filter, and at the end of each round,
+ *  a run of missing keys must pass it no more than MISS_PERCENT percent
+ *  of the time. The test reads the filter itself for both checks.
+ *
+ *  Every CHECK_INTERVAL operations, and at the end of each round, the
+ *  list is walked in full, and a copy of it, which has no filter, is
+ *  checked the same way.
+ *
+ *  Build and run with the Makefile in this directory:
+ *    make check
+ *  or pass a seed, to repeat a run with other operations:
+ *    ./bloommodel 12345
+ *
+ *  https://github.com/orlandol/keyarray
+ */
+
+/*
+ * Model declarations
+ */
+
+  #define KEY_LIMIT 4000
+  #define KEY_SIZE 16
+  #define ROUND_COUNT 24
+  #define STEP_COUNT 8000
+  #define CHECK_INTERVAL 500
+  #define BATCH_LIMIT 64
+  #define MISS_RUN 4000
+  #define MISS_PERCENT 1
+
+  char keyName[KEY_LIMIT][KEY_SIZE];
+  unsigned char present[KEY_LIMIT];
+  unsigned value[KEY_LIMIT];
+  size_t presentCount = 0;
+
+  /* Whether the bloom filter is enabled */
+  int bloomOn = 0;
+
+  void MakeKeyNames() {
+    unsigned keyId;
+
+    for( keyId = 0; keyId < KEY_LIMIT; keyId++ ) {
+      sprintf( keyName[keyId], "bloom-%05u", keyId );
+    }
+  }
+
+  void ClearModel() {
+    memset( present, 0, sizeof(present) );
+    memset( value, 0, sizeof(value) );
+    presentCount = 0;
+  }
+
+  /* Returns the number of keys in the model less than keyId */
+  size_t CountBelow( unsigned keyId ) {
+    size_t count = 0;
+    unsigned modelId;
+
+    for( modelId = 0; modelId < keyId; modelId++ ) {
+      count += present[modelId];
+    }
+    return count;
+  }
+
+  /* Writes a key that is never in the list to missKey: "miss-n", or
+     the name of keyId with one letter changed */
+  void MakeMissKey( char* missKey, unsigned keyId ) {
+    if( NextRandom(&randomState) % 2 ) {
+      sprintf( missKey, "miss-%u", NextRandom(&randomState) );
+    } else {
+      strcpy( missKey, keyName[keyId] );
+      missKey[NextRandom(&randomState) % 5] = 'X';
+    }
+  }
+
+/*
+ * List declarations
+ */
+
+  int CopyValue( unsigned* dest, unsigned* source ) {
+    (*dest) = (*source);
+    return 1;
+  }
+
+  void AddValue( unsigned* data, unsigned* sourceData ) {
+    (*data) += (*sourceData);
+  }
+
+  DECLARE_STRING_KEYARRAY_TYPES( BloomList, unsigned )
+  DECLARE_STRING_KEYARRAY_CREATE( CreateBloom, BloomList )
+  DECLARE_STRING_KEYARRAY_FREE( FreeBloom, BloomList, FreeNothing )
+  DECLARE_STRING_KEYARRAY_INSERT( InsertBloom, BloomList, unsigned )
+  DECLARE_STRING_KEYARRAY_UPSERT( UpsertBloom, BloomList, unsigned )
+  DECLARE_STRING_KEYARRAY_REMOVE( RemoveBloom, BloomList, FreeNothing )
+  DECLARE_STRING_KEYARRAY_RETRIEVE( RetrieveBloom, BloomList, unsigned )
+  DECLARE_STRING_KEYARRAY_MODIFY( ModifyBloom, BloomList, unsigned )
+  DECLARE_STRING_KEYARRAY_FINDINDEX_SIZE( FindBloom, BloomList )
+  DECLARE_STRING_KEYARRAY_GETPTR( GetBloom, BloomList, unsigned )
+  DECLARE_STRING_KEYARRAY_UPDATE( UpdateBloom, BloomList, unsigned,
+      AddValue )
+  DECLARE_STRING_KEYARRAY_MERGEBATCH( MergeBloom, BloomList, unsigned,
+      AddValue, FreeNothing )
+  DECLARE_STRING_KEYARRAY_RELEASEUNUSED( ReleaseBloom, BloomList )
+  DECLARE_STRING_KEYARRAY_COPY( CopyBloom, BloomList, unsigned,
+      CopyValue, FreeNothing )
+  DECLARE_STRING_KEYARRAY_BLOOMFILTER( FilterBloom, BloomList )
+  DECLARE_STRING_KEYARRAY_HASHINDEX( HashBloom, BloomList )
+  DECLARE_STRING_KEYARRAY_LOOKUPCACHE( CacheBloom, BloomList )
+
+  BloomList* bloomList = NULL;
+
+  /* Returns non-zero if key passes the list's filter */
+  int PassesFilter( BloomList* keyList, const char* key ) {
+    return KeyArrayBloomTest(keyList->bloomFilter,
+        KeyArrayStringHash64(key));
+  }
+
+/*
+ * List checks
+ */
+
+  /* Walks the whole list. Keys are in strictly increasing order, and as
+     many as in the model, so the list holds exactly the model's keys.
+     Each key passes the filter, if there is one. */
+  int CheckBloom( BloomList* keyList, int hasFilter ) {
+    unsigned keyId;
+    size_t index;
+
+    CHECK( keyList->itemCount == presentCount );
+    CHECK( (keyList->bloomFilter != NULL) == hasFilter );
+    if( hasFilter ) {
+      CHECK( keyList->bloomFilter->keyCount <=
+          keyList->bloomFilter->keyLimit );
+    }
+
+    for( index = 0; index < keyList->itemCount; index++ ) {
+      keyId = (unsigned)strtoul(keyList->item[index].key + 6, NULL, 10);
+      CHECK( keyId < KEY_LIMIT );
+      CHECK( strcmp(keyList->item[index].key, keyName[keyId]) == 0 );
+      CHECK( present[keyId] );
+      CHECK( keyList->item[index].data == value[keyId] );
+      if( index ) {
+        CHECK( strcmp(keyList->item[index - 1].key,
+            keyList->item[index].key) < 0 );
+      }
+      CHECK( (hasFilter == 0) ||
+          PassesFilter(keyList, keyList->item[index].key) );
+    }
+    return 1;
+  }
+
+  /* Checks the list, and a copy of the list */
+  int CheckLists() {
+    BloomList* bloomCopy = NULL;
+    int result;
+
+    CHECK( CheckBloom(bloomList, bloomOn) );
+
+    bloomCopy = CopyBloom(bloomList);
+    result = bloomCopy && CheckBloom(bloomCopy, 0);
+    FreeBloom( &bloomCopy );
+
+    CHECK( result );
+    return 1;
+  }
+
+  /* Counts the missing keys of a run that pass the filter */
+  int CheckMissRate() {
+    char missKey[KEY_SIZE];
+    unsigned missIndex;
+    unsigned passCount = 0;
+
+    if( bloomOn == 0 ) {
+      return 1;
+    }
+
+    for( missIndex = 0; missIndex < MISS_RUN; missIndex++ ) {
+      sprintf( missKey, "miss-%u", missIndex );
+      passCount += PassesFilter(bloomList, missKey);
+    }
+
+    CHECK( (passCount * 100) <= (MISS_RUN * MISS_PERCENT) );
+    return 1;
+  }
+
+/*
+ * Operations
+ */
+
+  int TestInsert( unsigned keyId ) {
+    unsigned data = NextRandom(&randomState);
+    int expected = (present[keyId] == 0);
+
+    CHECK( (InsertBloom(bloomList, keyName[keyId], &data) != 0) ==
+        expected );
+
+    if( expected ) {
+      present[keyId] = 1;
+      value[keyId] = data;
+      presentCount++;
+    }
+    return 1;
+  }
+
+  int TestUpsert( unsigned keyId ) {
+    unsigned data = NextRandom(&randomState);
+    unsigned* dataPtr;
+
+    if( present[keyId] == 0 ) {
+      present[keyId] = 1;
+      value[keyId] = data;
+      presentCount++;
+    }
+
+    dataPtr = UpsertBloom(bloomList, keyName[keyId], &data, NULL);
+    CHECK( dataPtr && ((*dataPtr) == value[keyId]) );
+    return 1;
+  }
+
+  int TestRemove( unsigned keyId ) {
+    RemoveBloom( bloomList, keyName[keyId] );
+
+    if( present[keyId] ) {
+      present[keyId] = 0;
+      presentCount--;
+    }
+    return 1;
+  }
+
+  /* Merges a batch of random keys, most of them new */
+  int TestMerge( unsigned keyRange ) {
+    BloomListItem batch[BATCH_LIMIT];
+    size_t batchCount = NextRandom(&randomState) % BATCH_LIMIT;
+    size_t batchIndex;
+    unsigned keyId;
+
+    for( batchIndex = 0; batchIndex < batchCount; batchIndex++ ) {
+      keyId = NextRandom(&randomState) % keyRange;
+      batch[batchIndex].key = keyName[keyId];
+      batch[batchIndex].data = NextRandom(&randomState);
+
+      if( present[keyId] ) {
+        value[keyId] += batch[batchIndex].data;
+      } else {
+        present[keyId] = 1;
+        value[keyId] = batch[batchIndex].data;
+        presentCount++;
+      }
+    }
+
+    CHECK( MergeBloom(bloomList, batch, batchCount) );
+    return 1;
+  }
+
+  /* Looks up key, which is present if keyId is not KEY_LIMIT, through
+     one of the lookup functions */
+  int TestLookup( const char* key, unsigned keyId ) {
+    int expected = (keyId < KEY_LIMIT) && present[keyId];
+    size_t index = expected ? CountBelow(keyId) : (size_t)-1;
+    unsigned data = NextRandom(&randomState);
+    unsigned* dataPtr;
+
+    switch( NextRandom(&randomState) % 5 ) {
+    case 0:
+      CHECK( (ModifyBloom(bloomList, (char*)key, &data) != 0) ==
+          expected );
+      if( expected ) {
+        value[keyId] = data;
+      }
+      break;
+
+    case 1:
+      CHECK( FindBloom(bloomList, (char*)key) == index );
+      break;
+
+    case 2:
+      dataPtr = GetBloom(bloomList, (char*)key);
+      CHECK( (dataPtr != NULL) == expected );
+      CHECK( (expected == 0) || ((*dataPtr) == value[keyId]) );
+      break;
+
+    case 3:
+      data %= 1000;
+      CHECK( (UpdateBloom(bloomList, (char*)key, &data) != 0) ==
+          expected );
+      if( expected ) {
+        value[keyId] += data;
+      }
+      break;
+
+    default:
+      data = expected ? ~value[keyId] : data;
+      CHECK( (RetrieveBloom(bloomList, (char*)key, &data) != 0) ==
+          expected );
+      CHECK( (expected == 0) || (data == value[keyId]) );
+      break;
+    }
+    return 1;
+  }
+
+  int TestMiss( unsigned keyId ) {
+    char missKey[KEY_SIZE];
+
+    MakeMissKey( missKey, keyId );
+    return TestLookup(missKey, KEY_LIMIT);
+  }
+
+  /* Switches a lookup structure on or off, or releases unused space */
+  int TestToggle() {
+    int enable = (NextRandom(&randomState) % 4) != 0;
+
+    switch( NextRandom(&randomState) % 4 ) {
+    case 0:
+      CHECK( FilterBloom(bloomList, enable) );
+      bloomOn = enable;
+      break;
+
+    case 1:
+      CHECK( HashBloom(bloomList, enable) );
+      break;
+
+    case 2:
+      CHECK( CacheBloom(bloomList, enable) );
+      break;
+
+    default:
+      ReleaseBloom( bloomList );
+      break;
+    }
+    return 1;
+  }
+
+/*
+ * Test rounds
+ */
+
+  int RunRound() {
+    unsigned keyRange = 1 + (NextRandom(&randomState) % KEY_LIMIT);
+    unsigned step;
+    unsigned keyId;
+    int result = 1;
+
+    for( step = 0; result && (step < STEP_COUNT); step++ ) {
+      keyId = NextRandom(&randomState) % keyRange;
+
+      switch( NextRandom(&randomState) % 32 ) {
+      case 0: case 1: case 2: case 3: case 4: case 5:
+        result = TestInsert(keyId);
+        break;
+
+      case 6:
+        result = TestUpsert(keyId);
+        break;
+
+      case 7: case 8: case 9:
+        result = TestRemove(keyId);
+        break;
+
+      case 10:
+        result = TestMerge(keyRange);
+        break;
+
+      case 11: case 12: case 13: case 14:
+        result = TestLookup(keyName[keyId], keyId);
+        break;
+
+      case 31:
+        result = TestToggle();
+        break;
+
+      default:
+        result = TestMiss(keyId);
+        break;
+      }
+
+      if( result && ((step % CHECK_INTERVAL) == 0) ) {
+        result = CheckLists();
+      }
+
+      if( result == 0 ) {
+        printf( "  Failed at step %u, key '%s'\n", step, keyName[keyId] );
+      }
+    }
+
+    return result && CheckLists() && CheckMissRate();
+  }
+
+/*
+ * Main program
+ */
+
+  int main( int argc, char* argv[] ) {
+    unsigned seed = 1;
+    unsigned round;
+
+    if( argc > 1 ) {
+      seed = (unsigned)strtoul(argv[1], NULL, 10);
+    }
+    randomState = seed ? seed : 1;
+
+    MakeKeyNames();
+
+    for( round = 0; round < ROUND_COUNT; round++ ) {
+      ClearModel();
+      bloomList = CreateBloom(NextRandom(&randomState) % 64);
+      if( !(bloomList && FilterBloom(bloomList, 1)) ) {
+        printf( "Error allocating list\n" );
+        return 1;
+      }
+      bloomOn = 1;
+
+      if( RunRound() == 0 ) {
+        printf( "bloommodel: failed in round %u, seed %u\n", round, seed );
+        return 1;
+      }
+
+      FreeBloom( &bloomList );
+    }
+
+    printf( "bloommodel: passed %u rounds, seed %u\n", ROUND_COUNT, seed );
+    return 0;
+  }
@@ -0,0 +1,455 @@
+#include <stdio.h>
+
+/* Small blocks, so that bounds fall on block edges often */
+#define KEYARRAY_BLOCK_SIZE 16
+
+#include "../keyarray.h"
+#include "model.h"
+
+/*
+ *  File: tests/boundmodel.c
+ *  Status: Complete
+ *
+ *  Bound Model Test: lower bound, upper bound, and range checked against
+ *  a model
+ *
+ *  Each round fills string lists in the array of structures, structure
+ *  of arrays, key prefix, and blocked layouts, and unsigned lists in the
+ *  array of structures, structure of arrays, and blocked layouts, with
+ *  the same random keys: none, one, a few, or many. Then probes every
+ *  layout with the smallest key, a key below the first key, a key above
+ *  the last key, the first and last keys exactly, keys between two
+ *  keys, and random keys, and checks the lower bound, upper bound, and
+ *  the range from each probe to every other against a count of the
+ *  model's keys.
+ *
+ *  Key n is "bound-n", zero padded, in the string lists, and 2n + 1 in
+ *  the unsigned lists, so that 2n falls between two keys.
+ *
+ *  Build and run with the Makefile in this directory:
+ *    make check
+ *  or pass a seed, to repeat a run with other operations:
+ *    ./boundmodel 12345
+ *
+ *  https://github.com/orlandol/keyarray
+ */
+
+/*
+ * Model declarations
+ */
+
+  #define KEY_LIMIT 2000
+  #define KEY_SIZE 16
+  #define ROUND_COUNT 64
+  #define PROBE_COUNT 12
+
+  char keyName[KEY_LIMIT][KEY_SIZE];
+  unsigned char present[KEY_LIMIT];
+  size_t presentCount = 0;
+
+  /* Bound keys, and the model's lower and upper bound of each */
+  char probe[PROBE_COUNT][KEY_SIZE + 2];
+  size_t lowerBound[PROBE_COUNT];
+  size_t upperBound[PROBE_COUNT];
+  unsigned uintProbe[PROBE_COUNT];
+  size_t uintLowerBound[PROBE_COUNT];
+  size_t uintUpperBound[PROBE_COUNT];
+
+  void MakeKeyNames() {
+    unsigned keyId;
+
+    for( keyId = 0; keyId < KEY_LIMIT; keyId++ ) {
+      sprintf( keyName[keyId], "bound-%05u", keyId );
+    }
+  }
+
+  /* Fills the model with no keys, one key, a few keys, or many */
+  void FillModel() {
+    unsigned keyId;
+    unsigned count;
+    unsigned density;
+
+    memset( present, 0, sizeof(present) );
+
+    switch( NextRandom(&randomState) % 4 ) {
+    case 0:
+      break;
+
+    case 1:
+      present[NextRandom(&randomState) % KEY_LIMIT] = 1;
+      break;
+
+    case 2:
+      count = 2 + (NextRandom(&randomState) % 16);
+      while( count-- ) {
+        present[NextRandom(&randomState) % KEY_LIMIT] = 1;
+      }
+      break;
+
+    default:
+      density = 1 + (NextRandom(&randomState) % 4);
+      for( keyId = 0; keyId < KEY_LIMIT; keyId++ ) {
+        present[keyId] = ((NextRandom(&randomState) % 4) < density);
+      }
+      break;
+    }
+
+    presentCount = 0;
+    for( keyId = 0; keyId < KEY_LIMIT; keyId++ ) {
+      presentCount += present[keyId];
+    }
+  }
+
+  /* Returns the first, or last, key id present, or a random id if the
+     model is empty */
+  unsigned EndKeyId( int lastKey ) {
+    unsigned keyId;
+
+    for( keyId = 0; keyId < KEY_LIMIT; keyId++ ) {
+      if( present[lastKey ? (KEY_LIMIT - 1 - keyId) : keyId] ) {
+        return lastKey ? (KEY_LIMIT - 1 - keyId) : keyId;
+      }
+    }
+    return NextRandom(&randomState) % KEY_LIMIT;
+  }
+
+  /* Makes the probes, and counts the model's keys before each. Probe 7
+     is the first key less its last digit, which sorts just before it. */
+  void MakeProbes() {
+    unsigned firstId = EndKeyId(0);
+    unsigned lastId = EndKeyId(1);
+    unsigned keyId;
+    size_t probeIndex;
+    int result;
+
+    strcpy( probe[0], "" );
+    strcpy( probe[1], "bound-" );
+    strcpy( probe[2], "bound-~" );
+    strcpy( probe[3], keyName[firstId] );
+    strcpy( probe[4], keyName[lastId] );
+    sprintf( probe[5], "%s0", keyName[firstId] );
+    sprintf( probe[6], "%s0", keyName[lastId] );
+    sprintf( probe[7], "%.*s", (int)strlen(keyName[firstId]) - 1,
+        keyName[firstId] );
+
+    for( probeIndex = 8; probeIndex < PROBE_COUNT; probeIndex++ ) {
+      keyId = NextRandom(&randomState) % KEY_LIMIT;
+      if( probeIndex & 1 ) {
+        sprintf( probe[probeIndex], "%s!", keyName[keyId] );
+      } else {
+        strcpy( probe[probeIndex], keyName[keyId] );
+      }
+    }
+
+    for( probeIndex = 0; probeIndex < PROBE_COUNT; probeIndex++ ) {
+      lowerBound[probeIndex] = 0;
+      upperBound[probeIndex] = 0;
+      for( keyId = 0; keyId < KEY_LIMIT; keyId++ ) {
+        if( present[keyId] ) {
+          result = strcmp(keyName[keyId], probe[probeIndex]);
+          lowerBound[probeIndex] += (result < 0);
+          upperBound[probeIndex] += (result <= 0);
+        }
+      }
+    }
+  }
+
+  /* Makes the unsigned probes, and counts the model's keys before each */
+  void MakeUintProbes() {
+    unsigned firstKey = (2 * EndKeyId(0)) + 1;
+    unsigned lastKey = (2 * EndKeyId(1)) + 1;
+    unsigned keyId;
+    size_t probeIndex;
+
+    uintProbe[0] = 0;
+    uintProbe[1] = firstKey - 1;
+    uintProbe[2] = UINT_MAX;
+    uintProbe[3] = firstKey;
+    uintProbe[4] = lastKey;
+    uintProbe[5] = firstKey + 1;
+    uintProbe[6] = lastKey + 1;
+    uintProbe[7] = 1;
+
+    for( probeIndex = 8; probeIndex < PROBE_COUNT; probeIndex++ ) {
+      keyId = NextRandom(&randomState) % KEY_LIMIT;
+      uintProbe[probeIndex] = (2 * keyId) + (probeIndex & 1);
+    }
+
+    for( probeIndex = 0; probeIndex < PROBE_COUNT; probeIndex++ ) {
+      uintLowerBound[probeIndex] = 0;
+      uintUpperBound[probeIndex] = 0;
+      for( keyId = 0; keyId < KEY_LIMIT; keyId++ ) {
+        if( present[keyId] ) {
+          uintLowerBound[probeIndex] +=
+              (((2 * keyId) + 1) < uintProbe[probeIndex]);
+          uintUpperBound[probeIndex] +=
+              (((2 * keyId) + 1) <= uintProbe[probeIndex]);
+        }
+      }
+    }
+  }
+
+/*
+ * List declarations
+ */
+
+  DECLARE_STRING_KEYARRAY_TYPES( AosList, unsigned )
+  DECLARE_STRING_KEYARRAY_CREATE( CreateAos, AosList )
+  DECLARE_STRING_KEYARRAY_FREE( FreeAos, AosList, FreeNothing )
+  DECLARE_STRING_KEYARRAY_INSERT( InsertAos, AosList, unsigned )
+  DECLARE_STRING_KEYARRAY_LOWERBOUND( LowerBoundAos, AosList )
+  DECLARE_STRING_KEYARRAY_UPPERBOUND( UpperBoundAos, AosList )
+  DECLARE_STRING_KEYARRAY_RANGE( RangeAos, AosList )
+
+  DECLARE_STRING_KEYARRAY_TYPES_SOA( SoaList, unsigned )
+  DECLARE_STRING_KEYARRAY_CREATE_SOA( CreateSoa, SoaList )
+  DECLARE_STRING_KEYARRAY_FREE_SOA( FreeSoa, SoaList, FreeNothing )
+  DECLARE_STRING_KEYARRAY_INSERT_SOA( InsertSoa, SoaList, unsigned )
+  DECLARE_STRING_KEYARRAY_LOWERBOUND_SOA( LowerBoundSoa, SoaList )
+  DECLARE_STRING_KEYARRAY_UPPERBOUND_SOA( UpperBoundSoa, SoaList )
+  DECLARE_STRING_KEYARRAY_RANGE_SOA( RangeSoa, SoaList )
+
+  DECLARE_STRING_KEYARRAY_TYPES_PREFIX( PrefixList, unsigned )
+  DECLARE_STRING_KEYARRAY_CREATE_PREFIX( CreatePrefix, PrefixList )
+  DECLARE_STRING_KEYARRAY_FREE_PREFIX( FreePrefix, PrefixList, FreeNothing )
+  DECLARE_STRING_KEYARRAY_INSERT_PREFIX( InsertPrefix, PrefixList,
+      unsigned )
+  DECLARE_STRING_KEYARRAY_LOWERBOUND_PREFIX( LowerBoundPrefix,
+      PrefixList )
+  DECLARE_STRING_KEYARRAY_UPPERBOUND_PREFIX( UpperBoundPrefix,
+      PrefixList )
+  DECLARE_STRING_KEYARRAY_RANGE_PREFIX( RangePrefix, PrefixList )
+
+  DECLARE_STRING_KEYARRAY_TYPES_BLOCKED( BlockList, unsigned )
+  DECLARE_STRING_KEYARRAY_CREATE_BLOCKED( CreateBlock, BlockList )
+  DECLARE_STRING_KEYARRAY_FREE_BLOCKED( FreeBlock, BlockList, FreeNothing )
+  DECLARE_STRING_KEYARRAY_INSERT_BLOCKED( InsertBlock, BlockList,
+      unsigned )
+  DECLARE_STRING_KEYARRAY_LOWERBOUND_BLOCKED( LowerBoundBlock,
+      BlockList )
+  DECLARE_STRING_KEYARRAY_UPPERBOUND_BLOCKED( UpperBoundBlock,
+      BlockList )
+  DECLARE_STRING_KEYARRAY_RANGE_BLOCKED( RangeBlock, BlockList )
+
+  DECLARE_UINT_KEYARRAY_TYPES( UintList, unsigned )
+  DECLARE_UINT_KEYARRAY_CREATE( CreateUint, UintList )
+  DECLARE_UINT_KEYARRAY_FREE( FreeUint, UintList, FreeNothing )
+  DECLARE_UINT_KEYARRAY_INSERT( InsertUint, UintList, unsigned )
+  DECLARE_UINT_KEYARRAY_LOWERBOUND( LowerBoundUint, UintList )
+  DECLARE_UINT_KEYARRAY_UPPERBOUND( UpperBoundUint, UintList )
+  DECLARE_UINT_KEYARRAY_RANGE( RangeUint, UintList )
+
+  DECLARE_UINT_KEYARRAY_TYPES_SOA( UintSoa, unsigned )
+  DECLARE_UINT_KEYARRAY_CREATE_SOA( CreateUintSoa, UintSoa )
+  DECLARE_UINT_KEYARRAY_FREE_SOA( FreeUintSoa, UintSoa, FreeNothing )
+  DECLARE_UINT_KEYARRAY_INSERT_SOA( InsertUintSoa, UintSoa, unsigned )
+  DECLARE_UINT_KEYARRAY_LOWERBOUND_SOA( LowerBoundUintSoa, UintSoa )
+  DECLARE_UINT_KEYARRAY_UPPERBOUND_SOA( UpperBoundUintSoa, UintSoa )
+  DECLARE_UINT_KEYARRAY_RANGE_SOA( RangeUintSoa, UintSoa )
+
+  DECLARE_UINT_KEYARRAY_TYPES_BLOCKED( UintBlock, unsigned )
+  DECLARE_UINT_KEYARRAY_CREATE_BLOCKED( CreateUintBlock, UintBlock )
+  DECLARE_UINT_KEYARRAY_FREE_BLOCKED( FreeUintBlock, UintBlock,
+      FreeNothing )
+  DECLARE_UINT_KEYARRAY_INSERT_BLOCKED( InsertUintBlock, UintBlock,
+      unsigned )
+  DECLARE_UINT_KEYARRAY_LOWERBOUND_BLOCKED( LowerBoundUintBlock,
+      UintBlock )
+  DECLARE_UINT_KEYARRAY_UPPERBOUND_BLOCKED( UpperBoundUintBlock,
+      UintBlock )
+  DECLARE_UINT_KEYARRAY_RANGE_BLOCKED( RangeUintBlock, UintBlock )
+
+  AosList* aosList = NULL;
+  SoaList* soaList = NULL;
+  PrefixList* prefixList = NULL;
+  BlockList* blockList = NULL;
+  UintList* uintList = NULL;
+  UintSoa* uintSoa = NULL;
+  UintBlock* uintBlock = NULL;
+
+/*
+ * List checks
+ */
+
+  /* Checks a range's count against the model's bounds of its first and
+     last keys, and where it begins, if it has any keys */
+  int CheckRange( size_t rangeCount, size_t beginIndex,
+      size_t firstLowerBound, size_t lastUpperBound ) {
+    size_t expectedCount = 0;
+
+    if( lastUpperBound > firstLowerBound ) {
+      expectedCount = lastUpperBound - firstLowerBound;
+    }
+
+    CHECK( rangeCount == expectedCount );
+    CHECK( (rangeCount == 0) || (beginIndex == firstLowerBound) );
+    return 1;
+  }
+
+  /* Checks the bounds of probe firstIndex, and the range from it to
+     probe lastIndex, in every layout */
+  int CheckProbe( size_t firstIndex, size_t lastIndex ) {
+    char* firstKey = probe[firstIndex];
+    char* lastKey = probe[lastIndex];
+    size_t firstBound;
+    size_t lastBound;
+    size_t beginIndex = 0;
+    size_t rangeCount;
+
+    CHECK( LowerBoundAos(aosList, firstKey) == lowerBound[firstIndex] );
+    CHECK( UpperBoundAos(aosList, firstKey) == upperBound[firstIndex] );
+    CHECK( LowerBoundSoa(soaList, firstKey) == lowerBound[firstIndex] );
+    CHECK( UpperBoundSoa(soaList, firstKey) == upperBound[firstIndex] );
+    CHECK( LowerBoundPrefix(prefixList, firstKey) ==
+        lowerBound[firstIndex] );
+    CHECK( UpperBoundPrefix(prefixList, firstKey) ==
+        upperBound[firstIndex] );
+    CHECK( LowerBoundBlock(blockList, firstKey) ==
+        lowerBound[firstIndex] );
+    CHECK( UpperBoundBlock(blockList, firstKey) ==
+        upperBound[firstIndex] );
+
+    firstBound = lowerBound[firstIndex];
+    lastBound = upperBound[lastIndex];
+    rangeCount = RangeAos(aosList, firstKey, lastKey, &beginIndex);
+    CHECK( CheckRange(rangeCount, beginIndex, firstBound, lastBound) );
+    rangeCount = RangeSoa(soaList, firstKey, lastKey, &beginIndex);
+    CHECK( CheckRange(rangeCount, beginIndex, firstBound, lastBound) );
+    rangeCount = RangePrefix(prefixList, firstKey, lastKey, &beginIndex);
+    CHECK( CheckRange(rangeCount, beginIndex, firstBound, lastBound) );
+    rangeCount = RangeBlock(blockList, firstKey, lastKey, &beginIndex);
+    CHECK( CheckRange(rangeCount, beginIndex, firstBound, lastBound) );
+
+    return 1;
+  }
+
+  int CheckUintProbe( size_t firstIndex, size_t lastIndex ) {
+    unsigned firstKey = uintProbe[firstIndex];
+    unsigned lastKey = uintProbe[lastIndex];
+    size_t firstBound = uintLowerBound[firstIndex];
+    size_t lastBound = uintUpperBound[lastIndex];
+    size_t beginIndex = 0;
+    size_t rangeCount;
+
+    CHECK( LowerBoundUint(uintList, firstKey) == firstBound );
+    CHECK( UpperBoundUint(uintList, firstKey) ==
+        uintUpperBound[firstIndex] );
+    CHECK( LowerBoundUintSoa(uintSoa, firstKey) == firstBound );
+    CHECK( UpperBoundUintSoa(uintSoa, firstKey) ==
+        uintUpperBound[firstIndex] );
+    CHECK( LowerBoundUintBlock(uintBlock, firstKey) == firstBound );
+    CHECK( UpperBoundUintBlock(uintBlock, firstKey) ==
+        uintUpperBound[firstIndex] );
+
+    rangeCount = RangeUint(uintList, firstKey, lastKey, &beginIndex);
+    CHECK( CheckRange(rangeCount, beginIndex, firstBound, lastBound) );
+    rangeCount = RangeUintSoa(uintSoa, firstKey, lastKey, &beginIndex);
+    CHECK( CheckRange(rangeCount, beginIndex, firstBound, lastBound) );
+    rangeCount = RangeUintBlock(uintBlock, firstKey, lastKey,
+        &beginIndex);
+    CHECK( CheckRange(rangeCount, beginIndex, firstBound, lastBound) );
+
+    return 1;
+  }
+
+/*
+ * Test rounds
+ */
+
+  int RunRound() {
+    unsigned keyId;
+    unsigned data;
+    size_t firstIndex;
+    size_t lastIndex;
+    int result = 1;
+
+    FillModel();
+    MakeProbes();
+    MakeUintProbes();
+
+    aosList = CreateAos(0);
+    soaList = CreateSoa(0);
+    prefixList = CreatePrefix(0);
+    blockList = CreateBlock(0);
+    uintList = CreateUint(0);
+    uintSoa = CreateUintSoa(0);
+    uintBlock = CreateUintBlock(0);
+    CHECK( aosList && soaList && prefixList && blockList && uintList &&
+        uintSoa && uintBlock );
+
+    for( keyId = 0; keyId < KEY_LIMIT; keyId++ ) {
+      if( present[keyId] ) {
+        data = keyId;
+        CHECK( InsertAos(aosList, keyName[keyId], &data) );
+        CHECK( InsertSoa(soaList, keyName[keyId], &data) );
+        CHECK( InsertPrefix(prefixList, keyName[keyId], &data) );
+        CHECK( InsertBlock(blockList, keyName[keyId], &data) );
+        CHECK( InsertUint(uintList, (2 * keyId) + 1, &data) );
+        CHECK( InsertUintSoa(uintSoa, (2 * keyId) + 1, &data) );
+        CHECK( InsertUintBlock(uintBlock, (2 * keyId) + 1, &data) );
+      }
+    }
+
+    for( firstIndex = 0; result && (firstIndex < PROBE_COUNT);
+        firstIndex++ ) {
+      for( lastIndex = 0; result && (lastIndex < PROBE_COUNT);
+          lastIndex++ ) {
+        result = CheckProbe(firstIndex, lastIndex);
+        if( result == 0 ) {
+          printf( "  Failed probes \"%s\" and \"%s\", %u keys\n",
+              probe[firstIndex], probe[lastIndex],
+              (unsigned)presentCount );
+        }
+      }
+    }
+
+    for( firstIndex = 0; result && (firstIndex < PROBE_COUNT);
+        firstIndex++ ) {
+      for( lastIndex = 0; result && (lastIndex < PROBE_COUNT);
+          lastIndex++ ) {
+        result = CheckUintProbe(firstIndex, lastIndex);
+        if( result == 0 ) {
+          printf( "  Failed probes %u and %u, %u keys\n",
+              uintProbe[firstIndex], uintProbe[lastIndex],
+              (unsigned)presentCount );
+        }
+      }
+    }
+
+    FreeAos( &aosList );
+    FreeSoa( &soaList );
+    FreePrefix( &prefixList );
+    FreeBlock( &blockList );
+    FreeUint( &uintList );
+    FreeUintSoa( &uintSoa );
+    FreeUintBlock( &uintBlock );
+
+    return result;
+  }
+
+/*
+ * Main program
+ */
+
+  int main( int argc, char* argv[] ) {
+    unsigned seed = 1;
+    unsigned round;
+
+    if( argc > 1 ) {
+      seed = (unsigned)strtoul(argv[1], NULL, 10);
+    }
+    randomState = seed ? seed : 1;
+
+    MakeKeyNames();
+
+    for( round = 0; round < ROUND_COUNT; round++ ) {
+      if( !RunRound() ) {
+        printf( "boundmodel: failed in round %u, seed %u\n", round,
+            seed );
+        return 1;
+      }
+    }
+
+    printf( "boundmodel: passed %u rounds, seed %u\n", ROUND_COUNT, seed );
+    return 0;
+  }
@@ -0,0 +1,442 @@
+#include <stdio.h>
+
+#include "../keyarray.h"
+#include "model.h"
+
+/*
+ *  File: tests/bulkmodel.c
+ *  Status: Complete
+ *
+ *  Bulk Load Model Test: duplicate policies checked against a model
+ *
+ *  Each round makes an unsorted array of items, with keys drawn from a
+ *  range small enough that many repeat, and the item's place in the
+ *  array as its data. Then bulk loads it as a string, an unsigned, and
+ *  a custom key list, under each duplicate policy, and checks the
+ *  list against a table of each key's items, in array order:
+ *  - Reject fails if any key repeats, and leaves the array untouched.
+ *  - First keeps the data of each key's first item.
+ *  - Last keeps the data of each key's last item.
+ *  - Merge folds the data of each key's later items into the first,
+ *    in array order.
+ *  A list holds each key once, and the data of every item that was not
+ *  kept is released.
+ *
+ *  Build and run with the Makefile in this directory:
+ *    make check
+ *  or pass a seed, to repeat a run with other operations:
+ *    ./bulkmodel 12345
+ *
+ *  https://github.com/orlandol/keyarray
+ */
+
+/*
+ * Model declarations
+ */
+
+  #define KEY_LIMIT 2000
+  #define KEY_SIZE 16
+  #define ROUND_COUNT 64
+  #define SOURCE_LIMIT 4000
+
+  char keyName[KEY_LIMIT][KEY_SIZE];
+
+  /* The source array, by key id, and what each policy should keep */
+  unsigned sourceKeyId[SOURCE_LIMIT];
+  size_t sourceCount = 0;
+  size_t itemCount[KEY_LIMIT];
+  unsigned firstData[KEY_LIMIT];
+  unsigned lastData[KEY_LIMIT];
+  unsigned mergedData[KEY_LIMIT];
+  size_t keyCount = 0;
+
+  /* Data releases made by the current bulk load */
+  size_t freeCalls = 0;
+
+  void MakeKeyNames() {
+    unsigned keyId;
+
+    for( keyId = 0; keyId < KEY_LIMIT; keyId++ ) {
+      sprintf( keyName[keyId], "bulk-%05u", keyId );
+    }
+  }
+
+  /* Folds source into dest, so the order data is merged in shows */
+  unsigned MergedValue( unsigned dest, unsigned source ) {
+    return (dest * 31) + source;
+  }
+
+  /* Makes the source array, and the table of what each policy keeps.
+     Item sourceIndex has data sourceIndex. */
+  void MakeSource() {
+    unsigned keyRange = 1 + (NextRandom(&randomState) % KEY_LIMIT);
+    int distinctKeys = ((NextRandom(&randomState) % 4) == 0);
+    unsigned keyId;
+    unsigned sourceIndex;
+
+    memset( itemCount, 0, sizeof(itemCount) );
+    keyCount = 0;
+
+    sourceCount = NextRandom(&randomState) % SOURCE_LIMIT;
+    if( (NextRandom(&randomState) % 8) == 0 ) {
+      sourceCount = NextRandom(&randomState) % 4;
+    }
+
+    /* Some arrays hold each key once, unsorted, so reject succeeds */
+    if( distinctKeys && (sourceCount > KEY_LIMIT) ) {
+      sourceCount = KEY_LIMIT;
+    }
+
+    for( sourceIndex = 0; sourceIndex < sourceCount; sourceIndex++ ) {
+      if( distinctKeys ) {
+        keyId = (sourceIndex * 7919) % KEY_LIMIT;
+      } else {
+        keyId = NextRandom(&randomState) % keyRange;
+      }
+      sourceKeyId[sourceIndex] = keyId;
+
+      if( itemCount[keyId] == 0 ) {
+        firstData[keyId] = sourceIndex;
+        mergedData[keyId] = sourceIndex;
+        keyCount++;
+      } else {
+        mergedData[keyId] = MergedValue(mergedData[keyId], sourceIndex);
+      }
+      lastData[keyId] = sourceIndex;
+      itemCount[keyId]++;
+    }
+  }
+
+  /* Returns the data policy keeps for keyId */
+  unsigned KeptData( unsigned keyId, int policy ) {
+    if( policy == KEYARRAY_DUPLICATES_LAST ) {
+      return lastData[keyId];
+    }
+    if( policy == KEYARRAY_DUPLICATES_MERGE ) {
+      return mergedData[keyId];
+    }
+    return firstData[keyId];
+  }
+
+  /* Checks the result of a bulk load under policy, before its list is
+     checked: rejected if a key repeats, or else one list item per key */
+  int CheckLoad( void* newList, int policy ) {
+    if( (policy == KEYARRAY_DUPLICATES_REJECT) &&
+        (keyCount != sourceCount) ) {
+      CHECK( newList == NULL );
+      CHECK( freeCalls == 0 );
+    } else {
+      CHECK( newList != NULL );
+      CHECK( freeCalls == (sourceCount - keyCount) );
+    }
+    return 1;
+  }
+
+/*
+ * List declarations
+ */
+
+  typedef struct PairKey {
+    unsigned high;
+    unsigned low;
+  } PairKey;
+
+  int ComparePairKeys( PairKey leftKey, PairKey rightKey ) {
+    if( leftKey.high != rightKey.high ) {
+      return (leftKey.high < rightKey.high) ? -1 : 1;
+    }
+    if( leftKey.low != rightKey.low ) {
+      return (leftKey.low < rightKey.low) ? -1 : 1;
+    }
+    return 0;
+  }
+
+  PairKey MakePairKey( unsigned keyId ) {
+    PairKey key;
+
+    key.high = keyId / 64;
+    key.low = keyId % 64;
+    return key;
+  }
+
+  void FreeValue( unsigned* data ) {
+    (void)data;
+    freeCalls++;
+  }
+
+  void MergeValue( unsigned* dest, unsigned* source ) {
+    (*dest) = MergedValue(*dest, *source);
+  }
+
+  DECLARE_STRING_KEYARRAY_TYPES( StringList, unsigned )
+  DECLARE_STRING_KEYARRAY_FREE( FreeString, StringList, FreeValue )
+  DECLARE_STRING_KEYARRAY_FINDINDEX_SIZE( FindString, StringList )
+  DECLARE_STRING_KEYARRAY_BULKLOAD( LoadStringReject, StringList,
+      unsigned, KEYARRAY_DUPLICATES_REJECT, MergeValue, FreeValue )
+  DECLARE_STRING_KEYARRAY_BULKLOAD( LoadStringFirst, StringList,
+      unsigned, KEYARRAY_DUPLICATES_FIRST, MergeValue, FreeValue )
+  DECLARE_STRING_KEYARRAY_BULKLOAD( LoadStringLast, StringList,
+      unsigned, KEYARRAY_DUPLICATES_LAST, MergeValue, FreeValue )
+  DECLARE_STRING_KEYARRAY_BULKLOAD( LoadStringMerge, StringList,
+      unsigned, KEYARRAY_DUPLICATES_MERGE, MergeValue, FreeValue )
+
+  DECLARE_UINT_KEYARRAY_TYPES( UintList, unsigned )
+  DECLARE_UINT_KEYARRAY_FREE( FreeUint, UintList, FreeValue )
+  DECLARE_UINT_KEYARRAY_FINDINDEX_SIZE( FindUint, UintList )
+  DECLARE_UINT_KEYARRAY_BULKLOAD( LoadUintReject, UintList, unsigned,
+      KEYARRAY_DUPLICATES_REJECT, MergeValue, FreeValue )
+  DECLARE_UINT_KEYARRAY_BULKLOAD( LoadUintFirst, UintList, unsigned,
+      KEYARRAY_DUPLICATES_FIRST, MergeValue, FreeValue )
+  DECLARE_UINT_KEYARRAY_BULKLOAD( LoadUintLast, UintList, unsigned,
+      KEYARRAY_DUPLICATES_LAST, MergeValue, FreeValue )
+  DECLARE_UINT_KEYARRAY_BULKLOAD( LoadUintMerge, UintList, unsigned,
+      KEYARRAY_DUPLICATES_MERGE, MergeValue, FreeValue )
+
+  DECLARE_CUSTOM_KEYARRAY_TYPES( PairList, PairKey, unsigned,
+      ComparePairKeys )
+  DECLARE_CUSTOM_KEYARRAY_FREE( FreePair, PairList, FreeValue )
+  DECLARE_CUSTOM_KEYARRAY_FINDINDEX_SIZE( FindPair, PairList )
+  DECLARE_CUSTOM_KEYARRAY_BULKLOAD( LoadPairReject, PairList, unsigned,
+      KEYARRAY_DUPLICATES_REJECT, MergeValue, FreeValue )
+  DECLARE_CUSTOM_KEYARRAY_BULKLOAD( LoadPairFirst, PairList, unsigned,
+      KEYARRAY_DUPLICATES_FIRST, MergeValue, FreeValue )
+  DECLARE_CUSTOM_KEYARRAY_BULKLOAD( LoadPairLast, PairList, unsigned,
+      KEYARRAY_DUPLICATES_LAST, MergeValue, FreeValue )
+  DECLARE_CUSTOM_KEYARRAY_BULKLOAD( LoadPairMerge, PairList, unsigned,
+      KEYARRAY_DUPLICATES_MERGE, MergeValue, FreeValue )
+
+  StringListItem stringSource[SOURCE_LIMIT];
+  UintListItem uintSource[SOURCE_LIMIT];
+  PairListItem pairSource[SOURCE_LIMIT];
+
+/*
+ * List checks
+ */
+
+  /* Each check walks the table's keys in order, beside the list, so
+     the list holds each key once, with the data policy keeps */
+
+  int CheckString( StringList* keyList, int policy ) {
+    unsigned keyId;
+    size_t index = 0;
+
+    CHECK( keyList->itemCount == keyCount );
+    for( keyId = 0; keyId < KEY_LIMIT; keyId++ ) {
+      if( itemCount[keyId] ) {
+        CHECK( strcmp(keyList->item[index].key, keyName[keyId]) == 0 );
+        CHECK( keyList->item[index].key != keyName[keyId] );
+        CHECK( keyList->item[index].data == KeptData(keyId, policy) );
+        CHECK( FindString(keyList, keyName[keyId]) == index );
+        index++;
+      }
+    }
+    return 1;
+  }
+
+  int CheckUint( UintList* keyList, int policy ) {
+    unsigned keyId;
+    size_t index = 0;
+
+    CHECK( keyList->itemCount == keyCount );
+    for( keyId = 0; keyId < KEY_LIMIT; keyId++ ) {
+      if( itemCount[keyId] ) {
+        CHECK( keyList->item[index].key == keyId );
+        CHECK( keyList->item[index].data == KeptData(keyId, policy) );
+        CHECK( FindUint(keyList, keyId) == index );
+        index++;
+      }
+    }
+    return 1;
+  }
+
+  int CheckPair( PairList* keyList, int policy ) {
+    unsigned keyId;
+    size_t index = 0;
+
+    CHECK( keyList->itemCount == keyCount );
+    for( keyId = 0; keyId < KEY_LIMIT; keyId++ ) {
+      if( itemCount[keyId] ) {
+        CHECK( ComparePairKeys(keyList->item[index].key,
+            MakePairKey(keyId)) == 0 );
+        CHECK( keyList->item[index].data == KeptData(keyId, policy) );
+        CHECK( FindPair(keyList, MakePairKey(keyId)) == index );
+        index++;
+      }
+    }
+    return 1;
+  }
+
+  /* Checks that a bulk load left the source arrays untouched */
+  int CheckSources() {
+    size_t sourceIndex;
+
+    for( sourceIndex = 0; sourceIndex < sourceCount; sourceIndex++ ) {
+      CHECK( stringSource[sourceIndex].key ==
+          keyName[sourceKeyId[sourceIndex]] );
+      CHECK( stringSource[sourceIndex].data == sourceIndex );
+      CHECK( uintSource[sourceIndex].key == sourceKeyId[sourceIndex] );
+      CHECK( uintSource[sourceIndex].data == sourceIndex );
+      CHECK( ComparePairKeys(pairSource[sourceIndex].key,
+          MakePairKey(sourceKeyId[sourceIndex])) == 0 );
+      CHECK( pairSource[sourceIndex].data == sourceIndex );
+    }
+    return 1;
+  }
+
+/*
+ * Operations
+ */
+
+  /* Fills each list type's source array from the model */
+  void FillSources() {
+    size_t sourceIndex;
+
+    for( sourceIndex = 0; sourceIndex < sourceCount; sourceIndex++ ) {
+      stringSource[sourceIndex].key = keyName[sourceKeyId[sourceIndex]];
+      stringSource[sourceIndex].data = (unsigned)sourceIndex;
+      uintSource[sourceIndex].key = sourceKeyId[sourceIndex];
+      uintSource[sourceIndex].data = (unsigned)sourceIndex;
+      pairSource[sourceIndex].key =
+          MakePairKey(sourceKeyId[sourceIndex]);
+      pairSource[sourceIndex].data = (unsigned)sourceIndex;
+    }
+  }
+
+  int TestString( int policy ) {
+    StringList* newList = NULL;
+    int result;
+
+    freeCalls = 0;
+    switch( policy ) {
+    case KEYARRAY_DUPLICATES_REJECT:
+      newList = LoadStringReject(stringSource, sourceCount);
+      break;
+
+    case KEYARRAY_DUPLICATES_FIRST:
+      newList = LoadStringFirst(stringSource, sourceCount);
+      break;
+
+    case KEYARRAY_DUPLICATES_LAST:
+      newList = LoadStringLast(stringSource, sourceCount);
+      break;
+
+    default:
+      newList = LoadStringMerge(stringSource, sourceCount);
+      break;
+    }
+
+    result = CheckLoad(newList, policy) &&
+        ((newList == NULL) || CheckString(newList, policy));
+
+    FreeString( &newList );
+    return result;
+  }
+
+  int TestUint( int policy ) {
+    UintList* newList = NULL;
+    int result;
+
+    freeCalls = 0;
+    switch( policy ) {
+    case KEYARRAY_DUPLICATES_REJECT:
+      newList = LoadUintReject(uintSource, sourceCount);
+      break;
+
+    case KEYARRAY_DUPLICATES_FIRST:
+      newList = LoadUintFirst(uintSource, sourceCount);
+      break;
+
+    case KEYARRAY_DUPLICATES_LAST:
+      newList = LoadUintLast(uintSource, sourceCount);
+      break;
+
+    default:
+      newList = LoadUintMerge(uintSource, sourceCount);
+      break;
+    }
+
+    result = CheckLoad(newList, policy) &&
+        ((newList == NULL) || CheckUint(newList, policy));
+
+    FreeUint( &newList );
+    return result;
+  }
+
+  int TestPair( int policy ) {
+    PairList* newList = NULL;
+    int result;
+
+    freeCalls = 0;
+    switch( policy ) {
+    case KEYARRAY_DUPLICATES_REJECT:
+      newList = LoadPairReject(pairSource, sourceCount);
+      break;
+
+    case KEYARRAY_DUPLICATES_FIRST:
+      newList = LoadPairFirst(pairSource, sourceCount);
+      break;
+
+    case KEYARRAY_DUPLICATES_LAST:
+      newList = LoadPairLast(pairSource, sourceCount);
+      break;
+
+    default:
+      newList = LoadPairMerge(pairSource, sourceCount);
+      break;
+    }
+
+    result = CheckLoad(newList, policy) &&
+        ((newList == NULL) || CheckPair(newList, policy));
+
+    FreePair( &newList );
+    return result;
+  }
+
+/*
+ * Test rounds
+ */
+
+  int RunRound() {
+    int policy;
+
+    MakeSource();
+    FillSources();
+
+    for( policy = KEYARRAY_DUPLICATES_REJECT;
+        policy <= KEYARRAY_DUPLICATES_MERGE; policy++ ) {
+      if( !(TestString(policy) && TestUint(policy) && TestPair(policy) &&
+          CheckSources()) ) {
+        printf( "  Failed policy %d, %u items, %u keys\n", policy,
+            (unsigned)sourceCount, (unsigned)keyCount );
+        return 0;
+      }
+    }
+
+    return 1;
+  }
+
+/*
+ * Main program
+ */
+
+  int main( int argc, char* argv[] ) {
+    unsigned seed = 1;
+    unsigned round;
+
+    if( argc > 1 ) {
+      seed = (unsigned)strtoul(argv[1], NULL, 10);
+    }
+    randomState = seed ? seed : 1;
+
+    MakeKeyNames();
+
+    for( round = 0; round < ROUND_COUNT; round++ ) {
+      if( !RunRound() ) {
+        printf( "bulkmodel: failed in round %u, seed %u\n", round, seed );
+        return 1;
+      }
+    }
+
+    printf( "bulkmodel: passed %u rounds, seed %u\n", ROUND_COUNT, seed );
+    return 0;
+  }
@@ -0,0 +1,588 @@
+#include <stdio.h>
+
+/* A small table and finger reach, so that slots are shared, and finger
+   searches fall back to the whole list often */
+#define KEYARRAY_LOOKUPCACHE_BITS 4
+#define KEYARRAY_FINGER_REACH 4
+
+#include "../keyarray.h"
+#include "model.h"
+
+/*
+ *  File: tests/cachemodel.c
+ *  Status: Complete
+ *
+ *  Lookup Cache Model Test: skewed and local lookups checked against a
+ *  model
+ *
+ *  Runs the same random retrieves, modifies, finds, get pointers, and
+ *  updates on a string list and an unsigned list with the lookup cache
+ *  enabled, and checks every result against a table of the keys that
+ *  should be present. Most lookups are of a few hot keys, or of keys
+ *  close to the one before, and are mixed with inserts, removes, and
+ *  merges, so that the cache is cleared between them. The cache, the
+ *  hash index of the string list, and the search index of the unsigned
+ *  list, are switched on and off along the way.
+ *
+ *  The hit and miss counts are checked too: a key looked up twice in a
+ *  row is a hit the second time, and the first lookup after a change is
+ *  a miss.
+ *
+ *  Key n is "cache-n", zero padded, in the string list, and n in the
+ *  unsigned list, so that both lists hold their keys in the same order.
+ *
+ *  Every CHECK_INTERVAL operations, and at the end of each round, each
+ *  list is walked in full, and a copy of each list is checked the same
+ *  way.
+ *
+ *  Build and run with the Makefile in this directory:
+ *    make check
+ *  or pass a seed, to repeat a run with other operations:
+ *    ./cachemodel 12345
+ *
+ *  https://github.com/orlandol/keyarray
+ */
+
+/*
+ * Model declarations
+ */
+
+  #define KEY_LIMIT 3000
+  #define KEY_SIZE 16
+  #define HOT_COUNT 24
+  #define ROUND_COUNT 24
+  #define STEP_COUNT 6000
+  #define CHECK_INTERVAL 500
+  #define BATCH_LIMIT 8
+
+  char keyName[KEY_LIMIT][KEY_SIZE];
+  unsigned char present[KEY_LIMIT];
+  unsigned value[KEY_LIMIT];
+  size_t presentCount = 0;
+
+  /* Hot keys of the round, and the key looked up last */
+  unsigned hotKey[HOT_COUNT];
+  unsigned lastKeyId = 0;
+
+  /* Whether the lookup cache of each list is enabled, and its hit and
+     miss counts when last read */
+  int stringCacheOn = 0;
+  int uintCacheOn = 0;
+  size_t stringHits = 0;
+  size_t stringMisses = 0;
+  size_t uintHits = 0;
+  size_t uintMisses = 0;
+
+  void MakeKeyNames() {
+    unsigned keyId;
+
+    for( keyId = 0; keyId < KEY_LIMIT; keyId++ ) {
+      sprintf( keyName[keyId], "cache-%05u", keyId );
+    }
+  }
+
+  void ClearModel( unsigned keyRange ) {
+    unsigned hotIndex;
+
+    memset( present, 0, sizeof(present) );
+    memset( value, 0, sizeof(value) );
+    presentCount = 0;
+
+    for( hotIndex = 0; hotIndex < HOT_COUNT; hotIndex++ ) {
+      hotKey[hotIndex] = NextRandom(&randomState) % keyRange;
+    }
+    lastKeyId = 0;
+  }
+
+  /* Returns the number of keys in the model less than keyId */
+  size_t CountBelow( unsigned keyId ) {
+    size_t count = 0;
+    unsigned modelId;
+
+    for( modelId = 0; modelId < keyId; modelId++ ) {
+      count += present[modelId];
+    }
+    return count;
+  }
+
+  /* Returns a hot key most of the time, then a key close to the last
+     one, then any key */
+  unsigned PickKey( unsigned keyRange ) {
+    unsigned pick = NextRandom(&randomState) % 8;
+    unsigned keyId;
+
+    if( pick < 5 ) {
+      keyId = hotKey[NextRandom(&randomState) % HOT_COUNT];
+    } else if( pick < 7 ) {
+      keyId = lastKeyId + (NextRandom(&randomState) % 7);
+      keyId = (keyId < 3) ? 0 : (keyId - 3);
+      if( keyId >= keyRange ) {
+        keyId = keyRange - 1;
+      }
+    } else {
+      keyId = NextRandom(&randomState) % keyRange;
+    }
+
+    lastKeyId = keyId;
+    return keyId;
+  }
+
+/*
+ * List declarations
+ */
+
+  int CopyValue( unsigned* dest, unsigned* source ) {
+    (*dest) = (*source);
+    return 1;
+  }
+
+  void AddValue( unsigned* data, unsigned* sourceData ) {
+    (*data) += (*sourceData);
+  }
+
+  DECLARE_STRING_KEYARRAY_TYPES( StringList, unsigned )
+  DECLARE_STRING_KEYARRAY_CREATE( CreateString, StringList )
+  DECLARE_STRING_KEYARRAY_FREE( FreeString, StringList, FreeNothing )
+  DECLARE_STRING_KEYARRAY_INSERT( InsertString, StringList, unsigned )
+  DECLARE_STRING_KEYARRAY_REMOVE( RemoveString, StringList, FreeNothing )
+  DECLARE_STRING_KEYARRAY_RETRIEVE( RetrieveString, StringList, unsigned )
+  DECLARE_STRING_KEYARRAY_MODIFY( ModifyString, StringList, unsigned )
+  DECLARE_STRING_KEYARRAY_FINDINDEX_SIZE( FindString, StringList )
+  DECLARE_STRING_KEYARRAY_GETPTR( GetString, StringList, unsigned )
+  DECLARE_STRING_KEYARRAY_UPDATE( UpdateString, StringList, unsigned,
+      AddValue )
+  DECLARE_STRING_KEYARRAY_MERGEBATCH( MergeString, StringList, unsigned,
+      AddValue, FreeNothing )
+  DECLARE_STRING_KEYARRAY_COPY( CopyString, StringList, unsigned,
+      CopyValue, FreeNothing )
+  DECLARE_STRING_KEYARRAY_HASHINDEX( HashString, StringList )
+  DECLARE_STRING_KEYARRAY_LOOKUPCACHE( CacheString, StringList )
+  DECLARE_STRING_KEYARRAY_CACHECOUNTS( CountsString, StringList )
+
+  DECLARE_UINT_KEYARRAY_TYPES( UintList, unsigned )
+  DECLARE_UINT_KEYARRAY_CREATE( CreateUint, UintList )
+  DECLARE_UINT_KEYARRAY_FREE( FreeUint, UintList, FreeNothing )
+  DECLARE_UINT_KEYARRAY_INSERT( InsertUint, UintList, unsigned )
+  DECLARE_UINT_KEYARRAY_REMOVE( RemoveUint, UintList, FreeNothing )
+  DECLARE_UINT_KEYARRAY_RETRIEVE( RetrieveUint, UintList, unsigned )
+  DECLARE_UINT_KEYARRAY_MODIFY( ModifyUint, UintList, unsigned )
+  DECLARE_UINT_KEYARRAY_FINDINDEX_SIZE( FindUint, UintList )
+  DECLARE_UINT_KEYARRAY_GETPTR( GetUint, UintList, unsigned )
+  DECLARE_UINT_KEYARRAY_UPDATE( UpdateUint, UintList, unsigned,
+      AddValue )
+  DECLARE_UINT_KEYARRAY_MERGEBATCH( MergeUint, UintList, unsigned,
+      AddValue, FreeNothing )
+  DECLARE_UINT_KEYARRAY_COPY( CopyUint, UintList, unsigned,
+      CopyValue, FreeNothing )
+  DECLARE_UINT_KEYARRAY_SEARCHINDEX( IndexUint, UintList )
+  DECLARE_UINT_KEYARRAY_LOOKUPCACHE( CacheUint, UintList )
+  DECLARE_UINT_KEYARRAY_CACHECOUNTS( CountsUint, UintList )
+
+  StringList* stringList = NULL;
+  UintList* uintList = NULL;
+
+/*
+ * List checks
+ */
+
+  /* Walks each list in full. Keys are in strictly increasing order, and
+     as many as in the model, so each list holds exactly the model's
+     keys. Copies have no cache. */
+  int CheckString( StringList* keyList ) {
+    unsigned keyId;
+    size_t index;
+
+    CHECK( keyList->itemCount == presentCount );
+    for( index = 0; index < keyList->itemCount; index++ ) {
+      keyId = (unsigned)strtoul(keyList->item[index].key + 6, NULL, 10);
+      CHECK( keyId < KEY_LIMIT );
+      CHECK( strcmp(keyList->item[index].key, keyName[keyId]) == 0 );
+      CHECK( present[keyId] );
+      CHECK( keyList->item[index].data == value[keyId] );
+      if( index ) {
+        CHECK( strcmp(keyList->item[index - 1].key,
+            keyList->item[index].key) < 0 );
+      }
+    }
+    return 1;
+  }
+
+  int CheckUint( UintList* keyList ) {
+    unsigned keyId;
+    size_t index;
+
+    CHECK( keyList->itemCount == presentCount );
+    for( index = 0; index < keyList->itemCount; index++ ) {
+      keyId = keyList->item[index].key;
+      CHECK( keyId < KEY_LIMIT );
+      CHECK( present[keyId] );
+      CHECK( keyList->item[index].data == value[keyId] );
+      if( index ) {
+        CHECK( keyList->item[index - 1].key < keyId );
+      }
+    }
+    return 1;
+  }
+
+  /* Checks each list, and a copy of each list */
+  int CheckLists() {
+    StringList* stringCopy = NULL;
+    UintList* uintCopy = NULL;
+    int result;
+
+    CHECK( CheckString(stringList) );
+    CHECK( CheckUint(uintList) );
+    CHECK( (CountsString(stringList, NULL, NULL, 0) != 0) ==
+        stringCacheOn );
+    CHECK( (CountsUint(uintList, NULL, NULL, 0) != 0) == uintCacheOn );
+
+    stringCopy = CopyString(stringList);
+    uintCopy = CopyUint(uintList);
+    result = stringCopy && uintCopy && CheckString(stringCopy) &&
+        CheckUint(uintCopy) &&
+        (CountsString(stringCopy, NULL, NULL, 0) == 0) &&
+        (CountsUint(uintCopy, NULL, NULL, 0) == 0);
+
+    FreeString( &stringCopy );
+    FreeUint( &uintCopy );
+
+    CHECK( result );
+    return 1;
+  }
+
+/*
+ * Operations
+ */
+
+  int TestInsert( unsigned keyId ) {
+    unsigned data = NextRandom(&randomState);
+    int expected = (present[keyId] == 0);
+
+    CHECK( (InsertString(stringList, keyName[keyId], &data) != 0) ==
+        expected );
+    CHECK( (InsertUint(uintList, keyId, &data) != 0) == expected );
+
+    if( expected ) {
+      present[keyId] = 1;
+      value[keyId] = data;
+      presentCount++;
+    }
+    return 1;
+  }
+
+  int TestRemove( unsigned keyId ) {
+    RemoveString( stringList, keyName[keyId] );
+    RemoveUint( uintList, keyId );
+
+    if( present[keyId] ) {
+      present[keyId] = 0;
+      presentCount--;
+    }
+    return 1;
+  }
+
+  /* Merges a small batch of random keys into each list */
+  int TestMerge( unsigned keyRange ) {
+    StringListItem stringBatch[BATCH_LIMIT];
+    UintListItem uintBatch[BATCH_LIMIT];
+    size_t batchCount = 1 + (NextRandom(&randomState) % BATCH_LIMIT);
+    size_t batchIndex;
+    unsigned keyId;
+    unsigned data;
+
+    for( batchIndex = 0; batchIndex < batchCount; batchIndex++ ) {
+      keyId = NextRandom(&randomState) % keyRange;
+      data = NextRandom(&randomState);
+
+      stringBatch[batchIndex].key = keyName[keyId];
+      stringBatch[batchIndex].data = data;
+      uintBatch[batchIndex].key = keyId;
+      uintBatch[batchIndex].data = data;
+
+      if( present[keyId] ) {
+        value[keyId] += data;
+      } else {
+        present[keyId] = 1;
+        value[keyId] = data;
+        presentCount++;
+      }
+    }
+
+    CHECK( MergeString(stringList, stringBatch, batchCount) );
+    CHECK( MergeUint(uintList, uintBatch, batchCount) );
+    return 1;
+  }
+
+  /* One lookup of keyId in each list, through retrieve, modify, find
+     index, get pointer, or update */
+  int TestLookup( unsigned keyId ) {
+    int expected = present[keyId];
+    size_t index = expected ? CountBelow(keyId) : (size_t)-1;
+    unsigned data = NextRandom(&randomState);
+    unsigned* stringPtr;
+    unsigned* uintPtr;
+
+    switch( NextRandom(&randomState) % 5 ) {
+    case 0:
+      CHECK( (ModifyString(stringList, keyName[keyId], &data) != 0) ==
+          expected );
+      CHECK( (ModifyUint(uintList, keyId, &data) != 0) == expected );
+      if( expected ) {
+        value[keyId] = data;
+      }
+      break;
+
+    case 1:
+      CHECK( FindString(stringList, keyName[keyId]) == index );
+      CHECK( FindUint(uintList, keyId) == index );
+      break;
+
+    case 2:
+      stringPtr = GetString(stringList, keyName[keyId]);
+      uintPtr = GetUint(uintList, keyId);
+      CHECK( (stringPtr != NULL) == expected );
+      CHECK( (uintPtr != NULL) == expected );
+      CHECK( (expected == 0) || ((*stringPtr) == value[keyId]) );
+      CHECK( (expected == 0) || ((*uintPtr) == value[keyId]) );
+      break;
+
+    case 3:
+      data %= 1000;
+      CHECK( (UpdateString(stringList, keyName[keyId], &data) != 0) ==
+          expected );
+      CHECK( (UpdateUint(uintList, keyId, &data) != 0) == expected );
+      if( expected ) {
+        value[keyId] += data;
+      }
+      break;
+
+    default:
+      data = ~value[keyId];
+      CHECK( (RetrieveString(stringList, keyName[keyId], &data) != 0) ==
+          expected );
+      CHECK( (expected == 0) || (data == value[keyId]) );
+      data = ~value[keyId];
+      CHECK( (RetrieveUint(uintList, keyId, &data) != 0) == expected );
+      CHECK( (expected == 0) || (data == value[keyId]) );
+      break;
+    }
+    return 1;
+  }
+
+  /* Reads the hit and miss counts of each list whose cache is enabled,
+     and checks how far they moved since the last read. A step of
+     ANY_STEP checks only that hits and misses moved by one in all. */
+  #define ANY_STEP ((size_t)-1)
+
+  int CheckCounts( size_t hitStep, size_t missStep ) {
+    size_t hitCount;
+    size_t missCount;
+
+    if( stringCacheOn ) {
+      CHECK( CountsString(stringList, &hitCount, &missCount, 0) );
+      if( hitStep == ANY_STEP ) {
+        CHECK( (hitCount + missCount) == (stringHits + stringMisses + 1) );
+      } else {
+        CHECK( hitCount == (stringHits + hitStep) );
+        CHECK( missCount == (stringMisses + missStep) );
+      }
+      stringHits = hitCount;
+      stringMisses = missCount;
+    }
+    if( uintCacheOn ) {
+      CHECK( CountsUint(uintList, &hitCount, &missCount, 0) );
+      if( hitStep == ANY_STEP ) {
+        CHECK( (hitCount + missCount) == (uintHits + uintMisses + 1) );
+      } else {
+        CHECK( hitCount == (uintHits + hitStep) );
+        CHECK( missCount == (uintMisses + missStep) );
+      }
+      uintHits = hitCount;
+      uintMisses = missCount;
+    }
+    return 1;
+  }
+
+  /* Reads the hit and miss counts, without checking them */
+  void ReadCounts() {
+    if( stringCacheOn ) {
+      CountsString( stringList, &stringHits, &stringMisses, 0 );
+    }
+    if( uintCacheOn ) {
+      CountsUint( uintList, &uintHits, &uintMisses, 0 );
+    }
+  }
+
+  /* Looks up a present key twice, which hits the second time, then
+     inserts a new key and looks the first up again, which misses */
+  int TestRepeat( unsigned keyId, unsigned keyRange ) {
+    unsigned newKeyId = NextRandom(&randomState) % keyRange;
+
+    if( present[keyId] == 0 ) {
+      return TestLookup(keyId);
+    }
+
+    ReadCounts();
+    CHECK( TestLookup(keyId) );
+    CHECK( CheckCounts(ANY_STEP, ANY_STEP) );
+    CHECK( TestLookup(keyId) );
+    CHECK( CheckCounts(1, 0) );
+
+    if( present[newKeyId] == 0 ) {
+      CHECK( TestInsert(newKeyId) );
+      CHECK( CheckCounts(0, 0) );
+      CHECK( TestLookup(keyId) );
+      CHECK( CheckCounts(0, 1) );
+    }
+    return 1;
+  }
+
+  /* Switches a lookup structure on or off, or resets the hit and miss
+     counts */
+  int TestToggle() {
+    int enable = (NextRandom(&randomState) % 4) != 0;
+    size_t hitCount = 1;
+    size_t missCount = 1;
+
+    switch( NextRandom(&randomState) % 5 ) {
+    case 0:
+      CHECK( CacheString(stringList, enable) );
+      if( enable && (stringCacheOn == 0) ) {
+        CHECK( CountsString(stringList, &hitCount, &missCount, 0) );
+        CHECK( (hitCount == 0) && (missCount == 0) );
+        stringHits = 0;
+        stringMisses = 0;
+      }
+      stringCacheOn = enable;
+      break;
+
+    case 1:
+      CHECK( CacheUint(uintList, enable) );
+      if( enable && (uintCacheOn == 0) ) {
+        CHECK( CountsUint(uintList, &hitCount, &missCount, 0) );
+        CHECK( (hitCount == 0) && (missCount == 0) );
+        uintHits = 0;
+        uintMisses = 0;
+      }
+      uintCacheOn = enable;
+      break;
+
+    case 2:
+      CHECK( HashString(stringList, enable) );
+      break;
+
+    case 3:
+      CHECK( IndexUint(uintList, enable) );
+      break;
+
+    default:
+      CHECK( (CountsString(stringList, NULL, NULL, 1) != 0) ==
+          stringCacheOn );
+      CHECK( (CountsUint(uintList, NULL, NULL, 1) != 0) == uintCacheOn );
+      stringHits = 0;
+      stringMisses = 0;
+      uintHits = 0;
+      uintMisses = 0;
+      CHECK( CheckCounts(0, 0) );
+      break;
+    }
+    return 1;
+  }
+
+/*
+ * Test rounds
+ */
+
+  int RunRound() {
+    unsigned keyRange = 1 + (NextRandom(&randomState) % KEY_LIMIT);
+    unsigned step;
+    unsigned keyId = 0;
+    int result = 1;
+
+    ClearModel( keyRange );
+
+    for( step = 0; result && (step < STEP_COUNT); step++ ) {
+      switch( NextRandom(&randomState) % 32 ) {
+      case 0: case 1: case 2:
+        keyId = NextRandom(&randomState) % keyRange;
+        result = TestInsert(keyId);
+        break;
+
+      case 3: case 4:
+        keyId = PickKey(keyRange);
+        result = TestRemove(keyId);
+        break;
+
+      case 5:
+        result = TestMerge(keyRange);
+        break;
+
+      case 6: case 7:
+        keyId = PickKey(keyRange);
+        result = TestRepeat(keyId, keyRange);
+        break;
+
+      case 31:
+        result = TestToggle();
+        break;
+
+      default:
+        keyId = PickKey(keyRange);
+        result = TestLookup(keyId);
+        break;
+      }
+
+      if( result && ((step % CHECK_INTERVAL) == 0) ) {
+        result = CheckLists();
+      }
+
+      if( result == 0 ) {
+        printf( "  Failed at step %u, key %u\n", step, keyId );
+      }
+    }
+
+    return result && CheckLists();
+  }
+
+/*
+ * Main program
+ */
+
+  int main( int argc, char* argv[] ) {
+    unsigned seed = 1;
+    unsigned round;
+
+    if( argc > 1 ) {
+      seed = (unsigned)strtoul(argv[1], NULL, 10);
+    }
+    randomState = seed ? seed : 1;
+
+    MakeKeyNames();
+
+    for( round = 0; round < ROUND_COUNT; round++ ) {
+      stringList = CreateString(0);
+      uintList = CreateUint(0);
+      if( !(stringList && uintList && CacheString(stringList, 1) &&
+          CacheUint(uintList, 1)) ) {
+        printf( "Error allocating lists\n" );
+        return 1;
+      }
+      stringCacheOn = 1;
+      uintCacheOn = 1;
+      stringHits = 0;
+      stringMisses = 0;
+      uintHits = 0;
+      uintMisses = 0;
+
+      if( RunRound() == 0 ) {
+        printf( "cachemodel: failed in round %u, seed %u\n", round, seed );
+        return 1;
+      }
+
+      FreeString( &stringList );
+      FreeUint( &uintList );
+    }
+
+    printf( "cachemodel: passed %u rounds, seed %u\n", ROUND_COUNT, seed );
+    return 0;
+  }
@@ -0,0 +1,656 @@
+#include <stdio.h>
+
+#include "../keyarray.h"
+#include "model.h"
+
+/*
+ *  File: tests/custommodel.c
+ *  Status: Complete
+ *
+ *  Custom Key Model Test: random operations checked against a model
+ *
+ *  Runs the same random inserts, removes, modifies, retrieves, finds,
+ *  and merges on custom key lists of composite keys, floating point
+ *  keys, and fixed size binary hashes, and checks every result against
+ *  a table of the keys that should be present. Lower bound, upper
+ *  bound, and range are probed with keys in the list, and keys between
+ *  two keys. Unused space is released along the way.
+ *
+ *  Key n is (n / 64, n % 64) in the composite list, and (n - 1500) / 4
+ *  in the floating point list, so that both hold their keys in the same
+ *  order. In the hash list, key n is HASH_SIZE bytes ordered by memcmp,
+ *  copied and freed by key hooks that count the keys they own. The key
+ *  passed to each insert is overwritten after the call, and copy hooks
+ *  fail on request, to check that a failed insert leaves the list as it
+ *  was.
+ *
+ *  Every CHECK_INTERVAL operations, and at the end of each round, each
+ *  list is walked in full, and a copy of each list is checked the same
+ *  way.
+ *
+ *  Build and run with the Makefile in this directory:
+ *    make check
+ *  or pass a seed, to repeat a run with other operations:
+ *    ./custommodel 12345
+ *
+ *  https://github.com/orlandol/keyarray
+ */
+
+/*
+ * Model declarations
+ */
+
+  #define KEY_LIMIT 3000
+  #define HASH_SIZE 16
+  #define ROUND_COUNT 24
+  #define STEP_COUNT 6000
+  #define CHECK_INTERVAL 500
+  #define BATCH_LIMIT 16
+
+  unsigned char present[KEY_LIMIT];
+  unsigned value[KEY_LIMIT];
+  size_t presentCount = 0;
+
+  /* Hash bytes of each key id, and each key id's place in memcmp order */
+  unsigned char hashKey[KEY_LIMIT][HASH_SIZE];
+  unsigned hashRank[KEY_LIMIT];
+
+  /* Hash keys held by the lists, and whether the next copy fails */
+  size_t liveKeys = 0;
+  int failCopy = 0;
+
+  /* The first 8 bytes are shared by a third of the keys each, and the
+     last 2 bytes hold the key id */
+  void MakeHashKeys() {
+    unsigned keyId;
+    unsigned mixed;
+    unsigned byteIndex;
+
+    for( keyId = 0; keyId < KEY_LIMIT; keyId++ ) {
+      mixed = keyId * 2654435761U;
+      for( byteIndex = 0; byteIndex < 8; byteIndex++ ) {
+        hashKey[keyId][byteIndex] = (unsigned char)((keyId % 3) * 0x7F);
+      }
+      hashKey[keyId][8] = (unsigned char)(mixed >> 24);
+      hashKey[keyId][9] = (unsigned char)(mixed >> 16);
+      hashKey[keyId][10] = (unsigned char)(mixed >> 8);
+      hashKey[keyId][11] = (unsigned char)mixed;
+      hashKey[keyId][12] = 0xFF;
+      hashKey[keyId][13] = 0x80;
+      hashKey[keyId][14] = (unsigned char)(keyId >> 8);
+      hashKey[keyId][15] = (unsigned char)keyId;
+    }
+  }
+
+  int CompareHashIds( const void* left, const void* right ) {
+    return memcmp(hashKey[*(const unsigned*)left],
+        hashKey[*(const unsigned*)right], HASH_SIZE);
+  }
+
+  void RankHashKeys() {
+    unsigned sortedId[KEY_LIMIT];
+    unsigned keyId;
+
+    for( keyId = 0; keyId < KEY_LIMIT; keyId++ ) {
+      sortedId[keyId] = keyId;
+    }
+    qsort( sortedId, KEY_LIMIT, sizeof(unsigned), CompareHashIds );
+    for( keyId = 0; keyId < KEY_LIMIT; keyId++ ) {
+      hashRank[sortedId[keyId]] = keyId;
+    }
+  }
+
+  void ClearModel() {
+    memset( present, 0, sizeof(present) );
+    memset( value, 0, sizeof(value) );
+    presentCount = 0;
+  }
+
+  /* Returns the number of keys in the model less than keyId */
+  size_t CountBelow( unsigned keyId ) {
+    size_t count = 0;
+    unsigned modelId;
+
+    for( modelId = 0; (modelId < keyId) && (modelId < KEY_LIMIT);
+        modelId++ ) {
+      count += present[modelId];
+    }
+    return count;
+  }
+
+  /* Returns the number of keys in the model whose hash is less than the
+     hash of keyId */
+  size_t CountHashBelow( unsigned keyId ) {
+    size_t count = 0;
+    unsigned modelId;
+
+    for( modelId = 0; modelId < KEY_LIMIT; modelId++ ) {
+      if( present[modelId] && (hashRank[modelId] < hashRank[keyId]) ) {
+        count++;
+      }
+    }
+    return count;
+  }
+
+/*
+ * List declarations
+ */
+
+  typedef struct PairKey {
+    unsigned high;
+    unsigned low;
+  } PairKey;
+
+  typedef unsigned char* HashKey;
+
+  int ComparePairKeys( PairKey leftKey, PairKey rightKey ) {
+    if( leftKey.high != rightKey.high ) {
+      return (leftKey.high < rightKey.high) ? -1 : 1;
+    }
+    return (leftKey.low > rightKey.low) - (leftKey.low < rightKey.low);
+  }
+
+  #define CompareFloatKeys( leftKey, rightKey )\
+    (((leftKey) > (rightKey)) - ((leftKey) < (rightKey)))
+
+  int CompareHashKeys( HashKey leftKey, HashKey rightKey ) {
+    return memcmp(leftKey, rightKey, HASH_SIZE);
+  }
+
+  int CopyHash( HashKey* keyCopy, HashKey key ) {
+    if( failCopy ) {
+      return 0;
+    }
+    (*keyCopy) = (HashKey)malloc(HASH_SIZE);
+    if( (*keyCopy) == NULL ) {
+      return 0;
+    }
+    memcpy( (*keyCopy), key, HASH_SIZE );
+    liveKeys++;
+    return 1;
+  }
+
+  void FreeHash( HashKey key ) {
+    if( key ) {
+      free( key );
+      liveKeys--;
+    }
+  }
+
+  int CopyValue( unsigned* dest, unsigned* source ) {
+    (*dest) = (*source);
+    return 1;
+  }
+
+  void AddValue( unsigned* existing, unsigned* incoming ) {
+    (*existing) += (*incoming);
+  }
+
+  DECLARE_CUSTOM_KEYARRAY_TYPES( PairList, PairKey, unsigned,
+      ComparePairKeys )
+  DECLARE_CUSTOM_KEYARRAY_CREATE( CreatePair, PairList )
+  DECLARE_CUSTOM_KEYARRAY_FREE( FreePair, PairList, FreeNothing )
+  DECLARE_CUSTOM_KEYARRAY_INSERT( InsertPair, PairList, unsigned )
+  DECLARE_CUSTOM_KEYARRAY_REMOVE( RemovePair, PairList, FreeNothing )
+  DECLARE_CUSTOM_KEYARRAY_RETRIEVE( RetrievePair, PairList, unsigned )
+  DECLARE_CUSTOM_KEYARRAY_MODIFY( ModifyPair, PairList, unsigned )
+  DECLARE_CUSTOM_KEYARRAY_FINDINDEX( FindPairInt, PairList )
+  DECLARE_CUSTOM_KEYARRAY_FINDINDEX_SIZE( FindPair, PairList )
+  DECLARE_CUSTOM_KEYARRAY_LOWERBOUND( LowerBoundPair, PairList )
+  DECLARE_CUSTOM_KEYARRAY_UPPERBOUND( UpperBoundPair, PairList )
+  DECLARE_CUSTOM_KEYARRAY_RANGE( RangePair, PairList )
+  DECLARE_CUSTOM_KEYARRAY_MERGEBATCH( MergePair, PairList, unsigned,
+      AddValue, FreeNothing )
+  DECLARE_CUSTOM_KEYARRAY_RELEASEUNUSED( ReleasePair, PairList )
+  DECLARE_CUSTOM_KEYARRAY_COPY( CopyPair, PairList, unsigned,
+      CopyValue, FreeNothing )
+
+  DECLARE_CUSTOM_KEYARRAY_TYPES( FloatList, double, unsigned,
+      CompareFloatKeys )
+  DECLARE_CUSTOM_KEYARRAY_CREATE( CreateFloat, FloatList )
+  DECLARE_CUSTOM_KEYARRAY_FREE( FreeFloat, FloatList, FreeNothing )
+  DECLARE_CUSTOM_KEYARRAY_INSERT( InsertFloat, FloatList, unsigned )
+  DECLARE_CUSTOM_KEYARRAY_REMOVE( RemoveFloat, FloatList, FreeNothing )
+  DECLARE_CUSTOM_KEYARRAY_RETRIEVE( RetrieveFloat, FloatList, unsigned )
+  DECLARE_CUSTOM_KEYARRAY_MODIFY( ModifyFloat, FloatList, unsigned )
+  DECLARE_CUSTOM_KEYARRAY_FINDINDEX_SIZE( FindFloat, FloatList )
+  DECLARE_CUSTOM_KEYARRAY_LOWERBOUND( LowerBoundFloat, FloatList )
+  DECLARE_CUSTOM_KEYARRAY_UPPERBOUND( UpperBoundFloat, FloatList )
+  DECLARE_CUSTOM_KEYARRAY_MERGEBATCH( MergeFloat, FloatList, unsigned,
+      AddValue, FreeNothing )
+  DECLARE_CUSTOM_KEYARRAY_RELEASEUNUSED( ReleaseFloat, FloatList )
+  DECLARE_CUSTOM_KEYARRAY_COPY( CopyFloat, FloatList, unsigned,
+      CopyValue, FreeNothing )
+
+  DECLARE_CUSTOM_KEYARRAY_TYPES_HOOKS( HashList, HashKey, unsigned,
+      CompareHashKeys, CopyHash, FreeHash )
+  DECLARE_CUSTOM_KEYARRAY_CREATE( CreateHash, HashList )
+  DECLARE_CUSTOM_KEYARRAY_FREE( FreeHashList, HashList, FreeNothing )
+  DECLARE_CUSTOM_KEYARRAY_INSERT( InsertHash, HashList, unsigned )
+  DECLARE_CUSTOM_KEYARRAY_REMOVE( RemoveHash, HashList, FreeNothing )
+  DECLARE_CUSTOM_KEYARRAY_RETRIEVE( RetrieveHash, HashList, unsigned )
+  DECLARE_CUSTOM_KEYARRAY_MODIFY( ModifyHash, HashList, unsigned )
+  DECLARE_CUSTOM_KEYARRAY_FINDINDEX_SIZE( FindHash, HashList )
+  DECLARE_CUSTOM_KEYARRAY_LOWERBOUND( LowerBoundHash, HashList )
+  DECLARE_CUSTOM_KEYARRAY_UPPERBOUND( UpperBoundHash, HashList )
+  DECLARE_CUSTOM_KEYARRAY_MERGEBATCH( MergeHash, HashList, unsigned,
+      AddValue, FreeNothing )
+  DECLARE_CUSTOM_KEYARRAY_RELEASEUNUSED( ReleaseHash, HashList )
+  DECLARE_CUSTOM_KEYARRAY_COPY( CopyHashList, HashList, unsigned,
+      CopyValue, FreeNothing )
+
+  PairList* pairList = NULL;
+  FloatList* floatList = NULL;
+  HashList* hashList = NULL;
+
+  PairKey MakePairKey( unsigned keyId ) {
+    PairKey key;
+
+    key.high = keyId / 64;
+    key.low = keyId % 64;
+    return key;
+  }
+
+  double FloatKey( unsigned keyId ) {
+    return ((double)keyId - 1500.0) / 4.0;
+  }
+
+/*
+ * List checks
+ */
+
+  /* Checks one item, in list order, against the model */
+  int CheckItem( size_t index, unsigned previousKeyId, unsigned keyId,
+      unsigned data ) {
+    CHECK( keyId < KEY_LIMIT );
+    CHECK( present[keyId] );
+    CHECK( data == value[keyId] );
+    if( index ) {
+      CHECK( previousKeyId < keyId );
+    }
+    return 1;
+  }
+
+  /* Walks each list in full. Keys are in strictly increasing order, and
+     as many as in the model, so each list holds exactly the model's
+     keys. */
+  int CheckPair( PairList* keyList ) {
+    unsigned keyId = 0;
+    unsigned previousKeyId = 0;
+    size_t index;
+
+    CHECK( keyList->itemCount == presentCount );
+    for( index = 0; index < keyList->itemCount; index++ ) {
+      CHECK( keyList->item[index].key.low < 64 );
+      keyId = (keyList->item[index].key.high * 64) +
+          keyList->item[index].key.low;
+      CHECK( CheckItem(index, previousKeyId, keyId,
+          keyList->item[index].data) );
+      CHECK( FindPair(keyList, keyList->item[index].key) == index );
+      previousKeyId = keyId;
+    }
+    return 1;
+  }
+
+  int CheckFloat( FloatList* keyList ) {
+    unsigned keyId = 0;
+    unsigned previousKeyId = 0;
+    size_t index;
+
+    CHECK( keyList->itemCount == presentCount );
+    for( index = 0; index < keyList->itemCount; index++ ) {
+      keyId = (unsigned)((keyList->item[index].key * 4.0) + 1500.0);
+      CHECK( keyList->item[index].key == FloatKey(keyId) );
+      CHECK( CheckItem(index, previousKeyId, keyId,
+          keyList->item[index].data) );
+      CHECK( FindFloat(keyList, keyList->item[index].key) == index );
+      previousKeyId = keyId;
+    }
+    return 1;
+  }
+
+  /* Hash keys are in memcmp order, so their ranks are increasing */
+  int CheckHash( HashList* keyList ) {
+    unsigned keyId = 0;
+    unsigned previousKeyId = 0;
+    size_t index;
+
+    CHECK( keyList->itemCount == presentCount );
+    for( index = 0; index < keyList->itemCount; index++ ) {
+      keyId = (keyList->item[index].key[14] << 8) |
+          keyList->item[index].key[15];
+      CHECK( keyId < KEY_LIMIT );
+      CHECK( keyList->item[index].key != hashKey[keyId] );
+      CHECK( memcmp(keyList->item[index].key, hashKey[keyId],
+          HASH_SIZE) == 0 );
+      CHECK( present[keyId] );
+      CHECK( keyList->item[index].data == value[keyId] );
+      if( index ) {
+        CHECK( hashRank[previousKeyId] < hashRank[keyId] );
+      }
+      CHECK( FindHash(keyList, keyList->item[index].key) == index );
+      previousKeyId = keyId;
+    }
+    return 1;
+  }
+
+  /* Checks each list, and a copy of each list. The hash keys of the copy
+     are counted, and freed with it. */
+  int CheckLists() {
+    PairList* pairCopy = NULL;
+    FloatList* floatCopy = NULL;
+    HashList* hashCopy = NULL;
+    int result;
+
+    CHECK( CheckPair(pairList) );
+    CHECK( CheckFloat(floatList) );
+    CHECK( CheckHash(hashList) );
+    CHECK( liveKeys == presentCount );
+
+    pairCopy = CopyPair(pairList);
+    floatCopy = CopyFloat(floatList);
+    hashCopy = CopyHashList(hashList);
+    result = pairCopy && floatCopy && hashCopy &&
+        CheckPair(pairCopy) && CheckFloat(floatCopy) &&
+        CheckHash(hashCopy) && (liveKeys == (presentCount * 2));
+
+    FreePair( &pairCopy );
+    FreeFloat( &floatCopy );
+    FreeHashList( &hashCopy );
+
+    CHECK( result );
+    CHECK( liveKeys == presentCount );
+    return 1;
+  }
+
+/*
+ * Operations
+ */
+
+  /* The hash key is passed from a buffer that is overwritten after the
+     call, so the list must hold its own copy */
+  int TestInsert( unsigned keyId ) {
+    unsigned char key[HASH_SIZE];
+    unsigned data = NextRandom(&randomState);
+    int expected = (present[keyId] == 0);
+
+    CHECK( (InsertPair(pairList, MakePairKey(keyId), &data) != 0) ==
+        expected );
+    CHECK( (InsertFloat(floatList, FloatKey(keyId), &data) != 0) ==
+        expected );
+
+    memcpy( key, hashKey[keyId], HASH_SIZE );
+    CHECK( (InsertHash(hashList, key, &data) != 0) == expected );
+    memset( key, 0xA5, HASH_SIZE );
+
+    if( expected ) {
+      present[keyId] = 1;
+      value[keyId] = data;
+      presentCount++;
+    }
+    return 1;
+  }
+
+  /* Inserts into the hash list with the copy hook failing, which fails
+     the insert of a new key */
+  int TestCopyFail( unsigned keyId ) {
+    unsigned data = NextRandom(&randomState);
+    int result;
+
+    failCopy = 1;
+    result = InsertHash(hashList, hashKey[keyId], &data);
+    failCopy = 0;
+
+    CHECK( result == 0 );
+    CHECK( (FindHash(hashList, hashKey[keyId]) != (size_t)-1) ==
+        present[keyId] );
+    CHECK( liveKeys == presentCount );
+    return 1;
+  }
+
+  int TestRemove( unsigned keyId ) {
+    RemovePair( pairList, MakePairKey(keyId) );
+    RemoveFloat( floatList, FloatKey(keyId) );
+    RemoveHash( hashList, hashKey[keyId] );
+
+    if( present[keyId] ) {
+      present[keyId] = 0;
+      presentCount--;
+    }
+    CHECK( liveKeys == presentCount );
+    return 1;
+  }
+
+  int TestModify( unsigned keyId ) {
+    unsigned data = NextRandom(&randomState);
+    int expected = present[keyId];
+
+    CHECK( (ModifyPair(pairList, MakePairKey(keyId), &data) != 0) ==
+        expected );
+    CHECK( (ModifyFloat(floatList, FloatKey(keyId), &data) != 0) ==
+        expected );
+    CHECK( (ModifyHash(hashList, hashKey[keyId], &data) != 0) ==
+        expected );
+
+    if( expected ) {
+      value[keyId] = data;
+    }
+    return 1;
+  }
+
+  int TestRetrieve( unsigned keyId ) {
+    int expected = present[keyId];
+    size_t index = expected ? CountBelow(keyId) : (size_t)-1;
+    size_t hashIndex = expected ? CountHashBelow(keyId) : (size_t)-1;
+    unsigned data;
+
+    data = ~value[keyId];
+    CHECK( (RetrievePair(pairList, MakePairKey(keyId), &data) != 0) ==
+        expected );
+    CHECK( (expected == 0) || (data == value[keyId]) );
+
+    data = ~value[keyId];
+    CHECK( (RetrieveFloat(floatList, FloatKey(keyId), &data) != 0) ==
+        expected );
+    CHECK( (expected == 0) || (data == value[keyId]) );
+
+    data = ~value[keyId];
+    CHECK( (RetrieveHash(hashList, hashKey[keyId], &data) != 0) ==
+        expected );
+    CHECK( (expected == 0) || (data == value[keyId]) );
+
+    CHECK( FindPair(pairList, MakePairKey(keyId)) == index );
+    CHECK( FindPairInt(pairList, MakePairKey(keyId)) ==
+        (expected ? (int)index : -1) );
+    CHECK( FindFloat(floatList, FloatKey(keyId)) == index );
+    CHECK( FindHash(hashList, hashKey[keyId]) == hashIndex );
+    return 1;
+  }
+
+  /* Probes the bounds of key keyId in each list, and of a key between
+     two keys: (n / 64, 64) comes after every key with the same high
+     part, and (n - 1500) / 4 - 1/8 comes just before key n */
+  int TestBounds( unsigned keyId ) {
+    size_t below = CountBelow(keyId);
+    size_t above = below + present[keyId];
+    size_t hashBelow = CountHashBelow(keyId);
+    unsigned lastId = NextRandom(&randomState) % KEY_LIMIT;
+    size_t rangeCount = 0;
+    size_t beginIndex;
+    PairKey pairKey = MakePairKey(keyId);
+
+    CHECK( LowerBoundPair(pairList, pairKey) == below );
+    CHECK( UpperBoundPair(pairList, pairKey) == above );
+    CHECK( LowerBoundFloat(floatList, FloatKey(keyId)) == below );
+    CHECK( UpperBoundFloat(floatList, FloatKey(keyId)) == above );
+    CHECK( LowerBoundHash(hashList, hashKey[keyId]) == hashBelow );
+    CHECK( UpperBoundHash(hashList, hashKey[keyId]) ==
+        (hashBelow + present[keyId]) );
+
+    CHECK( LowerBoundFloat(floatList, FloatKey(keyId) - 0.125) == below );
+    CHECK( UpperBoundFloat(floatList, FloatKey(keyId) - 0.125) == below );
+
+    pairKey.low = 64;
+    CHECK( LowerBoundPair(pairList, pairKey) ==
+        CountBelow((pairKey.high + 1) * 64) );
+    CHECK( UpperBoundPair(pairList, pairKey) ==
+        CountBelow((pairKey.high + 1) * 64) );
+
+    /* Range from keyId through lastId */
+    if( lastId >= keyId ) {
+      rangeCount = CountBelow(lastId + 1) - below;
+    }
+
+    beginIndex = (size_t)-1;
+    CHECK( RangePair(pairList, MakePairKey(keyId), MakePairKey(lastId),
+        &beginIndex) == rangeCount );
+    CHECK( (rangeCount == 0) || (beginIndex == below) );
+    return 1;
+  }
+
+  /* Merges a batch of random keys, some present, some repeated, into
+     each list. Resolved data is added to the data in the list, and new
+     hash keys are copied. */
+  int TestMerge( unsigned keyRange ) {
+    PairListItem pairBatch[BATCH_LIMIT];
+    FloatListItem floatBatch[BATCH_LIMIT];
+    HashListItem hashBatch[BATCH_LIMIT];
+    size_t batchCount = NextRandom(&randomState) % BATCH_LIMIT;
+    size_t batchIndex;
+    unsigned keyId;
+    unsigned data;
+
+    for( batchIndex = 0; batchIndex < batchCount; batchIndex++ ) {
+      keyId = NextRandom(&randomState) % keyRange;
+      data = NextRandom(&randomState);
+
+      pairBatch[batchIndex].key = MakePairKey(keyId);
+      pairBatch[batchIndex].data = data;
+      floatBatch[batchIndex].key = FloatKey(keyId);
+      floatBatch[batchIndex].data = data;
+      hashBatch[batchIndex].key = hashKey[keyId];
+      hashBatch[batchIndex].data = data;
+
+      if( present[keyId] ) {
+        value[keyId] += data;
+      } else {
+        present[keyId] = 1;
+        value[keyId] = data;
+        presentCount++;
+      }
+    }
+
+    CHECK( MergePair(pairList, pairBatch, batchCount) );
+    CHECK( MergeFloat(floatList, floatBatch, batchCount) );
+    CHECK( MergeHash(hashList, hashBatch, batchCount) );
+    CHECK( liveKeys == presentCount );
+    return 1;
+  }
+
+/*
+ * Test rounds
+ */
+
+  int RunRound() {
+    unsigned keyRange = 1 + (NextRandom(&randomState) % KEY_LIMIT);
+    unsigned step;
+    unsigned keyId;
+    int result = 1;
+
+    for( step = 0; result && (step < STEP_COUNT); step++ ) {
+      keyId = NextRandom(&randomState) % keyRange;
+
+      switch( NextRandom(&randomState) % 16 ) {
+      case 0: case 1: case 2: case 3: case 4:
+        result = TestInsert(keyId);
+        break;
+
+      case 5: case 6: case 7:
+        result = TestRemove(keyId);
+        break;
+
+      case 8:
+        result = TestModify(keyId);
+        break;
+
+      case 9: case 10:
+        result = TestBounds(keyId);
+        break;
+
+      case 11:
+        result = TestMerge(keyRange);
+        break;
+
+      case 12:
+        result = TestCopyFail(keyId);
+        break;
+
+      case 15:
+        ReleasePair( pairList );
+        ReleaseFloat( floatList );
+        ReleaseHash( hashList );
+        break;
+
+      default:
+        result = TestRetrieve(keyId);
+        break;
+      }
+
+      if( result && ((step % CHECK_INTERVAL) == 0) ) {
+        result = CheckLists();
+      }
+
+      if( result == 0 ) {
+        printf( "  Failed at step %u, key %u\n", step, keyId );
+      }
+    }
+
+    return result && CheckLists();
+  }
+
+/*
+ * Main program
+ */
+
+  int main( int argc, char* argv[] ) {
+    unsigned seed = 1;
+    unsigned round;
+
+    if( argc > 1 ) {
+      seed = (unsigned)strtoul(argv[1], NULL, 10);
+    }
+    randomState = seed ? seed : 1;
+
+    MakeHashKeys();
+    RankHashKeys();
+
+    for( round = 0; round < ROUND_COUNT; round++ ) {
+      ClearModel();
+      pairList = CreatePair(NextRandom(&randomState) % 64);
+      floatList = CreateFloat(NextRandom(&randomState) % 64);
+      hashList = CreateHash(NextRandom(&randomState) % 64);
+      if( !(pairList && floatList && hashList) ) {
+        printf( "Error allocating lists\n" );
+        return 1;
+      }
+
+      if( RunRound() == 0 ) {
+        printf( "custommodel: failed in round %u, seed %u\n", round,
+            seed );
+        return 1;
+      }
+
+      FreePair( &pairList );
+      FreeFloat( &floatList );
+      FreeHashList( &hashList );
+      if( liveKeys ) {
+        printf( "custommodel: %u hash keys not freed, seed %u\n",
+            (unsigned)liveKeys, seed );
+        return 1;
+      }
+    }
+
+    printf( "custommodel: passed %u rounds, seed %u\n", ROUND_COUNT,
+        seed );
+    return 0;
+  }
@@ -0,0 +1,642 @@
+/* Declares fsync and truncate, with -std=c99 */
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+
+/* Declares the write-ahead log */
+#define KEYARRAY_LOGGED
+
+#include "../keyarray.h"
+#include "model.h"
+
+/*
+ *  File: tests/logmodel.c
+ *  Status: Complete
+ *
+ *  Write-Ahead Log Model Test: logged changes replayed and checked
+ *
+ *  Runs random logged inserts, removes, and modifies on a string list
+ *  and an unsigned list, checkpointing each log once along the way,
+ *  and checks every result against a table of the keys that should be
+ *  present. Then replays each log onto the keys present at the
+ *  checkpoint, and checks that the list matches the model.
+ *
+ *  Then cuts copies of each log short at random bytes, as a crash in
+ *  the middle of a write would, and corrupts single bytes. Replay must
+ *  apply exactly the records before the first torn one, cut the file
+ *  back to them, and leave a log that later records append to.
+ *
+ *  Logs are written to the current directory, and removed when the
+ *  test passes.
+ *
+ *  Build and run with the Makefile in this directory:
+ *    make check
+ *  or pass a seed, to repeat a run with other operations:
+ *    ./logmodel 12345
+ *
+ *  https://github.com/orlandol/keyarray
+ */
+
+/*
+ * Model declarations
+ */
+
+  #define KEY_LIMIT 2000
+  #define KEY_SIZE 16
+  #define ROUND_COUNT 24
+  #define STEP_COUNT 4000
+  #define TORN_COUNT 24
+
+  #define STRING_LOG "logmodel-string.log"
+  #define UINT_LOG "logmodel-uint.log"
+  #define TORN_LOG "logmodel-torn.log"
+
+  char keyName[KEY_LIMIT][KEY_SIZE];
+  unsigned char present[KEY_LIMIT];
+  unsigned value[KEY_LIMIT];
+  size_t presentCount = 0;
+
+  /* The model at the last checkpoint, which replay starts from */
+  unsigned char checkpointPresent[KEY_LIMIT];
+  unsigned checkpointValue[KEY_LIMIT];
+
+  /* The changes logged since the last checkpoint, and where each one's
+     record ends in each log */
+  typedef struct LogChange {
+    uint32_t operation;
+    unsigned keyId;
+    unsigned data;
+    long stringEnd;
+    long uintEnd;
+  } LogChange;
+
+  LogChange change[STEP_COUNT];
+  size_t changeCount = 0;
+  long stringLogSize = 0;
+  long uintLogSize = 0;
+
+  void MakeKeyNames() {
+    unsigned keyId;
+
+    for( keyId = 0; keyId < KEY_LIMIT; keyId++ ) {
+      sprintf( keyName[keyId], "log-%05u", keyId );
+    }
+  }
+
+  unsigned KeyIdOf( const char* key ) {
+    return (unsigned)strtoul(key + 4, NULL, 10);
+  }
+
+  void ClearModel() {
+    memset( present, 0, sizeof(present) );
+    memset( value, 0, sizeof(value) );
+    presentCount = 0;
+  }
+
+  /* Sets the model to the checkpoint, plus the first count changes */
+  void ApplyChanges( size_t count ) {
+    size_t index;
+    unsigned keyId;
+
+    memcpy( present, checkpointPresent, sizeof(present) );
+    memcpy( value, checkpointValue, sizeof(value) );
+
+    for( index = 0; index < count; index++ ) {
+      keyId = change[index].keyId;
+      if( change[index].operation == KEYARRAY_LOG_REMOVE ) {
+        present[keyId] = 0;
+      } else {
+        present[keyId] = 1;
+        value[keyId] = change[index].data;
+      }
+    }
+
+    presentCount = 0;
+    for( keyId = 0; keyId < KEY_LIMIT; keyId++ ) {
+      presentCount += present[keyId];
+    }
+  }
+
+  /* Returns the size of fileName, or -1 if it cannot be read */
+  long FileSize( const char* fileName ) {
+    FILE* file = fopen(fileName, "rb");
+    long size = -1;
+
+    if( file ) {
+      if( fseek(file, 0, SEEK_END) == 0 ) {
+        size = ftell(file);
+      }
+      fclose( file );
+    }
+    return size;
+  }
+
+/*
+ * List declarations
+ */
+
+  DECLARE_STRING_KEYARRAY_TYPES( StringList, unsigned )
+  DECLARE_STRING_KEYARRAY_CREATE( CreateString, StringList )
+  DECLARE_STRING_KEYARRAY_FREE( FreeString, StringList, FreeNothing )
+  DECLARE_STRING_KEYARRAY_INSERT( InsertString, StringList, unsigned )
+  DECLARE_STRING_KEYARRAY_RETRIEVE( RetrieveString, StringList,
+      unsigned )
+  DECLARE_STRING_KEYARRAY_LOGOPEN( OpenStringLog, StringList, unsigned )
+  DECLARE_STRING_KEYARRAY_INSERT_LOGGED( InsertStringLogged, StringList,
+      unsigned )
+  DECLARE_STRING_KEYARRAY_REMOVE_LOGGED( RemoveStringLogged, StringList,
+      FreeNothing )
+  DECLARE_STRING_KEYARRAY_MODIFY_LOGGED( ModifyStringLogged, StringList,
+      unsigned )
+  DECLARE_STRING_KEYARRAY_REPLAY( ReplayString, StringList, unsigned,
+      FreeNothing )
+
+  DECLARE_UINT_KEYARRAY_TYPES( UintList, unsigned )
+  DECLARE_UINT_KEYARRAY_CREATE( CreateUint, UintList )
+  DECLARE_UINT_KEYARRAY_FREE( FreeUint, UintList, FreeNothing )
+  DECLARE_UINT_KEYARRAY_INSERT( InsertUint, UintList, unsigned )
+  DECLARE_UINT_KEYARRAY_RETRIEVE( RetrieveUint, UintList, unsigned )
+  DECLARE_UINT_KEYARRAY_LOGOPEN( OpenUintLog, UintList, unsigned )
+  DECLARE_UINT_KEYARRAY_INSERT_LOGGED( InsertUintLogged, UintList,
+      unsigned )
+  DECLARE_UINT_KEYARRAY_REMOVE_LOGGED( RemoveUintLogged, UintList,
+      FreeNothing )
+  DECLARE_UINT_KEYARRAY_MODIFY_LOGGED( ModifyUintLogged, UintList,
+      unsigned )
+  DECLARE_UINT_KEYARRAY_REPLAY( ReplayUint, UintList, unsigned,
+      FreeNothing )
+
+/*
+ * List checks
+ */
+
+  int CheckString( StringList* list ) {
+    size_t index;
+    unsigned keyId;
+
+    CHECK( list->itemCount == presentCount );
+    for( index = 0; index < list->itemCount; index++ ) {
+      keyId = KeyIdOf(list->item[index].key);
+      CHECK( keyId < KEY_LIMIT );
+      CHECK( strcmp(list->item[index].key, keyName[keyId]) == 0 );
+      CHECK( present[keyId] );
+      CHECK( list->item[index].data == value[keyId] );
+      CHECK( (index == 0) ||
+          (strcmp(list->item[index - 1].key, list->item[index].key) < 0) );
+    }
+    return 1;
+  }
+
+  int CheckUint( UintList* list ) {
+    size_t index;
+    unsigned keyId;
+
+    CHECK( list->itemCount == presentCount );
+    for( index = 0; index < list->itemCount; index++ ) {
+      keyId = list->item[index].key;
+      CHECK( keyId < KEY_LIMIT );
+      CHECK( present[keyId] );
+      CHECK( list->item[index].data == value[keyId] );
+      CHECK( (index == 0) || (list->item[index - 1].key < keyId) );
+    }
+    return 1;
+  }
+
+  /* Creates lists holding the keys present at the checkpoint, without
+     logging them */
+  StringList* CheckpointString() {
+    StringList* list = CreateString(KEY_LIMIT);
+    unsigned keyId;
+
+    for( keyId = 0; list && (keyId < KEY_LIMIT); keyId++ ) {
+      if( checkpointPresent[keyId] && (InsertString(list, keyName[keyId],
+          &(checkpointValue[keyId])) == 0) ) {
+        FreeString( &list );
+      }
+    }
+    return list;
+  }
+
+  UintList* CheckpointUint() {
+    UintList* list = CreateUint(KEY_LIMIT);
+    unsigned keyId;
+
+    for( keyId = 0; list && (keyId < KEY_LIMIT); keyId++ ) {
+      if( checkpointPresent[keyId] && (InsertUint(list, keyId,
+          &(checkpointValue[keyId])) == 0) ) {
+        FreeUint( &list );
+      }
+    }
+    return list;
+  }
+
+/*
+ * Logged operations
+ */
+
+  StringList* stringList = NULL;
+  UintList* uintList = NULL;
+  KeyArrayLog* stringLog = NULL;
+  KeyArrayLog* uintLog = NULL;
+
+  /* Adds a change that both lists logged, and the size of its records */
+  void AddChange( uint32_t operation, unsigned keyId, unsigned data ) {
+    long dataSize = (operation == KEYARRAY_LOG_REMOVE) ? 0 :
+        (long)sizeof(unsigned);
+
+    stringLogSize += (long)(sizeof(KeyArrayLogRecord) +
+        strlen(keyName[keyId])) + dataSize;
+    uintLogSize += (long)(sizeof(KeyArrayLogRecord) + sizeof(unsigned)) +
+        dataSize;
+
+    change[changeCount].operation = operation;
+    change[changeCount].keyId = keyId;
+    change[changeCount].data = data;
+    change[changeCount].stringEnd = stringLogSize;
+    change[changeCount].uintEnd = uintLogSize;
+    changeCount++;
+  }
+
+  /* Empties both logs, and makes the model the new checkpoint */
+  int Checkpoint() {
+    CHECK( KeyArrayLogCheckpoint(stringLog) );
+    CHECK( KeyArrayLogCheckpoint(uintLog) );
+    CHECK( FileSize(STRING_LOG) == (long)sizeof(KeyArrayLogHeader) );
+    CHECK( FileSize(UINT_LOG) == (long)sizeof(KeyArrayLogHeader) );
+
+    memcpy( checkpointPresent, present, sizeof(present) );
+    memcpy( checkpointValue, value, sizeof(value) );
+    changeCount = 0;
+    stringLogSize = (long)sizeof(KeyArrayLogHeader);
+    uintLogSize = (long)sizeof(KeyArrayLogHeader);
+    return 1;
+  }
+
+  /* Changes both lists, and the model, as one random logged operation.
+     Changes that leave a list as it was must not be logged. */
+  int TestLogged( unsigned keyId ) {
+    unsigned data = NextRandom(&randomState);
+    unsigned found;
+    int expected;
+
+    switch( NextRandom(&randomState) % 4 ) {
+    case 0:
+      expected = (present[keyId] == 0);
+      CHECK( (InsertStringLogged(stringList, stringLog, keyName[keyId],
+          &data) != 0) == expected );
+      CHECK( (InsertUintLogged(uintList, uintLog, keyId, &data) != 0) ==
+          expected );
+      if( expected ) {
+        present[keyId] = 1;
+        value[keyId] = data;
+        presentCount++;
+        AddChange( KEYARRAY_LOG_INSERT, keyId, data );
+      }
+      break;
+
+    case 1:
+      expected = present[keyId];
+      CHECK( (RemoveStringLogged(stringList, stringLog,
+          keyName[keyId]) != 0) == expected );
+      CHECK( (RemoveUintLogged(uintList, uintLog, keyId) != 0) ==
+          expected );
+      if( expected ) {
+        present[keyId] = 0;
+        presentCount--;
+        AddChange( KEYARRAY_LOG_REMOVE, keyId, 0 );
+      }
+      break;
+
+    case 2:
+      expected = present[keyId];
+      CHECK( (ModifyStringLogged(stringList, stringLog, keyName[keyId],
+          &data) != 0) == expected );
+      CHECK( (ModifyUintLogged(uintList, uintLog, keyId, &data) != 0) ==
+          expected );
+      if( expected ) {
+        value[keyId] = data;
+        AddChange( KEYARRAY_LOG_MODIFY, keyId, data );
+      }
+      break;
+
+    default:
+      expected = present[keyId];
+      found = ~value[keyId];
+      CHECK( (RetrieveString(stringList, keyName[keyId], &found) != 0) ==
+          expected );
+      CHECK( (expected == 0) || (found == value[keyId]) );
+      found = ~value[keyId];
+      CHECK( (RetrieveUint(uintList, keyId, &found) != 0) == expected );
+      CHECK( (expected == 0) || (found == value[keyId]) );
+      break;
+    }
+    return 1;
+  }
+
+/*
+ * Replay checks
+ */
+
+  /* Copies the first size bytes of fileName to TORN_LOG, then xors the
+     byte at flipOffset, if it is within them */
+  int WriteTornLog( const char* fileName, long size, long flipOffset ) {
+    static unsigned char buffer[1 << 20];
+    FILE* file;
+    size_t readSize;
+
+    file = fopen(fileName, "rb");
+    CHECK( file != NULL );
+    readSize = fread(buffer, 1, sizeof(buffer), file);
+    fclose( file );
+    CHECK( (long)readSize >= size );
+
+    if( (flipOffset >= 0) && (flipOffset < size) ) {
+      buffer[flipOffset] ^= 0x5A;
+    }
+
+    file = fopen(TORN_LOG, "wb");
+    CHECK( file != NULL );
+    CHECK( fwrite(buffer, 1, (size_t)size, file) == (size_t)size );
+    CHECK( fclose(file) == 0 );
+    return 1;
+  }
+
+  /* Returns how many changes end at or before size bytes */
+  size_t WholeChanges( long size, int stringKind ) {
+    size_t count = 0;
+
+    while( (count < changeCount) && ((stringKind ?
+        change[count].stringEnd : change[count].uintEnd) <= size) ) {
+      count++;
+    }
+    return count;
+  }
+
+  /* Replays a torn copy of the string log, and checks that exactly the
+     whole records before the tear were applied, and kept. Then logs one
+     more change to the torn log, and checks that it replays after
+     them. */
+  int TestTornString( long size, long flipOffset ) {
+    StringList* list = NULL;
+    KeyArrayLog* log = NULL;
+    unsigned keyId = NextRandom(&randomState) % KEY_LIMIT;
+    unsigned data = NextRandom(&randomState);
+    size_t wholeCount;
+    long keptSize;
+
+    /* A flipped byte tears the record holding it */
+    if( (flipOffset >= 0) && (flipOffset < size) ) {
+      size = flipOffset;
+    }
+    wholeCount = WholeChanges(size, 1);
+    keptSize = wholeCount ? change[wholeCount - 1].stringEnd :
+        (long)sizeof(KeyArrayLogHeader);
+    if( size < (long)sizeof(KeyArrayLogHeader) ) {
+      keptSize = 0;
+    }
+
+    list = CheckpointString();
+    CHECK( list != NULL );
+    CHECK( ReplayString(list, TORN_LOG) );
+    ApplyChanges( wholeCount );
+    CHECK( CheckString(list) );
+    CHECK( FileSize(TORN_LOG) == keptSize );
+
+    log = OpenStringLog(TORN_LOG, KEYARRAY_LOG_SYNC_NONE, 0);
+    CHECK( log != NULL );
+    if( present[keyId] ) {
+      CHECK( RemoveStringLogged(list, log, keyName[keyId]) );
+      present[keyId] = 0;
+      presentCount--;
+    } else {
+      CHECK( InsertStringLogged(list, log, keyName[keyId], &data) );
+      present[keyId] = 1;
+      value[keyId] = data;
+      presentCount++;
+    }
+    CHECK( KeyArrayLogClose(&log) );
+    FreeString( &list );
+
+    list = CheckpointString();
+    CHECK( list != NULL );
+    CHECK( ReplayString(list, TORN_LOG) );
+    CHECK( CheckString(list) );
+    FreeString( &list );
+    return 1;
+  }
+
+  int TestTornUint( long size, long flipOffset ) {
+    UintList* list = NULL;
+    KeyArrayLog* log = NULL;
+    unsigned keyId = NextRandom(&randomState) % KEY_LIMIT;
+    unsigned data = NextRandom(&randomState);
+    size_t wholeCount;
+    long keptSize;
+
+    if( (flipOffset >= 0) && (flipOffset < size) ) {
+      size = flipOffset;
+    }
+    wholeCount = WholeChanges(size, 0);
+    keptSize = wholeCount ? change[wholeCount - 1].uintEnd :
+        (long)sizeof(KeyArrayLogHeader);
+    if( size < (long)sizeof(KeyArrayLogHeader) ) {
+      keptSize = 0;
+    }
+
+    list = CheckpointUint();
+    CHECK( list != NULL );
+    CHECK( ReplayUint(list, TORN_LOG) );
+    ApplyChanges( wholeCount );
+    CHECK( CheckUint(list) );
+    CHECK( FileSize(TORN_LOG) == keptSize );
+
+    log = OpenUintLog(TORN_LOG, KEYARRAY_LOG_SYNC_NONE, 0);
+    CHECK( log != NULL );
+    if( present[keyId] ) {
+      CHECK( RemoveUintLogged(list, log, keyId) );
+      present[keyId] = 0;
+      presentCount--;
+    } else {
+      CHECK( InsertUintLogged(list, log, keyId, &data) );
+      present[keyId] = 1;
+      value[keyId] = data;
+      presentCount++;
+    }
+    CHECK( KeyArrayLogClose(&log) );
+    FreeUint( &list );
+
+    list = CheckpointUint();
+    CHECK( list != NULL );
+    CHECK( ReplayUint(list, TORN_LOG) );
+    CHECK( CheckUint(list) );
+    FreeUint( &list );
+    return 1;
+  }
+
+  /* Picks a tear: at the end, within the header, within the last few
+     records, or anywhere. Every other tear also flips a byte of a
+     record, as a flipped header is a log of another list type. */
+  long TornSize( long logSize, size_t tornIndex ) {
+    long lastSize;
+
+    switch( tornIndex % 4 ) {
+    case 0:
+      return logSize - (long)(tornIndex / 4);
+
+    case 1:
+      return (long)(NextRandom(&randomState) % sizeof(KeyArrayLogHeader));
+
+    case 2:
+      lastSize = 4 * (long)(sizeof(KeyArrayLogRecord) + KEY_SIZE);
+      if( lastSize > logSize ) {
+        lastSize = logSize;
+      }
+      return logSize - (long)(NextRandom(&randomState) % lastSize);
+
+    default:
+      return (long)(NextRandom(&randomState) % (logSize + 1));
+    }
+  }
+
+  int TestReplay() {
+    long size;
+    long flipOffset;
+    size_t tornIndex;
+
+    /* Every logged change replays onto the checkpoint */
+    CHECK( FileSize(STRING_LOG) == stringLogSize );
+    CHECK( FileSize(UINT_LOG) == uintLogSize );
+
+    stringList = CheckpointString();
+    uintList = CheckpointUint();
+    CHECK( stringList && uintList );
+    CHECK( ReplayString(stringList, STRING_LOG) );
+    CHECK( ReplayUint(uintList, UINT_LOG) );
+    ApplyChanges( changeCount );
+    CHECK( CheckString(stringList) );
+    CHECK( CheckUint(uintList) );
+    CHECK( FileSize(STRING_LOG) == stringLogSize );
+    CHECK( FileSize(UINT_LOG) == uintLogSize );
+    FreeString( &stringList );
+    FreeUint( &uintList );
+
+    for( tornIndex = 0; tornIndex < TORN_COUNT; tornIndex++ ) {
+      size = TornSize(stringLogSize, tornIndex);
+      flipOffset = -1;
+      if( (tornIndex & 1) && changeCount ) {
+        flipOffset = (long)sizeof(KeyArrayLogHeader) +
+            (long)(NextRandom(&randomState) % (stringLogSize -
+            (long)sizeof(KeyArrayLogHeader)));
+      }
+      CHECK( WriteTornLog(STRING_LOG, size, flipOffset) );
+      if( !TestTornString(size, flipOffset) ) {
+        printf( "  Failed replaying string log torn at %ld, flipped at"
+            " %ld\n", size, flipOffset );
+        return 0;
+      }
+
+      size = TornSize(uintLogSize, tornIndex);
+      flipOffset = -1;
+      if( (tornIndex & 1) && changeCount ) {
+        flipOffset = (long)sizeof(KeyArrayLogHeader) +
+            (long)(NextRandom(&randomState) % (uintLogSize -
+            (long)sizeof(KeyArrayLogHeader)));
+      }
+      CHECK( WriteTornLog(UINT_LOG, size, flipOffset) );
+      if( !TestTornUint(size, flipOffset) ) {
+        printf( "  Failed replaying unsigned log torn at %ld, flipped at"
+            " %ld\n", size, flipOffset );
+        return 0;
+      }
+    }
+    return 1;
+  }
+
+/*
+ * Test rounds
+ */
+
+  int RunRound( unsigned round ) {
+    unsigned keyRange = 1 + (NextRandom(&randomState) % KEY_LIMIT);
+    unsigned checkpointStep = NextRandom(&randomState) % (STEP_COUNT / 2);
+    size_t groupCount = NextRandom(&randomState) % 9;
+    int syncPolicy = (round % 4) ? KEYARRAY_LOG_SYNC_NONE :
+        KEYARRAY_LOG_SYNC_COMMIT;
+    unsigned keyId = 0;
+    unsigned step;
+    int result = 1;
+
+    ClearModel();
+    memset( checkpointPresent, 0, sizeof(checkpointPresent) );
+    memset( checkpointValue, 0, sizeof(checkpointValue) );
+    changeCount = 0;
+    stringLogSize = (long)sizeof(KeyArrayLogHeader);
+    uintLogSize = (long)sizeof(KeyArrayLogHeader);
+
+    remove( STRING_LOG );
+    remove( UINT_LOG );
+    stringList = CreateString(0);
+    uintList = CreateUint(0);
+    stringLog = OpenStringLog(STRING_LOG, syncPolicy, groupCount);
+    uintLog = OpenUintLog(UINT_LOG, syncPolicy, groupCount);
+    CHECK( stringList && uintList && stringLog && uintLog );
+
+    /* A log holds one list type only */
+    CHECK( OpenUintLog(STRING_LOG, syncPolicy, groupCount) == NULL );
+
+    for( step = 0; result && (step < STEP_COUNT); step++ ) {
+      keyId = NextRandom(&randomState) % keyRange;
+      result = TestLogged(keyId);
+
+      if( result && (step == checkpointStep) ) {
+        result = Checkpoint();
+      }
+      if( result && ((NextRandom(&randomState) % 64) == 0) ) {
+        result = KeyArrayLogCommit(stringLog) &&
+            KeyArrayLogCommit(uintLog);
+      }
+    }
+
+    if( result == 0 ) {
+      printf( "  Failed at step %u, key %u\n", step - 1, keyId );
+    }
+
+    result = result && CheckString(stringList) && CheckUint(uintList);
+
+    CHECK( KeyArrayLogClose(&stringLog) );
+    CHECK( KeyArrayLogClose(&uintLog) );
+    FreeString( &stringList );
+    FreeUint( &uintList );
+
+    return result && TestReplay();
+  }
+
+/*
+ * Main program
+ */
+
+  int main( int argc, char* argv[] ) {
+    unsigned seed = 1;
+    unsigned round;
+
+    if( argc > 1 ) {
+      seed = (unsigned)strtoul(argv[1], NULL, 10);
+    }
+    randomState = seed ? seed : 1;
+
+    MakeKeyNames();
+
+    for( round = 0; round < ROUND_COUNT; round++ ) {
+      if( !RunRound(round) ) {
+        printf( "logmodel: failed in round %u, seed %u\n", round, seed );
+        return 1;
+      }
+    }
+
+    remove( STRING_LOG );
+    remove( UINT_LOG );
+    remove( TORN_LOG );
+
+    printf( "logmodel: passed %u rounds, seed %u\n", ROUND_COUNT, seed );
+    return 0;
+  }
@@ -0,0 +1,475 @@
+/* Declares fsync, with -std=c99 */
+#define _POSIX_C_SOURCE 200112L
+
+#include <stdio.h>
+
+/* Declares mapped lists */
+#define KEYARRAY_MAPPED
+
+#include "../keyarray.h"
+#include "model.h"
+
+/*
+ *  File: tests/mapmodel.c
+ *  Status: Complete
+ *
+ *  Mapped File Model Test: saved lists opened mapped and checked
+ *
+ *  Runs random inserts and removes on a string list and an unsigned
+ *  list, saves each one, opens the files mapped, and checks every
+ *  lookup, index, and range against a table of the keys that should
+ *  be present.
+ *
+ *  Then writes damaged copies of each file: cut short at a random
+ *  byte, with a string key offset past the pool, and with two keys
+ *  swapped or repeated. Opening a damaged copy must fail.
+ *
+ *  Files are written to the current directory, and removed when the
+ *  test passes.
+ *
+ *  Build and run with the Makefile in this directory:
+ *    make check
+ *  or pass a seed, to repeat a run with other operations:
+ *    ./mapmodel 12345
+ *
+ *  https://github.com/orlandol/keyarray
+ */
+
+/*
+ * Model declarations
+ */
+
+  #define KEY_LIMIT 2000
+  #define KEY_SIZE 16
+  #define ROUND_COUNT 48
+  #define STEP_COUNT 3000
+  #define RANGE_COUNT 64
+
+  #define STRING_MAP "mapmodel-string.map"
+  #define UINT_MAP "mapmodel-uint.map"
+  #define BAD_MAP "mapmodel-bad.map"
+
+  char keyName[KEY_LIMIT][KEY_SIZE];
+  unsigned char present[KEY_LIMIT];
+  unsigned value[KEY_LIMIT];
+  size_t presentCount = 0;
+
+  /* A saved file, read back to be damaged */
+  unsigned char fileBuffer[1 << 20];
+  size_t fileSize = 0;
+
+  void MakeKeyNames() {
+    unsigned keyId;
+
+    for( keyId = 0; keyId < KEY_LIMIT; keyId++ ) {
+      sprintf( keyName[keyId], "map-%05u", keyId );
+    }
+  }
+
+  void ClearModel() {
+    memset( present, 0, sizeof(present) );
+    memset( value, 0, sizeof(value) );
+    presentCount = 0;
+  }
+
+  /* Returns how many keys from firstId to lastId are present */
+  size_t CountPresent( unsigned firstId, unsigned lastId ) {
+    size_t count = 0;
+    unsigned keyId;
+
+    for( keyId = firstId; (keyId <= lastId) && (keyId < KEY_LIMIT);
+        keyId++ ) {
+      count += present[keyId];
+    }
+    return count;
+  }
+
+  /* Reads fileName into fileBuffer */
+  int ReadFile( const char* fileName ) {
+    FILE* file;
+
+    file = fopen(fileName, "rb");
+    CHECK( file != NULL );
+    fileSize = fread(fileBuffer, 1, sizeof(fileBuffer), file);
+    fclose( file );
+    CHECK( (fileSize >= KEYARRAY_FILE_ITEMOFFSET) &&
+        (fileSize < sizeof(fileBuffer)) );
+    return 1;
+  }
+
+  /* Writes the first size bytes of fileBuffer to BAD_MAP */
+  int WriteBadFile( size_t size ) {
+    FILE* file;
+
+    file = fopen(BAD_MAP, "wb");
+    CHECK( file != NULL );
+    CHECK( fwrite(fileBuffer, 1, size, file) == size );
+    CHECK( fclose(file) == 0 );
+    return 1;
+  }
+
+  /* Returns the item at index in fileBuffer */
+  unsigned char* FileItemAt( size_t index, size_t itemSize ) {
+    return fileBuffer + KEYARRAY_FILE_ITEMOFFSET + (index * itemSize);
+  }
+
+/*
+ * List declarations
+ */
+
+  DECLARE_STRING_KEYARRAY_TYPES( StringList, unsigned )
+  DECLARE_STRING_KEYARRAY_TYPES_MAPPED( StringList, unsigned )
+  DECLARE_STRING_KEYARRAY_CREATE( CreateString, StringList )
+  DECLARE_STRING_KEYARRAY_FREE( FreeString, StringList, FreeNothing )
+  DECLARE_STRING_KEYARRAY_INSERT( InsertString, StringList, unsigned )
+  DECLARE_STRING_KEYARRAY_REMOVE( RemoveString, StringList, FreeNothing )
+  DECLARE_STRING_KEYARRAY_SAVE( SaveString, StringList, unsigned )
+  DECLARE_STRING_KEYARRAY_OPENMAPPED( OpenStringMapped, StringList,
+      unsigned )
+  DECLARE_STRING_KEYARRAY_CLOSEMAPPED( CloseStringMapped, StringList )
+  DECLARE_STRING_KEYARRAY_RETRIEVE_MAPPED( RetrieveStringMapped,
+      StringList, unsigned )
+  DECLARE_STRING_KEYARRAY_FINDINDEX_SIZE_MAPPED( FindStringMapped,
+      StringList )
+  DECLARE_STRING_KEYARRAY_RANGE_MAPPED( RangeStringMapped, StringList )
+
+  DECLARE_UINT_KEYARRAY_TYPES( UintList, unsigned )
+  DECLARE_UINT_KEYARRAY_TYPES_MAPPED( UintList, unsigned )
+  DECLARE_UINT_KEYARRAY_CREATE( CreateUint, UintList )
+  DECLARE_UINT_KEYARRAY_FREE( FreeUint, UintList, FreeNothing )
+  DECLARE_UINT_KEYARRAY_INSERT( InsertUint, UintList, unsigned )
+  DECLARE_UINT_KEYARRAY_REMOVE( RemoveUint, UintList, FreeNothing )
+  DECLARE_UINT_KEYARRAY_SAVE( SaveUint, UintList, unsigned )
+  DECLARE_UINT_KEYARRAY_OPENMAPPED( OpenUintMapped, UintList, unsigned )
+  DECLARE_UINT_KEYARRAY_CLOSEMAPPED( CloseUintMapped, UintList )
+  DECLARE_UINT_KEYARRAY_RETRIEVE_MAPPED( RetrieveUintMapped, UintList,
+      unsigned )
+  DECLARE_UINT_KEYARRAY_FINDINDEX_SIZE_MAPPED( FindUintMapped,
+      UintList )
+  DECLARE_UINT_KEYARRAY_RANGE_MAPPED( RangeUintMapped, UintList )
+
+  StringList* stringList = NULL;
+  UintList* uintList = NULL;
+
+/*
+ * List checks
+ */
+
+  /* Checks every key, and random ranges, of a mapped string list */
+  int CheckStringMapped( StringListMapped* mappedList ) {
+    unsigned keyId;
+    unsigned lastId;
+    unsigned data;
+    size_t index;
+    size_t beginIndex;
+    size_t count;
+
+    CHECK( mappedList->itemCount == presentCount );
+    for( keyId = 0; keyId < KEY_LIMIT; keyId++ ) {
+      data = 0;
+      CHECK( (RetrieveStringMapped(mappedList, keyName[keyId],
+          &data) != 0) == (present[keyId] != 0) );
+      CHECK( data == value[keyId] );
+
+      index = FindStringMapped(mappedList, keyName[keyId]);
+      if( present[keyId] ) {
+        CHECK( index == CountPresent(0, keyId) - 1 );
+        CHECK( strcmp(mappedList->pool +
+            mappedList->item[index].keyOffset, keyName[keyId]) == 0 );
+      } else {
+        CHECK( index == ((size_t)-1) );
+      }
+    }
+
+    for( index = 0; index < RANGE_COUNT; index++ ) {
+      keyId = NextRandom(&randomState) % KEY_LIMIT;
+      lastId = keyId + (NextRandom(&randomState) % 200);
+      if( lastId >= KEY_LIMIT ) {
+        lastId = KEY_LIMIT - 1;
+      }
+
+      count = RangeStringMapped(mappedList, keyName[keyId],
+          keyName[lastId], &beginIndex);
+      CHECK( count == CountPresent(keyId, lastId) );
+      CHECK( beginIndex == (keyId ? CountPresent(0, keyId - 1) : 0) );
+    }
+
+    return 1;
+  }
+
+  /* Checks every key, and random ranges, of a mapped unsigned list */
+  int CheckUintMapped( UintListMapped* mappedList ) {
+    unsigned keyId;
+    unsigned lastId;
+    unsigned data;
+    size_t index;
+    size_t beginIndex;
+    size_t count;
+
+    CHECK( mappedList->itemCount == presentCount );
+    for( keyId = 0; keyId < KEY_LIMIT; keyId++ ) {
+      data = 0;
+      CHECK( (RetrieveUintMapped(mappedList, keyId, &data) != 0) ==
+          (present[keyId] != 0) );
+      CHECK( data == value[keyId] );
+
+      index = FindUintMapped(mappedList, keyId);
+      if( present[keyId] ) {
+        CHECK( index == CountPresent(0, keyId) - 1 );
+        CHECK( mappedList->item[index].key == keyId );
+      } else {
+        CHECK( index == ((size_t)-1) );
+      }
+    }
+
+    for( index = 0; index < RANGE_COUNT; index++ ) {
+      keyId = NextRandom(&randomState) % KEY_LIMIT;
+      lastId = keyId + (NextRandom(&randomState) % 200);
+
+      count = RangeUintMapped(mappedList, keyId, lastId, &beginIndex);
+      CHECK( count == CountPresent(keyId, lastId) );
+      CHECK( beginIndex == (keyId ? CountPresent(0, keyId - 1) : 0) );
+    }
+
+    return 1;
+  }
+
+/*
+ * Operations
+ */
+
+  /* Inserts or removes keyId from both lists, and the model */
+  int TestChange( unsigned keyId ) {
+    unsigned data = NextRandom(&randomState);
+
+    if( NextRandom(&randomState) % 3 ) {
+      CHECK( (InsertString(stringList, keyName[keyId], &data) != 0) ==
+          (present[keyId] == 0) );
+      CHECK( (InsertUint(uintList, keyId, &data) != 0) ==
+          (present[keyId] == 0) );
+      if( present[keyId] == 0 ) {
+        present[keyId] = 1;
+        value[keyId] = data;
+        presentCount++;
+      }
+    } else {
+      RemoveString( stringList, keyName[keyId] );
+      RemoveUint( uintList, keyId );
+      if( present[keyId] ) {
+        present[keyId] = 0;
+        value[keyId] = 0;
+        presentCount--;
+      }
+    }
+
+    return 1;
+  }
+
+  /* Opens the saved string file mapped, and checks it */
+  int TestStringMapped() {
+    StringListMapped mappedList;
+    UintListMapped uintMapped;
+    int result;
+
+    CHECK( OpenStringMapped(&mappedList, STRING_MAP) );
+    result = CheckStringMapped(&mappedList);
+    CloseStringMapped( &mappedList );
+    CHECK( mappedList.mapping == NULL );
+
+    /* A string file is not an unsigned list */
+    CHECK( OpenUintMapped(&uintMapped, STRING_MAP) == 0 );
+
+    return result;
+  }
+
+  /* Opens the saved unsigned file mapped, and checks it */
+  int TestUintMapped() {
+    UintListMapped mappedList;
+    int result;
+
+    CHECK( OpenUintMapped(&mappedList, UINT_MAP) );
+    result = CheckUintMapped(&mappedList);
+    CloseUintMapped( &mappedList );
+    CHECK( mappedList.mapping == NULL );
+
+    return result;
+  }
+
+  /* Writes damaged copies of the saved string file, and checks that
+     none of them open */
+  int TestDamagedString() {
+    StringListMapped mappedList;
+    size_t itemSize = sizeof(StringListFileItem);
+    size_t index;
+    uint64_t keyOffset;
+    uint64_t nextOffset;
+    uint64_t poolSize;
+
+    CHECK( ReadFile(STRING_MAP) );
+    poolSize = ((const KeyArrayFileHeader*)fileBuffer)->poolSize;
+
+    /* The copy opens until it is damaged */
+    CHECK( WriteBadFile(fileSize) );
+    CHECK( OpenStringMapped(&mappedList, BAD_MAP) );
+    CloseStringMapped( &mappedList );
+
+    /* Cut short */
+    CHECK( WriteBadFile(NextRandom(&randomState) % fileSize) );
+    CHECK( OpenStringMapped(&mappedList, BAD_MAP) == 0 );
+    CHECK( mappedList.mapping == NULL );
+
+    if( presentCount == 0 ) {
+      return 1;
+    }
+
+    /* A key offset past the pool */
+    index = NextRandom(&randomState) % presentCount;
+    memcpy( &keyOffset, FileItemAt(index, itemSize), sizeof(uint64_t) );
+    nextOffset = poolSize + (NextRandom(&randomState) % 64);
+    memcpy( FileItemAt(index, itemSize), &nextOffset, sizeof(uint64_t) );
+    CHECK( WriteBadFile(fileSize) );
+    CHECK( OpenStringMapped(&mappedList, BAD_MAP) == 0 );
+    memcpy( FileItemAt(index, itemSize), &keyOffset, sizeof(uint64_t) );
+
+    if( presentCount < 2 ) {
+      return 1;
+    }
+
+    /* Two keys swapped */
+    index = NextRandom(&randomState) % (presentCount - 1);
+    memcpy( &keyOffset, FileItemAt(index, itemSize), sizeof(uint64_t) );
+    memcpy( &nextOffset, FileItemAt(index + 1, itemSize),
+        sizeof(uint64_t) );
+    memcpy( FileItemAt(index, itemSize), &nextOffset, sizeof(uint64_t) );
+    memcpy( FileItemAt(index + 1, itemSize), &keyOffset,
+        sizeof(uint64_t) );
+    CHECK( WriteBadFile(fileSize) );
+    CHECK( OpenStringMapped(&mappedList, BAD_MAP) == 0 );
+
+    /* A key repeated */
+    memcpy( FileItemAt(index, itemSize), &keyOffset, sizeof(uint64_t) );
+    CHECK( WriteBadFile(fileSize) );
+    CHECK( OpenStringMapped(&mappedList, BAD_MAP) == 0 );
+
+    return 1;
+  }
+
+  /* Writes damaged copies of the saved unsigned file, and checks that
+     none of them open */
+  int TestDamagedUint() {
+    UintListMapped mappedList;
+    size_t itemSize = sizeof(UintListFileItem);
+    size_t index;
+    unsigned key;
+    unsigned nextKey;
+
+    CHECK( ReadFile(UINT_MAP) );
+
+    /* The copy opens until it is damaged */
+    CHECK( WriteBadFile(fileSize) );
+    CHECK( OpenUintMapped(&mappedList, BAD_MAP) );
+    CloseUintMapped( &mappedList );
+
+    /* Cut short */
+    CHECK( WriteBadFile(NextRandom(&randomState) % fileSize) );
+    CHECK( OpenUintMapped(&mappedList, BAD_MAP) == 0 );
+    CHECK( mappedList.mapping == NULL );
+
+    if( presentCount < 2 ) {
+      return 1;
+    }
+
+    /* Two keys swapped */
+    index = NextRandom(&randomState) % (presentCount - 1);
+    memcpy( &key, FileItemAt(index, itemSize), sizeof(unsigned) );
+    memcpy( &nextKey, FileItemAt(index + 1, itemSize), sizeof(unsigned) );
+    memcpy( FileItemAt(index, itemSize), &nextKey, sizeof(unsigned) );
+    memcpy( FileItemAt(index + 1, itemSize), &key, sizeof(unsigned) );
+    CHECK( WriteBadFile(fileSize) );
+    CHECK( OpenUintMapped(&mappedList, BAD_MAP) == 0 );
+
+    /* A key repeated */
+    memcpy( FileItemAt(index, itemSize), &key, sizeof(unsigned) );
+    CHECK( WriteBadFile(fileSize) );
+    CHECK( OpenUintMapped(&mappedList, BAD_MAP) == 0 );
+
+    return 1;
+  }
+
+/*
+ * Test rounds
+ */
+
+  int RunRound( unsigned round ) {
+    unsigned keyRange = 1 + (NextRandom(&randomState) % KEY_LIMIT);
+    unsigned stepCount = NextRandom(&randomState) % STEP_COUNT;
+    unsigned keyId = 0;
+    unsigned step;
+    int result = 1;
+
+    /* Every few rounds, save empty lists */
+    if( (round % 8) == 0 ) {
+      stepCount = 0;
+    }
+
+    ClearModel();
+    stringList = CreateString(0);
+    uintList = CreateUint(0);
+    CHECK( stringList && uintList );
+
+    for( step = 0; result && (step < stepCount); step++ ) {
+      keyId = NextRandom(&randomState) % keyRange;
+      result = TestChange(keyId);
+    }
+
+    if( result == 0 ) {
+      printf( "  Failed at step %u, key %u\n", step - 1, keyId );
+    }
+
+    result = result && SaveString(stringList, STRING_MAP) &&
+        SaveUint(uintList, UINT_MAP);
+
+    FreeString( &stringList );
+    FreeUint( &uintList );
+
+    return result && TestStringMapped() && TestUintMapped() &&
+        TestDamagedString() && TestDamagedUint();
+  }
+
+/*
+ * Main program
+ */
+
+  int main( int argc, char* argv[] ) {
+    StringListMapped mappedList;
+    unsigned seed = 1;
+    unsigned round;
+
+    if( argc > 1 ) {
+      seed = (unsigned)strtoul(argv[1], NULL, 10);
+    }
+    randomState = seed ? seed : 1;
+
+    MakeKeyNames();
+
+    /* A missing file does not open */
+    remove( BAD_MAP );
+    if( OpenStringMapped(&mappedList, BAD_MAP) ) {
+      printf( "mapmodel: opened a missing file, seed %u\n", seed );
+      return 1;
+    }
+
+    for( round = 0; round < ROUND_COUNT; round++ ) {
+      if( !RunRound(round) ) {
+        printf( "mapmodel: failed in round %u, seed %u\n", round, seed );
+        return 1;
+      }
+    }
+
+    remove( STRING_MAP );
+    remove( UINT_MAP );
+    remove( BAD_MAP );
+
+    printf( "mapmodel: passed %u rounds, seed %u\n", ROUND_COUNT, seed );
+    return 0;
+  }
@@ -0,0 +1,424 @@
+#include <stdio.h>
+
+#include "../keyarray.h"
+#include "model.h"
+
+/*
+ *  File: tests/mergemodel.c
+ *  Status: Complete
+ *
+ *  Merge Batch Model Test: merge batches checked against a model
+ *
+ *  Runs random inserts, removes, and merge batches on string lists in
+ *  the array of structures, structure of arrays, and key prefix
+ *  layouts, and on unsigned lists in both layouts, and checks every
+ *  list against a table of the keys that should be present. Batches
+ *  are unsorted, repeat keys, and hold keys already in the lists, so
+ *  each merge adds the data of every repeat. Counts the data releases
+ *  each merge makes, and checks that a batch with an empty string key
+ *  fails, leaving the lists unchanged.
+ *
+ *  Build and run with the Makefile in this directory:
+ *    make check
+ *  or pass a seed, to repeat a run with other operations:
+ *    ./mergemodel 12345
+ *
+ *  https://github.com/orlandol/keyarray
+ */
+
+/*
+ * Model declarations
+ */
+
+  #define KEY_LIMIT 3000
+  #define KEY_SIZE 48
+  #define ROUND_COUNT 24
+  #define STEP_COUNT 3000
+  #define CHECK_INTERVAL 250
+  #define BATCH_LIMIT 512
+
+  char keyName[KEY_LIMIT][KEY_SIZE];
+  unsigned char present[KEY_LIMIT];
+  unsigned value[KEY_LIMIT];
+  size_t presentCount = 0;
+
+  /* Data releases made by the lists since the last check */
+  size_t freeCalls = 0;
+
+  /* Keys are short, or share a prefix longer than the inline key prefix */
+  void MakeKeyNames() {
+    unsigned keyId;
+
+    for( keyId = 0; keyId < KEY_LIMIT; keyId++ ) {
+      switch( keyId % 3 ) {
+      case 0:
+        sprintf( keyName[keyId], "%u", keyId );
+        break;
+
+      case 1:
+        sprintf( keyName[keyId], "key-%u", keyId );
+        break;
+
+      default:
+        sprintf( keyName[keyId], "https://example.com/keyarray/%u", keyId );
+        break;
+      }
+    }
+  }
+
+  /* Returns the key id of a key name, from its trailing digits */
+  unsigned KeyIdOf( const char* key ) {
+    const char* digits = key + strlen(key);
+
+    while( (digits > key) && (digits[-1] >= '0') && (digits[-1] <= '9') ) {
+      digits--;
+    }
+    return (unsigned)strtoul(digits, NULL, 10);
+  }
+
+  void ClearModel() {
+    memset( present, 0, sizeof(present) );
+    memset( value, 0, sizeof(value) );
+    presentCount = 0;
+  }
+
+/*
+ * List declarations
+ */
+
+  void FreeValue( unsigned* data ) {
+    (void)data;
+    freeCalls++;
+  }
+
+  void AddValue( unsigned* existing, unsigned* incoming ) {
+    (*existing) += (*incoming);
+  }
+
+  DECLARE_STRING_KEYARRAY_TYPES( AosList, unsigned )
+  DECLARE_STRING_KEYARRAY_CREATE( CreateAos, AosList )
+  DECLARE_STRING_KEYARRAY_FREE( FreeAos, AosList, FreeNothing )
+  DECLARE_STRING_KEYARRAY_INSERT( InsertAos, AosList, unsigned )
+  DECLARE_STRING_KEYARRAY_REMOVE( RemoveAos, AosList, FreeNothing )
+  DECLARE_STRING_KEYARRAY_FINDINDEX_SIZE( FindAos, AosList )
+  DECLARE_STRING_KEYARRAY_MERGEBATCH( MergeAos, AosList, unsigned,
+      AddValue, FreeValue )
+
+  DECLARE_STRING_KEYARRAY_TYPES_SOA( SoaList, unsigned )
+  DECLARE_STRING_KEYARRAY_CREATE_SOA( CreateSoa, SoaList )
+  DECLARE_STRING_KEYARRAY_FREE_SOA( FreeSoa, SoaList, FreeNothing )
+  DECLARE_STRING_KEYARRAY_INSERT_SOA( InsertSoa, SoaList, unsigned )
+  DECLARE_STRING_KEYARRAY_REMOVE_SOA( RemoveSoa, SoaList, FreeNothing )
+  DECLARE_STRING_KEYARRAY_FINDINDEX_SIZE_SOA( FindSoa, SoaList )
+  DECLARE_STRING_KEYARRAY_MERGEBATCH_SOA( MergeSoa, SoaList, unsigned,
+      AddValue, FreeValue )
+
+  DECLARE_STRING_KEYARRAY_TYPES_PREFIX( PrefixList, unsigned )
+  DECLARE_STRING_KEYARRAY_CREATE_PREFIX( CreatePrefix, PrefixList )
+  DECLARE_STRING_KEYARRAY_FREE_PREFIX( FreePrefix, PrefixList, FreeNothing )
+  DECLARE_STRING_KEYARRAY_INSERT_PREFIX( InsertPrefix, PrefixList,
+      unsigned )
+  DECLARE_STRING_KEYARRAY_REMOVE_PREFIX( RemovePrefix, PrefixList,
+      FreeNothing )
+  DECLARE_STRING_KEYARRAY_FINDINDEX_SIZE_PREFIX( FindPrefix, PrefixList )
+  DECLARE_STRING_KEYARRAY_MERGEBATCH_PREFIX( MergePrefix, PrefixList,
+      unsigned, AddValue, FreeValue )
+
+  DECLARE_UINT_KEYARRAY_TYPES( UintList, unsigned )
+  DECLARE_UINT_KEYARRAY_CREATE( CreateUint, UintList )
+  DECLARE_UINT_KEYARRAY_FREE( FreeUint, UintList, FreeNothing )
+  DECLARE_UINT_KEYARRAY_INSERT( InsertUint, UintList, unsigned )
+  DECLARE_UINT_KEYARRAY_REMOVE( RemoveUint, UintList, FreeNothing )
+  DECLARE_UINT_KEYARRAY_FINDINDEX_SIZE( FindUint, UintList )
+  DECLARE_UINT_KEYARRAY_MERGEBATCH( MergeUint, UintList, unsigned,
+      AddValue, FreeValue )
+
+  DECLARE_UINT_KEYARRAY_TYPES_SOA( UintSoa, unsigned )
+  DECLARE_UINT_KEYARRAY_CREATE_SOA( CreateUintSoa, UintSoa )
+  DECLARE_UINT_KEYARRAY_FREE_SOA( FreeUintSoa, UintSoa, FreeNothing )
+  DECLARE_UINT_KEYARRAY_INSERT_SOA( InsertUintSoa, UintSoa, unsigned )
+  DECLARE_UINT_KEYARRAY_REMOVE_SOA( RemoveUintSoa, UintSoa, FreeNothing )
+  DECLARE_UINT_KEYARRAY_FINDINDEX_SIZE_SOA( FindUintSoa, UintSoa )
+  DECLARE_UINT_KEYARRAY_MERGEBATCH_SOA( MergeUintSoa, UintSoa, unsigned,
+      AddValue, FreeValue )
+
+  AosList* aosList = NULL;
+  SoaList* soaList = NULL;
+  PrefixList* prefixList = NULL;
+  UintList* uintList = NULL;
+  UintSoa* uintSoa = NULL;
+
+/*
+ * List checks
+ */
+
+  /* Checks one item, in list order, against the model */
+  int CheckItem( size_t index, unsigned previousKeyId, unsigned keyId,
+      unsigned data ) {
+    CHECK( keyId < KEY_LIMIT );
+    CHECK( present[keyId] );
+    CHECK( data == value[keyId] );
+    if( index ) {
+      CHECK( previousKeyId < keyId );
+    }
+    return 1;
+  }
+
+  /* Checks one string item, in list order, against the model */
+  int CheckStringItem( size_t index, char* previousKey, char* key,
+      unsigned data ) {
+    unsigned keyId = KeyIdOf(key);
+
+    CHECK( keyId < KEY_LIMIT );
+    CHECK( strcmp(key, keyName[keyId]) == 0 );
+    CHECK( present[keyId] );
+    CHECK( data == value[keyId] );
+    if( index ) {
+      CHECK( strcmp(previousKey, key) < 0 );
+    }
+    return 1;
+  }
+
+  /* Walks each list in full. Keys are in strictly increasing order, and
+     as many as in the model, so each list holds exactly the model's
+     keys. */
+  int CheckLists() {
+    size_t index;
+
+    CHECK( aosList->itemCount == presentCount );
+    CHECK( soaList->itemCount == presentCount );
+    CHECK( prefixList->itemCount == presentCount );
+    CHECK( uintList->itemCount == presentCount );
+    CHECK( uintSoa->itemCount == presentCount );
+
+    for( index = 0; index < presentCount; index++ ) {
+      CHECK( CheckStringItem(index,
+          index ? aosList->item[index - 1].key : NULL,
+          aosList->item[index].key, aosList->item[index].data) );
+      CHECK( FindAos(aosList, aosList->item[index].key) == index );
+
+      CHECK( CheckStringItem(index, index ? soaList->keys[index - 1] : NULL,
+          soaList->keys[index], soaList->data[index]) );
+      CHECK( FindSoa(soaList, soaList->keys[index]) == index );
+
+      CHECK( CheckStringItem(index,
+          index ? prefixList->item[index - 1].key : NULL,
+          prefixList->item[index].key, prefixList->item[index].data) );
+      CHECK( FindPrefix(prefixList, prefixList->item[index].key) ==
+          index );
+
+      CHECK( CheckItem(index, index ? uintList->item[index - 1].key : 0,
+          uintList->item[index].key, uintList->item[index].data) );
+      CHECK( FindUint(uintList, uintList->item[index].key) == index );
+
+      CHECK( CheckItem(index, index ? uintSoa->keys[index - 1] : 0,
+          uintSoa->keys[index], uintSoa->data[index]) );
+      CHECK( FindUintSoa(uintSoa, uintSoa->keys[index]) == index );
+    }
+    return 1;
+  }
+
+/*
+ * Operations
+ */
+
+  int TestInsert( unsigned keyId ) {
+    char* key = keyName[keyId];
+    unsigned data = NextRandom(&randomState) & 0xFFFF;
+    int expected = (present[keyId] == 0);
+
+    CHECK( (InsertAos(aosList, key, &data) != 0) == expected );
+    CHECK( (InsertSoa(soaList, key, &data) != 0) == expected );
+    CHECK( (InsertPrefix(prefixList, key, &data) != 0) == expected );
+    CHECK( (InsertUint(uintList, keyId, &data) != 0) == expected );
+    CHECK( (InsertUintSoa(uintSoa, keyId, &data) != 0) == expected );
+
+    if( expected ) {
+      present[keyId] = 1;
+      value[keyId] = data;
+      presentCount++;
+    }
+    return 1;
+  }
+
+  int TestRemove( unsigned keyId ) {
+    char* key = keyName[keyId];
+
+    RemoveAos( aosList, key );
+    RemoveSoa( soaList, key );
+    RemovePrefix( prefixList, key );
+    RemoveUint( uintList, keyId );
+    RemoveUintSoa( uintSoa, keyId );
+
+    if( present[keyId] ) {
+      present[keyId] = 0;
+      presentCount--;
+    }
+    return 1;
+  }
+
+  /* Merges a batch of random keys, some repeated, into every list. Most
+     batches are small, so that new keys are found by galloping search.
+     Each list releases the data of every batch item that it resolves. */
+  int TestMergeBatch( unsigned keyRange ) {
+    static AosListItem aosBatch[BATCH_LIMIT];
+    static SoaListItem soaBatch[BATCH_LIMIT];
+    static PrefixListItem prefixBatch[BATCH_LIMIT];
+    static UintListItem uintBatch[BATCH_LIMIT];
+    static UintSoaItem uintSoaBatch[BATCH_LIMIT];
+    size_t batchLimit = (NextRandom(&randomState) % 8) ? 16 : BATCH_LIMIT;
+    size_t batchCount = NextRandom(&randomState) % batchLimit;
+    size_t resolveCount = 0;
+    size_t batchIndex;
+    unsigned keyId;
+    unsigned data;
+
+    for( batchIndex = 0; batchIndex < batchCount; batchIndex++ ) {
+      keyId = NextRandom(&randomState) % keyRange;
+      data = NextRandom(&randomState) & 0xFFFF;
+
+      aosBatch[batchIndex].key = keyName[keyId];
+      aosBatch[batchIndex].data = data;
+      soaBatch[batchIndex].key = keyName[keyId];
+      soaBatch[batchIndex].data = data;
+      prefixBatch[batchIndex].key = keyName[keyId];
+      prefixBatch[batchIndex].data = data;
+      uintBatch[batchIndex].key = keyId;
+      uintBatch[batchIndex].data = data;
+      uintSoaBatch[batchIndex].key = keyId;
+      uintSoaBatch[batchIndex].data = data;
+
+      if( present[keyId] ) {
+        value[keyId] += data;
+        resolveCount++;
+      } else {
+        present[keyId] = 1;
+        value[keyId] = data;
+        presentCount++;
+      }
+    }
+
+    freeCalls = 0;
+    CHECK( MergeAos(aosList, aosBatch, batchCount) );
+    CHECK( MergeSoa(soaList, soaBatch, batchCount) );
+    CHECK( MergePrefix(prefixList, prefixBatch, batchCount) );
+    CHECK( MergeUint(uintList, uintBatch, batchCount) );
+    CHECK( MergeUintSoa(uintSoa, uintSoaBatch, batchCount) );
+    CHECK( freeCalls == (resolveCount * 5) );
+    return 1;
+  }
+
+  /* Merges a batch holding one empty key into the string lists, which
+     fails, and leaves the lists as they were */
+  int TestEmptyKey( unsigned keyId ) {
+    AosListItem aosBatch[2];
+    SoaListItem soaBatch[2];
+    PrefixListItem prefixBatch[2];
+    char emptyKey[1] = "";
+
+    aosBatch[0].key = keyName[keyId];
+    aosBatch[0].data = 1;
+    aosBatch[1].key = emptyKey;
+    aosBatch[1].data = 2;
+    soaBatch[0].key = aosBatch[0].key;
+    soaBatch[0].data = 1;
+    soaBatch[1].key = emptyKey;
+    soaBatch[1].data = 2;
+    prefixBatch[0].key = aosBatch[0].key;
+    prefixBatch[0].data = 1;
+    prefixBatch[1].key = emptyKey;
+    prefixBatch[1].data = 2;
+
+    freeCalls = 0;
+    CHECK( MergeAos(aosList, aosBatch, 2) == 0 );
+    CHECK( MergeSoa(soaList, soaBatch, 2) == 0 );
+    CHECK( MergePrefix(prefixList, prefixBatch, 2) == 0 );
+    CHECK( freeCalls == 0 );
+    return CheckLists();
+  }
+
+/*
+ * Test rounds
+ */
+
+  int RunRound() {
+    unsigned keyRange = 1 + (NextRandom(&randomState) % KEY_LIMIT);
+    unsigned step;
+    unsigned keyId;
+    int result = 1;
+
+    for( step = 0; result && (step < STEP_COUNT); step++ ) {
+      keyId = NextRandom(&randomState) % keyRange;
+
+      switch( NextRandom(&randomState) % 16 ) {
+      case 0: case 1: case 2: case 3:
+        result = TestInsert(keyId);
+        break;
+
+      case 4: case 5: case 6: case 7: case 8:
+        result = TestRemove(keyId);
+        break;
+
+      case 9:
+        result = TestEmptyKey(keyId);
+        break;
+
+      default:
+        result = TestMergeBatch(keyRange);
+        break;
+      }
+
+      if( result && ((step % CHECK_INTERVAL) == 0) ) {
+        result = CheckLists();
+      }
+
+      if( result == 0 ) {
+        printf( "  Failed at step %u, key '%s'\n", step, keyName[keyId] );
+      }
+    }
+
+    return result && CheckLists();
+  }
+
+/*
+ * Main program
+ */
+
+  int main( int argc, char* argv[] ) {
+    unsigned seed = 1;
+    unsigned round;
+
+    if( argc > 1 ) {
+      seed = (unsigned)strtoul(argv[1], NULL, 10);
+    }
+    randomState = seed ? seed : 1;
+
+    MakeKeyNames();
+
+    for( round = 0; round < ROUND_COUNT; round++ ) {
+      ClearModel();
+      aosList = CreateAos(0);
+      soaList = CreateSoa(0);
+      prefixList = CreatePrefix(0);
+      uintList = CreateUint(0);
+      uintSoa = CreateUintSoa(0);
+      if( !(aosList && soaList && prefixList && uintList && uintSoa) ) {
+        printf( "Error allocating lists\n" );
+        return 1;
+      }
+
+      if( RunRound() == 0 ) {
+        printf( "mergemodel: failed in round %u, seed %u\n", round, seed );
+        return 1;
+      }
+
+      FreeAos( &aosList );
+      FreeSoa( &soaList );
+      FreePrefix( &prefixList );
+      FreeUint( &uintList );
+      FreeUintSoa( &uintSoa );
+    }
+
+    printf( "mergemodel: passed %u rounds, seed %u\n", ROUND_COUNT, seed );
+    return 0;
+  }
@@ -0,0 +1,40 @@
+#ifndef MODEL_H
+#define MODEL_H
+
+#include <stdio.h>
+
+/*
+ *  File: tests/model.h
+ *  Status: Complete
+ *
+ *  Model Test Helpers: checks, random numbers, and data functions
+ *
+ *  Shared by the model tests in this directory. Include it after
+ *  keyarray.h, and after any feature defines the test needs.
+ *
+ *  https://github.com/orlandol/keyarray
+ */
+
+  /* Prints the failed condition, and fails the calling function */
+  #define CHECK( condition )\
+    if( !(condition) ) {\
+      printf( "  Check failed, line %d: %s\n", __LINE__, #condition );\
+      return 0;\
+    }
+
+  unsigned randomState = 1;
+
+  unsigned NextRandom( unsigned* state ) {
+    (*state) ^= (*state) << 13;
+    (*state) ^= (*state) >> 17;
+    (*state) ^= (*state) << 5;
+    return (*state);
+  }
+
+  /* Releases list data that owns nothing. Tests that count releases
+     declare a release function of their own. */
+  void FreeNothing( unsigned* data ) {
+    (void)data;
+  }
+
+#endif
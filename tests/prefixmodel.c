@@ -0,0 +1,383 @@
+#include <stdio.h>
+
+#include "../keyarray.h"
+#include "model.h"
+
+/*
+ *  File: tests/prefixmodel.c
+ *  Status: Complete
+ *
+ *  Key Prefix Model Test: random operations checked against a model
+ *
+ *  Runs random inserts, removes, modifies, retrieves, and finds on a
+ *  key prefix list, and checks every result against a table of the keys
+ *  that should be present. Keys are shorter than the inline prefix, end
+ *  exactly at it, share all of it, or differ in a byte above 127, so
+ *  that the order of prefixes must match strcmp, and ties must be
+ *  decided by the key strings. Unused space is released along the way.
+ *
+ *  Every CHECK_INTERVAL operations, and at the end of each round, the
+ *  list is walked in full, and a copy of it is checked the same way.
+ *
+ *  Build and run with the Makefile in this directory:
+ *    make check
+ *  or pass a seed, to repeat a run with other operations:
+ *    ./prefixmodel 12345
+ *
+ *  https://github.com/orlandol/keyarray
+ */
+
+/*
+ * Model declarations
+ */
+
+  #define KEY_LIMIT 2000
+  #define KEY_SIZE 32
+  #define ROUND_COUNT 24
+  #define STEP_COUNT 6000
+  #define CHECK_INTERVAL 500
+
+  char keyName[KEY_LIMIT][KEY_SIZE];
+  unsigned char present[KEY_LIMIT];
+  unsigned value[KEY_LIMIT];
+  size_t presentCount = 0;
+
+  /* Key ids in strcmp order of their key names */
+  unsigned sortedKeyId[KEY_LIMIT];
+
+  /* Key id n is written in base 26, so that keys of each kind differ
+     only after the shared text */
+  void MakeKeyNames() {
+    char digits[8];
+    unsigned keyId;
+    unsigned number;
+    size_t length;
+
+    for( keyId = 0; keyId < KEY_LIMIT; keyId++ ) {
+      number = keyId / 5;
+      length = 0;
+      do {
+        digits[length++] = (char)('a' + (number % 26));
+        number /= 26;
+      } while( number );
+      digits[length] = 0;
+
+      switch( keyId % 5 ) {
+      case 0:
+        sprintf( keyName[keyId], "%s", digits );
+        break;
+
+      case 1:
+        sprintf( keyName[keyId], "%.*s", (int)(8 - length), "prefix--" );
+        strcat( keyName[keyId], digits );
+        break;
+
+      case 2:
+        sprintf( keyName[keyId], "shared-prefix-%s", digits );
+        break;
+
+      case 3:
+        sprintf( keyName[keyId], "shared-\xe9-%s", digits );
+        break;
+
+      default:
+        sprintf( keyName[keyId], "\xc3\xa9t\xc3\xa9-%s", digits );
+        break;
+      }
+    }
+  }
+
+  int CompareKeyIds( const void* left, const void* right ) {
+    return strcmp(keyName[*(const unsigned*)left],
+        keyName[*(const unsigned*)right]);
+  }
+
+  void SortKeyNames() {
+    unsigned keyId;
+
+    for( keyId = 0; keyId < KEY_LIMIT; keyId++ ) {
+      sortedKeyId[keyId] = keyId;
+    }
+    qsort( sortedKeyId, KEY_LIMIT, sizeof(unsigned), CompareKeyIds );
+  }
+
+  /* Returns the key id of a key name, or KEY_LIMIT if there is none */
+  unsigned KeyIdOf( const char* key ) {
+    size_t low = 0;
+    size_t high = KEY_LIMIT;
+    size_t middle;
+    int result;
+
+    while( low < high ) {
+      middle = low + ((high - low) / 2);
+      result = strcmp(keyName[sortedKeyId[middle]], key);
+      if( result == 0 ) {
+        return sortedKeyId[middle];
+      }
+      if( result < 0 ) {
+        low = middle + 1;
+      } else {
+        high = middle;
+      }
+    }
+    return KEY_LIMIT;
+  }
+
+  /* Returns the number of keys in the model that strcmp orders before
+     key */
+  size_t CountBelow( const char* key ) {
+    size_t count = 0;
+    unsigned keyId;
+
+    for( keyId = 0; keyId < KEY_LIMIT; keyId++ ) {
+      if( present[keyId] && (strcmp(keyName[keyId], key) < 0) ) {
+        count++;
+      }
+    }
+    return count;
+  }
+
+  void ClearModel() {
+    memset( present, 0, sizeof(present) );
+    memset( value, 0, sizeof(value) );
+    presentCount = 0;
+  }
+
+/*
+ * List declarations
+ */
+
+  int CopyValue( unsigned* dest, unsigned* source ) {
+    (*dest) = (*source);
+    return 1;
+  }
+
+  DECLARE_STRING_KEYARRAY_TYPES_PREFIX( PrefixList, unsigned )
+  DECLARE_STRING_KEYARRAY_CREATE_PREFIX( CreatePrefix, PrefixList )
+  DECLARE_STRING_KEYARRAY_FREE_PREFIX( FreePrefix, PrefixList, FreeNothing )
+  DECLARE_STRING_KEYARRAY_INSERT_PREFIX( InsertPrefix, PrefixList,
+      unsigned )
+  DECLARE_STRING_KEYARRAY_REMOVE_PREFIX( RemovePrefix, PrefixList,
+      FreeNothing )
+  DECLARE_STRING_KEYARRAY_RETRIEVE_PREFIX( RetrievePrefix, PrefixList,
+      unsigned )
+  DECLARE_STRING_KEYARRAY_MODIFY_PREFIX( ModifyPrefix, PrefixList,
+      unsigned )
+  DECLARE_STRING_KEYARRAY_FINDINDEX_PREFIX( FindPrefixInt, PrefixList )
+  DECLARE_STRING_KEYARRAY_FINDINDEX_SIZE_PREFIX( FindPrefix, PrefixList )
+  DECLARE_STRING_KEYARRAY_RELEASEUNUSED_PREFIX( ReleasePrefix,
+      PrefixList )
+  DECLARE_STRING_KEYARRAY_COPY_PREFIX( CopyPrefix, PrefixList, unsigned,
+      CopyValue, FreeNothing )
+
+  PrefixList* prefixList = NULL;
+
+/*
+ * List checks
+ */
+
+  /* Walks the whole list. Keys are in strictly increasing strcmp order,
+     and as many as in the model, so the list holds exactly the model's
+     keys. */
+  int CheckPrefix( PrefixList* keyList ) {
+    unsigned keyId;
+    size_t index;
+
+    CHECK( keyList->itemCount == presentCount );
+    for( index = 0; index < keyList->itemCount; index++ ) {
+      keyId = KeyIdOf(keyList->item[index].key);
+      CHECK( keyId < KEY_LIMIT );
+      CHECK( present[keyId] );
+      CHECK( keyList->item[index].data == value[keyId] );
+      if( index ) {
+        CHECK( strcmp(keyList->item[index - 1].key,
+            keyList->item[index].key) < 0 );
+      }
+      CHECK( FindPrefix(keyList, keyList->item[index].key) == index );
+    }
+    return 1;
+  }
+
+  /* Checks the list, and a copy of the list */
+  int CheckLists() {
+    PrefixList* prefixCopy = NULL;
+    int result;
+
+    CHECK( CheckPrefix(prefixList) );
+
+    prefixCopy = CopyPrefix(prefixList);
+    result = prefixCopy && CheckPrefix(prefixCopy);
+    FreePrefix( &prefixCopy );
+
+    CHECK( result );
+    return 1;
+  }
+
+/*
+ * Operations
+ */
+
+  int TestInsert( unsigned keyId ) {
+    unsigned data = NextRandom(&randomState);
+    int expected = (present[keyId] == 0);
+
+    CHECK( (InsertPrefix(prefixList, keyName[keyId], &data) != 0) ==
+        expected );
+
+    if( expected ) {
+      present[keyId] = 1;
+      value[keyId] = data;
+      presentCount++;
+    }
+    return 1;
+  }
+
+  int TestRemove( unsigned keyId ) {
+    RemovePrefix( prefixList, keyName[keyId] );
+
+    if( present[keyId] ) {
+      present[keyId] = 0;
+      presentCount--;
+    }
+    return 1;
+  }
+
+  int TestModify( unsigned keyId ) {
+    unsigned data = NextRandom(&randomState);
+    int expected = present[keyId];
+
+    CHECK( (ModifyPrefix(prefixList, keyName[keyId], &data) != 0) ==
+        expected );
+
+    if( expected ) {
+      value[keyId] = data;
+    }
+    return 1;
+  }
+
+  int TestRetrieve( unsigned keyId ) {
+    char* key = keyName[keyId];
+    int expected = present[keyId];
+    size_t index = expected ? CountBelow(key) : (size_t)-1;
+    unsigned data;
+
+    data = ~value[keyId];
+    CHECK( (RetrievePrefix(prefixList, key, &data) != 0) == expected );
+    CHECK( (expected == 0) || (data == value[keyId]) );
+
+    CHECK( FindPrefix(prefixList, key) == index );
+    CHECK( FindPrefixInt(prefixList, key) ==
+        (expected ? (int)index : -1) );
+    return 1;
+  }
+
+  /* Looks up a key that is not in the model: a present key with a byte
+     added, or with its last byte removed */
+  int TestMiss( unsigned keyId ) {
+    char key[KEY_SIZE + 1];
+    size_t length = strlen(keyName[keyId]);
+    unsigned data = 0;
+
+    strcpy( key, keyName[keyId] );
+    if( NextRandom(&randomState) % 2 ) {
+      key[length] = (char)(0x20 + (NextRandom(&randomState) % 0xE0));
+      key[length + 1] = 0;
+    } else {
+      key[length - 1] = 0;
+    }
+
+    if( (key[0] == 0) || (KeyIdOf(key) < KEY_LIMIT) ) {
+      return 1;
+    }
+
+    CHECK( RetrievePrefix(prefixList, key, &data) == 0 );
+    CHECK( FindPrefix(prefixList, key) == (size_t)-1 );
+    return 1;
+  }
+
+/*
+ * Test rounds
+ */
+
+  int RunRound() {
+    unsigned keyRange = 1 + (NextRandom(&randomState) % KEY_LIMIT);
+    unsigned step;
+    unsigned keyId;
+    int result = 1;
+
+    for( step = 0; result && (step < STEP_COUNT); step++ ) {
+      keyId = NextRandom(&randomState) % keyRange;
+
+      switch( NextRandom(&randomState) % 16 ) {
+      case 0: case 1: case 2: case 3: case 4:
+        result = TestInsert(keyId);
+        break;
+
+      case 5: case 6: case 7:
+        result = TestRemove(keyId);
+        break;
+
+      case 8: case 9:
+        result = TestModify(keyId);
+        break;
+
+      case 10: case 11:
+        result = TestMiss(keyId);
+        break;
+
+      case 15:
+        ReleasePrefix( prefixList );
+        break;
+
+      default:
+        result = TestRetrieve(keyId);
+        break;
+      }
+
+      if( result && ((step % CHECK_INTERVAL) == 0) ) {
+        result = CheckLists();
+      }
+
+      if( result == 0 ) {
+        printf( "  Failed at step %u, key id %u\n", step, keyId );
+      }
+    }
+
+    return result && CheckLists();
+  }
+
+/*
+ * Main program
+ */
+
+  int main( int argc, char* argv[] ) {
+    unsigned seed = 1;
+    unsigned round;
+
+    if( argc > 1 ) {
+      seed = (unsigned)strtoul(argv[1], NULL, 10);
+    }
+    randomState = seed ? seed : 1;
+
+    MakeKeyNames();
+    SortKeyNames();
+
+    for( round = 0; round < ROUND_COUNT; round++ ) {
+      ClearModel();
+      prefixList = CreatePrefix(NextRandom(&randomState) % 64);
+      if( prefixList == NULL ) {
+        printf( "Error allocating list\n" );
+        return 1;
+      }
+
+      if( RunRound() == 0 ) {
+        printf( "prefixmodel: failed in round %u, seed %u\n", round, seed );
+        return 1;
+      }
+
+      FreePrefix( &prefixList );
+    }
+
+    printf( "prefixmodel: passed %u rounds, seed %u\n", ROUND_COUNT, seed );
+    return 0;
+  }
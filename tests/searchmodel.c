@@ -0,0 +1,384 @@
+#include <stdio.h>
+
+#include "../keyarray.h"
+#include "model.h"
+
+/*
+ *  File: tests/searchmodel.c
+ *  Status: Complete
+ *
+ *  Search Index Model Test: indexed lookups checked against a model
+ *
+ *  Runs random inserts, removes, merge batches, modifies, retrieves, and
+ *  finds on unsigned lists in the array of structures and structure of
+ *  arrays layouts, and checks every result against a table of the keys
+ *  that should be present. The search index of each list is rebuilt or
+ *  released along the way, and each rebuild is followed by a run of
+ *  lookups, so lookups run against fresh, stale, and missing indices.
+ *  Lookups also probe the keys between, below, and above the list's
+ *  keys.
+ *
+ *  Key n is 3n + 1, so that 3n and 3n + 2 are never in the lists.
+ *
+ *  Build and run with the Makefile in this directory:
+ *    make check
+ *  or pass a seed, to repeat a run with other operations:
+ *    ./searchmodel 12345
+ *
+ *  https://github.com/orlandol/keyarray
+ */
+
+/*
+ * Model declarations
+ */
+
+  #define KEY_LIMIT 5000
+  #define ROUND_COUNT 24
+  #define STEP_COUNT 6000
+  #define CHECK_INTERVAL 500
+  #define BATCH_LIMIT 48
+  #define READ_COUNT 64
+
+  unsigned char present[KEY_LIMIT];
+  unsigned value[KEY_LIMIT];
+  size_t presentCount = 0;
+
+  unsigned KeyOf( unsigned keyId ) {
+    return (keyId * 3) + 1;
+  }
+
+  void ClearModel() {
+    memset( present, 0, sizeof(present) );
+    memset( value, 0, sizeof(value) );
+    presentCount = 0;
+  }
+
+  /* Returns the number of keys in the model less than key */
+  size_t CountBelow( unsigned key ) {
+    size_t count = 0;
+    unsigned keyId;
+
+    for( keyId = 0; (keyId < KEY_LIMIT) && (KeyOf(keyId) < key);
+        keyId++ ) {
+      count += present[keyId];
+    }
+    return count;
+  }
+
+/*
+ * List declarations
+ */
+
+  int CopyValue( unsigned* dest, unsigned* source ) {
+    (*dest) = (*source);
+    return 1;
+  }
+
+  void AddValue( unsigned* existing, unsigned* incoming ) {
+    (*existing) += (*incoming);
+  }
+
+  DECLARE_UINT_KEYARRAY_TYPES( AosList, unsigned )
+  DECLARE_UINT_KEYARRAY_CREATE( CreateAos, AosList )
+  DECLARE_UINT_KEYARRAY_FREE( FreeAos, AosList, FreeNothing )
+  DECLARE_UINT_KEYARRAY_INSERT( InsertAos, AosList, unsigned )
+  DECLARE_UINT_KEYARRAY_REMOVE( RemoveAos, AosList, FreeNothing )
+  DECLARE_UINT_KEYARRAY_RETRIEVE( RetrieveAos, AosList, unsigned )
+  DECLARE_UINT_KEYARRAY_MODIFY( ModifyAos, AosList, unsigned )
+  DECLARE_UINT_KEYARRAY_FINDINDEX_SIZE( FindAos, AosList )
+  DECLARE_UINT_KEYARRAY_FINDINDEX( FindAosInt, AosList )
+  DECLARE_UINT_KEYARRAY_MERGEBATCH( MergeAos, AosList, unsigned,
+      AddValue, FreeNothing )
+  DECLARE_UINT_KEYARRAY_COPY( CopyAos, AosList, unsigned,
+      CopyValue, FreeNothing )
+  DECLARE_UINT_KEYARRAY_SEARCHINDEX( IndexAos, AosList )
+
+  DECLARE_UINT_KEYARRAY_TYPES_SOA( SoaList, unsigned )
+  DECLARE_UINT_KEYARRAY_CREATE_SOA( CreateSoa, SoaList )
+  DECLARE_UINT_KEYARRAY_FREE_SOA( FreeSoa, SoaList, FreeNothing )
+  DECLARE_UINT_KEYARRAY_INSERT_SOA( InsertSoa, SoaList, unsigned )
+  DECLARE_UINT_KEYARRAY_REMOVE_SOA( RemoveSoa, SoaList, FreeNothing )
+  DECLARE_UINT_KEYARRAY_RETRIEVE_SOA( RetrieveSoa, SoaList, unsigned )
+  DECLARE_UINT_KEYARRAY_MODIFY_SOA( ModifySoa, SoaList, unsigned )
+  DECLARE_UINT_KEYARRAY_FINDINDEX_SIZE_SOA( FindSoa, SoaList )
+  DECLARE_UINT_KEYARRAY_MERGEBATCH_SOA( MergeSoa, SoaList, unsigned,
+      AddValue, FreeNothing )
+  DECLARE_UINT_KEYARRAY_COPY_SOA( CopySoa, SoaList, unsigned,
+      CopyValue, FreeNothing )
+  DECLARE_UINT_KEYARRAY_SEARCHINDEX_SOA( IndexSoa, SoaList )
+
+  AosList* aosList = NULL;
+  SoaList* soaList = NULL;
+
+/*
+ * List checks
+ */
+
+  /* Looks up one key, present or not, in a list and its copy */
+  int CheckLookup( AosList* aosCheck, SoaList* soaCheck, unsigned key ) {
+    unsigned keyId = key / 3;
+    int expected = ((key % 3) == 1) && (keyId < KEY_LIMIT) &&
+        present[keyId];
+    size_t index = expected ? CountBelow(key) : (size_t)-1;
+    unsigned data;
+
+    data = expected ? ~value[keyId] : 0;
+    CHECK( (RetrieveAos(aosCheck, key, &data) != 0) == expected );
+    CHECK( (expected == 0) || (data == value[keyId]) );
+
+    data = expected ? ~value[keyId] : 0;
+    CHECK( (RetrieveSoa(soaCheck, key, &data) != 0) == expected );
+    CHECK( (expected == 0) || (data == value[keyId]) );
+
+    CHECK( FindAos(aosCheck, key) == index );
+    CHECK( FindAosInt(aosCheck, key) == (expected ? (int)index : -1) );
+    CHECK( FindSoa(soaCheck, key) == index );
+    return 1;
+  }
+
+  /* Walks each list in full, and finds each key through the index */
+  int CheckLists() {
+    AosList* aosCopy = NULL;
+    SoaList* soaCopy = NULL;
+    unsigned keyId;
+    size_t index;
+    int result = 1;
+
+    CHECK( aosList->itemCount == presentCount );
+    CHECK( soaList->itemCount == presentCount );
+    for( index = 0; index < presentCount; index++ ) {
+      keyId = aosList->item[index].key / 3;
+      CHECK( keyId < KEY_LIMIT );
+      CHECK( aosList->item[index].key == KeyOf(keyId) );
+      CHECK( present[keyId] );
+      CHECK( aosList->item[index].data == value[keyId] );
+      CHECK( soaList->keys[index] == aosList->item[index].key );
+      CHECK( soaList->data[index] == value[keyId] );
+      if( index ) {
+        CHECK( aosList->item[index - 1].key < aosList->item[index].key );
+      }
+      CHECK( FindAos(aosList, aosList->item[index].key) == index );
+      CHECK( FindSoa(soaList, soaList->keys[index]) == index );
+    }
+
+    /* Copies do not copy the index */
+    aosCopy = CopyAos(aosList);
+    soaCopy = CopySoa(soaList);
+    result = aosCopy && soaCopy;
+    for( keyId = 0; result && (keyId < KEY_LIMIT); keyId += 7 ) {
+      result = CheckLookup(aosCopy, soaCopy, KeyOf(keyId));
+    }
+
+    FreeAos( &aosCopy );
+    FreeSoa( &soaCopy );
+
+    CHECK( result );
+    return 1;
+  }
+
+/*
+ * Operations
+ */
+
+  int TestInsert( unsigned keyId ) {
+    unsigned data = NextRandom(&randomState);
+    int expected = (present[keyId] == 0);
+
+    CHECK( (InsertAos(aosList, KeyOf(keyId), &data) != 0) == expected );
+    CHECK( (InsertSoa(soaList, KeyOf(keyId), &data) != 0) == expected );
+
+    if( expected ) {
+      present[keyId] = 1;
+      value[keyId] = data;
+      presentCount++;
+    }
+    return 1;
+  }
+
+  int TestRemove( unsigned keyId ) {
+    RemoveAos( aosList, KeyOf(keyId) );
+    RemoveSoa( soaList, KeyOf(keyId) );
+
+    if( present[keyId] ) {
+      present[keyId] = 0;
+      presentCount--;
+    }
+    return 1;
+  }
+
+  int TestModify( unsigned keyId ) {
+    unsigned data = NextRandom(&randomState);
+    int expected = present[keyId];
+
+    CHECK( (ModifyAos(aosList, KeyOf(keyId), &data) != 0) == expected );
+    CHECK( (ModifySoa(soaList, KeyOf(keyId), &data) != 0) == expected );
+
+    if( expected ) {
+      value[keyId] = data;
+    }
+    return 1;
+  }
+
+  /* Looks up a random key, or a key between, below, or above the keys */
+  int TestLookup( unsigned keyId ) {
+    switch( NextRandom(&randomState) % 8 ) {
+    case 0:
+      return CheckLookup(aosList, soaList, KeyOf(keyId) - 1);
+
+    case 1:
+      return CheckLookup(aosList, soaList, KeyOf(keyId) + 1);
+
+    case 2:
+      return CheckLookup(aosList, soaList, 0);
+
+    case 3:
+      return CheckLookup(aosList, soaList, UINT_MAX -
+          (NextRandom(&randomState) % 4));
+
+    default:
+      return CheckLookup(aosList, soaList, KeyOf(keyId));
+    }
+  }
+
+  /* Merges a batch of random keys, some repeated, into each list */
+  int TestMergeBatch( unsigned keyRange ) {
+    static AosListItem aosBatch[BATCH_LIMIT];
+    static SoaListItem soaBatch[BATCH_LIMIT];
+    size_t batchCount = NextRandom(&randomState) % BATCH_LIMIT;
+    size_t batchIndex;
+    unsigned keyId;
+    unsigned data;
+
+    for( batchIndex = 0; batchIndex < batchCount; batchIndex++ ) {
+      keyId = NextRandom(&randomState) % keyRange;
+      data = NextRandom(&randomState) & 0xFFFF;
+
+      aosBatch[batchIndex].key = KeyOf(keyId);
+      aosBatch[batchIndex].data = data;
+      soaBatch[batchIndex].key = KeyOf(keyId);
+      soaBatch[batchIndex].data = data;
+
+      if( present[keyId] ) {
+        value[keyId] += data;
+      } else {
+        present[keyId] = 1;
+        value[keyId] = data;
+        presentCount++;
+      }
+    }
+
+    CHECK( MergeAos(aosList, aosBatch, batchCount) );
+    CHECK( MergeSoa(soaList, soaBatch, batchCount) );
+    return 1;
+  }
+
+  /* Rebuilds the index of each list, and reads through it, or releases
+     the index of one list */
+  int TestIndex( unsigned keyRange ) {
+    unsigned readIndex;
+
+    switch( NextRandom(&randomState) % 4 ) {
+    case 0:
+      CHECK( IndexAos(aosList, 0) );
+      break;
+
+    case 1:
+      CHECK( IndexSoa(soaList, 0) );
+      break;
+
+    default:
+      CHECK( IndexAos(aosList, 1) );
+      CHECK( IndexSoa(soaList, 1) );
+      for( readIndex = 0; readIndex < READ_COUNT; readIndex++ ) {
+        CHECK( TestLookup(NextRandom(&randomState) % keyRange) );
+      }
+      break;
+    }
+    return 1;
+  }
+
+/*
+ * Test rounds
+ */
+
+  int RunRound() {
+    unsigned keyRange = 1 + (NextRandom(&randomState) % KEY_LIMIT);
+    unsigned step;
+    unsigned keyId;
+    int result = 1;
+
+    for( step = 0; result && (step < STEP_COUNT); step++ ) {
+      keyId = NextRandom(&randomState) % keyRange;
+
+      switch( NextRandom(&randomState) % 16 ) {
+      case 0: case 1: case 2: case 3:
+        result = TestInsert(keyId);
+        break;
+
+      case 4: case 5: case 6:
+        result = TestRemove(keyId);
+        break;
+
+      case 7:
+        result = TestModify(keyId);
+        break;
+
+      case 8:
+        result = TestMergeBatch(keyRange);
+        break;
+
+      case 9:
+        result = TestIndex(keyRange);
+        break;
+
+      default:
+        result = TestLookup(keyId);
+        break;
+      }
+
+      if( result && ((step % CHECK_INTERVAL) == 0) ) {
+        result = CheckLists();
+      }
+
+      if( result == 0 ) {
+        printf( "  Failed at step %u, key %u\n", step, KeyOf(keyId) );
+      }
+    }
+
+    return result && CheckLists();
+  }
+
+/*
+ * Main program
+ */
+
+  int main( int argc, char* argv[] ) {
+    unsigned seed = 1;
+    unsigned round;
+
+    if( argc > 1 ) {
+      seed = (unsigned)strtoul(argv[1], NULL, 10);
+    }
+    randomState = seed ? seed : 1;
+
+    for( round = 0; round < ROUND_COUNT; round++ ) {
+      ClearModel();
+      aosList = CreateAos(0);
+      soaList = CreateSoa(0);
+      if( !(aosList && soaList) ) {
+        printf( "Error allocating lists\n" );
+        return 1;
+      }
+
+      if( RunRound() == 0 ) {
+        printf( "searchmodel: failed in round %u, seed %u\n", round, seed );
+        return 1;
+      }
+
+      FreeAos( &aosList );
+      FreeSoa( &soaList );
+    }
+
+    printf( "searchmodel: passed %u rounds, seed %u\n", ROUND_COUNT, seed );
+    return 0;
+  }
@@ -0,0 +1,770 @@
+#include <stdio.h>
+
+#include "../keyarray.h"
+#include "model.h"
+
+/*
+ *  File: tests/setmodel.c
+ *  Status: Complete
+ *
+ *  Set Operation Model Test: union, intersect, and difference checked
+ *  against a naive merge
+ *
+ *  Each round fills a left and a right table of keys, each empty, a
+ *  few keys, a dense spread, or one run, so that sizes are often very
+ *  unequal, and the merge gallops. Then builds both as string, key
+ *  prefix, unsigned, and custom key lists, in the array of structures
+ *  and structure of arrays layouts, takes their union, intersect, and
+ *  difference, and checks each new list against a key by key merge of
+ *  the tables. Some rounds pass one list as both inputs.
+ *
+ *  Keys in both lists are kept from the left, kept from the right, or
+ *  added together, as the round's combine policy says. Some operations
+ *  fail a copy or combine part way through; they must return NULL,
+ *  free exactly the data already copied, and leave both lists as they
+ *  were.
+ *
+ *  Build and run with the Makefile in this directory:
+ *    make check
+ *  or pass a seed, to repeat a run with other operations:
+ *    ./setmodel 12345
+ *
+ *  https://github.com/orlandol/keyarray
+ */
+
+/*
+ * Model declarations
+ */
+
+  #define KEY_LIMIT 4000
+  #define KEY_SIZE 16
+  #define ROUND_COUNT 64
+
+  /* Model tables */
+  #define LEFT_SET 0
+  #define RIGHT_SET 1
+  #define RESULT_SET 2
+
+  /* What a combine keeps, for a key in both lists */
+  #define KEEP_LEFT 0
+  #define KEEP_RIGHT 1
+  #define ADD_BOTH 2
+
+  char keyName[KEY_LIMIT][KEY_SIZE];
+  unsigned char present[3][KEY_LIMIT];
+  unsigned value[3][KEY_LIMIT];
+  size_t presentCount[3];
+
+  /* Combine policy, and data function calls, of the current operation.
+     The call numbered failCall fails, unless it is 0. */
+  int combinePolicy = KEEP_LEFT;
+  size_t copyCalls = 0;
+  size_t combineCalls = 0;
+  size_t freeCalls = 0;
+  size_t failCall = 0;
+
+  /* Data function calls a successful operation makes */
+  size_t expectedCopies = 0;
+  size_t expectedCombines = 0;
+
+  void MakeKeyNames() {
+    unsigned keyId;
+
+    for( keyId = 0; keyId < KEY_LIMIT; keyId++ ) {
+      sprintf( keyName[keyId], "set-%05u", keyId );
+    }
+  }
+
+  /* Fills table set with no keys, a few keys, a dense spread of keys, or
+     one run of keys */
+  void FillSet( int set ) {
+    unsigned keyId;
+    unsigned firstId;
+    unsigned lastId;
+    unsigned count;
+    unsigned density;
+
+    memset( present[set], 0, sizeof(present[set]) );
+    memset( value[set], 0, sizeof(value[set]) );
+
+    switch( NextRandom(&randomState) % 4 ) {
+    case 0:
+      break;
+
+    case 1:
+      count = 1 + (NextRandom(&randomState) % 8);
+      while( count-- ) {
+        present[set][NextRandom(&randomState) % KEY_LIMIT] = 1;
+      }
+      break;
+
+    case 2:
+      density = 1 + (NextRandom(&randomState) % 4);
+      for( keyId = 0; keyId < KEY_LIMIT; keyId++ ) {
+        present[set][keyId] = ((NextRandom(&randomState) % 4) < density);
+      }
+      break;
+
+    default:
+      firstId = NextRandom(&randomState) % KEY_LIMIT;
+      lastId = firstId + (NextRandom(&randomState) % (KEY_LIMIT / 4));
+      for( keyId = firstId; (keyId <= lastId) && (keyId < KEY_LIMIT);
+          keyId++ ) {
+        present[set][keyId] = 1;
+      }
+      break;
+    }
+
+    presentCount[set] = 0;
+    for( keyId = 0; keyId < KEY_LIMIT; keyId++ ) {
+      if( present[set][keyId] ) {
+        value[set][keyId] = NextRandom(&randomState);
+        presentCount[set]++;
+      }
+    }
+  }
+
+  /* Returns what combining leftData and rightData keeps */
+  unsigned CombinedValue( unsigned leftData, unsigned rightData ) {
+    if( combinePolicy == KEEP_LEFT ) {
+      return leftData;
+    }
+    if( combinePolicy == KEEP_RIGHT ) {
+      return rightData;
+    }
+    return leftData + rightData;
+  }
+
+  /* Merges the left and right tables into the result table, one key at
+     a time, and counts the data function calls it takes */
+  void MergeSets( int operation ) {
+    unsigned keyId;
+    int inLeft;
+    int inRight;
+
+    memset( present[RESULT_SET], 0, sizeof(present[RESULT_SET]) );
+    memset( value[RESULT_SET], 0, sizeof(value[RESULT_SET]) );
+    presentCount[RESULT_SET] = 0;
+    expectedCopies = 0;
+    expectedCombines = 0;
+
+    for( keyId = 0; keyId < KEY_LIMIT; keyId++ ) {
+      inLeft = present[LEFT_SET][keyId];
+      inRight = present[RIGHT_SET][keyId];
+
+      if( inLeft && inRight && (operation != KEYARRAY_SET_DIFFERENCE) ) {
+        present[RESULT_SET][keyId] = 1;
+        value[RESULT_SET][keyId] = CombinedValue(value[LEFT_SET][keyId],
+            value[RIGHT_SET][keyId]);
+        expectedCombines++;
+      } else if( inLeft && !inRight &&
+          (operation != KEYARRAY_SET_INTERSECT) ) {
+        present[RESULT_SET][keyId] = 1;
+        value[RESULT_SET][keyId] = value[LEFT_SET][keyId];
+        expectedCopies++;
+      } else if( inRight && !inLeft &&
+          (operation == KEYARRAY_SET_UNION) ) {
+        present[RESULT_SET][keyId] = 1;
+        value[RESULT_SET][keyId] = value[RIGHT_SET][keyId];
+        expectedCopies++;
+      }
+      presentCount[RESULT_SET] += present[RESULT_SET][keyId];
+    }
+  }
+
+  /* Clears the call counts, and sometimes picks a call to fail */
+  void StartOperation() {
+    size_t callCount = expectedCopies + expectedCombines;
+
+    copyCalls = 0;
+    combineCalls = 0;
+    freeCalls = 0;
+    failCall = 0;
+    if( callCount && ((NextRandom(&randomState) % 4) == 0) ) {
+      failCall = 1 + (NextRandom(&randomState) % callCount);
+    }
+  }
+
+  /* Checks the result of an operation, once its lists were checked */
+  int CheckOperation( void* newList ) {
+    if( failCall ) {
+      CHECK( newList == NULL );
+      CHECK( (copyCalls + combineCalls) == failCall );
+      CHECK( freeCalls == (failCall - 1) );
+    } else {
+      CHECK( newList != NULL );
+      CHECK( copyCalls == expectedCopies );
+      CHECK( combineCalls == expectedCombines );
+      CHECK( freeCalls == 0 );
+    }
+    return 1;
+  }
+
+/*
+ * List declarations
+ */
+
+  typedef struct PairKey {
+    unsigned high;
+    unsigned low;
+  } PairKey;
+
+  int ComparePairKeys( PairKey leftKey, PairKey rightKey ) {
+    if( leftKey.high != rightKey.high ) {
+      return (leftKey.high < rightKey.high) ? -1 : 1;
+    }
+    if( leftKey.low != rightKey.low ) {
+      return (leftKey.low < rightKey.low) ? -1 : 1;
+    }
+    return 0;
+  }
+
+  PairKey MakePairKey( unsigned keyId ) {
+    PairKey key;
+
+    key.high = keyId / 64;
+    key.low = keyId % 64;
+    return key;
+  }
+
+  void FreeValue( unsigned* data ) {
+    (void)data;
+    freeCalls++;
+  }
+
+  int CopyValue( unsigned* dest, unsigned* source ) {
+    copyCalls++;
+    if( (copyCalls + combineCalls) == failCall ) {
+      return 0;
+    }
+    (*dest) = (*source);
+    return 1;
+  }
+
+  int CombineValue( unsigned* dest, unsigned* leftData,
+      unsigned* rightData ) {
+    combineCalls++;
+    if( (copyCalls + combineCalls) == failCall ) {
+      return 0;
+    }
+    (*dest) = CombinedValue(*leftData, *rightData);
+    return 1;
+  }
+
+  DECLARE_STRING_KEYARRAY_TYPES( StringList, unsigned )
+  DECLARE_STRING_KEYARRAY_CREATE( CreateString, StringList )
+  DECLARE_STRING_KEYARRAY_FREE( FreeString, StringList, FreeValue )
+  DECLARE_STRING_KEYARRAY_INSERT( InsertString, StringList, unsigned )
+  DECLARE_STRING_KEYARRAY_FINDINDEX_SIZE( FindString, StringList )
+  DECLARE_STRING_KEYARRAY_UNION( UnionString, StringList, unsigned,
+      CopyValue, CombineValue, FreeValue )
+  DECLARE_STRING_KEYARRAY_INTERSECT( IntersectString, StringList,
+      unsigned, CombineValue, FreeValue )
+  DECLARE_STRING_KEYARRAY_DIFFERENCE( DifferenceString, StringList,
+      unsigned, CopyValue, FreeValue )
+
+  DECLARE_STRING_KEYARRAY_TYPES_SOA( StringSoa, unsigned )
+  DECLARE_STRING_KEYARRAY_CREATE_SOA( CreateStringSoa, StringSoa )
+  DECLARE_STRING_KEYARRAY_FREE_SOA( FreeStringSoa, StringSoa, FreeValue )
+  DECLARE_STRING_KEYARRAY_INSERT_SOA( InsertStringSoa, StringSoa,
+      unsigned )
+  DECLARE_STRING_KEYARRAY_FINDINDEX_SIZE_SOA( FindStringSoa, StringSoa )
+  DECLARE_STRING_KEYARRAY_UNION_SOA( UnionStringSoa, StringSoa, unsigned,
+      CopyValue, CombineValue, FreeValue )
+  DECLARE_STRING_KEYARRAY_INTERSECT_SOA( IntersectStringSoa, StringSoa,
+      unsigned, CombineValue, FreeValue )
+  DECLARE_STRING_KEYARRAY_DIFFERENCE_SOA( DifferenceStringSoa, StringSoa,
+      unsigned, CopyValue, FreeValue )
+
+  DECLARE_STRING_KEYARRAY_TYPES_PREFIX( PrefixList, unsigned )
+  DECLARE_STRING_KEYARRAY_CREATE_PREFIX( CreatePrefix, PrefixList )
+  DECLARE_STRING_KEYARRAY_FREE_PREFIX( FreePrefix, PrefixList, FreeValue )
+  DECLARE_STRING_KEYARRAY_INSERT_PREFIX( InsertPrefix, PrefixList,
+      unsigned )
+  DECLARE_STRING_KEYARRAY_FINDINDEX_SIZE_PREFIX( FindPrefix, PrefixList )
+  DECLARE_STRING_KEYARRAY_UNION_PREFIX( UnionPrefix, PrefixList,
+      unsigned, CopyValue, CombineValue, FreeValue )
+  DECLARE_STRING_KEYARRAY_INTERSECT_PREFIX( IntersectPrefix, PrefixList,
+      unsigned, CombineValue, FreeValue )
+  DECLARE_STRING_KEYARRAY_DIFFERENCE_PREFIX( DifferencePrefix,
+      PrefixList, unsigned, CopyValue, FreeValue )
+
+  DECLARE_UINT_KEYARRAY_TYPES( UintList, unsigned )
+  DECLARE_UINT_KEYARRAY_CREATE( CreateUint, UintList )
+  DECLARE_UINT_KEYARRAY_FREE( FreeUint, UintList, FreeValue )
+  DECLARE_UINT_KEYARRAY_INSERT( InsertUint, UintList, unsigned )
+  DECLARE_UINT_KEYARRAY_FINDINDEX_SIZE( FindUint, UintList )
+  DECLARE_UINT_KEYARRAY_UNION( UnionUint, UintList, unsigned,
+      CopyValue, CombineValue, FreeValue )
+  DECLARE_UINT_KEYARRAY_INTERSECT( IntersectUint, UintList, unsigned,
+      CombineValue, FreeValue )
+  DECLARE_UINT_KEYARRAY_DIFFERENCE( DifferenceUint, UintList, unsigned,
+      CopyValue, FreeValue )
+
+  DECLARE_UINT_KEYARRAY_TYPES_SOA( UintSoa, unsigned )
+  DECLARE_UINT_KEYARRAY_CREATE_SOA( CreateUintSoa, UintSoa )
+  DECLARE_UINT_KEYARRAY_FREE_SOA( FreeUintSoa, UintSoa, FreeValue )
+  DECLARE_UINT_KEYARRAY_INSERT_SOA( InsertUintSoa, UintSoa, unsigned )
+  DECLARE_UINT_KEYARRAY_FINDINDEX_SIZE_SOA( FindUintSoa, UintSoa )
+  DECLARE_UINT_KEYARRAY_UNION_SOA( UnionUintSoa, UintSoa, unsigned,
+      CopyValue, CombineValue, FreeValue )
+  DECLARE_UINT_KEYARRAY_INTERSECT_SOA( IntersectUintSoa, UintSoa,
+      unsigned, CombineValue, FreeValue )
+  DECLARE_UINT_KEYARRAY_DIFFERENCE_SOA( DifferenceUintSoa, UintSoa,
+      unsigned, CopyValue, FreeValue )
+
+  DECLARE_CUSTOM_KEYARRAY_TYPES( PairList, PairKey, unsigned,
+      ComparePairKeys )
+  DECLARE_CUSTOM_KEYARRAY_CREATE( CreatePair, PairList )
+  DECLARE_CUSTOM_KEYARRAY_FREE( FreePair, PairList, FreeValue )
+  DECLARE_CUSTOM_KEYARRAY_INSERT( InsertPair, PairList, unsigned )
+  DECLARE_CUSTOM_KEYARRAY_FINDINDEX_SIZE( FindPair, PairList )
+  DECLARE_CUSTOM_KEYARRAY_UNION( UnionPair, PairList, unsigned,
+      CopyValue, CombineValue, FreeValue )
+  DECLARE_CUSTOM_KEYARRAY_INTERSECT( IntersectPair, PairList, unsigned,
+      CombineValue, FreeValue )
+  DECLARE_CUSTOM_KEYARRAY_DIFFERENCE( DifferencePair, PairList, unsigned,
+      CopyValue, FreeValue )
+
+/*
+ * List checks
+ */
+
+  /* Each check walks the keys of table set in order, beside the list,
+     so the list holds exactly the table's keys and data */
+
+  int CheckString( StringList* keyList, int set ) {
+    unsigned keyId;
+    size_t index = 0;
+
+    CHECK( keyList->itemCount == presentCount[set] );
+    for( keyId = 0; keyId < KEY_LIMIT; keyId++ ) {
+      if( present[set][keyId] ) {
+        CHECK( strcmp(keyList->item[index].key, keyName[keyId]) == 0 );
+        CHECK( keyList->item[index].data == value[set][keyId] );
+        CHECK( FindString(keyList, keyName[keyId]) == index );
+        index++;
+      }
+    }
+    return 1;
+  }
+
+  int CheckStringSoa( StringSoa* keyList, int set ) {
+    unsigned keyId;
+    size_t index = 0;
+
+    CHECK( keyList->itemCount == presentCount[set] );
+    for( keyId = 0; keyId < KEY_LIMIT; keyId++ ) {
+      if( present[set][keyId] ) {
+        CHECK( strcmp(keyList->keys[index], keyName[keyId]) == 0 );
+        CHECK( keyList->data[index] == value[set][keyId] );
+        CHECK( FindStringSoa(keyList, keyName[keyId]) == index );
+        index++;
+      }
+    }
+    return 1;
+  }
+
+  int CheckPrefix( PrefixList* keyList, int set ) {
+    unsigned keyId;
+    size_t index = 0;
+
+    CHECK( keyList->itemCount == presentCount[set] );
+    for( keyId = 0; keyId < KEY_LIMIT; keyId++ ) {
+      if( present[set][keyId] ) {
+        CHECK( strcmp(keyList->item[index].key, keyName[keyId]) == 0 );
+        CHECK( keyList->item[index].data == value[set][keyId] );
+        CHECK( FindPrefix(keyList, keyName[keyId]) == index );
+        index++;
+      }
+    }
+    return 1;
+  }
+
+  int CheckUint( UintList* keyList, int set ) {
+    unsigned keyId;
+    size_t index = 0;
+
+    CHECK( keyList->itemCount == presentCount[set] );
+    for( keyId = 0; keyId < KEY_LIMIT; keyId++ ) {
+      if( present[set][keyId] ) {
+        CHECK( keyList->item[index].key == keyId );
+        CHECK( keyList->item[index].data == value[set][keyId] );
+        CHECK( FindUint(keyList, keyId) == index );
+        index++;
+      }
+    }
+    return 1;
+  }
+
+  int CheckUintSoa( UintSoa* keyList, int set ) {
+    unsigned keyId;
+    size_t index = 0;
+
+    CHECK( keyList->itemCount == presentCount[set] );
+    for( keyId = 0; keyId < KEY_LIMIT; keyId++ ) {
+      if( present[set][keyId] ) {
+        CHECK( keyList->keys[index] == keyId );
+        CHECK( keyList->data[index] == value[set][keyId] );
+        CHECK( FindUintSoa(keyList, keyId) == index );
+        index++;
+      }
+    }
+    return 1;
+  }
+
+  int CheckPair( PairList* keyList, int set ) {
+    unsigned keyId;
+    size_t index = 0;
+
+    CHECK( keyList->itemCount == presentCount[set] );
+    for( keyId = 0; keyId < KEY_LIMIT; keyId++ ) {
+      if( present[set][keyId] ) {
+        CHECK( ComparePairKeys(keyList->item[index].key,
+            MakePairKey(keyId)) == 0 );
+        CHECK( keyList->item[index].data == value[set][keyId] );
+        CHECK( FindPair(keyList, MakePairKey(keyId)) == index );
+        index++;
+      }
+    }
+    return 1;
+  }
+
+/*
+ * Operations
+ */
+
+  /* Each test builds the left list, and the right list unless sameList
+     is non-zero, from the tables, then takes operation of them, and
+     checks the new list against the merged tables. Both lists must be
+     unchanged. */
+
+  int TestString( int operation, int sameList ) {
+    StringList* keyList[2] = { NULL, NULL };
+    StringList* newList = NULL;
+    unsigned keyId;
+    int set;
+    int result = 1;
+
+    for( set = LEFT_SET; set <= (sameList ? LEFT_SET : RIGHT_SET);
+        set++ ) {
+      keyList[set] = CreateString(0);
+      CHECK( keyList[set] != NULL );
+      for( keyId = 0; keyId < KEY_LIMIT; keyId++ ) {
+        if( present[set][keyId] ) {
+          CHECK( InsertString(keyList[set], keyName[keyId],
+              &(value[set][keyId])) );
+        }
+      }
+    }
+    if( sameList ) {
+      keyList[RIGHT_SET] = keyList[LEFT_SET];
+    }
+
+    StartOperation();
+    if( operation == KEYARRAY_SET_UNION ) {
+      newList = UnionString(keyList[LEFT_SET], keyList[RIGHT_SET]);
+    } else if( operation == KEYARRAY_SET_INTERSECT ) {
+      newList = IntersectString(keyList[LEFT_SET], keyList[RIGHT_SET]);
+    } else {
+      newList = DifferenceString(keyList[LEFT_SET], keyList[RIGHT_SET]);
+    }
+
+    result = CheckOperation(newList) &&
+        CheckString(keyList[LEFT_SET], LEFT_SET) &&
+        CheckString(keyList[RIGHT_SET], RIGHT_SET) &&
+        ((newList == NULL) || CheckString(newList, RESULT_SET));
+
+    FreeString( &newList );
+    FreeString( &(keyList[LEFT_SET]) );
+    if( sameList == 0 ) {
+      FreeString( &(keyList[RIGHT_SET]) );
+    }
+    return result;
+  }
+
+  int TestStringSoa( int operation, int sameList ) {
+    StringSoa* keyList[2] = { NULL, NULL };
+    StringSoa* newList = NULL;
+    unsigned keyId;
+    int set;
+    int result = 1;
+
+    for( set = LEFT_SET; set <= (sameList ? LEFT_SET : RIGHT_SET);
+        set++ ) {
+      keyList[set] = CreateStringSoa(0);
+      CHECK( keyList[set] != NULL );
+      for( keyId = 0; keyId < KEY_LIMIT; keyId++ ) {
+        if( present[set][keyId] ) {
+          CHECK( InsertStringSoa(keyList[set], keyName[keyId],
+              &(value[set][keyId])) );
+        }
+      }
+    }
+    if( sameList ) {
+      keyList[RIGHT_SET] = keyList[LEFT_SET];
+    }
+
+    StartOperation();
+    if( operation == KEYARRAY_SET_UNION ) {
+      newList = UnionStringSoa(keyList[LEFT_SET], keyList[RIGHT_SET]);
+    } else if( operation == KEYARRAY_SET_INTERSECT ) {
+      newList = IntersectStringSoa(keyList[LEFT_SET], keyList[RIGHT_SET]);
+    } else {
+      newList = DifferenceStringSoa(keyList[LEFT_SET],
+          keyList[RIGHT_SET]);
+    }
+
+    result = CheckOperation(newList) &&
+        CheckStringSoa(keyList[LEFT_SET], LEFT_SET) &&
+        CheckStringSoa(keyList[RIGHT_SET], RIGHT_SET) &&
+        ((newList == NULL) || CheckStringSoa(newList, RESULT_SET));
+
+    FreeStringSoa( &newList );
+    FreeStringSoa( &(keyList[LEFT_SET]) );
+    if( sameList == 0 ) {
+      FreeStringSoa( &(keyList[RIGHT_SET]) );
+    }
+    return result;
+  }
+
+  int TestPrefix( int operation, int sameList ) {
+    PrefixList* keyList[2] = { NULL, NULL };
+    PrefixList* newList = NULL;
+    unsigned keyId;
+    int set;
+    int result = 1;
+
+    for( set = LEFT_SET; set <= (sameList ? LEFT_SET : RIGHT_SET);
+        set++ ) {
+      keyList[set] = CreatePrefix(0);
+      CHECK( keyList[set] != NULL );
+      for( keyId = 0; keyId < KEY_LIMIT; keyId++ ) {
+        if( present[set][keyId] ) {
+          CHECK( InsertPrefix(keyList[set], keyName[keyId],
+              &(value[set][keyId])) );
+        }
+      }
+    }
+    if( sameList ) {
+      keyList[RIGHT_SET] = keyList[LEFT_SET];
+    }
+
+    StartOperation();
+    if( operation == KEYARRAY_SET_UNION ) {
+      newList = UnionPrefix(keyList[LEFT_SET], keyList[RIGHT_SET]);
+    } else if( operation == KEYARRAY_SET_INTERSECT ) {
+      newList = IntersectPrefix(keyList[LEFT_SET], keyList[RIGHT_SET]);
+    } else {
+      newList = DifferencePrefix(keyList[LEFT_SET], keyList[RIGHT_SET]);
+    }
+
+    result = CheckOperation(newList) &&
+        CheckPrefix(keyList[LEFT_SET], LEFT_SET) &&
+        CheckPrefix(keyList[RIGHT_SET], RIGHT_SET) &&
+        ((newList == NULL) || CheckPrefix(newList, RESULT_SET));
+
+    FreePrefix( &newList );
+    FreePrefix( &(keyList[LEFT_SET]) );
+    if( sameList == 0 ) {
+      FreePrefix( &(keyList[RIGHT_SET]) );
+    }
+    return result;
+  }
+
+  int TestUint( int operation, int sameList ) {
+    UintList* keyList[2] = { NULL, NULL };
+    UintList* newList = NULL;
+    unsigned keyId;
+    int set;
+    int result = 1;
+
+    for( set = LEFT_SET; set <= (sameList ? LEFT_SET : RIGHT_SET);
+        set++ ) {
+      keyList[set] = CreateUint(0);
+      CHECK( keyList[set] != NULL );
+      for( keyId = 0; keyId < KEY_LIMIT; keyId++ ) {
+        if( present[set][keyId] ) {
+          CHECK( InsertUint(keyList[set], keyId, &(value[set][keyId])) );
+        }
+      }
+    }
+    if( sameList ) {
+      keyList[RIGHT_SET] = keyList[LEFT_SET];
+    }
+
+    StartOperation();
+    if( operation == KEYARRAY_SET_UNION ) {
+      newList = UnionUint(keyList[LEFT_SET], keyList[RIGHT_SET]);
+    } else if( operation == KEYARRAY_SET_INTERSECT ) {
+      newList = IntersectUint(keyList[LEFT_SET], keyList[RIGHT_SET]);
+    } else {
+      newList = DifferenceUint(keyList[LEFT_SET], keyList[RIGHT_SET]);
+    }
+
+    result = CheckOperation(newList) &&
+        CheckUint(keyList[LEFT_SET], LEFT_SET) &&
+        CheckUint(keyList[RIGHT_SET], RIGHT_SET) &&
+        ((newList == NULL) || CheckUint(newList, RESULT_SET));
+
+    FreeUint( &newList );
+    FreeUint( &(keyList[LEFT_SET]) );
+    if( sameList == 0 ) {
+      FreeUint( &(keyList[RIGHT_SET]) );
+    }
+    return result;
+  }
+
+  int TestUintSoa( int operation, int sameList ) {
+    UintSoa* keyList[2] = { NULL, NULL };
+    UintSoa* newList = NULL;
+    unsigned keyId;
+    int set;
+    int result = 1;
+
+    for( set = LEFT_SET; set <= (sameList ? LEFT_SET : RIGHT_SET);
+        set++ ) {
+      keyList[set] = CreateUintSoa(0);
+      CHECK( keyList[set] != NULL );
+      for( keyId = 0; keyId < KEY_LIMIT; keyId++ ) {
+        if( present[set][keyId] ) {
+          CHECK( InsertUintSoa(keyList[set], keyId,
+              &(value[set][keyId])) );
+        }
+      }
+    }
+    if( sameList ) {
+      keyList[RIGHT_SET] = keyList[LEFT_SET];
+    }
+
+    StartOperation();
+    if( operation == KEYARRAY_SET_UNION ) {
+      newList = UnionUintSoa(keyList[LEFT_SET], keyList[RIGHT_SET]);
+    } else if( operation == KEYARRAY_SET_INTERSECT ) {
+      newList = IntersectUintSoa(keyList[LEFT_SET], keyList[RIGHT_SET]);
+    } else {
+      newList = DifferenceUintSoa(keyList[LEFT_SET], keyList[RIGHT_SET]);
+    }
+
+    result = CheckOperation(newList) &&
+        CheckUintSoa(keyList[LEFT_SET], LEFT_SET) &&
+        CheckUintSoa(keyList[RIGHT_SET], RIGHT_SET) &&
+        ((newList == NULL) || CheckUintSoa(newList, RESULT_SET));
+
+    FreeUintSoa( &newList );
+    FreeUintSoa( &(keyList[LEFT_SET]) );
+    if( sameList == 0 ) {
+      FreeUintSoa( &(keyList[RIGHT_SET]) );
+    }
+    return result;
+  }
+
+  int TestPair( int operation, int sameList ) {
+    PairList* keyList[2] = { NULL, NULL };
+    PairList* newList = NULL;
+    unsigned keyId;
+    int set;
+    int result = 1;
+
+    for( set = LEFT_SET; set <= (sameList ? LEFT_SET : RIGHT_SET);
+        set++ ) {
+      keyList[set] = CreatePair(0);
+      CHECK( keyList[set] != NULL );
+      for( keyId = 0; keyId < KEY_LIMIT; keyId++ ) {
+        if( present[set][keyId] ) {
+          CHECK( InsertPair(keyList[set], MakePairKey(keyId),
+              &(value[set][keyId])) );
+        }
+      }
+    }
+    if( sameList ) {
+      keyList[RIGHT_SET] = keyList[LEFT_SET];
+    }
+
+    StartOperation();
+    if( operation == KEYARRAY_SET_UNION ) {
+      newList = UnionPair(keyList[LEFT_SET], keyList[RIGHT_SET]);
+    } else if( operation == KEYARRAY_SET_INTERSECT ) {
+      newList = IntersectPair(keyList[LEFT_SET], keyList[RIGHT_SET]);
+    } else {
+      newList = DifferencePair(keyList[LEFT_SET], keyList[RIGHT_SET]);
+    }
+
+    result = CheckOperation(newList) &&
+        CheckPair(keyList[LEFT_SET], LEFT_SET) &&
+        CheckPair(keyList[RIGHT_SET], RIGHT_SET) &&
+        ((newList == NULL) || CheckPair(newList, RESULT_SET));
+
+    FreePair( &newList );
+    FreePair( &(keyList[LEFT_SET]) );
+    if( sameList == 0 ) {
+      FreePair( &(keyList[RIGHT_SET]) );
+    }
+    return result;
+  }
+
+/*
+ * Test rounds
+ */
+
+  int RunRound( unsigned round ) {
+    int sameList = ((round % 4) == 3);
+    int operation;
+
+    combinePolicy = (int)(NextRandom(&randomState) % 3);
+
+    FillSet( LEFT_SET );
+    if( sameList ) {
+      memcpy( present[RIGHT_SET], present[LEFT_SET],
+          sizeof(present[LEFT_SET]) );
+      memcpy( value[RIGHT_SET], value[LEFT_SET], sizeof(value[LEFT_SET]) );
+      presentCount[RIGHT_SET] = presentCount[LEFT_SET];
+    } else {
+      FillSet( RIGHT_SET );
+    }
+
+    for( operation = KEYARRAY_SET_UNION;
+        operation <= KEYARRAY_SET_DIFFERENCE; operation++ ) {
+      MergeSets( operation );
+
+      if( !(TestString(operation, sameList) &&
+          TestStringSoa(operation, sameList) &&
+          TestPrefix(operation, sameList) &&
+          TestUint(operation, sameList) &&
+          TestUintSoa(operation, sameList) &&
+          TestPair(operation, sameList)) ) {
+        printf( "  Failed operation %d, %u and %u keys, policy %d\n",
+            operation, (unsigned)presentCount[LEFT_SET],
+            (unsigned)presentCount[RIGHT_SET], combinePolicy );
+        return 0;
+      }
+    }
+
+    return 1;
+  }
+
+/*
+ * Main program
+ */
+
+  int main( int argc, char* argv[] ) {
+    unsigned seed = 1;
+    unsigned round;
+
+    if( argc > 1 ) {
+      seed = (unsigned)strtoul(argv[1], NULL, 10);
+    }
+    randomState = seed ? seed : 1;
+
+    MakeKeyNames();
+
+    for( round = 0; round < ROUND_COUNT; round++ ) {
+      if( !RunRound(round) ) {
+        printf( "setmodel: failed in round %u, seed %u\n", round, seed );
+        return 1;
+      }
+    }
+
+    printf( "setmodel: passed %u rounds, seed %u\n", ROUND_COUNT, seed );
+    return 0;
+  }
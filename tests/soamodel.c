@@ -0,0 +1,349 @@
+#include <stdio.h>
+
+#include "../keyarray.h"
+#include "model.h"
+
+/*
+ *  File: tests/soamodel.c
+ *  Status: Complete
+ *
+ *  Structure of Arrays Model Test: random operations checked against a
+ *  model
+ *
+ *  Runs the same random inserts, removes, modifies, retrieves, and
+ *  reserves on a string list and an unsigned list in the structure of
+ *  arrays layout, and checks every result against a table of the keys
+ *  that should be present. Unused space is released along the way.
+ *
+ *  Every CHECK_INTERVAL operations, and at the end of each round, the
+ *  key and data arrays of each list are walked in full, and a copy of
+ *  each list is checked the same way.
+ *
+ *  Build and run with the Makefile in this directory:
+ *    make check
+ *  or pass a seed, to repeat a run with other operations:
+ *    ./soamodel 12345
+ *
+ *  https://github.com/orlandol/keyarray
+ */
+
+/*
+ * Model declarations
+ */
+
+  #define KEY_LIMIT 3000
+  #define KEY_SIZE 16
+  #define ROUND_COUNT 24
+  #define STEP_COUNT 6000
+  #define CHECK_INTERVAL 500
+
+  char keyName[KEY_LIMIT][KEY_SIZE];
+  unsigned char present[KEY_LIMIT];
+  unsigned value[KEY_LIMIT];
+  size_t presentCount = 0;
+
+  void MakeKeyNames() {
+    unsigned keyId;
+
+    for( keyId = 0; keyId < KEY_LIMIT; keyId++ ) {
+      sprintf( keyName[keyId], "soa-%05u", keyId );
+    }
+  }
+
+  void ClearModel() {
+    memset( present, 0, sizeof(present) );
+    memset( value, 0, sizeof(value) );
+    presentCount = 0;
+  }
+
+  /* Returns the number of keys in the model less than keyId */
+  size_t CountBelow( unsigned keyId ) {
+    size_t count = 0;
+    unsigned modelId;
+
+    for( modelId = 0; modelId < keyId; modelId++ ) {
+      count += present[modelId];
+    }
+    return count;
+  }
+
+/*
+ * List declarations
+ */
+
+  int CopyValue( unsigned* dest, unsigned* source ) {
+    (*dest) = (*source);
+    return 1;
+  }
+
+  DECLARE_STRING_KEYARRAY_TYPES_SOA( StringSoa, unsigned )
+  DECLARE_STRING_KEYARRAY_CREATE_SOA( CreateStringSoa, StringSoa )
+  DECLARE_STRING_KEYARRAY_FREE_SOA( FreeStringSoa, StringSoa,
+      FreeNothing )
+  DECLARE_STRING_KEYARRAY_INSERT_SOA( InsertStringSoa, StringSoa,
+      unsigned )
+  DECLARE_STRING_KEYARRAY_RESERVE_SOA( ReserveStringSoa, StringSoa )
+  DECLARE_STRING_KEYARRAY_REMOVE_SOA( RemoveStringSoa, StringSoa,
+      FreeNothing )
+  DECLARE_STRING_KEYARRAY_RETRIEVE_SOA( RetrieveStringSoa, StringSoa,
+      unsigned )
+  DECLARE_STRING_KEYARRAY_MODIFY_SOA( ModifyStringSoa, StringSoa,
+      unsigned )
+  DECLARE_STRING_KEYARRAY_FINDINDEX_SOA( FindStringSoaInt, StringSoa )
+  DECLARE_STRING_KEYARRAY_FINDINDEX_SIZE_SOA( FindStringSoa, StringSoa )
+  DECLARE_STRING_KEYARRAY_RELEASEUNUSED_SOA( ReleaseStringSoa,
+      StringSoa )
+  DECLARE_STRING_KEYARRAY_COPY_SOA( CopyStringSoa, StringSoa, unsigned,
+      CopyValue, FreeNothing )
+
+  DECLARE_UINT_KEYARRAY_TYPES_SOA( UintSoa, unsigned )
+  DECLARE_UINT_KEYARRAY_CREATE_SOA( CreateUintSoa, UintSoa )
+  DECLARE_UINT_KEYARRAY_FREE_SOA( FreeUintSoa, UintSoa, FreeNothing )
+  DECLARE_UINT_KEYARRAY_INSERT_SOA( InsertUintSoa, UintSoa, unsigned )
+  DECLARE_UINT_KEYARRAY_RESERVE_SOA( ReserveUintSoa, UintSoa )
+  DECLARE_UINT_KEYARRAY_REMOVE_SOA( RemoveUintSoa, UintSoa, FreeNothing )
+  DECLARE_UINT_KEYARRAY_RETRIEVE_SOA( RetrieveUintSoa, UintSoa,
+      unsigned )
+  DECLARE_UINT_KEYARRAY_MODIFY_SOA( ModifyUintSoa, UintSoa, unsigned )
+  DECLARE_UINT_KEYARRAY_FINDINDEX_SOA( FindUintSoaInt, UintSoa )
+  DECLARE_UINT_KEYARRAY_FINDINDEX_SIZE_SOA( FindUintSoa, UintSoa )
+  DECLARE_UINT_KEYARRAY_RELEASEUNUSED_SOA( ReleaseUintSoa, UintSoa )
+  DECLARE_UINT_KEYARRAY_COPY_SOA( CopyUintSoa, UintSoa, unsigned,
+      CopyValue, FreeNothing )
+
+  StringSoa* stringSoa = NULL;
+  UintSoa* uintSoa = NULL;
+
+/*
+ * List checks
+ */
+
+  /* Walks the key and data arrays in full. Keys are in strictly
+     increasing order, and as many as in the model, so the list holds
+     exactly the model's keys. */
+  int CheckStringSoa( StringSoa* keyList ) {
+    unsigned keyId;
+    size_t index;
+
+    CHECK( keyList->itemCount == presentCount );
+    CHECK( keyList->itemCount <= keyList->reservedCount );
+    for( index = 0; index < keyList->itemCount; index++ ) {
+      keyId = (unsigned)strtoul(keyList->keys[index] + 4, NULL, 10);
+      CHECK( keyId < KEY_LIMIT );
+      CHECK( strcmp(keyList->keys[index], keyName[keyId]) == 0 );
+      CHECK( present[keyId] );
+      CHECK( keyList->data[index] == value[keyId] );
+      if( index ) {
+        CHECK( strcmp(keyList->keys[index - 1], keyList->keys[index]) < 0 );
+      }
+    }
+    return 1;
+  }
+
+  int CheckUintSoa( UintSoa* keyList ) {
+    unsigned keyId;
+    size_t index;
+
+    CHECK( keyList->itemCount == presentCount );
+    CHECK( keyList->itemCount <= keyList->reservedCount );
+    for( index = 0; index < keyList->itemCount; index++ ) {
+      keyId = keyList->keys[index];
+      CHECK( keyId < KEY_LIMIT );
+      CHECK( present[keyId] );
+      CHECK( keyList->data[index] == value[keyId] );
+      if( index ) {
+        CHECK( keyList->keys[index - 1] < keyId );
+      }
+    }
+    return 1;
+  }
+
+  /* Checks each list, and a copy of each list */
+  int CheckLists() {
+    StringSoa* stringCopy = NULL;
+    UintSoa* uintCopy = NULL;
+    int result;
+
+    CHECK( CheckStringSoa(stringSoa) );
+    CHECK( CheckUintSoa(uintSoa) );
+
+    stringCopy = CopyStringSoa(stringSoa);
+    uintCopy = CopyUintSoa(uintSoa);
+    result = stringCopy && uintCopy && CheckStringSoa(stringCopy) &&
+        CheckUintSoa(uintCopy);
+
+    FreeStringSoa( &stringCopy );
+    FreeUintSoa( &uintCopy );
+
+    CHECK( result );
+    return 1;
+  }
+
+/*
+ * Operations
+ */
+
+  int TestInsert( unsigned keyId ) {
+    unsigned data = NextRandom(&randomState);
+    int expected = (present[keyId] == 0);
+
+    CHECK( (InsertStringSoa(stringSoa, keyName[keyId], &data) != 0) ==
+        expected );
+    CHECK( (InsertUintSoa(uintSoa, keyId, &data) != 0) == expected );
+
+    if( expected ) {
+      present[keyId] = 1;
+      value[keyId] = data;
+      presentCount++;
+    }
+    return 1;
+  }
+
+  int TestRemove( unsigned keyId ) {
+    RemoveStringSoa( stringSoa, keyName[keyId] );
+    RemoveUintSoa( uintSoa, keyId );
+
+    if( present[keyId] ) {
+      present[keyId] = 0;
+      presentCount--;
+    }
+    return 1;
+  }
+
+  int TestModify( unsigned keyId ) {
+    unsigned data = NextRandom(&randomState);
+    int expected = present[keyId];
+
+    CHECK( (ModifyStringSoa(stringSoa, keyName[keyId], &data) != 0) ==
+        expected );
+    CHECK( (ModifyUintSoa(uintSoa, keyId, &data) != 0) == expected );
+
+    if( expected ) {
+      value[keyId] = data;
+    }
+    return 1;
+  }
+
+  int TestRetrieve( unsigned keyId ) {
+    int expected = present[keyId];
+    size_t index = expected ? CountBelow(keyId) : (size_t)-1;
+    unsigned data;
+
+    data = ~value[keyId];
+    CHECK( (RetrieveStringSoa(stringSoa, keyName[keyId], &data) != 0) ==
+        expected );
+    CHECK( (expected == 0) || (data == value[keyId]) );
+
+    data = ~value[keyId];
+    CHECK( (RetrieveUintSoa(uintSoa, keyId, &data) != 0) == expected );
+    CHECK( (expected == 0) || (data == value[keyId]) );
+
+    CHECK( FindStringSoa(stringSoa, keyName[keyId]) == index );
+    CHECK( FindStringSoaInt(stringSoa, keyName[keyId]) ==
+        (expected ? (int)index : -1) );
+    CHECK( FindUintSoa(uintSoa, keyId) == index );
+    CHECK( FindUintSoaInt(uintSoa, keyId) ==
+        (expected ? (int)index : -1) );
+    return 1;
+  }
+
+  /* Reserves room for more items, or releases unused space */
+  int TestReserve() {
+    size_t reserveCount = presentCount +
+        (NextRandom(&randomState) % 256);
+
+    if( NextRandom(&randomState) % 2 ) {
+      CHECK( ReserveStringSoa(stringSoa, reserveCount) );
+      CHECK( ReserveUintSoa(uintSoa, reserveCount) );
+      CHECK( stringSoa->reservedCount >= reserveCount );
+      CHECK( uintSoa->reservedCount >= reserveCount );
+    } else {
+      ReleaseStringSoa( stringSoa );
+      ReleaseUintSoa( uintSoa );
+    }
+    return 1;
+  }
+
+/*
+ * Test rounds
+ */
+
+  int RunRound() {
+    unsigned keyRange = 1 + (NextRandom(&randomState) % KEY_LIMIT);
+    unsigned step;
+    unsigned keyId;
+    int result = 1;
+
+    for( step = 0; result && (step < STEP_COUNT); step++ ) {
+      keyId = NextRandom(&randomState) % keyRange;
+
+      switch( NextRandom(&randomState) % 16 ) {
+      case 0: case 1: case 2: case 3: case 4:
+        result = TestInsert(keyId);
+        break;
+
+      case 5: case 6: case 7: case 8:
+        result = TestRemove(keyId);
+        break;
+
+      case 9: case 10:
+        result = TestModify(keyId);
+        break;
+
+      case 15:
+        result = TestReserve();
+        break;
+
+      default:
+        result = TestRetrieve(keyId);
+        break;
+      }
+
+      if( result && ((step % CHECK_INTERVAL) == 0) ) {
+        result = CheckLists();
+      }
+
+      if( result == 0 ) {
+        printf( "  Failed at step %u, key %u\n", step, keyId );
+      }
+    }
+
+    return result && CheckLists();
+  }
+
+/*
+ * Main program
+ */
+
+  int main( int argc, char* argv[] ) {
+    unsigned seed = 1;
+    unsigned round;
+
+    if( argc > 1 ) {
+      seed = (unsigned)strtoul(argv[1], NULL, 10);
+    }
+    randomState = seed ? seed : 1;
+
+    MakeKeyNames();
+
+    for( round = 0; round < ROUND_COUNT; round++ ) {
+      ClearModel();
+      stringSoa = CreateStringSoa(NextRandom(&randomState) % 64);
+      uintSoa = CreateUintSoa(NextRandom(&randomState) % 64);
+      if( !(stringSoa && uintSoa) ) {
+        printf( "Error allocating lists\n" );
+        return 1;
+      }
+
+      if( RunRound() == 0 ) {
+        printf( "soamodel: failed in round %u, seed %u\n", round, seed );
+        return 1;
+      }
+
+      FreeStringSoa( &stringSoa );
+      FreeUintSoa( &uintSoa );
+    }
+
+    printf( "soamodel: passed %u rounds, seed %u\n", ROUND_COUNT, seed );
+    return 0;
+  }
@@ -0,0 +1,471 @@
+/* Declares clock_gettime, with -std=c99 */
+#define _POSIX_C_SOURCE 199309L
+
+#include <stdio.h>
+
+/* Records operation statistics. The Makefile also passes
+   -DKEYARRAY_STATS, so that the build flag itself is tested. */
+#ifndef KEYARRAY_STATS
+  #define KEYARRAY_STATS
+#endif
+
+#include "../keyarray.h"
+#include "model.h"
+
+/*
+ *  File: tests/statmodel.c
+ *  Status: Complete
+ *
+ *  Operation Statistics Model Test: counters checked against a model
+ *
+ *  Runs the same random inserts, upserts, removes, retrieves,
+ *  modifies, and find index calls on a string list, an unsigned list,
+ *  and a custom key list, and counts what each call should record:
+ *  calls per operation, bytes moved, reallocs, and the peak reserved
+ *  count. Every few hundred steps, checks each list's statistics
+ *  against the counts, checks that every search made at least one key
+ *  comparison, and that the latency histogram and percentiles agree
+ *  with the operation count. Some checks also reset the statistics.
+ *
+ *  Build and run with the Makefile in this directory:
+ *    make check
+ *  or pass a seed, to repeat a run with other operations:
+ *    ./statmodel 12345
+ *
+ *  https://github.com/orlandol/keyarray
+ */
+
+/*
+ * Model declarations
+ */
+
+  #define KEY_LIMIT 2000
+  #define KEY_SIZE 16
+  #define ROUND_COUNT 24
+  #define STEP_COUNT 4000
+  #define LIST_COUNT 3
+
+  char keyName[KEY_LIMIT][KEY_SIZE];
+  unsigned char present[KEY_LIMIT];
+  unsigned value[KEY_LIMIT];
+  size_t presentCount = 0;
+
+  /* What the statistics should hold since they were last reset. The
+     lists change in step, so that only reallocs and the peak reserved
+     count, which depend on each list's growth, are kept per list. */
+  uint64_t callCount[KEYARRAY_STATS_OPERATIONS];
+  uint64_t movedItems[KEYARRAY_STATS_OPERATIONS];
+  uint64_t searchCount[KEYARRAY_STATS_OPERATIONS];
+  uint64_t reallocCount[LIST_COUNT];
+  size_t peakReservedCount[LIST_COUNT];
+
+  void MakeKeyNames() {
+    unsigned keyId;
+
+    for( keyId = 0; keyId < KEY_LIMIT; keyId++ ) {
+      sprintf( keyName[keyId], "stat-%05u", keyId );
+    }
+  }
+
+  void ClearModel() {
+    memset( present, 0, sizeof(present) );
+    memset( value, 0, sizeof(value) );
+    presentCount = 0;
+  }
+
+  /* Clears the expected statistics, as a reset does */
+  void ClearExpected() {
+    memset( callCount, 0, sizeof(callCount) );
+    memset( movedItems, 0, sizeof(movedItems) );
+    memset( searchCount, 0, sizeof(searchCount) );
+    memset( reallocCount, 0, sizeof(reallocCount) );
+  }
+
+  /* Returns the number of keys in the model greater than keyId */
+  size_t CountAbove( unsigned keyId ) {
+    size_t count = 0;
+    unsigned modelId;
+
+    for( modelId = keyId + 1; modelId < KEY_LIMIT; modelId++ ) {
+      count += present[modelId];
+    }
+    return count;
+  }
+
+/*
+ * List declarations
+ */
+
+  typedef struct PairKey {
+    unsigned high;
+    unsigned low;
+  } PairKey;
+
+  int ComparePairKeys( PairKey leftKey, PairKey rightKey ) {
+    if( leftKey.high != rightKey.high ) {
+      return (leftKey.high < rightKey.high) ? -1 : 1;
+    }
+    if( leftKey.low != rightKey.low ) {
+      return (leftKey.low < rightKey.low) ? -1 : 1;
+    }
+    return 0;
+  }
+
+  PairKey MakePairKey( unsigned keyId ) {
+    PairKey key;
+
+    key.high = keyId >> 4;
+    key.low = keyId & 15;
+    return key;
+  }
+
+  DECLARE_STRING_KEYARRAY_TYPES( StringList, unsigned )
+  DECLARE_STRING_KEYARRAY_CREATE( CreateString, StringList )
+  DECLARE_STRING_KEYARRAY_FREE( FreeString, StringList, FreeNothing )
+  DECLARE_STRING_KEYARRAY_INSERT( InsertString, StringList, unsigned )
+  DECLARE_STRING_KEYARRAY_UPSERT( UpsertString, StringList, unsigned )
+  DECLARE_STRING_KEYARRAY_RESERVE( ReserveString, StringList )
+  DECLARE_STRING_KEYARRAY_REMOVE( RemoveString, StringList, FreeNothing )
+  DECLARE_STRING_KEYARRAY_RETRIEVE( RetrieveString, StringList,
+      unsigned )
+  DECLARE_STRING_KEYARRAY_MODIFY( ModifyString, StringList, unsigned )
+  DECLARE_STRING_KEYARRAY_FINDINDEX_SIZE( FindString, StringList )
+  DECLARE_STRING_KEYARRAY_STATS( StatsString, StringList )
+
+  DECLARE_UINT_KEYARRAY_TYPES( UintList, unsigned )
+  DECLARE_UINT_KEYARRAY_CREATE( CreateUint, UintList )
+  DECLARE_UINT_KEYARRAY_FREE( FreeUint, UintList, FreeNothing )
+  DECLARE_UINT_KEYARRAY_INSERT( InsertUint, UintList, unsigned )
+  DECLARE_UINT_KEYARRAY_UPSERT( UpsertUint, UintList, unsigned )
+  DECLARE_UINT_KEYARRAY_RESERVE( ReserveUint, UintList )
+  DECLARE_UINT_KEYARRAY_REMOVE( RemoveUint, UintList, FreeNothing )
+  DECLARE_UINT_KEYARRAY_RETRIEVE( RetrieveUint, UintList, unsigned )
+  DECLARE_UINT_KEYARRAY_MODIFY( ModifyUint, UintList, unsigned )
+  DECLARE_UINT_KEYARRAY_FINDINDEX_SIZE( FindUint, UintList )
+  DECLARE_UINT_KEYARRAY_STATS( StatsUint, UintList )
+
+  DECLARE_CUSTOM_KEYARRAY_TYPES( PairList, PairKey, unsigned,
+      ComparePairKeys )
+  DECLARE_CUSTOM_KEYARRAY_CREATE( CreatePair, PairList )
+  DECLARE_CUSTOM_KEYARRAY_FREE( FreePair, PairList, FreeNothing )
+  DECLARE_CUSTOM_KEYARRAY_INSERT( InsertPair, PairList, unsigned )
+  DECLARE_CUSTOM_KEYARRAY_UPSERT( UpsertPair, PairList, unsigned )
+  DECLARE_CUSTOM_KEYARRAY_RESERVE( ReservePair, PairList )
+  DECLARE_CUSTOM_KEYARRAY_REMOVE( RemovePair, PairList, FreeNothing )
+  DECLARE_CUSTOM_KEYARRAY_RETRIEVE( RetrievePair, PairList, unsigned )
+  DECLARE_CUSTOM_KEYARRAY_MODIFY( ModifyPair, PairList, unsigned )
+  DECLARE_CUSTOM_KEYARRAY_FINDINDEX_SIZE( FindPair, PairList )
+  DECLARE_CUSTOM_KEYARRAY_STATS( StatsPair, PairList )
+
+  StringList* stringList = NULL;
+  UintList* uintList = NULL;
+  PairList* pairList = NULL;
+
+  /* Reserved counts before a call, to tell which calls grew a list */
+  size_t lastReserved[LIST_COUNT];
+
+/*
+ * List checks
+ */
+
+  /* Checks one list's statistics against the expected counts */
+  int CheckStats( const KeyArrayStats* stats, size_t itemSize,
+      size_t listIndex ) {
+    const KeyArrayOperationStats* operationStats;
+    uint64_t histogramCount;
+    uint64_t reallocTotal = 0;
+    size_t operation;
+    size_t bucket;
+
+    for( operation = 0; operation < KEYARRAY_STATS_OPERATIONS;
+        operation++ ) {
+      operationStats = &(stats->operation[operation]);
+      CHECK( operationStats->count == callCount[operation] );
+      CHECK( operationStats->moveBytes ==
+          (movedItems[operation] * itemSize) );
+      CHECK( operationStats->compareCount >= searchCount[operation] );
+      reallocTotal += operationStats->reallocCount;
+
+      histogramCount = 0;
+      for( bucket = 0; bucket < KEYARRAY_STATS_BUCKETS; bucket++ ) {
+        histogramCount += operationStats->histogram[bucket];
+      }
+      CHECK( histogramCount == operationStats->count );
+      CHECK( operationStats->maxNs <= operationStats->totalNs );
+      CHECK( KeyArrayStatsPercentile(operationStats, 50) <=
+          KeyArrayStatsPercentile(operationStats, 99) );
+      CHECK( KeyArrayStatsPercentile(operationStats, 99) <=
+          operationStats->maxNs );
+    }
+
+    /* Only insert, and upsert, which is recorded as insert, grow */
+    CHECK( reallocTotal == reallocCount[listIndex] );
+    CHECK( stats->operation[KEYARRAY_STATS_INSERT].reallocCount ==
+        reallocTotal );
+    CHECK( stats->peakReservedCount == peakReservedCount[listIndex] );
+
+    return 1;
+  }
+
+  /* Checks every list's statistics, then resets them if resetStats is
+     non-zero, and checks that they were cleared */
+  int CheckAllStats( int resetStats ) {
+    KeyArrayStats stats;
+
+    CHECK( StatsString(stringList, &stats, resetStats) );
+    CHECK( CheckStats(&stats, sizeof(StringListItem), 0) );
+    CHECK( StatsUint(uintList, &stats, resetStats) );
+    CHECK( CheckStats(&stats, sizeof(UintListItem), 1) );
+    CHECK( StatsPair(pairList, &stats, resetStats) );
+    CHECK( CheckStats(&stats, sizeof(PairListItem), 2) );
+
+    if( resetStats == 0 ) {
+      return 1;
+    }
+
+    ClearExpected();
+    peakReservedCount[0] = stringList->reservedCount;
+    peakReservedCount[1] = uintList->reservedCount;
+    peakReservedCount[2] = pairList->reservedCount;
+
+    CHECK( StatsString(stringList, &stats, 0) );
+    CHECK( CheckStats(&stats, sizeof(StringListItem), 0) );
+    CHECK( StatsUint(uintList, &stats, 0) );
+    CHECK( CheckStats(&stats, sizeof(UintListItem), 1) );
+    CHECK( StatsPair(pairList, &stats, 0) );
+    CHECK( CheckStats(&stats, sizeof(PairListItem), 2) );
+
+    return 1;
+  }
+
+/*
+ * Operations
+ */
+
+  void SaveReserved() {
+    lastReserved[0] = stringList->reservedCount;
+    lastReserved[1] = uintList->reservedCount;
+    lastReserved[2] = pairList->reservedCount;
+  }
+
+  /* Counts one timed call of operation on every list, and any growth
+     since SaveReserved */
+  void CountCall( int operation ) {
+    size_t reservedCount[LIST_COUNT];
+    size_t listIndex;
+
+    reservedCount[0] = stringList->reservedCount;
+    reservedCount[1] = uintList->reservedCount;
+    reservedCount[2] = pairList->reservedCount;
+
+    callCount[operation]++;
+    for( listIndex = 0; listIndex < LIST_COUNT; listIndex++ ) {
+      if( reservedCount[listIndex] != lastReserved[listIndex] ) {
+        reallocCount[listIndex]++;
+      }
+      if( reservedCount[listIndex] > peakReservedCount[listIndex] ) {
+        peakReservedCount[listIndex] = reservedCount[listIndex];
+      }
+    }
+  }
+
+  /* Inserts keyId, with insert or upsert */
+  int TestInsert( unsigned keyId, int useUpsert ) {
+    unsigned data = NextRandom(&randomState);
+    int expected = (present[keyId] == 0);
+    int inserted = 0;
+
+    SaveReserved();
+    if( useUpsert ) {
+      CHECK( UpsertString(stringList, keyName[keyId], &data, &inserted) );
+      CHECK( inserted == expected );
+      CHECK( UpsertUint(uintList, keyId, &data, &inserted) );
+      CHECK( inserted == expected );
+      CHECK( UpsertPair(pairList, MakePairKey(keyId), &data, &inserted) );
+      CHECK( inserted == expected );
+    } else {
+      CHECK( (InsertString(stringList, keyName[keyId], &data) != 0) ==
+          expected );
+      CHECK( (InsertUint(uintList, keyId, &data) != 0) == expected );
+      CHECK( (InsertPair(pairList, MakePairKey(keyId), &data) != 0) ==
+          expected );
+    }
+    CountCall( KEYARRAY_STATS_INSERT );
+
+    if( expected ) {
+      movedItems[KEYARRAY_STATS_INSERT] += CountAbove(keyId);
+      present[keyId] = 1;
+      value[keyId] = data;
+      presentCount++;
+    }
+
+    return 1;
+  }
+
+  int TestRemove( unsigned keyId ) {
+    SaveReserved();
+    RemoveString( stringList, keyName[keyId] );
+    RemoveUint( uintList, keyId );
+    RemovePair( pairList, MakePairKey(keyId) );
+    CountCall( KEYARRAY_STATS_REMOVE );
+
+    if( present[keyId] ) {
+      movedItems[KEYARRAY_STATS_REMOVE] += CountAbove(keyId);
+      present[keyId] = 0;
+      value[keyId] = 0;
+      presentCount--;
+    }
+
+    return 1;
+  }
+
+  /* Looks keyId up with retrieve, modify, or find index */
+  int TestLookup( unsigned keyId, int operation ) {
+    unsigned data = NextRandom(&randomState);
+    int expected = present[keyId];
+
+    if( presentCount ) {
+      searchCount[operation]++;
+    }
+
+    SaveReserved();
+    if( operation == KEYARRAY_STATS_RETRIEVE ) {
+      CHECK( (RetrieveString(stringList, keyName[keyId], &data) != 0) ==
+          expected );
+      CHECK( (RetrieveUint(uintList, keyId, &data) != 0) == expected );
+      CHECK( (RetrievePair(pairList, MakePairKey(keyId), &data) != 0) ==
+          expected );
+    } else if( operation == KEYARRAY_STATS_MODIFY ) {
+      CHECK( (ModifyString(stringList, keyName[keyId], &data) != 0) ==
+          expected );
+      CHECK( (ModifyUint(uintList, keyId, &data) != 0) == expected );
+      CHECK( (ModifyPair(pairList, MakePairKey(keyId), &data) != 0) ==
+          expected );
+      if( expected ) {
+        value[keyId] = data;
+      }
+    } else {
+      CHECK( (FindString(stringList, keyName[keyId]) != ((size_t)-1)) ==
+          expected );
+      CHECK( (FindUint(uintList, keyId) != ((size_t)-1)) == expected );
+      CHECK( (FindPair(pairList, MakePairKey(keyId)) != ((size_t)-1)) ==
+          expected );
+    }
+    CountCall( operation );
+
+    return 1;
+  }
+
+  /* Reserves room on every list. Reserve is not timed, so it counts
+     nothing, though later inserts may then grow less. */
+  int TestReserve() {
+    size_t reserveCount = presentCount + (NextRandom(&randomState) % 64);
+
+    CHECK( ReserveString(stringList, reserveCount) );
+    CHECK( ReserveUint(uintList, reserveCount) );
+    CHECK( ReservePair(pairList, reserveCount) );
+
+    return 1;
+  }
+
+  int TestStep( unsigned keyId ) {
+    switch( NextRandom(&randomState) % 8 ) {
+    case 0:
+    case 1:
+      return TestInsert(keyId, 0);
+
+    case 2:
+      return TestInsert(keyId, 1);
+
+    case 3:
+      return TestRemove(keyId);
+
+    case 4:
+      return TestLookup(keyId, KEYARRAY_STATS_RETRIEVE);
+
+    case 5:
+      return TestLookup(keyId, KEYARRAY_STATS_MODIFY);
+
+    case 6:
+      return TestLookup(keyId, KEYARRAY_STATS_FINDINDEX);
+
+    default:
+      if( (NextRandom(&randomState) % 32) == 0 ) {
+        return TestReserve();
+      }
+      return TestInsert(keyId, 0);
+    }
+  }
+
+/*
+ * Test rounds
+ */
+
+  int RunRound( unsigned round ) {
+    unsigned keyRange = 1 + (NextRandom(&randomState) % KEY_LIMIT);
+    unsigned checkInterval = 1 + (NextRandom(&randomState) % 500);
+    unsigned keyId = 0;
+    unsigned step;
+    int result = 1;
+
+    (void)round;
+
+    ClearModel();
+    ClearExpected();
+    memset( peakReservedCount, 0, sizeof(peakReservedCount) );
+
+    stringList = CreateString(0);
+    uintList = CreateUint(0);
+    pairList = CreatePair(0);
+    CHECK( stringList && uintList && pairList );
+
+    /* A new list has recorded nothing */
+    result = CheckAllStats(0);
+
+    for( step = 0; result && (step < STEP_COUNT); step++ ) {
+      keyId = NextRandom(&randomState) % keyRange;
+      result = TestStep(keyId);
+
+      if( result && ((step % checkInterval) == 0) ) {
+        result = CheckAllStats(NextRandom(&randomState) % 2);
+      }
+    }
+
+    if( result == 0 ) {
+      printf( "  Failed at step %u, key %u\n", step - 1, keyId );
+    }
+
+    result = result && CheckAllStats(1);
+
+    FreeString( &stringList );
+    FreeUint( &uintList );
+    FreePair( &pairList );
+
+    return result;
+  }
+
+/*
+ * Main program
+ */
+
+  int main( int argc, char* argv[] ) {
+    unsigned seed = 1;
+    unsigned round;
+
+    if( argc > 1 ) {
+      seed = (unsigned)strtoul(argv[1], NULL, 10);
+    }
+    randomState = seed ? seed : 1;
+
+    MakeKeyNames();
+
+    for( round = 0; round < ROUND_COUNT; round++ ) {
+      if( !RunRound(round) ) {
+        printf( "statmodel: failed in round %u, seed %u\n", round, seed );
+        return 1;
+      }
+    }
+
+    printf( "statmodel: passed %u rounds, seed %u\n", ROUND_COUNT, seed );
+    return 0;
+  }
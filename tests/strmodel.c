@@ -0,0 +1,413 @@
+#include <stdio.h>
+
+#include "../keyarray.h"
+#include "model.h"
+
+/*
+ *  File: tests/strmodel.c
+ *  Status: Complete
+ *
+ *  String Key Model Test: random operations checked against a model
+ *
+ *  Runs the same random inserts, removes, modifies, and retrieves on an
+ *  array of structures list, a structure of arrays list, and a key
+ *  prefix list, and checks every result against a table of the keys that
+ *  should be present. The hash index of each list is switched on and off
+ *  along the way, so that lookups run through the hash index edit log
+ *  both before and after it is applied.
+ *
+ *  Every CHECK_INTERVAL operations, and at the end of each round, each
+ *  list is walked in full, and a copy of it is checked the same way.
+ *
+ *  Build and run with the Makefile in this directory:
+ *    make check
+ *  or pass a seed, to repeat a run with other operations:
+ *    ./strmodel 12345
+ *
+ *  https://github.com/orlandol/keyarray
+ */
+
+/*
+ * Model declarations
+ */
+
+  #define KEY_LIMIT 3000
+  #define KEY_SIZE 48
+  #define ROUND_COUNT 24
+  #define STEP_COUNT 6000
+  #define CHECK_INTERVAL 500
+
+  char keyName[KEY_LIMIT][KEY_SIZE];
+  unsigned char present[KEY_LIMIT];
+  unsigned value[KEY_LIMIT];
+  size_t presentCount = 0;
+
+  /* Keys are short, or share a prefix longer than the inline key prefix,
+     so that prefix ties are decided by the key strings */
+  void MakeKeyNames() {
+    unsigned keyId;
+
+    for( keyId = 0; keyId < KEY_LIMIT; keyId++ ) {
+      switch( keyId % 3 ) {
+      case 0:
+        sprintf( keyName[keyId], "%u", keyId );
+        break;
+
+      case 1:
+        sprintf( keyName[keyId], "key-%u", keyId );
+        break;
+
+      default:
+        sprintf( keyName[keyId], "https://example.com/keyarray/%u", keyId );
+        break;
+      }
+    }
+  }
+
+  /* Returns the key id of a key name, from its trailing digits */
+  unsigned KeyIdOf( const char* key ) {
+    const char* digits = key + strlen(key);
+
+    while( (digits > key) && (digits[-1] >= '0') && (digits[-1] <= '9') ) {
+      digits--;
+    }
+    return (unsigned)strtoul(digits, NULL, 10);
+  }
+
+  void ClearModel() {
+    memset( present, 0, sizeof(present) );
+    memset( value, 0, sizeof(value) );
+    presentCount = 0;
+  }
+
+/*
+ * List declarations
+ */
+
+  int CopyValue( unsigned* dest, unsigned* source ) {
+    (*dest) = (*source);
+    return 1;
+  }
+
+  DECLARE_STRING_KEYARRAY_TYPES( AosList, unsigned )
+  DECLARE_STRING_KEYARRAY_CREATE( CreateAos, AosList )
+  DECLARE_STRING_KEYARRAY_FREE( FreeAos, AosList, FreeNothing )
+  DECLARE_STRING_KEYARRAY_INSERT( InsertAos, AosList, unsigned )
+  DECLARE_STRING_KEYARRAY_REMOVE( RemoveAos, AosList, FreeNothing )
+  DECLARE_STRING_KEYARRAY_RETRIEVE( RetrieveAos, AosList, unsigned )
+  DECLARE_STRING_KEYARRAY_MODIFY( ModifyAos, AosList, unsigned )
+  DECLARE_STRING_KEYARRAY_FINDINDEX( FindAos, AosList )
+  DECLARE_STRING_KEYARRAY_RELEASEUNUSED( ReleaseAos, AosList )
+  DECLARE_STRING_KEYARRAY_COPY( CopyAos, AosList, unsigned,
+      CopyValue, FreeNothing )
+  DECLARE_STRING_KEYARRAY_HASHINDEX( HashAos, AosList )
+
+  DECLARE_STRING_KEYARRAY_TYPES_SOA( SoaList, unsigned )
+  DECLARE_STRING_KEYARRAY_CREATE_SOA( CreateSoa, SoaList )
+  DECLARE_STRING_KEYARRAY_FREE_SOA( FreeSoa, SoaList, FreeNothing )
+  DECLARE_STRING_KEYARRAY_INSERT_SOA( InsertSoa, SoaList, unsigned )
+  DECLARE_STRING_KEYARRAY_REMOVE_SOA( RemoveSoa, SoaList, FreeNothing )
+  DECLARE_STRING_KEYARRAY_RETRIEVE_SOA( RetrieveSoa, SoaList, unsigned )
+  DECLARE_STRING_KEYARRAY_MODIFY_SOA( ModifySoa, SoaList, unsigned )
+  DECLARE_STRING_KEYARRAY_FINDINDEX_SOA( FindSoa, SoaList )
+  DECLARE_STRING_KEYARRAY_RELEASEUNUSED_SOA( ReleaseSoa, SoaList )
+  DECLARE_STRING_KEYARRAY_COPY_SOA( CopySoa, SoaList, unsigned,
+      CopyValue, FreeNothing )
+  DECLARE_STRING_KEYARRAY_HASHINDEX_SOA( HashSoa, SoaList )
+
+  DECLARE_STRING_KEYARRAY_TYPES_PREFIX( PrefixList, unsigned )
+  DECLARE_STRING_KEYARRAY_CREATE_PREFIX( CreatePrefix, PrefixList )
+  DECLARE_STRING_KEYARRAY_FREE_PREFIX( FreePrefix, PrefixList, FreeNothing )
+  DECLARE_STRING_KEYARRAY_INSERT_PREFIX( InsertPrefix, PrefixList,
+      unsigned )
+  DECLARE_STRING_KEYARRAY_REMOVE_PREFIX( RemovePrefix, PrefixList,
+      FreeNothing )
+  DECLARE_STRING_KEYARRAY_RETRIEVE_PREFIX( RetrievePrefix, PrefixList,
+      unsigned )
+  DECLARE_STRING_KEYARRAY_MODIFY_PREFIX( ModifyPrefix, PrefixList,
+      unsigned )
+  DECLARE_STRING_KEYARRAY_FINDINDEX_PREFIX( FindPrefix, PrefixList )
+  DECLARE_STRING_KEYARRAY_RELEASEUNUSED_PREFIX( ReleasePrefix,
+      PrefixList )
+  DECLARE_STRING_KEYARRAY_COPY_PREFIX( CopyPrefix, PrefixList, unsigned,
+      CopyValue, FreeNothing )
+  DECLARE_STRING_KEYARRAY_HASHINDEX_PREFIX( HashPrefix, PrefixList )
+
+  AosList* aosList = NULL;
+  SoaList* soaList = NULL;
+  PrefixList* prefixList = NULL;
+
+/*
+ * List checks
+ */
+
+  /* Checks one item, in list order, against the model */
+  int CheckItem( size_t index, char* previousKey, char* key,
+      unsigned data ) {
+    unsigned keyId = KeyIdOf(key);
+
+    CHECK( keyId < KEY_LIMIT );
+    CHECK( strcmp(key, keyName[keyId]) == 0 );
+    CHECK( present[keyId] );
+    CHECK( data == value[keyId] );
+    if( index ) {
+      CHECK( strcmp(previousKey, key) < 0 );
+    }
+    return 1;
+  }
+
+  /* Walks the whole list. Keys are in strictly increasing order, and as
+     many as in the model, so the list holds exactly the model's keys. */
+  int CheckAos( AosList* keyList ) {
+    size_t index;
+
+    CHECK( keyList->itemCount == presentCount );
+    for( index = 0; index < keyList->itemCount; index++ ) {
+      CHECK( CheckItem(index, index ? keyList->item[index - 1].key : NULL,
+          keyList->item[index].key, keyList->item[index].data) );
+      CHECK( FindAos(keyList, keyList->item[index].key) == (int)index );
+    }
+    return 1;
+  }
+
+  int CheckSoa( SoaList* keyList ) {
+    size_t index;
+
+    CHECK( keyList->itemCount == presentCount );
+    for( index = 0; index < keyList->itemCount; index++ ) {
+      CHECK( CheckItem(index, index ? keyList->keys[index - 1] : NULL,
+          keyList->keys[index], keyList->data[index]) );
+      CHECK( FindSoa(keyList, keyList->keys[index]) == (int)index );
+    }
+    return 1;
+  }
+
+  int CheckPrefix( PrefixList* keyList ) {
+    size_t index;
+
+    CHECK( keyList->itemCount == presentCount );
+    for( index = 0; index < keyList->itemCount; index++ ) {
+      CHECK( CheckItem(index, index ? keyList->item[index - 1].key : NULL,
+          keyList->item[index].key, keyList->item[index].data) );
+      CHECK( FindPrefix(keyList, keyList->item[index].key) ==
+          (int)index );
+    }
+    return 1;
+  }
+
+  /* Checks each list, and a copy of each list */
+  int CheckLists() {
+    AosList* aosCopy = NULL;
+    SoaList* soaCopy = NULL;
+    PrefixList* prefixCopy = NULL;
+    int result;
+
+    CHECK( CheckAos(aosList) );
+    CHECK( CheckSoa(soaList) );
+    CHECK( CheckPrefix(prefixList) );
+
+    aosCopy = CopyAos(aosList);
+    soaCopy = CopySoa(soaList);
+    prefixCopy = CopyPrefix(prefixList);
+    result = aosCopy && soaCopy && prefixCopy && CheckAos(aosCopy) &&
+        CheckSoa(soaCopy) && CheckPrefix(prefixCopy);
+
+    FreeAos( &aosCopy );
+    FreeSoa( &soaCopy );
+    FreePrefix( &prefixCopy );
+
+    CHECK( result );
+    return 1;
+  }
+
+/*
+ * Operations
+ */
+
+  int TestInsert( unsigned keyId ) {
+    char* key = keyName[keyId];
+    unsigned data = NextRandom(&randomState);
+    int expected = (present[keyId] == 0);
+
+    CHECK( (InsertAos(aosList, key, &data) != 0) == expected );
+    CHECK( (InsertSoa(soaList, key, &data) != 0) == expected );
+    CHECK( (InsertPrefix(prefixList, key, &data) != 0) == expected );
+
+    if( expected ) {
+      present[keyId] = 1;
+      value[keyId] = data;
+      presentCount++;
+    }
+    return 1;
+  }
+
+  int TestRemove( unsigned keyId ) {
+    char* key = keyName[keyId];
+
+    RemoveAos( aosList, key );
+    RemoveSoa( soaList, key );
+    RemovePrefix( prefixList, key );
+
+    if( present[keyId] ) {
+      present[keyId] = 0;
+      presentCount--;
+    }
+    return 1;
+  }
+
+  int TestModify( unsigned keyId ) {
+    char* key = keyName[keyId];
+    unsigned data = NextRandom(&randomState);
+    int expected = present[keyId];
+
+    CHECK( (ModifyAos(aosList, key, &data) != 0) == expected );
+    CHECK( (ModifySoa(soaList, key, &data) != 0) == expected );
+    CHECK( (ModifyPrefix(prefixList, key, &data) != 0) == expected );
+
+    if( expected ) {
+      value[keyId] = data;
+    }
+    return 1;
+  }
+
+  int TestRetrieve( unsigned keyId ) {
+    char* key = keyName[keyId];
+    int expected = present[keyId];
+    unsigned data;
+    int index;
+
+    data = ~value[keyId];
+    CHECK( (RetrieveAos(aosList, key, &data) != 0) == expected );
+    CHECK( (expected == 0) || (data == value[keyId]) );
+
+    data = ~value[keyId];
+    CHECK( (RetrieveSoa(soaList, key, &data) != 0) == expected );
+    CHECK( (expected == 0) || (data == value[keyId]) );
+
+    data = ~value[keyId];
+    CHECK( (RetrievePrefix(prefixList, key, &data) != 0) == expected );
+    CHECK( (expected == 0) || (data == value[keyId]) );
+
+    index = FindAos(aosList, key);
+    if( expected ) {
+      CHECK( (index >= 0) && ((size_t)index < aosList->itemCount) );
+      CHECK( strcmp(aosList->item[index].key, key) == 0 );
+    } else {
+      CHECK( index == -1 );
+    }
+    CHECK( FindSoa(soaList, key) == index );
+    CHECK( FindPrefix(prefixList, key) == index );
+    return 1;
+  }
+
+  /* Switches a lookup structure on or off, or releases unused space */
+  int TestToggle() {
+    int enable = (NextRandom(&randomState) % 4) != 0;
+
+    switch( NextRandom(&randomState) % 5 ) {
+    case 0:
+      CHECK( HashAos(aosList, enable) );
+      break;
+
+    case 1:
+      CHECK( HashSoa(soaList, enable) );
+      break;
+
+    case 2:
+      CHECK( HashPrefix(prefixList, enable) );
+      break;
+
+    default:
+      ReleaseAos( aosList );
+      ReleaseSoa( soaList );
+      ReleasePrefix( prefixList );
+      break;
+    }
+    return 1;
+  }
+
+/*
+ * Test rounds
+ */
+
+  int RunRound() {
+    unsigned keyRange = 1 + (NextRandom(&randomState) % KEY_LIMIT);
+    unsigned step;
+    unsigned keyId;
+    int result = 1;
+
+    for( step = 0; result && (step < STEP_COUNT); step++ ) {
+      keyId = NextRandom(&randomState) % keyRange;
+
+      switch( NextRandom(&randomState) % 16 ) {
+      case 0: case 1: case 2: case 3: case 4:
+        result = TestInsert(keyId);
+        break;
+
+      case 5: case 6: case 7:
+        result = TestRemove(keyId);
+        break;
+
+      case 8:
+        result = TestModify(keyId);
+        break;
+
+      case 9: case 10: case 11: case 12: case 13:
+        result = TestRetrieve(keyId);
+        break;
+
+      default:
+        result = TestToggle();
+        break;
+      }
+
+      if( result && ((step % CHECK_INTERVAL) == 0) ) {
+        result = CheckLists();
+      }
+
+      if( result == 0 ) {
+        printf( "  Failed at step %u, key '%s'\n", step, keyName[keyId] );
+      }
+    }
+
+    return result && CheckLists();
+  }
+
+/*
+ * Main program
+ */
+
+  int main( int argc, char* argv[] ) {
+    unsigned seed = 1;
+    unsigned round;
+
+    if( argc > 1 ) {
+      seed = (unsigned)strtoul(argv[1], NULL, 10);
+    }
+    randomState = seed ? seed : 1;
+
+    MakeKeyNames();
+
+    for( round = 0; round < ROUND_COUNT; round++ ) {
+      ClearModel();
+      aosList = CreateAos(0);
+      soaList = CreateSoa(0);
+      prefixList = CreatePrefix(NextRandom(&randomState) % 64);
+      if( !(aosList && soaList && prefixList) ) {
+        printf( "Error allocating lists\n" );
+        return 1;
+      }
+
+      if( RunRound() == 0 ) {
+        printf( "strmodel: failed in round %u, seed %u\n", round, seed );
+        return 1;
+      }
+
+      FreeAos( &aosList );
+      FreeSoa( &soaList );
+      FreePrefix( &prefixList );
+    }
+
+    printf( "strmodel: passed %u rounds, seed %u\n", ROUND_COUNT, seed );
+    return 0;
+  }
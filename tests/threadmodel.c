@@ -0,0 +1,835 @@
+/* Declares pthread read-write locks, with -std=c99 */
+#define _POSIX_C_SOURCE 200112L
+
+#include <stdio.h>
+
+/* Declares the sharded and snapshot layouts */
+#define KEYARRAY_THREADS
+
+#include "../keyarray.h"
+#include "model.h"
+
+/*
+ *  File: tests/threadmodel.c
+ *  Status: Complete
+ *
+ *  Threaded Layout Model Test: sharded and snapshot lists
+ *
+ *  Runs random operations on a sharded unsigned list, with split keys,
+ *  and a sharded string list, spread by hash, and checks every result,
+ *  and every iteration, against a table of the keys that should be
+ *  present. Then runs the same operations from several threads at once,
+ *  each with keys of its own, while another thread iterates.
+ *
+ *  Runs random reads and writes on a snapshot list from one thread,
+ *  and checks that each reader still sees the version it started with,
+ *  and that each retired version is released exactly when no reader
+ *  can still hold it. Then has several reader threads check versions
+ *  while one writer thread publishes new ones.
+ *
+ *  Build and run with the Makefile in this directory:
+ *    make check
+ *  or pass a seed, to repeat a run with other operations:
+ *    ./threadmodel 12345
+ *
+ *  https://github.com/orlandol/keyarray
+ */
+
+/*
+ * Model declarations
+ */
+
+  #define KEY_LIMIT 2000
+  #define KEY_SIZE 16
+  #define ROUND_COUNT 8
+  #define STEP_COUNT 6000
+  #define CHECK_INTERVAL 500
+  #define SHARD_COUNT 8
+  #define THREAD_COUNT 4
+  #define READER_COUNT 4
+  #define RETIRED_LIMIT 4096
+  #define COMMIT_COUNT 2000
+
+  char keyName[KEY_LIMIT][KEY_SIZE];
+  unsigned char present[KEY_LIMIT];
+  unsigned value[KEY_LIMIT];
+  size_t presentCount = 0;
+
+  void MakeKeyNames() {
+    unsigned keyId;
+
+    for( keyId = 0; keyId < KEY_LIMIT; keyId++ ) {
+      sprintf( keyName[keyId], "thread-%05u", keyId );
+    }
+  }
+
+  unsigned KeyIdOf( const char* key ) {
+    return (unsigned)strtoul(key + 7, NULL, 10);
+  }
+
+  void ClearModel() {
+    memset( present, 0, sizeof(present) );
+    memset( value, 0, sizeof(value) );
+    presentCount = 0;
+  }
+
+/*
+ * List declarations
+ */
+
+  /* Snapshot data copies, less snapshot data releases. Only the
+     snapshot writer copies or releases data, so the count is not shared
+     between threads. */
+  long liveData = 0;
+
+  void FreeValue( unsigned* data ) {
+    (void)data;
+    liveData--;
+  }
+
+  int CopyValue( unsigned* dest, unsigned* source ) {
+    (*dest) = (*source);
+    liveData++;
+    return 1;
+  }
+
+  DECLARE_UINT_KEYARRAY_TYPES_SHARDED( UintShards, unsigned )
+  DECLARE_UINT_KEYARRAY_CREATE_SHARDED( CreateUintShards, UintShards )
+  DECLARE_UINT_KEYARRAY_FREE_SHARDED( FreeUintShards, UintShards,
+      FreeNothing )
+  DECLARE_UINT_KEYARRAY_INSERT_SHARDED( InsertUintShards, UintShards,
+      unsigned )
+  DECLARE_UINT_KEYARRAY_REMOVE_SHARDED( RemoveUintShards, UintShards,
+      FreeNothing )
+  DECLARE_UINT_KEYARRAY_RETRIEVE_SHARDED( RetrieveUintShards, UintShards,
+      unsigned )
+  DECLARE_UINT_KEYARRAY_MODIFY_SHARDED( ModifyUintShards, UintShards,
+      unsigned )
+  DECLARE_UINT_KEYARRAY_ITERATEBEGIN_SHARDED( BeginUintShards, UintShards )
+  DECLARE_UINT_KEYARRAY_ITERATENEXT_SHARDED( NextUintShards, UintShards )
+  DECLARE_UINT_KEYARRAY_ITERATEEND_SHARDED( EndUintShards, UintShards )
+
+  DECLARE_STRING_KEYARRAY_TYPES_SHARDED( StringShards, unsigned )
+  DECLARE_STRING_KEYARRAY_CREATE_SHARDED( CreateStringShards,
+      StringShards )
+  DECLARE_STRING_KEYARRAY_FREE_SHARDED( FreeStringShards, StringShards,
+      FreeNothing )
+  DECLARE_STRING_KEYARRAY_INSERT_SHARDED( InsertStringShards,
+      StringShards, unsigned )
+  DECLARE_STRING_KEYARRAY_REMOVE_SHARDED( RemoveStringShards,
+      StringShards, FreeNothing )
+  DECLARE_STRING_KEYARRAY_RETRIEVE_SHARDED( RetrieveStringShards,
+      StringShards, unsigned )
+  DECLARE_STRING_KEYARRAY_MODIFY_SHARDED( ModifyStringShards,
+      StringShards, unsigned )
+  DECLARE_STRING_KEYARRAY_ITERATEBEGIN_SHARDED( BeginStringShards,
+      StringShards )
+  DECLARE_STRING_KEYARRAY_ITERATENEXT_SHARDED( NextStringShards,
+      StringShards )
+  DECLARE_STRING_KEYARRAY_ITERATEEND_SHARDED( EndStringShards,
+      StringShards )
+
+  DECLARE_UINT_KEYARRAY_TYPES_SNAPSHOT( Snapshot, unsigned )
+  DECLARE_UINT_KEYARRAY_CREATE_SNAPSHOT( CreateSnapshot, Snapshot )
+  DECLARE_UINT_KEYARRAY_FREE_SNAPSHOT( FreeSnapshot, Snapshot, FreeValue )
+  DECLARE_UINT_KEYARRAY_READBEGIN_SNAPSHOT( ReadBegin, Snapshot )
+  DECLARE_UINT_KEYARRAY_READEND_SNAPSHOT( ReadEnd, Snapshot )
+  DECLARE_UINT_KEYARRAY_RETRIEVE_SNAPSHOT( RetrieveSnapshot, Snapshot,
+      unsigned )
+  DECLARE_UINT_KEYARRAY_WRITEBEGIN_SNAPSHOT( WriteBegin, Snapshot,
+      unsigned, CopyValue, FreeValue )
+  DECLARE_UINT_KEYARRAY_WRITECOMMIT_SNAPSHOT( WriteCommit, Snapshot,
+      FreeValue )
+  DECLARE_UINT_KEYARRAY_WRITEABORT_SNAPSHOT( WriteAbort, Snapshot,
+      FreeValue )
+
+  DECLARE_UINT_KEYARRAY_INSERT( InsertPart, SnapshotPart, unsigned )
+  DECLARE_UINT_KEYARRAY_REMOVE( RemovePart, SnapshotPart, FreeValue )
+  DECLARE_UINT_KEYARRAY_RETRIEVE( RetrievePart, SnapshotPart, unsigned )
+  DECLARE_UINT_KEYARRAY_MODIFY( ModifyPart, SnapshotPart, unsigned )
+  DECLARE_UINT_KEYARRAY_FINDINDEX_SIZE( FindPart, SnapshotPart )
+  DECLARE_UINT_KEYARRAY_SEARCHINDEX( IndexPart, SnapshotPart )
+  DECLARE_UINT_KEYARRAY_LOOKUPCACHE( CachePart, SnapshotPart )
+
+/*
+ * Sharded lists, from one thread
+ */
+
+  UintShards* uintShards = NULL;
+  StringShards* stringShards = NULL;
+
+  /* Iterates the list in full. Keys are in strictly increasing order,
+     and as many as in the model, so the list holds exactly the model's
+     keys. */
+  int CheckUintShards() {
+    UintShardsIterator iterator;
+    UintShardsItem* item;
+    size_t itemCount = 0;
+    unsigned previousKeyId = 0;
+    unsigned keyId;
+    int result = 1;
+
+    CHECK( BeginUintShards(uintShards, &iterator) );
+    while( result && (item = NextUintShards(&iterator)) ) {
+      keyId = item->key;
+      result = (keyId < KEY_LIMIT) && present[keyId] &&
+          (item->data == value[keyId]) &&
+          ((itemCount == 0) || (previousKeyId < keyId));
+      previousKeyId = keyId;
+      itemCount++;
+    }
+    EndUintShards( &iterator );
+    CHECK( result );
+    CHECK( itemCount == presentCount );
+    return 1;
+  }
+
+  int CheckStringShards() {
+    StringShardsIterator iterator;
+    StringShardsItem* item;
+    size_t itemCount = 0;
+    unsigned previousKeyId = 0;
+    unsigned keyId;
+    int result = 1;
+
+    CHECK( BeginStringShards(stringShards, &iterator) );
+    while( result && (item = NextStringShards(&iterator)) ) {
+      keyId = KeyIdOf(item->key);
+      result = (keyId < KEY_LIMIT) && present[keyId] &&
+          (strcmp(item->key, keyName[keyId]) == 0) &&
+          (item->data == value[keyId]) &&
+          ((itemCount == 0) || (previousKeyId < keyId));
+      previousKeyId = keyId;
+      itemCount++;
+    }
+    EndStringShards( &iterator );
+    CHECK( result );
+    CHECK( itemCount == presentCount );
+    return 1;
+  }
+
+  int TestShardStep( unsigned keyId ) {
+    unsigned data = NextRandom(&randomState);
+    int expected;
+
+    switch( NextRandom(&randomState) % 4 ) {
+    case 0:
+      expected = (present[keyId] == 0);
+      CHECK( (InsertUintShards(uintShards, keyId, &data) != 0) ==
+          expected );
+      CHECK( (InsertStringShards(stringShards, keyName[keyId], &data) !=
+          0) == expected );
+      if( expected ) {
+        present[keyId] = 1;
+        value[keyId] = data;
+        presentCount++;
+      }
+      break;
+
+    case 1:
+      RemoveUintShards( uintShards, keyId );
+      RemoveStringShards( stringShards, keyName[keyId] );
+      if( present[keyId] ) {
+        present[keyId] = 0;
+        presentCount--;
+      }
+      break;
+
+    case 2:
+      expected = present[keyId];
+      CHECK( (ModifyUintShards(uintShards, keyId, &data) != 0) ==
+          expected );
+      CHECK( (ModifyStringShards(stringShards, keyName[keyId], &data) !=
+          0) == expected );
+      if( expected ) {
+        value[keyId] = data;
+      }
+      break;
+
+    default:
+      expected = present[keyId];
+      data = ~value[keyId];
+      CHECK( (RetrieveUintShards(uintShards, keyId, &data) != 0) ==
+          expected );
+      CHECK( (expected == 0) || (data == value[keyId]) );
+      data = ~value[keyId];
+      CHECK( (RetrieveStringShards(stringShards, keyName[keyId], &data) !=
+          0) == expected );
+      CHECK( (expected == 0) || (data == value[keyId]) );
+      break;
+    }
+    return 1;
+  }
+
+  int TestShards() {
+    unsigned splitKey[SHARD_COUNT - 1];
+    unsigned keyRange = 1 + (NextRandom(&randomState) % KEY_LIMIT);
+    unsigned index;
+    unsigned step;
+    int result = 1;
+
+    /* Increasing split keys, some past the keys in use */
+    splitKey[0] = NextRandom(&randomState) % 64;
+    for( index = 1; index < (SHARD_COUNT - 1); index++ ) {
+      splitKey[index] = splitKey[index - 1] + 1 +
+          (NextRandom(&randomState) % (KEY_LIMIT / 4));
+    }
+
+    ClearModel();
+    uintShards = CreateUintShards(SHARD_COUNT, splitKey);
+    stringShards = CreateStringShards(SHARD_COUNT, NULL);
+    CHECK( uintShards && stringShards );
+
+    for( step = 0; result && (step < STEP_COUNT); step++ ) {
+      result = TestShardStep(NextRandom(&randomState) % keyRange);
+      if( result && ((step % CHECK_INTERVAL) == 0) ) {
+        result = CheckUintShards() && CheckStringShards();
+      }
+
+      if( result == 0 ) {
+        printf( "  Failed at sharded step %u\n", step );
+      }
+    }
+
+    result = result && CheckUintShards() && CheckStringShards();
+    FreeUintShards( &uintShards );
+    FreeStringShards( &stringShards );
+    return result;
+  }
+
+/*
+ * Sharded lists, from several threads
+ */
+
+  typedef struct ShardThread {
+    pthread_t thread;
+    unsigned threadIndex;
+    unsigned randomState;
+    size_t presentCount;
+    int result;
+  } ShardThread;
+
+  volatile int shardWritersDone = 0;
+
+  /* Each thread changes only the keys equal to its index, modulo
+     THREAD_COUNT, so it can keep its part of the model without locks */
+  int RunShardThread( ShardThread* shardThread ) {
+    unsigned step;
+    unsigned keyId;
+    unsigned data;
+    int expected;
+
+    for( step = 0; step < STEP_COUNT; step++ ) {
+      keyId = NextRandom(&(shardThread->randomState)) %
+          (KEY_LIMIT / THREAD_COUNT);
+      keyId = (keyId * THREAD_COUNT) + shardThread->threadIndex;
+      data = NextRandom(&(shardThread->randomState));
+
+      if( data & 1 ) {
+        expected = (present[keyId] == 0);
+        CHECK( (InsertUintShards(uintShards, keyId, &data) != 0) ==
+            expected );
+        if( expected ) {
+          present[keyId] = 1;
+          value[keyId] = data;
+          shardThread->presentCount++;
+        }
+      } else if( data & 2 ) {
+        RemoveUintShards( uintShards, keyId );
+        if( present[keyId] ) {
+          present[keyId] = 0;
+          shardThread->presentCount--;
+        }
+      } else {
+        expected = present[keyId];
+        CHECK( (RetrieveUintShards(uintShards, keyId, &data) != 0) ==
+            expected );
+        CHECK( (expected == 0) || (data == value[keyId]) );
+      }
+    }
+    return 1;
+  }
+
+  void* ShardThreadMain( void* argument ) {
+    ShardThread* shardThread = (ShardThread*)argument;
+
+    shardThread->result = RunShardThread(shardThread);
+    return NULL;
+  }
+
+  /* Iterates while the other threads change the list. Every iteration
+     holds every shard's read lock, so it sees keys in strictly
+     increasing order. */
+  int RunIterateThread() {
+    UintShardsIterator iterator;
+    UintShardsItem* item;
+    unsigned previousKey = 0;
+    size_t itemCount;
+
+    while( __atomic_load_n(&shardWritersDone, __ATOMIC_SEQ_CST) == 0 ) {
+      CHECK( BeginUintShards(uintShards, &iterator) );
+      for( itemCount = 0; (item = NextUintShards(&iterator));
+          itemCount++ ) {
+        if( itemCount && (previousKey >= item->key) ) {
+          EndUintShards( &iterator );
+          CHECK( previousKey < item->key );
+        }
+        previousKey = item->key;
+      }
+      EndUintShards( &iterator );
+    }
+    return 1;
+  }
+
+  void* IterateThreadMain( void* argument ) {
+    (*(int*)argument) = RunIterateThread();
+    return NULL;
+  }
+
+  int TestShardThreads() {
+    ShardThread shardThread[THREAD_COUNT];
+    pthread_t iterateThread;
+    int iterateResult = 0;
+    unsigned index;
+
+    ClearModel();
+    uintShards = CreateUintShards(SHARD_COUNT, NULL);
+    CHECK( uintShards != NULL );
+
+    shardWritersDone = 0;
+    CHECK( pthread_create(&iterateThread, NULL, IterateThreadMain,
+        &iterateResult) == 0 );
+
+    for( index = 0; index < THREAD_COUNT; index++ ) {
+      shardThread[index].threadIndex = index;
+      shardThread[index].randomState = NextRandom(&randomState) | 1;
+      shardThread[index].presentCount = 0;
+      shardThread[index].result = 0;
+      CHECK( pthread_create(&(shardThread[index].thread), NULL,
+          ShardThreadMain, &(shardThread[index])) == 0 );
+    }
+
+    for( index = 0; index < THREAD_COUNT; index++ ) {
+      pthread_join( shardThread[index].thread, NULL );
+      CHECK( shardThread[index].result );
+      presentCount += shardThread[index].presentCount;
+    }
+
+    __atomic_store_n( &shardWritersDone, 1, __ATOMIC_SEQ_CST );
+    pthread_join( iterateThread, NULL );
+    CHECK( iterateResult );
+
+    CHECK( CheckUintShards() );
+    FreeUintShards( &uintShards );
+    return 1;
+  }
+
+/*
+ * Snapshot list, from one thread
+ */
+
+  /* What a reader slot is expected to see */
+  typedef struct ReaderModel {
+    int active;
+    unsigned long long epoch;
+    SnapshotPart* list;
+    unsigned char present[KEY_LIMIT];
+    unsigned value[KEY_LIMIT];
+  } ReaderModel;
+
+  Snapshot* snapshot = NULL;
+  ReaderModel readerModel[READER_COUNT];
+  unsigned long long modelEpoch;
+  unsigned long long retiredEpoch[RETIRED_LIMIT];
+  size_t retiredCount;
+
+  /* Checks that the retired versions are exactly those retired at, or
+     after, the oldest epoch of an active reader, and that no other
+     version still holds data */
+  int CheckRetired() {
+    SnapshotVersion* version;
+    size_t retiredIndex = retiredCount;
+    long expectedData;
+
+    CHECK( snapshot->epoch == modelEpoch );
+
+    expectedData = (long)snapshot->current->list->itemCount;
+    for( version = snapshot->retired; version;
+        version = version->nextRetired ) {
+      CHECK( retiredIndex > 0 );
+      retiredIndex--;
+      CHECK( version->retireEpoch == retiredEpoch[retiredIndex] );
+      expectedData += (long)version->list->itemCount;
+    }
+    CHECK( retiredIndex == 0 );
+    CHECK( liveData == expectedData );
+    return 1;
+  }
+
+  /* Models a commit: the current version is retired at the list epoch,
+     then every retired version older than the oldest reader is
+     released */
+  void RetireVersion() {
+    unsigned long long oldestEpoch = (unsigned long long)-1;
+    size_t retiredIndex;
+    size_t keptCount = 0;
+    unsigned readerIndex;
+
+    retiredEpoch[retiredCount] = modelEpoch;
+    retiredCount++;
+    modelEpoch++;
+
+    for( readerIndex = 0; readerIndex < READER_COUNT; readerIndex++ ) {
+      if( readerModel[readerIndex].active &&
+          (readerModel[readerIndex].epoch < oldestEpoch) ) {
+        oldestEpoch = readerModel[readerIndex].epoch;
+      }
+    }
+
+    for( retiredIndex = 0; retiredIndex < retiredCount; retiredIndex++ ) {
+      if( retiredEpoch[retiredIndex] >= oldestEpoch ) {
+        retiredEpoch[keptCount] = retiredEpoch[retiredIndex];
+        keptCount++;
+      }
+    }
+    retiredCount = keptCount;
+  }
+
+  /* Writes a few random changes to a draft, then commits or aborts it */
+  int TestSnapshotWrite( unsigned keyRange ) {
+    static unsigned char draftPresent[KEY_LIMIT];
+    static unsigned draftValue[KEY_LIMIT];
+    SnapshotPart* draft;
+    unsigned changeCount = 1 + (NextRandom(&randomState) % 8);
+    unsigned keyId;
+    unsigned data;
+    int expected;
+
+    memcpy( draftPresent, present, sizeof(present) );
+    memcpy( draftValue, value, sizeof(value) );
+
+    draft = WriteBegin(snapshot);
+    CHECK( draft != NULL );
+    CHECK( draft != snapshot->current->list );
+
+    /* Lookups of the draft may use, and write to, its own index and
+       cache, which commit rebuilds or releases */
+    if( (NextRandom(&randomState) % 4) == 0 ) {
+      CHECK( IndexPart(draft, 1) );
+      CHECK( CachePart(draft, 1) );
+    }
+
+    while( changeCount-- ) {
+      keyId = NextRandom(&randomState) % keyRange;
+      data = NextRandom(&randomState);
+
+      if( data & 1 ) {
+        expected = (draftPresent[keyId] == 0);
+        CHECK( (InsertPart(draft, keyId, &data) != 0) == expected );
+        if( expected ) {
+          liveData++;
+          draftPresent[keyId] = 1;
+          draftValue[keyId] = data;
+        }
+      } else if( data & 2 ) {
+        RemovePart( draft, keyId );
+        draftPresent[keyId] = 0;
+      } else {
+        expected = draftPresent[keyId];
+        CHECK( (ModifyPart(draft, keyId, &data) != 0) == expected );
+        if( expected ) {
+          draftValue[keyId] = data;
+        }
+      }
+
+      data = ~draftValue[keyId];
+      CHECK( (RetrievePart(draft, keyId, &data) != 0) ==
+          draftPresent[keyId] );
+    }
+
+    if( (NextRandom(&randomState) % 8) == 0 ) {
+      WriteAbort( snapshot );
+      CHECK( snapshot->draft == NULL );
+      return CheckRetired();
+    }
+
+    CHECK( WriteCommit(snapshot) );
+    CHECK( snapshot->current->list == draft );
+    CHECK( (draft->lookupCache == NULL) && ((draft->searchIndex == NULL) ||
+        (draft->searchIndex->generation == draft->generation)) );
+
+    memcpy( present, draftPresent, sizeof(present) );
+    memcpy( value, draftValue, sizeof(value) );
+    RetireVersion();
+    return CheckRetired();
+  }
+
+  /* Starts, checks, or ends a read of one reader slot */
+  int TestSnapshotRead( unsigned keyRange ) {
+    unsigned readerIndex = NextRandom(&randomState) % READER_COUNT;
+    ReaderModel* reader = &(readerModel[readerIndex]);
+    unsigned keyId = NextRandom(&randomState) % keyRange;
+    unsigned data;
+    size_t itemIndex;
+
+    if( reader->active == 0 ) {
+      /* A one-shot lookup ends the read, so only idle slots use it */
+      if( NextRandom(&randomState) % 2 ) {
+        data = ~value[keyId];
+        CHECK( (RetrieveSnapshot(snapshot, readerIndex, keyId, &data) !=
+            0) == present[keyId] );
+        CHECK( (present[keyId] == 0) || (data == value[keyId]) );
+        CHECK( snapshot->reader[readerIndex].epoch == 0 );
+        return 1;
+      }
+
+      reader->list = ReadBegin(snapshot, readerIndex);
+      CHECK( reader->list == snapshot->current->list );
+      CHECK( snapshot->reader[readerIndex].epoch == modelEpoch );
+      reader->active = 1;
+      reader->epoch = modelEpoch;
+      memcpy( reader->present, present, sizeof(present) );
+      memcpy( reader->value, value, sizeof(value) );
+      return 1;
+    }
+
+    if( (NextRandom(&randomState) % 4) == 0 ) {
+      ReadEnd( snapshot, readerIndex );
+      reader->active = 0;
+      return 1;
+    }
+
+    /* The version this reader started with is unchanged, and kept */
+    data = ~reader->value[keyId];
+    CHECK( (RetrievePart(reader->list, keyId, &data) != 0) ==
+        reader->present[keyId] );
+    CHECK( (reader->present[keyId] == 0) ||
+        (data == reader->value[keyId]) );
+
+    itemIndex = FindPart(reader->list, keyId);
+    CHECK( (itemIndex == (size_t)-1) == (reader->present[keyId] == 0) );
+    CHECK( (itemIndex == (size_t)-1) ||
+        (reader->list->item[itemIndex].key == keyId) );
+    return 1;
+  }
+
+  int TestSnapshot() {
+    unsigned keyRange = 1 + (NextRandom(&randomState) % KEY_LIMIT);
+    unsigned readerIndex;
+    unsigned step;
+    int result = 1;
+
+    ClearModel();
+    memset( readerModel, 0, sizeof(readerModel) );
+    modelEpoch = 1;
+    retiredCount = 0;
+    liveData = 0;
+
+    snapshot = CreateSnapshot(READER_COUNT);
+    CHECK( snapshot != NULL );
+
+    for( step = 0; result && (step < STEP_COUNT); step++ ) {
+      if( NextRandom(&randomState) % 3 ) {
+        result = TestSnapshotRead(keyRange);
+      } else {
+        result = TestSnapshotWrite(keyRange);
+      }
+
+      /* Keep long reads from retiring more versions than the model
+         holds */
+      if( retiredCount > (RETIRED_LIMIT / 2) ) {
+        for( readerIndex = 0; readerIndex < READER_COUNT; readerIndex++ ) {
+          ReadEnd( snapshot, readerIndex );
+          readerModel[readerIndex].active = 0;
+        }
+      }
+
+      if( result == 0 ) {
+        printf( "  Failed at snapshot step %u\n", step );
+      }
+    }
+
+    /* Once every reader ends, the next commit releases every retired
+       version */
+    for( readerIndex = 0; readerIndex < READER_COUNT; readerIndex++ ) {
+      ReadEnd( snapshot, readerIndex );
+      readerModel[readerIndex].active = 0;
+    }
+    CHECK( result );
+    CHECK( WriteBegin(snapshot) != NULL );
+    CHECK( WriteCommit(snapshot) );
+    RetireVersion();
+    CHECK( CheckRetired() );
+    CHECK( snapshot->retired == NULL );
+
+    FreeSnapshot( &snapshot );
+    CHECK( liveData == 0 );
+    return 1;
+  }
+
+/*
+ * Snapshot list, from several threads
+ */
+
+  typedef struct ReaderThread {
+    pthread_t thread;
+    size_t readerIndex;
+    unsigned long readCount;
+    int result;
+  } ReaderThread;
+
+  volatile int snapshotWriterDone = 0;
+
+  /* Every item of a version holds the number of the commit that
+     published it, so a reader can tell a torn or released version from
+     a whole one. Commit numbers never go backwards. */
+  int RunReaderThread( ReaderThread* readerThread ) {
+    SnapshotPart* list;
+    unsigned commitNumber = 0;
+    unsigned lastCommitNumber = 0;
+    unsigned data;
+    size_t index;
+    int done;
+
+    do {
+      done = __atomic_load_n(&snapshotWriterDone, __ATOMIC_SEQ_CST);
+
+      list = ReadBegin(snapshot, readerThread->readerIndex);
+      CHECK( list != NULL );
+
+      if( list->itemCount ) {
+        commitNumber = list->item[0].data;
+      }
+      for( index = 0; index < list->itemCount; index++ ) {
+        CHECK( list->item[index].data == commitNumber );
+        CHECK( (index == 0) ||
+            (list->item[index - 1].key < list->item[index].key) );
+      }
+      if( list->itemCount ) {
+        index = list->item[list->itemCount / 2].key;
+        CHECK( FindPart(list, (unsigned)index) == (list->itemCount / 2) );
+        CHECK( RetrievePart(list, (unsigned)index, &data) &&
+            (data == commitNumber) );
+      }
+
+      ReadEnd( snapshot, readerThread->readerIndex );
+
+      CHECK( commitNumber >= lastCommitNumber );
+      lastCommitNumber = commitNumber;
+      readerThread->readCount++;
+    } while( done == 0 );
+
+    return 1;
+  }
+
+  void* ReaderThreadMain( void* argument ) {
+    ReaderThread* readerThread = (ReaderThread*)argument;
+
+    readerThread->result = RunReaderThread(readerThread);
+    return NULL;
+  }
+
+  int RunSnapshotWriter() {
+    SnapshotPart* draft;
+    unsigned commitNumber;
+    unsigned keyId;
+    unsigned data;
+    size_t index;
+
+    for( commitNumber = 1; commitNumber <= COMMIT_COUNT; commitNumber++ ) {
+      draft = WriteBegin(snapshot);
+      CHECK( draft != NULL );
+
+      if( (commitNumber % 64) == 0 ) {
+        CHECK( IndexPart(draft, 1) );
+      }
+
+      for( index = 0; index < 4; index++ ) {
+        keyId = NextRandom(&randomState) % 512;
+        data = commitNumber;
+        if( InsertPart(draft, keyId, &data) ) {
+          liveData++;
+        } else if( NextRandom(&randomState) % 2 ) {
+          RemovePart( draft, keyId );
+        }
+      }
+
+      for( index = 0; index < draft->itemCount; index++ ) {
+        draft->item[index].data = commitNumber;
+      }
+
+      if( (commitNumber % 16) == 0 ) {
+        WriteAbort( snapshot );
+      } else {
+        CHECK( WriteCommit(snapshot) );
+      }
+    }
+    return 1;
+  }
+
+  int TestSnapshotThreads() {
+    ReaderThread readerThread[READER_COUNT];
+    unsigned index;
+    int result;
+
+    liveData = 0;
+    snapshot = CreateSnapshot(READER_COUNT);
+    CHECK( snapshot != NULL );
+
+    snapshotWriterDone = 0;
+    for( index = 0; index < READER_COUNT; index++ ) {
+      readerThread[index].readerIndex = index;
+      readerThread[index].readCount = 0;
+      readerThread[index].result = 0;
+      CHECK( pthread_create(&(readerThread[index].thread), NULL,
+          ReaderThreadMain, &(readerThread[index])) == 0 );
+    }
+
+    result = RunSnapshotWriter();
+    __atomic_store_n( &snapshotWriterDone, 1, __ATOMIC_SEQ_CST );
+
+    for( index = 0; index < READER_COUNT; index++ ) {
+      pthread_join( readerThread[index].thread, NULL );
+      CHECK( readerThread[index].result );
+      CHECK( readerThread[index].readCount > 0 );
+    }
+    CHECK( result );
+
+    /* With every reader gone, one more commit releases every retired
+       version, leaving only the data of the current one */
+    CHECK( WriteBegin(snapshot) != NULL );
+    CHECK( WriteCommit(snapshot) );
+    CHECK( snapshot->retired == NULL );
+    CHECK( liveData == (long)snapshot->current->list->itemCount );
+
+    FreeSnapshot( &snapshot );
+    CHECK( liveData == 0 );
+    return 1;
+  }
+
+/*
+ * Main program
+ */
+
+  int main( int argc, char* argv[] ) {
+    unsigned seed = 1;
+    unsigned round;
+
+    if( argc > 1 ) {
+      seed = (unsigned)strtoul(argv[1], NULL, 10);
+    }
+    randomState = seed ? seed : 1;
+
+    MakeKeyNames();
+
+    for( round = 0; round < ROUND_COUNT; round++ ) {
+      if( !(TestShards() && TestShardThreads() && TestSnapshot() &&
+          TestSnapshotThreads()) ) {
+        printf( "threadmodel: failed in round %u, seed %u\n", round, seed );
+        return 1;
+      }
+    }
+
+    printf( "threadmodel: passed %u rounds, seed %u\n", ROUND_COUNT, seed );
+    return 0;
+  }
@@ -0,0 +1,258 @@
+#include <stdio.h>
+
+#include "../keyarray.h"
+#include "model.h"
+
+/*
+ *  File: tests/uintmodel.c
+ *  Status: Complete
+ *
+ *  Unsigned Key Model Test: random operations checked against a model
+ *
+ *  Runs random inserts, removes, modifies, and retrieves on an array of
+ *  structures list, and checks every result against a table of the keys
+ *  that should be present. Unused space is released along the way.
+ *
+ *  Every CHECK_INTERVAL operations, and at the end of each round, the
+ *  list is walked in full, and a copy of it is checked the same way.
+ *
+ *  Build and run with the Makefile in this directory:
+ *    make check
+ *  or pass a seed, to repeat a run with other operations:
+ *    ./uintmodel 12345
+ *
+ *  https://github.com/orlandol/keyarray
+ */
+
+/*
+ * Model declarations
+ */
+
+  #define KEY_LIMIT 3000
+  #define ROUND_COUNT 24
+  #define STEP_COUNT 6000
+  #define CHECK_INTERVAL 500
+
+  unsigned char present[KEY_LIMIT];
+  unsigned value[KEY_LIMIT];
+  size_t presentCount = 0;
+
+  void ClearModel() {
+    memset( present, 0, sizeof(present) );
+    memset( value, 0, sizeof(value) );
+    presentCount = 0;
+  }
+
+  /* Returns the number of keys in the model less than keyId */
+  size_t CountBelow( unsigned keyId ) {
+    size_t count = 0;
+    unsigned modelId;
+
+    for( modelId = 0; (modelId < keyId) && (modelId < KEY_LIMIT);
+        modelId++ ) {
+      count += present[modelId];
+    }
+    return count;
+  }
+
+/*
+ * List declarations
+ */
+
+  int CopyValue( unsigned* dest, unsigned* source ) {
+    (*dest) = (*source);
+    return 1;
+  }
+
+  DECLARE_UINT_KEYARRAY_TYPES( AosList, unsigned )
+  DECLARE_UINT_KEYARRAY_CREATE( CreateAos, AosList )
+  DECLARE_UINT_KEYARRAY_FREE( FreeAos, AosList, FreeNothing )
+  DECLARE_UINT_KEYARRAY_INSERT( InsertAos, AosList, unsigned )
+  DECLARE_UINT_KEYARRAY_REMOVE( RemoveAos, AosList, FreeNothing )
+  DECLARE_UINT_KEYARRAY_RETRIEVE( RetrieveAos, AosList, unsigned )
+  DECLARE_UINT_KEYARRAY_MODIFY( ModifyAos, AosList, unsigned )
+  DECLARE_UINT_KEYARRAY_FINDINDEX( FindAos, AosList )
+  DECLARE_UINT_KEYARRAY_RELEASEUNUSED( ReleaseAos, AosList )
+  DECLARE_UINT_KEYARRAY_COPY( CopyAos, AosList, unsigned,
+      CopyValue, FreeNothing )
+
+  AosList* aosList = NULL;
+
+/*
+ * List checks
+ */
+
+  /* Checks one item, in list order, against the model */
+  int CheckItem( size_t index, unsigned previousKeyId, unsigned keyId,
+      unsigned data ) {
+    CHECK( keyId < KEY_LIMIT );
+    CHECK( present[keyId] );
+    CHECK( data == value[keyId] );
+    if( index ) {
+      CHECK( previousKeyId < keyId );
+    }
+    return 1;
+  }
+
+  /* Walks the whole list. Keys are in strictly increasing order, and as
+     many as in the model, so the list holds exactly the model's keys. */
+  int CheckAos( AosList* keyList ) {
+    size_t index;
+
+    CHECK( keyList->itemCount == presentCount );
+    for( index = 0; index < keyList->itemCount; index++ ) {
+      CHECK( CheckItem(index, index ? keyList->item[index - 1].key : 0,
+          keyList->item[index].key, keyList->item[index].data) );
+      CHECK( FindAos(keyList, keyList->item[index].key) == (int)index );
+    }
+    return 1;
+  }
+
+  /* Checks the list, and a copy of it */
+  int CheckLists() {
+    AosList* aosCopy = NULL;
+    int result;
+
+    CHECK( CheckAos(aosList) );
+
+    aosCopy = CopyAos(aosList);
+    result = aosCopy && CheckAos(aosCopy);
+
+    FreeAos( &aosCopy );
+
+    CHECK( result );
+    return 1;
+  }
+
+/*
+ * Operations
+ */
+
+  int TestInsert( unsigned keyId ) {
+    unsigned data = NextRandom(&randomState);
+    int expected = (present[keyId] == 0);
+
+    CHECK( (InsertAos(aosList, keyId, &data) != 0) == expected );
+
+    if( expected ) {
+      present[keyId] = 1;
+      value[keyId] = data;
+      presentCount++;
+    }
+    return 1;
+  }
+
+  int TestRemove( unsigned keyId ) {
+    RemoveAos( aosList, keyId );
+
+    if( present[keyId] ) {
+      present[keyId] = 0;
+      presentCount--;
+    }
+    return 1;
+  }
+
+  int TestModify( unsigned keyId ) {
+    unsigned data = NextRandom(&randomState);
+    int expected = present[keyId];
+
+    CHECK( (ModifyAos(aosList, keyId, &data) != 0) == expected );
+
+    if( expected ) {
+      value[keyId] = data;
+    }
+    return 1;
+  }
+
+  int TestRetrieve( unsigned keyId ) {
+    int expected = present[keyId];
+    int index = expected ? (int)CountBelow(keyId) : -1;
+    unsigned data;
+
+    data = ~value[keyId];
+    CHECK( (RetrieveAos(aosList, keyId, &data) != 0) == expected );
+    CHECK( (expected == 0) || (data == value[keyId]) );
+
+    CHECK( FindAos(aosList, keyId) == index );
+    return 1;
+  }
+
+/*
+ * Test rounds
+ */
+
+  int RunRound() {
+    unsigned keyRange = 1 + (NextRandom(&randomState) % KEY_LIMIT);
+    unsigned step;
+    unsigned keyId;
+    int result = 1;
+
+    for( step = 0; result && (step < STEP_COUNT); step++ ) {
+      keyId = NextRandom(&randomState) % keyRange;
+
+      switch( NextRandom(&randomState) % 16 ) {
+      case 0: case 1: case 2: case 3: case 4:
+        result = TestInsert(keyId);
+        break;
+
+      case 5: case 6: case 7:
+        result = TestRemove(keyId);
+        break;
+
+      case 8:
+        result = TestModify(keyId);
+        break;
+
+      case 9: case 10: case 11: case 12: case 13:
+        result = TestRetrieve(keyId);
+        break;
+
+      default:
+        ReleaseAos( aosList );
+        break;
+      }
+
+      if( result && ((step % CHECK_INTERVAL) == 0) ) {
+        result = CheckLists();
+      }
+
+      if( result == 0 ) {
+        printf( "  Failed at step %u, key %u\n", step, keyId );
+      }
+    }
+
+    return result && CheckLists();
+  }
+
+/*
+ * Main program
+ */
+
+  int main( int argc, char* argv[] ) {
+    unsigned seed = 1;
+    unsigned round;
+
+    if( argc > 1 ) {
+      seed = (unsigned)strtoul(argv[1], NULL, 10);
+    }
+    randomState = seed ? seed : 1;
+
+    for( round = 0; round < ROUND_COUNT; round++ ) {
+      ClearModel();
+      aosList = CreateAos(0);
+      if( aosList == NULL ) {
+        printf( "Error allocating list\n" );
+        return 1;
+      }
+
+      if( RunRound() == 0 ) {
+        printf( "uintmodel: failed in round %u, seed %u\n", round, seed );
+        return 1;
+      }
+
+      FreeAos( &aosList );
+    }
+
+    printf( "uintmodel: passed %u rounds, seed %u\n", ROUND_COUNT, seed );
+    return 0;
+  }
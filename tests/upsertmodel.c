@@ -0,0 +1,533 @@
+#include <stdio.h>
+
+#include "../keyarray.h"
+#include "model.h"
+
+/*
+ *  File: tests/upsertmodel.c
+ *  Status: Complete
+ *
+ *  Upsert Model Test: data pointers, upsert, and update checked against
+ *  a model
+ *
+ *  Runs the same random upserts, get pointers, updates, inserts, and
+ *  removes on a string list, an unsigned list, and a custom key list,
+ *  and checks every result against a table of the keys that should be
+ *  present. Data is changed in place through the returned pointers, the
+ *  way a counting loop would. The unsigned list upserts with its own
+ *  growth policy. The hash index of the string list, and the lookup
+ *  cache of the unsigned list, are switched on and off along the way,
+ *  so that upserts and updates of present keys run through them.
+ *
+ *  Key n is "word-n", zero padded, in the string list, n in the
+ *  unsigned list, and (n / 64, n % 64) in the custom list, so that
+ *  every list holds its keys in the same order.
+ *
+ *  Every CHECK_INTERVAL operations, and at the end of each round, each
+ *  list is walked in full, and a copy of each list is checked the same
+ *  way.
+ *
+ *  Build and run with the Makefile in this directory:
+ *    make check
+ *  or pass a seed, to repeat a run with other operations:
+ *    ./upsertmodel 12345
+ *
+ *  https://github.com/orlandol/keyarray
+ */
+
+/*
+ * Model declarations
+ */
+
+  #define KEY_LIMIT 3000
+  #define KEY_SIZE 16
+  #define ROUND_COUNT 24
+  #define STEP_COUNT 6000
+  #define CHECK_INTERVAL 500
+
+  char keyName[KEY_LIMIT][KEY_SIZE];
+  unsigned char present[KEY_LIMIT];
+  unsigned value[KEY_LIMIT];
+  size_t presentCount = 0;
+
+  /* Calls of the unsigned list's growth function */
+  size_t growCalls = 0;
+
+  void MakeKeyNames() {
+    unsigned keyId;
+
+    for( keyId = 0; keyId < KEY_LIMIT; keyId++ ) {
+      sprintf( keyName[keyId], "word-%05u", keyId );
+    }
+  }
+
+  void ClearModel() {
+    memset( present, 0, sizeof(present) );
+    memset( value, 0, sizeof(value) );
+    presentCount = 0;
+  }
+
+  /* Returns the number of keys in the model less than keyId */
+  size_t CountBelow( unsigned keyId ) {
+    size_t count = 0;
+    unsigned modelId;
+
+    for( modelId = 0; modelId < keyId; modelId++ ) {
+      count += present[modelId];
+    }
+    return count;
+  }
+
+/*
+ * List declarations
+ */
+
+  typedef struct PairKey {
+    unsigned high;
+    unsigned low;
+  } PairKey;
+
+  int ComparePairKeys( PairKey leftKey, PairKey rightKey ) {
+    if( leftKey.high != rightKey.high ) {
+      return (leftKey.high < rightKey.high) ? -1 : 1;
+    }
+    return (leftKey.low > rightKey.low) - (leftKey.low < rightKey.low);
+  }
+
+  int CopyValue( unsigned* dest, unsigned* source ) {
+    (*dest) = (*source);
+    return 1;
+  }
+
+  /* Adds sourceData to data, or counts one when there is none */
+  void AddCount( unsigned* data, unsigned* sourceData ) {
+    (*data) += sourceData ? (*sourceData) : 1;
+  }
+
+  /* Grows by half again, from at least 4 items */
+  size_t GrowByHalf( size_t reservedCount, size_t requiredCount ) {
+    growCalls++;
+    reservedCount += (reservedCount / 2) + 4;
+    return (reservedCount < requiredCount) ? requiredCount : reservedCount;
+  }
+
+  DECLARE_STRING_KEYARRAY_TYPES( WordList, unsigned )
+  DECLARE_STRING_KEYARRAY_CREATE( CreateWord, WordList )
+  DECLARE_STRING_KEYARRAY_FREE( FreeWord, WordList, FreeNothing )
+  DECLARE_STRING_KEYARRAY_INSERT( InsertWord, WordList, unsigned )
+  DECLARE_STRING_KEYARRAY_REMOVE( RemoveWord, WordList, FreeNothing )
+  DECLARE_STRING_KEYARRAY_RETRIEVE( RetrieveWord, WordList, unsigned )
+  DECLARE_STRING_KEYARRAY_FINDINDEX_SIZE( FindWord, WordList )
+  DECLARE_STRING_KEYARRAY_UPSERT( UpsertWord, WordList, unsigned )
+  DECLARE_STRING_KEYARRAY_GETPTR( GetWord, WordList, unsigned )
+  DECLARE_STRING_KEYARRAY_UPDATE( UpdateWord, WordList, unsigned,
+      AddCount )
+  DECLARE_STRING_KEYARRAY_RELEASEUNUSED( ReleaseWord, WordList )
+  DECLARE_STRING_KEYARRAY_COPY( CopyWord, WordList, unsigned,
+      CopyValue, FreeNothing )
+  DECLARE_STRING_KEYARRAY_HASHINDEX( HashWord, WordList )
+
+  DECLARE_UINT_KEYARRAY_TYPES( CountList, unsigned )
+  DECLARE_UINT_KEYARRAY_CREATE( CreateCount, CountList )
+  DECLARE_UINT_KEYARRAY_FREE( FreeCount, CountList, FreeNothing )
+  DECLARE_UINT_KEYARRAY_INSERT( InsertCount, CountList, unsigned )
+  DECLARE_UINT_KEYARRAY_REMOVE( RemoveCount, CountList, FreeNothing )
+  DECLARE_UINT_KEYARRAY_RETRIEVE( RetrieveCount, CountList, unsigned )
+  DECLARE_UINT_KEYARRAY_FINDINDEX_SIZE( FindCount, CountList )
+  DECLARE_UINT_KEYARRAY_UPSERT_GROWTH( UpsertCount, CountList, unsigned,
+      GrowByHalf )
+  DECLARE_UINT_KEYARRAY_GETPTR( GetCount, CountList, unsigned )
+  DECLARE_UINT_KEYARRAY_UPDATE( UpdateCount, CountList, unsigned,
+      AddCount )
+  DECLARE_UINT_KEYARRAY_RELEASEUNUSED( ReleaseCount, CountList )
+  DECLARE_UINT_KEYARRAY_COPY( CopyCount, CountList, unsigned,
+      CopyValue, FreeNothing )
+  DECLARE_UINT_KEYARRAY_LOOKUPCACHE( CacheCount, CountList )
+
+  DECLARE_CUSTOM_KEYARRAY_TYPES( PairList, PairKey, unsigned,
+      ComparePairKeys )
+  DECLARE_CUSTOM_KEYARRAY_CREATE( CreatePair, PairList )
+  DECLARE_CUSTOM_KEYARRAY_FREE( FreePair, PairList, FreeNothing )
+  DECLARE_CUSTOM_KEYARRAY_INSERT( InsertPair, PairList, unsigned )
+  DECLARE_CUSTOM_KEYARRAY_REMOVE( RemovePair, PairList, FreeNothing )
+  DECLARE_CUSTOM_KEYARRAY_RETRIEVE( RetrievePair, PairList, unsigned )
+  DECLARE_CUSTOM_KEYARRAY_FINDINDEX_SIZE( FindPair, PairList )
+  DECLARE_CUSTOM_KEYARRAY_UPSERT( UpsertPair, PairList, unsigned )
+  DECLARE_CUSTOM_KEYARRAY_GETPTR( GetPair, PairList, unsigned )
+  DECLARE_CUSTOM_KEYARRAY_UPDATE( UpdatePair, PairList, unsigned,
+      AddCount )
+  DECLARE_CUSTOM_KEYARRAY_RELEASEUNUSED( ReleasePair, PairList )
+  DECLARE_CUSTOM_KEYARRAY_COPY( CopyPair, PairList, unsigned,
+      CopyValue, FreeNothing )
+
+  WordList* wordList = NULL;
+  CountList* countList = NULL;
+  PairList* pairList = NULL;
+
+  PairKey MakePairKey( unsigned keyId ) {
+    PairKey key;
+
+    key.high = keyId / 64;
+    key.low = keyId % 64;
+    return key;
+  }
+
+/*
+ * List checks
+ */
+
+  /* Checks one item, in list order, against the model */
+  int CheckItem( size_t index, unsigned previousKeyId, unsigned keyId,
+      unsigned data ) {
+    CHECK( keyId < KEY_LIMIT );
+    CHECK( present[keyId] );
+    CHECK( data == value[keyId] );
+    if( index ) {
+      CHECK( previousKeyId < keyId );
+    }
+    return 1;
+  }
+
+  /* Walks each list in full. Keys are in strictly increasing order, and
+     as many as in the model, so each list holds exactly the model's
+     keys. */
+  int CheckWord( WordList* keyList ) {
+    unsigned keyId = 0;
+    unsigned previousKeyId = 0;
+    size_t index;
+
+    CHECK( keyList->itemCount == presentCount );
+    for( index = 0; index < keyList->itemCount; index++ ) {
+      keyId = (unsigned)strtoul(keyList->item[index].key + 5, NULL, 10);
+      CHECK( keyId < KEY_LIMIT );
+      CHECK( strcmp(keyList->item[index].key, keyName[keyId]) == 0 );
+      CHECK( CheckItem(index, previousKeyId, keyId,
+          keyList->item[index].data) );
+      CHECK( FindWord(keyList, keyList->item[index].key) == index );
+      previousKeyId = keyId;
+    }
+    return 1;
+  }
+
+  int CheckCount( CountList* keyList ) {
+    size_t index;
+
+    CHECK( keyList->itemCount == presentCount );
+    CHECK( keyList->itemCount <= keyList->reservedCount );
+    for( index = 0; index < keyList->itemCount; index++ ) {
+      CHECK( CheckItem(index, index ? keyList->item[index - 1].key : 0,
+          keyList->item[index].key, keyList->item[index].data) );
+      CHECK( FindCount(keyList, keyList->item[index].key) == index );
+    }
+    return 1;
+  }
+
+  int CheckPair( PairList* keyList ) {
+    unsigned keyId = 0;
+    unsigned previousKeyId = 0;
+    size_t index;
+
+    CHECK( keyList->itemCount == presentCount );
+    for( index = 0; index < keyList->itemCount; index++ ) {
+      CHECK( keyList->item[index].key.low < 64 );
+      keyId = (keyList->item[index].key.high * 64) +
+          keyList->item[index].key.low;
+      CHECK( CheckItem(index, previousKeyId, keyId,
+          keyList->item[index].data) );
+      CHECK( FindPair(keyList, keyList->item[index].key) == index );
+      previousKeyId = keyId;
+    }
+    return 1;
+  }
+
+  /* Checks each list, and a copy of each list */
+  int CheckLists() {
+    WordList* wordCopy = NULL;
+    CountList* countCopy = NULL;
+    PairList* pairCopy = NULL;
+    int result;
+
+    CHECK( CheckWord(wordList) );
+    CHECK( CheckCount(countList) );
+    CHECK( CheckPair(pairList) );
+
+    wordCopy = CopyWord(wordList);
+    countCopy = CopyCount(countList);
+    pairCopy = CopyPair(pairList);
+    result = wordCopy && countCopy && pairCopy && CheckWord(wordCopy) &&
+        CheckCount(countCopy) && CheckPair(pairCopy);
+
+    FreeWord( &wordCopy );
+    FreeCount( &countCopy );
+    FreePair( &pairCopy );
+
+    CHECK( result );
+    return 1;
+  }
+
+/*
+ * Operations
+ */
+
+  int TestInsert( unsigned keyId ) {
+    unsigned data = NextRandom(&randomState);
+    int expected = (present[keyId] == 0);
+
+    CHECK( (InsertWord(wordList, keyName[keyId], &data) != 0) ==
+        expected );
+    CHECK( (InsertCount(countList, keyId, &data) != 0) == expected );
+    CHECK( (InsertPair(pairList, MakePairKey(keyId), &data) != 0) ==
+        expected );
+
+    if( expected ) {
+      present[keyId] = 1;
+      value[keyId] = data;
+      presentCount++;
+    }
+    return 1;
+  }
+
+  int TestRemove( unsigned keyId ) {
+    RemoveWord( wordList, keyName[keyId] );
+    RemoveCount( countList, keyId );
+    RemovePair( pairList, MakePairKey(keyId) );
+
+    if( present[keyId] ) {
+      present[keyId] = 0;
+      presentCount--;
+    }
+    return 1;
+  }
+
+  /* Upserts keyId, then counts one through the returned pointer. The
+     inserted flag is left out now and then. */
+  int TestUpsert( unsigned keyId ) {
+    unsigned data = NextRandom(&randomState);
+    int expected = (present[keyId] == 0);
+    int* insertedPtr = NULL;
+    int inserted = -1;
+    unsigned* dataPtr;
+    size_t growStart = growCalls;
+
+    if( NextRandom(&randomState) % 4 ) {
+      insertedPtr = &inserted;
+    }
+
+    if( expected ) {
+      present[keyId] = 1;
+      value[keyId] = data;
+      presentCount++;
+    }
+
+    dataPtr = UpsertWord(wordList, keyName[keyId], &data, insertedPtr);
+    CHECK( dataPtr && ((*dataPtr) == value[keyId]) );
+    CHECK( (insertedPtr == NULL) || (inserted == expected) );
+    (*dataPtr)++;
+
+    inserted = -1;
+    dataPtr = UpsertCount(countList, keyId, &data, insertedPtr);
+    CHECK( dataPtr && ((*dataPtr) == value[keyId]) );
+    CHECK( (insertedPtr == NULL) || (inserted == expected) );
+    (*dataPtr)++;
+
+    inserted = -1;
+    dataPtr = UpsertPair(pairList, MakePairKey(keyId), &data, insertedPtr);
+    CHECK( dataPtr && ((*dataPtr) == value[keyId]) );
+    CHECK( (insertedPtr == NULL) || (inserted == expected) );
+    (*dataPtr)++;
+
+    /* Only the insert of a new key into a full list grows it */
+    CHECK( (growCalls == growStart) || expected );
+    value[keyId]++;
+    return 1;
+  }
+
+  /* Gets a pointer to the data of keyId, and changes it in place */
+  int TestGetPtr( unsigned keyId ) {
+    unsigned data = NextRandom(&randomState);
+    unsigned* wordPtr = GetWord(wordList, keyName[keyId]);
+    unsigned* countPtr = GetCount(countList, keyId);
+    unsigned* pairPtr = GetPair(pairList, MakePairKey(keyId));
+
+    if( present[keyId] == 0 ) {
+      CHECK( (wordPtr == NULL) && (countPtr == NULL) && (pairPtr == NULL) );
+      return 1;
+    }
+
+    CHECK( wordPtr && ((*wordPtr) == value[keyId]) );
+    CHECK( countPtr && ((*countPtr) == value[keyId]) );
+    CHECK( pairPtr && ((*pairPtr) == value[keyId]) );
+
+    (*wordPtr) = data;
+    (*countPtr) = data;
+    (*pairPtr) = data;
+    value[keyId] = data;
+    return 1;
+  }
+
+  /* Updates keyId in place, adding random data, or counting one with no
+     source data */
+  int TestUpdate( unsigned keyId ) {
+    unsigned data = NextRandom(&randomState) % 1000;
+    unsigned* source = (NextRandom(&randomState) % 2) ? &data : NULL;
+    int expected = present[keyId];
+
+    CHECK( (UpdateWord(wordList, keyName[keyId], source) != 0) ==
+        expected );
+    CHECK( (UpdateCount(countList, keyId, source) != 0) == expected );
+    CHECK( (UpdatePair(pairList, MakePairKey(keyId), source) != 0) ==
+        expected );
+
+    if( expected ) {
+      AddCount( &value[keyId], source );
+    }
+    return 1;
+  }
+
+  int TestRetrieve( unsigned keyId ) {
+    int expected = present[keyId];
+    size_t index = expected ? CountBelow(keyId) : (size_t)-1;
+    unsigned data;
+
+    data = ~value[keyId];
+    CHECK( (RetrieveWord(wordList, keyName[keyId], &data) != 0) ==
+        expected );
+    CHECK( (expected == 0) || (data == value[keyId]) );
+
+    data = ~value[keyId];
+    CHECK( (RetrieveCount(countList, keyId, &data) != 0) == expected );
+    CHECK( (expected == 0) || (data == value[keyId]) );
+
+    data = ~value[keyId];
+    CHECK( (RetrievePair(pairList, MakePairKey(keyId), &data) != 0) ==
+        expected );
+    CHECK( (expected == 0) || (data == value[keyId]) );
+
+    CHECK( FindWord(wordList, keyName[keyId]) == index );
+    CHECK( FindCount(countList, keyId) == index );
+    CHECK( FindPair(pairList, MakePairKey(keyId)) == index );
+    return 1;
+  }
+
+  /* Switches a lookup structure on or off, or releases unused space */
+  int TestToggle() {
+    int enable = (NextRandom(&randomState) % 4) != 0;
+
+    switch( NextRandom(&randomState) % 3 ) {
+    case 0:
+      CHECK( HashWord(wordList, enable) );
+      break;
+
+    case 1:
+      CHECK( CacheCount(countList, enable) );
+      break;
+
+    default:
+      ReleaseWord( wordList );
+      ReleaseCount( countList );
+      ReleasePair( pairList );
+      break;
+    }
+    return 1;
+  }
+
+/*
+ * Test rounds
+ */
+
+  int RunRound() {
+    unsigned keyRange = 1 + (NextRandom(&randomState) % KEY_LIMIT);
+    unsigned step;
+    unsigned keyId;
+    int result = 1;
+
+    for( step = 0; result && (step < STEP_COUNT); step++ ) {
+      keyId = NextRandom(&randomState) % keyRange;
+
+      switch( NextRandom(&randomState) % 16 ) {
+      case 0: case 1: case 2: case 3:
+        result = TestUpsert(keyId);
+        break;
+
+      case 4: case 5:
+        result = TestGetPtr(keyId);
+        break;
+
+      case 6: case 7:
+        result = TestUpdate(keyId);
+        break;
+
+      case 8:
+        result = TestInsert(keyId);
+        break;
+
+      case 9: case 10: case 11: case 12:
+        result = TestRemove(keyId);
+        break;
+
+      case 15:
+        result = TestToggle();
+        break;
+
+      default:
+        result = TestRetrieve(keyId);
+        break;
+      }
+
+      if( result && ((step % CHECK_INTERVAL) == 0) ) {
+        result = CheckLists();
+      }
+
+      if( result == 0 ) {
+        printf( "  Failed at step %u, key %u\n", step, keyId );
+      }
+    }
+
+    return result && CheckLists();
+  }
+
+/*
+ * Main program
+ */
+
+  int main( int argc, char* argv[] ) {
+    unsigned seed = 1;
+    unsigned round;
+
+    if( argc > 1 ) {
+      seed = (unsigned)strtoul(argv[1], NULL, 10);
+    }
+    randomState = seed ? seed : 1;
+
+    MakeKeyNames();
+
+    for( round = 0; round < ROUND_COUNT; round++ ) {
+      ClearModel();
+      wordList = CreateWord(NextRandom(&randomState) % 64);
+      countList = CreateCount(NextRandom(&randomState) % 64);
+      pairList = CreatePair(NextRandom(&randomState) % 64);
+      if( !(wordList && countList && pairList) ) {
+        printf( "Error allocating lists\n" );
+        return 1;
+      }
+
+      if( RunRound() == 0 ) {
+        printf( "upsertmodel: failed in round %u, seed %u\n", round,
+            seed );
+        return 1;
+      }
+
+      FreeWord( &wordList );
+      FreeCount( &countList );
+      FreePair( &pairList );
+    }
+
+    if( growCalls == 0 ) {
+      printf( "upsertmodel: growth function not called, seed %u\n", seed );
+      return 1;
+    }
+
+    printf( "upsertmodel: passed %u rounds, seed %u\n", ROUND_COUNT,
+        seed );
+    return 0;
+  }
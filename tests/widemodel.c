@@ -0,0 +1,541 @@
+#include <stdio.h>
+
+#include "../keyarray.h"
+#include "model.h"
+
+/*
+ *  File: tests/widemodel.c
+ *  Status: Complete
+ *
+ *  Key Width Model Test: random operations checked against a model
+ *
+ *  Runs the same random inserts, removes, modifies, retrieves, finds,
+ *  and merges on unsigned lists of 16, 32, and 64 bit keys, and checks
+ *  every result against a table of the keys that should be present.
+ *  Lower bound, upper bound, and range are probed with keys in the list,
+ *  keys between two keys, and the smallest and largest keys of each
+ *  width. Space is reserved or released along the way.
+ *
+ *  Key n is 2556 + 21n in the 16 bit list, so that the last key is
+ *  65535, and (n << 20) + n + 1 and (n << 52) + n + 1 in the 32 and 64
+ *  bit lists, so that half of the keys have the top bit set, and a key
+ *  one less than any key is never a key.
+ *
+ *  Every CHECK_INTERVAL operations, and at the end of each round, each
+ *  list is walked in full, and a copy of each list is checked the same
+ *  way.
+ *
+ *  Build and run with the Makefile in this directory:
+ *    make check
+ *  or pass a seed, to repeat a run with other operations:
+ *    ./widemodel 12345
+ *
+ *  https://github.com/orlandol/keyarray
+ */
+
+/*
+ * Model declarations
+ */
+
+  #define KEY_LIMIT 3000
+  #define ROUND_COUNT 24
+  #define STEP_COUNT 6000
+  #define CHECK_INTERVAL 500
+  #define BATCH_LIMIT 16
+
+  unsigned char present[KEY_LIMIT];
+  unsigned value[KEY_LIMIT];
+  size_t presentCount = 0;
+
+  void ClearModel() {
+    memset( present, 0, sizeof(present) );
+    memset( value, 0, sizeof(value) );
+    presentCount = 0;
+  }
+
+  /* Returns the number of keys in the model less than keyId */
+  size_t CountBelow( unsigned keyId ) {
+    size_t count = 0;
+    unsigned modelId;
+
+    for( modelId = 0; (modelId < keyId) && (modelId < KEY_LIMIT);
+        modelId++ ) {
+      count += present[modelId];
+    }
+    return count;
+  }
+
+/*
+ * List declarations
+ */
+
+  int CopyValue( unsigned* dest, unsigned* source ) {
+    (*dest) = (*source);
+    return 1;
+  }
+
+  void AddValue( unsigned* existing, unsigned* incoming ) {
+    (*existing) += (*incoming);
+  }
+
+  DECLARE_UINT_KEYARRAY_TYPES_WIDTH( NarrowList, unsigned, 16 )
+  DECLARE_UINT_KEYARRAY_CREATE( CreateNarrow, NarrowList )
+  DECLARE_UINT_KEYARRAY_FREE( FreeNarrow, NarrowList, FreeNothing )
+  DECLARE_UINT_KEYARRAY_INSERT( InsertNarrow, NarrowList, unsigned )
+  DECLARE_UINT_KEYARRAY_RESERVE( ReserveNarrow, NarrowList )
+  DECLARE_UINT_KEYARRAY_REMOVE( RemoveNarrow, NarrowList, FreeNothing )
+  DECLARE_UINT_KEYARRAY_RETRIEVE( RetrieveNarrow, NarrowList, unsigned )
+  DECLARE_UINT_KEYARRAY_MODIFY( ModifyNarrow, NarrowList, unsigned )
+  DECLARE_UINT_KEYARRAY_FINDINDEX( FindNarrowInt, NarrowList )
+  DECLARE_UINT_KEYARRAY_FINDINDEX_SIZE( FindNarrow, NarrowList )
+  DECLARE_UINT_KEYARRAY_LOWERBOUND( LowerBoundNarrow, NarrowList )
+  DECLARE_UINT_KEYARRAY_UPPERBOUND( UpperBoundNarrow, NarrowList )
+  DECLARE_UINT_KEYARRAY_RANGE( RangeNarrow, NarrowList )
+  DECLARE_UINT_KEYARRAY_MERGEBATCH( MergeNarrow, NarrowList, unsigned,
+      AddValue, FreeNothing )
+  DECLARE_UINT_KEYARRAY_RELEASEUNUSED( ReleaseNarrow, NarrowList )
+  DECLARE_UINT_KEYARRAY_COPY( CopyNarrow, NarrowList, unsigned,
+      CopyValue, FreeNothing )
+
+  DECLARE_UINT_KEYARRAY_TYPES_WIDTH( MiddleList, unsigned, 32 )
+  DECLARE_UINT_KEYARRAY_CREATE( CreateMiddle, MiddleList )
+  DECLARE_UINT_KEYARRAY_FREE( FreeMiddle, MiddleList, FreeNothing )
+  DECLARE_UINT_KEYARRAY_INSERT( InsertMiddle, MiddleList, unsigned )
+  DECLARE_UINT_KEYARRAY_RESERVE( ReserveMiddle, MiddleList )
+  DECLARE_UINT_KEYARRAY_REMOVE( RemoveMiddle, MiddleList, FreeNothing )
+  DECLARE_UINT_KEYARRAY_RETRIEVE( RetrieveMiddle, MiddleList, unsigned )
+  DECLARE_UINT_KEYARRAY_MODIFY( ModifyMiddle, MiddleList, unsigned )
+  DECLARE_UINT_KEYARRAY_FINDINDEX( FindMiddleInt, MiddleList )
+  DECLARE_UINT_KEYARRAY_FINDINDEX_SIZE( FindMiddle, MiddleList )
+  DECLARE_UINT_KEYARRAY_LOWERBOUND( LowerBoundMiddle, MiddleList )
+  DECLARE_UINT_KEYARRAY_UPPERBOUND( UpperBoundMiddle, MiddleList )
+  DECLARE_UINT_KEYARRAY_RANGE( RangeMiddle, MiddleList )
+  DECLARE_UINT_KEYARRAY_MERGEBATCH( MergeMiddle, MiddleList, unsigned,
+      AddValue, FreeNothing )
+  DECLARE_UINT_KEYARRAY_RELEASEUNUSED( ReleaseMiddle, MiddleList )
+  DECLARE_UINT_KEYARRAY_COPY( CopyMiddle, MiddleList, unsigned,
+      CopyValue, FreeNothing )
+
+  DECLARE_UINT_KEYARRAY_TYPES_WIDTH( WideList, unsigned, 64 )
+  DECLARE_UINT_KEYARRAY_CREATE( CreateWide, WideList )
+  DECLARE_UINT_KEYARRAY_FREE( FreeWide, WideList, FreeNothing )
+  DECLARE_UINT_KEYARRAY_INSERT( InsertWide, WideList, unsigned )
+  DECLARE_UINT_KEYARRAY_RESERVE( ReserveWide, WideList )
+  DECLARE_UINT_KEYARRAY_REMOVE( RemoveWide, WideList, FreeNothing )
+  DECLARE_UINT_KEYARRAY_RETRIEVE( RetrieveWide, WideList, unsigned )
+  DECLARE_UINT_KEYARRAY_MODIFY( ModifyWide, WideList, unsigned )
+  DECLARE_UINT_KEYARRAY_FINDINDEX( FindWideInt, WideList )
+  DECLARE_UINT_KEYARRAY_FINDINDEX_SIZE( FindWide, WideList )
+  DECLARE_UINT_KEYARRAY_LOWERBOUND( LowerBoundWide, WideList )
+  DECLARE_UINT_KEYARRAY_UPPERBOUND( UpperBoundWide, WideList )
+  DECLARE_UINT_KEYARRAY_RANGE( RangeWide, WideList )
+  DECLARE_UINT_KEYARRAY_MERGEBATCH( MergeWide, WideList, unsigned,
+      AddValue, FreeNothing )
+  DECLARE_UINT_KEYARRAY_RELEASEUNUSED( ReleaseWide, WideList )
+  DECLARE_UINT_KEYARRAY_COPY( CopyWide, WideList, unsigned,
+      CopyValue, FreeNothing )
+
+  NarrowList* narrowList = NULL;
+  MiddleList* middleList = NULL;
+  WideList* wideList = NULL;
+
+  NarrowListKey NarrowKey( unsigned keyId ) {
+    return (NarrowListKey)(2556 + (21 * keyId));
+  }
+
+  MiddleListKey MiddleKey( unsigned keyId ) {
+    return (((MiddleListKey)keyId) << 20) + keyId + 1;
+  }
+
+  WideListKey WideKey( unsigned keyId ) {
+    return (((WideListKey)keyId) << 52) + keyId + 1;
+  }
+
+/*
+ * List checks
+ */
+
+  /* Checks one item, in list order, against the model */
+  int CheckItem( size_t index, unsigned previousKeyId, unsigned keyId,
+      unsigned data ) {
+    CHECK( keyId < KEY_LIMIT );
+    CHECK( present[keyId] );
+    CHECK( data == value[keyId] );
+    if( index ) {
+      CHECK( previousKeyId < keyId );
+    }
+    return 1;
+  }
+
+  /* Walks each list in full. Keys are in strictly increasing order, and
+     as many as in the model, so each list holds exactly the model's
+     keys. */
+  int CheckNarrow( NarrowList* keyList ) {
+    unsigned keyId = 0;
+    unsigned previousKeyId = 0;
+    size_t index;
+
+    CHECK( keyList->itemCount == presentCount );
+    CHECK( keyList->itemCount <= keyList->reservedCount );
+    for( index = 0; index < keyList->itemCount; index++ ) {
+      CHECK( keyList->item[index].key >= NarrowKey(0) );
+      keyId = (keyList->item[index].key - NarrowKey(0)) / 21;
+      CHECK( keyList->item[index].key == NarrowKey(keyId) );
+      CHECK( CheckItem(index, previousKeyId, keyId,
+          keyList->item[index].data) );
+      CHECK( FindNarrow(keyList, keyList->item[index].key) == index );
+      previousKeyId = keyId;
+    }
+    return 1;
+  }
+
+  int CheckMiddle( MiddleList* keyList ) {
+    unsigned keyId = 0;
+    unsigned previousKeyId = 0;
+    size_t index;
+
+    CHECK( keyList->itemCount == presentCount );
+    CHECK( keyList->itemCount <= keyList->reservedCount );
+    for( index = 0; index < keyList->itemCount; index++ ) {
+      keyId = (unsigned)(keyList->item[index].key >> 20);
+      CHECK( keyList->item[index].key == MiddleKey(keyId) );
+      CHECK( CheckItem(index, previousKeyId, keyId,
+          keyList->item[index].data) );
+      CHECK( FindMiddle(keyList, keyList->item[index].key) == index );
+      previousKeyId = keyId;
+    }
+    return 1;
+  }
+
+  int CheckWide( WideList* keyList ) {
+    unsigned keyId = 0;
+    unsigned previousKeyId = 0;
+    size_t index;
+
+    CHECK( keyList->itemCount == presentCount );
+    CHECK( keyList->itemCount <= keyList->reservedCount );
+    for( index = 0; index < keyList->itemCount; index++ ) {
+      keyId = (unsigned)(keyList->item[index].key >> 52);
+      CHECK( keyList->item[index].key == WideKey(keyId) );
+      CHECK( CheckItem(index, previousKeyId, keyId,
+          keyList->item[index].data) );
+      CHECK( FindWide(keyList, keyList->item[index].key) == index );
+      previousKeyId = keyId;
+    }
+    return 1;
+  }
+
+  /* Checks each list, and a copy of each list */
+  int CheckLists() {
+    NarrowList* narrowCopy = NULL;
+    MiddleList* middleCopy = NULL;
+    WideList* wideCopy = NULL;
+    int result;
+
+    CHECK( CheckNarrow(narrowList) );
+    CHECK( CheckMiddle(middleList) );
+    CHECK( CheckWide(wideList) );
+
+    narrowCopy = CopyNarrow(narrowList);
+    middleCopy = CopyMiddle(middleList);
+    wideCopy = CopyWide(wideList);
+    result = narrowCopy && middleCopy && wideCopy &&
+        CheckNarrow(narrowCopy) && CheckMiddle(middleCopy) &&
+        CheckWide(wideCopy);
+
+    FreeNarrow( &narrowCopy );
+    FreeMiddle( &middleCopy );
+    FreeWide( &wideCopy );
+
+    CHECK( result );
+    return 1;
+  }
+
+/*
+ * Operations
+ */
+
+  int TestInsert( unsigned keyId ) {
+    unsigned data = NextRandom(&randomState);
+    int expected = (present[keyId] == 0);
+
+    CHECK( (InsertNarrow(narrowList, NarrowKey(keyId), &data) != 0) ==
+        expected );
+    CHECK( (InsertMiddle(middleList, MiddleKey(keyId), &data) != 0) ==
+        expected );
+    CHECK( (InsertWide(wideList, WideKey(keyId), &data) != 0) ==
+        expected );
+
+    if( expected ) {
+      present[keyId] = 1;
+      value[keyId] = data;
+      presentCount++;
+    }
+    return 1;
+  }
+
+  int TestRemove( unsigned keyId ) {
+    RemoveNarrow( narrowList, NarrowKey(keyId) );
+    RemoveMiddle( middleList, MiddleKey(keyId) );
+    RemoveWide( wideList, WideKey(keyId) );
+
+    if( present[keyId] ) {
+      present[keyId] = 0;
+      presentCount--;
+    }
+    return 1;
+  }
+
+  int TestModify( unsigned keyId ) {
+    unsigned data = NextRandom(&randomState);
+    int expected = present[keyId];
+
+    CHECK( (ModifyNarrow(narrowList, NarrowKey(keyId), &data) != 0) ==
+        expected );
+    CHECK( (ModifyMiddle(middleList, MiddleKey(keyId), &data) != 0) ==
+        expected );
+    CHECK( (ModifyWide(wideList, WideKey(keyId), &data) != 0) ==
+        expected );
+
+    if( expected ) {
+      value[keyId] = data;
+    }
+    return 1;
+  }
+
+  int TestRetrieve( unsigned keyId ) {
+    int expected = present[keyId];
+    size_t index = expected ? CountBelow(keyId) : (size_t)-1;
+    int intIndex = expected ? (int)index : -1;
+    unsigned data;
+
+    data = ~value[keyId];
+    CHECK( (RetrieveNarrow(narrowList, NarrowKey(keyId), &data) != 0) ==
+        expected );
+    CHECK( (expected == 0) || (data == value[keyId]) );
+
+    data = ~value[keyId];
+    CHECK( (RetrieveMiddle(middleList, MiddleKey(keyId), &data) != 0) ==
+        expected );
+    CHECK( (expected == 0) || (data == value[keyId]) );
+
+    data = ~value[keyId];
+    CHECK( (RetrieveWide(wideList, WideKey(keyId), &data) != 0) ==
+        expected );
+    CHECK( (expected == 0) || (data == value[keyId]) );
+
+    CHECK( FindNarrow(narrowList, NarrowKey(keyId)) == index );
+    CHECK( FindNarrowInt(narrowList, NarrowKey(keyId)) == intIndex );
+    CHECK( FindMiddle(middleList, MiddleKey(keyId)) == index );
+    CHECK( FindMiddleInt(middleList, MiddleKey(keyId)) == intIndex );
+    CHECK( FindWide(wideList, WideKey(keyId)) == index );
+    CHECK( FindWideInt(wideList, WideKey(keyId)) == intIndex );
+    return 1;
+  }
+
+  /* Probes the bounds of key keyId, and of the key one less, which falls
+     between two keys. Then the smallest and largest key of each width.
+     The largest 16 bit key is the last key. */
+  int TestBounds( unsigned keyId ) {
+    size_t below = CountBelow(keyId);
+    size_t above = below + present[keyId];
+    unsigned lastId = NextRandom(&randomState) % KEY_LIMIT;
+    size_t rangeCount = 0;
+    size_t beginIndex;
+
+    CHECK( LowerBoundNarrow(narrowList, NarrowKey(keyId)) == below );
+    CHECK( UpperBoundNarrow(narrowList, NarrowKey(keyId)) == above );
+    CHECK( LowerBoundNarrow(narrowList, NarrowKey(keyId) - 1) == below );
+    CHECK( UpperBoundNarrow(narrowList, NarrowKey(keyId) - 1) == below );
+    CHECK( LowerBoundMiddle(middleList, MiddleKey(keyId)) == below );
+    CHECK( UpperBoundMiddle(middleList, MiddleKey(keyId)) == above );
+    CHECK( LowerBoundMiddle(middleList, MiddleKey(keyId) - 1) == below );
+    CHECK( UpperBoundMiddle(middleList, MiddleKey(keyId) - 1) == below );
+    CHECK( LowerBoundWide(wideList, WideKey(keyId)) == below );
+    CHECK( UpperBoundWide(wideList, WideKey(keyId)) == above );
+    CHECK( LowerBoundWide(wideList, WideKey(keyId) - 1) == below );
+    CHECK( UpperBoundWide(wideList, WideKey(keyId) - 1) == below );
+
+    CHECK( LowerBoundNarrow(narrowList, 0) == 0 );
+    CHECK( UpperBoundNarrow(narrowList, 0) == 0 );
+    CHECK( LowerBoundMiddle(middleList, 0) == 0 );
+    CHECK( UpperBoundMiddle(middleList, 0) == 0 );
+    CHECK( LowerBoundWide(wideList, 0) == 0 );
+    CHECK( UpperBoundWide(wideList, 0) == 0 );
+
+    CHECK( LowerBoundNarrow(narrowList, UINT16_MAX) ==
+        CountBelow(KEY_LIMIT - 1) );
+    CHECK( UpperBoundNarrow(narrowList, UINT16_MAX) == presentCount );
+    CHECK( LowerBoundMiddle(middleList, UINT32_MAX) == presentCount );
+    CHECK( UpperBoundMiddle(middleList, UINT32_MAX) == presentCount );
+    CHECK( LowerBoundWide(wideList, UINT64_MAX) == presentCount );
+    CHECK( UpperBoundWide(wideList, UINT64_MAX) == presentCount );
+
+    /* Range from keyId through lastId */
+    if( lastId >= keyId ) {
+      rangeCount = CountBelow(lastId + 1) - below;
+    }
+
+    beginIndex = (size_t)-1;
+    CHECK( RangeNarrow(narrowList, NarrowKey(keyId), NarrowKey(lastId),
+        &beginIndex) == rangeCount );
+    CHECK( (rangeCount == 0) || (beginIndex == below) );
+    beginIndex = (size_t)-1;
+    CHECK( RangeMiddle(middleList, MiddleKey(keyId), MiddleKey(lastId),
+        &beginIndex) == rangeCount );
+    CHECK( (rangeCount == 0) || (beginIndex == below) );
+    beginIndex = (size_t)-1;
+    CHECK( RangeWide(wideList, WideKey(keyId), WideKey(lastId),
+        &beginIndex) == rangeCount );
+    CHECK( (rangeCount == 0) || (beginIndex == below) );
+    return 1;
+  }
+
+  /* Merges a batch of random keys, some present, some repeated, into
+     each list. Resolved data is added to the data in the list. */
+  int TestMerge( unsigned keyRange ) {
+    NarrowListItem narrowBatch[BATCH_LIMIT];
+    MiddleListItem middleBatch[BATCH_LIMIT];
+    WideListItem wideBatch[BATCH_LIMIT];
+    size_t batchCount = NextRandom(&randomState) % BATCH_LIMIT;
+    size_t batchIndex;
+    unsigned keyId;
+    unsigned data;
+
+    for( batchIndex = 0; batchIndex < batchCount; batchIndex++ ) {
+      keyId = NextRandom(&randomState) % keyRange;
+      data = NextRandom(&randomState);
+
+      narrowBatch[batchIndex].key = NarrowKey(keyId);
+      narrowBatch[batchIndex].data = data;
+      middleBatch[batchIndex].key = MiddleKey(keyId);
+      middleBatch[batchIndex].data = data;
+      wideBatch[batchIndex].key = WideKey(keyId);
+      wideBatch[batchIndex].data = data;
+
+      if( present[keyId] ) {
+        value[keyId] += data;
+      } else {
+        present[keyId] = 1;
+        value[keyId] = data;
+        presentCount++;
+      }
+    }
+
+    CHECK( MergeNarrow(narrowList, narrowBatch, batchCount) );
+    CHECK( MergeMiddle(middleList, middleBatch, batchCount) );
+    CHECK( MergeWide(wideList, wideBatch, batchCount) );
+    return 1;
+  }
+
+  /* Reserves room for more items, or releases unused space */
+  int TestReserve() {
+    size_t reserveCount = presentCount +
+        (NextRandom(&randomState) % 256);
+
+    if( NextRandom(&randomState) % 2 ) {
+      CHECK( ReserveNarrow(narrowList, reserveCount) );
+      CHECK( ReserveMiddle(middleList, reserveCount) );
+      CHECK( ReserveWide(wideList, reserveCount) );
+      CHECK( narrowList->reservedCount >= reserveCount );
+      CHECK( middleList->reservedCount >= reserveCount );
+      CHECK( wideList->reservedCount >= reserveCount );
+    } else {
+      ReleaseNarrow( narrowList );
+      ReleaseMiddle( middleList );
+      ReleaseWide( wideList );
+    }
+    return 1;
+  }
+
+/*
+ * Test rounds
+ */
+
+  int RunRound() {
+    unsigned keyRange = 1 + (NextRandom(&randomState) % KEY_LIMIT);
+    unsigned step;
+    unsigned keyId;
+    int result = 1;
+
+    for( step = 0; result && (step < STEP_COUNT); step++ ) {
+      keyId = NextRandom(&randomState) % keyRange;
+
+      switch( NextRandom(&randomState) % 16 ) {
+      case 0: case 1: case 2: case 3: case 4:
+        result = TestInsert(keyId);
+        break;
+
+      case 5: case 6: case 7: case 8:
+        result = TestRemove(keyId);
+        break;
+
+      case 9:
+        result = TestModify(keyId);
+        break;
+
+      case 10: case 11:
+        result = TestBounds(keyId);
+        break;
+
+      case 12:
+        result = TestMerge(keyRange);
+        break;
+
+      case 15:
+        result = TestReserve();
+        break;
+
+      default:
+        result = TestRetrieve(keyId);
+        break;
+      }
+
+      if( result && ((step % CHECK_INTERVAL) == 0) ) {
+        result = CheckLists();
+      }
+
+      if( result == 0 ) {
+        printf( "  Failed at step %u, key %u\n", step, keyId );
+      }
+    }
+
+    return result && CheckLists();
+  }
+
+/*
+ * Main program
+ */
+
+  int main( int argc, char* argv[] ) {
+    unsigned seed = 1;
+    unsigned round;
+
+    if( argc > 1 ) {
+      seed = (unsigned)strtoul(argv[1], NULL, 10);
+    }
+    randomState = seed ? seed : 1;
+
+    for( round = 0; round < ROUND_COUNT; round++ ) {
+      ClearModel();
+      narrowList = CreateNarrow(NextRandom(&randomState) % 64);
+      middleList = CreateMiddle(NextRandom(&randomState) % 64);
+      wideList = CreateWide(NextRandom(&randomState) % 64);
+      if( !(narrowList && middleList && wideList) ) {
+        printf( "Error allocating lists\n" );
+        return 1;
+      }
+
+      if( RunRound() == 0 ) {
+        printf( "widemodel: failed in round %u, seed %u\n", round, seed );
+        return 1;
+      }
+
+      FreeNarrow( &narrowList );
+      FreeMiddle( &middleList );
+      FreeWide( &wideList );
+    }
+
+    printf( "widemodel: passed %u rounds, seed %u\n", ROUND_COUNT, seed );
+    return 0;
+  }